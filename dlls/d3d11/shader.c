@@ -268,7 +268,6 @@ static HRESULT d3d_vertex_shader_init(struct d3d_vertex_shader *shader, struct d
     shader->ID3D11VertexShader_iface.lpVtbl = &d3d11_vertex_shader_vtbl;
     shader->ID3D10VertexShader_iface.lpVtbl = &d3d10_vertex_shader_vtbl;
     shader->refcount = 1;
-    wined3d_mutex_lock();
     wined3d_private_store_init(&shader->private_store);
 
     desc.byte_code = byte_code;
@@ -278,10 +277,8 @@ static HRESULT d3d_vertex_shader_init(struct d3d_vertex_shader *shader, struct d
     {
         WARN("Failed to create wined3d vertex shader, hr %#x.\n", hr);
         wined3d_private_store_cleanup(&shader->private_store);
-        wined3d_mutex_unlock();
         return E_INVALIDARG;
     }
-    wined3d_mutex_unlock();
 
     ID3D11Device2_AddRef(shader->device = &device->ID3D11Device2_iface);
 
@@ -471,7 +468,6 @@ static HRESULT d3d11_hull_shader_init(struct d3d11_hull_shader *shader, struct d
 
     shader->ID3D11HullShader_iface.lpVtbl = &d3d11_hull_shader_vtbl;
     shader->refcount = 1;
-    wined3d_mutex_lock();
     wined3d_private_store_init(&shader->private_store);
 
     desc.byte_code = byte_code;
@@ -481,10 +477,8 @@ static HRESULT d3d11_hull_shader_init(struct d3d11_hull_shader *shader, struct d
     {
         WARN("Failed to create wined3d hull shader, hr %#x.\n", hr);
         wined3d_private_store_cleanup(&shader->private_store);
-        wined3d_mutex_unlock();
         return E_INVALIDARG;
     }
-    wined3d_mutex_unlock();
 
     ID3D11Device2_AddRef(shader->device = &device->ID3D11Device2_iface);
 
@@ -664,7 +658,6 @@ static HRESULT d3d11_domain_shader_init(struct d3d11_domain_shader *shader, stru
 
     shader->ID3D11DomainShader_iface.lpVtbl = &d3d11_domain_shader_vtbl;
     shader->refcount = 1;
-    wined3d_mutex_lock();
     wined3d_private_store_init(&shader->private_store);
 
     desc.byte_code = byte_code;
@@ -674,10 +667,8 @@ static HRESULT d3d11_domain_shader_init(struct d3d11_domain_shader *shader, stru
     {
         WARN("Failed to create wined3d domain shader, hr %#x.\n", hr);
         wined3d_private_store_cleanup(&shader->private_store);
-        wined3d_mutex_unlock();
         return E_INVALIDARG;
     }
-    wined3d_mutex_unlock();
 
     ID3D11Device2_AddRef(shader->device = &device->ID3D11Device2_iface);
 
@@ -1157,7 +1148,6 @@ static HRESULT d3d_geometry_shader_init(struct d3d_geometry_shader *shader,
     shader->ID3D11GeometryShader_iface.lpVtbl = &d3d11_geometry_shader_vtbl;
     shader->ID3D10GeometryShader_iface.lpVtbl = &d3d10_geometry_shader_vtbl;
     shader->refcount = 1;
-    wined3d_mutex_lock();
     wined3d_private_store_init(&shader->private_store);
 
     if (FAILED(hr = wined3d_shader_create_gs(device->wined3d_device, &desc, so_entries ? &so_desc : NULL,
@@ -1165,10 +1155,8 @@ static HRESULT d3d_geometry_shader_init(struct d3d_geometry_shader *shader,
     {
         WARN("Failed to create wined3d geometry shader, hr %#x.\n", hr);
         wined3d_private_store_cleanup(&shader->private_store);
-        wined3d_mutex_unlock();
         return E_INVALIDARG;
     }
-    wined3d_mutex_unlock();
 
     ID3D11Device2_AddRef(shader->device = &device->ID3D11Device2_iface);
 
@@ -1464,7 +1452,6 @@ static HRESULT d3d_pixel_shader_init(struct d3d_pixel_shader *shader, struct d3d
     shader->ID3D11PixelShader_iface.lpVtbl = &d3d11_pixel_shader_vtbl;
     shader->ID3D10PixelShader_iface.lpVtbl = &d3d10_pixel_shader_vtbl;
     shader->refcount = 1;
-    wined3d_mutex_lock();
     wined3d_private_store_init(&shader->private_store);
 
     desc.byte_code = byte_code;
@@ -1474,10 +1461,8 @@ static HRESULT d3d_pixel_shader_init(struct d3d_pixel_shader *shader, struct d3d
     {
         WARN("Failed to create wined3d pixel shader, hr %#x.\n", hr);
         wined3d_private_store_cleanup(&shader->private_store);
-        wined3d_mutex_unlock();
         return E_INVALIDARG;
     }
-    wined3d_mutex_unlock();
 
     ID3D11Device2_AddRef(shader->device = &device->ID3D11Device2_iface);
 
@@ -1665,7 +1650,6 @@ static HRESULT d3d11_compute_shader_init(struct d3d11_compute_shader *shader, st
 
     shader->ID3D11ComputeShader_iface.lpVtbl = &d3d11_compute_shader_vtbl;
     shader->refcount = 1;
-    wined3d_mutex_lock();
     wined3d_private_store_init(&shader->private_store);
 
     desc.byte_code = byte_code;
@@ -1675,10 +1659,8 @@ static HRESULT d3d11_compute_shader_init(struct d3d11_compute_shader *shader, st
     {
         WARN("Failed to create wined3d compute shader, hr %#x.\n", hr);
         wined3d_private_store_cleanup(&shader->private_store);
-        wined3d_mutex_unlock();
         return E_INVALIDARG;
     }
-    wined3d_mutex_unlock();
 
     ID3D11Device2_AddRef(shader->device = &device->ID3D11Device2_iface);
 
@@ -2258,7 +2258,7 @@ static void test_create_deferred_context(void)
     }
 
     hr = ID3D11Device_CreateDeferredContext(device, 0, &context);
-    todo_wine ok(hr == DXGI_ERROR_INVALID_CALL, "Failed to create deferred context, hr %#x.\n", hr);
+    ok(hr == DXGI_ERROR_INVALID_CALL, "Failed to create deferred context, hr %#x.\n", hr);
 
     refcount = ID3D11Device_Release(device);
     ok(!refcount, "Device has %u references left.\n", refcount);
@@ -2271,7 +2271,7 @@ static void test_create_deferred_context(void)
 
     expected_refcount = get_refcount(device) + 1;
     hr = ID3D11Device_CreateDeferredContext(device, 0, &context);
-    todo_wine ok(hr == S_OK, "Failed to create deferred context, hr %#x.\n", hr);
+    ok(hr == S_OK, "Failed to create deferred context, hr %#x.\n", hr);
     if (FAILED(hr))
         goto done;
     refcount = get_refcount(device);
@@ -13424,6 +13424,72 @@ static void test_resource_map(void)
     ok(!refcount, "Device has %u references left.\n", refcount);
 }
 
+static void test_dynamic_buffer_map(void)
+{
+    D3D11_MAPPED_SUBRESOURCE map_desc;
+    struct resource_readback rb;
+    D3D11_BUFFER_DESC buffer_desc;
+    ID3D11DeviceContext *context;
+    unsigned int i, j, expected;
+    ID3D11Buffer *buffer;
+    ID3D11Device *device;
+    DWORD *data, value;
+    ULONG refcount;
+    HRESULT hr;
+
+    if (!(device = create_device(NULL)))
+    {
+        skip("Failed to create device.\n");
+        return;
+    }
+
+    ID3D11Device_GetImmediateContext(device, &context);
+
+    buffer_desc.ByteWidth = 1024;
+    buffer_desc.Usage = D3D11_USAGE_DYNAMIC;
+    buffer_desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+    buffer_desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+    buffer_desc.MiscFlags = 0;
+    buffer_desc.StructureByteStride = 0;
+    hr = ID3D11Device_CreateBuffer(device, &buffer_desc, NULL, &buffer);
+    ok(hr == S_OK, "Failed to create buffer, hr %#x.\n", hr);
+
+    /* WRITE_NO_OVERWRITE maps have to return the current buffer contents,
+     * even right after a WRITE_DISCARD map. */
+    for (i = 0; i < 4; ++i)
+    {
+        hr = ID3D11DeviceContext_Map(context, (ID3D11Resource *)buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &map_desc);
+        ok(hr == S_OK, "Got unexpected hr %#x.\n", hr);
+        data = map_desc.pData;
+        for (j = 0; j < buffer_desc.ByteWidth / sizeof(*data); ++j)
+            data[j] = i << 16 | j;
+        ID3D11DeviceContext_Unmap(context, (ID3D11Resource *)buffer, 0);
+
+        hr = ID3D11DeviceContext_Map(context, (ID3D11Resource *)buffer, 0,
+                D3D11_MAP_WRITE_NO_OVERWRITE, 0, &map_desc);
+        ok(hr == S_OK, "Got unexpected hr %#x.\n", hr);
+        data = map_desc.pData;
+        for (j = 64; j < 128; ++j)
+            data[j] = 0xdead0000 | j;
+        ID3D11DeviceContext_Unmap(context, (ID3D11Resource *)buffer, 0);
+
+        get_buffer_readback(buffer, &rb);
+        for (j = 0; j < buffer_desc.ByteWidth / sizeof(*data); ++j)
+        {
+            value = get_readback_u32(&rb, j, 0, 0);
+            expected = j >= 64 && j < 128 ? 0xdead0000 | j : i << 16 | j;
+            ok(value == expected, "%u: Got unexpected value %#x at %u, expected %#x.\n", i, value, j, expected);
+        }
+        release_resource_readback(&rb);
+    }
+
+    ID3D11Buffer_Release(buffer);
+    ID3D11DeviceContext_Release(context);
+
+    refcount = ID3D11Device_Release(device);
+    ok(!refcount, "Device has %u references left.\n", refcount);
+}
+
 #define check_resource_cpu_access(a, b, c, d, e) check_resource_cpu_access_(__LINE__, a, b, c, d, e)
 static void check_resource_cpu_access_(unsigned int line, ID3D11DeviceContext *context,
         ID3D11Resource *resource, D3D11_USAGE usage, UINT bind_flags, UINT cpu_access)
@@ -30314,7 +30380,7 @@ static void test_deferred_context_state(void)
     ID3D11DeviceContext_PSSetConstantBuffers(immediate, 0, 1, &green_buffer);
 
     hr = ID3D11Device_CreateDeferredContext(device, 0, &deferred);
-    todo_wine ok(hr == S_OK, "Failed to create deferred context, hr %#x.\n", hr);
+    ok(hr == S_OK, "Failed to create deferred context, hr %#x.\n", hr);
     if (hr != S_OK)
     {
         ID3D11Buffer_Release(blue_buffer);
@@ -30389,7 +30455,7 @@ static void test_deferred_context_rendering(void)
     ID3D11DeviceContext_ClearRenderTargetView(immediate, test_context.backbuffer_rtv, white);
 
     hr = ID3D11Device_CreateDeferredContext(device, 0, &deferred);
-    todo_wine ok(hr == S_OK, "Failed to create deferred context, hr %#x.\n", hr);
+    ok(hr == S_OK, "Failed to create deferred context, hr %#x.\n", hr);
     if (hr != S_OK)
     {
         release_test_context(&test_context);
@@ -30466,6 +30532,732 @@ static void test_deferred_context_rendering(void)
     release_test_context(&test_context);
 }
 
+static void test_deferred_context_map(void)
+{
+    ID3D11DeviceContext *immediate, *deferred;
+    struct d3d11_test_context test_context;
+    D3D11_MAPPED_SUBRESOURCE map_desc;
+    struct resource_readback rb;
+    D3D11_BUFFER_DESC buffer_desc;
+    ID3D11CommandList *list;
+    ID3D11Buffer *buffer;
+    ID3D11Device *device;
+    unsigned int i;
+    DWORD *data;
+    HRESULT hr;
+
+    if (!init_test_context(&test_context, NULL))
+        return;
+
+    device = test_context.device;
+    immediate = test_context.immediate_context;
+
+    hr = ID3D11Device_CreateDeferredContext(device, 0, &deferred);
+    ok(hr == S_OK, "Failed to create deferred context, hr %#x.\n", hr);
+    if (hr != S_OK)
+    {
+        release_test_context(&test_context);
+        return;
+    }
+
+    buffer_desc.ByteWidth = 64 * sizeof(*data);
+    buffer_desc.Usage = D3D11_USAGE_DYNAMIC;
+    buffer_desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+    buffer_desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+    buffer_desc.MiscFlags = 0;
+    buffer_desc.StructureByteStride = 0;
+    hr = ID3D11Device_CreateBuffer(device, &buffer_desc, NULL, &buffer);
+    ok(hr == S_OK, "Failed to create buffer, hr %#x.\n", hr);
+
+    hr = ID3D11DeviceContext_Map(deferred, (ID3D11Resource *)buffer, 0, D3D11_MAP_WRITE_NO_OVERWRITE, 0, &map_desc);
+    ok(hr == E_INVALIDARG, "Got unexpected hr %#x.\n", hr);
+    hr = ID3D11DeviceContext_Map(deferred, (ID3D11Resource *)buffer, 0, D3D11_MAP_WRITE, 0, &map_desc);
+    ok(hr == E_INVALIDARG, "Got unexpected hr %#x.\n", hr);
+
+    hr = ID3D11DeviceContext_Map(deferred, (ID3D11Resource *)buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &map_desc);
+    ok(hr == S_OK, "Failed to map buffer, hr %#x.\n", hr);
+    data = map_desc.pData;
+    for (i = 0; i < 64; ++i)
+        data[i] = i;
+    ID3D11DeviceContext_Unmap(deferred, (ID3D11Resource *)buffer, 0);
+
+    /* The previous contents are kept for NO_OVERWRITE maps. */
+    hr = ID3D11DeviceContext_Map(deferred, (ID3D11Resource *)buffer, 0, D3D11_MAP_WRITE_NO_OVERWRITE, 0, &map_desc);
+    ok(hr == S_OK, "Failed to map buffer, hr %#x.\n", hr);
+    data = map_desc.pData;
+    for (i = 32; i < 64; ++i)
+        data[i] = 0xdeadbeef;
+    ID3D11DeviceContext_Unmap(deferred, (ID3D11Resource *)buffer, 0);
+
+    hr = ID3D11DeviceContext_FinishCommandList(deferred, FALSE, &list);
+    ok(hr == S_OK, "Failed to create command list, hr %#x.\n", hr);
+
+    ID3D11DeviceContext_ExecuteCommandList(immediate, list, FALSE);
+    get_buffer_readback(buffer, &rb);
+    for (i = 0; i < 64; ++i)
+    {
+        DWORD expected = i < 32 ? i : 0xdeadbeef;
+        DWORD value = get_readback_u32(&rb, i, 0, 0);
+
+        ok(value == expected, "Got unexpected value %#x at %u.\n", value, i);
+    }
+    release_resource_readback(&rb);
+
+    /* Mappings don't carry over into the next command list. */
+    hr = ID3D11DeviceContext_Map(deferred, (ID3D11Resource *)buffer, 0, D3D11_MAP_WRITE_NO_OVERWRITE, 0, &map_desc);
+    ok(hr == E_INVALIDARG, "Got unexpected hr %#x.\n", hr);
+
+    ID3D11CommandList_Release(list);
+    ID3D11Buffer_Release(buffer);
+    ID3D11DeviceContext_Release(deferred);
+    release_test_context(&test_context);
+}
+
+/* Draws with a stream of new pixel shaders, and prints a histogram of the
+ * frame times. The shaders only differ in an immediate constant, and are
+ * first used in the middle of a frame, like in games that create their
+ * shaders on demand. Changing the constant invalidates the DXBC checksum,
+ * so this only runs on implementations that don't validate it. */
+static void test_shader_compile_frame_times(void)
+{
+    static const unsigned int bucket_limits[] = {2, 4, 8, 16, 33, 66, 133};
+    static const float white[] = {1.0f, 1.0f, 1.0f, 1.0f};
+    unsigned int histogram[ARRAY_SIZE(bucket_limits) + 1] = {0};
+    struct d3d11_test_context test_context;
+    LARGE_INTEGER frequency, start, end;
+    ID3D11PixelShader *ps[64] = {NULL};
+    DWORD code[53], color, time, max_time = 0;
+    ID3D11DeviceContext *context;
+    ID3D11Device *device;
+    unsigned int i, j;
+    float red;
+    HRESULT hr;
+
+    static const DWORD ps_code[] =
+    {
+#if 0
+        float4 main(float4 position : SV_POSITION) : SV_Target
+        {
+            return float4(0.0, 1.0, 0.0, 1.0);
+        }
+#endif
+        0x43425844, 0x30240e72, 0x012f250c, 0x8673c6ea, 0x392e4cec, 0x00000001, 0x000000d4, 0x00000003,
+        0x0000002c, 0x00000060, 0x00000094, 0x4e475349, 0x0000002c, 0x00000001, 0x00000008, 0x00000020,
+        0x00000000, 0x00000001, 0x00000003, 0x00000000, 0x0000000f, 0x505f5653, 0x5449534f, 0x004e4f49,
+        0x4e47534f, 0x0000002c, 0x00000001, 0x00000008, 0x00000020, 0x00000000, 0x00000000, 0x00000003,
+        0x00000000, 0x0000000f, 0x545f5653, 0x65677261, 0xabab0074, 0x52444853, 0x00000038, 0x00000040,
+        0x0000000e, 0x03000065, 0x001020f2, 0x00000000, 0x08000036, 0x001020f2, 0x00000000, 0x00004002,
+        0x00000000, 0x3f800000, 0x00000000, 0x3f800000, 0x0100003e,
+    };
+
+    if (!init_test_context(&test_context, NULL))
+        return;
+
+    device = test_context.device;
+    context = test_context.immediate_context;
+
+    for (i = 0; i < ARRAY_SIZE(ps); ++i)
+    {
+        memcpy(code, ps_code, sizeof(code));
+        red = i / 255.0f;
+        memcpy(&code[48], &red, sizeof(red));
+        if (FAILED(hr = ID3D11Device_CreatePixelShader(device, code, sizeof(code), NULL, &ps[i])))
+        {
+            skip("Failed to create pixel shader, hr %#x.\n", hr);
+            goto done;
+        }
+    }
+
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&start);
+    for (i = 0; i < 4 * ARRAY_SIZE(ps); ++i)
+    {
+        /* Switch to a new shader every fourth frame. */
+        ID3D11DeviceContext_PSSetShader(context, ps[i / 4], NULL, 0);
+        ID3D11DeviceContext_ClearRenderTargetView(context, test_context.backbuffer_rtv, white);
+        draw_quad(&test_context);
+        IDXGISwapChain_Present(test_context.swapchain, 0, 0);
+
+        QueryPerformanceCounter(&end);
+        time = (end.QuadPart - start.QuadPart) * 1000 / frequency.QuadPart;
+        start = end;
+
+        max_time = max(max_time, time);
+        for (j = 0; j < ARRAY_SIZE(bucket_limits) && time >= bucket_limits[j]; ++j);
+        ++histogram[j];
+    }
+
+    trace("Frame times for %u frames, maximum %u ms:\n", i, max_time);
+    for (j = 0; j < ARRAY_SIZE(histogram); ++j)
+    {
+        if (j < ARRAY_SIZE(bucket_limits))
+            trace("  < %3u ms: %u\n", bucket_limits[j], histogram[j]);
+        else
+            trace(" >= %3u ms: %u\n", bucket_limits[j - 1], histogram[j]);
+    }
+
+    /* Draws may be skipped while shaders are compiled asynchronously, but
+     * the last shader has to be used eventually. */
+    for (i = 0; i < 100; ++i)
+    {
+        ID3D11DeviceContext_ClearRenderTargetView(context, test_context.backbuffer_rtv, white);
+        draw_quad(&test_context);
+        color = get_texture_color(test_context.backbuffer, 320, 240);
+        if (compare_color(color, 0xff00ff3f, 1))
+            break;
+        Sleep(10);
+    }
+    ok(compare_color(color, 0xff00ff3f, 1), "Got unexpected color 0x%08x.\n", color);
+
+done:
+    for (i = 0; i < ARRAY_SIZE(ps); ++i)
+    {
+        if (ps[i])
+            ID3D11PixelShader_Release(ps[i]);
+    }
+    release_test_context(&test_context);
+}
+
+struct draw_submission_thread
+{
+    struct d3d11_test_context *test_context;
+    ID3D11DeviceContext *deferred;
+    ID3D11PixelShader *ps;
+    ID3D11CommandList *list;
+    unsigned int draw_count;
+};
+
+static void record_draw_submission(struct d3d11_test_context *test_context,
+        ID3D11DeviceContext *context, ID3D11PixelShader *ps, unsigned int draw_count)
+{
+    unsigned int stride = sizeof(struct vec3), offset = 0, i;
+
+    ID3D11DeviceContext_IASetInputLayout(context, test_context->input_layout);
+    ID3D11DeviceContext_IASetPrimitiveTopology(context, D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+    ID3D11DeviceContext_IASetVertexBuffers(context, 0, 1, &test_context->vb, &stride, &offset);
+    ID3D11DeviceContext_VSSetShader(context, test_context->vs, NULL, 0);
+    ID3D11DeviceContext_OMSetRenderTargets(context, 1, &test_context->backbuffer_rtv, NULL);
+    set_viewport(context, 0.0f, 0.0f, 640.0f, 480.0f, 0.0f, 1.0f);
+
+    for (i = 0; i < draw_count; ++i)
+    {
+        /* Rebind the shader, like an application drawing different
+         * materials would. */
+        ID3D11DeviceContext_PSSetShader(context, ps, NULL, 0);
+        ID3D11DeviceContext_Draw(context, 4, 0);
+    }
+}
+
+static DWORD WINAPI draw_submission_thread_proc(void *arg)
+{
+    struct draw_submission_thread *thread = arg;
+    HRESULT hr;
+
+    record_draw_submission(thread->test_context, thread->deferred, thread->ps, thread->draw_count);
+    hr = ID3D11DeviceContext_FinishCommandList(thread->deferred, FALSE, &thread->list);
+    ok(hr == S_OK, "Failed to create command list, hr %#x.\n", hr);
+
+    return 0;
+}
+
+/* Records the same number of draws on the immediate context, and from
+ * several threads on deferred contexts, and prints the submission times. */
+static void test_multithreaded_draw_submission(void)
+{
+    static const float white[] = {1.0f, 1.0f, 1.0f, 1.0f};
+    static const unsigned int draw_count = 20000;
+    struct draw_submission_thread threads[4];
+    struct d3d11_test_context test_context;
+    LARGE_INTEGER frequency, start, end;
+    HANDLE handles[ARRAY_SIZE(threads)];
+    ID3D11DeviceContext *immediate;
+    ID3D11PixelShader *ps;
+    ID3D11Device *device;
+    DWORD color, time;
+    unsigned int i;
+    HRESULT hr;
+
+    static const DWORD ps_code[] =
+    {
+#if 0
+        float4 main(float4 position : SV_POSITION) : SV_Target
+        {
+            return float4(0.0, 1.0, 0.0, 1.0);
+        }
+#endif
+        0x43425844, 0x30240e72, 0x012f250c, 0x8673c6ea, 0x392e4cec, 0x00000001, 0x000000d4, 0x00000003,
+        0x0000002c, 0x00000060, 0x00000094, 0x4e475349, 0x0000002c, 0x00000001, 0x00000008, 0x00000020,
+        0x00000000, 0x00000001, 0x00000003, 0x00000000, 0x0000000f, 0x505f5653, 0x5449534f, 0x004e4f49,
+        0x4e47534f, 0x0000002c, 0x00000001, 0x00000008, 0x00000020, 0x00000000, 0x00000000, 0x00000003,
+        0x00000000, 0x0000000f, 0x545f5653, 0x65677261, 0xabab0074, 0x52444853, 0x00000038, 0x00000040,
+        0x0000000e, 0x03000065, 0x001020f2, 0x00000000, 0x08000036, 0x001020f2, 0x00000000, 0x00004002,
+        0x00000000, 0x3f800000, 0x00000000, 0x3f800000, 0x0100003e,
+    };
+
+    if (!init_test_context(&test_context, NULL))
+        return;
+
+    device = test_context.device;
+    immediate = test_context.immediate_context;
+
+    if (ID3D11Device_GetCreationFlags(device) & D3D11_CREATE_DEVICE_SINGLETHREADED)
+    {
+        skip("Deferred contexts are not supported on single-threaded devices.\n");
+        release_test_context(&test_context);
+        return;
+    }
+
+    hr = ID3D11Device_CreatePixelShader(device, ps_code, sizeof(ps_code), NULL, &ps);
+    ok(hr == S_OK, "Failed to create pixel shader, hr %#x.\n", hr);
+
+    /* Create the input layout, vertex shader and vertex buffer. */
+    draw_quad(&test_context);
+
+    ID3D11DeviceContext_ClearRenderTargetView(immediate, test_context.backbuffer_rtv, white);
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&start);
+    record_draw_submission(&test_context, immediate, ps, draw_count);
+    ID3D11DeviceContext_Flush(immediate);
+    QueryPerformanceCounter(&end);
+    time = (end.QuadPart - start.QuadPart) * 1000 / frequency.QuadPart;
+    trace("Immediate context: %u draws submitted in %u ms.\n", draw_count, time);
+    color = get_texture_color(test_context.backbuffer, 320, 240);
+    ok(color == 0xff00ff00, "Got unexpected color %#08x.\n", color);
+
+    for (i = 0; i < ARRAY_SIZE(threads); ++i)
+    {
+        threads[i].test_context = &test_context;
+        threads[i].ps = ps;
+        threads[i].list = NULL;
+        threads[i].draw_count = draw_count / ARRAY_SIZE(threads);
+        hr = ID3D11Device_CreateDeferredContext(device, 0, &threads[i].deferred);
+        ok(hr == S_OK, "Failed to create deferred context, hr %#x.\n", hr);
+    }
+
+    ID3D11DeviceContext_ClearRenderTargetView(immediate, test_context.backbuffer_rtv, white);
+    QueryPerformanceCounter(&start);
+    for (i = 0; i < ARRAY_SIZE(threads); ++i)
+        handles[i] = CreateThread(NULL, 0, draw_submission_thread_proc, &threads[i], 0, NULL);
+    WaitForMultipleObjects(ARRAY_SIZE(handles), handles, TRUE, INFINITE);
+    for (i = 0; i < ARRAY_SIZE(threads); ++i)
+        ID3D11DeviceContext_ExecuteCommandList(immediate, threads[i].list, FALSE);
+    ID3D11DeviceContext_Flush(immediate);
+    QueryPerformanceCounter(&end);
+    time = (end.QuadPart - start.QuadPart) * 1000 / frequency.QuadPart;
+    trace("%u deferred contexts: %u draws submitted in %u ms.\n",
+            (unsigned int)ARRAY_SIZE(threads), draw_count, time);
+    color = get_texture_color(test_context.backbuffer, 320, 240);
+    ok(color == 0xff00ff00, "Got unexpected color %#08x.\n", color);
+
+    for (i = 0; i < ARRAY_SIZE(threads); ++i)
+    {
+        CloseHandle(handles[i]);
+        ID3D11CommandList_Release(threads[i].list);
+        ID3D11DeviceContext_Release(threads[i].deferred);
+    }
+    ID3D11PixelShader_Release(ps);
+    release_test_context(&test_context);
+}
+
+/* Prints the time it takes to update a constant buffer or a vertex buffer
+ * before every draw, with UpdateSubresource(), WRITE_DISCARD maps and
+ * WRITE_NO_OVERWRITE maps. */
+static void test_dynamic_buffer_update_times(void)
+{
+    static const struct vec4 red = {1.0f, 0.0f, 0.0f, 1.0f};
+    static const struct vec4 green = {0.0f, 1.0f, 0.0f, 1.0f};
+    static const float white[] = {1.0f, 1.0f, 1.0f, 1.0f};
+    static const unsigned int draw_count = 20000;
+    static const struct vec3 quad[] =
+    {
+        {-1.0f, -1.0f, 0.0f},
+        {-1.0f,  1.0f, 0.0f},
+        { 1.0f, -1.0f, 0.0f},
+        { 1.0f,  1.0f, 0.0f},
+    };
+    unsigned int stride = sizeof(*quad), offset = 0, vertex_count, i;
+    struct d3d11_test_context test_context;
+    LARGE_INTEGER frequency, start, end;
+    D3D11_MAPPED_SUBRESOURCE map_desc;
+    D3D11_BUFFER_DESC buffer_desc;
+    ID3D11DeviceContext *context;
+    ID3D11Buffer *cb, *vb;
+    ID3D11Device *device;
+    DWORD color, time;
+    D3D11_MAP map_type;
+    HRESULT hr;
+
+    if (!init_test_context(&test_context, NULL))
+        return;
+
+    device = test_context.device;
+    context = test_context.immediate_context;
+
+    buffer_desc.ByteWidth = sizeof(struct vec4);
+    buffer_desc.Usage = D3D11_USAGE_DYNAMIC;
+    buffer_desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+    buffer_desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+    buffer_desc.MiscFlags = 0;
+    buffer_desc.StructureByteStride = 0;
+    hr = ID3D11Device_CreateBuffer(device, &buffer_desc, NULL, &cb);
+    ok(hr == S_OK, "Failed to create constant buffer, hr %#x.\n", hr);
+
+    buffer_desc.ByteWidth = 1024 * sizeof(quad);
+    buffer_desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+    hr = ID3D11Device_CreateBuffer(device, &buffer_desc, NULL, &vb);
+    ok(hr == S_OK, "Failed to create vertex buffer, hr %#x.\n", hr);
+
+    QueryPerformanceFrequency(&frequency);
+
+    /* Create the shaders, input layout and default usage constant buffer. */
+    ID3D11DeviceContext_ClearRenderTargetView(context, test_context.backbuffer_rtv, white);
+    draw_color_quad(&test_context, &red);
+
+    QueryPerformanceCounter(&start);
+    for (i = 0; i < draw_count; ++i)
+    {
+        set_quad_color(&test_context, i == draw_count - 1 ? &green : &red);
+        ID3D11DeviceContext_Draw(context, 4, 0);
+    }
+    color = get_texture_color(test_context.backbuffer, 320, 240);
+    QueryPerformanceCounter(&end);
+    time = (end.QuadPart - start.QuadPart) * 1000 / frequency.QuadPart;
+    trace("UpdateSubresource: %u constant buffer updates in %u ms.\n", draw_count, time);
+    ok(color == 0xff00ff00, "Got unexpected color %#08x.\n", color);
+
+    ID3D11DeviceContext_ClearRenderTargetView(context, test_context.backbuffer_rtv, white);
+    ID3D11DeviceContext_PSSetConstantBuffers(context, 0, 1, &cb);
+    QueryPerformanceCounter(&start);
+    for (i = 0; i < draw_count; ++i)
+    {
+        hr = ID3D11DeviceContext_Map(context, (ID3D11Resource *)cb, 0, D3D11_MAP_WRITE_DISCARD, 0, &map_desc);
+        ok(hr == S_OK, "Failed to map constant buffer, hr %#x.\n", hr);
+        memcpy(map_desc.pData, i == draw_count - 1 ? &green : &red, sizeof(green));
+        ID3D11DeviceContext_Unmap(context, (ID3D11Resource *)cb, 0);
+        ID3D11DeviceContext_Draw(context, 4, 0);
+    }
+    color = get_texture_color(test_context.backbuffer, 320, 240);
+    QueryPerformanceCounter(&end);
+    time = (end.QuadPart - start.QuadPart) * 1000 / frequency.QuadPart;
+    trace("WRITE_DISCARD: %u constant buffer updates in %u ms.\n", draw_count, time);
+    ok(color == 0xff00ff00, "Got unexpected color %#08x.\n", color);
+
+    ID3D11DeviceContext_ClearRenderTargetView(context, test_context.backbuffer_rtv, white);
+    ID3D11DeviceContext_IASetVertexBuffers(context, 0, 1, &vb, &stride, &offset);
+    vertex_count = buffer_desc.ByteWidth / sizeof(*quad);
+    QueryPerformanceCounter(&start);
+    for (i = 0; i < draw_count; ++i)
+    {
+        offset = (i * ARRAY_SIZE(quad)) % vertex_count;
+        map_type = offset ? D3D11_MAP_WRITE_NO_OVERWRITE : D3D11_MAP_WRITE_DISCARD;
+        hr = ID3D11DeviceContext_Map(context, (ID3D11Resource *)vb, 0, map_type, 0, &map_desc);
+        ok(hr == S_OK, "Failed to map vertex buffer, hr %#x.\n", hr);
+        memcpy((struct vec3 *)map_desc.pData + offset, quad, sizeof(quad));
+        ID3D11DeviceContext_Unmap(context, (ID3D11Resource *)vb, 0);
+        ID3D11DeviceContext_Draw(context, 4, offset);
+    }
+    color = get_texture_color(test_context.backbuffer, 320, 240);
+    QueryPerformanceCounter(&end);
+    time = (end.QuadPart - start.QuadPart) * 1000 / frequency.QuadPart;
+    trace("WRITE_DISCARD/WRITE_NO_OVERWRITE: %u vertex buffer updates in %u ms.\n", draw_count, time);
+    ok(color == 0xff00ff00, "Got unexpected color %#08x.\n", color);
+
+    ID3D11Buffer_Release(vb);
+    ID3D11Buffer_Release(cb);
+    release_test_context(&test_context);
+}
+
+/* Prints the time it takes to draw with shader resource views, samplers and
+ * constant buffers set before every draw, either with the values that are
+ * already bound, or changed and restored again before the draw. */
+static void test_redundant_state_draw_times(void)
+{
+    static const struct vec4 green = {0.0f, 1.0f, 0.0f, 1.0f};
+    static const float white[] = {1.0f, 1.0f, 1.0f, 1.0f};
+    static const unsigned int draw_count = 20000;
+    struct d3d11_test_context test_context;
+    LARGE_INTEGER frequency, start, end;
+    D3D11_TEXTURE2D_DESC texture_desc;
+    D3D11_SAMPLER_DESC sampler_desc;
+    ID3D11ShaderResourceView *srv[2];
+    ID3D11SamplerState *sampler[2];
+    ID3D11DeviceContext *context;
+    ID3D11Texture2D *texture;
+    ID3D11Device *device;
+    unsigned int i, pass;
+    DWORD color, time;
+    ID3D11Buffer *cb;
+    HRESULT hr;
+
+    if (!init_test_context(&test_context, NULL))
+        return;
+
+    device = test_context.device;
+    context = test_context.immediate_context;
+
+    texture_desc.Width = 64;
+    texture_desc.Height = 64;
+    texture_desc.MipLevels = 1;
+    texture_desc.ArraySize = 1;
+    texture_desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    texture_desc.SampleDesc.Count = 1;
+    texture_desc.SampleDesc.Quality = 0;
+    texture_desc.Usage = D3D11_USAGE_DEFAULT;
+    texture_desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+    texture_desc.CPUAccessFlags = 0;
+    texture_desc.MiscFlags = 0;
+    hr = ID3D11Device_CreateTexture2D(device, &texture_desc, NULL, &texture);
+    ok(hr == S_OK, "Failed to create texture, hr %#x.\n", hr);
+    for (i = 0; i < ARRAY_SIZE(srv); ++i)
+    {
+        hr = ID3D11Device_CreateShaderResourceView(device, (ID3D11Resource *)texture, NULL, &srv[i]);
+        ok(hr == S_OK, "Failed to create shader resource view, hr %#x.\n", hr);
+    }
+
+    memset(&sampler_desc, 0, sizeof(sampler_desc));
+    sampler_desc.AddressU = D3D11_TEXTURE_ADDRESS_WRAP;
+    sampler_desc.AddressV = D3D11_TEXTURE_ADDRESS_WRAP;
+    sampler_desc.AddressW = D3D11_TEXTURE_ADDRESS_WRAP;
+    sampler_desc.MaxLOD = FLT_MAX;
+    for (i = 0; i < ARRAY_SIZE(sampler); ++i)
+    {
+        sampler_desc.Filter = i ? D3D11_FILTER_MIN_MAG_MIP_LINEAR : D3D11_FILTER_MIN_MAG_MIP_POINT;
+        hr = ID3D11Device_CreateSamplerState(device, &sampler_desc, &sampler[i]);
+        ok(hr == S_OK, "Failed to create sampler state, hr %#x.\n", hr);
+    }
+
+    cb = create_buffer(device, D3D11_BIND_CONSTANT_BUFFER, sizeof(green), &green);
+
+    QueryPerformanceFrequency(&frequency);
+
+    /* Create the shaders, input layout and vertex buffer. */
+    ID3D11DeviceContext_ClearRenderTargetView(context, test_context.backbuffer_rtv, white);
+    draw_color_quad(&test_context, &green);
+
+    ID3D11DeviceContext_PSSetShaderResources(context, 0, 2, srv);
+    ID3D11DeviceContext_PSSetSamplers(context, 0, 2, sampler);
+    ID3D11DeviceContext_PSSetConstantBuffers(context, 1, 1, &cb);
+
+    for (pass = 0; pass < 3; ++pass)
+    {
+        ID3D11DeviceContext_ClearRenderTargetView(context, test_context.backbuffer_rtv, white);
+        QueryPerformanceCounter(&start);
+        for (i = 0; i < draw_count; ++i)
+        {
+            if (pass == 1)
+            {
+                ID3D11DeviceContext_PSSetShaderResources(context, 0, 2, srv);
+                ID3D11DeviceContext_PSSetSamplers(context, 0, 2, sampler);
+                ID3D11DeviceContext_PSSetConstantBuffers(context, 1, 1, &cb);
+            }
+            else if (pass == 2)
+            {
+                ID3D11DeviceContext_PSSetShaderResources(context, 0, 1, &srv[1]);
+                ID3D11DeviceContext_PSSetShaderResources(context, 0, 1, &srv[0]);
+                ID3D11DeviceContext_PSSetSamplers(context, 0, 1, &sampler[1]);
+                ID3D11DeviceContext_PSSetSamplers(context, 0, 1, &sampler[0]);
+                ID3D11DeviceContext_PSSetConstantBuffers(context, 1, 1, &test_context.ps_cb);
+                ID3D11DeviceContext_PSSetConstantBuffers(context, 1, 1, &cb);
+            }
+            ID3D11DeviceContext_Draw(context, 4, 0);
+        }
+        color = get_texture_color(test_context.backbuffer, 320, 240);
+        QueryPerformanceCounter(&end);
+        time = (end.QuadPart - start.QuadPart) * 1000 / frequency.QuadPart;
+        trace("%s: %u draws in %u ms.\n", pass == 2 ? "Changed and restored states"
+                : pass == 1 ? "Redundant states" : "No state changes", draw_count, time);
+        ok(color == 0xff00ff00, "Got unexpected color %#08x.\n", color);
+    }
+
+    ID3D11Buffer_Release(cb);
+    for (i = 0; i < ARRAY_SIZE(sampler); ++i)
+        ID3D11SamplerState_Release(sampler[i]);
+    for (i = 0; i < ARRAY_SIZE(srv); ++i)
+        ID3D11ShaderResourceView_Release(srv[i]);
+    ID3D11Texture2D_Release(texture);
+    release_test_context(&test_context);
+}
+
+struct shader_creation_thread
+{
+    ID3D11Device *device;
+    unsigned int count;
+    unsigned int failures;
+};
+
+static const DWORD shader_creation_vs_code[] =
+{
+    0x43425844, 0x3ae813ca, 0x0f034b91, 0x790f3226, 0x6b4a718a, 0x00000001, 0x000001c0,
+    0x00000003, 0x0000002c, 0x0000007c, 0x000000cc, 0x4e475349, 0x00000048, 0x00000002,
+    0x00000008, 0x00000038, 0x00000000, 0x00000000, 0x00000003, 0x00000000, 0x00000f0f,
+    0x00000041, 0x00000000, 0x00000000, 0x00000003, 0x00000001, 0x00000707, 0x49534f50,
+    0x4e4f4954, 0x524f4e00, 0x004c414d, 0x4e47534f, 0x00000048, 0x00000002, 0x00000008,
+    0x00000038, 0x00000000, 0x00000000, 0x00000003, 0x00000000, 0x0000000f, 0x00000041,
+    0x00000000, 0x00000000, 0x00000003, 0x00000001, 0x0000000f, 0x49534f50, 0x4e4f4954,
+    0x4c4f4300, 0xab00524f, 0x52444853, 0x000000ec, 0x00010040, 0x0000003b, 0x04000059,
+    0x00208e46, 0x00000000, 0x00000005, 0x0300005f, 0x001010f2, 0x00000000, 0x0300005f,
+    0x00101072, 0x00000001, 0x03000065, 0x001020f2, 0x00000000, 0x03000065, 0x001020f2,
+    0x00000001, 0x08000011, 0x00102012, 0x00000000, 0x00101e46, 0x00000000, 0x00208e46,
+    0x00000000, 0x00000001, 0x08000011, 0x00102022, 0x00000000, 0x00101e46, 0x00000000,
+    0x00208e46, 0x00000000, 0x00000002, 0x08000011, 0x00102042, 0x00000000, 0x00101e46,
+    0x00000000, 0x00208e46, 0x00000000, 0x00000003, 0x08000011, 0x00102082, 0x00000000,
+    0x00101e46, 0x00000000, 0x00208e46, 0x00000000, 0x00000004, 0x08000010, 0x001020f2,
+    0x00000001, 0x00208246, 0x00000000, 0x00000000, 0x00101246, 0x00000001, 0x0100003e,
+};
+
+static const DWORD shader_creation_gs_code[] =
+{
+    0x43425844, 0x000ee786, 0xc624c269, 0x885a5cbe, 0x444b3b1f, 0x00000001, 0x0000023c, 0x00000003,
+    0x0000002c, 0x00000060, 0x00000094, 0x4e475349, 0x0000002c, 0x00000001, 0x00000008, 0x00000020,
+    0x00000000, 0x00000000, 0x00000003, 0x00000000, 0x00000f0f, 0x49534f50, 0x4e4f4954, 0xababab00,
+    0x4e47534f, 0x0000002c, 0x00000001, 0x00000008, 0x00000020, 0x00000000, 0x00000001, 0x00000003,
+    0x00000000, 0x0000000f, 0x505f5653, 0x5449534f, 0x004e4f49, 0x52444853, 0x000001a0, 0x00020040,
+    0x00000068, 0x0400005f, 0x002010f2, 0x00000001, 0x00000000, 0x02000068, 0x00000001, 0x0100085d,
+    0x0100285c, 0x04000067, 0x001020f2, 0x00000000, 0x00000001, 0x0200005e, 0x00000004, 0x0f000032,
+    0x00100032, 0x00000000, 0x80201ff6, 0x00000041, 0x00000000, 0x00000000, 0x00004002, 0x3dcccccd,
+    0x3dcccccd, 0x00000000, 0x00000000, 0x00201046, 0x00000000, 0x00000000, 0x05000036, 0x00102032,
+    0x00000000, 0x00100046, 0x00000000, 0x06000036, 0x001020c2, 0x00000000, 0x00201ea6, 0x00000000,
+    0x00000000, 0x01000013, 0x05000036, 0x00102012, 0x00000000, 0x0010000a, 0x00000000, 0x0e000032,
+    0x00100052, 0x00000000, 0x00201ff6, 0x00000000, 0x00000000, 0x00004002, 0x3dcccccd, 0x00000000,
+    0x3dcccccd, 0x00000000, 0x00201106, 0x00000000, 0x00000000, 0x05000036, 0x00102022, 0x00000000,
+    0x0010002a, 0x00000000, 0x06000036, 0x001020c2, 0x00000000, 0x00201ea6, 0x00000000, 0x00000000,
+    0x01000013, 0x05000036, 0x00102012, 0x00000000, 0x0010000a, 0x00000000, 0x05000036, 0x00102022,
+    0x00000000, 0x0010001a, 0x00000000, 0x06000036, 0x001020c2, 0x00000000, 0x00201ea6, 0x00000000,
+    0x00000000, 0x01000013, 0x05000036, 0x00102032, 0x00000000, 0x00100086, 0x00000000, 0x06000036,
+    0x001020c2, 0x00000000, 0x00201ea6, 0x00000000, 0x00000000, 0x01000013, 0x0100003e,
+};
+
+static const DWORD shader_creation_ps_code[] =
+{
+#if 0
+    Texture1D t;
+
+    float miplevel;
+
+    float4 main(float4 position : SV_POSITION) : SV_TARGET
+    {
+        float2 p;
+        t.GetDimensions(miplevel, p.x, p.y);
+        p.y = miplevel;
+        p *= float2(position.x / 640.0f, 1.0f);
+        return t.Load(int2(p));
+    }
+#endif
+    0x43425844, 0x7b0c6359, 0x598178f6, 0xef2ddbdb, 0x88fc794c, 0x00000001, 0x000001ac, 0x00000003,
+    0x0000002c, 0x00000060, 0x00000094, 0x4e475349, 0x0000002c, 0x00000001, 0x00000008, 0x00000020,
+    0x00000000, 0x00000001, 0x00000003, 0x00000000, 0x0000010f, 0x505f5653, 0x5449534f, 0x004e4f49,
+    0x4e47534f, 0x0000002c, 0x00000001, 0x00000008, 0x00000020, 0x00000000, 0x00000000, 0x00000003,
+    0x00000000, 0x0000000f, 0x545f5653, 0x45475241, 0xabab0054, 0x52444853, 0x00000110, 0x00000040,
+    0x00000044, 0x04000059, 0x00208e46, 0x00000000, 0x00000001, 0x04001058, 0x00107000, 0x00000000,
+    0x00005555, 0x04002064, 0x00101012, 0x00000000, 0x00000001, 0x03000065, 0x001020f2, 0x00000000,
+    0x02000068, 0x00000001, 0x0600001c, 0x00100012, 0x00000000, 0x0020800a, 0x00000000, 0x00000000,
+    0x0700003d, 0x001000f2, 0x00000000, 0x0010000a, 0x00000000, 0x00107e46, 0x00000000, 0x07000038,
+    0x00100012, 0x00000000, 0x0010000a, 0x00000000, 0x0010100a, 0x00000000, 0x06000036, 0x001000e2,
+    0x00000000, 0x00208006, 0x00000000, 0x00000000, 0x0a000038, 0x001000f2, 0x00000000, 0x00100e46,
+    0x00000000, 0x00004002, 0x3acccccd, 0x3f800000, 0x3f800000, 0x3f800000, 0x0500001b, 0x001000f2,
+    0x00000000, 0x00100e46, 0x00000000, 0x0700002d, 0x001020f2, 0x00000000, 0x00100e46, 0x00000000,
+    0x00107e46, 0x00000000, 0x0100003e,
+};
+
+static unsigned int create_shader_corpus(ID3D11Device *device, unsigned int count)
+{
+    unsigned int i, failures = 0;
+    ID3D11GeometryShader *gs;
+    ID3D11VertexShader *vs;
+    ID3D11PixelShader *ps;
+
+    for (i = 0; i < count; ++i)
+    {
+        switch (i % 3)
+        {
+            case 0:
+                if (FAILED(ID3D11Device_CreateVertexShader(device, shader_creation_vs_code,
+                        sizeof(shader_creation_vs_code), NULL, &vs)))
+                    ++failures;
+                else
+                    ID3D11VertexShader_Release(vs);
+                break;
+
+            case 1:
+                if (FAILED(ID3D11Device_CreateGeometryShader(device, shader_creation_gs_code,
+                        sizeof(shader_creation_gs_code), NULL, &gs)))
+                    ++failures;
+                else
+                    ID3D11GeometryShader_Release(gs);
+                break;
+
+            case 2:
+                if (FAILED(ID3D11Device_CreatePixelShader(device, shader_creation_ps_code,
+                        sizeof(shader_creation_ps_code), NULL, &ps)))
+                    ++failures;
+                else
+                    ID3D11PixelShader_Release(ps);
+                break;
+        }
+    }
+
+    return failures;
+}
+
+static DWORD WINAPI shader_creation_thread_proc(void *arg)
+{
+    struct shader_creation_thread *thread = arg;
+
+    thread->failures = create_shader_corpus(thread->device, thread->count);
+
+    return 0;
+}
+
+/* Prints the time it takes to create the same set of shaders from a single
+ * thread, and from several threads. */
+static void test_shader_creation_times(void)
+{
+    static const unsigned int shader_count = 6000;
+    struct shader_creation_thread threads[4];
+    LARGE_INTEGER frequency, start, end;
+    HANDLE handles[ARRAY_SIZE(threads)];
+    unsigned int i, failures;
+    ID3D11Device *device;
+    DWORD time;
+    ULONG refcount;
+
+    if (!(device = create_device(NULL)))
+    {
+        skip("Failed to create device.\n");
+        return;
+    }
+
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&start);
+    failures = create_shader_corpus(device, shader_count);
+    QueryPerformanceCounter(&end);
+    time = (end.QuadPart - start.QuadPart) * 1000 / frequency.QuadPart;
+    trace("1 thread: %u shaders created in %u ms.\n", shader_count, time);
+    ok(!failures, "Failed to create %u shaders.\n", failures);
+
+    QueryPerformanceCounter(&start);
+    for (i = 0; i < ARRAY_SIZE(threads); ++i)
+    {
+        threads[i].device = device;
+        threads[i].count = shader_count / ARRAY_SIZE(threads);
+        threads[i].failures = 0;
+        handles[i] = CreateThread(NULL, 0, shader_creation_thread_proc, &threads[i], 0, NULL);
+    }
+    WaitForMultipleObjects(ARRAY_SIZE(handles), handles, TRUE, INFINITE);
+    QueryPerformanceCounter(&end);
+    time = (end.QuadPart - start.QuadPart) * 1000 / frequency.QuadPart;
+    trace("%u threads: %u shaders created in %u ms.\n", (unsigned int)ARRAY_SIZE(threads), shader_count, time);
+
+    for (i = 0; i < ARRAY_SIZE(threads); ++i)
+    {
+        ok(!threads[i].failures, "Thread %u failed to create %u shaders.\n", i, threads[i].failures);
+        CloseHandle(handles[i]);
+    }
+
+    refcount = ID3D11Device_Release(device);
+    ok(!refcount, "Device has %u references left.\n", refcount);
+}
+
 START_TEST(d3d11)
 {
     unsigned int argc, i;
@@ -30538,6 +31330,7 @@ START_TEST(d3d11)
     queue_test(test_copy_subresource_region_1d);
     queue_test(test_copy_subresource_region_3d);
     queue_test(test_resource_map);
+    queue_test(test_dynamic_buffer_map);
     queue_for_each_feature_level(test_resource_access);
     queue_test(test_check_multisample_quality_levels);
     queue_for_each_feature_level(test_swapchain_formats);
@@ -30631,6 +31424,17 @@ START_TEST(d3d11)
     queue_test(test_dual_source_blend);
     queue_test(test_deferred_context_state);
     queue_test(test_deferred_context_rendering);
+    queue_test(test_deferred_context_map);
 
     run_queued_tests();
+
+    /* Timing results are meaningless when other tests run concurrently. */
+    if (winetest_interactive)
+    {
+        test_shader_compile_frame_times();
+        test_multithreaded_draw_submission();
+        test_dynamic_buffer_update_times();
+        test_redundant_state_draw_times();
+        test_shader_creation_times();
+    }
 }
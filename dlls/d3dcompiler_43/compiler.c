@@ -53,6 +53,7 @@ struct loaded_include
 static struct loaded_include *includes;
 static int includes_capacity, includes_size;
 static const char *parent_include;
+static DWORD parent_include_idx;
 
 static char *wpp_output;
 static int wpp_output_capacity, wpp_output_size;
@@ -82,6 +83,485 @@ static CRITICAL_SECTION_DEBUG wpp_mutex_debug =
 };
 static CRITICAL_SECTION wpp_mutex = { &wpp_mutex_debug, -1, 0, 0, 0, 0 };
 
+/* Compilation cache.
+ *
+ * When the "CompilerCacheSize" setting is non-zero, preprocessed shaders are
+ * stored on disk, in the "CompilerCachePath" directory or in
+ * %LOCALAPPDATA%\wine\d3dcompiler_cache. Entries are keyed by the source,
+ * file name and macros, and record the name and contents of every include
+ * file opened while preprocessing, along with the preprocessor warnings. An
+ * entry is only used if the include handler still returns the same contents
+ * for all of them. Compiled shaders aren't cached, as the HLSL compiler
+ * doesn't generate code yet.
+ *
+ * Each entry stores its complete key, so hash collisions are detected. Keys
+ * and data are sequences of fields, each preceded by its DWORD size. The
+ * cache is only accessed with wpp_mutex held. */
+
+#define COMPILE_CACHE_MAGIC 0x32434344 /* "DCC2" */
+#define COMPILE_CACHE_MAX_ENTRY_SIZE (16 * 1024 * 1024)
+#define COMPILE_CACHE_HASH_INIT 0xcbf29ce484222325ull
+
+enum compile_cache_entry_type
+{
+    COMPILE_CACHE_PREPROCESS,
+};
+
+struct compile_cache_header
+{
+    DWORD magic;
+    DWORD key_size;
+    DWORD data_size;
+    DWORD padding;
+    UINT64 hash;
+    UINT64 checksum;
+};
+
+struct compile_cache_buffer
+{
+    BYTE *data;
+    SIZE_T size, capacity;
+};
+
+struct compile_cache_reader
+{
+    const BYTE *ptr, *end;
+};
+
+struct compile_cache_file
+{
+    char name[24];
+    FILETIME time;
+    UINT64 size;
+};
+
+static char compile_cache_dir[MAX_PATH];
+static UINT64 compile_cache_size, compile_cache_limit;
+static FILETIME compile_cache_module_time;
+
+/* The include files opened by the current preprocessing pass, or NULL if
+ * they're not recorded. */
+static struct compile_cache_buffer *include_deps;
+static unsigned int include_deps_count;
+
+/* 64-bit FNV-1a. */
+static UINT64 compile_cache_hash(UINT64 hash, const void *data, SIZE_T size)
+{
+    const BYTE *ptr = data;
+    SIZE_T i;
+
+    for (i = 0; i < size; ++i)
+    {
+        hash ^= ptr[i];
+        hash *= 0x100000001b3ull;
+    }
+
+    return hash;
+}
+
+static BOOL compile_cache_write(struct compile_cache_buffer *buffer, const void *data, SIZE_T size)
+{
+    SIZE_T new_capacity;
+    BYTE *new_data;
+
+    if (size > COMPILE_CACHE_MAX_ENTRY_SIZE - buffer->size)
+        return FALSE;
+
+    if (buffer->capacity - buffer->size < size)
+    {
+        new_capacity = max(max(buffer->capacity * 2, 256), buffer->size + size);
+        if (!(new_data = heap_realloc(buffer->data, new_capacity)))
+            return FALSE;
+        buffer->data = new_data;
+        buffer->capacity = new_capacity;
+    }
+
+    if (size)
+        memcpy(buffer->data + buffer->size, data, size);
+    buffer->size += size;
+    return TRUE;
+}
+
+static BOOL compile_cache_append(struct compile_cache_buffer *buffer, const void *data, SIZE_T size)
+{
+    DWORD field_size = size;
+
+    return size <= COMPILE_CACHE_MAX_ENTRY_SIZE && compile_cache_write(buffer, &field_size, sizeof(field_size))
+            && compile_cache_write(buffer, data, size);
+}
+
+static BOOL compile_cache_append_dword(struct compile_cache_buffer *buffer, DWORD value)
+{
+    return compile_cache_append(buffer, &value, sizeof(value));
+}
+
+static BOOL compile_cache_append_string(struct compile_cache_buffer *buffer, const char *str)
+{
+    return compile_cache_append(buffer, str, str ? strlen(str) + 1 : 0);
+}
+
+static BOOL compile_cache_read(struct compile_cache_reader *reader, const void **data, DWORD *size)
+{
+    DWORD field_size;
+
+    if (reader->end - reader->ptr < sizeof(field_size))
+        return FALSE;
+    memcpy(&field_size, reader->ptr, sizeof(field_size));
+    reader->ptr += sizeof(field_size);
+    if (reader->end - reader->ptr < field_size)
+        return FALSE;
+
+    *data = reader->ptr;
+    *size = field_size;
+    reader->ptr += field_size;
+    return TRUE;
+}
+
+static BOOL compile_cache_read_dword(struct compile_cache_reader *reader, DWORD *value)
+{
+    const void *data;
+    DWORD size;
+
+    if (!compile_cache_read(reader, &data, &size) || size != sizeof(*value))
+        return FALSE;
+    memcpy(value, data, sizeof(*value));
+    return TRUE;
+}
+
+static BOOL compile_cache_read_string(struct compile_cache_reader *reader, const char **str)
+{
+    const void *data;
+    DWORD size;
+
+    if (!compile_cache_read(reader, &data, &size) || !size || ((const char *)data)[size - 1])
+        return FALSE;
+    *str = data;
+    return TRUE;
+}
+
+static BOOL compile_cache_add_include(struct compile_cache_buffer *deps, D3D_INCLUDE_TYPE type,
+        DWORD parent_idx, const char *filename, const void *data, UINT size)
+{
+    ++include_deps_count;
+    return compile_cache_append_dword(deps, type) && compile_cache_append_dword(deps, parent_idx)
+            && compile_cache_append_string(deps, filename) && compile_cache_append(deps, data, size);
+}
+
+static BOOL compile_cache_get_path(char *path, SIZE_T size, const char *name)
+{
+    return snprintf(path, size, "%s\\%s", compile_cache_dir, name) < size;
+}
+
+static void compile_cache_get_name(char *name, SIZE_T size, UINT64 hash)
+{
+    snprintf(name, size, "%08x%08x.dcc", (unsigned int)(hash >> 32), (unsigned int)hash);
+}
+
+static BOOL compile_cache_create_dir(const char *path)
+{
+    return CreateDirectoryA(path, NULL) || GetLastError() == ERROR_ALREADY_EXISTS;
+}
+
+static struct compile_cache_file *compile_cache_list_files(SIZE_T *count, UINT64 *total_size)
+{
+    struct compile_cache_file *files = NULL, *new_files;
+    SIZE_T capacity = 0;
+    WIN32_FIND_DATAA data;
+    char path[MAX_PATH];
+    HANDLE handle;
+
+    *count = 0;
+    *total_size = 0;
+
+    if (!compile_cache_get_path(path, sizeof(path), "*.dcc"))
+        return NULL;
+    if ((handle = FindFirstFileA(path, &data)) == INVALID_HANDLE_VALUE)
+        return NULL;
+
+    do
+    {
+        struct compile_cache_file *file;
+
+        if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY || strlen(data.cFileName) >= sizeof(file->name))
+            continue;
+        if (*count == capacity)
+        {
+            capacity = max(capacity * 2, 64);
+            if (!(new_files = heap_realloc(files, capacity * sizeof(*files))))
+                break;
+            files = new_files;
+        }
+
+        file = &files[(*count)++];
+        strcpy(file->name, data.cFileName);
+        file->time = data.ftLastWriteTime;
+        file->size = ((UINT64)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+        *total_size += file->size;
+    } while (FindNextFileA(handle, &data));
+    FindClose(handle);
+
+    return files;
+}
+
+/* Temporary files are left behind if a process dies while storing an entry.
+ * Recent ones may still be written to by another process. */
+static void compile_cache_remove_temp_files(void)
+{
+    WIN32_FIND_DATAA data;
+    char path[MAX_PATH];
+    ULARGE_INTEGER now, time;
+    FILETIME ft;
+    HANDLE handle;
+
+    if (!compile_cache_get_path(path, sizeof(path), "dcc*.tmp"))
+        return;
+    if ((handle = FindFirstFileA(path, &data)) == INVALID_HANDLE_VALUE)
+        return;
+
+    GetSystemTimeAsFileTime(&ft);
+    now.u.LowPart = ft.dwLowDateTime;
+    now.u.HighPart = ft.dwHighDateTime;
+    do
+    {
+        time.u.LowPart = data.ftLastWriteTime.dwLowDateTime;
+        time.u.HighPart = data.ftLastWriteTime.dwHighDateTime;
+        if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY
+                || time.QuadPart + 60 * (ULONGLONG)10000000 > now.QuadPart)
+            continue;
+        if (compile_cache_get_path(path, sizeof(path), data.cFileName) && DeleteFileA(path))
+            TRACE("Removed stale temporary file %s.\n", debugstr_a(data.cFileName));
+    } while (FindNextFileA(handle, &data));
+    FindClose(handle);
+}
+
+static BOOL WINAPI compile_cache_init_once(INIT_ONCE *once, void *param, void **context)
+{
+    DWORD type, size, cache_size = 0;
+    WIN32_FILE_ATTRIBUTE_DATA attr;
+    struct compile_cache_file *files;
+    char path[MAX_PATH], module_path[MAX_PATH];
+    HMODULE module;
+    SIZE_T count;
+    HKEY key;
+
+    if (!RegOpenKeyA(HKEY_CURRENT_USER, "Software\\Wine\\Direct3D", &key))
+    {
+        size = sizeof(cache_size);
+        if (RegQueryValueExA(key, "CompilerCacheSize", NULL, &type, (BYTE *)&cache_size, &size)
+                || type != REG_DWORD)
+            cache_size = 0;
+        size = sizeof(path) - 1;
+        if (RegQueryValueExA(key, "CompilerCachePath", NULL, &type, (BYTE *)path, &size) || type != REG_SZ)
+            size = 0;
+        path[size] = 0;
+        RegCloseKey(key);
+    }
+
+    if (!cache_size)
+    {
+        TRACE("Compilation cache disabled.\n");
+        return TRUE;
+    }
+
+    if (!path[0])
+    {
+        size = GetEnvironmentVariableA("LOCALAPPDATA", path, sizeof(path));
+        if (!size || size + strlen("\\wine\\d3dcompiler_cache") >= sizeof(path))
+        {
+            WARN("Failed to get the local application data directory.\n");
+            return TRUE;
+        }
+        strcat(path, "\\wine");
+        compile_cache_create_dir(path);
+        strcat(path, "\\d3dcompiler_cache");
+    }
+
+    if (!compile_cache_create_dir(path))
+    {
+        WARN("Failed to create compilation cache directory %s, error %u.\n", debugstr_a(path), GetLastError());
+        return TRUE;
+    }
+
+    /* Entries produced by a different build of the compiler are never used. */
+    if (!GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+            (const char *)compile_cache_init_once, &module)
+            || !GetModuleFileNameA(module, module_path, sizeof(module_path))
+            || !GetFileAttributesExA(module_path, GetFileExInfoStandard, &attr))
+    {
+        WARN("Failed to get the module timestamp.\n");
+        return TRUE;
+    }
+    compile_cache_module_time = attr.ftLastWriteTime;
+
+    strcpy(compile_cache_dir, path);
+    compile_cache_limit = (UINT64)cache_size * 1024 * 1024;
+    compile_cache_remove_temp_files();
+    files = compile_cache_list_files(&count, &compile_cache_size);
+    heap_free(files);
+
+    TRACE("Using compilation cache %s, %lu entries, %s bytes.\n", debugstr_a(compile_cache_dir),
+            count, wine_dbgstr_longlong(compile_cache_size));
+
+    return TRUE;
+}
+
+static BOOL compile_cache_init(void)
+{
+    static INIT_ONCE init_once = INIT_ONCE_STATIC_INIT;
+
+    InitOnceExecuteOnce(&init_once, compile_cache_init_once, NULL, NULL);
+    return !!compile_cache_dir[0];
+}
+
+static int __cdecl compile_cache_file_compare(const void *a, const void *b)
+{
+    const struct compile_cache_file *f1 = a, *f2 = b;
+
+    return CompareFileTime(&f1->time, &f2->time);
+}
+
+/* Remove the least recently used entries until the cache uses at most 3/4 of
+ * its size limit. */
+static void compile_cache_evict(void)
+{
+    struct compile_cache_file *files;
+    char path[MAX_PATH];
+    SIZE_T count, i;
+
+    /* Other processes may have added or removed entries. */
+    files = compile_cache_list_files(&count, &compile_cache_size);
+    qsort(files, count, sizeof(*files), compile_cache_file_compare);
+
+    for (i = 0; i < count && compile_cache_size > compile_cache_limit / 4 * 3; ++i)
+    {
+        if (!compile_cache_get_path(path, sizeof(path), files[i].name) || !DeleteFileA(path))
+            continue;
+        TRACE("Evicted %s.\n", debugstr_a(files[i].name));
+        compile_cache_size -= files[i].size;
+    }
+
+    heap_free(files);
+}
+
+static BOOL compile_cache_init_key(struct compile_cache_buffer *key, enum compile_cache_entry_type type)
+{
+    memset(key, 0, sizeof(*key));
+    return compile_cache_append_dword(key, type) && compile_cache_append_dword(key, D3D_COMPILER_VERSION)
+            && compile_cache_append(key, &compile_cache_module_time, sizeof(compile_cache_module_time));
+}
+
+/* Returns the cache entry matching the key, and sets up the reader to read its
+ * data. The returned pointer must be freed with heap_free(). */
+static BYTE *compile_cache_load(const struct compile_cache_buffer *key, struct compile_cache_reader *reader)
+{
+    UINT64 hash = compile_cache_hash(COMPILE_CACHE_HASH_INIT, key->data, key->size);
+    struct compile_cache_header header;
+    char name[24], path[MAX_PATH];
+    BYTE *entry;
+    FILETIME now;
+    HANDLE file;
+    DWORD count;
+
+    compile_cache_get_name(name, sizeof(name), hash);
+    if (!compile_cache_get_path(path, sizeof(path), name))
+        return NULL;
+
+    if ((file = CreateFileA(path, GENERIC_READ | FILE_WRITE_ATTRIBUTES,
+            FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, 0, NULL))
+            == INVALID_HANDLE_VALUE)
+    {
+        TRACE("Cache miss for %s.\n", debugstr_a(name));
+        return NULL;
+    }
+
+    if (!ReadFile(file, &header, sizeof(header), &count, NULL) || count != sizeof(header)
+            || header.magic != COMPILE_CACHE_MAGIC || header.hash != hash || header.key_size != key->size
+            || header.data_size > COMPILE_CACHE_MAX_ENTRY_SIZE
+            || !(entry = heap_alloc(header.key_size + header.data_size)))
+    {
+        WARN("Invalid cache entry %s.\n", debugstr_a(name));
+        CloseHandle(file);
+        return NULL;
+    }
+
+    if (!ReadFile(file, entry, header.key_size + header.data_size, &count, NULL)
+            || count != header.key_size + header.data_size
+            || compile_cache_hash(COMPILE_CACHE_HASH_INIT, entry, count) != header.checksum)
+    {
+        WARN("Corrupted cache entry %s.\n", debugstr_a(name));
+        CloseHandle(file);
+        heap_free(entry);
+        return NULL;
+    }
+
+    if (memcmp(entry, key->data, key->size))
+    {
+        TRACE("Hash collision for %s.\n", debugstr_a(name));
+        CloseHandle(file);
+        heap_free(entry);
+        return NULL;
+    }
+
+    GetSystemTimeAsFileTime(&now);
+    SetFileTime(file, NULL, NULL, &now);
+    CloseHandle(file);
+
+    TRACE("Loaded %u bytes from %s.\n", header.data_size, debugstr_a(name));
+
+    reader->ptr = entry + header.key_size;
+    reader->end = reader->ptr + header.data_size;
+    return entry;
+}
+
+static void compile_cache_store(const struct compile_cache_buffer *key, const struct compile_cache_buffer *data)
+{
+    char name[24], path[MAX_PATH], tmp_path[MAX_PATH];
+    struct compile_cache_header header;
+    DWORD written;
+    HANDLE file;
+    BOOL ret;
+
+    if (key->size + data->size > COMPILE_CACHE_MAX_ENTRY_SIZE)
+        return;
+
+    header.magic = COMPILE_CACHE_MAGIC;
+    header.key_size = key->size;
+    header.data_size = data->size;
+    header.padding = 0;
+    header.hash = compile_cache_hash(COMPILE_CACHE_HASH_INIT, key->data, key->size);
+    header.checksum = compile_cache_hash(header.hash, data->data, data->size);
+
+    compile_cache_get_name(name, sizeof(name), header.hash);
+    if (!compile_cache_get_path(path, sizeof(path), name)
+            || !GetTempFileNameA(compile_cache_dir, "dcc", 0, tmp_path))
+        return;
+
+    if ((file = CreateFileA(tmp_path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, NULL)) == INVALID_HANDLE_VALUE)
+    {
+        WARN("Failed to create %s, error %u.\n", debugstr_a(tmp_path), GetLastError());
+        DeleteFileA(tmp_path);
+        return;
+    }
+
+    ret = WriteFile(file, &header, sizeof(header), &written, NULL) && written == sizeof(header)
+            && WriteFile(file, key->data, key->size, &written, NULL) && written == key->size
+            && WriteFile(file, data->data, data->size, &written, NULL) && written == data->size;
+    CloseHandle(file);
+
+    if (!ret || !MoveFileExA(tmp_path, path, MOVEFILE_REPLACE_EXISTING))
+    {
+        WARN("Failed to write cache entry %s, error %u.\n", debugstr_a(name), GetLastError());
+        DeleteFileA(tmp_path);
+        return;
+    }
+
+    TRACE("Stored %lu bytes in %s.\n", data->size, debugstr_a(name));
+
+    compile_cache_size += sizeof(header) + key->size + data->size;
+    if (compile_cache_size > compile_cache_limit)
+        compile_cache_evict();
+}
+
 /* Preprocessor error reporting functions */
 static void wpp_write_message(const char *fmt, __ms_va_list args)
 {
@@ -169,6 +649,7 @@ char *wpp_lookup(const char *filename, int type, const char *parent_name)
     TRACE("Looking for include %s, parent %s.\n", debugstr_a(filename), debugstr_a(parent_name));
 
     parent_include = NULL;
+    parent_include_idx = ~0u;
     if (strcmp(parent_name, initial_filename))
     {
         for(i = 0; i < includes_size; i++)
@@ -176,6 +657,7 @@ char *wpp_lookup(const char *filename, int type, const char *parent_name)
             if(!strcmp(parent_name, includes[i].name))
             {
                 parent_include = includes[i].data;
+                parent_include_idx = i;
                 break;
             }
         }
@@ -227,13 +709,13 @@ void *wpp_open(const char *filename, int type)
                 ERR("Error allocating memory for the loaded includes structure\n");
                 goto error;
             }
-            includes_capacity = INCLUDES_INITIAL_CAPACITY * sizeof(*includes);
+            includes_capacity = INCLUDES_INITIAL_CAPACITY;
         }
         else
         {
             int newcapacity = includes_capacity * 2;
             struct loaded_include *newincludes =
-                HeapReAlloc(GetProcessHeap(), 0, includes, newcapacity);
+                HeapReAlloc(GetProcessHeap(), 0, includes, newcapacity * sizeof(*includes));
             if(newincludes == NULL)
             {
                 ERR("Error reallocating memory for the loaded includes structure\n");
@@ -246,6 +728,10 @@ void *wpp_open(const char *filename, int type)
     includes[includes_size].name = filename;
     includes[includes_size++].data = desc->buffer;
 
+    if (include_deps && !compile_cache_add_include(include_deps, type ? D3D_INCLUDE_LOCAL : D3D_INCLUDE_SYSTEM,
+            parent_include_idx, filename, desc->buffer, desc->size))
+        include_deps = NULL;
+
     desc->pos = 0;
     return desc;
 
@@ -481,36 +967,175 @@ int wpp_parse( const char *input, FILE *output )
     return ret;
 }
 
-static HRESULT preprocess_shader(const void *data, SIZE_T data_size, const char *filename,
-        const D3D_SHADER_MACRO *defines, ID3DInclude *include, ID3DBlob **error_messages)
+static BOOL preprocess_cache_init_key(struct compile_cache_buffer *key, const void *data, SIZE_T data_size,
+        const char *filename, const D3D_SHADER_MACRO *defines)
 {
-    int ret;
-    HRESULT hr = S_OK;
-    const D3D_SHADER_MACRO *def = defines;
+    if (!compile_cache_init_key(key, COMPILE_CACHE_PREPROCESS)
+            || !compile_cache_append_string(key, filename)
+            || !compile_cache_append(key, data, data_size))
+        return FALSE;
 
-    if (def != NULL)
+    for (; defines && defines->Name; ++defines)
     {
-        while (def->Name != NULL)
+        if (!compile_cache_append_string(key, defines->Name)
+                || !compile_cache_append_string(key, defines->Definition))
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+/* Reopens all the include files recorded in the cache entry, and only returns
+ * the cached output if none of them changed. */
+static BOOL preprocess_cache_lookup(const struct compile_cache_buffer *key, ID3DInclude *include)
+{
+    struct
+    {
+        const void *data;
+        UINT size;
+    } *opened = NULL;
+    DWORD count, type, parent_idx, size, messages_size, i, opened_count = 0;
+    const void *expected, *messages, *output;
+    struct compile_cache_reader reader;
+    const char *name;
+    BOOL ret = FALSE;
+    BYTE *entry;
+
+    if (!(entry = compile_cache_load(key, &reader)))
+        return FALSE;
+
+    if (!compile_cache_read_dword(&reader, &count))
+        goto done;
+    if (count && (!include || !(opened = heap_calloc(count, sizeof(*opened)))))
+        goto done;
+
+    for (i = 0; i < count; ++i)
+    {
+        if (!compile_cache_read_dword(&reader, &type) || !compile_cache_read_dword(&reader, &parent_idx)
+                || !compile_cache_read_string(&reader, &name) || !compile_cache_read(&reader, &expected, &size)
+                || (parent_idx != ~0u && parent_idx >= i))
+            goto done;
+
+        if (FAILED(ID3DInclude_Open(include, type, name, parent_idx == ~0u ? NULL : opened[parent_idx].data,
+                &opened[i].data, &opened[i].size)))
+        {
+            TRACE("Failed to open include %s.\n", debugstr_a(name));
+            goto done;
+        }
+        ++opened_count;
+
+        if (opened[i].size != size || memcmp(opened[i].data, expected, size))
         {
-            wpp_add_define(def->Name, def->Definition);
-            def++;
+            TRACE("Include %s changed.\n", debugstr_a(name));
+            goto done;
         }
     }
-    current_include = include;
-    includes_size = 0;
+
+    if (!compile_cache_read(&reader, &messages, &messages_size)
+            || (messages_size && ((const char *)messages)[messages_size - 1])
+            || !compile_cache_read(&reader, &output, &size) || !size)
+        goto done;
+    if (!(wpp_output = HeapAlloc(GetProcessHeap(), 0, size)))
+        goto done;
+    if (messages_size && !(wpp_messages = HeapAlloc(GetProcessHeap(), 0, messages_size)))
+    {
+        HeapFree(GetProcessHeap(), 0, wpp_output);
+        wpp_output = NULL;
+        goto done;
+    }
+    memcpy(wpp_output, output, size);
+    wpp_output_size = wpp_output_capacity = size;
+    if (messages_size)
+    {
+        memcpy(wpp_messages, messages, messages_size);
+        wpp_messages_size = messages_size - 1;
+        wpp_messages_capacity = messages_size;
+    }
+    ret = TRUE;
+
+done:
+    while (opened_count)
+        ID3DInclude_Close(include, opened[--opened_count].data);
+    heap_free(opened);
+    heap_free(entry);
+    return ret;
+}
+
+static void preprocess_cache_store(const struct compile_cache_buffer *key, const struct compile_cache_buffer *deps)
+{
+    struct compile_cache_buffer data = {0};
+
+    if (compile_cache_append_dword(&data, include_deps_count)
+            && compile_cache_write(&data, deps->data, deps->size)
+            && compile_cache_append(&data, wpp_messages, wpp_messages ? wpp_messages_size + 1 : 0)
+            && compile_cache_append(&data, wpp_output, wpp_output_size))
+        compile_cache_store(key, &data);
+
+    heap_free(data.data);
+}
+
+static HRESULT preprocess_shader(const void *data, SIZE_T data_size, const char *filename,
+        const D3D_SHADER_MACRO *defines, ID3DInclude *include, ID3DBlob **error_messages)
+{
+    struct compile_cache_buffer key = {0}, deps = {0};
+    int ret;
+    HRESULT hr = S_OK;
+    const D3D_SHADER_MACRO *def = defines;
+    BOOL use_cache;
 
     wpp_output_size = wpp_output_capacity = 0;
     wpp_output = NULL;
-
     wpp_messages_size = wpp_messages_capacity = 0;
     wpp_messages = NULL;
-    current_shader.buffer = data;
-    current_shader.size = data_size;
     initial_filename = filename ? filename : "";
 
-    ret = wpp_parse(initial_filename, NULL);
-    if (!wpp_close_output())
-        ret = 1;
+    use_cache = compile_cache_init() && preprocess_cache_init_key(&key, data, data_size, filename, defines);
+    if (use_cache && preprocess_cache_lookup(&key, include))
+    {
+        TRACE("Using the cached preprocessed shader.\n");
+        ret = 0;
+    }
+    else
+    {
+        if (use_cache)
+        {
+            include_deps = &deps;
+            include_deps_count = 0;
+        }
+
+        if (def != NULL)
+        {
+            while (def->Name != NULL)
+            {
+                wpp_add_define(def->Name, def->Definition);
+                def++;
+            }
+        }
+        current_include = include;
+        includes_size = 0;
+
+        current_shader.buffer = data;
+        current_shader.size = data_size;
+
+        ret = wpp_parse(initial_filename, NULL);
+        if (!wpp_close_output())
+            ret = 1;
+        /* include_deps is reset if recording an include failed. */
+        if (use_cache && !ret && include_deps)
+            preprocess_cache_store(&key, &deps);
+        include_deps = NULL;
+
+        /* Remove the previously added defines */
+        if (defines != NULL)
+        {
+            while (defines->Name != NULL)
+            {
+                wpp_del_define(defines->Name);
+                defines++;
+            }
+        }
+    }
+
     if (ret)
     {
         TRACE("Error during shader preprocessing\n");
@@ -535,18 +1160,15 @@ static HRESULT preprocess_shader(const void *data, SIZE_T data_size, const char
             TRACE("Shader source:\n%s\n", debugstr_an(data, data_size));
         hr = E_FAIL;
     }
-
-cleanup:
-    /* Remove the previously added defines */
-    if (defines != NULL)
+    else if (wpp_messages)
     {
-        while (defines->Name != NULL)
-        {
-            wpp_del_define(defines->Name);
-            defines++;
-        }
+        TRACE("Preprocessor warnings:\n%s\n", debugstr_a(wpp_messages));
     }
+
+cleanup:
     HeapFree(GetProcessHeap(), 0, wpp_messages);
+    heap_free(deps.data);
+    heap_free(key.data);
     return hr;
 }
 
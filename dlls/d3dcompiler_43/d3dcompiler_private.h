@@ -960,10 +960,10 @@ enum parse_assign_op
     ASSIGN_OP_XOR,
 };
 
+struct hlsl_arena_chunk;
+
 struct hlsl_parse_ctx
 {
-    const char **source_files;
-    unsigned int source_files_count;
     const char *source_file;
     unsigned int line_no;
     unsigned int column;
@@ -980,10 +980,16 @@ struct hlsl_parse_ctx
 
     enum hlsl_matrix_majority matrix_majority;
 
+    /* All the memory used by the parser and its IR is allocated from this
+     * arena, and released at once at the end of the compilation. */
+    struct hlsl_arena_chunk *arena;
+    struct wine_rb_tree strings;
+
     struct
     {
         struct hlsl_type *scalar[HLSL_TYPE_LAST_SCALAR + 1];
         struct hlsl_type *vector[HLSL_TYPE_LAST_SCALAR + 1][4];
+        struct hlsl_type *matrix[HLSL_TYPE_LAST_SCALAR + 1][4][4];
         struct hlsl_type *sampler[HLSL_SAMPLER_DIM_MAX + 1];
         struct hlsl_type *Void;
     } builtin_types;
@@ -1094,9 +1100,15 @@ struct hlsl_ir_node *new_binary_expr(enum hlsl_ir_expr_op op, struct hlsl_ir_nod
 struct hlsl_ir_node *new_unary_expr(enum hlsl_ir_expr_op op, struct hlsl_ir_node *arg,
         struct source_location loc) DECLSPEC_HIDDEN;
 
+void init_hlsl_arena(void) DECLSPEC_HIDDEN;
+void free_hlsl_arena(void) DECLSPEC_HIDDEN;
+void *hlsl_alloc(SIZE_T size) DECLSPEC_HIDDEN;
+void *hlsl_realloc(void *ptr, SIZE_T size) DECLSPEC_HIDDEN;
+char *hlsl_strdup(const char *string) DECLSPEC_HIDDEN;
+char *hlsl_intern(const char *string) DECLSPEC_HIDDEN;
+
 BOOL add_declaration(struct hlsl_scope *scope, struct hlsl_ir_var *decl, BOOL local_var) DECLSPEC_HIDDEN;
 struct hlsl_ir_var *get_variable(struct hlsl_scope *scope, const char *name) DECLSPEC_HIDDEN;
-void free_declaration(struct hlsl_ir_var *decl) DECLSPEC_HIDDEN;
 struct hlsl_type *new_hlsl_type(const char *name, enum hlsl_type_class type_class,
         enum hlsl_base_type base_type, unsigned dimx, unsigned dimy) DECLSPEC_HIDDEN;
 struct hlsl_type *new_array_type(struct hlsl_type *basic_type, unsigned int array_size) DECLSPEC_HIDDEN;
@@ -1121,10 +1133,8 @@ const char *debug_modifiers(DWORD modifiers) DECLSPEC_HIDDEN;
 const char *debug_node_type(enum hlsl_ir_node_type type) DECLSPEC_HIDDEN;
 void debug_dump_ir_function_decl(const struct hlsl_ir_function_decl *func) DECLSPEC_HIDDEN;
 
-void free_hlsl_type(struct hlsl_type *type) DECLSPEC_HIDDEN;
 void free_instr(struct hlsl_ir_node *node) DECLSPEC_HIDDEN;
 void free_instr_list(struct list *list) DECLSPEC_HIDDEN;
-void free_function_rb(struct wine_rb_entry *entry, void *context) DECLSPEC_HIDDEN;
 
 #define MAKE_TAG(ch0, ch1, ch2, ch3) \
     ((DWORD)(ch0) | ((DWORD)(ch1) << 8) | \
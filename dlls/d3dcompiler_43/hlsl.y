@@ -229,20 +229,21 @@ static void declare_predefined_types(struct hlsl_scope *scope)
             for (x = 1; x <= 4; ++x)
             {
                 sprintf(name, "%s%ux%u", names[bt], y, x);
-                type = new_hlsl_type(d3dcompiler_strdup(name), HLSL_CLASS_MATRIX, bt, x, y);
+                type = new_hlsl_type(hlsl_intern(name), HLSL_CLASS_MATRIX, bt, x, y);
                 add_type_to_scope(scope, type);
+                hlsl_ctx.builtin_types.matrix[bt][x - 1][y - 1] = type;
 
                 if (y == 1)
                 {
                     sprintf(name, "%s%u", names[bt], x);
-                    type = new_hlsl_type(d3dcompiler_strdup(name), HLSL_CLASS_VECTOR, bt, x, y);
+                    type = new_hlsl_type(hlsl_intern(name), HLSL_CLASS_VECTOR, bt, x, y);
                     add_type_to_scope(scope, type);
                     hlsl_ctx.builtin_types.vector[bt][x - 1] = type;
 
                     if (x == 1)
                     {
                         sprintf(name, "%s", names[bt]);
-                        type = new_hlsl_type(d3dcompiler_strdup(name), HLSL_CLASS_SCALAR, bt, x, y);
+                        type = new_hlsl_type(hlsl_intern(name), HLSL_CLASS_SCALAR, bt, x, y);
                         add_type_to_scope(scope, type);
                         hlsl_ctx.builtin_types.scalar[bt] = type;
                     }
@@ -253,29 +254,29 @@ static void declare_predefined_types(struct hlsl_scope *scope)
 
     for (bt = 0; bt <= HLSL_SAMPLER_DIM_MAX; ++bt)
     {
-        type = new_hlsl_type(d3dcompiler_strdup(sampler_names[bt]), HLSL_CLASS_OBJECT, HLSL_TYPE_SAMPLER, 1, 1);
+        type = new_hlsl_type(hlsl_intern(sampler_names[bt]), HLSL_CLASS_OBJECT, HLSL_TYPE_SAMPLER, 1, 1);
         type->sampler_dim = bt;
         hlsl_ctx.builtin_types.sampler[bt] = type;
     }
 
-    hlsl_ctx.builtin_types.Void = new_hlsl_type(d3dcompiler_strdup("void"), HLSL_CLASS_OBJECT, HLSL_TYPE_VOID, 1, 1);
+    hlsl_ctx.builtin_types.Void = new_hlsl_type(hlsl_intern("void"), HLSL_CLASS_OBJECT, HLSL_TYPE_VOID, 1, 1);
 
     /* DX8 effects predefined types */
-    type = new_hlsl_type(d3dcompiler_strdup("DWORD"), HLSL_CLASS_SCALAR, HLSL_TYPE_INT, 1, 1);
+    type = new_hlsl_type(hlsl_intern("DWORD"), HLSL_CLASS_SCALAR, HLSL_TYPE_INT, 1, 1);
     add_type_to_scope(scope, type);
-    type = new_hlsl_type(d3dcompiler_strdup("FLOAT"), HLSL_CLASS_SCALAR, HLSL_TYPE_FLOAT, 1, 1);
+    type = new_hlsl_type(hlsl_intern("FLOAT"), HLSL_CLASS_SCALAR, HLSL_TYPE_FLOAT, 1, 1);
     add_type_to_scope(scope, type);
-    type = new_hlsl_type(d3dcompiler_strdup("VECTOR"), HLSL_CLASS_VECTOR, HLSL_TYPE_FLOAT, 4, 1);
+    type = new_hlsl_type(hlsl_intern("VECTOR"), HLSL_CLASS_VECTOR, HLSL_TYPE_FLOAT, 4, 1);
     add_type_to_scope(scope, type);
-    type = new_hlsl_type(d3dcompiler_strdup("MATRIX"), HLSL_CLASS_MATRIX, HLSL_TYPE_FLOAT, 4, 4);
+    type = new_hlsl_type(hlsl_intern("MATRIX"), HLSL_CLASS_MATRIX, HLSL_TYPE_FLOAT, 4, 4);
     add_type_to_scope(scope, type);
-    type = new_hlsl_type(d3dcompiler_strdup("STRING"), HLSL_CLASS_OBJECT, HLSL_TYPE_STRING, 1, 1);
+    type = new_hlsl_type(hlsl_intern("STRING"), HLSL_CLASS_OBJECT, HLSL_TYPE_STRING, 1, 1);
     add_type_to_scope(scope, type);
-    type = new_hlsl_type(d3dcompiler_strdup("TEXTURE"), HLSL_CLASS_OBJECT, HLSL_TYPE_TEXTURE, 1, 1);
+    type = new_hlsl_type(hlsl_intern("TEXTURE"), HLSL_CLASS_OBJECT, HLSL_TYPE_TEXTURE, 1, 1);
     add_type_to_scope(scope, type);
-    type = new_hlsl_type(d3dcompiler_strdup("PIXELSHADER"), HLSL_CLASS_OBJECT, HLSL_TYPE_PIXELSHADER, 1, 1);
+    type = new_hlsl_type(hlsl_intern("PIXELSHADER"), HLSL_CLASS_OBJECT, HLSL_TYPE_PIXELSHADER, 1, 1);
     add_type_to_scope(scope, type);
-    type = new_hlsl_type(d3dcompiler_strdup("VERTEXSHADER"), HLSL_CLASS_OBJECT, HLSL_TYPE_VERTEXSHADER, 1, 1);
+    type = new_hlsl_type(hlsl_intern("VERTEXSHADER"), HLSL_CLASS_OBJECT, HLSL_TYPE_VERTEXSHADER, 1, 1);
     add_type_to_scope(scope, type);
 }
 
@@ -288,7 +289,7 @@ static struct hlsl_ir_if *new_if(struct hlsl_ir_node *condition, struct source_l
 {
     struct hlsl_ir_if *iff;
 
-    if (!(iff = d3dcompiler_alloc(sizeof(*iff))))
+    if (!(iff = hlsl_alloc(sizeof(*iff))))
         return NULL;
     init_node(&iff->node, HLSL_IR_IF, NULL, loc);
     hlsl_src_from_node(&iff->condition, condition);
@@ -322,7 +323,7 @@ static BOOL append_conditional_break(struct list *cond_list)
     }
     list_add_tail(cond_list, &iff->node.entry);
 
-    if (!(jump = d3dcompiler_alloc(sizeof(*jump))))
+    if (!(jump = hlsl_alloc(sizeof(*jump))))
     {
         ERR("Out of memory.\n");
         return FALSE;
@@ -343,28 +344,24 @@ enum loop_type
 static struct list *create_loop(enum loop_type type, struct list *init, struct list *cond,
         struct list *iter, struct list *body, struct source_location loc)
 {
-    struct list *list = NULL;
-    struct hlsl_ir_loop *loop = NULL;
-    struct hlsl_ir_if *cond_jump = NULL;
+    struct hlsl_ir_loop *loop;
+    struct list *list;
 
-    list = d3dcompiler_alloc(sizeof(*list));
-    if (!list)
-        goto oom;
+    if (!(list = hlsl_alloc(sizeof(*list))) || !(loop = hlsl_alloc(sizeof(*loop)))
+            || !append_conditional_break(cond))
+    {
+        ERR("Out of memory.\n");
+        return NULL;
+    }
     list_init(list);
 
     if (init)
         list_move_head(list, init);
 
-    loop = d3dcompiler_alloc(sizeof(*loop));
-    if (!loop)
-        goto oom;
     init_node(&loop->node, HLSL_IR_LOOP, NULL, loc);
     list_add_tail(list, &loop->node.entry);
     list_init(&loop->body);
 
-    if (!append_conditional_break(cond))
-        goto oom;
-
     if (type != LOOP_DO_WHILE)
         list_move_tail(&loop->body, cond);
 
@@ -376,21 +373,7 @@ static struct list *create_loop(enum loop_type type, struct list *init, struct l
     if (type == LOOP_DO_WHILE)
         list_move_tail(&loop->body, cond);
 
-    d3dcompiler_free(init);
-    d3dcompiler_free(cond);
-    d3dcompiler_free(body);
     return list;
-
-oom:
-    ERR("Out of memory.\n");
-    d3dcompiler_free(loop);
-    d3dcompiler_free(cond_jump);
-    d3dcompiler_free(list);
-    free_instr_list(init);
-    free_instr_list(cond);
-    free_instr_list(iter);
-    free_instr_list(body);
-    return NULL;
 }
 
 static unsigned int initializer_size(const struct parse_initializer *initializer)
@@ -408,18 +391,17 @@ static unsigned int initializer_size(const struct parse_initializer *initializer
 static void free_parse_initializer(struct parse_initializer *initializer)
 {
     free_instr_list(initializer->instrs);
-    d3dcompiler_free(initializer->args);
 }
 
 static struct hlsl_ir_swizzle *new_swizzle(DWORD s, unsigned int components,
         struct hlsl_ir_node *val, struct source_location *loc)
 {
-    struct hlsl_ir_swizzle *swizzle = d3dcompiler_alloc(sizeof(*swizzle));
+    struct hlsl_ir_swizzle *swizzle = hlsl_alloc(sizeof(*swizzle));
 
     if (!swizzle)
         return NULL;
     init_node(&swizzle->node, HLSL_IR_SWIZZLE,
-            new_hlsl_type(NULL, HLSL_CLASS_VECTOR, val->data_type->base_type, components, 1), *loc);
+            hlsl_ctx.builtin_types.vector[val->data_type->base_type][components - 1], *loc);
     hlsl_src_from_node(&swizzle->val, val);
     swizzle->swizzle = s;
     return swizzle;
@@ -512,7 +494,7 @@ static struct hlsl_ir_var *new_var(const char *name, struct hlsl_type *type, con
 {
     struct hlsl_ir_var *var;
 
-    if (!(var = d3dcompiler_alloc(sizeof(*var))))
+    if (!(var = hlsl_alloc(sizeof(*var))))
     {
         hlsl_ctx.status = PARSE_ERR;
         return NULL;
@@ -545,7 +527,7 @@ static struct hlsl_ir_assignment *new_assignment(struct hlsl_ir_var *var, struct
     if (!writemask && type_is_single_reg(rhs->data_type))
         writemask = (1 << rhs->data_type->dimx) - 1;
 
-    if (!(assign = d3dcompiler_alloc(sizeof(*assign))))
+    if (!(assign = hlsl_alloc(sizeof(*assign))))
         return NULL;
 
     init_node(&assign->node, HLSL_IR_ASSIGNMENT, NULL, loc);
@@ -584,7 +566,7 @@ static struct hlsl_ir_jump *add_return(struct list *instrs,
         return NULL;
     }
 
-    if (!(jump = d3dcompiler_alloc(sizeof(*jump))))
+    if (!(jump = hlsl_alloc(sizeof(*jump))))
     {
         ERR("Out of memory\n");
         return NULL;
@@ -600,7 +582,7 @@ static struct hlsl_ir_constant *new_uint_constant(unsigned int n, const struct s
 {
     struct hlsl_ir_constant *c;
 
-    if (!(c = d3dcompiler_alloc(sizeof(*c))))
+    if (!(c = hlsl_alloc(sizeof(*c))))
         return NULL;
     init_node(&c->node, HLSL_IR_CONSTANT, hlsl_ctx.builtin_types.scalar[HLSL_TYPE_UINT], loc);
     c->value.u[0] = n;
@@ -611,7 +593,7 @@ struct hlsl_ir_node *new_unary_expr(enum hlsl_ir_expr_op op, struct hlsl_ir_node
 {
     struct hlsl_ir_expr *expr;
 
-    if (!(expr = d3dcompiler_alloc(sizeof(*expr))))
+    if (!(expr = hlsl_alloc(sizeof(*expr))))
         return NULL;
     init_node(&expr->node, HLSL_IR_EXPR, arg->data_type, loc);
     expr->op = op;
@@ -626,7 +608,7 @@ struct hlsl_ir_node *new_binary_expr(enum hlsl_ir_expr_op op,
 
     assert(compare_hlsl_types(arg1->data_type, arg2->data_type));
 
-    if (!(expr = d3dcompiler_alloc(sizeof(*expr))))
+    if (!(expr = hlsl_alloc(sizeof(*expr))))
         return NULL;
     init_node(&expr->node, HLSL_IR_EXPR, arg1->data_type, arg1->loc);
     expr->op = op;
@@ -637,7 +619,7 @@ struct hlsl_ir_node *new_binary_expr(enum hlsl_ir_expr_op op,
 
 static struct hlsl_ir_load *new_var_load(struct hlsl_ir_var *var, const struct source_location loc)
 {
-    struct hlsl_ir_load *load = d3dcompiler_alloc(sizeof(*load));
+    struct hlsl_ir_load *load = hlsl_alloc(sizeof(*load));
 
     if (!load)
     {
@@ -686,7 +668,7 @@ static struct hlsl_ir_load *add_load(struct list *instrs, struct hlsl_ir_node *v
         list_add_tail(instrs, &assign->node.entry);
     }
 
-    if (!(load = d3dcompiler_alloc(sizeof(*load))))
+    if (!(load = hlsl_alloc(sizeof(*load))))
         return NULL;
     init_node(&load->node, HLSL_IR_LOAD, data_type, loc);
     load->src.var = var;
@@ -762,7 +744,6 @@ static void struct_var_initializer(struct list *list, struct hlsl_ir_var *var,
     }
 
     list_move_tail(list, initializer->instrs);
-    d3dcompiler_free(initializer->instrs);
 
     LIST_FOR_EACH_ENTRY(field, type->e.elements, struct hlsl_struct_field, entry)
     {
@@ -786,17 +767,6 @@ static void struct_var_initializer(struct list *list, struct hlsl_ir_var *var,
         else
             FIXME("Initializing with \"mismatched\" fields is not supported yet.\n");
     }
-
-    d3dcompiler_free(initializer->args);
-}
-
-static void free_parse_variable_def(struct parse_variable_def *v)
-{
-    free_parse_initializer(&v->initializer);
-    d3dcompiler_free(v->name);
-    d3dcompiler_free((void *)v->semantic);
-    d3dcompiler_free(v->reg_reservation);
-    d3dcompiler_free(v);
 }
 
 static struct list *declare_vars(struct hlsl_type *basic_type, DWORD modifiers, struct list *var_list)
@@ -805,7 +775,7 @@ static struct list *declare_vars(struct hlsl_type *basic_type, DWORD modifiers,
     struct parse_variable_def *v, *v_next;
     struct hlsl_ir_var *var;
     BOOL ret, local = TRUE;
-    struct list *statements_list = d3dcompiler_alloc(sizeof(*statements_list));
+    struct list *statements_list = hlsl_alloc(sizeof(*statements_list));
 
     if (basic_type->type == HLSL_CLASS_MATRIX)
         assert(basic_type->modifiers & HLSL_MODIFIERS_MAJORITY_MASK);
@@ -813,9 +783,6 @@ static struct list *declare_vars(struct hlsl_type *basic_type, DWORD modifiers,
     if (!statements_list)
     {
         ERR("Out of memory.\n");
-        LIST_FOR_EACH_ENTRY_SAFE(v, v_next, var_list, struct parse_variable_def, entry)
-            free_parse_variable_def(v);
-        d3dcompiler_free(var_list);
         return NULL;
     }
     list_init(statements_list);
@@ -832,7 +799,7 @@ static struct list *declare_vars(struct hlsl_type *basic_type, DWORD modifiers,
 
         if (!(var = new_var(v->name, type, v->loc, v->semantic, modifiers, v->reg_reservation)))
         {
-            free_parse_variable_def(v);
+            free_parse_initializer(&v->initializer);
             continue;
         }
         debug_dump_decl(type, modifiers, v->name, v->loc.line);
@@ -846,18 +813,12 @@ static struct list *declare_vars(struct hlsl_type *basic_type, DWORD modifiers,
         if (type->modifiers & HLSL_MODIFIER_CONST && !(var->modifiers & HLSL_STORAGE_UNIFORM) && !v->initializer.args_count)
         {
             hlsl_report_message(v->loc, HLSL_LEVEL_ERROR, "const variable without initializer");
-            free_declaration(var);
-            d3dcompiler_free(v);
             continue;
         }
 
         ret = declare_variable(var, local);
         if (!ret)
-        {
-            free_declaration(var);
-            d3dcompiler_free(v);
             continue;
-        }
         TRACE("Declared variable %s.\n", var->name);
 
         if (v->initializer.args_count)
@@ -874,7 +835,6 @@ static struct list *declare_vars(struct hlsl_type *basic_type, DWORD modifiers,
                     hlsl_report_message(v->loc, HLSL_LEVEL_ERROR,
                             "'%s' initializer does not match", v->name);
                     free_parse_initializer(&v->initializer);
-                    d3dcompiler_free(v);
                     continue;
                 }
             }
@@ -884,52 +844,43 @@ static struct list *declare_vars(struct hlsl_type *basic_type, DWORD modifiers,
                 hlsl_report_message(v->loc, HLSL_LEVEL_ERROR,
                         "'%s' initializer does not match", v->name);
                 free_parse_initializer(&v->initializer);
-                d3dcompiler_free(v);
                 continue;
             }
 
             if (type->type == HLSL_CLASS_STRUCT)
             {
                 struct_var_initializer(statements_list, var, &v->initializer);
-                d3dcompiler_free(v);
                 continue;
             }
             if (type->type > HLSL_CLASS_LAST_NUMERIC)
             {
                 FIXME("Initializers for non scalar/struct variables not supported yet.\n");
                 free_parse_initializer(&v->initializer);
-                d3dcompiler_free(v);
                 continue;
             }
             if (v->array_size > 0)
             {
                 FIXME("Initializing arrays is not supported yet.\n");
                 free_parse_initializer(&v->initializer);
-                d3dcompiler_free(v);
                 continue;
             }
             if (v->initializer.args_count > 1)
             {
                 FIXME("Complex initializers are not supported yet.\n");
                 free_parse_initializer(&v->initializer);
-                d3dcompiler_free(v);
                 continue;
             }
 
             load = new_var_load(var, var->loc);
             list_add_tail(v->initializer.instrs, &load->node.entry);
             add_assignment(v->initializer.instrs, &load->node, ASSIGN_OP_ASSIGN, v->initializer.args[0]);
-            d3dcompiler_free(v->initializer.args);
 
             if (modifiers & HLSL_STORAGE_STATIC)
                 list_move_tail(&hlsl_ctx.static_initializers, v->initializer.instrs);
             else
                 list_move_tail(statements_list, v->initializer.instrs);
-            d3dcompiler_free(v->initializer.instrs);
         }
-        d3dcompiler_free(v);
     }
-    d3dcompiler_free(var_list);
     return statements_list;
 }
 
@@ -998,7 +949,7 @@ static struct list *gen_struct_fields(struct hlsl_type *type, DWORD modifiers, s
     if (type->type == HLSL_CLASS_MATRIX)
         assert(type->modifiers & HLSL_MODIFIERS_MAJORITY_MASK);
 
-    list = d3dcompiler_alloc(sizeof(*list));
+    list = hlsl_alloc(sizeof(*list));
     if (!list)
     {
         ERR("Out of memory.\n");
@@ -1008,11 +959,10 @@ static struct list *gen_struct_fields(struct hlsl_type *type, DWORD modifiers, s
     LIST_FOR_EACH_ENTRY_SAFE(v, v_next, fields, struct parse_variable_def, entry)
     {
         debug_dump_decl(type, 0, v->name, v->loc.line);
-        field = d3dcompiler_alloc(sizeof(*field));
+        field = hlsl_alloc(sizeof(*field));
         if (!field)
         {
             ERR("Out of memory.\n");
-            d3dcompiler_free(v);
             return list;
         }
         if (v->array_size)
@@ -1028,9 +978,7 @@ static struct list *gen_struct_fields(struct hlsl_type *type, DWORD modifiers, s
             free_parse_initializer(&v->initializer);
         }
         list_add_tail(list, &field->entry);
-        d3dcompiler_free(v);
     }
-    d3dcompiler_free(fields);
     return list;
 }
 
@@ -1043,7 +991,7 @@ static DWORD get_array_size(const struct hlsl_type *type)
 
 static struct hlsl_type *new_struct_type(const char *name, struct list *fields)
 {
-    struct hlsl_type *type = d3dcompiler_alloc(sizeof(*type));
+    struct hlsl_type *type = hlsl_alloc(sizeof(*type));
     struct hlsl_struct_field *field;
     unsigned int reg_size = 0;
 
@@ -1089,7 +1037,6 @@ static BOOL add_typedef(DWORD modifiers, struct hlsl_type *orig_type, struct lis
             ERR("Out of memory\n");
             return FALSE;
         }
-        d3dcompiler_free((void *)type->name);
         type->name = v->name;
         type->modifiers |= modifiers;
 
@@ -1108,9 +1055,7 @@ static BOOL add_typedef(DWORD modifiers, struct hlsl_type *orig_type, struct lis
             hlsl_report_message(v->loc, HLSL_LEVEL_ERROR,
                     "redefinition of custom type '%s'", v->name);
         }
-        d3dcompiler_free(v);
     }
-    d3dcompiler_free(list);
     return TRUE;
 }
 
@@ -1125,10 +1070,7 @@ static BOOL add_func_parameter(struct list *list, struct parse_parameter *param,
         return FALSE;
 
     if (!add_declaration(hlsl_ctx.cur_scope, var, FALSE))
-    {
-        free_declaration(var);
         return FALSE;
-    }
     list_add_tail(list, &var->param_entry);
     return TRUE;
 }
@@ -1164,7 +1106,7 @@ static struct reg_reservation *parse_reg_reservation(const char *reg_string)
         return NULL;
     }
 
-    reg_res = d3dcompiler_alloc(sizeof(*reg_res));
+    reg_res = hlsl_alloc(sizeof(*reg_res));
     if (!reg_res)
     {
         ERR("Out of memory.\n");
@@ -1225,7 +1167,6 @@ static struct list *add_binary_expr(struct list *list1, struct list *list2,
 {
     struct hlsl_ir_node *args[3] = {node_from_list(list1), node_from_list(list2)};
     list_move_tail(list1, list2);
-    d3dcompiler_free(list2);
     add_expr(list1, op, args, &loc);
     return list1;
 }
@@ -1234,7 +1175,7 @@ static struct list *make_list(struct hlsl_ir_node *node)
 {
     struct list *list;
 
-    if (!(list = d3dcompiler_alloc(sizeof(*list))))
+    if (!(list = hlsl_alloc(sizeof(*list))))
     {
         ERR("Out of memory.\n");
         free_instr(node);
@@ -1290,7 +1231,7 @@ static struct hlsl_ir_function_decl *new_func_decl(struct hlsl_type *return_type
 {
     struct hlsl_ir_function_decl *decl;
 
-    if (!(decl = d3dcompiler_alloc(sizeof(*decl))))
+    if (!(decl = hlsl_alloc(sizeof(*decl))))
         return NULL;
     decl->return_type = return_type;
     decl->parameters = parameters;
@@ -1304,10 +1245,7 @@ static struct hlsl_ir_function_decl *new_func_decl(struct hlsl_type *return_type
 
         sprintf(name, "<retval-%p>", decl);
         if (!(return_var = new_synthetic_var(name, return_type, loc)))
-        {
-            d3dcompiler_free(decl);
             return NULL;
-        }
         decl->return_var = return_var;
     }
 
@@ -1561,24 +1499,9 @@ hlsl_prog:                /* empty */
 
 preproc_directive:        PRE_LINE STRING
                             {
-                                const char **new_array = NULL;
-
                                 TRACE("Updating line information to file %s, line %u\n", debugstr_a($2), $1);
                                 hlsl_ctx.line_no = $1;
-                                if (strcmp($2, hlsl_ctx.source_file))
-                                    new_array = d3dcompiler_realloc(hlsl_ctx.source_files,
-                                            sizeof(*hlsl_ctx.source_files) * (hlsl_ctx.source_files_count + 1));
-
-                                if (new_array)
-                                {
-                                    hlsl_ctx.source_files = new_array;
-                                    hlsl_ctx.source_files[hlsl_ctx.source_files_count++] = $2;
-                                    hlsl_ctx.source_file = $2;
-                                }
-                                else
-                                {
-                                    d3dcompiler_free($2);
-                                }
+                                hlsl_ctx.source_file = $2;
                             }
 
 struct_declaration:       var_modifiers struct_spec variables_def_optional ';'
@@ -1643,7 +1566,7 @@ any_identifier:           VAR_IDENTIFIER
 
 fields_list:              /* Empty */
                             {
-                                $$ = d3dcompiler_alloc(sizeof(*$$));
+                                $$ = hlsl_alloc(sizeof(*$$));
                                 list_init($$);
                             }
                         | fields_list field
@@ -1659,10 +1582,8 @@ fields_list:              /* Empty */
                                     {
                                         hlsl_report_message(get_location(&@2),
                                                 HLSL_LEVEL_ERROR, "redefinition of '%s'", field->name);
-                                        d3dcompiler_free(field);
                                     }
                                 }
-                                d3dcompiler_free($2);
                             }
 
 field_type:               type
@@ -1714,10 +1635,7 @@ func_prototype:           var_modifiers type var_identifier '(' parameters ')' c
                                 }
 
                                 if ($7.reg_reservation)
-                                {
                                     FIXME("Unexpected register reservation for a function.\n");
-                                    d3dcompiler_free($7.reg_reservation);
-                                }
                                 if (!($$.decl = new_func_decl($2, $5, $7.semantic, get_location(&@3))))
                                 {
                                     ERR("Out of memory.\n");
@@ -1729,7 +1647,7 @@ func_prototype:           var_modifiers type var_identifier '(' parameters ')' c
 
 compound_statement:       '{' '}'
                             {
-                                $$ = d3dcompiler_alloc(sizeof(*$$));
+                                $$ = hlsl_alloc(sizeof(*$$));
                                 list_init($$);
                             }
                         | '{' scope_start statement_list '}'
@@ -1771,20 +1689,16 @@ semantic:                 ':' any_identifier
 register_opt:             ':' KW_REGISTER '(' any_identifier ')'
                             {
                                 $$ = parse_reg_reservation($4);
-                                d3dcompiler_free($4);
                             }
                         | ':' KW_REGISTER '(' any_identifier ',' any_identifier ')'
                             {
                                 FIXME("Ignoring shader target %s in a register reservation.\n", debugstr_a($4));
-                                d3dcompiler_free($4);
-
                                 $$ = parse_reg_reservation($6);
-                                d3dcompiler_free($6);
                             }
 
 parameters:               scope_start
                             {
-                                $$ = d3dcompiler_alloc(sizeof(*$$));
+                                $$ = hlsl_alloc(sizeof(*$$));
                                 list_init($$);
                             }
                         | scope_start param_list
@@ -1794,7 +1708,7 @@ parameters:               scope_start
 
 param_list:               parameter
                             {
-                                $$ = d3dcompiler_alloc(sizeof(*$$));
+                                $$ = hlsl_alloc(sizeof(*$$));
                                 list_init($$);
                                 if (!add_func_parameter($$, &$1, get_location(&@1)))
                                 {
@@ -1879,7 +1793,7 @@ type:
                 YYABORT;
             }
 
-            $$ = new_hlsl_type(NULL, HLSL_CLASS_VECTOR, $3->base_type, $5, 1);
+            $$ = hlsl_ctx.builtin_types.vector[$3->base_type][$5 - 1];
         }
     | KW_MATRIX '<' base_type ',' C_INTEGER ',' C_INTEGER '>'
         {
@@ -1902,7 +1816,7 @@ type:
                 YYABORT;
             }
 
-            $$ = new_hlsl_type(NULL, HLSL_CLASS_MATRIX, $3->base_type, $7, $5);
+            $$ = hlsl_ctx.builtin_types.matrix[$3->base_type][$7 - 1][$5 - 1];
         }
 
 base_type:
@@ -1934,21 +1848,19 @@ base_type:
     | TYPE_IDENTIFIER
         {
             $$ = get_type(hlsl_ctx.cur_scope, $1, TRUE);
-            d3dcompiler_free($1);
         }
     | KW_STRUCT TYPE_IDENTIFIER
         {
             $$ = get_type(hlsl_ctx.cur_scope, $2, TRUE);
             if ($$->type != HLSL_CLASS_STRUCT)
                 hlsl_report_message(get_location(&@1), HLSL_LEVEL_ERROR, "'%s' redefined as a structure\n", $2);
-            d3dcompiler_free($2);
         }
 
 declaration_statement:    declaration
                         | struct_declaration
                         | typedef
                             {
-                                $$ = d3dcompiler_alloc(sizeof(*$$));
+                                $$ = hlsl_alloc(sizeof(*$$));
                                 if (!$$)
                                 {
                                     ERR("Out of memory\n");
@@ -1964,12 +1876,8 @@ typedef:                  KW_TYPEDEF var_modifiers typedef_type type_specs ';'
                             {
                                 if ($2 & ~HLSL_TYPE_MODIFIERS_MASK)
                                 {
-                                    struct parse_variable_def *v, *v_next;
                                     hlsl_report_message(get_location(&@1),
                                             HLSL_LEVEL_ERROR, "modifier not allowed on typedefs");
-                                    LIST_FOR_EACH_ENTRY_SAFE(v, v_next, $4, struct parse_variable_def, entry)
-                                        d3dcompiler_free(v);
-                                    d3dcompiler_free($4);
                                     YYABORT;
                                 }
                                 if (!add_typedef($2, $3, $4))
@@ -1978,7 +1886,7 @@ typedef:                  KW_TYPEDEF var_modifiers typedef_type type_specs ';'
 
 type_specs:               type_spec
                             {
-                                $$ = d3dcompiler_alloc(sizeof(*$$));
+                                $$ = hlsl_alloc(sizeof(*$$));
                                 list_init($$);
                                 list_add_head($$, &$1->entry);
                             }
@@ -1990,7 +1898,7 @@ type_specs:               type_spec
 
 type_spec:                any_identifier array
                             {
-                                $$ = d3dcompiler_alloc(sizeof(*$$));
+                                $$ = hlsl_alloc(sizeof(*$$));
                                 $$->loc = get_location(&@1);
                                 $$->name = $1;
                                 $$->array_size = $2;
@@ -2017,7 +1925,7 @@ variables_def_optional:   /* Empty */
 
 variables_def:            variable_def
                             {
-                                $$ = d3dcompiler_alloc(sizeof(*$$));
+                                $$ = hlsl_alloc(sizeof(*$$));
                                 list_init($$);
                                 list_add_head($$, &$1->entry);
                             }
@@ -2029,7 +1937,7 @@ variables_def:            variable_def
 
 variable_def:             any_identifier array colon_attribute
                             {
-                                $$ = d3dcompiler_alloc(sizeof(*$$));
+                                $$ = hlsl_alloc(sizeof(*$$));
                                 $$->loc = get_location(&@1);
                                 $$->name = $1;
                                 $$->array_size = $2;
@@ -2039,7 +1947,7 @@ variable_def:             any_identifier array colon_attribute
                         | any_identifier array colon_attribute '=' complex_initializer
                             {
                                 TRACE("Declaration with initializer.\n");
-                                $$ = d3dcompiler_alloc(sizeof(*$$));
+                                $$ = hlsl_alloc(sizeof(*$$));
                                 $$->loc = get_location(&@1);
                                 $$->name = $1;
                                 $$->array_size = $2;
@@ -2127,7 +2035,7 @@ var_modifiers:            /* Empty */
 complex_initializer:      initializer_expr
                             {
                                 $$.args_count = 1;
-                                if (!($$.args = d3dcompiler_alloc(sizeof(*$$.args))))
+                                if (!($$.args = hlsl_alloc(sizeof(*$$.args))))
                                     YYABORT;
                                 $$.args[0] = node_from_list($1);
                                 $$.instrs = $1;
@@ -2149,7 +2057,7 @@ initializer_expr:         assignment_expr
 initializer_expr_list:    initializer_expr
                             {
                                 $$.args_count = 1;
-                                if (!($$.args = d3dcompiler_alloc(sizeof(*$$.args))))
+                                if (!($$.args = hlsl_alloc(sizeof(*$$.args))))
                                     YYABORT;
                                 $$.args[0] = node_from_list($1);
                                 $$.instrs = $1;
@@ -2157,11 +2065,10 @@ initializer_expr_list:    initializer_expr
                         | initializer_expr_list ',' initializer_expr
                             {
                                 $$ = $1;
-                                if (!($$.args = d3dcompiler_realloc($$.args, ($$.args_count + 1) * sizeof(*$$.args))))
+                                if (!($$.args = hlsl_realloc($$.args, ($$.args_count + 1) * sizeof(*$$.args))))
                                     YYABORT;
                                 $$.args[$$.args_count++] = node_from_list($3);
                                 list_move_tail($$.instrs, $3);
-                                d3dcompiler_free($3);
                             }
 
 boolean:                  KW_TRUE
@@ -2181,7 +2088,6 @@ statement_list:           statement
                             {
                                 $$ = $1;
                                 list_move_tail($$, $2);
-                                d3dcompiler_free($2);
                             }
 
 statement:                declaration_statement
@@ -2201,7 +2107,7 @@ jump_statement:
         }
     | KW_RETURN ';'
         {
-            if (!($$ = d3dcompiler_alloc(sizeof(*$$))))
+            if (!($$ = hlsl_alloc(sizeof(*$$))))
                 YYABORT;
             list_init($$);
             if (!add_return($$, NULL, get_location(&@1)))
@@ -2217,8 +2123,6 @@ selection_statement:      KW_IF '(' expr ')' if_body
                                     YYABORT;
                                 list_move_tail(&instr->then_instrs, $5.then_instrs);
                                 list_move_tail(&instr->else_instrs, $5.else_instrs);
-                                d3dcompiler_free($5.then_instrs);
-                                d3dcompiler_free($5.else_instrs);
                                 if (condition->data_type->dimx > 1 || condition->data_type->dimy > 1)
                                 {
                                     hlsl_report_message(instr->node.loc, HLSL_LEVEL_ERROR,
@@ -2263,7 +2167,7 @@ loop_statement:           KW_WHILE '(' expr ')' statement
 
 expr_statement:           ';'
                             {
-                                $$ = d3dcompiler_alloc(sizeof(*$$));
+                                $$ = hlsl_alloc(sizeof(*$$));
                                 list_init($$);
                             }
                         | expr ';'
@@ -2273,7 +2177,7 @@ expr_statement:           ';'
 
 primary_expr:             C_FLOAT
                             {
-                                struct hlsl_ir_constant *c = d3dcompiler_alloc(sizeof(*c));
+                                struct hlsl_ir_constant *c = hlsl_alloc(sizeof(*c));
                                 if (!c)
                                 {
                                     ERR("Out of memory.\n");
@@ -2287,7 +2191,7 @@ primary_expr:             C_FLOAT
                             }
                         | C_INTEGER
                             {
-                                struct hlsl_ir_constant *c = d3dcompiler_alloc(sizeof(*c));
+                                struct hlsl_ir_constant *c = hlsl_alloc(sizeof(*c));
                                 if (!c)
                                 {
                                     ERR("Out of memory.\n");
@@ -2301,7 +2205,7 @@ primary_expr:             C_FLOAT
                             }
                         | boolean
                             {
-                                struct hlsl_ir_constant *c = d3dcompiler_alloc(sizeof(*c));
+                                struct hlsl_ir_constant *c = hlsl_alloc(sizeof(*c));
                                 if (!c)
                                 {
                                     ERR("Out of memory.\n");
@@ -2429,7 +2333,6 @@ postfix_expr:             primary_expr
             struct hlsl_ir_node *array = node_from_list($1), *index = node_from_list($3);
 
             list_move_tail($1, $3);
-            d3dcompiler_free($3);
 
             if (index->data_type->type != HLSL_CLASS_SCALAR)
             {
@@ -2512,7 +2415,6 @@ postfix_expr:             primary_expr
                 writemask_offset += width;
                 list_add_tail($4.instrs, &assignment->node.entry);
             }
-            d3dcompiler_free($4.args);
             if (!(load = new_var_load(var, get_location(&@2))))
                 YYABORT;
             $$ = append_unop($4.instrs, &load->node);
@@ -2746,7 +2648,6 @@ assignment_expr:
                 YYABORT;
             }
             list_move_tail($3, $1);
-            d3dcompiler_free($1);
             if (!add_assignment($3, lhs, $2, rhs))
                 YYABORT;
             $$ = $3;
@@ -2805,7 +2706,6 @@ expr:                     assignment_expr
                             {
                                 $$ = $1;
                                 list_move_tail($$, $3);
-                                d3dcompiler_free($3);
                             }
 
 %%
@@ -2958,20 +2858,13 @@ HRESULT parse_hlsl(enum shader_type type, DWORD major, DWORD minor,
         const char *entrypoint, ID3D10Blob **shader_blob, char **messages)
 {
     struct hlsl_ir_function_decl *entry_func;
-    struct hlsl_scope *scope, *next_scope;
-    struct hlsl_type *hlsl_type, *next_type;
-    struct hlsl_ir_var *var, *next_var;
     HRESULT hr = E_FAIL;
-    unsigned int i;
 
     hlsl_ctx.status = PARSE_SUCCESS;
     hlsl_ctx.messages.size = hlsl_ctx.messages.capacity = 0;
     hlsl_ctx.line_no = hlsl_ctx.column = 1;
-    hlsl_ctx.source_file = d3dcompiler_strdup("");
-    hlsl_ctx.source_files = d3dcompiler_alloc(sizeof(*hlsl_ctx.source_files));
-    if (hlsl_ctx.source_files)
-        hlsl_ctx.source_files[0] = hlsl_ctx.source_file;
-    hlsl_ctx.source_files_count = 1;
+    init_hlsl_arena();
+    hlsl_ctx.source_file = "";
     hlsl_ctx.cur_scope = NULL;
     hlsl_ctx.matrix_majority = HLSL_COLUMN_MAJOR;
     list_init(&hlsl_ctx.scopes);
@@ -3031,29 +2924,8 @@ out:
             d3dcompiler_free(hlsl_ctx.messages.string);
     }
 
-    for (i = 0; i < hlsl_ctx.source_files_count; ++i)
-        d3dcompiler_free((void *)hlsl_ctx.source_files[i]);
-    d3dcompiler_free(hlsl_ctx.source_files);
-
-    TRACE("Freeing functions IR.\n");
-    wine_rb_destroy(&hlsl_ctx.functions, free_function_rb, NULL);
-
-    TRACE("Freeing variables.\n");
-    LIST_FOR_EACH_ENTRY_SAFE(scope, next_scope, &hlsl_ctx.scopes, struct hlsl_scope, entry)
-    {
-        LIST_FOR_EACH_ENTRY_SAFE(var, next_var, &scope->vars, struct hlsl_ir_var, scope_entry)
-        {
-            free_declaration(var);
-        }
-        wine_rb_destroy(&scope->types, NULL, NULL);
-        d3dcompiler_free(scope);
-    }
-
-    TRACE("Freeing types.\n");
-    LIST_FOR_EACH_ENTRY_SAFE(hlsl_type, next_type, &hlsl_ctx.types, struct hlsl_type, entry)
-    {
-        free_hlsl_type(hlsl_type);
-    }
+    TRACE("Freeing the IR.\n");
+    free_hlsl_arena();
 
     return hr;
 }
@@ -25,6 +25,7 @@
 #include <math.h>
 
 static pD3DCompile ppD3DCompile;
+static pD3DPreprocess ppD3DPreprocess;
 
 static HRESULT (WINAPI *pD3DCompile2)(const void *data, SIZE_T data_size, const char *filename, const D3D_SHADER_MACRO *defines,
         ID3DInclude *include, const char *entrypoint, const char *target, UINT sflags, UINT eflags, UINT secondary_flags,
@@ -1442,6 +1443,405 @@ static void test_fail(void)
     }
 }
 
+static void test_compile_times(void)
+{
+    static const char uber_shader[] =
+        "float4x4 world_view_proj;\n"
+        "float4x4 world;\n"
+        "float3 light_dir[4];\n"
+        "float4 light_color[4];\n"
+        "float4 material_color;\n"
+        "sampler2D diffuse_map;\n"
+        "sampler2D normal_map;\n"
+        "\n"
+        "struct ps_input\n"
+        "{\n"
+        "    float4 pos : POSITION;\n"
+        "    float2 texcoord : TEXCOORD0;\n"
+        "    float3 normal : TEXCOORD1;\n"
+        "    float3 world_pos : TEXCOORD2;\n"
+        "};\n"
+        "\n"
+        "float3 light(float3 n, float3 l, float3 c)\n"
+        "{\n"
+        "    return c * max(dot(n, -l), 0.0);\n"
+        "}\n"
+        "\n"
+        "float4 main(ps_input i) : COLOR\n"
+        "{\n"
+        "    float4 color = material_color;\n"
+        "    float3 n = normalize(i.normal);\n"
+        "    float3 total = float3(0.1, 0.1, 0.1);\n"
+        "#ifdef NORMAL_MAP\n"
+        "    n = normalize(n + tex2D(normal_map, i.texcoord).xyz * 2.0 - 1.0);\n"
+        "#endif\n"
+        "#ifdef DIFFUSE_MAP\n"
+        "    color *= tex2D(diffuse_map, i.texcoord);\n"
+        "#endif\n"
+        "#if LIGHTS > 0\n"
+        "    total += light(n, light_dir[0], light_color[0].xyz);\n"
+        "#endif\n"
+        "#if LIGHTS > 1\n"
+        "    total += light(n, light_dir[1], light_color[1].xyz);\n"
+        "#endif\n"
+        "#if LIGHTS > 2\n"
+        "    total += light(n, light_dir[2], light_color[2].xyz);\n"
+        "    total += light(n, light_dir[3], light_color[3].xyz);\n"
+        "#endif\n"
+        "#ifdef FOG\n"
+        "    color.xyz = lerp(color.xyz, float3(0.5, 0.5, 0.5), saturate(length(i.world_pos) / 100.0));\n"
+        "#endif\n"
+        "    color.xyz *= total;\n"
+        "    return color;\n"
+        "}\n";
+    static const char *light_counts[] = {"0", "1", "2", "4"};
+    D3D_SHADER_MACRO defines[5];
+    ID3D10Blob *blob, *errors;
+    unsigned int i, j, count, length;
+    DWORD start;
+    char *source;
+    HRESULT hr;
+
+    start = GetTickCount();
+    for (i = 0; i < 64; ++i)
+    {
+        count = 0;
+        defines[count].Name = "LIGHTS";
+        defines[count++].Definition = light_counts[i & 3];
+        if (i & 4)
+        {
+            defines[count].Name = "NORMAL_MAP";
+            defines[count++].Definition = "1";
+        }
+        if (i & 8)
+        {
+            defines[count].Name = "DIFFUSE_MAP";
+            defines[count++].Definition = "1";
+        }
+        if (i & 16)
+        {
+            defines[count].Name = "FOG";
+            defines[count++].Definition = "1";
+        }
+        defines[count].Name = NULL;
+        defines[count].Definition = NULL;
+
+        blob = errors = NULL;
+        hr = ppD3DCompile(uber_shader, strlen(uber_shader), NULL, defines, NULL,
+                "main", i & 32 ? "ps_3_0" : "ps_2_0", 0, 0, &blob, &errors);
+        if (i == 0)
+            trace("Uber shader compilation hr %#x.\n", hr);
+        if (blob)
+            ID3D10Blob_Release(blob);
+        if (errors)
+            ID3D10Blob_Release(errors);
+    }
+    trace("Compiled 64 uber shader permutations in %u ms.\n", GetTickCount() - start);
+
+    /* A large generated shader, with many declarations and expressions. */
+    source = heap_alloc(1 << 20);
+    length = sprintf(source, "float4 globals[64];\n");
+    for (i = 0; i < 200; ++i)
+    {
+        length += sprintf(source + length,
+                "struct s%u\n{\n    float4 a;\n    float3x3 m;\n    int2 b[2];\n};\n"
+                "float4 func%u(float4 x, s%u s)\n{\n    float4 y = x * globals[%u] + s.a;\n"
+                "    float3 z = mul(s.m, y.xyz);\n", i, i, i, i % 64);
+        for (j = 0; j < 10; ++j)
+            length += sprintf(source + length, "    y.%c += z.x * %u.0 - y.w / (s.b[%u].x + 1);\n",
+                    "xyzw"[j & 3], j, j & 1);
+        length += sprintf(source + length, "    return y%s;\n}\n",
+                i ? wine_dbg_sprintf(" + func%u(y, (s%u)0)", i - 1, i - 1) : "");
+    }
+    length += sprintf(source + length,
+            "float4 main(float4 pos : TEXCOORD0) : COLOR\n{\n    return func199(pos, (s199)0);\n}\n");
+
+    start = GetTickCount();
+    for (i = 0; i < 10; ++i)
+    {
+        blob = errors = NULL;
+        hr = ppD3DCompile(source, length, NULL, NULL, NULL, "main", "ps_3_0", 0, 0, &blob, &errors);
+        if (i == 0)
+            trace("Large shader (%u bytes) compilation hr %#x.\n", length, hr);
+        if (blob)
+            ID3D10Blob_Release(blob);
+        if (errors)
+            ID3D10Blob_Release(errors);
+    }
+    trace("Compiled the large shader 10 times in %u ms.\n", GetTickCount() - start);
+
+    heap_free(source);
+}
+
+static unsigned int benchmark_include_version;
+
+static HRESULT WINAPI benchmark_include_open(ID3DInclude *iface, D3D_INCLUDE_TYPE include_type,
+        const char *filename, const void *parent_data, const void **data, UINT *bytes)
+{
+    static const char *common[] =
+    {
+        "#define SCALE 2.0\n"
+        "#define SCALE 3.0\n"
+        "float4x4 world_view_proj;\n"
+        "float4 colors[16];\n"
+        "float4 shade(float4 c, float3 n)\n"
+        "{\n"
+        "    return c * SCALE * saturate(dot(n, float3(0.0, 0.7, 0.7)));\n"
+        "}\n",
+
+        "#define SCALE 2.0\n"
+        "#define SCALE 3.0\n"
+        "float4x4 world_view_proj;\n"
+        "float4 colors[16];\n"
+        "float4 shade(float4 c, float3 n)\n"
+        "{\n"
+        "    return c * SCALE * saturate(dot(n, float3(0.0, 0.25, 0.75)));\n"
+        "}\n",
+    };
+
+    *data = common[benchmark_include_version];
+    *bytes = strlen(common[benchmark_include_version]);
+    return S_OK;
+}
+
+static HRESULT WINAPI benchmark_include_close(ID3DInclude *iface, const void *data)
+{
+    return S_OK;
+}
+
+static const struct ID3DIncludeVtbl benchmark_include_vtbl =
+{
+    benchmark_include_open,
+    benchmark_include_close
+};
+
+static BOOL blobs_equal(ID3D10Blob *a, ID3D10Blob *b)
+{
+    if (!a || !b)
+        return a == b;
+    return ID3D10Blob_GetBufferSize(a) == ID3D10Blob_GetBufferSize(b)
+            && !memcmp(ID3D10Blob_GetBufferPointer(a), ID3D10Blob_GetBufferPointer(b), ID3D10Blob_GetBufferSize(a));
+}
+
+/* With "CompilerCacheSize" set in HKCU\Software\Wine\Direct3D, the second
+ * pass should be served from the compilation cache, and give the same
+ * results as the first one. The include redefines a macro, so the
+ * preprocessor warnings are checked too. Changing the include must not
+ * return stale cached output. */
+static void test_compile_cache_times(void)
+{
+    ID3D10Blob *preprocessed[2][100], *preprocess_errors[2][100], *compiled[2][100], *compile_errors[2][100];
+    ID3DInclude include = {&benchmark_include_vtbl};
+    HRESULT preprocess_hr[2][100], compile_hr[2][100];
+    unsigned int i, pass, length;
+    ID3D10Blob *blob, *errors;
+    char source[1024];
+    DWORD start;
+    HRESULT hr;
+
+    if (!ppD3DPreprocess)
+    {
+        win_skip("D3DPreprocess() is not available.\n");
+        return;
+    }
+
+    benchmark_include_version = 0;
+    for (pass = 0; pass < 2; ++pass)
+    {
+        start = GetTickCount();
+        for (i = 0; i < ARRAY_SIZE(preprocessed[pass]); ++i)
+        {
+            length = sprintf(source,
+                    "#include \"common.h\"\n"
+                    "float4 main(float3 n : TEXCOORD0) : COLOR\n"
+                    "{\n"
+                    "    float4 c = colors[%u] * %u.0;\n"
+                    "    return shade(c, n) + mul(world_view_proj, c);\n"
+                    "}\n", i % 16, i);
+
+            preprocessed[pass][i] = preprocess_errors[pass][i] = NULL;
+            preprocess_hr[pass][i] = ppD3DPreprocess(source, length, "shader.hlsl", NULL, &include,
+                    &preprocessed[pass][i], &preprocess_errors[pass][i]);
+            compiled[pass][i] = compile_errors[pass][i] = NULL;
+            compile_hr[pass][i] = ppD3DCompile(source, length, "shader.hlsl", NULL, &include, "main",
+                    i & 1 ? "ps_3_0" : "ps_2_0", 0, 0, &compiled[pass][i], &compile_errors[pass][i]);
+        }
+        trace("Pass %u: preprocessed and compiled 100 shaders in %u ms, compilation hr %#x.\n",
+                pass, GetTickCount() - start, compile_hr[pass][0]);
+    }
+
+    for (i = 0; i < ARRAY_SIZE(preprocessed[0]); ++i)
+    {
+        ok(preprocess_hr[0][i] == S_OK, "Shader %u: got unexpected hr %#x.\n", i, preprocess_hr[0][i]);
+        ok(preprocess_hr[1][i] == preprocess_hr[0][i], "Shader %u: got hr %#x, expected %#x.\n",
+                i, preprocess_hr[1][i], preprocess_hr[0][i]);
+        ok(blobs_equal(preprocessed[0][i], preprocessed[1][i]), "Shader %u: preprocessed output differs.\n", i);
+        ok(blobs_equal(preprocess_errors[0][i], preprocess_errors[1][i]),
+                "Shader %u: preprocessor messages differ.\n", i);
+        ok(compile_hr[1][i] == compile_hr[0][i], "Shader %u: got hr %#x, expected %#x.\n",
+                i, compile_hr[1][i], compile_hr[0][i]);
+        ok(blobs_equal(compiled[0][i], compiled[1][i]), "Shader %u: compiled shader differs.\n", i);
+        ok(blobs_equal(compile_errors[0][i], compile_errors[1][i]), "Shader %u: compiler messages differ.\n", i);
+
+        for (pass = 0; pass < 2; ++pass)
+        {
+            if (preprocessed[pass][i])
+                ID3D10Blob_Release(preprocessed[pass][i]);
+            if (preprocess_errors[pass][i])
+                ID3D10Blob_Release(preprocess_errors[pass][i]);
+            if (compiled[pass][i])
+                ID3D10Blob_Release(compiled[pass][i]);
+            if (compile_errors[pass][i])
+                ID3D10Blob_Release(compile_errors[pass][i]);
+        }
+    }
+
+    benchmark_include_version = 1;
+    length = sprintf(source, "#include \"common.h\"\n");
+    blob = errors = NULL;
+    hr = ppD3DPreprocess(source, length, "shader.hlsl", NULL, &include, &blob, &errors);
+    ok(hr == S_OK, "Got unexpected hr %#x.\n", hr);
+    if (blob)
+    {
+        ok(!!strstr(ID3D10Blob_GetBufferPointer(blob), "0.25"), "Got stale output %s.\n",
+                debugstr_a(ID3D10Blob_GetBufferPointer(blob)));
+        ID3D10Blob_Release(blob);
+    }
+    if (errors)
+        ID3D10Blob_Release(errors);
+}
+
+static unsigned int count_cache_entries(const char *dir)
+{
+    WIN32_FIND_DATAA data;
+    char path[MAX_PATH];
+    unsigned int count = 0;
+    HANDLE handle;
+
+    sprintf(path, "%s\\*.dcc", dir);
+    if ((handle = FindFirstFileA(path, &data)) == INVALID_HANDLE_VALUE)
+        return 0;
+    do
+    {
+        ++count;
+    } while (FindNextFileA(handle, &data));
+    FindClose(handle);
+
+    return count;
+}
+
+static void check_preprocessed_include(unsigned int line, ID3DInclude *include,
+        const char *expected, const char *unexpected)
+{
+    static const char source[] = "#include \"common.h\"\n";
+    ID3D10Blob *blob = NULL, *errors = NULL;
+    const char *text;
+    HRESULT hr;
+
+    hr = ppD3DPreprocess(source, strlen(source), "shader.hlsl", NULL, include, &blob, &errors);
+    ok_(__FILE__, line)(hr == S_OK, "Got unexpected hr %#x.\n", hr);
+    if (errors)
+        ID3D10Blob_Release(errors);
+    if (!blob)
+        return;
+    text = ID3D10Blob_GetBufferPointer(blob);
+    ok_(__FILE__, line)(strstr(text, expected) && !strstr(text, unexpected),
+            "Got unexpected output %s.\n", debugstr_a(text));
+    ID3D10Blob_Release(blob);
+}
+
+/* Runs in a child process, with the compilation cache enabled in dir. */
+static void test_compile_cache_child(const char *dir)
+{
+    ID3DInclude include = {&benchmark_include_vtbl};
+
+    ok(!count_cache_entries(dir), "Cache directory isn't empty.\n");
+
+    benchmark_include_version = 0;
+    check_preprocessed_include(__LINE__, &include, "0.7", "0.25");
+    ok(count_cache_entries(dir) == 1, "Got %u cache entries.\n", count_cache_entries(dir));
+    check_preprocessed_include(__LINE__, &include, "0.7", "0.25");
+    ok(count_cache_entries(dir) == 1, "Got %u cache entries.\n", count_cache_entries(dir));
+
+    /* A changed include invalidates the entry. */
+    benchmark_include_version = 1;
+    check_preprocessed_include(__LINE__, &include, "0.25", "0.7");
+    benchmark_include_version = 0;
+    check_preprocessed_include(__LINE__, &include, "0.7", "0.25");
+}
+
+static void test_compile_cache(void)
+{
+    char dir[MAX_PATH], path[MAX_PATH], cmdline[MAX_PATH * 2], **argv;
+    STARTUPINFOA si = {sizeof(si)};
+    PROCESS_INFORMATION pi;
+    WIN32_FIND_DATAA data;
+    DWORD cache_size = 1;
+    HANDLE handle;
+    HKEY key;
+    BOOL ret;
+
+    if (strcmp(winetest_platform, "wine"))
+    {
+        skip("The compilation cache is specific to Wine.\n");
+        return;
+    }
+    if (!ppD3DPreprocess)
+    {
+        win_skip("D3DPreprocess() is not available.\n");
+        return;
+    }
+
+    if (RegCreateKeyA(HKEY_CURRENT_USER, "Software\\Wine\\Direct3D", &key))
+    {
+        skip("Failed to open the Direct3D key.\n");
+        return;
+    }
+    if (!RegQueryValueExA(key, "CompilerCacheSize", NULL, NULL, NULL, NULL)
+            || !RegQueryValueExA(key, "CompilerCachePath", NULL, NULL, NULL, NULL))
+    {
+        skip("The compilation cache is already configured.\n");
+        RegCloseKey(key);
+        return;
+    }
+
+    GetTempPathA(ARRAY_SIZE(dir), dir);
+    strcat(dir, "d3dcompiler_cache_test");
+    ret = CreateDirectoryA(dir, NULL);
+    ok(ret, "Failed to create %s, error %u.\n", dir, GetLastError());
+
+    RegSetValueExA(key, "CompilerCacheSize", 0, REG_DWORD, (BYTE *)&cache_size, sizeof(cache_size));
+    RegSetValueExA(key, "CompilerCachePath", 0, REG_SZ, (BYTE *)dir, strlen(dir) + 1);
+
+    winetest_get_mainargs(&argv);
+    sprintf(cmdline, "\"%s\" hlsl_d3d9 compile_cache \"%s\"", argv[0], dir);
+    ret = CreateProcessA(NULL, cmdline, NULL, NULL, FALSE, 0, NULL, NULL, &si, &pi);
+    ok(ret, "Failed to create process, error %u.\n", GetLastError());
+    if (ret)
+    {
+        wait_child_process(pi.hProcess);
+        CloseHandle(pi.hProcess);
+        CloseHandle(pi.hThread);
+    }
+
+    RegDeleteValueA(key, "CompilerCacheSize");
+    RegDeleteValueA(key, "CompilerCachePath");
+    RegCloseKey(key);
+
+    sprintf(path, "%s\\*", dir);
+    if ((handle = FindFirstFileA(path, &data)) != INVALID_HANDLE_VALUE)
+    {
+        do
+        {
+            sprintf(path, "%s\\%s", dir, data.cFileName);
+            DeleteFileA(path);
+        } while (FindNextFileA(handle, &data));
+        FindClose(handle);
+    }
+    ret = RemoveDirectoryA(dir);
+    ok(ret, "Failed to remove %s, error %u.\n", dir, GetLastError());
+}
+
 static BOOL load_d3dcompiler(void)
 {
     HMODULE module;
@@ -1455,6 +1855,7 @@ static BOOL load_d3dcompiler(void)
 #endif
 
     ppD3DCompile = (void*)GetProcAddress(module, "D3DCompile");
+    ppD3DPreprocess = (void*)GetProcAddress(module, "D3DPreprocess");
     return TRUE;
 }
 
@@ -1693,6 +2094,7 @@ cleanup:
 START_TEST(hlsl_d3d9)
 {
     HMODULE mod;
+    char **argv;
 
     if (!load_d3dcompiler())
     {
@@ -1700,6 +2102,12 @@ START_TEST(hlsl_d3d9)
         return;
     }
 
+    if (winetest_get_mainargs(&argv) >= 4 && !strcmp(argv[2], "compile_cache"))
+    {
+        test_compile_cache_child(argv[3]);
+        return;
+    }
+
     if (!(mod = LoadLibraryA("d3dx9_36.dll")))
     {
         win_skip("Failed to load d3dx9_36.dll.\n");
@@ -1724,4 +2132,11 @@ START_TEST(hlsl_d3d9)
     test_constant_table();
     test_fail();
     test_d3dcompile();
+    test_compile_cache();
+
+    if (winetest_interactive)
+    {
+        test_compile_times();
+        test_compile_cache_times();
+    }
 }
@@ -759,6 +759,161 @@ void compilation_message(struct compilation_messages *msg, const char *fmt, __ms
 }
 
 #if D3D_COMPILER_VERSION
+/* Blocks of HLSL_ARENA_CHUNK_SIZE bytes are carved into allocations, each of
+ * them preceded by a header storing its size so that hlsl_realloc() knows how
+ * much to copy. Allocations larger than a quarter of a chunk get a chunk of
+ * their own, to avoid wasting the end of the current one. Allocations are
+ * never released individually, the whole arena is freed by free_hlsl_arena(). */
+#define HLSL_ARENA_CHUNK_SIZE 0x10000
+
+union hlsl_arena_block
+{
+    SIZE_T size;
+    double align;
+    void *ptr;
+};
+
+struct hlsl_arena_chunk
+{
+    struct hlsl_arena_chunk *next;
+    SIZE_T size, used;
+    union hlsl_arena_block blocks[1];
+};
+
+#define HLSL_ARENA_CHUNK_BLOCKS ((HLSL_ARENA_CHUNK_SIZE - offsetof(struct hlsl_arena_chunk, blocks)) \
+        / sizeof(union hlsl_arena_block))
+
+struct hlsl_string
+{
+    struct wine_rb_entry entry;
+    char string[1];
+};
+
+static int compare_hlsl_string_rb(const void *key, const struct wine_rb_entry *entry)
+{
+    return strcmp(key, WINE_RB_ENTRY_VALUE(entry, const struct hlsl_string, entry)->string);
+}
+
+void init_hlsl_arena(void)
+{
+    hlsl_ctx.arena = NULL;
+    wine_rb_init(&hlsl_ctx.strings, compare_hlsl_string_rb);
+}
+
+void free_hlsl_arena(void)
+{
+    struct hlsl_arena_chunk *chunk, *next;
+
+    for (chunk = hlsl_ctx.arena; chunk; chunk = next)
+    {
+        next = chunk->next;
+        d3dcompiler_free(chunk);
+    }
+    hlsl_ctx.arena = NULL;
+}
+
+static struct hlsl_arena_chunk *new_arena_chunk(SIZE_T size)
+{
+    struct hlsl_arena_chunk *chunk;
+
+    if (!(chunk = d3dcompiler_alloc(offsetof(struct hlsl_arena_chunk, blocks[size]))))
+    {
+        ERR("Out of memory.\n");
+        return NULL;
+    }
+    chunk->size = size;
+    return chunk;
+}
+
+void *hlsl_alloc(SIZE_T size)
+{
+    SIZE_T count = (size + sizeof(union hlsl_arena_block) - 1) / sizeof(union hlsl_arena_block) + 1;
+    struct hlsl_arena_chunk *chunk = hlsl_ctx.arena;
+    union hlsl_arena_block *block;
+
+    if (count > HLSL_ARENA_CHUNK_BLOCKS / 4)
+    {
+        if (!(chunk = new_arena_chunk(count)))
+            return NULL;
+        if (hlsl_ctx.arena)
+        {
+            chunk->next = hlsl_ctx.arena->next;
+            hlsl_ctx.arena->next = chunk;
+        }
+        else
+        {
+            hlsl_ctx.arena = chunk;
+        }
+    }
+    else if (!chunk || chunk->size - chunk->used < count)
+    {
+        if (!(chunk = new_arena_chunk(HLSL_ARENA_CHUNK_BLOCKS)))
+            return NULL;
+        chunk->next = hlsl_ctx.arena;
+        hlsl_ctx.arena = chunk;
+    }
+
+    /* Chunks are zeroed on allocation. */
+    block = &chunk->blocks[chunk->used];
+    block->size = (count - 1) * sizeof(*block);
+    chunk->used += count;
+    return block + 1;
+}
+
+void *hlsl_realloc(void *ptr, SIZE_T size)
+{
+    union hlsl_arena_block *block;
+    void *new_ptr;
+
+    if (!ptr)
+        return hlsl_alloc(size);
+
+    block = (union hlsl_arena_block *)ptr - 1;
+    if (size <= block->size)
+        return ptr;
+
+    if (!(new_ptr = hlsl_alloc(size)))
+        return NULL;
+    memcpy(new_ptr, ptr, block->size);
+    return new_ptr;
+}
+
+char *hlsl_strdup(const char *string)
+{
+    SIZE_T len;
+    char *copy;
+
+    if (!string)
+        return NULL;
+
+    len = strlen(string);
+    if ((copy = hlsl_alloc(len + 1)))
+        memcpy(copy, string, len + 1);
+    return copy;
+}
+
+/* Returns a unique copy of the string, shared with all the other users of an
+ * identical one. The returned string must not be modified. */
+char *hlsl_intern(const char *string)
+{
+    struct wine_rb_entry *entry;
+    struct hlsl_string *s;
+    SIZE_T len;
+
+    if (!string)
+        return NULL;
+
+    if ((entry = wine_rb_get(&hlsl_ctx.strings, string)))
+        return WINE_RB_ENTRY_VALUE(entry, struct hlsl_string, entry)->string;
+
+    len = strlen(string);
+    if (!(s = hlsl_alloc(offsetof(struct hlsl_string, string[len + 1]))))
+        return NULL;
+    memcpy(s->string, string, len + 1);
+    wine_rb_put(&hlsl_ctx.strings, s->string, &s->entry);
+    return s->string;
+}
+
 BOOL add_declaration(struct hlsl_scope *scope, struct hlsl_ir_var *decl, BOOL local_var)
 {
     struct hlsl_ir_var *var;
@@ -796,20 +951,12 @@ struct hlsl_ir_var *get_variable(struct hlsl_scope *scope, const char *name)
     return get_variable(scope->upper, name);
 }
 
-void free_declaration(struct hlsl_ir_var *decl)
-{
-    d3dcompiler_free((void *)decl->name);
-    d3dcompiler_free((void *)decl->semantic);
-    d3dcompiler_free((void *)decl->reg_reservation);
-    d3dcompiler_free(decl);
-}
-
 struct hlsl_type *new_hlsl_type(const char *name, enum hlsl_type_class type_class,
         enum hlsl_base_type base_type, unsigned dimx, unsigned dimy)
 {
     struct hlsl_type *type;
 
-    type = d3dcompiler_alloc(sizeof(*type));
+    type = hlsl_alloc(sizeof(*type));
     if (!type)
     {
         ERR("Out of memory\n");
@@ -939,21 +1086,13 @@ struct hlsl_type *clone_hlsl_type(struct hlsl_type *old, unsigned int default_ma
     struct hlsl_type *type;
     struct hlsl_struct_field *old_field, *field;
 
-    type = d3dcompiler_alloc(sizeof(*type));
+    type = hlsl_alloc(sizeof(*type));
     if (!type)
     {
         ERR("Out of memory\n");
         return NULL;
     }
-    if (old->name)
-    {
-        type->name = d3dcompiler_strdup(old->name);
-        if (!type->name)
-        {
-            d3dcompiler_free(type);
-            return NULL;
-        }
-    }
+    type->name = old->name;
     type->type = old->type;
     type->base_type = old->base_type;
     type->dimx = old->dimx;
@@ -974,34 +1113,16 @@ struct hlsl_type *clone_hlsl_type(struct hlsl_type *old, unsigned int default_ma
         {
             unsigned int reg_size = 0;
 
-            type->e.elements = d3dcompiler_alloc(sizeof(*type->e.elements));
-            if (!type->e.elements)
-            {
-                d3dcompiler_free((void *)type->name);
-                d3dcompiler_free(type);
+            if (!(type->e.elements = hlsl_alloc(sizeof(*type->e.elements))))
                 return NULL;
-            }
             list_init(type->e.elements);
             LIST_FOR_EACH_ENTRY(old_field, old->e.elements, struct hlsl_struct_field, entry)
             {
-                field = d3dcompiler_alloc(sizeof(*field));
-                if (!field)
-                {
-                    LIST_FOR_EACH_ENTRY_SAFE(field, old_field, type->e.elements, struct hlsl_struct_field, entry)
-                    {
-                        d3dcompiler_free((void *)field->semantic);
-                        d3dcompiler_free((void *)field->name);
-                        d3dcompiler_free(field);
-                    }
-                    d3dcompiler_free(type->e.elements);
-                    d3dcompiler_free((void *)type->name);
-                    d3dcompiler_free(type);
+                if (!(field = hlsl_alloc(sizeof(*field))))
                     return NULL;
-                }
                 field->type = clone_hlsl_type(old_field->type, default_majority);
-                field->name = d3dcompiler_strdup(old_field->name);
-                if (old_field->semantic)
-                    field->semantic = d3dcompiler_strdup(old_field->semantic);
+                field->name = old_field->name;
+                field->semantic = old_field->semantic;
                 field->modifiers = old_field->modifiers;
                 field->reg_offset = reg_size;
                 reg_size += field->type->reg_size;
@@ -1298,7 +1419,7 @@ static struct hlsl_type *expr_common_type(struct hlsl_type *t1, struct hlsl_type
         return hlsl_ctx.builtin_types.scalar[base];
     if (type == HLSL_CLASS_VECTOR)
         return hlsl_ctx.builtin_types.vector[base][dimx - 1];
-    return new_hlsl_type(NULL, type, base, dimx, dimy);
+    return hlsl_ctx.builtin_types.matrix[base][dimx - 1][dimy - 1];
 }
 
 struct hlsl_ir_node *add_implicit_conversion(struct list *instrs, struct hlsl_ir_node *node,
@@ -1365,7 +1486,7 @@ struct hlsl_ir_expr *add_expr(struct list *instrs, enum hlsl_ir_expr_op op, stru
         operands[i] = &cast->node;
     }
 
-    if (!(expr = d3dcompiler_alloc(sizeof(*expr))))
+    if (!(expr = hlsl_alloc(sizeof(*expr))))
         return NULL;
     init_node(&expr->node, HLSL_IR_EXPR, type, *loc);
     expr->op = op;
@@ -1459,7 +1580,7 @@ struct hlsl_ir_node *add_assignment(struct list *instrs, struct hlsl_ir_node *lh
             return NULL;
     }
 
-    assign = d3dcompiler_alloc(sizeof(*assign));
+    assign = hlsl_alloc(sizeof(*assign));
     if (!assign)
     {
         ERR("Out of memory\n");
@@ -1473,7 +1594,6 @@ struct hlsl_ir_node *add_assignment(struct list *instrs, struct hlsl_ir_node *lh
         if (lhs->type == HLSL_IR_EXPR && expr_from_node(lhs)->op == HLSL_IR_UNOP_CAST)
         {
             FIXME("Cast on the lhs.\n");
-            d3dcompiler_free(assign);
             return NULL;
         }
         else if (lhs->type == HLSL_IR_SWIZZLE)
@@ -1494,7 +1614,6 @@ struct hlsl_ir_node *add_assignment(struct list *instrs, struct hlsl_ir_node *lh
             if (!invert_swizzle(&swizzle->swizzle, &writemask, &width))
             {
                 hlsl_report_message(lhs->loc, HLSL_LEVEL_ERROR, "invalid writemask");
-                d3dcompiler_free(assign);
                 return NULL;
             }
             assert(swizzle_type->type == HLSL_CLASS_VECTOR);
@@ -1505,7 +1624,6 @@ struct hlsl_ir_node *add_assignment(struct list *instrs, struct hlsl_ir_node *lh
         else
         {
             hlsl_report_message(lhs->loc, HLSL_LEVEL_ERROR, "invalid lvalue");
-            d3dcompiler_free(assign);
             return NULL;
         }
 
@@ -1550,7 +1668,7 @@ static int compare_hlsl_types_rb(const void *key, const struct wine_rb_entry *en
 
 void push_scope(struct hlsl_parse_ctx *ctx)
 {
-    struct hlsl_scope *new_scope = d3dcompiler_alloc(sizeof(*new_scope));
+    struct hlsl_scope *new_scope = hlsl_alloc(sizeof(*new_scope));
 
     if (!new_scope)
     {
@@ -2091,51 +2209,27 @@ void debug_dump_ir_function_decl(const struct hlsl_ir_function_decl *func)
     }
 }
 
-void free_hlsl_type(struct hlsl_type *type)
-{
-    struct hlsl_struct_field *field, *next_field;
-
-    d3dcompiler_free((void *)type->name);
-    if (type->type == HLSL_CLASS_STRUCT)
-    {
-        LIST_FOR_EACH_ENTRY_SAFE(field, next_field, type->e.elements, struct hlsl_struct_field, entry)
-        {
-            d3dcompiler_free((void *)field->name);
-            d3dcompiler_free((void *)field->semantic);
-            d3dcompiler_free(field);
-        }
-    }
-    d3dcompiler_free(type);
-}
-
 void free_instr_list(struct list *list)
 {
     struct hlsl_ir_node *node, *next_node;
 
     if (!list)
         return;
-    /* Iterate in reverse, to avoid use-after-free when unlinking sources from
-     * the "uses" list. */
+    /* The instructions belong to the arena, freeing them only unlinks their
+     * sources from the "uses" lists. Iterate in reverse, so that uses are
+     * unlinked before the instructions they refer to. */
     LIST_FOR_EACH_ENTRY_SAFE_REV(node, next_node, list, struct hlsl_ir_node, entry)
         free_instr(node);
-    d3dcompiler_free(list);
-}
-
-static void free_ir_constant(struct hlsl_ir_constant *constant)
-{
-    d3dcompiler_free(constant);
 }
 
 static void free_ir_load(struct hlsl_ir_load *load)
 {
     hlsl_src_remove(&load->src.offset);
-    d3dcompiler_free(load);
 }
 
 static void free_ir_swizzle(struct hlsl_ir_swizzle *swizzle)
 {
     hlsl_src_remove(&swizzle->val);
-    d3dcompiler_free(swizzle);
 }
 
 static void free_ir_expr(struct hlsl_ir_expr *expr)
@@ -2144,14 +2238,12 @@ static void free_ir_expr(struct hlsl_ir_expr *expr)
 
     for (i = 0; i < ARRAY_SIZE(expr->operands); ++i)
         hlsl_src_remove(&expr->operands[i]);
-    d3dcompiler_free(expr);
 }
 
 static void free_ir_assignment(struct hlsl_ir_assignment *assignment)
 {
     hlsl_src_remove(&assignment->rhs);
     hlsl_src_remove(&assignment->lhs.offset);
-    d3dcompiler_free(assignment);
 }
 
 static void free_ir_if(struct hlsl_ir_if *if_node)
@@ -2163,7 +2255,6 @@ static void free_ir_if(struct hlsl_ir_if *if_node)
     LIST_FOR_EACH_ENTRY_SAFE(node, next_node, &if_node->else_instrs, struct hlsl_ir_node, entry)
         free_instr(node);
     hlsl_src_remove(&if_node->condition);
-    d3dcompiler_free(if_node);
 }
 
 static void free_ir_loop(struct hlsl_ir_loop *loop)
@@ -2172,12 +2263,6 @@ static void free_ir_loop(struct hlsl_ir_loop *loop)
 
     LIST_FOR_EACH_ENTRY_SAFE(node, next_node, &loop->body, struct hlsl_ir_node, entry)
         free_instr(node);
-    d3dcompiler_free(loop);
-}
-
-static void free_ir_jump(struct hlsl_ir_jump *jump)
-{
-    d3dcompiler_free(jump);
 }
 
 void free_instr(struct hlsl_ir_node *node)
@@ -2185,7 +2270,7 @@ void free_instr(struct hlsl_ir_node *node)
     switch (node->type)
     {
         case HLSL_IR_CONSTANT:
-            free_ir_constant(constant_from_node(node));
+        case HLSL_IR_JUMP:
             break;
         case HLSL_IR_LOAD:
             free_ir_load(load_from_node(node));
@@ -2205,37 +2290,14 @@ void free_instr(struct hlsl_ir_node *node)
         case HLSL_IR_LOOP:
             free_ir_loop(loop_from_node(node));
             break;
-        case HLSL_IR_JUMP:
-            free_ir_jump(jump_from_node(node));
-            break;
         default:
             FIXME("Unsupported node type %s\n", debug_node_type(node->type));
     }
 }
 
-static void free_function_decl(struct hlsl_ir_function_decl *decl)
-{
-    d3dcompiler_free((void *)decl->semantic);
-    d3dcompiler_free(decl->parameters);
-    free_instr_list(decl->body);
-    d3dcompiler_free(decl);
-}
-
 static void free_function_decl_rb(struct wine_rb_entry *entry, void *context)
 {
-    free_function_decl(WINE_RB_ENTRY_VALUE(entry, struct hlsl_ir_function_decl, entry));
-}
-
-static void free_function(struct hlsl_ir_function *func)
-{
-    wine_rb_destroy(&func->overloads, free_function_decl_rb, NULL);
-    d3dcompiler_free((void *)func->name);
-    d3dcompiler_free(func);
-}
-
-void free_function_rb(struct wine_rb_entry *entry, void *context)
-{
-    free_function(WINE_RB_ENTRY_VALUE(entry, struct hlsl_ir_function, entry));
+    free_instr_list(WINE_RB_ENTRY_VALUE(entry, struct hlsl_ir_function_decl, entry)->body);
 }
 
 void add_function_decl(struct wine_rb_tree *funcs, char *name, struct hlsl_ir_function_decl *decl, BOOL intrinsic)
@@ -2266,19 +2328,14 @@ void add_function_decl(struct wine_rb_tree *funcs, char *name, struct hlsl_ir_fu
                     WINE_RB_ENTRY_VALUE(old_entry, struct hlsl_ir_function_decl, entry);
 
             if (!decl->body)
-            {
-                free_function_decl(decl);
-                d3dcompiler_free(name);
                 return;
-            }
             wine_rb_remove(&func->overloads, old_entry);
-            free_function_decl(old_decl);
+            free_instr_list(old_decl->body);
         }
         wine_rb_put(&func->overloads, decl->parameters, &decl->entry);
-        d3dcompiler_free(name);
         return;
     }
-    func = d3dcompiler_alloc(sizeof(*func));
+    func = hlsl_alloc(sizeof(*func));
     func->name = name;
     wine_rb_init(&func->overloads, compare_function_decl_rb);
     decl->func = func;
@@ -130,6 +130,10 @@ HRESULT unlock_surface(IDirect3DSurface9 *surface, const RECT *surface_rect,
 unsigned short float_32_to_16(const float in) DECLSPEC_HIDDEN;
 float float_16_to_32(const unsigned short in) DECLSPEC_HIDDEN;
 
+typedef void (*d3dx_parallel_func)(void *context, unsigned int start, unsigned int end);
+void d3dx_parallel_for(unsigned int count, unsigned int chunk_size, d3dx_parallel_func func,
+        void *context) DECLSPEC_HIDDEN;
+
 /* debug helpers */
 const char *debug_d3dxparameter_class(D3DXPARAMETER_CLASS c) DECLSPEC_HIDDEN;
 const char *debug_d3dxparameter_type(D3DXPARAMETER_TYPE t) DECLSPEC_HIDDEN;
@@ -277,6 +281,7 @@ struct d3dx_regstore
 };
 
 struct d3dx_pres_ins;
+struct d3dx_pres_float_ins;
 
 struct d3dx_preshader
 {
@@ -284,6 +289,8 @@ struct d3dx_preshader
 
     unsigned int ins_count;
     struct d3dx_pres_ins *ins;
+    struct d3dx_pres_float_ins *program;
+    float *float_immediates;
 
     struct d3dx_const_tab inputs;
 };
@@ -1216,6 +1216,125 @@ static int __cdecl compare_vertex_keys(const void *a, const void *b)
     return left->key < right->key ? -1 : 1;
 }
 
+static int __cdecl compare_dwords(const void *a, const void *b)
+{
+    const DWORD *left = a;
+    const DWORD *right = b;
+    return *left < *right ? -1 : *left > *right;
+}
+
+/* Coincident vertices are found through a spatial hash. With a positive
+ * epsilon, space is divided into cells twice as large as epsilon, so that
+ * vertices within epsilon of each other are always in the same or in
+ * neighbouring cells. With a zero epsilon, vertices are hashed by their exact
+ * position. */
+struct vertex_hash
+{
+    float scale;
+    int range;
+    DWORD mask;
+    DWORD *heads;
+    DWORD *next;
+};
+
+static INT64 vertex_hash_coord(const struct vertex_hash *hash, float value)
+{
+    union
+    {
+        float f;
+        DWORD d;
+    } u;
+    float cell;
+
+    if (!hash->range)
+    {
+        /* Make -0.0f and 0.0f hash the same. */
+        u.f = value + 0.0f;
+        return u.d;
+    }
+
+    cell = floorf(value * hash->scale);
+    if (cell != cell)
+        return 0;
+    if (cell < -1e15f)
+        cell = -1e15f;
+    else if (cell > 1e15f)
+        cell = 1e15f;
+    return (INT64)cell;
+}
+
+static DWORD vertex_hash_bucket(const struct vertex_hash *hash, INT64 x, INT64 y, INT64 z)
+{
+    UINT64 h = (UINT64)x * 73856093u ^ (UINT64)y * 19349663u ^ (UINT64)z * 83492791u;
+
+    return (h ^ (h >> 32)) & hash->mask;
+}
+
+static DWORD vertex_hash_get_bucket(const struct vertex_hash *hash, const D3DXVECTOR3 *v)
+{
+    return vertex_hash_bucket(hash, vertex_hash_coord(hash, v->x),
+            vertex_hash_coord(hash, v->y), vertex_hash_coord(hash, v->z));
+}
+
+/* Gathers the sorted positions of vertices after "index" that are coincident
+ * with it, in increasing order. This is the same set of vertices a linear
+ * scan of the sorted array would find. */
+static DWORD vertex_hash_find_coincident(const struct vertex_hash *hash, const struct vertex_metadata *sorted_vertices,
+        const DWORD *sorted_positions, const BYTE *vertices, DWORD vertex_size, DWORD index, float epsilon,
+        DWORD *coincident)
+{
+    const struct vertex_metadata *sorted_vertex_a = &sorted_vertices[index];
+    const D3DXVECTOR3 *vertex_a = (const D3DXVECTOR3 *)(vertices + sorted_vertex_a->vertex_index * vertex_size);
+    DWORD buckets[27], bucket_count = 0, count = 0, bucket, vertex_index, k;
+    INT64 x, y, z;
+    int dx, dy, dz;
+
+    x = vertex_hash_coord(hash, vertex_a->x);
+    y = vertex_hash_coord(hash, vertex_a->y);
+    z = vertex_hash_coord(hash, vertex_a->z);
+
+    for (dz = -hash->range; dz <= hash->range; ++dz)
+    {
+        for (dy = -hash->range; dy <= hash->range; ++dy)
+        {
+            for (dx = -hash->range; dx <= hash->range; ++dx)
+            {
+                bucket = vertex_hash_bucket(hash, x + dx, y + dy, z + dz);
+                for (k = 0; k < bucket_count; ++k)
+                {
+                    if (buckets[k] == bucket)
+                        break;
+                }
+                if (k < bucket_count)
+                    continue;
+                buckets[bucket_count++] = bucket;
+
+                for (vertex_index = hash->heads[bucket]; vertex_index != ~0u; vertex_index = hash->next[vertex_index])
+                {
+                    const struct vertex_metadata *sorted_vertex_b;
+                    const D3DXVECTOR3 *vertex_b;
+
+                    if (sorted_positions[vertex_index] <= index)
+                        continue;
+                    sorted_vertex_b = &sorted_vertices[sorted_positions[vertex_index]];
+                    if (sorted_vertex_b->key - sorted_vertex_a->key > epsilon * 3.0f)
+                        continue;
+                    vertex_b = (const D3DXVECTOR3 *)(vertices + vertex_index * vertex_size);
+                    if (fabsf(vertex_a->x - vertex_b->x) <= epsilon &&
+                        fabsf(vertex_a->y - vertex_b->y) <= epsilon &&
+                        fabsf(vertex_a->z - vertex_b->z) <= epsilon)
+                        coincident[count++] = sorted_positions[vertex_index];
+                }
+            }
+        }
+    }
+
+    if (count > 1)
+        qsort(coincident, count, sizeof(*coincident), compare_dwords);
+
+    return count;
+}
+
 static HRESULT WINAPI d3dx9_mesh_GenerateAdjacency(ID3DXMesh *iface, float epsilon, DWORD *adjacency)
 {
     struct d3dx9_mesh *This = impl_from_ID3DXMesh(iface);
@@ -1229,21 +1348,31 @@ static HRESULT WINAPI d3dx9_mesh_GenerateAdjacency(ID3DXMesh *iface, float epsil
     /* shared_indices links together identical indices in the index buffer so
      * that adjacency checks can be limited to faces sharing a vertex */
     DWORD *shared_indices = NULL;
+    DWORD *sorted_positions, *coincident;
+    struct vertex_hash hash;
     const FLOAT epsilon_sq = epsilon * epsilon;
-    DWORD i;
+    DWORD i, bucket_count;
 
     TRACE("iface %p, epsilon %.8e, adjacency %p.\n", iface, epsilon, adjacency);
 
     if (!adjacency)
         return D3DERR_INVALIDCALL;
 
-    buffer_size = This->numfaces * 3 * sizeof(*shared_indices) + This->numvertices * sizeof(*sorted_vertices);
+    for (bucket_count = 1; bucket_count < This->numvertices; bucket_count <<= 1)
+        ;
+
+    buffer_size = This->numfaces * 3 * sizeof(*shared_indices) + This->numvertices * sizeof(*sorted_vertices)
+            + This->numvertices * 3 * sizeof(DWORD) + bucket_count * sizeof(DWORD);
     if (!(This->options & D3DXMESH_32BIT))
         buffer_size += This->numfaces * 3 * sizeof(*indices);
     shared_indices = HeapAlloc(GetProcessHeap(), 0, buffer_size);
     if (!shared_indices)
         return E_OUTOFMEMORY;
     sorted_vertices = (struct vertex_metadata*)(shared_indices + This->numfaces * 3);
+    sorted_positions = (DWORD *)(sorted_vertices + This->numvertices);
+    coincident = sorted_positions + This->numvertices;
+    hash.next = coincident + This->numvertices;
+    hash.heads = hash.next + This->numvertices;
 
     hr = iface->lpVtbl->LockVertexBuffer(iface, D3DLOCK_READONLY, (void**)&vertices);
     if (FAILED(hr)) goto cleanup;
@@ -1252,7 +1381,7 @@ static HRESULT WINAPI d3dx9_mesh_GenerateAdjacency(ID3DXMesh *iface, float epsil
 
     if (!(This->options & D3DXMESH_32BIT)) {
         const WORD *word_indices = (const WORD*)indices;
-        DWORD *dword_indices = (DWORD*)(sorted_vertices + This->numvertices);
+        DWORD *dword_indices = hash.heads + bucket_count;
         indices = dword_indices;
         for (i = 0; i < This->numfaces * 3; i++)
             *dword_indices++ = *word_indices++;
@@ -1273,13 +1402,31 @@ static HRESULT WINAPI d3dx9_mesh_GenerateAdjacency(ID3DXMesh *iface, float epsil
     }
     qsort(sorted_vertices, This->numvertices, sizeof(*sorted_vertices), compare_vertex_keys);
 
+    hash.range = epsilon > 0.0f ? 1 : 0;
+    hash.scale = 0.5f / epsilon;
+    /* Put everything in a single cell if the cell size can't be represented. */
+    if (!(hash.scale <= FLT_MAX))
+        hash.scale = 0.0f;
+    hash.mask = bucket_count - 1;
+    memset(hash.heads, 0xff, bucket_count * sizeof(*hash.heads));
+    for (i = 0; i < This->numvertices; i++) {
+        DWORD bucket = vertex_hash_get_bucket(&hash, (D3DXVECTOR3 *)(vertices + vertex_size * i));
+        hash.next[i] = hash.heads[bucket];
+        hash.heads[bucket] = i;
+        sorted_positions[sorted_vertices[i].vertex_index] = i;
+    }
+
     for (i = 0; i < This->numvertices; i++) {
         struct vertex_metadata *sorted_vertex_a = &sorted_vertices[i];
-        D3DXVECTOR3 *vertex_a = (D3DXVECTOR3*)(vertices + sorted_vertex_a->vertex_index * vertex_size);
         DWORD shared_index_a = sorted_vertex_a->first_shared_index;
+        DWORD coincident_count = 0;
+
+        if (shared_index_a != -1 && epsilon >= 0.0f)
+            coincident_count = vertex_hash_find_coincident(&hash, sorted_vertices, sorted_positions,
+                    vertices, vertex_size, i, epsilon, coincident);
 
         while (shared_index_a != -1) {
-            DWORD j = i;
+            DWORD j = 0;
             DWORD shared_index_b = shared_indices[shared_index_a];
             struct vertex_metadata *sorted_vertex_b = sorted_vertex_a;
 
@@ -1326,26 +1473,10 @@ static HRESULT WINAPI d3dx9_mesh_GenerateAdjacency(ID3DXMesh *iface, float epsil
 
                     shared_index_b = shared_indices[shared_index_b];
                 }
-                while (++j < This->numvertices) {
-                    D3DXVECTOR3 *vertex_b;
-
-                    sorted_vertex_b++;
-                    if (sorted_vertex_b->key - sorted_vertex_a->key > epsilon * 3.0f) {
-                        /* no more coincident vertices to try */
-                        j = This->numvertices;
-                        break;
-                    }
-                    /* check for coincidence */
-                    vertex_b = (D3DXVECTOR3*)(vertices + sorted_vertex_b->vertex_index * vertex_size);
-                    if (fabsf(vertex_a->x - vertex_b->x) <= epsilon &&
-                        fabsf(vertex_a->y - vertex_b->y) <= epsilon &&
-                        fabsf(vertex_a->z - vertex_b->z) <= epsilon)
-                    {
-                        break;
-                    }
-                }
-                if (j >= This->numvertices)
+                /* move on to the next coincident vertex */
+                if (j >= coincident_count)
                     break;
+                sorted_vertex_b = &sorted_vertices[coincident[j++]];
                 shared_index_b = sorted_vertex_b->first_shared_index;
             }
 
@@ -7014,6 +7145,9 @@ HRESULT WINAPI D3DXWeldVertices(ID3DXMesh *mesh, DWORD flags, const D3DXWELDEPSI
     struct d3dx9_mesh *This = impl_from_ID3DXMesh(mesh);
     DWORD *vertex_face_map = NULL;
     BYTE *vertices = NULL;
+    FLOAT component_epsilons[MAX_FVF_DECL_SIZE];
+    DWORD num_vertex_components, vertex_size;
+    D3DVERTEXELEMENT9 *decl_ptr;
 
     TRACE("mesh %p, flags %#x, epsilons %p, adjacency %p, adjacency_out %p, face_remap_out %p, vertex_remap_out %p.\n",
             mesh, flags, epsilons, adjacency, adjacency_out, face_remap_out, vertex_remap_out);
@@ -7107,40 +7241,37 @@ HRESULT WINAPI D3DXWeldVertices(ID3DXMesh *mesh, DWORD flags, const D3DXWELDEPSI
          * belong to the same attribute group. Otherwise the vertex components
          * that are within epsilon are set to the same value.
          */
+        vertex_size = mesh->lpVtbl->GetNumBytesPerVertex(mesh);
+        for (decl_ptr = This->cached_declaration, num_vertex_components = 0; decl_ptr->Stream != 0xFF;
+                decl_ptr++, num_vertex_components++)
+            component_epsilons[num_vertex_components] = get_component_epsilon(decl_ptr, epsilons);
+
         for (i = 0; i < 3 * This->numfaces; i++)
         {
-            D3DVERTEXELEMENT9 *decl_ptr;
-            DWORD vertex_size = mesh->lpVtbl->GetNumBytesPerVertex(mesh);
-            DWORD num_vertex_components;
-            INT matches = 0;
-            BOOL all_match;
             DWORD index = read_ib(indices, indices_are_32bit, i);
+            DWORD rep_index = point_reps[index];
+            DWORD matches = 0, c;
 
-            for (decl_ptr = This->cached_declaration, num_vertex_components = 0; decl_ptr->Stream != 0xFF; decl_ptr++, num_vertex_components++)
+            /* Don't weld self */
+            if (index == rep_index)
+                continue;
+
+            for (decl_ptr = This->cached_declaration, c = 0; c < num_vertex_components; decl_ptr++, c++)
             {
                 BYTE *to = &vertices[vertex_size*index + decl_ptr->Offset];
-                BYTE *from = &vertices[vertex_size*point_reps[index] + decl_ptr->Offset];
-                FLOAT epsilon = get_component_epsilon(decl_ptr, epsilons);
-
-                /* Don't weld self */
-                if (index == point_reps[index])
-                {
-                    matches++;
-                    continue;
-                }
+                BYTE *from = &vertices[vertex_size*rep_index + decl_ptr->Offset];
 
-                if (weld_component(to, from, decl_ptr->Type, epsilon))
+                if (weld_component(to, from, decl_ptr->Type, component_epsilons[c]))
                     matches++;
             }
 
-            all_match = (num_vertex_components == matches);
-            if (all_match && !(flags & D3DXWELDEPSILONS_DONOTREMOVEVERTICES))
+            if (num_vertex_components == matches && !(flags & D3DXWELDEPSILONS_DONOTREMOVEVERTICES))
             {
                 DWORD to_face = vertex_face_map[index];
-                DWORD from_face = vertex_face_map[point_reps[index]];
+                DWORD from_face = vertex_face_map[rep_index];
                 if(attributes[to_face] != attributes[from_face] && !(flags & D3DXWELDEPSILONS_DONOTSPLIT))
                     continue;
-                write_ib(indices, indices_are_32bit, i, point_reps[index]);
+                write_ib(indices, indices_are_32bit, i, rep_index);
             }
         }
         mesh->lpVtbl->UnlockVertexBuffer(mesh);
@@ -7184,6 +7315,184 @@ cleanup:
     return hr;
 }
 
+/* Vertex cache optimisation, after Tom Forsyth's "Linear-Speed Vertex Cache
+ * Optimisation". Faces are emitted greedily, picking the face whose vertices
+ * score best, based on their position in a simulated LRU cache and on how
+ * many faces still use them. */
+#define FACE_CACHE_SIZE 32
+
+struct face_cache_vertex
+{
+    float score;
+    int cache_position;
+    DWORD face_count;
+    DWORD remaining_faces;
+    DWORD first_face;
+};
+
+static float face_cache_vertex_score(const struct face_cache_vertex *vertex)
+{
+    float score = 0.0f;
+
+    if (!vertex->remaining_faces)
+        return -1.0f;
+
+    if (vertex->cache_position >= 0)
+    {
+        if (vertex->cache_position < 3)
+            score = 0.75f;
+        else
+            score = powf(1.0f - (vertex->cache_position - 3) * (1.0f / (FACE_CACHE_SIZE - 3)), 1.5f);
+    }
+
+    return score + 2.0f / sqrtf(vertex->remaining_faces);
+}
+
+static HRESULT optimize_faces_for_vertex_cache(const DWORD *indices, UINT num_faces, UINT num_vertices,
+        DWORD *face_order)
+{
+    DWORD cache[FACE_CACHE_SIZE + 3], new_cache[FACE_CACHE_SIZE + 3];
+    DWORD cache_count = 0, new_cache_count, scan_position = 0;
+    struct face_cache_vertex *vertices;
+    DWORD *vertex_faces;
+    float *face_scores, best_score;
+    DWORD i, j, k, face, best_face;
+    BOOL *face_added;
+
+    vertices = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, num_vertices * sizeof(*vertices));
+    vertex_faces = HeapAlloc(GetProcessHeap(), 0, 3 * num_faces * sizeof(*vertex_faces));
+    face_scores = HeapAlloc(GetProcessHeap(), 0, num_faces * sizeof(*face_scores));
+    face_added = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, num_faces * sizeof(*face_added));
+    if (!vertices || !vertex_faces || !face_scores || !face_added)
+    {
+        HeapFree(GetProcessHeap(), 0, vertices);
+        HeapFree(GetProcessHeap(), 0, vertex_faces);
+        HeapFree(GetProcessHeap(), 0, face_scores);
+        HeapFree(GetProcessHeap(), 0, face_added);
+        return E_OUTOFMEMORY;
+    }
+
+    /* Build a list of faces for each vertex. */
+    for (i = 0; i < 3 * num_faces; ++i)
+        ++vertices[indices[i]].face_count;
+    for (i = 0, j = 0; i < num_vertices; ++i)
+    {
+        vertices[i].first_face = j;
+        vertices[i].remaining_faces = 0;
+        vertices[i].cache_position = -1;
+        j += vertices[i].face_count;
+    }
+    for (i = 0; i < 3 * num_faces; ++i)
+    {
+        struct face_cache_vertex *vertex = &vertices[indices[i]];
+        vertex_faces[vertex->first_face + vertex->remaining_faces++] = i / 3;
+    }
+
+    for (i = 0; i < num_vertices; ++i)
+        vertices[i].score = face_cache_vertex_score(&vertices[i]);
+
+    best_face = 0;
+    best_score = -1.0f;
+    for (i = 0; i < num_faces; ++i)
+    {
+        face_scores[i] = vertices[indices[3 * i]].score + vertices[indices[3 * i + 1]].score
+                + vertices[indices[3 * i + 2]].score;
+        if (face_scores[i] > best_score)
+        {
+            best_score = face_scores[i];
+            best_face = i;
+        }
+    }
+
+    for (i = 0; i < num_faces; ++i)
+    {
+        if (best_score < 0.0f)
+        {
+            /* Nothing in the cache is connected to a remaining face, pick the
+             * next one in the original order. */
+            while (face_added[scan_position])
+                ++scan_position;
+            best_face = scan_position;
+        }
+
+        face = best_face;
+        face_added[face] = TRUE;
+        face_order[i] = face;
+
+        /* Remove the face from its vertices' lists, and move the vertices to
+         * the front of the cache. */
+        new_cache_count = 0;
+        for (j = 0; j < 3; ++j)
+        {
+            DWORD index = indices[3 * face + j];
+            struct face_cache_vertex *vertex = &vertices[index];
+            DWORD *faces = &vertex_faces[vertex->first_face];
+
+            for (k = 0; k < vertex->remaining_faces; ++k)
+            {
+                if (faces[k] == face)
+                {
+                    faces[k] = faces[--vertex->remaining_faces];
+                    break;
+                }
+            }
+
+            for (k = 0; k < new_cache_count; ++k)
+            {
+                if (new_cache[k] == index)
+                    break;
+            }
+            if (k == new_cache_count)
+                new_cache[new_cache_count++] = index;
+        }
+        for (j = 0; j < cache_count; ++j)
+        {
+            DWORD index = cache[j];
+
+            if (index == new_cache[0] || (new_cache_count > 1 && index == new_cache[1])
+                    || (new_cache_count > 2 && index == new_cache[2]))
+                continue;
+            new_cache[new_cache_count++] = index;
+        }
+
+        /* Update vertex scores, then the scores of faces using them. */
+        for (j = 0; j < new_cache_count; ++j)
+            vertices[new_cache[j]].cache_position = j < FACE_CACHE_SIZE ? j : -1;
+        for (j = 0; j < new_cache_count; ++j)
+            vertices[new_cache[j]].score = face_cache_vertex_score(&vertices[new_cache[j]]);
+
+        best_score = -1.0f;
+        for (j = 0; j < new_cache_count; ++j)
+        {
+            const struct face_cache_vertex *vertex = &vertices[new_cache[j]];
+            const DWORD *faces = &vertex_faces[vertex->first_face];
+
+            for (k = 0; k < vertex->remaining_faces; ++k)
+            {
+                DWORD f = faces[k];
+
+                face_scores[f] = vertices[indices[3 * f]].score + vertices[indices[3 * f + 1]].score
+                        + vertices[indices[3 * f + 2]].score;
+                if (face_scores[f] > best_score || (face_scores[f] == best_score && f < best_face))
+                {
+                    best_score = face_scores[f];
+                    best_face = f;
+                }
+            }
+        }
+
+        cache_count = min(new_cache_count, FACE_CACHE_SIZE);
+        memcpy(cache, new_cache, cache_count * sizeof(*cache));
+    }
+
+    HeapFree(GetProcessHeap(), 0, vertices);
+    HeapFree(GetProcessHeap(), 0, vertex_faces);
+    HeapFree(GetProcessHeap(), 0, face_scores);
+    HeapFree(GetProcessHeap(), 0, face_added);
+
+    return D3D_OK;
+}
+
 /*************************************************************************
  * D3DXOptimizeFaces    (D3DX9_36.@)
  *
@@ -7200,52 +7509,59 @@ cleanup:
  *   Success: D3D_OK.
  *   Failure: D3DERR_INVALIDCALL.
  *
- * BUGS
- *   The face re-ordering does not use the vertex cache optimally.
- *
  */
 HRESULT WINAPI D3DXOptimizeFaces(const void *indices, UINT num_faces,
         UINT num_vertices, BOOL indices_are_32bit, DWORD *face_remap)
 {
-    UINT i;
-    UINT j = num_faces - 1;
     UINT limit_16_bit = 2 << 15; /* According to MSDN */
-    HRESULT hr = D3D_OK;
+    DWORD *dword_indices, *face_order;
+    HRESULT hr;
+    UINT i;
 
-    FIXME("indices %p, num_faces %u, num_vertices %u, indices_are_32bit %#x, face_remap %p semi-stub. "
-            "Face order will not be optimal.\n",
+    TRACE("indices %p, num_faces %u, num_vertices %u, indices_are_32bit %#x, face_remap %p.\n",
             indices, num_faces, num_vertices, indices_are_32bit, face_remap);
 
     if (!indices_are_32bit && num_faces >= limit_16_bit)
     {
         WARN("Number of faces must be less than %d when using 16-bit indices.\n",
              limit_16_bit);
-        hr = D3DERR_INVALIDCALL;
-        goto error;
+        return D3DERR_INVALIDCALL;
     }
 
     if (!face_remap)
     {
         WARN("Face remap pointer is NULL.\n");
-        hr = D3DERR_INVALIDCALL;
-        goto error;
+        return D3DERR_INVALIDCALL;
     }
 
-    /* The faces are drawn in reverse order for simple meshes. This ordering
-     * is not optimal for complicated meshes, but will not break anything
-     * either. The ordering should be changed to take advantage of the vertex
-     * cache on the graphics card.
-     *
-     * TODO Re-order to take advantage of vertex cache.
-     */
-    for (i = 0; i < num_faces; i++)
+    if (!num_faces)
+        return D3D_OK;
+
+    if (!(dword_indices = HeapAlloc(GetProcessHeap(), 0, 3 * num_faces * sizeof(*dword_indices) + num_faces * sizeof(*face_order))))
+        return E_OUTOFMEMORY;
+    face_order = dword_indices + 3 * num_faces;
+
+    for (i = 0; i < 3 * num_faces; ++i)
     {
-        face_remap[i] = j--;
+        dword_indices[i] = read_ib((void *)indices, indices_are_32bit, i);
+        if (dword_indices[i] >= num_vertices)
+        {
+            WARN("Index %u is out of range.\n", dword_indices[i]);
+            HeapFree(GetProcessHeap(), 0, dword_indices);
+            return D3DERR_INVALIDCALL;
+        }
     }
 
-    return D3D_OK;
+    if (SUCCEEDED(hr = optimize_faces_for_vertex_cache(dword_indices, num_faces, num_vertices, face_order)))
+    {
+        /* Native emits simple meshes in reverse order. Reversing the optimised
+         * order matches that, and the cache behaves the same either way. */
+        for (i = 0; i < num_faces; ++i)
+            face_remap[i] = face_order[num_faces - 1 - i];
+    }
+
+    HeapFree(GetProcessHeap(), 0, dword_indices);
 
-error:
     return hr;
 }
 
@@ -7282,6 +7598,86 @@ static D3DXVECTOR3 read_vec3(BYTE *vertices, const D3DVERTEXELEMENT9 *declaratio
     return vec3;
 }
 
+struct face_normals_context
+{
+    void *indices;
+    BOOL indices_are_32bit;
+    BYTE *vertices;
+    const D3DVERTEXELEMENT9 *position_declaration;
+    DWORD vertex_stride;
+    DWORD weighting_method;
+    D3DXVECTOR3 *corner_normals;
+};
+
+/* Computes the weighted face normal contribution of each face corner. */
+static void compute_face_normals(void *context, unsigned int start, unsigned int end)
+{
+    const struct face_normals_context *ctx = context;
+    void *indices = ctx->indices;
+    BOOL indices_are_32bit = ctx->indices_are_32bit;
+    BYTE *vertices = ctx->vertices;
+    const D3DVERTEXELEMENT9 *position_declaration = ctx->position_declaration;
+    DWORD vertex_stride = ctx->vertex_stride;
+    unsigned int i, j;
+
+    for (i = start; i < end; i++)
+    {
+        float denominator, weights[3];
+        D3DXVECTOR3 a, b, cross, face_normal;
+        const DWORD face_indices[3] =
+        {
+            read_ib(indices, indices_are_32bit, 3 * i + 0),
+            read_ib(indices, indices_are_32bit, 3 * i + 1),
+            read_ib(indices, indices_are_32bit, 3 * i + 2)
+        };
+        const D3DXVECTOR3 v0 = read_vec3(vertices, position_declaration, vertex_stride, face_indices[0]);
+        const D3DXVECTOR3 v1 = read_vec3(vertices, position_declaration, vertex_stride, face_indices[1]);
+        const D3DXVECTOR3 v2 = read_vec3(vertices, position_declaration, vertex_stride, face_indices[2]);
+
+        D3DXVec3Cross(&cross, D3DXVec3Subtract(&a, &v0, &v1), D3DXVec3Subtract(&b, &v0, &v2));
+
+        switch (ctx->weighting_method)
+        {
+            case D3DXTANGENT_WEIGHT_EQUAL:
+                weights[0] = weights[1] = weights[2] = 1.0f;
+                break;
+            case D3DXTANGENT_WEIGHT_BY_AREA:
+                weights[0] = weights[1] = weights[2] = D3DXVec3Length(&cross);
+                break;
+            default:
+                /* weight by angle */
+                denominator = D3DXVec3Length(&a) * D3DXVec3Length(&b);
+                if (!denominator)
+                    weights[0] = 0.0f;
+                else
+                    weights[0] = acosf(D3DXVec3Dot(&a, &b) / denominator);
+
+                D3DXVec3Subtract(&a, &v1, &v0);
+                D3DXVec3Subtract(&b, &v1, &v2);
+                denominator = D3DXVec3Length(&a) * D3DXVec3Length(&b);
+                if (!denominator)
+                    weights[1] = 0.0f;
+                else
+                    weights[1] = acosf(D3DXVec3Dot(&a, &b) / denominator);
+
+                D3DXVec3Subtract(&a, &v2, &v0);
+                D3DXVec3Subtract(&b, &v2, &v1);
+                denominator = D3DXVec3Length(&a) * D3DXVec3Length(&b);
+                if (!denominator)
+                    weights[2] = 0.0f;
+                else
+                    weights[2] = acosf(D3DXVec3Dot(&a, &b) / denominator);
+
+                break;
+        }
+
+        D3DXVec3Normalize(&face_normal, &cross);
+
+        for (j = 0; j < 3; j++)
+            D3DXVec3Scale(&ctx->corner_normals[3 * i + j], &face_normal, weights[j]);
+    }
+}
+
 /*************************************************************************
  * D3DXComputeTangentFrameEx    (D3DX9_36.@)
  */
@@ -7301,6 +7697,8 @@ HRESULT WINAPI D3DXComputeTangentFrameEx(ID3DXMesh *mesh, DWORD texture_in_seman
     D3DVERTEXELEMENT9 declaration[MAX_FVF_DECL_SIZE] = {D3DDECL_END()};
     D3DVERTEXELEMENT9 *position_declaration = NULL, *normal_declaration = NULL;
     DWORD weighting_method = options & (D3DXTANGENT_WEIGHT_EQUAL | D3DXTANGENT_WEIGHT_BY_AREA);
+    D3DXVECTOR3 *corner_normals = NULL;
+    struct face_normals_context ctx;
 
     TRACE("mesh %p, texture_in_semantic %u, texture_in_index %u, u_partial_out_semantic %u, u_partial_out_index %u, "
             "v_partial_out_semantic %u, v_partial_out_index %u, normal_out_semantic %u, normal_out_index %u, "
@@ -7417,67 +7815,30 @@ HRESULT WINAPI D3DXComputeTangentFrameEx(ID3DXMesh *mesh, DWORD texture_in_seman
         memcpy(normal, &default_vector, normal_size);
     }
 
-    for (i = 0; i < num_faces; i++)
+    if (!(corner_normals = HeapAlloc(GetProcessHeap(), 0, 3 * num_faces * sizeof(*corner_normals))))
     {
-        float denominator, weights[3];
-        D3DXVECTOR3 a, b, cross, face_normal;
-        const DWORD face_indices[3] =
-        {
-            read_ib(indices, indices_are_32bit, 3 * i + 0),
-            read_ib(indices, indices_are_32bit, 3 * i + 1),
-            read_ib(indices, indices_are_32bit, 3 * i + 2)
-        };
-        const D3DXVECTOR3 v0 = read_vec3(vertices, position_declaration, vertex_stride, face_indices[0]);
-        const D3DXVECTOR3 v1 = read_vec3(vertices, position_declaration, vertex_stride, face_indices[1]);
-        const D3DXVECTOR3 v2 = read_vec3(vertices, position_declaration, vertex_stride, face_indices[2]);
-
-        D3DXVec3Cross(&cross, D3DXVec3Subtract(&a, &v0, &v1), D3DXVec3Subtract(&b, &v0, &v2));
-
-        switch (weighting_method)
-        {
-            case D3DXTANGENT_WEIGHT_EQUAL:
-                weights[0] = weights[1] = weights[2] = 1.0f;
-                break;
-            case D3DXTANGENT_WEIGHT_BY_AREA:
-                weights[0] = weights[1] = weights[2] = D3DXVec3Length(&cross);
-                break;
-            default:
-                /* weight by angle */
-                denominator = D3DXVec3Length(&a) * D3DXVec3Length(&b);
-                if (!denominator)
-                    weights[0] = 0.0f;
-                else
-                    weights[0] = acosf(D3DXVec3Dot(&a, &b) / denominator);
-
-                D3DXVec3Subtract(&a, &v1, &v0);
-                D3DXVec3Subtract(&b, &v1, &v2);
-                denominator = D3DXVec3Length(&a) * D3DXVec3Length(&b);
-                if (!denominator)
-                    weights[1] = 0.0f;
-                else
-                    weights[1] = acosf(D3DXVec3Dot(&a, &b) / denominator);
-
-                D3DXVec3Subtract(&a, &v2, &v0);
-                D3DXVec3Subtract(&b, &v2, &v1);
-                denominator = D3DXVec3Length(&a) * D3DXVec3Length(&b);
-                if (!denominator)
-                    weights[2] = 0.0f;
-                else
-                    weights[2] = acosf(D3DXVec3Dot(&a, &b) / denominator);
-
-                break;
-        }
+        hr = E_OUTOFMEMORY;
+        goto done;
+    }
 
-        D3DXVec3Normalize(&face_normal, &cross);
+    ctx.indices = indices;
+    ctx.indices_are_32bit = indices_are_32bit;
+    ctx.vertices = vertices;
+    ctx.position_declaration = position_declaration;
+    ctx.vertex_stride = vertex_stride;
+    ctx.weighting_method = weighting_method;
+    ctx.corner_normals = corner_normals;
+    d3dx_parallel_for(num_faces, 4096, compute_face_normals, &ctx);
 
+    /* Accumulate in face order, so that results don't depend on scheduling. */
+    for (i = 0; i < num_faces; i++)
+    {
         for (j = 0; j < 3; j++)
         {
-            D3DXVECTOR3 normal;
-            DWORD rep_index = point_reps[face_indices[j]];
+            DWORD rep_index = point_reps[read_ib(indices, indices_are_32bit, 3 * i + j)];
             D3DXVECTOR3 *rep_normal = vertex_element_vec3(vertices, normal_declaration, vertex_stride, rep_index);
 
-            D3DXVec3Scale(&normal, &face_normal, weights[j]);
-            D3DXVec3Add(rep_normal, rep_normal, &normal);
+            D3DXVec3Add(rep_normal, rep_normal, &corner_normals[3 * i + j]);
         }
     }
 
@@ -7503,6 +7864,7 @@ done:
         mesh->lpVtbl->UnlockIndexBuffer(mesh);
 
     HeapFree(GetProcessHeap(), 0, point_reps);
+    HeapFree(GetProcessHeap(), 0, corner_normals);
 
     return hr;
 }
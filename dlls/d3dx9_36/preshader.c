@@ -257,6 +257,21 @@ struct d3dx_pres_ins
     struct d3dx_pres_operand output;
 };
 
+/* Instructions which only read and write float registers without relative
+ * addressing are compiled at load time to direct register pointers. The
+ * operations handled this way give the same result in single precision as
+ * the double precision path rounded to float, so the latter is only used for
+ * the remaining instructions, referenced by "ins". */
+struct d3dx_pres_float_ins
+{
+    const struct d3dx_pres_ins *ins;
+    enum pres_ops op;
+    unsigned int component_count;
+    unsigned int scalar_stride;
+    float *output;
+    const float *inputs[3];
+};
+
 struct const_upload_info
 {
     BOOL transpose;
@@ -1220,6 +1235,108 @@ static HRESULT parse_preshader(struct d3dx_preshader *pres, unsigned int *ptr, u
     return D3D_OK;
 }
 
+static BOOL is_float_ins_op(enum pres_ops op)
+{
+    switch (op)
+    {
+        case PRESHADER_OP_MOV:
+        case PRESHADER_OP_NEG:
+        case PRESHADER_OP_RCP:
+        case PRESHADER_OP_FRC:
+        case PRESHADER_OP_MIN:
+        case PRESHADER_OP_MAX:
+        case PRESHADER_OP_LT:
+        case PRESHADER_OP_GE:
+        case PRESHADER_OP_ADD:
+        case PRESHADER_OP_MUL:
+        case PRESHADER_OP_CMP:
+        case PRESHADER_OP_DOT:
+            return TRUE;
+        default:
+            return FALSE;
+    }
+}
+
+static const float *get_float_operand(struct d3dx_preshader *pres, const struct d3dx_pres_operand *opr,
+        unsigned int count)
+{
+    const double *immediates;
+    unsigned int i;
+
+    if (opr->index_reg.table != PRES_REGTAB_COUNT)
+        return NULL;
+
+    if (opr->reg.table == PRES_REGTAB_IMMED)
+    {
+        /* Immediates which can't be represented exactly in single precision
+         * need the double precision path. */
+        immediates = (const double *)pres->regs.tables[PRES_REGTAB_IMMED] + opr->reg.offset;
+        for (i = 0; i < count; ++i)
+        {
+            if ((float)immediates[i] != immediates[i])
+                return NULL;
+        }
+        return pres->float_immediates + opr->reg.offset;
+    }
+
+    if (table_info[opr->reg.table].type != PRES_VT_FLOAT)
+        return NULL;
+    return (const float *)pres->regs.tables[opr->reg.table] + opr->reg.offset;
+}
+
+static HRESULT compile_preshader(struct d3dx_preshader *pres)
+{
+    unsigned int i, j, immediate_count, compiled_count = 0;
+    const double *immediates;
+
+    if (!pres->ins_count)
+        return D3D_OK;
+
+    if (!(pres->program = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, sizeof(*pres->program) * pres->ins_count)))
+        return E_OUTOFMEMORY;
+
+    immediate_count = get_offset_reg(PRES_REGTAB_IMMED, pres->regs.table_sizes[PRES_REGTAB_IMMED]);
+    if (immediate_count)
+    {
+        if (!(pres->float_immediates = HeapAlloc(GetProcessHeap(), 0,
+                sizeof(*pres->float_immediates) * immediate_count)))
+            return E_OUTOFMEMORY;
+        immediates = pres->regs.tables[PRES_REGTAB_IMMED];
+        for (i = 0; i < immediate_count; ++i)
+            pres->float_immediates[i] = immediates[i];
+    }
+
+    for (i = 0; i < pres->ins_count; ++i)
+    {
+        const struct d3dx_pres_ins *ins = &pres->ins[i];
+        struct d3dx_pres_float_ins *fins = &pres->program[i];
+        unsigned int input_count = pres_op_info[ins->op].input_count;
+
+        fins->ins = ins;
+        if (!is_float_ins_op(ins->op) || table_info[ins->output.reg.table].type != PRES_VT_FLOAT)
+            continue;
+
+        for (j = 0; j < input_count; ++j)
+        {
+            if (!(fins->inputs[j] = get_float_operand(pres, &ins->inputs[j],
+                    ins->scalar_op && !j ? 1 : ins->component_count)))
+                break;
+        }
+        if (j < input_count)
+            continue;
+
+        fins->ins = NULL;
+        fins->op = ins->op;
+        fins->component_count = ins->component_count;
+        fins->scalar_stride = ins->scalar_op ? 0 : 1;
+        fins->output = (float *)pres->regs.tables[ins->output.reg.table] + ins->output.reg.offset;
+        ++compiled_count;
+    }
+    TRACE("Compiled %u of %u preshader instructions.\n", compiled_count, pres->ins_count);
+
+    return D3D_OK;
+}
+
 HRESULT d3dx_create_param_eval(struct d3dx_effect *effect, void *byte_code, unsigned int byte_code_size,
         D3DXPARAMETER_TYPE type, struct d3dx_param_eval **peval_out, ULONG64 *version_counter,
         const char **skip_constants, unsigned int skip_constants_count)
@@ -1306,6 +1423,9 @@ HRESULT d3dx_create_param_eval(struct d3dx_effect *effect, void *byte_code, unsi
             goto err_out;
     }
 
+    if (FAILED(ret = compile_preshader(&peval->pres)))
+        goto err_out;
+
     if (TRACE_ON(d3dx))
     {
         dump_bytecode(byte_code, byte_code_size);
@@ -1340,6 +1460,8 @@ static void d3dx_free_const_tab(struct d3dx_const_tab *ctab)
 static void d3dx_free_preshader(struct d3dx_preshader *pres)
 {
     HeapFree(GetProcessHeap(), 0, pres->ins);
+    HeapFree(GetProcessHeap(), 0, pres->program);
+    HeapFree(GetProcessHeap(), 0, pres->float_immediates);
 
     regstore_free_tables(&pres->regs);
     d3dx_free_const_tab(&pres->inputs);
@@ -1646,49 +1768,127 @@ static void exec_set_arg(struct d3dx_regstore *rs, const struct d3dx_pres_reg *r
 }
 
 #define ARGS_ARRAY_SIZE 8
-static HRESULT execute_preshader(struct d3dx_preshader *pres)
+static HRESULT execute_pres_ins(struct d3dx_regstore *rs, const struct d3dx_pres_ins *ins)
 {
-    unsigned int i, j, k;
+    const struct op_info *oi = &pres_op_info[ins->op];
     double args[ARGS_ARRAY_SIZE];
+    unsigned int j, k;
     double res;
 
-    for (i = 0; i < pres->ins_count; ++i)
+    if (oi->func_all_comps)
     {
-        const struct d3dx_pres_ins *ins;
-        const struct op_info *oi;
+        if (oi->input_count * ins->component_count > ARGS_ARRAY_SIZE)
+        {
+            FIXME("Too many arguments (%u) for one instruction.\n", oi->input_count * ins->component_count);
+            return E_FAIL;
+        }
+        for (k = 0; k < oi->input_count; ++k)
+            for (j = 0; j < ins->component_count; ++j)
+                args[k * ins->component_count + j] = exec_get_arg(rs, &ins->inputs[k],
+                        ins->scalar_op && !k ? 0 : j);
+        res = oi->func(args, ins->component_count);
 
-        ins = &pres->ins[i];
-        oi = &pres_op_info[ins->op];
-        if (oi->func_all_comps)
+        /* only 'dot' instruction currently falls here */
+        exec_set_arg(rs, &ins->output.reg, 0, res);
+    }
+    else
+    {
+        for (j = 0; j < ins->component_count; ++j)
         {
-            if (oi->input_count * ins->component_count > ARGS_ARRAY_SIZE)
-            {
-                FIXME("Too many arguments (%u) for one instruction.\n", oi->input_count * ins->component_count);
-                return E_FAIL;
-            }
             for (k = 0; k < oi->input_count; ++k)
-                for (j = 0; j < ins->component_count; ++j)
-                    args[k * ins->component_count + j] = exec_get_arg(&pres->regs, &ins->inputs[k],
-                            ins->scalar_op && !k ? 0 : j);
+                args[k] = exec_get_arg(rs, &ins->inputs[k], ins->scalar_op && !k ? 0 : j);
             res = oi->func(args, ins->component_count);
-
-            /* only 'dot' instruction currently falls here */
-            exec_set_arg(&pres->regs, &ins->output.reg, 0, res);
-        }
-        else
-        {
-            for (j = 0; j < ins->component_count; ++j)
-            {
-                for (k = 0; k < oi->input_count; ++k)
-                    args[k] = exec_get_arg(&pres->regs, &ins->inputs[k], ins->scalar_op && !k ? 0 : j);
-                res = oi->func(args, ins->component_count);
-                exec_set_arg(&pres->regs, &ins->output.reg, j, res);
-            }
+            exec_set_arg(rs, &ins->output.reg, j, res);
         }
     }
     return D3D_OK;
 }
 
+static void execute_float_ins(const struct d3dx_pres_float_ins *ins)
+{
+    const float *a = ins->inputs[0], *b = ins->inputs[1], *c = ins->inputs[2];
+    unsigned int i, count = ins->component_count, s = ins->scalar_stride;
+    float *out = ins->output;
+    double sum;
+
+    /* Components are written in order, like on the generic path, so that
+     * instructions with overlapping operands give the same results. */
+    switch (ins->op)
+    {
+        case PRESHADER_OP_MOV:
+            for (i = 0; i < count; ++i)
+                out[i] = a[i * s];
+            break;
+        case PRESHADER_OP_NEG:
+            for (i = 0; i < count; ++i)
+                out[i] = -a[i * s];
+            break;
+        case PRESHADER_OP_RCP:
+            for (i = 0; i < count; ++i)
+                out[i] = 1.0f / a[i * s];
+            break;
+        case PRESHADER_OP_FRC:
+            for (i = 0; i < count; ++i)
+                out[i] = a[i * s] - floorf(a[i * s]);
+            break;
+        case PRESHADER_OP_MIN:
+            for (i = 0; i < count; ++i)
+                out[i] = fmin(a[i * s], b[i]);
+            break;
+        case PRESHADER_OP_MAX:
+            for (i = 0; i < count; ++i)
+                out[i] = fmax(a[i * s], b[i]);
+            break;
+        case PRESHADER_OP_LT:
+            for (i = 0; i < count; ++i)
+                out[i] = a[i * s] < b[i] ? 1.0f : 0.0f;
+            break;
+        case PRESHADER_OP_GE:
+            for (i = 0; i < count; ++i)
+                out[i] = a[i * s] >= b[i] ? 1.0f : 0.0f;
+            break;
+        case PRESHADER_OP_ADD:
+            for (i = 0; i < count; ++i)
+                out[i] = a[i * s] + b[i];
+            break;
+        case PRESHADER_OP_MUL:
+            for (i = 0; i < count; ++i)
+                out[i] = a[i * s] * b[i];
+            break;
+        case PRESHADER_OP_CMP:
+            for (i = 0; i < count; ++i)
+                out[i] = a[i * s] >= 0.0f ? b[i] : c[i];
+            break;
+        case PRESHADER_OP_DOT:
+            /* Accumulate in double precision like pres_dot(). */
+            sum = 0.0;
+            for (i = 0; i < count; ++i)
+                sum += (double)a[i * s] * b[i];
+            out[0] = sum;
+            break;
+        default:
+            assert(0);
+            break;
+    }
+}
+
+static HRESULT execute_preshader(struct d3dx_preshader *pres)
+{
+    unsigned int i;
+    HRESULT hr;
+
+    for (i = 0; i < pres->ins_count; ++i)
+    {
+        const struct d3dx_pres_float_ins *ins = &pres->program[i];
+
+        if (!ins->ins)
+            execute_float_ins(ins);
+        else if (FAILED(hr = execute_pres_ins(&pres->regs, ins->ins)))
+            return hr;
+    }
+    return D3D_OK;
+}
+
 static BOOL is_const_tab_input_dirty(struct d3dx_const_tab *ctab, ULONG64 update_version)
 {
     unsigned int i;
@@ -1745,11 +1945,18 @@ HRESULT d3dx_param_eval_set_shader_constants(ID3DXEffectStateManager *manager, s
     HRESULT hr;
     struct d3dx_preshader *pres = &peval->pres;
     struct d3dx_regstore *rs = &pres->regs;
-    ULONG64 new_update_version = next_update_version(peval->version_counter);
+    ULONG64 new_update_version;
     BOOL pres_dirty = FALSE;
 
     TRACE("device %p, peval %p, param_type %u.\n", device, peval, peval->param_type);
 
+    /* Nothing to evaluate or upload if no input has changed since the last
+     * update. */
+    if (!update_all && !is_const_tab_input_dirty(&pres->inputs, ULONG64_MAX)
+            && !is_const_tab_input_dirty(&peval->shader_inputs, ULONG64_MAX))
+        return D3D_OK;
+
+    new_update_version = next_update_version(peval->version_counter);
     if (is_const_tab_input_dirty(&pres->inputs, ULONG64_MAX))
     {
         set_constants(rs, &pres->inputs, new_update_version,
@@ -34,6 +34,34 @@ HRESULT WINAPI WICCreateImagingFactory_Proxy(UINT, IWICImagingFactory**);
 /* Wine-specific WIC GUIDs */
 DEFINE_GUID(GUID_WineContainerFormatTga, 0x0c44fda1,0xa5c5,0x4298,0x96,0x85,0x47,0x3f,0xc1,0x7c,0xd3,0x22);
 
+static INIT_ONCE dxtn_quality_once = INIT_ONCE_STATIC_INIT;
+static BOOL dxtn_quality_high;
+
+/* The slower, higher quality DXTn base color search is only used when it is
+ * enabled with the "HighQualityDXTn" DWORD value in HKCU\Software\Wine\Direct3DX. */
+static BOOL WINAPI dxtn_quality_init(INIT_ONCE *once, void *param, void **context)
+{
+    DWORD value, size = sizeof(value);
+    HKEY key;
+
+    if (!RegOpenKeyA(HKEY_CURRENT_USER, "Software\\Wine\\Direct3DX", &key))
+    {
+        if (!RegQueryValueExA(key, "HighQualityDXTn", NULL, NULL, (BYTE *)&value, &size)
+                && size == sizeof(value))
+            dxtn_quality_high = !!value;
+        RegCloseKey(key);
+    }
+    TRACE("Using %s quality DXTn compression.\n", dxtn_quality_high ? "high" : "default");
+
+    return TRUE;
+}
+
+static BOOL dxtn_high_quality(void)
+{
+    InitOnceExecuteOnce(&dxtn_quality_once, dxtn_quality_init, NULL, NULL);
+    return dxtn_quality_high;
+}
+
 static const struct
 {
     const GUID *wic_guid;
@@ -2108,7 +2136,8 @@ HRESULT WINAPI D3DXLoadSurfaceFromMemory(IDirect3DSurface9 *dst_surface,
             }
             tx_compress_dxtn(4, dst_size_aligned.width, dst_size_aligned.height,
                     dst_uncompressed, gl_format, lockrect.pBits,
-                    lockrect.Pitch * destformatdesc->block_width / destformatdesc->block_byte_count);
+                    lockrect.Pitch * destformatdesc->block_width / destformatdesc->block_byte_count,
+                    dxtn_high_quality());
             heap_free(dst_uncompressed);
         }
     }
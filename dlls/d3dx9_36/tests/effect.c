@@ -5769,6 +5769,83 @@ static void test_effect_commitchanges(IDirect3DDevice9 *device)
     effect->lpVtbl->Release(effect);
 }
 
+static void test_effect_commitchanges_performance(IDirect3DDevice9 *device)
+{
+    static const unsigned int iteration_count = 100000;
+    D3DXHANDLE opvect1, g_pos1;
+    unsigned int i, passes_count;
+    ID3DXEffect *effect;
+    D3DXVECTOR4 fvect;
+    DWORD start;
+    HRESULT hr;
+
+    hr = D3DXCreateEffect(device, test_effect_preshader_effect_blob, sizeof(test_effect_preshader_effect_blob),
+            NULL, NULL, 0, NULL, &effect, NULL);
+    ok(hr == D3D_OK, "Got result %#x.\n", hr);
+
+    opvect1 = effect->lpVtbl->GetParameterByName(effect, NULL, "opvect1");
+    ok(!!opvect1, "GetParameterByName failed.\n");
+    g_pos1 = effect->lpVtbl->GetParameterByName(effect, NULL, "g_Pos1");
+    ok(!!g_pos1, "GetParameterByName failed.\n");
+
+    hr = effect->lpVtbl->Begin(effect, &passes_count, 0);
+    ok(hr == D3D_OK, "Got result %#x.\n", hr);
+
+    start = GetTickCount();
+    for (i = 0; i < iteration_count; ++i)
+    {
+        hr = effect->lpVtbl->BeginPass(effect, 0);
+        ok(hr == D3D_OK, "Got result %#x.\n", hr);
+        hr = effect->lpVtbl->EndPass(effect);
+        ok(hr == D3D_OK, "Got result %#x.\n", hr);
+    }
+    trace("BeginPass/EndPass: %u iterations in %u ms.\n", iteration_count, GetTickCount() - start);
+
+    hr = effect->lpVtbl->BeginPass(effect, 0);
+    ok(hr == D3D_OK, "Got result %#x.\n", hr);
+
+    start = GetTickCount();
+    for (i = 0; i < iteration_count; ++i)
+    {
+        hr = effect->lpVtbl->CommitChanges(effect);
+        ok(hr == D3D_OK, "Got result %#x.\n", hr);
+    }
+    trace("CommitChanges, no changes: %u iterations in %u ms.\n", iteration_count, GetTickCount() - start);
+
+    /* opvect1 is a preshader input, g_Pos1 a plain shader constant. */
+    start = GetTickCount();
+    for (i = 0; i < iteration_count; ++i)
+    {
+        fvect.x = fvect.y = fvect.z = fvect.w = i;
+        hr = effect->lpVtbl->SetVector(effect, opvect1, &fvect);
+        ok(hr == D3D_OK, "Got result %#x.\n", hr);
+        hr = effect->lpVtbl->CommitChanges(effect);
+        ok(hr == D3D_OK, "Got result %#x.\n", hr);
+    }
+    trace("CommitChanges, preshader input changed: %u iterations in %u ms.\n",
+            iteration_count, GetTickCount() - start);
+
+    start = GetTickCount();
+    for (i = 0; i < iteration_count; ++i)
+    {
+        fvect.x = fvect.y = fvect.z = fvect.w = i;
+        hr = effect->lpVtbl->SetVector(effect, g_pos1, &fvect);
+        ok(hr == D3D_OK, "Got result %#x.\n", hr);
+        hr = effect->lpVtbl->CommitChanges(effect);
+        ok(hr == D3D_OK, "Got result %#x.\n", hr);
+    }
+    trace("CommitChanges, shader constant changed: %u iterations in %u ms.\n",
+            iteration_count, GetTickCount() - start);
+
+    hr = effect->lpVtbl->EndPass(effect);
+    ok(hr == D3D_OK, "Got result %#x.\n", hr);
+
+    hr = effect->lpVtbl->End(effect);
+    ok(hr == D3D_OK, "Got result %#x.\n", hr);
+
+    effect->lpVtbl->Release(effect);
+}
+
 static void test_effect_preshader_relative_addressing(IDirect3DDevice9 *device)
 {
     static const struct
@@ -8375,6 +8452,8 @@ START_TEST(effect)
     test_effect_large_address_aware_flag(device);
     test_effect_get_pass_desc(device);
     test_effect_skip_constants(device);
+    if (winetest_interactive)
+        test_effect_commitchanges_performance(device);
 
     refcount = IDirect3DDevice9_Release(device);
     ok(!refcount, "Device has %u references left.\n", refcount);
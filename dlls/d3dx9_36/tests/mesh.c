@@ -11464,6 +11464,89 @@ static void test_load_skin_mesh_from_xof(void)
     DestroyWindow(hwnd);
 }
 
+static void test_mesh_processing_times(void)
+{
+    static const unsigned int grid_size = 256;
+    unsigned int num_faces = grid_size * grid_size * 2, num_vertices = num_faces * 3, x, y, i;
+    struct test_context *test_context;
+    DWORD *adjacency, *face_remap;
+    struct
+    {
+        D3DXVECTOR3 position;
+        D3DXVECTOR3 normal;
+    } *vertices;
+    DWORD start, *indices;
+    ID3DXMesh *mesh;
+    HRESULT hr;
+
+    if (!(test_context = new_test_context()))
+    {
+        skip("Couldn't create test context.\n");
+        return;
+    }
+
+    hr = D3DXCreateMeshFVF(num_faces, num_vertices, D3DXMESH_32BIT | D3DXMESH_SYSTEMMEM,
+            D3DFVF_XYZ | D3DFVF_NORMAL, test_context->device, &mesh);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+
+    /* A height field where every face has its own vertices. */
+    mesh->lpVtbl->LockVertexBuffer(mesh, 0, (void **)&vertices);
+    mesh->lpVtbl->LockIndexBuffer(mesh, 0, (void **)&indices);
+    for (y = 0, i = 0; y < grid_size; ++y)
+    {
+        for (x = 0; x < grid_size; ++x)
+        {
+            static const unsigned int corners[6][2] = {{0, 0}, {1, 0}, {0, 1}, {1, 0}, {1, 1}, {0, 1}};
+            unsigned int k;
+
+            for (k = 0; k < 6; ++k, ++i)
+            {
+                float px = (float)(x + corners[k][0]), py = (float)(y + corners[k][1]);
+
+                vertices[i].position.x = px;
+                vertices[i].position.y = sinf(px * 0.1f) * cosf(py * 0.1f);
+                vertices[i].position.z = py;
+                indices[i] = i;
+            }
+        }
+    }
+    mesh->lpVtbl->UnlockIndexBuffer(mesh);
+    mesh->lpVtbl->UnlockVertexBuffer(mesh);
+
+    adjacency = HeapAlloc(GetProcessHeap(), 0, 3 * num_faces * sizeof(*adjacency));
+    face_remap = HeapAlloc(GetProcessHeap(), 0, num_faces * sizeof(*face_remap));
+
+    start = GetTickCount();
+    hr = mesh->lpVtbl->GenerateAdjacency(mesh, 1e-6f, adjacency);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    trace("GenerateAdjacency: %u faces in %u ms.\n", num_faces, GetTickCount() - start);
+
+    start = GetTickCount();
+    hr = D3DXComputeTangentFrameEx(mesh, D3DX_DEFAULT, 0, D3DX_DEFAULT, 0, D3DX_DEFAULT, 0,
+            D3DDECLUSAGE_NORMAL, 0, D3DXTANGENT_GENERATE_IN_PLACE | D3DXTANGENT_CALCULATE_NORMALS,
+            adjacency, -1.01f, -0.01f, -1.01f, NULL, NULL);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    trace("D3DXComputeTangentFrameEx: %u faces in %u ms.\n", num_faces, GetTickCount() - start);
+
+    start = GetTickCount();
+    hr = D3DXWeldVertices(mesh, D3DXWELDEPSILONS_WELDALL, NULL, adjacency, NULL, NULL, NULL);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    trace("D3DXWeldVertices: %u vertices in %u ms, %u left.\n", num_vertices, GetTickCount() - start,
+            mesh->lpVtbl->GetNumVertices(mesh));
+
+    mesh->lpVtbl->LockIndexBuffer(mesh, D3DLOCK_READONLY, (void **)&indices);
+    start = GetTickCount();
+    hr = D3DXOptimizeFaces(indices, num_faces, mesh->lpVtbl->GetNumVertices(mesh), TRUE, face_remap);
+    ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+    trace("D3DXOptimizeFaces: %u faces in %u ms.\n", num_faces, GetTickCount() - start);
+    mesh->lpVtbl->UnlockIndexBuffer(mesh);
+
+    HeapFree(GetProcessHeap(), 0, face_remap);
+    HeapFree(GetProcessHeap(), 0, adjacency);
+    mesh->lpVtbl->Release(mesh);
+    free_test_context(test_context);
+}
+
 START_TEST(mesh)
 {
     D3DXBoundProbeTest();
@@ -11497,4 +11580,7 @@ START_TEST(mesh)
     test_compute_normals();
     test_D3DXFrameFind();
     test_load_skin_mesh_from_xof();
+
+    if (winetest_interactive)
+        test_mesh_processing_times();
 }
@@ -1753,6 +1753,318 @@ static void test_D3DXSaveSurfaceToFile(IDirect3DDevice9 *device)
     IDirect3DSurface9_Release(surface);
 }
 
+/* Two colors per 4x4 block, exactly representable in the compressed formats. */
+static DWORD get_dxtn_test_color(D3DFORMAT format, unsigned int x, unsigned int y)
+{
+    unsigned int i = ((y / 4) * 37 + x / 4) * 2 + ((x + y) & 1);
+    unsigned int r = (i * 7) & 0x1f, g = (i * 13 + 5) & 0x3f, b = (i * 3 + 11) & 0x1f, a;
+
+    if (format == D3DFMT_DXT1)
+        a = 0xff;
+    else if (format == D3DFMT_DXT3)
+        a = ((i * 5) & 0xf) * 0x11;
+    else
+        a = (i * 29) & 0xff;
+    return D3DCOLOR_ARGB(a, r << 3 | r >> 2, g << 2 | g >> 4, b << 3 | b >> 2);
+}
+
+static DWORD expand_r5g6b5(unsigned int color)
+{
+    unsigned int r = color >> 11, g = (color >> 5) & 0x3f, b = color & 0x1f;
+
+    return D3DCOLOR_ARGB(0, r << 3 | r >> 2, g << 2 | g >> 4, b << 3 | b >> 2);
+}
+
+static DWORD blend_colors(DWORD c0, DWORD c1, unsigned int w0, unsigned int w1)
+{
+    unsigned int shift;
+    DWORD color = 0;
+
+    for (shift = 0; shift < 24; shift += 8)
+        color |= ((((c0 >> shift) & 0xff) * w0 + ((c1 >> shift) & 0xff) * w1) / (w0 + w1)) << shift;
+    return color;
+}
+
+static void decode_dxtn_block(D3DFORMAT format, const BYTE *block, DWORD texels[16])
+{
+    const BYTE *color_block = format == D3DFMT_DXT1 ? block : block + 8;
+    unsigned int c0 = color_block[0] | color_block[1] << 8;
+    unsigned int c1 = color_block[2] | color_block[3] << 8;
+    unsigned int i, index, bit, alphas[8];
+    DWORD colors[4];
+
+    colors[0] = expand_r5g6b5(c0);
+    colors[1] = expand_r5g6b5(c1);
+    if (format != D3DFMT_DXT1 || c0 > c1)
+    {
+        colors[2] = blend_colors(colors[0], colors[1], 2, 1);
+        colors[3] = blend_colors(colors[0], colors[1], 1, 2);
+    }
+    else
+    {
+        colors[2] = blend_colors(colors[0], colors[1], 1, 1);
+        colors[3] = 0;
+    }
+
+    alphas[0] = block[0];
+    alphas[1] = block[1];
+    for (i = 2; i < 8; ++i)
+    {
+        if (alphas[0] > alphas[1])
+            alphas[i] = ((8 - i) * alphas[0] + (i - 1) * alphas[1]) / 7;
+        else if (i < 6)
+            alphas[i] = ((6 - i) * alphas[0] + (i - 1) * alphas[1]) / 5;
+        else
+            alphas[i] = i == 6 ? 0x00 : 0xff;
+    }
+
+    for (i = 0; i < 16; ++i)
+    {
+        index = (color_block[4 + i / 4] >> (i % 4 * 2)) & 3;
+        texels[i] = colors[index];
+        if (format == D3DFMT_DXT1)
+        {
+            if (index != 3 || c0 > c1)
+                texels[i] |= 0xff000000;
+        }
+        else if (format == D3DFMT_DXT3)
+        {
+            texels[i] |= ((block[i / 2] >> (i % 2 * 4)) & 0xf) * 0x11 << 24;
+        }
+        else
+        {
+            bit = 16 + i * 3;
+            texels[i] |= alphas[((block[bit / 8] | block[bit / 8 + 1] << 8) >> (bit % 8)) & 7] << 24;
+        }
+    }
+}
+
+/* Compresses mip levels whose size isn't a multiple of the block size, so that
+ * they end with partial blocks, and checks that every block decodes to its
+ * source texels. The 1022x1018 level is large enough to be split into several
+ * tasks. */
+static void test_dxtn_compression(IDirect3DDevice9 *device)
+{
+    static const struct
+    {
+        D3DFORMAT format;
+        const char *name;
+        unsigned int block_size;
+    }
+    formats[] =
+    {
+        {D3DFMT_DXT1, "DXT1", 8},
+        {D3DFMT_DXT3, "DXT3", 16},
+        {D3DFMT_DXT5, "DXT5", 16},
+    };
+    static const struct
+    {
+        unsigned int width, height, level;
+    }
+    sizes[] =
+    {
+        {24, 20, 2},     /* 6x5 */
+        {24, 20, 3},     /* 3x2 */
+        {24, 20, 4},     /* 1x1 */
+        {2044, 2036, 1}, /* 1022x1018 */
+    };
+    unsigned int i, j, x, y, width, height, diff_count, diff_x = 0, diff_y = 0;
+    DWORD *pixels, texels[16], diff = 0;
+    IDirect3DTexture9 *texture;
+    IDirect3DSurface9 *surface;
+    D3DLOCKED_RECT lock_rect;
+    const BYTE *block;
+    RECT rect;
+    HRESULT hr;
+
+    for (i = 0; i < ARRAY_SIZE(formats); ++i)
+    {
+        for (j = 0; j < ARRAY_SIZE(sizes); ++j)
+        {
+            hr = IDirect3DDevice9_CreateTexture(device, sizes[j].width, sizes[j].height, sizes[j].level + 1,
+                    0, formats[i].format, D3DPOOL_SYSTEMMEM, &texture, NULL);
+            if (FAILED(hr))
+            {
+                skip("Failed to create %s texture, hr %#x.\n", formats[i].name, hr);
+                continue;
+            }
+            hr = IDirect3DTexture9_GetSurfaceLevel(texture, sizes[j].level, &surface);
+            ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+
+            width = max(1, sizes[j].width >> sizes[j].level);
+            height = max(1, sizes[j].height >> sizes[j].level);
+            pixels = HeapAlloc(GetProcessHeap(), 0, width * height * sizeof(*pixels));
+            for (y = 0; y < height; ++y)
+            {
+                for (x = 0; x < width; ++x)
+                    pixels[y * width + x] = get_dxtn_test_color(formats[i].format, x, y);
+            }
+
+            SetRect(&rect, 0, 0, width, height);
+            hr = D3DXLoadSurfaceFromMemory(surface, NULL, NULL, pixels, D3DFMT_A8R8G8B8,
+                    width * sizeof(*pixels), NULL, &rect, D3DX_FILTER_NONE, 0);
+            ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+
+            hr = IDirect3DSurface9_LockRect(surface, &lock_rect, NULL, D3DLOCK_READONLY);
+            ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+            diff_count = 0;
+            for (y = 0; y < height; ++y)
+            {
+                for (x = 0; x < width; ++x)
+                {
+                    if (!(x % 4))
+                    {
+                        block = (const BYTE *)lock_rect.pBits + (y / 4) * lock_rect.Pitch
+                                + (x / 4) * formats[i].block_size;
+                        decode_dxtn_block(formats[i].format, block, texels);
+                    }
+                    if (texels[(y % 4) * 4 + x % 4] != pixels[y * width + x] && !diff_count++)
+                    {
+                        diff_x = x;
+                        diff_y = y;
+                        diff = texels[(y % 4) * 4 + x % 4];
+                    }
+                }
+            }
+            ok(!diff_count, "%s %ux%u: %u texels differ, got %#x at (%u, %u), expected %#x.\n",
+                    formats[i].name, width, height, diff_count, diff, diff_x, diff_y,
+                    diff_count ? pixels[diff_y * width + diff_x] : 0);
+            hr = IDirect3DSurface9_UnlockRect(surface);
+            ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+
+            HeapFree(GetProcessHeap(), 0, pixels);
+            check_release((IUnknown *)surface, 1);
+            check_release((IUnknown *)texture, 0);
+        }
+    }
+}
+
+/* Runs test_dxtn_compression() again in a child process using the high quality mode. */
+static void test_dxtn_compression_high_quality(void)
+{
+    char cmdline[MAX_PATH * 2], **argv;
+    STARTUPINFOA si = {sizeof(si)};
+    PROCESS_INFORMATION pi;
+    DWORD value = 1;
+    HKEY key;
+    BOOL ret;
+
+    if (RegCreateKeyA(HKEY_CURRENT_USER, "Software\\Wine\\Direct3DX", &key))
+    {
+        skip("Failed to open the Direct3DX key.\n");
+        return;
+    }
+    if (!RegQueryValueExA(key, "HighQualityDXTn", NULL, NULL, NULL, NULL))
+    {
+        skip("The DXTn compression quality is already configured.\n");
+        RegCloseKey(key);
+        return;
+    }
+    RegSetValueExA(key, "HighQualityDXTn", 0, REG_DWORD, (BYTE *)&value, sizeof(value));
+
+    winetest_get_mainargs(&argv);
+    sprintf(cmdline, "\"%s\" surface dxtn_high_quality", argv[0]);
+    ret = CreateProcessA(NULL, cmdline, NULL, NULL, FALSE, 0, NULL, NULL, &si, &pi);
+    ok(ret, "Failed to create process, error %u.\n", GetLastError());
+    if (ret)
+    {
+        wait_child_process(pi.hProcess);
+        CloseHandle(pi.hProcess);
+        CloseHandle(pi.hThread);
+    }
+
+    RegDeleteValueA(key, "HighQualityDXTn");
+    RegCloseKey(key);
+}
+
+static void test_dxtn_compression_times(IDirect3DDevice9 *device)
+{
+    static const unsigned int size = 1024;
+    static const struct
+    {
+        D3DFORMAT format;
+        const char *name;
+    }
+    formats[] =
+    {
+        {D3DFMT_DXT1, "DXT1"},
+        {D3DFMT_DXT3, "DXT3"},
+        {D3DFMT_DXT5, "DXT5"},
+    };
+    static const struct
+    {
+        DWORD filter;
+        const char *name;
+    }
+    filters[] =
+    {
+        {D3DX_FILTER_NONE, "none"},
+        {D3DX_DEFAULT, "default"},
+    };
+    static const char *image_names[] = {"gradient", "noise", "stripes"};
+    unsigned int i, j, image, x, y, seed = 1;
+    IDirect3DSurface9 *surface;
+    IDirect3DTexture9 *texture;
+    DWORD start, *pixels;
+    RECT rect;
+    HRESULT hr;
+
+    pixels = HeapAlloc(GetProcessHeap(), 0, size * size * sizeof(*pixels));
+    SetRect(&rect, 0, 0, size, size);
+
+    for (image = 0; image < ARRAY_SIZE(image_names); ++image)
+    {
+        for (y = 0; y < size; ++y)
+        {
+            for (x = 0; x < size; ++x)
+            {
+                switch (image)
+                {
+                    case 0:
+                        pixels[y * size + x] = D3DCOLOR_ARGB(x * 255 / size, y * 255 / size,
+                                (x + y) * 255 / (2 * size), 255 - x * 255 / size);
+                        break;
+                    case 1:
+                        seed = seed * 1103515245 + 12345;
+                        pixels[y * size + x] = seed;
+                        break;
+                    default:
+                        pixels[y * size + x] = (x / 3 + y / 5) & 1 ? 0xff2060c0 : 0x80f0d010;
+                        break;
+                }
+            }
+        }
+
+        for (i = 0; i < ARRAY_SIZE(formats); ++i)
+        {
+            hr = IDirect3DDevice9_CreateTexture(device, size, size, 1, 0, formats[i].format,
+                    D3DPOOL_SYSTEMMEM, &texture, NULL);
+            if (FAILED(hr))
+            {
+                skip("Failed to create %s texture, hr %#x.\n", formats[i].name, hr);
+                continue;
+            }
+            hr = IDirect3DTexture9_GetSurfaceLevel(texture, 0, &surface);
+            ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+
+            for (j = 0; j < ARRAY_SIZE(filters); ++j)
+            {
+                start = GetTickCount();
+                hr = D3DXLoadSurfaceFromMemory(surface, NULL, NULL, pixels, D3DFMT_A8R8G8B8,
+                        size * sizeof(*pixels), NULL, &rect, filters[j].filter, 0);
+                ok(hr == D3D_OK, "Got unexpected hr %#x.\n", hr);
+                trace("%s %ux%u %s, %s: %u ms.\n", image_names[image], size, size,
+                        formats[i].name, filters[j].name, GetTickCount() - start);
+            }
+
+            check_release((IUnknown *)surface, 1);
+            check_release((IUnknown *)texture, 0);
+        }
+    }
+
+    HeapFree(GetProcessHeap(), 0, pixels);
+}
+
 START_TEST(surface)
 {
     HWND wnd;
@@ -1760,6 +2072,7 @@ START_TEST(surface)
     IDirect3DDevice9 *device;
     D3DPRESENT_PARAMETERS d3dpp;
     HRESULT hr;
+    char **argv;
 
     if (!(wnd = CreateWindowA("static", "d3dx9_test", WS_OVERLAPPEDWINDOW, 0, 0,
             640, 480, NULL, NULL, NULL, NULL)))
@@ -1785,10 +2098,21 @@ START_TEST(surface)
         return;
     }
 
-    test_D3DXGetImageInfo();
-    test_D3DXLoadSurface(device);
-    test_D3DXSaveSurfaceToFileInMemory(device);
-    test_D3DXSaveSurfaceToFile(device);
+    if (winetest_get_mainargs(&argv) >= 3 && !strcmp(argv[2], "dxtn_high_quality"))
+    {
+        test_dxtn_compression(device);
+    }
+    else
+    {
+        test_D3DXGetImageInfo();
+        test_D3DXLoadSurface(device);
+        test_D3DXSaveSurfaceToFileInMemory(device);
+        test_D3DXSaveSurfaceToFile(device);
+        test_dxtn_compression(device);
+        test_dxtn_compression_high_quality();
+        if (winetest_interactive)
+            test_dxtn_compression_times(device);
+    }
 
     check_release((IUnknown*)device, 0);
     check_release((IUnknown*)d3d, 0);
@@ -24,6 +24,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include "d3dx9_private.h"
 #include "txc_dxtn.h"
 
 /* weights used for error function, basically weights (unsquared 2/4/1) according to rgb->luminance conversion
@@ -34,17 +35,111 @@
 
 #define ALPHACUT 127
 
+/* number of additional base color refinement passes in high quality mode */
+#define MAXREFINEPASSES 4
+
+/* find the closest of the 4 colors in cv for each pixel, using the same distance metric and tie
+   breaking everywhere. Returns the summed error, the 2 bit indices are stored in bits */
+typedef GLuint (*colorindicesfunc)(GLubyte srccolors[4][4][4], GLubyte cv[4][4],
+                                   GLint numxpixels, GLint numypixels, GLuint *bits);
+
+static GLuint colorindices_c(GLubyte srccolors[4][4][4], GLubyte cv[4][4],
+                             GLint numxpixels, GLint numypixels, GLuint *bits)
+{
+   GLint i, j, colors;
+   GLuint pixerror, pixerrorbest, blockerror = 0;
+   GLint colordist;
+   GLubyte enc = 0;
+
+   *bits = 0;
+   for (j = 0; j < numypixels; j++) {
+      for (i = 0; i < numxpixels; i++) {
+         pixerrorbest = 0xffffffff;
+         for (colors = 0; colors < 4; colors++) {
+            colordist = srccolors[j][i][0] - cv[colors][0];
+            pixerror = colordist * colordist * REDWEIGHT;
+            colordist = srccolors[j][i][1] - cv[colors][1];
+            pixerror += colordist * colordist * GREENWEIGHT;
+            colordist = srccolors[j][i][2] - cv[colors][2];
+            pixerror += colordist * colordist * BLUEWEIGHT;
+            if (pixerror < pixerrorbest) {
+               pixerrorbest = pixerror;
+               enc = colors;
+            }
+         }
+         blockerror += pixerrorbest;
+         *bits |= enc << (2 * (j * 4 + i));
+      }
+   }
+   return blockerror;
+}
+
+#if (defined(__i386__) || defined(__x86_64__)) \
+      && (defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+
+#define HAVE_COLORINDICES_SSE2
+
+typedef short colorindices_v8hi __attribute__((vector_size(16)));
+typedef int colorindices_v4si __attribute__((vector_size(16)));
+
+/* one row of 4 pixels at a time, red and green are interleaved so that pmaddwd computes their
+   weighted squared distance in one go, blue is interleaved with zeroes */
+static __attribute__((target("sse2"))) GLuint colorindices_sse2(GLubyte srccolors[4][4][4], GLubyte cv[4][4],
+                                                                GLint numxpixels, GLint numypixels, GLuint *bits)
+{
+   static const colorindices_v8hi rgweight = {REDWEIGHT, GREENWEIGHT, REDWEIGHT, GREENWEIGHT,
+                                              REDWEIGHT, GREENWEIGHT, REDWEIGHT, GREENWEIGHT};
+   colorindices_v8hi cvrg[4], cvb[4], rg, b, distrg, distb;
+   colorindices_v4si pixerror, pixerrorbest, enc, mask, blockerror = {0};
+   GLint i, j, colors;
+
+   if (numxpixels != 4 || numypixels != 4)
+      return colorindices_c(srccolors, cv, numxpixels, numypixels, bits);
+
+   for (colors = 0; colors < 4; colors++) {
+      cvrg[colors] = (colorindices_v8hi){cv[colors][0], cv[colors][1], cv[colors][0], cv[colors][1],
+                                         cv[colors][0], cv[colors][1], cv[colors][0], cv[colors][1]};
+      cvb[colors] = (colorindices_v8hi){cv[colors][2], 0, cv[colors][2], 0, cv[colors][2], 0, cv[colors][2], 0};
+   }
+
+   *bits = 0;
+   for (j = 0; j < 4; j++) {
+      rg = (colorindices_v8hi){srccolors[j][0][0], srccolors[j][0][1], srccolors[j][1][0], srccolors[j][1][1],
+                               srccolors[j][2][0], srccolors[j][2][1], srccolors[j][3][0], srccolors[j][3][1]};
+      b = (colorindices_v8hi){srccolors[j][0][2], 0, srccolors[j][1][2], 0,
+                              srccolors[j][2][2], 0, srccolors[j][3][2], 0};
+      pixerrorbest = (colorindices_v4si){0x7fffffff, 0x7fffffff, 0x7fffffff, 0x7fffffff};
+      enc = (colorindices_v4si){0};
+      for (colors = 0; colors < 4; colors++) {
+         distrg = rg - cvrg[colors];
+         distb = b - cvb[colors];
+         pixerror = (colorindices_v4si)__builtin_ia32_pmaddwd128(distrg, distrg * rgweight)
+               + (colorindices_v4si)__builtin_ia32_pmaddwd128(distb, distb);
+         mask = pixerror < pixerrorbest;
+         pixerrorbest = (pixerrorbest & ~mask) | (pixerror & mask);
+         enc = (enc & ~mask) | ((colorindices_v4si){colors, colors, colors, colors} & mask);
+      }
+      blockerror += pixerrorbest;
+      for (i = 0; i < 4; i++)
+         *bits |= (GLuint)enc[i] << (2 * (j * 4 + i));
+   }
+   return blockerror[0] + blockerror[1] + blockerror[2] + blockerror[3];
+}
+
+#endif
+
 static void fancybasecolorsearch( GLubyte *blkaddr, GLubyte srccolors[4][4][4], GLubyte *bestcolor[2],
-                           GLint numxpixels, GLint numypixels, GLint type, GLboolean haveAlpha)
+                           GLint numxpixels, GLint numypixels, GLint type, GLboolean haveAlpha,
+                           colorindicesfunc colorindices)
 {
    /* use same luminance-weighted distance metric to determine encoding as for finding the base colors */
 
    /* TODO could also try to find a better encoding for the 3-color-encoding type, this really should be done
       if it's rgba_dxt1 and we have alpha in the block, currently even values which will be mapped to black
       due to their alpha value will influence the result */
-   GLint i, j, colors, z;
-   GLuint pixerror, pixerrorred, pixerrorgreen, pixerrorblue, pixerrorbest;
-   GLint colordist, blockerrlin[2][3];
+   GLint i, j, z;
+   GLuint bits;
+   GLint blockerrlin[2][3];
    GLubyte nrcolor[2];
    GLint pixerrorcolorbest[3];
    GLubyte enc = 0;
@@ -88,26 +183,12 @@ static void fancybasecolorsearch( GLubyte *blkaddr, GLubyte srccolors[4][4][4],
    nrcolor[0] = 0;
    nrcolor[1] = 0;
 
+   colorindices(srccolors, cv, numxpixels, numypixels, &bits);
    for (j = 0; j < numypixels; j++) {
       for (i = 0; i < numxpixels; i++) {
-         pixerrorbest = 0xffffffff;
-         for (colors = 0; colors < 4; colors++) {
-            colordist = srccolors[j][i][0] - (cv[colors][0]);
-            pixerror = colordist * colordist * REDWEIGHT;
-            pixerrorred = colordist;
-            colordist = srccolors[j][i][1] - (cv[colors][1]);
-            pixerror += colordist * colordist * GREENWEIGHT;
-            pixerrorgreen = colordist;
-            colordist = srccolors[j][i][2] - (cv[colors][2]);
-            pixerror += colordist * colordist * BLUEWEIGHT;
-            pixerrorblue = colordist;
-            if (pixerror < pixerrorbest) {
-               enc = colors;
-               pixerrorbest = pixerror;
-               pixerrorcolorbest[0] = pixerrorred;
-               pixerrorcolorbest[1] = pixerrorgreen;
-               pixerrorcolorbest[2] = pixerrorblue;
-            }
+         enc = (bits >> (2 * (j * 4 + i))) & 3;
+         for (z = 0; z < 3; z++) {
+            pixerrorcolorbest[z] = srccolors[j][i][z] - cv[enc][z];
          }
          if (enc == 0) {
             for (z = 0; z < 3; z++) {
@@ -227,7 +308,8 @@ static void fancybasecolorsearch( GLubyte *blkaddr, GLubyte srccolors[4][4][4],
 
 
 static void storedxtencodedblock( GLubyte *blkaddr, GLubyte srccolors[4][4][4], GLubyte *bestcolor[2],
-                           GLint numxpixels, GLint numypixels, GLuint type, GLboolean haveAlpha)
+                           GLint numxpixels, GLint numypixels, GLuint type, GLboolean haveAlpha,
+                           colorindicesfunc colorindices)
 {
    /* use same luminance-weighted distance metric to determine encoding as for finding the base colors */
 
@@ -262,26 +344,7 @@ static void storedxtencodedblock( GLubyte *blkaddr, GLubyte srccolors[4][4][4],
       cv[3][i] = (bestcolor[0][i] + bestcolor[1][i] * 2) / 3;
    }
 
-   testerror = 0;
-   for (j = 0; j < numypixels; j++) {
-      for (i = 0; i < numxpixels; i++) {
-         pixerrorbest = 0xffffffff;
-         for (colors = 0; colors < 4; colors++) {
-            colordist = srccolors[j][i][0] - cv[colors][0];
-            pixerror = colordist * colordist * REDWEIGHT;
-            colordist = srccolors[j][i][1] - cv[colors][1];
-            pixerror += colordist * colordist * GREENWEIGHT;
-            colordist = srccolors[j][i][2] - cv[colors][2];
-            pixerror += colordist * colordist * BLUEWEIGHT;
-            if (pixerror < pixerrorbest) {
-               pixerrorbest = pixerror;
-               enc = colors;
-            }
-         }
-         testerror += pixerrorbest;
-         bits |= enc << (2 * (j * 4 + i));
-      }
-   }
+   testerror = colorindices(srccolors, cv, numxpixels, numypixels, &bits);
    /* some hw might disagree but actually decoding should always use 4-color encoding
       for non-dxt1 formats */
    if (type == GL_COMPRESSED_RGB_S3TC_DXT1_EXT || type == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT) {
@@ -349,8 +412,28 @@ static void storedxtencodedblock( GLubyte *blkaddr, GLubyte srccolors[4][4][4],
    }
 }
 
+static GLuint colorblockerror( GLubyte srccolors[4][4][4], GLubyte *bestcolor[2],
+                         GLint numxpixels, GLint numypixels, colorindicesfunc colorindices)
+{
+   /* error of the 4 color encoding with the base colors reduced to 565, as used by storedxtencodedblock */
+   GLubyte cv[4][4];
+   GLuint bits;
+   GLint i;
+
+   for (i = 0; i < 3; i++) {
+      GLubyte mask = i == 1 ? 0xfc : 0xf8;
+
+      cv[0][i] = bestcolor[0][i] & mask;
+      cv[1][i] = bestcolor[1][i] & mask;
+      cv[2][i] = (cv[0][i] * 2 + cv[1][i]) / 3;
+      cv[3][i] = (cv[0][i] + cv[1][i] * 2) / 3;
+   }
+   return colorindices(srccolors, cv, numxpixels, numypixels, &bits);
+}
+
 static void encodedxtcolorblockfaster( GLubyte *blkaddr, GLubyte srccolors[4][4][4],
-                         GLint numxpixels, GLint numypixels, GLuint type )
+                         GLint numxpixels, GLint numypixels, GLuint type,
+                         GLboolean highquality, colorindicesfunc colorindices )
 {
 /* simplistic approach. We need two base colors, simply use the "highest" and the "lowest" color
    present in the picture as base colors */
@@ -399,9 +482,31 @@ static void encodedxtcolorblockfaster( GLubyte *blkaddr, GLubyte srccolors[4][4]
    bestcolor[1] = basecolors[1];
 
    /* try to find better base colors */
-   fancybasecolorsearch(blkaddr, srccolors, bestcolor, numxpixels, numypixels, type, haveAlpha);
+   fancybasecolorsearch(blkaddr, srccolors, bestcolor, numxpixels, numypixels, type, haveAlpha, colorindices);
+   if (highquality) {
+      /* keep refining as long as the error goes down */
+      GLubyte testcolors[2][3];
+      GLubyte *testcolor[2];
+      GLuint blockerror, testerror;
+      GLint pass;
+
+      testcolor[0] = testcolors[0];
+      testcolor[1] = testcolors[1];
+      blockerror = colorblockerror(srccolors, bestcolor, numxpixels, numypixels, colorindices);
+      for (pass = 0; pass < MAXREFINEPASSES && blockerror; pass++) {
+         memcpy(testcolors[0], bestcolor[0], 3);
+         memcpy(testcolors[1], bestcolor[1], 3);
+         fancybasecolorsearch(blkaddr, srccolors, testcolor, numxpixels, numypixels, type, haveAlpha, colorindices);
+         testerror = colorblockerror(srccolors, testcolor, numxpixels, numypixels, colorindices);
+         if (testerror >= blockerror)
+            break;
+         blockerror = testerror;
+         memcpy(bestcolor[0], testcolors[0], 3);
+         memcpy(bestcolor[1], testcolors[1], 3);
+      }
+   }
    /* find the best encoding for these colors, and store the result */
-   storedxtencodedblock(blkaddr, srccolors, bestcolor, numxpixels, numypixels, type, haveAlpha);
+   storedxtencodedblock(blkaddr, srccolors, bestcolor, numxpixels, numypixels, type, haveAlpha, colorindices);
 }
 
 static void writedxt5encodedalphablock( GLubyte *blkaddr, GLubyte alphabase1, GLubyte alphabase2,
@@ -754,51 +859,63 @@ static void extractsrccolors( GLubyte srcpixels[4][4][4], const GLchan *srcaddr,
    }
 }
 
+/* fills the pixels of a partial block outside the image by replicating the last column and row,
+   so that every block only contains colors of its own pixels */
+static void padsrccolors( GLubyte srcpixels[4][4][4], GLint numxpixels, GLint numypixels )
+{
+   GLint i, j;
+   for (j = 0; j < numypixels; j++) {
+      for (i = numxpixels; i < 4; i++) {
+         memcpy(srcpixels[j][i], srcpixels[j][numxpixels - 1], sizeof(srcpixels[j][i]));
+      }
+   }
+   for (j = numypixels; j < 4; j++) {
+      memcpy(srcpixels[j], srcpixels[numypixels - 1], sizeof(srcpixels[j]));
+   }
+}
+
 
-void tx_compress_dxtn(GLint srccomps, GLint width, GLint height, const GLubyte *srcPixData,
-                     GLenum destFormat, GLubyte *dest, GLint dstRowStride)
+struct compressrowsparams {
+   GLint srccomps, width, height;
+   const GLubyte *srcPixData;
+   GLenum destFormat;
+   GLubyte *dest;
+   GLint blockRowStride;
+   GLboolean highquality;
+   colorindicesfunc colorindices;
+};
+
+/* compresses the rows of blocks from start to end, rows are independent of each other */
+static void compressblockrows(void *context, unsigned int start, unsigned int end)
 {
-      GLubyte *blkaddr = dest;
+      const struct compressrowsparams *params = context;
+      GLubyte *blkaddr;
       GLubyte srcpixels[4][4][4];
-      const GLchan *srcaddr = srcPixData;
+      const GLchan *srcaddr;
       GLint numxpixels, numypixels;
       GLint i, j;
-      GLint dstRowDiff;
 
-   switch (destFormat) {
-   case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
-   case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
-      /* hmm we used to get called without dstRowStride... */
-      dstRowDiff = dstRowStride >= (width * 2) ? dstRowStride - (((width + 3) & ~3) * 2) : 0;
-/*      fprintf(stderr, "dxt1 tex width %d tex height %d dstRowStride %d\n",
-              width, height, dstRowStride); */
-      for (j = 0; j < height; j += 4) {
-         if (height > j + 3) numypixels = 4;
-         else numypixels = height - j;
-         srcaddr = srcPixData + j * width * srccomps;
-         for (i = 0; i < width; i += 4) {
-            if (width > i + 3) numxpixels = 4;
-            else numxpixels = width - i;
-            extractsrccolors(srcpixels, srcaddr, width, numxpixels, numypixels, srccomps);
-            encodedxtcolorblockfaster(blkaddr, srcpixels, numxpixels, numypixels, destFormat);
-            srcaddr += srccomps * numxpixels;
+   /* components missing from the source stay zero */
+   memset(srcpixels, 0, sizeof(srcpixels));
+   for (j = start * 4; j < end * 4; j += 4) {
+      if (params->height > j + 3) numypixels = 4;
+      else numypixels = params->height - j;
+      srcaddr = params->srcPixData + j * params->width * params->srccomps;
+      blkaddr = params->dest + (j / 4) * params->blockRowStride;
+      for (i = 0; i < params->width; i += 4) {
+         if (params->width > i + 3) numxpixels = 4;
+         else numxpixels = params->width - i;
+         extractsrccolors(srcpixels, srcaddr, params->width, numxpixels, numypixels, params->srccomps);
+         if (numxpixels < 4 || numypixels < 4)
+            padsrccolors(srcpixels, numxpixels, numypixels);
+         switch (params->destFormat) {
+         case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+         case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+            encodedxtcolorblockfaster(blkaddr, srcpixels, numxpixels, numypixels, params->destFormat,
+                                      params->highquality, params->colorindices);
             blkaddr += 8;
-         }
-         blkaddr += dstRowDiff;
-      }
-      break;
-   case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
-      dstRowDiff = dstRowStride >= (width * 4) ? dstRowStride - (((width + 3) & ~3) * 4) : 0;
-/*      fprintf(stderr, "dxt3 tex width %d tex height %d dstRowStride %d\n",
-              width, height, dstRowStride); */
-      for (j = 0; j < height; j += 4) {
-         if (height > j + 3) numypixels = 4;
-         else numypixels = height - j;
-         srcaddr = srcPixData + j * width * srccomps;
-         for (i = 0; i < width; i += 4) {
-            if (width > i + 3) numxpixels = 4;
-            else numxpixels = width - i;
-            extractsrccolors(srcpixels, srcaddr, width, numxpixels, numypixels, srccomps);
+            break;
+         case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
             *blkaddr++ = (srcpixels[0][0][3] >> 4) | (srcpixels[0][1][3] & 0xf0);
             *blkaddr++ = (srcpixels[0][2][3] >> 4) | (srcpixels[0][3][3] & 0xf0);
             *blkaddr++ = (srcpixels[1][0][3] >> 4) | (srcpixels[1][1][3] & 0xf0);
@@ -807,35 +924,59 @@ void tx_compress_dxtn(GLint srccomps, GLint width, GLint height, const GLubyte *
             *blkaddr++ = (srcpixels[2][2][3] >> 4) | (srcpixels[2][3][3] & 0xf0);
             *blkaddr++ = (srcpixels[3][0][3] >> 4) | (srcpixels[3][1][3] & 0xf0);
             *blkaddr++ = (srcpixels[3][2][3] >> 4) | (srcpixels[3][3][3] & 0xf0);
-            encodedxtcolorblockfaster(blkaddr, srcpixels, numxpixels, numypixels, destFormat);
-            srcaddr += srccomps * numxpixels;
+            encodedxtcolorblockfaster(blkaddr, srcpixels, numxpixels, numypixels, params->destFormat,
+                                      params->highquality, params->colorindices);
             blkaddr += 8;
-         }
-         blkaddr += dstRowDiff;
-      }
-      break;
-   case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
-      dstRowDiff = dstRowStride >= (width * 4) ? dstRowStride - (((width + 3) & ~3) * 4) : 0;
-/*      fprintf(stderr, "dxt5 tex width %d tex height %d dstRowStride %d\n",
-              width, height, dstRowStride); */
-      for (j = 0; j < height; j += 4) {
-         if (height > j + 3) numypixels = 4;
-         else numypixels = height - j;
-         srcaddr = srcPixData + j * width * srccomps;
-         for (i = 0; i < width; i += 4) {
-            if (width > i + 3) numxpixels = 4;
-            else numxpixels = width - i;
-            extractsrccolors(srcpixels, srcaddr, width, numxpixels, numypixels, srccomps);
+            break;
+         case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
             encodedxt5alpha(blkaddr, srcpixels, numxpixels, numypixels);
-            encodedxtcolorblockfaster(blkaddr + 8, srcpixels, numxpixels, numypixels, destFormat);
-            srcaddr += srccomps * numxpixels;
+            encodedxtcolorblockfaster(blkaddr + 8, srcpixels, numxpixels, numypixels, params->destFormat,
+                                      params->highquality, params->colorindices);
             blkaddr += 16;
+            break;
          }
-         blkaddr += dstRowDiff;
+         srcaddr += params->srccomps * numxpixels;
       }
+   }
+}
+
+void tx_compress_dxtn(GLint srccomps, GLint width, GLint height, const GLubyte *srcPixData,
+                     GLenum destFormat, GLubyte *dest, GLint dstRowStride, GLboolean highquality)
+{
+      struct compressrowsparams params;
+      GLint blockrowsize, blocksperrow;
+
+   switch (destFormat) {
+   case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+   case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+      /* hmm we used to get called without dstRowStride... */
+      blockrowsize = ((width + 3) & ~3) * 2;
+      params.blockRowStride = dstRowStride >= (width * 2) ? dstRowStride : blockrowsize;
+      break;
+   case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
+   case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+      blockrowsize = ((width + 3) & ~3) * 4;
+      params.blockRowStride = dstRowStride >= (width * 4) ? dstRowStride : blockrowsize;
       break;
    default:
       /* fprintf(stderr, "libdxtn: Bad dstFormat %d in tx_compress_dxtn\n", destFormat); */
       return;
    }
+
+   params.srccomps = srccomps;
+   params.width = width;
+   params.height = height;
+   params.srcPixData = srcPixData;
+   params.destFormat = destFormat;
+   params.dest = dest;
+   params.highquality = highquality;
+   params.colorindices = colorindices_c;
+#ifdef HAVE_COLORINDICES_SSE2
+   if (IsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE))
+      params.colorindices = colorindices_sse2;
+#endif
+
+   /* hand out at least 4096 blocks at a time, textures up to 256x256 are compressed on the calling thread */
+   blocksperrow = (width + 3) / 4;
+   d3dx_parallel_for((height + 3) / 4, max(1, 4096 / max(blocksperrow, 1)), compressblockrows, &params);
 }
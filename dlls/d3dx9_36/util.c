@@ -289,6 +289,75 @@ const char *debug_d3dxparameter_registerset(D3DXREGISTER_SET r)
 
 #undef WINE_D3DX_TO_STR
 
+#define D3DX_MAX_PARALLEL_THREADS 16
+
+struct d3dx_parallel_loop
+{
+    d3dx_parallel_func func;
+    void *context;
+    unsigned int count;
+    unsigned int chunk_size;
+    LONG next;
+};
+
+static void d3dx_parallel_loop_run(struct d3dx_parallel_loop *loop)
+{
+    unsigned int start;
+
+    while ((start = InterlockedExchangeAdd(&loop->next, loop->chunk_size)) < loop->count)
+        loop->func(loop->context, start, min(start + loop->chunk_size, loop->count));
+}
+
+static void CALLBACK d3dx_parallel_loop_work(TP_CALLBACK_INSTANCE *instance, void *arg, TP_WORK *work)
+{
+    d3dx_parallel_loop_run(arg);
+}
+
+/* Calls func for consecutive ranges of at most chunk_size items out of count,
+ * on the calling thread and a few process thread pool threads. Ranges are
+ * handed out in order, but may complete in any order. Loops of a single
+ * range run on the calling thread only. */
+void d3dx_parallel_for(unsigned int count, unsigned int chunk_size, d3dx_parallel_func func, void *context)
+{
+    struct d3dx_parallel_loop loop;
+    unsigned int i, thread_count;
+    SYSTEM_INFO info;
+    TP_WORK *work;
+
+    if (!count)
+        return;
+
+    GetSystemInfo(&info);
+    thread_count = min(min(info.dwNumberOfProcessors, D3DX_MAX_PARALLEL_THREADS),
+            (count + chunk_size - 1) / chunk_size);
+    if (thread_count <= 1)
+    {
+        func(context, 0, count);
+        return;
+    }
+
+    loop.func = func;
+    loop.context = context;
+    loop.count = count;
+    loop.chunk_size = chunk_size;
+    loop.next = 0;
+
+    if (!(work = CreateThreadpoolWork(d3dx_parallel_loop_work, &loop, NULL)))
+    {
+        WARN("Failed to create thread pool work, error %u.\n", GetLastError());
+        func(context, 0, count);
+        return;
+    }
+
+    for (i = 0; i < thread_count - 1; ++i)
+        SubmitThreadpoolWork(work);
+
+    d3dx_parallel_loop_run(&loop);
+
+    WaitForThreadpoolWorkCallbacks(work, FALSE);
+    CloseThreadpoolWork(work);
+}
+
 /***********************************************************************
  * D3DXDebugMute
  * Returns always FALSE for us.
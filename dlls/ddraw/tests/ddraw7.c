@@ -18523,6 +18523,131 @@ done:
     IDirectDraw7_Release(ddraw);
 }
 
+/* Times colour fills and source colour keyed blits between system memory
+ * surfaces, which are done on the CPU and don't need a 3D device. */
+static void test_sysmem_blit_times(void)
+{
+    static const unsigned int size = 1024, count = 50;
+    static const struct
+    {
+        const char *name;
+        unsigned int bpp;
+        DWORD r, g, b, key, fill;
+    }
+    tests[] =
+    {
+        {"R5G6B5",   16, 0xf800,     0x07e0,     0x001f,     0x001f,     0x07e0},
+        {"X8R8G8B8", 32, 0x00ff0000, 0x0000ff00, 0x000000ff, 0x000000ff, 0x0000ff00},
+    };
+    LARGE_INTEGER frequency, start, end;
+    IDirectDrawSurface7 *src, *dst;
+    DDSURFACEDESC2 surface_desc;
+    double fill_time, blt_time;
+    unsigned int i, j, x, y;
+    IDirectDraw7 *ddraw;
+    DDCOLORKEY ckey;
+    DDBLTFX fx;
+    DWORD color;
+    HRESULT hr;
+
+    if (!(ddraw = create_ddraw()))
+    {
+        skip("Failed to create a ddraw object.\n");
+        return;
+    }
+    hr = IDirectDraw7_SetCooperativeLevel(ddraw, NULL, DDSCL_NORMAL);
+    ok(SUCCEEDED(hr), "Failed to set cooperative level, hr %#x.\n", hr);
+
+    QueryPerformanceFrequency(&frequency);
+
+    for (i = 0; i < ARRAY_SIZE(tests); ++i)
+    {
+        memset(&surface_desc, 0, sizeof(surface_desc));
+        surface_desc.dwSize = sizeof(surface_desc);
+        surface_desc.dwFlags = DDSD_CAPS | DDSD_WIDTH | DDSD_HEIGHT | DDSD_PIXELFORMAT;
+        surface_desc.dwWidth = size;
+        surface_desc.dwHeight = size;
+        surface_desc.ddsCaps.dwCaps = DDSCAPS_OFFSCREENPLAIN | DDSCAPS_SYSTEMMEMORY;
+        U4(surface_desc).ddpfPixelFormat.dwSize = sizeof(U4(surface_desc).ddpfPixelFormat);
+        U4(surface_desc).ddpfPixelFormat.dwFlags = DDPF_RGB;
+        U1(U4(surface_desc).ddpfPixelFormat).dwRGBBitCount = tests[i].bpp;
+        U2(U4(surface_desc).ddpfPixelFormat).dwRBitMask = tests[i].r;
+        U3(U4(surface_desc).ddpfPixelFormat).dwGBitMask = tests[i].g;
+        U4(U4(surface_desc).ddpfPixelFormat).dwBBitMask = tests[i].b;
+        hr = IDirectDraw7_CreateSurface(ddraw, &surface_desc, &src, NULL);
+        ok(SUCCEEDED(hr), "Failed to create surface, hr %#x.\n", hr);
+        hr = IDirectDraw7_CreateSurface(ddraw, &surface_desc, &dst, NULL);
+        ok(SUCCEEDED(hr), "Failed to create surface, hr %#x.\n", hr);
+
+        /* Key out every other column of the source. */
+        hr = IDirectDrawSurface7_Lock(src, NULL, &surface_desc, DDLOCK_WAIT, NULL);
+        ok(SUCCEEDED(hr), "Failed to lock surface, hr %#x.\n", hr);
+        for (y = 0; y < size; ++y)
+        {
+            BYTE *row = (BYTE *)surface_desc.lpSurface + y * U1(surface_desc).lPitch;
+
+            for (x = 0; x < size; ++x)
+            {
+                color = x & 1 ? tests[i].key : tests[i].r;
+                if (tests[i].bpp == 16)
+                    ((WORD *)row)[x] = color;
+                else
+                    ((DWORD *)row)[x] = color;
+            }
+        }
+        hr = IDirectDrawSurface7_Unlock(src, NULL);
+        ok(SUCCEEDED(hr), "Failed to unlock surface, hr %#x.\n", hr);
+
+        ckey.dwColorSpaceLowValue = ckey.dwColorSpaceHighValue = tests[i].key;
+        hr = IDirectDrawSurface7_SetColorKey(src, DDCKEY_SRCBLT, &ckey);
+        ok(SUCCEEDED(hr), "Failed to set color key, hr %#x.\n", hr);
+
+        memset(&fx, 0, sizeof(fx));
+        fx.dwSize = sizeof(fx);
+        U5(fx).dwFillColor = tests[i].fill;
+
+        QueryPerformanceCounter(&start);
+        for (j = 0; j < count; ++j)
+        {
+            hr = IDirectDrawSurface7_Blt(dst, NULL, NULL, NULL, DDBLT_COLORFILL | DDBLT_WAIT, &fx);
+            ok(SUCCEEDED(hr), "Failed to color fill, hr %#x.\n", hr);
+        }
+        QueryPerformanceCounter(&end);
+        fill_time = (end.QuadPart - start.QuadPart) * 1000.0 / frequency.QuadPart / count;
+
+        QueryPerformanceCounter(&start);
+        for (j = 0; j < count; ++j)
+        {
+            hr = IDirectDrawSurface7_Blt(dst, NULL, src, NULL, DDBLT_KEYSRC | DDBLT_WAIT, NULL);
+            ok(SUCCEEDED(hr), "Failed to blit, hr %#x.\n", hr);
+        }
+        QueryPerformanceCounter(&end);
+        blt_time = (end.QuadPart - start.QuadPart) * 1000.0 / frequency.QuadPart / count;
+
+        trace("%s %ux%u: %.3f ms per color fill, %.3f ms per color keyed blit.\n",
+                tests[i].name, size, size, fill_time, blt_time);
+
+        hr = IDirectDrawSurface7_Lock(dst, NULL, &surface_desc, DDLOCK_WAIT | DDLOCK_READONLY, NULL);
+        ok(SUCCEEDED(hr), "Failed to lock surface, hr %#x.\n", hr);
+        for (x = 0; x < 2; ++x)
+        {
+            if (tests[i].bpp == 16)
+                color = ((WORD *)surface_desc.lpSurface)[x];
+            else
+                color = ((DWORD *)surface_desc.lpSurface)[x] & 0x00ffffff;
+            ok(color == (x & 1 ? tests[i].fill : tests[i].r),
+                    "%s: Got unexpected color 0x%08x at %u.\n", tests[i].name, color, x);
+        }
+        hr = IDirectDrawSurface7_Unlock(dst, NULL);
+        ok(SUCCEEDED(hr), "Failed to unlock surface, hr %#x.\n", hr);
+
+        IDirectDrawSurface7_Release(dst);
+        IDirectDrawSurface7_Release(src);
+    }
+
+    IDirectDraw7_Release(ddraw);
+}
+
 START_TEST(ddraw7)
 {
     DDDEVICEIDENTIFIER2 identifier;
@@ -18676,4 +18801,8 @@ START_TEST(ddraw7)
     test_cursor_clipping();
     test_window_position();
     test_get_display_mode();
+
+    /* Timing results are only meaningful when run on their own. */
+    if (winetest_interactive)
+        test_sysmem_blit_times();
 }
@@ -137,6 +137,7 @@ static HRESULT DirectSoundDevice_Create(DirectSoundDevice ** ppDevice)
     device->ref            = 1;
     device->priolevel      = DSSCL_NORMAL;
     device->stopped        = 1;
+    device->mix_worker_count = -1;
     device->speaker_config = DSSPEAKER_COMBINED(DSSPEAKER_STEREO, DSSPEAKER_GEOMETRY_WIDE);
 
     DSOUND_ParseSpeakerConfig(device);
@@ -207,6 +208,7 @@ static ULONG DirectSoundDevice_Release(DirectSoundDevice * device)
             WaitForSingleObject(device->thread, INFINITE);
             CloseHandle(device->thread);
         }
+        DSOUND_DestroyMixWorkers(device);
 
         EnterCriticalSection(&DSOUND_renderers_lock);
         list_remove(&device->entry);
@@ -234,8 +236,8 @@ static ULONG DirectSoundDevice_Release(DirectSoundDevice * device)
         if(device->mmdevice)
             IMMDevice_Release(device->mmdevice);
         CloseHandle(device->sleepev);
-        HeapFree(GetProcessHeap(), 0, device->tmp_buffer);
-        HeapFree(GetProcessHeap(), 0, device->cp_buffer);
+        HeapFree(GetProcessHeap(), 0, device->mix_scratch.tmp_buffer);
+        HeapFree(GetProcessHeap(), 0, device->mix_scratch.cp_buffer);
         HeapFree(GetProcessHeap(), 0, device->buffer);
         device->mixlock.DebugInfo->Spare[0] = 0;
         DeleteCriticalSection(&device->mixlock);
@@ -55,61 +55,105 @@ WINE_DEFAULT_DEBUG_CHANNEL(dsound);
 #define le32(x) (x)
 #endif
 
-static float get8(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel)
+/* The get functions convert "count" frames of one channel, starting at byte
+ * offset "pos" of the secondary buffer, to a contiguous array of floats. The
+ * put functions write "count" frames of one channel to the interleaved
+ * buffer "dst", which has the device's channel count. */
+
+static void get8(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel, float *dst, UINT count)
 {
-    const BYTE* buf = dsb->buffer->memory;
-    buf += pos + channel;
-    return (buf[0] - 0x80) / (float)0x80;
+    const BYTE *buf = dsb->buffer->memory + pos + channel;
+    UINT stride = dsb->pwfx->nBlockAlign;
+
+    while (count--)
+    {
+        *dst++ = (buf[0] - 0x80) / (float)0x80;
+        buf += stride;
+    }
 }
 
-static float get16(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel)
+static void get16(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel, float *dst, UINT count)
 {
-    const BYTE* buf = dsb->buffer->memory;
-    const SHORT *sbuf = (const SHORT*)(buf + pos + 2 * channel);
-    SHORT sample = (SHORT)le16(*sbuf);
-    return sample / (float)0x8000;
+    const BYTE *buf = dsb->buffer->memory + pos + 2 * channel;
+    UINT stride = dsb->pwfx->nBlockAlign;
+
+    while (count--)
+    {
+        SHORT sample = (SHORT)le16(*(const SHORT *)buf);
+        *dst++ = sample / (float)0x8000;
+        buf += stride;
+    }
 }
 
-static float get24(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel)
+static void get24(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel, float *dst, UINT count)
 {
+    const BYTE *buf = dsb->buffer->memory + pos + 3 * channel;
+    UINT stride = dsb->pwfx->nBlockAlign;
     LONG sample;
-    const BYTE* buf = dsb->buffer->memory;
-    buf += pos + 3 * channel;
-    /* The next expression deliberately has an overflow for buf[2] >= 0x80,
-       this is how negative values are made.
-     */
-    sample = (buf[0] << 8) | (buf[1] << 16) | (buf[2] << 24);
-    return sample / (float)0x80000000U;
+
+    while (count--)
+    {
+        /* The next expression deliberately has an overflow for buf[2] >= 0x80,
+           this is how negative values are made.
+         */
+        sample = (buf[0] << 8) | (buf[1] << 16) | (buf[2] << 24);
+        *dst++ = sample / (float)0x80000000U;
+        buf += stride;
+    }
 }
 
-static float get32(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel)
+static void get32(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel, float *dst, UINT count)
 {
-    const BYTE* buf = dsb->buffer->memory;
-    const LONG *sbuf = (const LONG*)(buf + pos + 4 * channel);
-    LONG sample = le32(*sbuf);
-    return sample / (float)0x80000000U;
+    const BYTE *buf = dsb->buffer->memory + pos + 4 * channel;
+    UINT stride = dsb->pwfx->nBlockAlign;
+
+    while (count--)
+    {
+        LONG sample = le32(*(const LONG *)buf);
+        *dst++ = sample / (float)0x80000000U;
+        buf += stride;
+    }
 }
 
-static float getieee32(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel)
+static void getieee32(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel, float *dst, UINT count)
 {
-    const BYTE* buf = dsb->buffer->memory;
-    const float *sbuf = (const float*)(buf + pos + 4 * channel);
+    const BYTE *buf = dsb->buffer->memory + pos + 4 * channel;
+    UINT stride = dsb->pwfx->nBlockAlign;
+
     /* The value will be clipped later, when put into some non-float buffer */
-    return *sbuf;
+    while (count--)
+    {
+        *dst++ = *(const float *)buf;
+        buf += stride;
+    }
 }
 
 const bitsgetfunc getbpp[5] = {get8, get16, get24, get32, getieee32};
 
-float get_mono(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel)
+void get_mono(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel, float *dst, UINT count)
 {
     DWORD channels = dsb->pwfx->nChannels;
+    float tmp[DS_MIX_BLOCK_FRAMES];
+    UINT block, i;
     DWORD c;
-    float val = 0;
+
     /* XXX: does Windows include LFE into the mix? */
-    for (c = 0; c < channels; c++)
-        val += dsb->get_aux(dsb, pos, c);
-    val /= channels;
-    return val;
+    while (count)
+    {
+        block = min(count, ARRAY_SIZE(tmp));
+        dsb->get_aux(dsb, pos, 0, dst, block);
+        for (c = 1; c < channels; c++)
+        {
+            dsb->get_aux(dsb, pos, c, tmp, block);
+            dsound_mix_funcs.mix(dst, tmp, block);
+        }
+        for (i = 0; i < block; ++i)
+            dst[i] /= channels;
+
+        pos += block * dsb->pwfx->nBlockAlign;
+        dst += block;
+        count -= block;
+    }
 }
 
 static inline unsigned char f_to_8(float value)
@@ -148,98 +192,135 @@ static inline LONG f_to_32(float value)
     return le32(lrintf(value * 0x80000000U));
 }
 
-void putieee32(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel, float value)
+void putieee32(const IDirectSoundBufferImpl *dsb, float *dst, DWORD channel, const float *src, UINT count)
 {
-    BYTE *buf = (BYTE *)dsb->device->tmp_buffer;
-    float *fbuf = (float*)(buf + pos + sizeof(float) * channel);
-    *fbuf = value;
+    UINT stride = dsb->device->pwfx->nChannels;
+    float *fbuf = dst + channel;
+
+    while (count--)
+    {
+        *fbuf = *src++;
+        fbuf += stride;
+    }
 }
 
-void putieee32_sum(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel, float value)
+void putieee32_sum(const IDirectSoundBufferImpl *dsb, float *dst, DWORD channel, const float *src, UINT count)
 {
-    BYTE *buf = (BYTE *)dsb->device->tmp_buffer;
-    float *fbuf = (float*)(buf + pos + sizeof(float) * channel);
-    *fbuf += value;
+    UINT stride = dsb->device->pwfx->nChannels;
+    float *fbuf = dst + channel;
+
+    while (count--)
+    {
+        *fbuf += *src++;
+        fbuf += stride;
+    }
 }
 
-void put_mono2stereo(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel, float value)
+/* Only used by the downmixing functions, which always sum. */
+static void putieee32_sum_scaled(const IDirectSoundBufferImpl *dsb, float *dst, DWORD channel,
+        const float *src, UINT count, float scale)
 {
-    dsb->put_aux(dsb, pos, 0, value);
-    dsb->put_aux(dsb, pos, 1, value);
+    UINT stride = dsb->device->pwfx->nChannels;
+    float *fbuf = dst + channel;
+
+    while (count--)
+    {
+        *fbuf += *src++ * scale;
+        fbuf += stride;
+    }
 }
 
-void put_mono2quad(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel, float value)
+static void putieee32_silence(const IDirectSoundBufferImpl *dsb, float *dst, DWORD channel, UINT count)
 {
-    dsb->put_aux(dsb, pos, 0, value);
-    dsb->put_aux(dsb, pos, 1, value);
-    dsb->put_aux(dsb, pos, 2, value);
-    dsb->put_aux(dsb, pos, 3, value);
+    UINT stride = dsb->device->pwfx->nChannels;
+    float *fbuf = dst + channel;
+
+    while (count--)
+    {
+        *fbuf = 0.0f;
+        fbuf += stride;
+    }
+}
+
+void put_mono2stereo(const IDirectSoundBufferImpl *dsb, float *dst, DWORD channel, const float *src, UINT count)
+{
+    float *fbuf = dst;
+
+    /* The most common case, so don't go through put_aux. */
+    while (count--)
+    {
+        fbuf[0] = fbuf[1] = *src++;
+        fbuf += 2;
+    }
 }
 
-void put_stereo2quad(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel, float value)
+void put_mono2quad(const IDirectSoundBufferImpl *dsb, float *dst, DWORD channel, const float *src, UINT count)
+{
+    dsb->put_aux(dsb, dst, 0, src, count);
+    dsb->put_aux(dsb, dst, 1, src, count);
+    dsb->put_aux(dsb, dst, 2, src, count);
+    dsb->put_aux(dsb, dst, 3, src, count);
+}
+
+void put_stereo2quad(const IDirectSoundBufferImpl *dsb, float *dst, DWORD channel, const float *src, UINT count)
 {
     if (channel == 0) { /* Left */
-        dsb->put_aux(dsb, pos, 0, value); /* Front left */
-        dsb->put_aux(dsb, pos, 2, value); /* Back left */
+        dsb->put_aux(dsb, dst, 0, src, count); /* Front left */
+        dsb->put_aux(dsb, dst, 2, src, count); /* Back left */
     } else if (channel == 1) { /* Right */
-        dsb->put_aux(dsb, pos, 1, value); /* Front right */
-        dsb->put_aux(dsb, pos, 3, value); /* Back right */
+        dsb->put_aux(dsb, dst, 1, src, count); /* Front right */
+        dsb->put_aux(dsb, dst, 3, src, count); /* Back right */
     }
 }
 
-void put_mono2surround51(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel, float value)
+void put_mono2surround51(const IDirectSoundBufferImpl *dsb, float *dst, DWORD channel, const float *src, UINT count)
 {
-    dsb->put_aux(dsb, pos, 0, value);
-    dsb->put_aux(dsb, pos, 1, value);
-    dsb->put_aux(dsb, pos, 2, value);
-    dsb->put_aux(dsb, pos, 3, value);
-    dsb->put_aux(dsb, pos, 4, value);
-    dsb->put_aux(dsb, pos, 5, value);
+    dsb->put_aux(dsb, dst, 0, src, count);
+    dsb->put_aux(dsb, dst, 1, src, count);
+    dsb->put_aux(dsb, dst, 2, src, count);
+    dsb->put_aux(dsb, dst, 3, src, count);
+    dsb->put_aux(dsb, dst, 4, src, count);
+    dsb->put_aux(dsb, dst, 5, src, count);
 }
 
-void put_stereo2surround51(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel, float value)
+void put_stereo2surround51(const IDirectSoundBufferImpl *dsb, float *dst, DWORD channel, const float *src, UINT count)
 {
     if (channel == 0) { /* Left */
-        dsb->put_aux(dsb, pos, 0, value); /* Front left */
-        dsb->put_aux(dsb, pos, 4, value); /* Back left */
+        dsb->put_aux(dsb, dst, 0, src, count); /* Front left */
+        dsb->put_aux(dsb, dst, 4, src, count); /* Back left */
 
-        dsb->put_aux(dsb, pos, 2, 0.0f); /* Mute front centre */
-        dsb->put_aux(dsb, pos, 3, 0.0f); /* Mute LFE */
+        putieee32_silence(dsb, dst, 2, count); /* Mute front centre */
+        putieee32_silence(dsb, dst, 3, count); /* Mute LFE */
     } else if (channel == 1) { /* Right */
-        dsb->put_aux(dsb, pos, 1, value); /* Front right */
-        dsb->put_aux(dsb, pos, 5, value); /* Back right */
+        dsb->put_aux(dsb, dst, 1, src, count); /* Front right */
+        dsb->put_aux(dsb, dst, 5, src, count); /* Back right */
     }
 }
 
-void put_surround512stereo(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel, float value)
+void put_surround512stereo(const IDirectSoundBufferImpl *dsb, float *dst, DWORD channel, const float *src, UINT count)
 {
     /* based on analyzing a recording of a dsound downmix */
     switch(channel){
 
     case 4: /* surround left */
-        value *= 0.24f;
-        dsb->put_aux(dsb, pos, 0, value);
+        putieee32_sum_scaled(dsb, dst, 0, src, count, 0.24f);
         break;
 
     case 0: /* front left */
-        value *= 1.0f;
-        dsb->put_aux(dsb, pos, 0, value);
+        dsb->put_aux(dsb, dst, 0, src, count);
         break;
 
     case 5: /* surround right */
-        value *= 0.24f;
-        dsb->put_aux(dsb, pos, 1, value);
+        putieee32_sum_scaled(dsb, dst, 1, src, count, 0.24f);
         break;
 
     case 1: /* front right */
-        value *= 1.0f;
-        dsb->put_aux(dsb, pos, 1, value);
+        dsb->put_aux(dsb, dst, 1, src, count);
         break;
 
     case 2: /* centre */
-        value *= 0.7;
-        dsb->put_aux(dsb, pos, 0, value);
-        dsb->put_aux(dsb, pos, 1, value);
+        putieee32_sum_scaled(dsb, dst, 0, src, count, 0.7f);
+        putieee32_sum_scaled(dsb, dst, 1, src, count, 0.7f);
         break;
 
     case 3:
@@ -248,45 +329,38 @@ void put_surround512stereo(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD c
     }
 }
 
-void put_surround712stereo(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel, float value)
+void put_surround712stereo(const IDirectSoundBufferImpl *dsb, float *dst, DWORD channel, const float *src, UINT count)
 {
     /* based on analyzing a recording of a dsound downmix */
     switch(channel){
 
     case 6: /* back left */
-        value *= 0.24f;
-        dsb->put_aux(dsb, pos, 0, value);
+        putieee32_sum_scaled(dsb, dst, 0, src, count, 0.24f);
         break;
 
     case 4: /* surround left */
-        value *= 0.24f;
-        dsb->put_aux(dsb, pos, 0, value);
+        putieee32_sum_scaled(dsb, dst, 0, src, count, 0.24f);
         break;
 
     case 0: /* front left */
-        value *= 1.0f;
-        dsb->put_aux(dsb, pos, 0, value);
+        dsb->put_aux(dsb, dst, 0, src, count);
         break;
 
     case 7: /* back right */
-        value *= 0.24f;
-        dsb->put_aux(dsb, pos, 1, value);
+        putieee32_sum_scaled(dsb, dst, 1, src, count, 0.24f);
         break;
 
     case 5: /* surround right */
-        value *= 0.24f;
-        dsb->put_aux(dsb, pos, 1, value);
+        putieee32_sum_scaled(dsb, dst, 1, src, count, 0.24f);
         break;
 
     case 1: /* front right */
-        value *= 1.0f;
-        dsb->put_aux(dsb, pos, 1, value);
+        dsb->put_aux(dsb, dst, 1, src, count);
         break;
 
     case 2: /* centre */
-        value *= 0.7;
-        dsb->put_aux(dsb, pos, 0, value);
-        dsb->put_aux(dsb, pos, 1, value);
+        putieee32_sum_scaled(dsb, dst, 0, src, count, 0.7f);
+        putieee32_sum_scaled(dsb, dst, 1, src, count, 0.7f);
         break;
 
     case 3:
@@ -295,40 +369,62 @@ void put_surround712stereo(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD c
     }
 }
 
-void put_quad2stereo(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel, float value)
+void put_quad2stereo(const IDirectSoundBufferImpl *dsb, float *dst, DWORD channel, const float *src, UINT count)
 {
     /* based on pulseaudio's downmix algorithm */
     switch(channel){
 
     case 2: /* back left */
-        value *= 0.1f; /* (1/9) / (sum of left volumes) */
-        dsb->put_aux(dsb, pos, 0, value);
+        putieee32_sum_scaled(dsb, dst, 0, src, count, 0.1f); /* (1/9) / (sum of left volumes) */
         break;
 
     case 0: /* front left */
-        value *= 0.9f; /* 1 / (sum of left volumes) */
-        dsb->put_aux(dsb, pos, 0, value);
+        putieee32_sum_scaled(dsb, dst, 0, src, count, 0.9f); /* 1 / (sum of left volumes) */
         break;
 
     case 3: /* back right */
-        value *= 0.1f; /* (1/9) / (sum of right volumes) */
-        dsb->put_aux(dsb, pos, 1, value);
+        putieee32_sum_scaled(dsb, dst, 1, src, count, 0.1f); /* (1/9) / (sum of right volumes) */
         break;
 
     case 1: /* front right */
-        value *= 0.9f; /* 1 / (sum of right volumes) */
-        dsb->put_aux(dsb, pos, 1, value);
+        putieee32_sum_scaled(dsb, dst, 1, src, count, 0.9f); /* 1 / (sum of right volumes) */
         break;
     }
 }
 
-void mixieee32(float *src, float *dst, unsigned samples)
+static void mixieee32(float *dst, const float *src, unsigned int count)
 {
-    TRACE("%p - %p %d\n", src, dst, samples);
-    while (samples--)
+    while (count--)
         *(dst++) += *(src++);
 }
 
+static void scaleieee32(float *dst, const float *vols, unsigned int channels, unsigned int frames)
+{
+    unsigned int i, chan;
+
+    for (i = 0; i < frames; ++i)
+    {
+        for (chan = 0; chan < channels; ++chan)
+            dst[i * channels + chan] *= vols[chan];
+    }
+}
+
+static float dotieee32(const float *a, const float *b, unsigned int count)
+{
+    float sum = 0.0f;
+
+    while (count--)
+        sum += *(a++) * *(b++);
+    return sum;
+}
+
+struct dsound_mix_funcs dsound_mix_funcs =
+{
+    mixieee32,
+    scaleieee32,
+    dotieee32,
+};
+
 static void norm8(float *src, unsigned char *dst, unsigned samples)
 {
     TRACE("%p - %p %d\n", src, dst, samples);
@@ -92,6 +92,8 @@ const WCHAR wine_vxd_drv[] = L"winemm.vxd";
 
 /* All default settings, you most likely don't want to touch these, see wiki on UsefulRegistryKeys */
 int ds_hel_buflen = 32768 * 2;
+int ds_parallel_mix_buffers = 32;
+int ds_mix_threads = -1;
 static HINSTANCE instance;
 
 /*
@@ -144,10 +146,18 @@ void setup_dsound_options(void)
     if (!get_config_key( hkey, appkey, "HelBuflen", buffer, MAX_PATH ))
         ds_hel_buflen = atoi(buffer);
 
+    if (!get_config_key( hkey, appkey, "ParallelMixBuffers", buffer, MAX_PATH ))
+        ds_parallel_mix_buffers = atoi(buffer);
+
+    if (!get_config_key( hkey, appkey, "MixThreads", buffer, MAX_PATH ))
+        ds_mix_threads = atoi(buffer);
+
     if (appkey) RegCloseKey( appkey );
     if (hkey) RegCloseKey( hkey );
 
     TRACE("ds_hel_buflen = %d\n", ds_hel_buflen);
+    TRACE("ds_parallel_mix_buffers = %d\n", ds_parallel_mix_buffers);
+    TRACE("ds_mix_threads = %d\n", ds_mix_threads);
 }
 
 static const char * get_device_id(LPCGUID pGuid)
@@ -792,6 +802,7 @@ BOOL WINAPI DllMain(HINSTANCE hInstDLL, DWORD fdwReason, LPVOID lpvReserved)
         DisableThreadLibraryCalls(hInstDLL);
         /* Increase refcount on dsound by 1 */
         GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS, (LPCWSTR)hInstDLL, &hInstDLL);
+        dsound_init_mix_funcs();
         break;
     case DLL_PROCESS_DETACH:
         if (lpvReserved) break;
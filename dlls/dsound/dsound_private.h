@@ -35,6 +35,8 @@
 #define DS_MAX_CHANNELS 6
 
 extern int ds_hel_buflen DECLSPEC_HIDDEN;
+extern int ds_parallel_mix_buffers DECLSPEC_HIDDEN;
+extern int ds_mix_threads DECLSPEC_HIDDEN;
 
 /*****************************************************************************
  * Predeclare the interface implementation structures
@@ -42,16 +44,32 @@ extern int ds_hel_buflen DECLSPEC_HIDDEN;
 typedef struct IDirectSoundBufferImpl        IDirectSoundBufferImpl;
 typedef struct DirectSoundDevice             DirectSoundDevice;
 
+/* Number of frames converted at a time when a temporary buffer is needed. */
+#define DS_MIX_BLOCK_FRAMES 256
+
 /* dsound_convert.h */
-typedef float (*bitsgetfunc)(const IDirectSoundBufferImpl *, DWORD, DWORD);
-typedef void (*bitsputfunc)(const IDirectSoundBufferImpl *, DWORD, DWORD, float);
+typedef void (*bitsgetfunc)(const IDirectSoundBufferImpl *, DWORD, DWORD, float *, UINT);
+typedef void (*bitsputfunc)(const IDirectSoundBufferImpl *, float *, DWORD, const float *, UINT);
 extern const bitsgetfunc getbpp[5] DECLSPEC_HIDDEN;
-void putieee32(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel, float value) DECLSPEC_HIDDEN;
-void putieee32_sum(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel, float value) DECLSPEC_HIDDEN;
-void mixieee32(float *src, float *dst, unsigned samples) DECLSPEC_HIDDEN;
+void putieee32(const IDirectSoundBufferImpl *dsb, float *dst, DWORD channel, const float *src, UINT count) DECLSPEC_HIDDEN;
+void putieee32_sum(const IDirectSoundBufferImpl *dsb, float *dst, DWORD channel, const float *src, UINT count) DECLSPEC_HIDDEN;
 typedef void (*normfunc)(const void *, void *, unsigned);
 extern const normfunc normfunctions[4] DECLSPEC_HIDDEN;
 
+/* Float loops of the mixer that have vectorized versions, see simd.c. */
+struct dsound_mix_funcs
+{
+    /* dst[i] += src[i] */
+    void (*mix)(float *dst, const float *src, unsigned int count);
+    /* Multiplies each channel of interleaved frames by its volume. */
+    void (*scale)(float *dst, const float *vols, unsigned int channels, unsigned int frames);
+    float (*dot)(const float *a, const float *b, unsigned int count);
+};
+
+extern struct dsound_mix_funcs dsound_mix_funcs DECLSPEC_HIDDEN;
+
+void dsound_init_mix_funcs(void) DECLSPEC_HIDDEN;
+
 typedef struct _DSVOLUMEPAN
 {
     DWORD	dwTotalAmpFactor[DS_MAX_CHANNELS];
@@ -65,6 +83,26 @@ typedef struct DSFilter {
     IMediaObjectInPlace* inplace;
 } DSFilter;
 
+/* Temporary buffers used while mixing a secondary buffer. The mixer thread
+ * and each mixing worker have their own. */
+struct dsound_mix_scratch
+{
+    float *tmp_buffer, *cp_buffer;
+    DWORD tmp_buffer_len, cp_buffer_len;
+};
+
+/* A thread mixing part of the secondary buffers into its own sum, which the
+ * mixer thread adds to the device buffer afterwards. */
+struct dsound_mix_worker
+{
+    DirectSoundDevice *device;
+    HANDLE thread, event;
+    struct dsound_mix_scratch scratch;
+    float *sum;
+    DWORD sum_len;
+    BOOL mixed, playing;
+};
+
 /*****************************************************************************
  * IDirectSoundDevice implementation structure
  */
@@ -88,8 +126,15 @@ struct DirectSoundDevice
     int                         speaker_num[DS_MAX_CHANNELS];
     int                         num_speakers;
     int                         lfe_channel;
-    float *tmp_buffer, *cp_buffer;
-    DWORD                       tmp_buffer_len, cp_buffer_len;
+    struct dsound_mix_scratch   mix_scratch;
+
+    /* parallel mixing, see DSOUND_MixToPrimary() */
+    struct dsound_mix_worker   *mix_workers;
+    int                         mix_worker_count;
+    LONG                        mix_next, mix_pending;
+    DWORD                       mix_frames;
+    HANDLE                      mix_done;
+    BOOL                        mix_exit;
 
     DSVOLUMEPAN                 volpan;
 
@@ -171,15 +216,23 @@ struct IDirectSoundBufferImpl
     struct list entry;
 };
 
-float get_mono(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel) DECLSPEC_HIDDEN;
-void put_mono2stereo(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel, float value) DECLSPEC_HIDDEN;
-void put_mono2quad(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel, float value) DECLSPEC_HIDDEN;
-void put_stereo2quad(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel, float value) DECLSPEC_HIDDEN;
-void put_mono2surround51(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel, float value) DECLSPEC_HIDDEN;
-void put_stereo2surround51(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel, float value) DECLSPEC_HIDDEN;
-void put_surround512stereo(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel, float value) DECLSPEC_HIDDEN;
-void put_surround712stereo(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel, float value) DECLSPEC_HIDDEN;
-void put_quad2stereo(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel, float value) DECLSPEC_HIDDEN;
+void get_mono(const IDirectSoundBufferImpl *dsb, DWORD pos, DWORD channel, float *dst, UINT count) DECLSPEC_HIDDEN;
+void put_mono2stereo(const IDirectSoundBufferImpl *dsb, float *dst, DWORD channel,
+        const float *src, UINT count) DECLSPEC_HIDDEN;
+void put_mono2quad(const IDirectSoundBufferImpl *dsb, float *dst, DWORD channel,
+        const float *src, UINT count) DECLSPEC_HIDDEN;
+void put_stereo2quad(const IDirectSoundBufferImpl *dsb, float *dst, DWORD channel,
+        const float *src, UINT count) DECLSPEC_HIDDEN;
+void put_mono2surround51(const IDirectSoundBufferImpl *dsb, float *dst, DWORD channel,
+        const float *src, UINT count) DECLSPEC_HIDDEN;
+void put_stereo2surround51(const IDirectSoundBufferImpl *dsb, float *dst, DWORD channel,
+        const float *src, UINT count) DECLSPEC_HIDDEN;
+void put_surround512stereo(const IDirectSoundBufferImpl *dsb, float *dst, DWORD channel,
+        const float *src, UINT count) DECLSPEC_HIDDEN;
+void put_surround712stereo(const IDirectSoundBufferImpl *dsb, float *dst, DWORD channel,
+        const float *src, UINT count) DECLSPEC_HIDDEN;
+void put_quad2stereo(const IDirectSoundBufferImpl *dsb, float *dst, DWORD channel,
+        const float *src, UINT count) DECLSPEC_HIDDEN;
 
 HRESULT secondarybuffer_create(DirectSoundDevice *device, const DSBUFFERDESC *dsbd,
         IDirectSoundBuffer **buffer) DECLSPEC_HIDDEN;
@@ -229,6 +282,7 @@ void DSOUND_RecalcFormat(IDirectSoundBufferImpl *dsb) DECLSPEC_HIDDEN;
 DWORD DSOUND_secpos_to_bufpos(const IDirectSoundBufferImpl *dsb, DWORD secpos, DWORD secmixpos, float *overshot) DECLSPEC_HIDDEN;
 
 DWORD CALLBACK DSOUND_mixthread(void *ptr) DECLSPEC_HIDDEN;
+void DSOUND_DestroyMixWorkers(DirectSoundDevice *device) DECLSPEC_HIDDEN;
 
 /* sound3d.c */
 
@@ -275,31 +275,59 @@ void DSOUND_CheckEvent(const IDirectSoundBufferImpl *dsb, DWORD playpos, int len
     }
 }
 
-static inline float get_current_sample(const IDirectSoundBufferImpl *dsb,
-        DWORD mixpos, DWORD channel)
+/* Converts "count" frames of one channel to floats, handling wraparound and
+ * the end of non-looping buffers. */
+static void get_current_samples(const IDirectSoundBufferImpl *dsb,
+        DWORD mixpos, DWORD channel, float *dst, UINT count)
 {
-    if (mixpos >= dsb->buflen && !(dsb->playflags & DSBPLAY_LOOPING))
-        return 0.0f;
-    return dsb->get(dsb, mixpos % dsb->buflen, channel);
+    UINT istride = dsb->pwfx->nBlockAlign;
+    UINT block;
+
+    while (count)
+    {
+        if (mixpos >= dsb->buflen)
+        {
+            if (!(dsb->playflags & DSBPLAY_LOOPING))
+            {
+                memset(dst, 0, count * sizeof(*dst));
+                return;
+            }
+            mixpos %= dsb->buflen;
+        }
+
+        if (!(block = min(count, (dsb->buflen - mixpos) / istride)))
+            block = 1;
+        dsb->get(dsb, mixpos, channel, dst, block);
+
+        mixpos += block * istride;
+        dst += block;
+        count -= block;
+    }
 }
 
-static UINT cp_fields_noresample(IDirectSoundBufferImpl *dsb, UINT count)
+static UINT cp_fields_noresample(IDirectSoundBufferImpl *dsb, struct dsound_mix_scratch *scratch, UINT count)
 {
     UINT istride = dsb->pwfx->nBlockAlign;
-    UINT ostride = dsb->device->pwfx->nChannels * sizeof(float);
-    DWORD channel, i;
-    for (i = 0; i < count; i++)
+    UINT ochannels = dsb->device->pwfx->nChannels;
+    float tmp[DS_MIX_BLOCK_FRAMES];
+    DWORD channel, i, block;
+
+    for (i = 0; i < count; i += block)
+    {
+        block = min(count - i, DS_MIX_BLOCK_FRAMES);
         for (channel = 0; channel < dsb->mix_channels; channel++)
-            dsb->put(dsb, i * ostride, channel, get_current_sample(dsb,
-                    dsb->sec_mixpos + i * istride, channel));
+        {
+            get_current_samples(dsb, dsb->sec_mixpos + i * istride, channel, tmp, block);
+            dsb->put(dsb, scratch->tmp_buffer + i * ochannels, channel, tmp, block);
+        }
+    }
     return count;
 }
 
-static UINT cp_fields_resample(IDirectSoundBufferImpl *dsb, UINT count, LONG64 *freqAccNum)
+static UINT cp_fields_resample(IDirectSoundBufferImpl *dsb, struct dsound_mix_scratch *scratch,
+        UINT count, LONG64 *freqAccNum)
 {
     UINT i, channel;
-    UINT istride = dsb->pwfx->nBlockAlign;
-    UINT ostride = dsb->device->pwfx->nChannels * sizeof(float);
 
     LONG64 freqAcc_start = *freqAccNum;
     LONG64 freqAcc_end = freqAcc_start + count * dsb->freqAdjustNum;
@@ -309,22 +337,24 @@ static UINT cp_fields_resample(IDirectSoundBufferImpl *dsb, UINT count, LONG64 *
 
     UINT fir_cachesize = (fir_len + dsbfirstep - 2) / dsbfirstep;
     UINT required_input = max_ipos + fir_cachesize;
-    float *intermediate, *fir_copy, *itmp;
+    float *intermediate, *fir_copy, *output, *itmp;
 
     DWORD len = required_input * channels;
     len += fir_cachesize;
+    len += count * channels;
     len *= sizeof(float);
 
-    if (!dsb->device->cp_buffer) {
-        dsb->device->cp_buffer = HeapAlloc(GetProcessHeap(), 0, len);
-        dsb->device->cp_buffer_len = len;
-    } else if (len > dsb->device->cp_buffer_len) {
-        dsb->device->cp_buffer = HeapReAlloc(GetProcessHeap(), 0, dsb->device->cp_buffer, len);
-        dsb->device->cp_buffer_len = len;
+    if (!scratch->cp_buffer) {
+        scratch->cp_buffer = HeapAlloc(GetProcessHeap(), 0, len);
+        scratch->cp_buffer_len = len;
+    } else if (len > scratch->cp_buffer_len) {
+        scratch->cp_buffer = HeapReAlloc(GetProcessHeap(), 0, scratch->cp_buffer, len);
+        scratch->cp_buffer_len = len;
     }
 
-    fir_copy = dsb->device->cp_buffer;
+    fir_copy = scratch->cp_buffer;
     intermediate = fir_copy + fir_cachesize;
+    output = intermediate + required_input * channels;
 
 
     /* Important: this buffer MUST be non-interleaved
@@ -333,9 +363,10 @@ static UINT cp_fields_resample(IDirectSoundBufferImpl *dsb, UINT count, LONG64 *
      */
     itmp = intermediate;
     for (channel = 0; channel < channels; channel++)
-        for (i = 0; i < required_input; i++)
-            *(itmp++) = get_current_sample(dsb,
-                    dsb->sec_mixpos + i * istride, channel);
+    {
+        get_current_samples(dsb, dsb->sec_mixpos, channel, itmp, required_input);
+        itmp += required_input;
+    }
 
     for(i = 0; i < count; ++i) {
         UINT int_fir_steps = (freqAcc_start + i * dsb->freqAdjustNum) * dsbfirstep / dsb->freqAdjustDen;
@@ -354,29 +385,30 @@ static UINT cp_fields_resample(IDirectSoundBufferImpl *dsb, UINT count, LONG64 *
         assert(fir_used <= fir_cachesize);
         assert(ipos + fir_used <= required_input);
 
-        for (channel = 0; channel < dsb->mix_channels; channel++) {
-            int j;
-            float sum = 0.0;
+        for (channel = 0; channel < channels; channel++) {
             float* cache = &intermediate[channel * required_input + ipos];
-            for (j = 0; j < fir_used; j++)
-                sum += fir_copy[j] * cache[j];
-            dsb->put(dsb, i * ostride, channel, sum * dsb->firgain);
+            float sum = dsound_mix_funcs.dot(fir_copy, cache, fir_used);
+            output[channel * count + i] = sum * dsb->firgain;
         }
     }
 
+    for (channel = 0; channel < channels; channel++)
+        dsb->put(dsb, scratch->tmp_buffer, channel, &output[channel * count], count);
+
     *freqAccNum = freqAcc_end % dsb->freqAdjustDen;
 
     return max_ipos;
 }
 
-static void cp_fields(IDirectSoundBufferImpl *dsb, UINT count, LONG64 *freqAccNum)
+static void cp_fields(IDirectSoundBufferImpl *dsb, struct dsound_mix_scratch *scratch,
+        UINT count, LONG64 *freqAccNum)
 {
     DWORD ipos, adv;
 
     if (dsb->freqAdjustNum == dsb->freqAdjustDen)
-        adv = cp_fields_noresample(dsb, count); /* *freqAccNum is unmodified */
+        adv = cp_fields_noresample(dsb, scratch, count); /* *freqAccNum is unmodified */
     else
-        adv = cp_fields_resample(dsb, count, freqAccNum);
+        adv = cp_fields_resample(dsb, scratch, count, freqAccNum);
 
     ipos = dsb->sec_mixpos + adv * dsb->pwfx->nBlockAlign;
     if (ipos >= dsb->buflen) {
@@ -419,29 +451,29 @@ static inline DWORD DSOUND_BufPtrDiff(DWORD buflen, DWORD ptr1, DWORD ptr2)
  *
  * NOTE: writepos + len <= buflen. When called by mixer, MixOne makes sure of this.
  */
-static void DSOUND_MixToTemporary(IDirectSoundBufferImpl *dsb, DWORD frames)
+static void DSOUND_MixToTemporary(IDirectSoundBufferImpl *dsb, struct dsound_mix_scratch *scratch, DWORD frames)
 {
 	UINT size_bytes = frames * sizeof(float) * dsb->device->pwfx->nChannels;
 	HRESULT hr;
 	int i;
 
-	if (dsb->device->tmp_buffer_len < size_bytes || !dsb->device->tmp_buffer)
+	if (scratch->tmp_buffer_len < size_bytes || !scratch->tmp_buffer)
 	{
-		dsb->device->tmp_buffer_len = size_bytes;
-		if (dsb->device->tmp_buffer)
-			dsb->device->tmp_buffer = HeapReAlloc(GetProcessHeap(), 0, dsb->device->tmp_buffer, size_bytes);
+		scratch->tmp_buffer_len = size_bytes;
+		if (scratch->tmp_buffer)
+			scratch->tmp_buffer = HeapReAlloc(GetProcessHeap(), 0, scratch->tmp_buffer, size_bytes);
 		else
-			dsb->device->tmp_buffer = HeapAlloc(GetProcessHeap(), 0, size_bytes);
+			scratch->tmp_buffer = HeapAlloc(GetProcessHeap(), 0, size_bytes);
 	}
 	if(dsb->put_aux == putieee32_sum)
-		memset(dsb->device->tmp_buffer, 0, dsb->device->tmp_buffer_len);
+		memset(scratch->tmp_buffer, 0, scratch->tmp_buffer_len);
 
-	cp_fields(dsb, frames, &dsb->freqAccNum);
+	cp_fields(dsb, scratch, frames, &dsb->freqAccNum);
 
 	if (size_bytes > 0) {
 		for (i = 0; i < dsb->num_filters; i++) {
 			if (dsb->filters[i].inplace) {
-				hr = IMediaObjectInPlace_Process(dsb->filters[i].inplace, size_bytes, (BYTE*)dsb->device->tmp_buffer, 0, DMO_INPLACE_NORMAL);
+				hr = IMediaObjectInPlace_Process(dsb->filters[i].inplace, size_bytes, (BYTE*)scratch->tmp_buffer, 0, DMO_INPLACE_NORMAL);
 
 				if (FAILED(hr))
 					WARN("IMediaObjectInPlace_Process failed for filter %u\n", i);
@@ -451,11 +483,11 @@ static void DSOUND_MixToTemporary(IDirectSoundBufferImpl *dsb, DWORD frames)
 	}
 }
 
-static void DSOUND_MixerVol(const IDirectSoundBufferImpl *dsb, INT frames)
+static void DSOUND_MixerVol(const IDirectSoundBufferImpl *dsb, struct dsound_mix_scratch *scratch, INT frames)
 {
 	INT	i;
 	float vols[DS_MAX_CHANNELS];
-	UINT channels = dsb->device->pwfx->nChannels, chan;
+	UINT channels = dsb->device->pwfx->nChannels;
 
 	TRACE("(%p,%d)\n",dsb,frames);
 	TRACE("left = %x, right = %x\n", dsb->volpan.dwTotalAmpFactor[0],
@@ -475,11 +507,7 @@ static void DSOUND_MixerVol(const IDirectSoundBufferImpl *dsb, INT frames)
 	for (i = 0; i < channels; ++i)
 		vols[i] = dsb->volpan.dwTotalAmpFactor[i] / ((float)0xFFFF);
 
-	for(i = 0; i < frames; ++i){
-		for(chan = 0; chan < channels; ++chan){
-			dsb->device->tmp_buffer[i * channels + chan] *= vols[chan];
-		}
-	}
+	dsound_mix_funcs.scale(scratch->tmp_buffer, vols, channels, frames);
 }
 
 /**
@@ -494,7 +522,8 @@ static void DSOUND_MixerVol(const IDirectSoundBufferImpl *dsb, INT frames)
  * dsb  = the secondary buffer to mix from
  * fraglen = number of bytes to mix
  */
-static DWORD DSOUND_MixInBuffer(IDirectSoundBufferImpl *dsb, float *mix_buffer, DWORD frames)
+static DWORD DSOUND_MixInBuffer(IDirectSoundBufferImpl *dsb, struct dsound_mix_scratch *scratch,
+        float *mix_buffer, DWORD frames)
 {
 	float *ibuf;
 	DWORD oldpos;
@@ -504,13 +533,13 @@ static DWORD DSOUND_MixInBuffer(IDirectSoundBufferImpl *dsb, float *mix_buffer,
 
 	/* Resample buffer to temporary buffer specifically allocated for this purpose, if needed */
 	oldpos = dsb->sec_mixpos;
-	DSOUND_MixToTemporary(dsb, frames);
-	ibuf = dsb->device->tmp_buffer;
+	DSOUND_MixToTemporary(dsb, scratch, frames);
+	ibuf = scratch->tmp_buffer;
 
 	/* Apply volume if needed */
-	DSOUND_MixerVol(dsb, frames);
+	DSOUND_MixerVol(dsb, scratch, frames);
 
-	mixieee32(ibuf, mix_buffer, frames * dsb->device->pwfx->nChannels);
+	dsound_mix_funcs.mix(mix_buffer, ibuf, frames * dsb->device->pwfx->nChannels);
 
 	/* check for notification positions */
 	if (dsb->dsbd.dwFlags & DSBCAPS_CTRLPOSITIONNOTIFY &&
@@ -533,7 +562,8 @@ static DWORD DSOUND_MixInBuffer(IDirectSoundBufferImpl *dsb, float *mix_buffer,
  *
  * Returns: the number of frames beyond the writepos that were mixed.
  */
-static DWORD DSOUND_MixOne(IDirectSoundBufferImpl *dsb, float *mix_buffer, DWORD frames)
+static DWORD DSOUND_MixOne(IDirectSoundBufferImpl *dsb, struct dsound_mix_scratch *scratch,
+        float *mix_buffer, DWORD frames)
 {
 	DWORD primary_done = 0;
 
@@ -558,7 +588,7 @@ static DWORD DSOUND_MixOne(IDirectSoundBufferImpl *dsb, float *mix_buffer, DWORD
 	/* First try to mix to the end of the buffer if possible
 	 * Theoretically it would allow for better optimization
 	*/
-	primary_done += DSOUND_MixInBuffer(dsb, mix_buffer, frames);
+	primary_done += DSOUND_MixInBuffer(dsb, scratch, mix_buffer, frames);
 
 	TRACE("total mixed data=%d\n", primary_done);
 
@@ -566,6 +596,171 @@ static DWORD DSOUND_MixOne(IDirectSoundBufferImpl *dsb, float *mix_buffer, DWORD
 	return primary_done;
 }
 
+/**
+ * Mix one secondary buffer into the given mix buffer.
+ *
+ * Returns: TRUE if the buffer is still playing.
+ */
+static BOOL DSOUND_MixBuffer(IDirectSoundBufferImpl *dsb, struct dsound_mix_scratch *scratch,
+        float *mix_buffer, DWORD frames)
+{
+	BOOL playing = FALSE;
+
+	TRACE("MixToPrimary for %p, state=%d\n", dsb, dsb->state);
+
+	if (dsb->buflen && dsb->state) {
+		TRACE("Checking %p, frames=%d\n", dsb, frames);
+		AcquireSRWLockShared(&dsb->lock);
+		/* if buffer is stopping it is stopped now */
+		if (dsb->state == STATE_STOPPING) {
+			dsb->state = STATE_STOPPED;
+			DSOUND_CheckEvent(dsb, 0, 0);
+		} else if (dsb->state != STATE_STOPPED) {
+
+			/* if the buffer was starting, it must be playing now */
+			if (dsb->state == STATE_STARTING)
+				dsb->state = STATE_PLAYING;
+
+			/* mix next buffer into the main buffer */
+			DSOUND_MixOne(dsb, scratch, mix_buffer, frames);
+
+			playing = TRUE;
+		}
+		ReleaseSRWLockShared(&dsb->lock);
+	}
+
+	return playing;
+}
+
+/**
+ * Above ds_parallel_mix_buffers playing buffers, the buffers are distributed
+ * between the mixer thread and a few worker threads. Each worker mixes the
+ * buffers it takes into its own sum, and the mixer thread adds the sums to
+ * the device buffer once all workers are done. The buffers are independent,
+ * and each one is only touched by a single thread.
+ */
+static DWORD CALLBACK DSOUND_mixworker(void *ctx)
+{
+	struct dsound_mix_worker *worker = ctx;
+	DirectSoundDevice *device = worker->device;
+	LONG i;
+
+	for (;;) {
+		WaitForSingleObject(worker->event, INFINITE);
+		if (device->mix_exit)
+			break;
+
+		worker->mixed = worker->playing = FALSE;
+		while ((i = InterlockedIncrement(&device->mix_next) - 1) < device->nrofbuffers) {
+			if (!worker->mixed) {
+				memset(worker->sum, 0, device->mix_frames * device->pwfx->nChannels * sizeof(float));
+				worker->mixed = TRUE;
+			}
+			worker->playing |= DSOUND_MixBuffer(device->buffers[i], &worker->scratch,
+					worker->sum, device->mix_frames);
+		}
+
+		if (!InterlockedDecrement(&device->mix_pending))
+			SetEvent(device->mix_done);
+	}
+
+	return 0;
+}
+
+static void DSOUND_InitMixWorkers(DirectSoundDevice *device)
+{
+	struct dsound_mix_worker *worker;
+	SYSTEM_INFO info;
+	int count;
+
+	device->mix_worker_count = 0;
+
+	if ((count = ds_mix_threads) < 0) {
+		GetSystemInfo(&info);
+		count = min(info.dwNumberOfProcessors, 4) - 1;
+	}
+	if (count <= 0 || !(device->mix_done = CreateEventW(NULL, FALSE, FALSE, NULL)))
+		return;
+	if (!(device->mix_workers = HeapAlloc(GetProcessHeap(), HEAP_ZERO_MEMORY, count * sizeof(*device->mix_workers))))
+		return;
+
+	while (device->mix_worker_count < count) {
+		worker = &device->mix_workers[device->mix_worker_count];
+		worker->device = device;
+		if (!(worker->event = CreateEventW(NULL, FALSE, FALSE, NULL)))
+			break;
+		if (!(worker->thread = CreateThread(NULL, 0, DSOUND_mixworker, worker, 0, NULL))) {
+			CloseHandle(worker->event);
+			break;
+		}
+		SetThreadPriority(worker->thread, THREAD_PRIORITY_TIME_CRITICAL);
+		++device->mix_worker_count;
+	}
+
+	TRACE("Using %d mixing threads.\n", device->mix_worker_count);
+}
+
+void DSOUND_DestroyMixWorkers(DirectSoundDevice *device)
+{
+	struct dsound_mix_worker *worker;
+	int i;
+
+	device->mix_exit = TRUE;
+	for (i = 0; i < device->mix_worker_count; ++i) {
+		worker = &device->mix_workers[i];
+		SetEvent(worker->event);
+		WaitForSingleObject(worker->thread, INFINITE);
+		CloseHandle(worker->thread);
+		CloseHandle(worker->event);
+		HeapFree(GetProcessHeap(), 0, worker->scratch.tmp_buffer);
+		HeapFree(GetProcessHeap(), 0, worker->scratch.cp_buffer);
+		HeapFree(GetProcessHeap(), 0, worker->sum);
+	}
+	HeapFree(GetProcessHeap(), 0, device->mix_workers);
+	if (device->mix_done)
+		CloseHandle(device->mix_done);
+}
+
+/* Returns FALSE if the buffers should be mixed by the mixer thread alone. */
+static BOOL DSOUND_PrepareMixWorkers(DirectSoundDevice *device, DWORD frames)
+{
+	DWORD len = frames * device->pwfx->nChannels * sizeof(float);
+	struct dsound_mix_worker *worker;
+	int i, playing = 0;
+	float *sum;
+
+	if (ds_parallel_mix_buffers <= 0 || device->nrofbuffers < ds_parallel_mix_buffers)
+		return FALSE;
+
+	for (i = 0; i < device->nrofbuffers; i++) {
+		if (device->buffers[i]->state != STATE_STOPPED)
+			++playing;
+	}
+	if (playing < ds_parallel_mix_buffers)
+		return FALSE;
+
+	if (device->mix_worker_count == -1)
+		DSOUND_InitMixWorkers(device);
+	if (!device->mix_worker_count)
+		return FALSE;
+
+	for (i = 0; i < device->mix_worker_count; ++i) {
+		worker = &device->mix_workers[i];
+		if (worker->sum_len >= len)
+			continue;
+		if (worker->sum)
+			sum = HeapReAlloc(GetProcessHeap(), 0, worker->sum, len);
+		else
+			sum = HeapAlloc(GetProcessHeap(), 0, len);
+		if (!sum)
+			return FALSE;
+		worker->sum = sum;
+		worker->sum_len = len;
+	}
+
+	return TRUE;
+}
+
 /**
  * For a DirectSoundDevice, go through all the currently playing buffers and
  * mix them in to the device buffer.
@@ -576,41 +771,42 @@ static DWORD DSOUND_MixOne(IDirectSoundBufferImpl *dsb, float *mix_buffer, DWORD
  * Returns:  the length beyond the writepos that was mixed to.
  */
 
-static void DSOUND_MixToPrimary(const DirectSoundDevice *device, float *mix_buffer, DWORD frames, BOOL *all_stopped)
+static void DSOUND_MixToPrimary(DirectSoundDevice *device, float *mix_buffer, DWORD frames, BOOL *all_stopped)
 {
-	INT i;
-	IDirectSoundBufferImpl	*dsb;
-
-	/* unless we find a running buffer, all have stopped */
-	*all_stopped = TRUE;
+	struct dsound_mix_worker *worker;
+	BOOL playing = FALSE;
+	LONG i;
 
 	TRACE("(frames %d)\n", frames);
-	for (i = 0; i < device->nrofbuffers; i++) {
-		dsb = device->buffers[i];
 
-		TRACE("MixToPrimary for %p, state=%d\n", dsb, dsb->state);
+	if (!DSOUND_PrepareMixWorkers(device, frames)) {
+		for (i = 0; i < device->nrofbuffers; i++)
+			playing |= DSOUND_MixBuffer(device->buffers[i], &device->mix_scratch, mix_buffer, frames);
+		/* unless we find a running buffer, all have stopped */
+		*all_stopped = !playing;
+		return;
+	}
 
-		if (dsb->buflen && dsb->state) {
-			TRACE("Checking %p, frames=%d\n", dsb, frames);
-			AcquireSRWLockShared(&dsb->lock);
-			/* if buffer is stopping it is stopped now */
-			if (dsb->state == STATE_STOPPING) {
-				dsb->state = STATE_STOPPED;
-				DSOUND_CheckEvent(dsb, 0, 0);
-			} else if (dsb->state != STATE_STOPPED) {
+	device->mix_next = 0;
+	device->mix_frames = frames;
+	device->mix_pending = device->mix_worker_count;
+	for (i = 0; i < device->mix_worker_count; ++i)
+		SetEvent(device->mix_workers[i].event);
 
-				/* if the buffer was starting, it must be playing now */
-				if (dsb->state == STATE_STARTING)
-					dsb->state = STATE_PLAYING;
+	while ((i = InterlockedIncrement(&device->mix_next) - 1) < device->nrofbuffers)
+		playing |= DSOUND_MixBuffer(device->buffers[i], &device->mix_scratch, mix_buffer, frames);
 
-				/* mix next buffer into the main buffer */
-				DSOUND_MixOne(dsb, mix_buffer, frames);
+	WaitForSingleObject(device->mix_done, INFINITE);
 
-				*all_stopped = FALSE;
-			}
-			ReleaseSRWLockShared(&dsb->lock);
-		}
+	for (i = 0; i < device->mix_worker_count; ++i) {
+		worker = &device->mix_workers[i];
+		if (!worker->mixed)
+			continue;
+		dsound_mix_funcs.mix(mix_buffer, worker->sum, frames * device->pwfx->nChannels);
+		playing |= worker->playing;
 	}
+
+	*all_stopped = !playing;
 }
 
 /**
@@ -656,8 +852,9 @@ static void DSOUND_WaveQueue(DirectSoundDevice *device, LPBYTE pos, DWORD bytes)
  * The mixing procedure goes:
  *
  * secondary->buffer (secondary format)
- *   =[Resample]=> device->tmp_buffer (float format)
- *   =[Volume]=> device->tmp_buffer (float format)
+ *   =[Resample]=> tmp_buffer (float format)
+ *   =[Volume]=> tmp_buffer (float format)
+ *   =[Sum]=> worker sums (float format, only with many buffers)
  *   =[Reformat]=> device->buffer (device format, skipped on float)
  */
 static void DSOUND_PerformMix(DirectSoundDevice *device)
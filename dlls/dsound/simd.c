@@ -0,0 +1,110 @@
+/*
+ * Vectorized mixer loops
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include <stdarg.h>
+
+#include "windef.h"
+#include "winbase.h"
+#include "mmsystem.h"
+#include "wine/debug.h"
+#include "dsound.h"
+#include "dsound_private.h"
+
+WINE_DEFAULT_DEBUG_CHANNEL(dsound);
+
+/* The C versions, used for the remaining samples. */
+static struct dsound_mix_funcs mix_funcs_c;
+
+#if defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+
+/* The mixer loops are built from simd_mix.h once per vector size, using the
+ * compiler vector extensions. On x86 the variants are compiled for the
+ * corresponding instruction set and selected at runtime, elsewhere the native
+ * vector size is used. */
+
+#define MIX_FUNC(name) MIX_FUNC_(name, MIX_SUFFIX)
+#define MIX_FUNC_(name, suffix) MIX_FUNC__(name, suffix)
+#define MIX_FUNC__(name, suffix) name##_##suffix
+
+#define SET_MIX_FUNCS(funcs, suffix) \
+    do { \
+        (funcs)->mix = mixieee32_##suffix; \
+        (funcs)->scale = scaleieee32_##suffix; \
+        (funcs)->dot = dotieee32_##suffix; \
+    } while (0)
+
+#if defined(__i386__) || defined(__x86_64__)
+
+#define MIX_SUFFIX   sse2
+#define MIX_TARGET   __attribute__((target("sse2")))
+#define MIX_VEC_SIZE 16
+#include "simd_mix.h"
+#undef MIX_SUFFIX
+#undef MIX_TARGET
+#undef MIX_VEC_SIZE
+
+#define MIX_SUFFIX   avx
+#define MIX_TARGET   __attribute__((target("avx")))
+#define MIX_VEC_SIZE 32
+#include "simd_mix.h"
+#undef MIX_SUFFIX
+#undef MIX_TARGET
+#undef MIX_VEC_SIZE
+
+void dsound_init_mix_funcs(void)
+{
+    mix_funcs_c = dsound_mix_funcs;
+
+    if (IsProcessorFeaturePresent(PF_AVX_INSTRUCTIONS_AVAILABLE))
+    {
+        TRACE("Using AVX mixer functions.\n");
+        SET_MIX_FUNCS(&dsound_mix_funcs, avx);
+    }
+    else if (IsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE))
+    {
+        TRACE("Using SSE2 mixer functions.\n");
+        SET_MIX_FUNCS(&dsound_mix_funcs, sse2);
+    }
+}
+
+#else  /* __i386__ || __x86_64__ */
+
+#define MIX_SUFFIX   vec
+#define MIX_TARGET
+#define MIX_VEC_SIZE 16
+#include "simd_mix.h"
+#undef MIX_SUFFIX
+#undef MIX_TARGET
+#undef MIX_VEC_SIZE
+
+void dsound_init_mix_funcs(void)
+{
+    mix_funcs_c = dsound_mix_funcs;
+    SET_MIX_FUNCS(&dsound_mix_funcs, vec);
+}
+
+#endif  /* __i386__ || __x86_64__ */
+
+#else  /* __clang__ || __GNUC__ */
+
+void dsound_init_mix_funcs(void)
+{
+    mix_funcs_c = dsound_mix_funcs;
+}
+
+#endif  /* __clang__ || __GNUC__ */
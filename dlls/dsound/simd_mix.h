@@ -0,0 +1,74 @@
+/*
+ * Vectorized mixer loops
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/* This file is included multiple times by simd.c, with MIX_SUFFIX, MIX_TARGET
+ * and MIX_VEC_SIZE defined to the name suffix, the compiler target and the
+ * vector size in bytes of the functions to build. The C versions in
+ * dsound_convert.c handle the remaining samples. */
+
+#define MIX_FLOATS (MIX_VEC_SIZE / 4)
+
+typedef float MIX_FUNC(vecf) __attribute__((vector_size(MIX_VEC_SIZE), aligned(4), may_alias));
+
+static MIX_TARGET void MIX_FUNC(mixieee32)(float *dst, const float *src, unsigned int count)
+{
+    unsigned int i;
+
+    for (i = 0; i + MIX_FLOATS <= count; i += MIX_FLOATS)
+        *(MIX_FUNC(vecf) *)(dst + i) += *(const MIX_FUNC(vecf) *)(src + i);
+    mix_funcs_c.mix(dst + i, src + i, count - i);
+}
+
+static MIX_TARGET void MIX_FUNC(scaleieee32)(float *dst, const float *vols, unsigned int channels, unsigned int frames)
+{
+    unsigned int count = frames * channels, period = channels * MIX_FLOATS;
+    MIX_FUNC(vecf) pattern[DS_MAX_CHANNELS];
+    unsigned int i, j;
+
+    /* The volumes repeat every "channels" floats, so every "channels"
+     * vectors start at the same channel again. */
+    for (j = 0; j < channels; ++j)
+    {
+        for (i = 0; i < MIX_FLOATS; ++i)
+            pattern[j][i] = vols[(j * MIX_FLOATS + i) % channels];
+    }
+
+    for (i = 0; i + period <= count; i += period)
+    {
+        for (j = 0; j < channels; ++j)
+            *(MIX_FUNC(vecf) *)(dst + i + j * MIX_FLOATS) *= pattern[j];
+    }
+    mix_funcs_c.scale(dst + i, vols, channels, (count - i) / channels);
+}
+
+static MIX_TARGET float MIX_FUNC(dotieee32)(const float *a, const float *b, unsigned int count)
+{
+    MIX_FUNC(vecf) sum = {0};
+    unsigned int i;
+    float total;
+
+    for (i = 0; i + MIX_FLOATS <= count; i += MIX_FLOATS)
+        sum += *(const MIX_FUNC(vecf) *)(a + i) * *(const MIX_FUNC(vecf) *)(b + i);
+    total = mix_funcs_c.dot(a + i, b + i, count - i);
+    for (i = 0; i < MIX_FLOATS; ++i)
+        total += sum[i];
+
+    return total;
+}
+
+#undef MIX_FLOATS
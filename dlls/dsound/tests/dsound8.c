@@ -1809,6 +1809,171 @@ static void test_effects(void)
     ok(!ref, "Got outstanding refcount %u.\n", ref);
 }
 
+static ULONGLONG get_process_cpu_time(void)
+{
+    FILETIME creation, exit, kernel, user;
+
+    GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user);
+    return ((ULONGLONG)kernel.dwHighDateTime << 32 | kernel.dwLowDateTime)
+            + ((ULONGLONG)user.dwHighDateTime << 32 | user.dwLowDateTime);
+}
+
+static void test_mixing_times(void)
+{
+    static const struct
+    {
+        DWORD rate;
+        WORD bits, channels;
+    }
+    formats[] =
+    {
+        {44100, 16, 2},
+        {48000, 16, 2},
+        {22050, 16, 1},
+        {11025,  8, 1},
+    };
+    DSBUFFERDESC buffer_desc = {.dwSize = sizeof(buffer_desc)};
+    IDirectSoundBuffer *buffers[64];
+    ULONGLONG cpu_start, cpu_time;
+    DWORD start, time, size, i, j;
+    IDirectSound8 *dsound;
+    WAVEFORMATEX wfx;
+    HRESULT hr;
+    BYTE *ptr;
+
+    hr = DirectSoundCreate8(NULL, &dsound, NULL);
+    ok(hr == DS_OK || hr == DSERR_NODRIVER, "Got hr %#x.\n", hr);
+    if (FAILED(hr))
+        return;
+
+    hr = IDirectSound8_SetCooperativeLevel(dsound, get_hwnd(), DSSCL_PRIORITY);
+    ok(hr == DS_OK, "Got hr %#x.\n", hr);
+
+    buffer_desc.dwFlags = DSBCAPS_CTRLVOLUME | DSBCAPS_CTRLPAN | DSBCAPS_CTRLFREQUENCY | DSBCAPS_GLOBALFOCUS;
+    buffer_desc.lpwfxFormat = &wfx;
+    for (i = 0; i < ARRAY_SIZE(buffers); ++i)
+    {
+        init_format(&wfx, WAVE_FORMAT_PCM, formats[i % ARRAY_SIZE(formats)].rate,
+                formats[i % ARRAY_SIZE(formats)].bits, formats[i % ARRAY_SIZE(formats)].channels);
+        buffer_desc.dwBufferBytes = align(wfx.nAvgBytesPerSec, wfx.nBlockAlign);
+        hr = IDirectSound8_CreateSoundBuffer(dsound, &buffer_desc, &buffers[i], NULL);
+        ok(hr == DS_OK, "Got hr %#x.\n", hr);
+
+        hr = IDirectSoundBuffer_Lock(buffers[i], 0, 0, (void **)&ptr, &size, NULL, NULL, DSBLOCK_ENTIREBUFFER);
+        ok(hr == DS_OK, "Got hr %#x.\n", hr);
+        for (j = 0; j < size; ++j)
+            ptr[j] = j * (i + 1);
+        hr = IDirectSoundBuffer_Unlock(buffers[i], ptr, size, NULL, 0);
+        ok(hr == DS_OK, "Got hr %#x.\n", hr);
+
+        IDirectSoundBuffer_SetVolume(buffers[i], -600);
+        IDirectSoundBuffer_SetPan(buffers[i], (LONG)(i % 5) * 1000 - 2000);
+    }
+
+    cpu_start = get_process_cpu_time();
+    start = GetTickCount();
+    for (i = 0; i < ARRAY_SIZE(buffers); ++i)
+    {
+        hr = IDirectSoundBuffer_Play(buffers[i], 0, 0, DSBPLAY_LOOPING);
+        ok(hr == DS_OK, "Got hr %#x.\n", hr);
+    }
+    Sleep(2000);
+    time = GetTickCount() - start;
+    cpu_time = (get_process_cpu_time() - cpu_start) / 10000;
+
+    trace("%u buffers played for %u ms using %u ms of CPU time, %.1f buffers mixed per millisecond.\n",
+            (unsigned int)ARRAY_SIZE(buffers), time, (unsigned int)cpu_time,
+            cpu_time ? (double)ARRAY_SIZE(buffers) * time / cpu_time : 0.0);
+
+    for (i = 0; i < ARRAY_SIZE(buffers); ++i)
+    {
+        IDirectSoundBuffer_Stop(buffers[i]);
+        IDirectSoundBuffer_Release(buffers[i]);
+    }
+    IDirectSound8_Release(dsound);
+}
+
+static void test_mixing_underruns(void)
+{
+    static const unsigned int counts[] = {16, 64, 256};
+    DSBUFFERDESC buffer_desc = {.dwSize = sizeof(buffer_desc)};
+    DWORD start, last, now, pos, last_pos, size, advance, i, j, k;
+    unsigned int underruns, intervals;
+    IDirectSoundBuffer **buffers;
+    IDirectSound8 *dsound;
+    WAVEFORMATEX wfx;
+    HRESULT hr;
+    BYTE *ptr;
+
+    hr = DirectSoundCreate8(NULL, &dsound, NULL);
+    ok(hr == DS_OK || hr == DSERR_NODRIVER, "Got hr %#x.\n", hr);
+    if (FAILED(hr))
+        return;
+
+    hr = IDirectSound8_SetCooperativeLevel(dsound, get_hwnd(), DSSCL_PRIORITY);
+    ok(hr == DS_OK, "Got hr %#x.\n", hr);
+
+    buffers = HeapAlloc(GetProcessHeap(), 0, counts[ARRAY_SIZE(counts) - 1] * sizeof(*buffers));
+    buffer_desc.dwFlags = DSBCAPS_CTRLVOLUME | DSBCAPS_CTRLPAN | DSBCAPS_GLOBALFOCUS;
+    buffer_desc.lpwfxFormat = &wfx;
+
+    for (i = 0; i < ARRAY_SIZE(counts); ++i)
+    {
+        for (j = 0; j < counts[i]; ++j)
+        {
+            /* Every other buffer needs resampling. */
+            init_format(&wfx, WAVE_FORMAT_PCM, j & 1 ? 22050 : 44100, 16, 2);
+            buffer_desc.dwBufferBytes = align(wfx.nAvgBytesPerSec, wfx.nBlockAlign);
+            hr = IDirectSound8_CreateSoundBuffer(dsound, &buffer_desc, &buffers[j], NULL);
+            ok(hr == DS_OK, "Got hr %#x.\n", hr);
+
+            hr = IDirectSoundBuffer_Lock(buffers[j], 0, 0, (void **)&ptr, &size, NULL, NULL, DSBLOCK_ENTIREBUFFER);
+            ok(hr == DS_OK, "Got hr %#x.\n", hr);
+            for (k = 0; k < size; ++k)
+                ptr[k] = k * (j + 1);
+            hr = IDirectSoundBuffer_Unlock(buffers[j], ptr, size, NULL, 0);
+            ok(hr == DS_OK, "Got hr %#x.\n", hr);
+
+            IDirectSoundBuffer_SetVolume(buffers[j], -1200);
+            IDirectSoundBuffer_SetPan(buffers[j], (LONG)(j % 5) * 1000 - 2000);
+            hr = IDirectSoundBuffer_Play(buffers[j], 0, 0, DSBPLAY_LOOPING);
+            ok(hr == DS_OK, "Got hr %#x.\n", hr);
+        }
+
+        /* The play position of a buffer only advances when it is mixed. An
+         * interval where the first buffer advanced by less than half the
+         * elapsed time means that the mixer fell behind. */
+        init_format(&wfx, WAVE_FORMAT_PCM, 44100, 16, 2);
+        size = align(wfx.nAvgBytesPerSec, wfx.nBlockAlign);
+        underruns = intervals = 0;
+        IDirectSoundBuffer_GetCurrentPosition(buffers[0], &last_pos, NULL);
+        start = last = GetTickCount();
+        while (GetTickCount() - start < 3000)
+        {
+            Sleep(20);
+            now = GetTickCount();
+            IDirectSoundBuffer_GetCurrentPosition(buffers[0], &pos, NULL);
+            advance = (pos + size - last_pos) % size;
+            if (advance * 1000 / wfx.nAvgBytesPerSec * 2 < now - last)
+                ++underruns;
+            ++intervals;
+            last_pos = pos;
+            last = now;
+        }
+
+        trace("%u buffers: %u underruns in %u intervals.\n", counts[i], underruns, intervals);
+
+        for (j = 0; j < counts[i]; ++j)
+        {
+            IDirectSoundBuffer_Stop(buffers[j]);
+            IDirectSoundBuffer_Release(buffers[j]);
+        }
+    }
+
+    HeapFree(GetProcessHeap(), 0, buffers);
+    IDirectSound8_Release(dsound);
+}
+
 START_TEST(dsound8)
 {
     DWORD cookie;
@@ -1831,5 +1996,11 @@ START_TEST(dsound8)
 
     CoRevokeClassObject(cookie);
 
+    if (winetest_interactive)
+    {
+        test_mixing_times();
+        test_mixing_underruns();
+    }
+
     CoUninitialize();
 }
@@ -23,6 +23,7 @@
 #include "gdi_private.h"
 #include "dibdrv.h"
 
+#include "wine/list.h"
 #include "wine/debug.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(dib);
@@ -581,19 +582,182 @@ static void mask_rect( dib_info *dst, const RECT *dst_rect, const dib_info *src,
     }
 }
 
+/* Large operations are split into bands of rows that are processed by a small
+ * pool of worker threads, together with the calling thread. */
+
+#define MIN_TILE_PIXELS  (512 * 512)
+#define MIN_TILE_ROWS    16
+#define MAX_TILE_THREADS 8
+
+struct tile_job
+{
+    struct list entry;
+    void      (*func)( void *ctx, int top, int bottom );
+    int         top;        /* rows to process */
+    int         bottom;
+    int         bands;      /* number of bands */
+    int         next;       /* next band to process */
+    int         remaining;  /* number of bands not finished yet */
+    void       *ctx;
+};
+
+static struct list tile_jobs = LIST_INIT( tile_jobs );
+static int tile_threads = -1;  /* number of worker threads, -1 if not initialized yet */
+static CONDITION_VARIABLE tile_job_cv = CONDITION_VARIABLE_INIT;
+static CONDITION_VARIABLE tile_done_cv = CONDITION_VARIABLE_INIT;
+
+static CRITICAL_SECTION tile_section;
+static CRITICAL_SECTION_DEBUG tile_critsect_debug =
+{
+    0, 0, &tile_section,
+    { &tile_critsect_debug.ProcessLocksList, &tile_critsect_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": tile_section") }
+};
+static CRITICAL_SECTION tile_section = { &tile_critsect_debug, -1, 0, 0, 0, 0 };
+
+/* process the next band of a job, called with the tile_section held */
+static void run_tile_band( struct tile_job *job )
+{
+    int band = job->next++;
+    int height = job->bottom - job->top;
+
+    if (job->next == job->bands) list_remove( &job->entry );
+    LeaveCriticalSection( &tile_section );
+    job->func( job->ctx, job->top + MulDiv( band, height, job->bands ),
+               job->top + MulDiv( band + 1, height, job->bands ) );
+    EnterCriticalSection( &tile_section );
+    if (!--job->remaining) WakeAllConditionVariable( &tile_done_cv );
+}
+
+static DWORD WINAPI tile_thread( void *arg )
+{
+    struct list *ptr;
+
+    EnterCriticalSection( &tile_section );
+    for (;;)
+    {
+        while (!(ptr = list_head( &tile_jobs )))
+            SleepConditionVariableCS( &tile_job_cv, &tile_section, INFINITE );
+        run_tile_band( LIST_ENTRY( ptr, struct tile_job, entry ));
+    }
+    return 0;
+}
+
+/* must be called with the tile_section held */
+static void init_tile_threads(void)
+{
+    SYSTEM_INFO info;
+    HANDLE thread;
+    int count;
+
+    GetSystemInfo( &info );
+    count = min( info.dwNumberOfProcessors, MAX_TILE_THREADS ) - 1;
+    for (tile_threads = 0; tile_threads < count; tile_threads++)
+    {
+        if (!(thread = CreateThread( NULL, 0, tile_thread, NULL, 0, NULL ))) break;
+        CloseHandle( thread );
+    }
+    TRACE( "using %d tile threads\n", tile_threads );
+}
+
+/***********************************************************************
+ *           run_tiled
+ *
+ * Call func on bands covering the rows from top to bottom, in parallel if
+ * the operation is large enough. The bands must be independent from each other.
+ */
+static void run_tiled( void (*func)( void *ctx, int top, int bottom ), void *ctx,
+                       int top, int bottom, int width )
+{
+    struct tile_job job;
+    int height = bottom - top;
+
+    if (height < 2 * MIN_TILE_ROWS || (LONGLONG)width * height < MIN_TILE_PIXELS)
+    {
+        func( ctx, top, bottom );
+        return;
+    }
+
+    EnterCriticalSection( &tile_section );
+    if (tile_threads == -1) init_tile_threads();
+    if (!tile_threads)
+    {
+        LeaveCriticalSection( &tile_section );
+        func( ctx, top, bottom );
+        return;
+    }
+
+    job.func      = func;
+    job.ctx       = ctx;
+    job.top       = top;
+    job.bottom    = bottom;
+    job.bands     = min( tile_threads + 1, height / MIN_TILE_ROWS );
+    job.next      = 0;
+    job.remaining = job.bands;
+    list_add_tail( &tile_jobs, &job.entry );
+    WakeAllConditionVariable( &tile_job_cv );
+
+    while (job.next < job.bands) run_tile_band( &job );
+    while (job.remaining) SleepConditionVariableCS( &tile_done_cv, &tile_section, INFINITE );
+    LeaveCriticalSection( &tile_section );
+}
+
+/* check if the bits of two dibs overlap, in which case the rows are not independent */
+static BOOL dib_bits_overlap( const dib_info *dst, const dib_info *src )
+{
+    const char *dst_start = dst->bits.ptr, *src_start = src->bits.ptr;
+    const char *dst_end, *src_end;
+
+    if (dst->stride < 0) dst_start += (dst->height - 1) * dst->stride;
+    if (src->stride < 0) src_start += (src->height - 1) * src->stride;
+    dst_end = dst_start + abs( dst->stride ) * dst->height;
+    src_end = src_start + abs( src->stride ) * src->height;
+    return dst_start < src_end && src_start < dst_end;
+}
+
+struct blend_tile
+{
+    dib_info       *dst;
+    const RECT     *rect;
+    const dib_info *src;
+    POINT           origin;
+    BLENDFUNCTION   blend;
+};
+
+static void blend_tile( void *ctx, int top, int bottom )
+{
+    const struct blend_tile *tile = ctx;
+    RECT rect = *tile->rect;
+    POINT origin = tile->origin;
+
+    origin.y += top - rect.top;
+    rect.top = top;
+    rect.bottom = bottom;
+    tile->dst->funcs->blend_rect( tile->dst, &rect, tile->src, &origin, tile->blend );
+}
+
 static DWORD blend_rect( dib_info *dst, const RECT *dst_rect, const dib_info *src, const RECT *src_rect,
                          HRGN clip, BLENDFUNCTION blend )
 {
-    POINT origin;
+    struct blend_tile tile;
     struct clipped_rects clipped_rects;
+    BOOL overlap = dib_bits_overlap( dst, src );
     int i;
 
     if (!get_clipped_rects( dst, dst_rect, clip, &clipped_rects )) return ERROR_SUCCESS;
+    tile.dst = dst;
+    tile.src = src;
+    tile.blend = blend;
     for (i = 0; i < clipped_rects.count; i++)
     {
-        origin.x = src_rect->left + clipped_rects.rects[i].left - dst_rect->left;
-        origin.y = src_rect->top  + clipped_rects.rects[i].top  - dst_rect->top;
-        dst->funcs->blend_rect( dst, &clipped_rects.rects[i], src, &origin, blend );
+        tile.rect = &clipped_rects.rects[i];
+        tile.origin.x = src_rect->left + clipped_rects.rects[i].left - dst_rect->left;
+        tile.origin.y = src_rect->top  + clipped_rects.rects[i].top  - dst_rect->top;
+        if (overlap)
+            dst->funcs->blend_rect( dst, tile.rect, src, &tile.origin, blend );
+        else
+            run_tiled( blend_tile, &tile, tile.rect->top, tile.rect->bottom,
+                       tile.rect->right - tile.rect->left );
     }
     free_clipped_rects( &clipped_rects );
     return ERROR_SUCCESS;
@@ -1196,111 +1360,153 @@ static DWORD calc_1d_stretch_params( INT dst_start, INT dst_length, INT dst_vis_
 }
 
 
-DWORD stretch_bitmapinfo( const BITMAPINFO *src_info, void *src_bits, struct bitblt_coords *src,
-                          const BITMAPINFO *dst_info, void *dst_bits, struct bitblt_coords *dst,
-                          INT mode )
+struct stretch_tile
 {
-    dib_info src_dib, dst_dib;
-    POINT dst_start, src_start, dst_end, src_end;
-    RECT rect;
-    BOOL hstretch, vstretch;
-    struct stretch_params v_params, h_params;
-    int err;
-    DWORD ret;
+    dib_info              dst_dib;
+    dib_info              src_dib;
+    POINT                 dst_start;
+    POINT                 src_start;
+    struct stretch_params v_params;
+    struct stretch_params h_params;
+    BOOL                  vstretch;
+    int                   mode;
+    int                   width;
     void (* row_fn)(const dib_info *dst_dib, const POINT *dst_start,
                     const dib_info *src_dib, const POINT *src_start,
                     const struct stretch_params *params, int mode, BOOL keep_dst);
+};
 
-    TRACE("dst %d, %d - %d x %d visrect %s src %d, %d - %d x %d visrect %s\n",
-          dst->x, dst->y, dst->width, dst->height, wine_dbgstr_rect(&dst->visrect),
-          src->x, src->y, src->width, src->height, wine_dbgstr_rect(&src->visrect));
-
-    init_dib_info_from_bitmapinfo( &src_dib, src_info, src_bits );
-    init_dib_info_from_bitmapinfo( &dst_dib, dst_info, dst_bits );
-
-    /* v */
-    ret = calc_1d_stretch_params( dst->y, dst->height, dst->visrect.top, dst->visrect.bottom,
-                                  src->y, src->height, src->visrect.top, src->visrect.bottom,
-                                  &dst_start.y, &src_start.y, &dst_end.y, &src_end.y,
-                                  &v_params, &vstretch );
-    if (ret) return ret;
-
-    /* h */
-    ret = calc_1d_stretch_params( dst->x, dst->width, dst->visrect.left, dst->visrect.right,
-                                  src->x, src->width, src->visrect.left, src->visrect.right,
-                                  &dst_start.x, &src_start.x, &dst_end.x, &src_end.x,
-                                  &h_params, &hstretch );
-    if (ret) return ret;
-
-    TRACE("got dst start %d, %d inc %d, %d. src start %d, %d inc %d, %d len %d x %d\n",
-          dst_start.x, dst_start.y, h_params.dst_inc, v_params.dst_inc,
-          src_start.x, src_start.y, h_params.src_inc, v_params.src_inc,
-          h_params.length, v_params.length);
-
-    get_bounding_rect( &rect, dst_start.x, dst_start.y, dst_end.x - dst_start.x, dst_end.y - dst_start.y );
-    intersect_rect( &dst->visrect, &dst->visrect, &rect );
-
-    dst_start.x -= dst->visrect.left;
-    dst_start.y -= dst->visrect.top;
-
-    err = v_params.err_start;
-
-    row_fn = hstretch ? dst_dib.funcs->stretch_row : dst_dib.funcs->shrink_row;
-
-    if (vstretch)
+/* stretch the destination rows from top to bottom */
+static void stretch_tile( void *ctx, int top, int bottom )
+{
+    struct stretch_tile *tile = ctx;
+    const struct stretch_params *v_params = &tile->v_params;
+    POINT dst_start = tile->dst_start, src_start = tile->src_start;
+    unsigned int length = v_params->length;
+    int err = v_params->err_start;
+    BOOL in_band = FALSE;
+
+    if (tile->vstretch)
     {
         BOOL need_row = TRUE;
         RECT last_row, this_row;
-        if (hstretch) mode = STRETCH_DELETESCANS;
         last_row.left = 0;
-        last_row.right = dst->visrect.right - dst->visrect.left;
+        last_row.right = tile->width;
 
-        while (v_params.length--)
+        while (length--)
         {
-            if (need_row)
-            {
-                row_fn( &dst_dib, &dst_start, &src_dib, &src_start, &h_params, mode, FALSE );
-                need_row = FALSE;
-            }
-            else
+            if (dst_start.y >= top && dst_start.y < bottom)
             {
-                last_row.top = dst_start.y - v_params.dst_inc;
-                last_row.bottom = last_row.top + 1;
-                this_row = last_row;
-                offset_rect( &this_row, 0, v_params.dst_inc );
-                copy_rect( &dst_dib, &this_row, &dst_dib, &last_row, NULL, R2_COPYPEN );
+                /* the first row of the band can't be copied from the previous one */
+                if (need_row || !in_band)
+                {
+                    tile->row_fn( &tile->dst_dib, &dst_start, &tile->src_dib, &src_start,
+                                  &tile->h_params, tile->mode, FALSE );
+                }
+                else
+                {
+                    last_row.top = dst_start.y - v_params->dst_inc;
+                    last_row.bottom = last_row.top + 1;
+                    this_row = last_row;
+                    offset_rect( &this_row, 0, v_params->dst_inc );
+                    copy_rect( &tile->dst_dib, &this_row, &tile->dst_dib, &last_row, NULL, R2_COPYPEN );
+                }
+                in_band = TRUE;
             }
+            else if (in_band) break;
+            need_row = FALSE;
 
             if (err > 0)
             {
-                src_start.y += v_params.src_inc;
+                src_start.y += v_params->src_inc;
                 need_row = TRUE;
-                err += v_params.err_add_1;
+                err += v_params->err_add_1;
             }
-            else err += v_params.err_add_2;
-            dst_start.y += v_params.dst_inc;
+            else err += v_params->err_add_2;
+            dst_start.y += v_params->dst_inc;
         }
     }
     else
     {
         int merged_rows = 0;
 
-        while (v_params.length--)
+        while (length--)
         {
-            if (mode != STRETCH_DELETESCANS || !merged_rows)
-                row_fn( &dst_dib, &dst_start, &src_dib, &src_start, &h_params, mode, merged_rows != 0 );
+            if (dst_start.y >= top && dst_start.y < bottom)
+            {
+                if (tile->mode != STRETCH_DELETESCANS || !merged_rows)
+                    tile->row_fn( &tile->dst_dib, &dst_start, &tile->src_dib, &src_start,
+                                  &tile->h_params, tile->mode, merged_rows != 0 );
+                in_band = TRUE;
+            }
+            else if (in_band) break;
             merged_rows++;
 
             if (err > 0)
             {
-                dst_start.y += v_params.dst_inc;
+                dst_start.y += v_params->dst_inc;
                 merged_rows = 0;
-                err += v_params.err_add_1;
+                err += v_params->err_add_1;
             }
-            else err += v_params.err_add_2;
-            src_start.y += v_params.src_inc;
+            else err += v_params->err_add_2;
+            src_start.y += v_params->src_inc;
         }
     }
+}
+
+DWORD stretch_bitmapinfo( const BITMAPINFO *src_info, void *src_bits, struct bitblt_coords *src,
+                          const BITMAPINFO *dst_info, void *dst_bits, struct bitblt_coords *dst,
+                          INT mode )
+{
+    struct stretch_tile tile;
+    POINT dst_end, src_end;
+    RECT rect;
+    BOOL hstretch;
+    DWORD ret;
+    int height;
+
+    TRACE("dst %d, %d - %d x %d visrect %s src %d, %d - %d x %d visrect %s\n",
+          dst->x, dst->y, dst->width, dst->height, wine_dbgstr_rect(&dst->visrect),
+          src->x, src->y, src->width, src->height, wine_dbgstr_rect(&src->visrect));
+
+    init_dib_info_from_bitmapinfo( &tile.src_dib, src_info, src_bits );
+    init_dib_info_from_bitmapinfo( &tile.dst_dib, dst_info, dst_bits );
+
+    /* v */
+    ret = calc_1d_stretch_params( dst->y, dst->height, dst->visrect.top, dst->visrect.bottom,
+                                  src->y, src->height, src->visrect.top, src->visrect.bottom,
+                                  &tile.dst_start.y, &tile.src_start.y, &dst_end.y, &src_end.y,
+                                  &tile.v_params, &tile.vstretch );
+    if (ret) return ret;
+
+    /* h */
+    ret = calc_1d_stretch_params( dst->x, dst->width, dst->visrect.left, dst->visrect.right,
+                                  src->x, src->width, src->visrect.left, src->visrect.right,
+                                  &tile.dst_start.x, &tile.src_start.x, &dst_end.x, &src_end.x,
+                                  &tile.h_params, &hstretch );
+    if (ret) return ret;
+
+    TRACE("got dst start %d, %d inc %d, %d. src start %d, %d inc %d, %d len %d x %d\n",
+          tile.dst_start.x, tile.dst_start.y, tile.h_params.dst_inc, tile.v_params.dst_inc,
+          tile.src_start.x, tile.src_start.y, tile.h_params.src_inc, tile.v_params.src_inc,
+          tile.h_params.length, tile.v_params.length);
+
+    get_bounding_rect( &rect, tile.dst_start.x, tile.dst_start.y,
+                       dst_end.x - tile.dst_start.x, dst_end.y - tile.dst_start.y );
+    intersect_rect( &dst->visrect, &dst->visrect, &rect );
+
+    tile.dst_start.x -= dst->visrect.left;
+    tile.dst_start.y -= dst->visrect.top;
+
+    tile.row_fn = hstretch ? tile.dst_dib.funcs->stretch_row : tile.dst_dib.funcs->shrink_row;
+    tile.mode = (tile.vstretch && hstretch) ? STRETCH_DELETESCANS : mode;
+    tile.width = dst->visrect.right - dst->visrect.left;
+    height = dst->visrect.bottom - dst->visrect.top;
+
+    if (dib_bits_overlap( &tile.dst_dib, &tile.src_dib ))
+        stretch_tile( &tile, 0, height );
+    else
+        run_tiled( stretch_tile, &tile, 0, height, tile.width );
 
     /* update coordinates, the destination rectangle is always stored at 0,0 */
     *src = *dst;
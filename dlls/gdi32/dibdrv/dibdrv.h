@@ -213,6 +213,20 @@ typedef struct primitive_funcs
                                     const struct stretch_params *params, int mode, BOOL keep_dst);
 } primitive_funcs;
 
+/* innermost loops of the primitives that have vectorized versions, see simd.c */
+struct row_funcs
+{
+    void           (* rop_row_32)(DWORD *ptr, DWORD and, DWORD xor, int len);
+    void           (* rop_row_16)(WORD *ptr, WORD and, WORD xor, int len);
+    void       (* blend_row_argb)(DWORD *dst, const DWORD *src, int len);
+    void (* blend_row_argb_alpha)(DWORD *dst, const DWORD *src, DWORD alpha, int len);
+    void (* convert_row_32_to_8888)(DWORD *dst, const DWORD *src, int len,
+                                    int red_shift, int green_shift, int blue_shift);
+    void (* convert_row_555_to_8888)(DWORD *dst, const WORD *src, int len);
+};
+
+extern struct row_funcs row_funcs DECLSPEC_HIDDEN;
+
 extern const primitive_funcs funcs_8888 DECLSPEC_HIDDEN;
 extern const primitive_funcs funcs_32   DECLSPEC_HIDDEN;
 extern const primitive_funcs funcs_24   DECLSPEC_HIDDEN;
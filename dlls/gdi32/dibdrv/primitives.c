@@ -264,10 +264,20 @@ static inline void memset_16( WORD *start, WORD val, DWORD size )
 #endif
 }
 
+static void rop_row_32( DWORD *ptr, DWORD and, DWORD xor, int len )
+{
+    for (; len > 0; len--) do_rop_32( ptr++, and, xor );
+}
+
+static void rop_row_16( WORD *ptr, WORD and, WORD xor, int len )
+{
+    for (; len > 0; len--) do_rop_16( ptr++, and, xor );
+}
+
 static void solid_rects_32(const dib_info *dib, int num, const RECT *rc, DWORD and, DWORD xor)
 {
-    DWORD *ptr, *start;
-    int x, y, i;
+    DWORD *start;
+    int y, i;
 
     for(i = 0; i < num; i++, rc++)
     {
@@ -276,8 +286,7 @@ static void solid_rects_32(const dib_info *dib, int num, const RECT *rc, DWORD a
         start = get_pixel_ptr_32(dib, rc->left, rc->top);
         if (and)
             for(y = rc->top; y < rc->bottom; y++, start += dib->stride / 4)
-                for(x = rc->left, ptr = start; x < rc->right; x++)
-                    do_rop_32(ptr++, and, xor);
+                row_funcs.rop_row_32( start, and, xor, rc->right - rc->left );
         else
             for(y = rc->top; y < rc->bottom; y++, start += dib->stride / 4)
                 memset_32( start, xor, rc->right - rc->left );
@@ -417,8 +426,8 @@ static void solid_rects_24(const dib_info *dib, int num, const RECT *rc, DWORD a
 
 static void solid_rects_16(const dib_info *dib, int num, const RECT *rc, DWORD and, DWORD xor)
 {
-    WORD *ptr, *start;
-    int x, y, i;
+    WORD *start;
+    int y, i;
 
     for(i = 0; i < num; i++, rc++)
     {
@@ -427,8 +436,7 @@ static void solid_rects_16(const dib_info *dib, int num, const RECT *rc, DWORD a
         start = get_pixel_ptr_16(dib, rc->left, rc->top);
         if (and)
             for(y = rc->top; y < rc->bottom; y++, start += dib->stride / 2)
-                for(x = rc->left, ptr = start; x < rc->right; x++)
-                    do_rop_16(ptr++, and, xor);
+                row_funcs.rop_row_16( start, and, xor, rc->right - rc->left );
         else
             for(y = rc->top; y < rc->bottom; y++, start += dib->stride / 2)
                 memset_16( start, xor, rc->right - rc->left );
@@ -2215,6 +2223,33 @@ static inline BOOL bit_fields_match(const dib_info *d1, const dib_info *d2)
            d1->blue_mask  == d2->blue_mask;
 }
 
+static void convert_row_32_to_8888( DWORD *dst, const DWORD *src, int len,
+                                   int red_shift, int green_shift, int blue_shift )
+{
+    DWORD src_val;
+
+    for (; len > 0; len--)
+    {
+        src_val = *src++;
+        *dst++ = (((src_val >> red_shift)   & 0xff) << 16) |
+                 (((src_val >> green_shift) & 0xff) <<  8) |
+                  ((src_val >> blue_shift)  & 0xff);
+    }
+}
+
+static void convert_row_555_to_8888( DWORD *dst, const WORD *src, int len )
+{
+    DWORD src_val;
+
+    for (; len > 0; len--)
+    {
+        src_val = *src++;
+        *dst++ = ((src_val << 9) & 0xf80000) | ((src_val << 4) & 0x070000) |
+                 ((src_val << 6) & 0x00f800) | ((src_val << 1) & 0x000700) |
+                 ((src_val << 3) & 0x0000f8) | ((src_val >> 2) & 0x000007);
+    }
+}
+
 static void convert_to_8888(dib_info *dst, const dib_info *src, const RECT *src_rect, BOOL dither)
 {
     DWORD *dst_start = get_pixel_ptr_32(dst, 0, 0), *dst_pixel, src_val;
@@ -2244,16 +2279,9 @@ static void convert_to_8888(dib_info *dst, const dib_info *src, const RECT *src_
         {
             for(y = src_rect->top; y < src_rect->bottom; y++)
             {
-                dst_pixel = dst_start;
-                src_pixel = src_start;
-                for(x = src_rect->left; x < src_rect->right; x++)
-                {
-                    src_val = *src_pixel++;
-                    *dst_pixel++ = (((src_val >> src->red_shift)   & 0xff) << 16) |
-                                   (((src_val >> src->green_shift) & 0xff) <<  8) |
-                                    ((src_val >> src->blue_shift)  & 0xff);
-                }
-                if(pad_size) memset(dst_pixel, 0, pad_size);
+                row_funcs.convert_row_32_to_8888( dst_start, src_start, src_rect->right - src_rect->left,
+                                                  src->red_shift, src->green_shift, src->blue_shift );
+                if(pad_size) memset(dst_start + (src_rect->right - src_rect->left), 0, pad_size);
                 dst_start += dst->stride / 4;
                 src_start += src->stride / 4;
             }
@@ -2310,16 +2338,8 @@ static void convert_to_8888(dib_info *dst, const dib_info *src, const RECT *src_
         {
             for(y = src_rect->top; y < src_rect->bottom; y++)
             {
-                dst_pixel = dst_start;
-                src_pixel = src_start;
-                for(x = src_rect->left; x < src_rect->right; x++)
-                {
-                    src_val = *src_pixel++;
-                    *dst_pixel++ = ((src_val << 9) & 0xf80000) | ((src_val << 4) & 0x070000) |
-                                   ((src_val << 6) & 0x00f800) | ((src_val << 1) & 0x000700) |
-                                   ((src_val << 3) & 0x0000f8) | ((src_val >> 2) & 0x000007);
-                }
-                if(pad_size) memset(dst_pixel, 0, pad_size);
+                row_funcs.convert_row_555_to_8888( dst_start, src_start, src_rect->right - src_rect->left );
+                if(pad_size) memset(dst_start + (src_rect->right - src_rect->left), 0, pad_size);
                 dst_start += dst->stride / 4;
                 src_start += src->stride / 2;
             }
@@ -4651,6 +4671,20 @@ static inline DWORD blend_rgb( BYTE dst_r, BYTE dst_g, BYTE dst_b, DWORD src, BL
             blend_color( dst_r, src >> 16, blend.SourceConstantAlpha ) << 16);
 }
 
+static void blend_row_argb( DWORD *dst, const DWORD *src, int len )
+{
+    int x;
+
+    for (x = 0; x < len; x++) dst[x] = blend_argb( dst[x], src[x] );
+}
+
+static void blend_row_argb_alpha( DWORD *dst, const DWORD *src, DWORD alpha, int len )
+{
+    int x;
+
+    for (x = 0; x < len; x++) dst[x] = blend_argb_alpha( dst[x], src[x], alpha );
+}
+
 static void blend_rect_8888(const dib_info *dst, const RECT *rc,
                             const dib_info *src, const POINT *origin, BLENDFUNCTION blend)
 {
@@ -4662,12 +4696,11 @@ static void blend_rect_8888(const dib_info *dst, const RECT *rc,
     {
 	if (blend.SourceConstantAlpha == 255)
 	    for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
-		for (x = 0; x < rc->right - rc->left; x++)
-		    dst_ptr[x] = blend_argb( dst_ptr[x], src_ptr[x] );
+                row_funcs.blend_row_argb( dst_ptr, src_ptr, rc->right - rc->left );
         else
 	    for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
-		for (x = 0; x < rc->right - rc->left; x++)
-		    dst_ptr[x] = blend_argb_alpha( dst_ptr[x], src_ptr[x], blend.SourceConstantAlpha );
+                row_funcs.blend_row_argb_alpha( dst_ptr, src_ptr, blend.SourceConstantAlpha,
+                                                rc->right - rc->left );
     }
     else if (src->compression == BI_RGB)
 	for (y = rc->top; y < rc->bottom; y++, dst_ptr += dst->stride / 4, src_ptr += src->stride / 4)
@@ -7367,6 +7400,16 @@ static void shrink_row_null(const dib_info *dst_dib, const POINT *dst_start,
     return;
 }
 
+struct row_funcs row_funcs =
+{
+    rop_row_32,
+    rop_row_16,
+    blend_row_argb,
+    blend_row_argb_alpha,
+    convert_row_32_to_8888,
+    convert_row_555_to_8888
+};
+
 const primitive_funcs funcs_8888 =
 {
     solid_rects_32,
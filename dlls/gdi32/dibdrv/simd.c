@@ -0,0 +1,129 @@
+/*
+ * DIB driver vectorized primitives.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "gdi_private.h"
+#include "dibdrv.h"
+
+#include "wine/debug.h"
+
+WINE_DEFAULT_DEBUG_CHANNEL(dib);
+
+static struct row_funcs row_funcs_c;  /* the C versions, used for the end of the rows */
+
+#if defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+
+/* The row functions are built from simd_row.h once per vector size, using the
+ * compiler vector extensions so that no intrinsics headers are needed. On x86
+ * the variants are compiled for the corresponding instruction set and selected
+ * at runtime, elsewhere the native vector size is used. */
+
+#define ROW_FUNC(name) ROW_FUNC_(name, ROW_SUFFIX)
+#define ROW_FUNC_(name, suffix) ROW_FUNC__(name, suffix)
+#define ROW_FUNC__(name, suffix) name##_##suffix
+
+#if defined(__i386__) || defined(__x86_64__)
+
+#define ROW_SUFFIX   sse2
+#define ROW_TARGET   __attribute__((target("sse2")))
+#define ROW_VEC_SIZE 16
+#include "simd_row.h"
+#undef ROW_SUFFIX
+#undef ROW_TARGET
+#undef ROW_VEC_SIZE
+
+#define ROW_SUFFIX   avx2
+#define ROW_TARGET   __attribute__((target("avx2")))
+#define ROW_VEC_SIZE 32
+#include "simd_row.h"
+#undef ROW_SUFFIX
+#undef ROW_TARGET
+#undef ROW_VEC_SIZE
+
+static void set_row_funcs_sse2( struct row_funcs *funcs )
+{
+    funcs->rop_row_32              = rop_row_32_sse2;
+    funcs->rop_row_16              = rop_row_16_sse2;
+    funcs->blend_row_argb          = blend_row_argb_sse2;
+    funcs->blend_row_argb_alpha    = blend_row_argb_alpha_sse2;
+    funcs->convert_row_32_to_8888  = convert_row_32_to_8888_sse2;
+    funcs->convert_row_555_to_8888 = convert_row_555_to_8888_sse2;
+}
+
+static void set_row_funcs_avx2( struct row_funcs *funcs )
+{
+    funcs->rop_row_32              = rop_row_32_avx2;
+    funcs->rop_row_16              = rop_row_16_avx2;
+    funcs->blend_row_argb          = blend_row_argb_avx2;
+    funcs->blend_row_argb_alpha    = blend_row_argb_alpha_avx2;
+    funcs->convert_row_32_to_8888  = convert_row_32_to_8888_avx2;
+    funcs->convert_row_555_to_8888 = convert_row_555_to_8888_avx2;
+}
+
+/***********************************************************************
+ *           init_dib_row_funcs
+ *
+ * Select the vectorized row functions supported by the CPU.
+ */
+void init_dib_row_funcs(void)
+{
+    row_funcs_c = row_funcs;
+
+    if (IsProcessorFeaturePresent( PF_AVX2_INSTRUCTIONS_AVAILABLE ))
+    {
+        TRACE( "using AVX2 row functions\n" );
+        set_row_funcs_avx2( &row_funcs );
+    }
+    else if (IsProcessorFeaturePresent( PF_XMMI64_INSTRUCTIONS_AVAILABLE ))
+    {
+        TRACE( "using SSE2 row functions\n" );
+        set_row_funcs_sse2( &row_funcs );
+    }
+}
+
+#else  /* __i386__ || __x86_64__ */
+
+#define ROW_SUFFIX   vec
+#define ROW_TARGET
+#define ROW_VEC_SIZE 16
+#include "simd_row.h"
+#undef ROW_SUFFIX
+#undef ROW_TARGET
+#undef ROW_VEC_SIZE
+
+void init_dib_row_funcs(void)
+{
+    row_funcs_c = row_funcs;
+
+    row_funcs.rop_row_32              = rop_row_32_vec;
+    row_funcs.rop_row_16              = rop_row_16_vec;
+    row_funcs.blend_row_argb          = blend_row_argb_vec;
+    row_funcs.blend_row_argb_alpha    = blend_row_argb_alpha_vec;
+    row_funcs.convert_row_32_to_8888  = convert_row_32_to_8888_vec;
+    row_funcs.convert_row_555_to_8888 = convert_row_555_to_8888_vec;
+}
+
+#endif  /* __i386__ || __x86_64__ */
+
+#else  /* __clang__ || __GNUC__ */
+
+void init_dib_row_funcs(void)
+{
+    row_funcs_c = row_funcs;
+}
+
+#endif  /* __clang__ || __GNUC__ */
@@ -0,0 +1,155 @@
+/*
+ * DIB driver vectorized row functions
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/* This file is included multiple times by simd.c, with ROW_SUFFIX, ROW_TARGET
+ * and ROW_VEC_SIZE defined to the name suffix, the compiler target and the
+ * vector size in bytes of the functions to build.
+ *
+ * The results must be identical to the C versions in primitives.c. In
+ * particular blending is done on 16-bit channels, dividing by 255 with
+ * (x + 1 + (x >> 8)) >> 8 which is exact for x <= 255 * 255 + 127, and channel
+ * overflows are carried into the next channel like the C code does. */
+
+#define ROW_PIXELS (ROW_VEC_SIZE / 4)
+
+typedef DWORD ROW_FUNC(vec32) __attribute__((vector_size(ROW_VEC_SIZE), aligned(4), may_alias));
+typedef WORD  ROW_FUNC(vec16) __attribute__((vector_size(ROW_VEC_SIZE), aligned(2), may_alias));
+
+static ROW_TARGET void ROW_FUNC(rop_row_32)( DWORD *ptr, DWORD and, DWORD xor, int len )
+{
+    ROW_FUNC(vec32) *vec;
+
+    for (; len >= ROW_PIXELS; len -= ROW_PIXELS, ptr += ROW_PIXELS)
+    {
+        vec = (ROW_FUNC(vec32) *)ptr;
+        *vec = (*vec & and) ^ xor;
+    }
+    row_funcs_c.rop_row_32( ptr, and, xor, len );
+}
+
+static ROW_TARGET void ROW_FUNC(rop_row_16)( WORD *ptr, WORD and, WORD xor, int len )
+{
+    ROW_FUNC(vec16) *vec;
+
+    for (; len >= 2 * ROW_PIXELS; len -= 2 * ROW_PIXELS, ptr += 2 * ROW_PIXELS)
+    {
+        vec = (ROW_FUNC(vec16) *)ptr;
+        *vec = (*vec & and) ^ xor;
+    }
+    row_funcs_c.rop_row_16( ptr, and, xor, len );
+}
+
+/* compute (val * alpha + 127) / 255 on 16-bit channels */
+static inline ROW_TARGET ROW_FUNC(vec16) ROW_FUNC(scale_channels)( ROW_FUNC(vec16) val, ROW_FUNC(vec16) alpha )
+{
+    val = val * alpha + 127;
+    return (val + (val >> 8) + 1) >> 8;
+}
+
+/* equivalent of blend_argb() */
+static inline ROW_TARGET ROW_FUNC(vec32) ROW_FUNC(blend_argb)( ROW_FUNC(vec32) dst, ROW_FUNC(vec32) src )
+{
+    ROW_FUNC(vec32) inv = 255 - (src >> 24), rb, ag;
+
+    inv |= inv << 16;
+    rb = (ROW_FUNC(vec32))ROW_FUNC(scale_channels)( (ROW_FUNC(vec16))(dst & 0x00ff00ff),
+                                                    (ROW_FUNC(vec16))inv );
+    ag = (ROW_FUNC(vec32))ROW_FUNC(scale_channels)( (ROW_FUNC(vec16))((dst >> 8) & 0x00ff00ff),
+                                                    (ROW_FUNC(vec16))inv );
+    rb += src & 0x00ff00ff;
+    ag += (src >> 8) & 0x00ff00ff;
+    return rb | (ag << 8);
+}
+
+static ROW_TARGET void ROW_FUNC(blend_row_argb)( DWORD *dst, const DWORD *src, int len )
+{
+    ROW_FUNC(vec32) *dst_vec;
+    int x;
+
+    for (x = 0; x + ROW_PIXELS <= len; x += ROW_PIXELS)
+    {
+        dst_vec = (ROW_FUNC(vec32) *)(dst + x);
+        *dst_vec = ROW_FUNC(blend_argb)( *dst_vec, *(const ROW_FUNC(vec32) *)(src + x) );
+    }
+    row_funcs_c.blend_row_argb( dst + x, src + x, len - x );
+}
+
+static ROW_TARGET void ROW_FUNC(blend_row_argb_alpha)( DWORD *dst, const DWORD *src, DWORD alpha, int len )
+{
+    ROW_FUNC(vec32) *dst_vec, src_vec, rb, ag;
+    ROW_FUNC(vec16) alpha_vec = {0};
+    int x;
+
+    alpha_vec += (WORD)alpha;
+    for (x = 0; x + ROW_PIXELS <= len; x += ROW_PIXELS)
+    {
+        dst_vec = (ROW_FUNC(vec32) *)(dst + x);
+        src_vec = *(const ROW_FUNC(vec32) *)(src + x);
+        /* premultiply all the source channels, including alpha */
+        rb = (ROW_FUNC(vec32))ROW_FUNC(scale_channels)( (ROW_FUNC(vec16))(src_vec & 0x00ff00ff), alpha_vec );
+        ag = (ROW_FUNC(vec32))ROW_FUNC(scale_channels)( (ROW_FUNC(vec16))((src_vec >> 8) & 0x00ff00ff),
+                                                        alpha_vec );
+        *dst_vec = ROW_FUNC(blend_argb)( *dst_vec, rb | (ag << 8) );
+    }
+    row_funcs_c.blend_row_argb_alpha( dst + x, src + x, alpha, len - x );
+}
+
+static ROW_TARGET void ROW_FUNC(convert_row_32_to_8888)( DWORD *dst, const DWORD *src, int len,
+                                                         int red_shift, int green_shift, int blue_shift )
+{
+    ROW_FUNC(vec32) val;
+    int x;
+
+    for (x = 0; x + ROW_PIXELS <= len; x += ROW_PIXELS)
+    {
+        val = *(const ROW_FUNC(vec32) *)(src + x);
+        *(ROW_FUNC(vec32) *)(dst + x) = (((val >> red_shift)   & 0xff) << 16) |
+                                        (((val >> green_shift) & 0xff) <<  8) |
+                                         ((val >> blue_shift)  & 0xff);
+    }
+    row_funcs_c.convert_row_32_to_8888( dst + x, src + x, len - x, red_shift, green_shift, blue_shift );
+}
+
+static inline ROW_TARGET ROW_FUNC(vec32) ROW_FUNC(expand_555)( ROW_FUNC(vec32) val )
+{
+    return ((val << 9) & 0xf80000) | ((val << 4) & 0x070000) |
+           ((val << 6) & 0x00f800) | ((val << 1) & 0x000700) |
+           ((val << 3) & 0x0000f8) | ((val >> 2) & 0x000007);
+}
+
+static ROW_TARGET void ROW_FUNC(convert_row_555_to_8888)( DWORD *dst, const WORD *src, int len )
+{
+    ROW_FUNC(vec32) val, even, odd;
+    int i, x;
+
+    /* each 32-bit lane holds two source pixels */
+    for (x = 0; x + 2 * ROW_PIXELS <= len; x += 2 * ROW_PIXELS)
+    {
+        val = *(const ROW_FUNC(vec32) *)(src + x);
+        even = ROW_FUNC(expand_555)( val & 0xffff );
+        odd = ROW_FUNC(expand_555)( val >> 16 );
+        for (i = 0; i < ROW_PIXELS; i++)
+        {
+            dst[x + 2 * i] = even[i];
+            dst[x + 2 * i + 1] = odd[i];
+        }
+    }
+    row_funcs_c.convert_row_555_to_8888( dst + x, src + x, len - x );
+}
+
+#undef ROW_PIXELS
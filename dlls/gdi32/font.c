@@ -41,7 +41,6 @@
 WINE_DEFAULT_DEBUG_CHANNEL(font);
 
 static HKEY wine_fonts_key;
-static HKEY wine_fonts_cache_key;
 
 struct font_physdev
 {
@@ -995,158 +994,444 @@ static int CDECL add_gdi_face( const WCHAR *family_name, const WCHAR *second_nam
     return ret;
 }
 
-/* font cache */
+/* font cache
+ *
+ * The list of system faces is stored in a binary file, and mapped by the following
+ * processes, including those of later sessions, to load the faces without having
+ * to scan the font directories again. The file is rebuilt when the modification
+ * times of any of the scanned font directories or font registry keys change. */
+
+#define FACE_CACHE_MAGIC   0x43464657  /* WFFC */
+#define FACE_CACHE_VERSION 3
 
-struct cached_face
+struct face_cache_header
 {
+    DWORD  magic;
+    DWORD  version;
+    DWORD  count;
+    DWORD  size;      /* total size of the file */
+    UINT64 dirs_key;  /* modification times of the font directories and registry keys */
+};
+
+struct face_cache_entry
+{
+    DWORD                   size;  /* size of the entry, including the names */
     DWORD                   index;
     DWORD                   flags;
     DWORD                   ntmflags;
     DWORD                   version;
-    struct bitmap_font_size size;
+    BOOL                    scalable;
+    struct bitmap_font_size bitmap_size;
     FONTSIGNATURE           fs;
-    WCHAR                   full_name[1];
-    /* WCHAR                file_name[]; */
+    WORD                    family_len;  /* lengths of the names in WCHARs, including the null */
+    WORD                    second_len;
+    WORD                    style_len;
+    WORD                    full_len;
+    WORD                    file_len;
+    WCHAR                   names[1];  /* family, second, style, full and file names */
 };
 
-static void load_face_from_cache( HKEY hkey_family, struct gdi_font_family *family,
-                                  void *buffer, DWORD buffer_size, BOOL scalable )
+struct face_cache
 {
-    DWORD type, size, needed, index = 0;
-    struct gdi_font_face *face;
-    HKEY hkey_strike;
-    WCHAR name[256];
-    struct cached_face *cached = (struct cached_face *)buffer;
+    BYTE *data;
+    DWORD size;
+    DWORD alloc;
+    DWORD count;
+};
 
-    size = sizeof(name);
-    needed = buffer_size - sizeof(DWORD);
-    while (!RegEnumValueW( hkey_family, index++, name, &size, NULL, &type, buffer, &needed ))
-    {
-        if (type == REG_BINARY && needed > sizeof(*cached))
-        {
-            ((DWORD *)buffer)[needed / sizeof(DWORD)] = 0;
-            if ((face = create_face( family, name, cached->full_name,
-                                     cached->full_name + lstrlenW(cached->full_name) + 1,
-                                     NULL, 0, cached->index, cached->fs, cached->ntmflags, cached->version,
-                                     cached->flags, scalable ? NULL : &cached->size )))
-            {
-                if (!scalable)
-                    TRACE("Adding bitmap size h %d w %d size %d x_ppem %d y_ppem %d\n",
-                          face->size.height, face->size.width, face->size.size >> 6,
-                          face->size.x_ppem >> 6, face->size.y_ppem >> 6);
+static BOOL face_cache_loading;  /* set while initializing the font list */
 
-                TRACE("fsCsb = %08x %08x/%08x %08x %08x %08x\n",
-                      face->fs.fsCsb[0], face->fs.fsCsb[1],
-                      face->fs.fsUsb[0], face->fs.fsUsb[1],
-                      face->fs.fsUsb[2], face->fs.fsUsb[3]);
+/* in the Windows directory, which isn't redirected for 32-bit processes */
+static void get_face_cache_path( WCHAR *path )
+{
+    GetWindowsDirectoryW( path, MAX_PATH - 24 );
+    lstrcatW( path, L"\\wine_fontcache.dat" );
+}
 
-                release_face( face );
-            }
-        }
-        size = sizeof(name);
-        needed = buffer_size - sizeof(DWORD);
-    }
+static UINT64 add_face_cache_dir_key( UINT64 key, const WCHAR *dir )
+{
+    WIN32_FILE_ATTRIBUTE_DATA info;
+    WCHAR path[MAX_PATH];
+    int i, len;
+
+    lstrcpynW( path, dir, MAX_PATH );
+    len = lstrlenW( path );
+    while (len > 3 && path[len - 1] == '\\') path[--len] = 0;
+    for (i = 0; i < len; i++) key = key * 31 + towlower( path[i] );
+    if (!GetFileAttributesExW( path, GetFileExInfoStandard, &info )) return key * 31;
+    return key * 31 + (((UINT64)info.ftLastWriteTime.dwHighDateTime << 32) | info.ftLastWriteTime.dwLowDateTime);
+}
 
-    /* load bitmap strikes */
+static UINT64 add_face_cache_reg_key( UINT64 key, HKEY root, const WCHAR *name )
+{
+    FILETIME time;
+    HKEY hkey;
 
-    index = 0;
-    needed = buffer_size;
-    while (!RegEnumKeyExW( hkey_family, index++, buffer, &needed, NULL, NULL, NULL, NULL ))
+    if (RegOpenKeyW( root, name, &hkey )) return key * 31;
+    if (RegQueryInfoKeyW( hkey, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, &time ))
+        time.dwHighDateTime = time.dwLowDateTime = 0;
+    RegCloseKey( hkey );
+    return key * 31 + (((UINT64)time.dwHighDateTime << 32) | time.dwLowDateTime);
+}
+
+/* key of the state of everything scanned when the cache is built: the font directories,
+ * including the system ones scanned by the backend, and the font registry keys */
+static UINT64 get_face_cache_dirs_key(void)
+{
+    WCHAR *ptr, *next, path[MAX_PATH], value[1024];
+    DWORD len = sizeof(value);
+    UINT64 key = font_funcs->get_fonts_key();
+
+    key = add_face_cache_reg_key( key, HKEY_CURRENT_CONFIG, L"Software\\Fonts" );
+    key = add_face_cache_reg_key( key, HKEY_LOCAL_MACHINE,
+                                  L"Software\\Microsoft\\Windows NT\\CurrentVersion\\Fonts" );
+    key = add_face_cache_reg_key( key, HKEY_LOCAL_MACHINE,
+                                  L"Software\\Microsoft\\Windows\\CurrentVersion\\Fonts" );
+
+    get_fonts_win_dir_path( L"", path );
+    key = add_face_cache_dir_key( key, path );
+    get_fonts_data_dir_path( L"", path );
+    key = add_face_cache_dir_key( key, path );
+
+    if (!RegQueryValueExW( wine_fonts_key, L"Path", NULL, NULL, (BYTE *)value, &len ))
     {
-        if (!RegOpenKeyExW( hkey_family, buffer, 0, KEY_ALL_ACCESS, &hkey_strike ))
+        for (ptr = value; ptr; ptr = next)
         {
-            load_face_from_cache( hkey_strike, family, buffer, buffer_size, FALSE );
-            RegCloseKey( hkey_strike );
+            if ((next = wcschr( ptr, ';' ))) *next++ = 0;
+            if (next && next - ptr < 2) continue;
+            key = add_face_cache_dir_key( key, ptr );
         }
-        needed = buffer_size;
     }
+    return key;
 }
 
-static void load_font_list_from_cache(void)
+static BOOL face_cache_append( struct face_cache *cache, const void *data, DWORD size )
 {
-    DWORD size, family_index = 0;
-    struct gdi_font_family *family;
-    HKEY hkey_family;
-    WCHAR buffer[4096], second_name[LF_FACESIZE];
+    if (cache->size + size > cache->alloc)
+    {
+        DWORD new_alloc = max( cache->alloc * 2, cache->size + size + 4096 );
+        BYTE *new_data;
 
-    size = sizeof(buffer);
-    while (!RegEnumKeyExW( wine_fonts_cache_key, family_index++, buffer, &size, NULL, NULL, NULL, NULL ))
+        if (cache->data) new_data = HeapReAlloc( GetProcessHeap(), 0, cache->data, new_alloc );
+        else new_data = HeapAlloc( GetProcessHeap(), 0, new_alloc );
+        if (!new_data) return FALSE;
+        cache->data = new_data;
+        cache->alloc = new_alloc;
+    }
+    memcpy( cache->data + cache->size, data, size );
+    cache->size += size;
+    cache->count++;
+    return TRUE;
+}
+
+static void face_cache_append_face( struct face_cache *cache, const struct gdi_font_face *face )
+{
+    const WCHAR *names[5];
+    WORD lens[5];
+    DWORD i, size, len = 0, buffer[1024];
+    struct face_cache_entry *entry = (struct face_cache_entry *)buffer;
+
+    names[0] = face->family->family_name;
+    names[1] = face->family->second_name;
+    names[2] = face->style_name;
+    names[3] = face->full_name;
+    names[4] = face->file;
+    for (i = 0; i < ARRAY_SIZE(names); i++)
     {
-        RegOpenKeyExW( wine_fonts_cache_key, buffer, 0, KEY_ALL_ACCESS, &hkey_family );
-        TRACE("opened family key %s\n", debugstr_w(buffer));
-        size = sizeof(second_name);
-        if (RegQueryValueExW( hkey_family, NULL, NULL, NULL, (BYTE *)second_name, &size ))
-            second_name[0] = 0;
+        lens[i] = lstrlenW( names[i] ) + 1;
+        len += lens[i];
+    }
+    size = (offsetof( struct face_cache_entry, names[len] ) + 3) & ~3;
+    if (size > sizeof(buffer)) return;
 
-        family = create_family( buffer, second_name );
+    memset( entry, 0, size );
+    entry->size       = size;
+    entry->index      = face->face_index;
+    entry->flags      = face->flags;
+    entry->ntmflags   = face->ntmFlags;
+    entry->version    = face->version;
+    entry->scalable   = face->scalable;
+    entry->fs         = face->fs;
+    entry->family_len = lens[0];
+    entry->second_len = lens[1];
+    entry->style_len  = lens[2];
+    entry->full_len   = lens[3];
+    entry->file_len   = lens[4];
+    if (!face->scalable) entry->bitmap_size = face->size;
+    for (i = len = 0; i < ARRAY_SIZE(names); len += lens[i++])
+        memcpy( entry->names + len, names[i], lens[i] * sizeof(WCHAR) );
 
-        load_face_from_cache( hkey_family, family, buffer, sizeof(buffer), TRUE );
+    face_cache_append( cache, entry, size );
+}
 
-        RegCloseKey( hkey_family );
-        release_family( family );
-        size = sizeof(buffer);
+/* check if a cache entry describes the same face, in which case it replaces it */
+static BOOL face_cache_entry_matches( const struct face_cache_entry *entry, const struct gdi_font_face *face )
+{
+    const WCHAR *style = entry->names + entry->family_len + entry->second_len;
+
+    if (!entry->scalable != !face->scalable) return FALSE;
+    if (!face->scalable && entry->bitmap_size.y_ppem != face->size.y_ppem) return FALSE;
+    if (wcsicmp( entry->names, face->family->family_name )) return FALSE;
+    return !wcsicmp( style, face->style_name );
+}
+
+static inline const struct face_cache_entry *next_face_cache_entry( const struct face_cache_entry *entry )
+{
+    return (const struct face_cache_entry *)((const BYTE *)entry + entry->size);
+}
+
+/* map the cache file, the returned view must be unmapped by the caller */
+static const struct face_cache_header *map_face_cache(void)
+{
+    const struct face_cache_header *header;
+    WCHAR path[MAX_PATH];
+    HANDLE file, mapping;
+    LARGE_INTEGER size;
+
+    get_face_cache_path( path );
+    file = CreateFileW( path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, 0, 0 );
+    if (file == INVALID_HANDLE_VALUE) return NULL;
+    mapping = NULL;
+    if (GetFileSizeEx( file, &size ) && size.QuadPart >= sizeof(*header) && size.QuadPart < 0x10000000)
+        mapping = CreateFileMappingW( file, NULL, PAGE_READONLY, 0, 0, NULL );
+    CloseHandle( file );
+    if (!mapping) return NULL;
+    header = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+    CloseHandle( mapping );
+    if (!header) return NULL;
+
+    if (header->magic != FACE_CACHE_MAGIC || header->version != FACE_CACHE_VERSION ||
+        header->size != size.QuadPart)
+    {
+        WARN( "invalid font cache %s\n", debugstr_w(path) );
+        UnmapViewOfFile( header );
+        return NULL;
     }
+    if (header->dirs_key != get_face_cache_dirs_key())
+    {
+        TRACE( "font directories changed, ignoring %s\n", debugstr_w(path) );
+        UnmapViewOfFile( header );
+        return NULL;
+    }
+    return header;
 }
 
-static void add_face_to_cache( struct gdi_font_face *face )
+static void write_face_cache( const struct face_cache *cache, UINT64 dirs_key )
 {
-    HKEY hkey_family, hkey_face;
-    DWORD len, buffer[1024];
-    struct cached_face *cached = (struct cached_face *)buffer;
+    struct face_cache_header header;
+    WCHAR path[MAX_PATH], tmp[MAX_PATH];
+    HANDLE file;
+    DWORD written;
+    BOOL ret;
 
-    if (RegCreateKeyExW( wine_fonts_cache_key, face->family->family_name, 0, NULL, REG_OPTION_VOLATILE,
-                         KEY_ALL_ACCESS, NULL, &hkey_family, NULL ))
+    get_face_cache_path( path );
+    lstrcpyW( tmp, path );
+    lstrcatW( tmp, L".tmp" );
+    file = CreateFileW( tmp, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, 0 );
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        WARN( "failed to create %s\n", debugstr_w(tmp) );
         return;
+    }
+    header.magic    = FACE_CACHE_MAGIC;
+    header.version  = FACE_CACHE_VERSION;
+    header.count    = cache->count;
+    header.size     = sizeof(header) + cache->size;
+    header.dirs_key = dirs_key;
+    ret = WriteFile( file, &header, sizeof(header), &written, NULL ) &&
+          WriteFile( file, cache->data, cache->size, &written, NULL );
+    CloseHandle( file );
+    if (!ret || !MoveFileExW( tmp, path, MOVEFILE_REPLACE_EXISTING ))
+    {
+        WARN( "failed to write %s\n", debugstr_w(path) );
+        DeleteFileW( tmp );
+    }
+    TRACE( "wrote %u faces, %u bytes\n", cache->count, header.size );
+}
 
-    if (face->family->second_name[0])
-        RegSetValueExW( hkey_family, NULL, 0, REG_SZ, (BYTE *)face->family->second_name,
-                        (lstrlenW( face->family->second_name ) + 1) * sizeof(WCHAR) );
+static BOOL validate_face_cache( const struct face_cache_header *header )
+{
+    const struct face_cache_entry *entry = (const struct face_cache_entry *)(header + 1);
+    const BYTE *end = (const BYTE *)header + header->size;
+    DWORD i, len;
 
-    if (!face->scalable)
+    for (i = 0; i < header->count; i++, entry = next_face_cache_entry( entry ))
     {
-        WCHAR name[10];
+        if (end - (const BYTE *)entry < offsetof( struct face_cache_entry, names )) return FALSE;
+        if (entry->size < offsetof( struct face_cache_entry, names )) return FALSE;
+        if (entry->size > end - (const BYTE *)entry) return FALSE;
+        if (!entry->family_len || !entry->second_len || !entry->style_len ||
+            !entry->full_len || !entry->file_len) return FALSE;
+        len = entry->family_len + entry->second_len + entry->style_len + entry->full_len + entry->file_len;
+        if (offsetof( struct face_cache_entry, names[len] ) > entry->size) return FALSE;
+        if (entry->names[entry->family_len - 1] || entry->names[len - 1]) return FALSE;
+    }
+    return TRUE;
+}
+
+static BOOL load_font_list_from_cache(void)
+{
+    const struct face_cache_header *header;
+    const struct face_cache_entry *entry;
+    struct gdi_font_family *family;
+    struct gdi_font_face *face;
+    const WCHAR *second, *style, *full, *file;
+    DWORD i;
 
-        swprintf( name, ARRAY_SIZE(name), L"%d", face->size.y_ppem );
-        RegCreateKeyExW( hkey_family, name, 0, NULL, REG_OPTION_VOLATILE, KEY_ALL_ACCESS,
-                         NULL, &hkey_face, NULL);
+    if (!(header = map_face_cache())) return FALSE;
+    if (!validate_face_cache( header ))
+    {
+        WARN( "invalid font cache\n" );
+        UnmapViewOfFile( header );
+        return FALSE;
     }
-    else hkey_face = hkey_family;
 
-    memset( cached, 0, sizeof(*cached) );
-    cached->index = face->face_index;
-    cached->flags = face->flags;
-    cached->ntmflags = face->ntmFlags;
-    cached->version = face->version;
-    cached->fs = face->fs;
-    if (!face->scalable) cached->size = face->size;
-    lstrcpyW( cached->full_name, face->full_name );
-    len = lstrlenW( face->full_name ) + 1;
-    lstrcpyW( cached->full_name + len, face->file );
-    len += lstrlenW( face->file ) + 1;
+    entry = (const struct face_cache_entry *)(header + 1);
+    for (i = 0; i < header->count; i++, entry = next_face_cache_entry( entry ))
+    {
+        second = entry->names + entry->family_len;
+        style  = second + entry->second_len;
+        full   = style + entry->style_len;
+        file   = full + entry->full_len;
 
-    RegSetValueExW( hkey_face, face->style_name, 0, REG_BINARY, (BYTE *)cached,
-                    offsetof( struct cached_face, full_name[len] ));
+        if ((family = find_family_from_name( entry->names ))) family->refcount++;
+        else if (!(family = create_family( entry->names, second ))) continue;
+
+        if ((face = create_face( family, style, full, file, NULL, 0, entry->index, entry->fs,
+                                 entry->ntmflags, entry->version, entry->flags,
+                                 entry->scalable ? NULL : &entry->bitmap_size )))
+        {
+            if (!face->scalable)
+                TRACE("Adding bitmap size h %d w %d size %d x_ppem %d y_ppem %d\n",
+                      face->size.height, face->size.width, face->size.size >> 6,
+                      face->size.x_ppem >> 6, face->size.y_ppem >> 6);
 
-    if (hkey_face != hkey_family) RegCloseKey( hkey_face );
-    RegCloseKey( hkey_family );
+            TRACE("fsCsb = %08x %08x/%08x %08x %08x %08x\n",
+                  face->fs.fsCsb[0], face->fs.fsCsb[1],
+                  face->fs.fsUsb[0], face->fs.fsUsb[1],
+                  face->fs.fsUsb[2], face->fs.fsUsb[3]);
+
+            release_face( face );
+        }
+        release_family( family );
+    }
+    TRACE( "loaded %u faces from the cache\n", header->count );
+    UnmapViewOfFile( header );
+    return TRUE;
 }
 
-static void remove_face_from_cache( struct gdi_font_face *face )
+/* append a face at the end of the cache file */
+static void append_face_cache( const struct face_cache_header *old_header, const struct gdi_font_face *face )
 {
-    HKEY hkey_family;
+    struct face_cache_header header = *old_header;
+    struct face_cache cache = { NULL };
+    WCHAR path[MAX_PATH];
+    LARGE_INTEGER pos;
+    DWORD written;
+    HANDLE file;
+    BOOL ret;
 
-    if (RegOpenKeyExW( wine_fonts_cache_key, face->family->family_name, 0, KEY_ALL_ACCESS, &hkey_family ))
+    face_cache_append_face( &cache, face );
+    if (!cache.count) return;
+
+    get_face_cache_path( path );
+    file = CreateFileW( path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, 0 );
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        HeapFree( GetProcessHeap(), 0, cache.data );
         return;
+    }
 
-    if (!face->scalable)
+    /* the header is updated last, a partially written entry leaves a size mismatch */
+    header.count += cache.count;
+    header.size  += cache.size;
+    pos.QuadPart = old_header->size;
+    ret = SetFilePointerEx( file, pos, NULL, FILE_BEGIN ) &&
+          WriteFile( file, cache.data, cache.size, &written, NULL ) && written == cache.size;
+    pos.QuadPart = 0;
+    ret = ret && SetFilePointerEx( file, pos, NULL, FILE_BEGIN ) &&
+          WriteFile( file, &header, sizeof(header), &written, NULL ) && written == sizeof(header);
+    CloseHandle( file );
+    if (!ret)
+    {
+        WARN( "failed to update %s\n", debugstr_w(path) );
+        DeleteFileW( path );
+    }
+    HeapFree( GetProcessHeap(), 0, cache.data );
+}
+
+/* add or remove a face in the cache file, for fonts added after initialization.
+ * New faces are appended, the file is only rewritten when an entry is replaced
+ * or removed. */
+static void update_face_cache( const struct gdi_font_face *face, BOOL add )
+{
+    const struct face_cache_header *header;
+    const struct face_cache_entry *entry;
+    struct face_cache_header old_header;
+    struct face_cache cache = { NULL };
+    BOOL found = FALSE;
+    HANDLE mutex;
+    DWORD i;
+
+    if (!(mutex = CreateMutexW( NULL, FALSE, L"__WINE_FONT_MUTEX__" ))) return;
+    WaitForSingleObject( mutex, INFINITE );
+
+    if (!(header = map_face_cache()) || !validate_face_cache( header ))
     {
-        WCHAR name[10];
-        swprintf( name, ARRAY_SIZE(name), L"%d", face->size.y_ppem );
-        RegDeleteKeyW( hkey_family, name );
+        /* the next process will rebuild it */
+        if (header) UnmapViewOfFile( header );
+        goto done;
+    }
+
+    old_header = *header;
+    entry = (const struct face_cache_entry *)(header + 1);
+    for (i = 0; i < header->count && !found; i++, entry = next_face_cache_entry( entry ))
+        found = face_cache_entry_matches( entry, face );
+
+    if (!found)
+    {
+        UnmapViewOfFile( header );
+        if (add) append_face_cache( &old_header, face );
+        goto done;
+    }
+
+    entry = (const struct face_cache_entry *)(header + 1);
+    for (i = 0; i < header->count; i++, entry = next_face_cache_entry( entry ))
+        if (!face_cache_entry_matches( entry, face )) face_cache_append( &cache, entry, entry->size );
+    UnmapViewOfFile( header );
+    if (add) face_cache_append_face( &cache, face );
+    write_face_cache( &cache, old_header.dirs_key );
+    HeapFree( GetProcessHeap(), 0, cache.data );
+
+done:
+    ReleaseMutex( mutex );
+    CloseHandle( mutex );
+}
+
+/* write the cache file from the faces that remain after scanning the font directories */
+static void build_face_cache(void)
+{
+    struct face_cache cache = { NULL };
+    struct gdi_font_family *family;
+    struct gdi_font_face *face;
+
+    WINE_RB_FOR_EACH_ENTRY( family, &family_name_tree, struct gdi_font_family, name_entry )
+    {
+        LIST_FOR_EACH_ENTRY( face, &family->faces, struct gdi_font_face, entry )
+            if (face->flags & ADDFONT_ADD_TO_CACHE) face_cache_append_face( &cache, face );
     }
-    else RegDeleteValueW( hkey_family, face->style_name );
+    write_face_cache( &cache, get_face_cache_dirs_key() );
+    HeapFree( GetProcessHeap(), 0, cache.data );
+}
 
-    RegCloseKey( hkey_family );
+static void add_face_to_cache( struct gdi_font_face *face )
+{
+    if (!face_cache_loading) update_face_cache( face, TRUE );
+}
+
+static void remove_face_from_cache( struct gdi_font_face *face )
+{
+    if (!face_cache_loading) update_face_cache( face, FALSE );
 }
 
 /* font links */
@@ -1786,6 +2071,502 @@ static void set_gdi_font_glyph_metrics( struct gdi_font *font, UINT index,
     font->gm[block][entry].init = TRUE;
 }
 
+/* glyph bitmap cache, shared by all the fonts of the process so that the glyphs
+ * survive fonts being created and destroyed repeatedly. Glyphs missing from it
+ * are looked up in the shared glyph cache before being rendered. */
+
+struct glyph_cache_font
+{
+    struct list  entry;
+    DWORD        id;
+    UINT64       hash;
+    LOGFONTW     lf;
+    FMAT2        matrix;
+    INT          scale_y;
+    INT          aveWidth;
+    UINT         face_index;
+    UINT         ntmFlags;
+    BOOL         can_use_bitmap;
+    BOOL         fake_italic;
+    BOOL         fake_bold;
+    FILETIME     writetime;
+    SIZE_T       data_size;
+    WCHAR        file[1];
+};
+
+struct glyph_cache_entry
+{
+    struct list  entry;      /* entry in the hash table */
+    struct list  lru_entry;  /* entry in the LRU list, most recent first */
+    DWORD        font_id;
+    UINT         index;
+    UINT         format;
+    BOOL         tategaki;
+    GLYPHMETRICS gm;
+    ABC          abc;
+    DWORD        size;
+    BYTE         bits[1];
+};
+
+#define GLYPH_CACHE_HASH_SIZE  1024
+#define GLYPH_CACHE_MAX_FONTS  256
+#define GLYPH_CACHE_MAX_SIZE   (4 * 1024 * 1024)
+#define GLYPH_CACHE_MAX_GLYPH  (64 * 1024)
+
+static struct list glyph_cache_fonts = LIST_INIT( glyph_cache_fonts );
+static unsigned int glyph_cache_font_count;
+static struct list glyph_cache_hash[GLYPH_CACHE_HASH_SIZE];
+static struct list glyph_cache_lru = LIST_INIT( glyph_cache_lru );
+static UINT glyph_cache_size;
+
+/* The shared glyph cache is a section mapped by all the processes of the prefix,
+ * holding a ring of rendered glyphs and a direct-mapped table pointing into it.
+ * Positions in the ring are counted from its creation, so an entry is still
+ * valid as long as less than a ring size has been written after it. Fonts are
+ * identified by a hash of the font file and the rendering parameters.
+ * Its size is set in MB with the "SharedGlyphCacheSize" value of the
+ * HKCU\Software\Wine\Fonts key, 0 disables it. */
+
+#define SHARED_GLYPH_CACHE_MAGIC  0x31434753  /* "SGC1" */
+#define SHARED_GLYPH_CACHE_SLOTS  16384
+#define SHARED_GLYPH_CACHE_DEFAULT_SIZE  8
+
+struct shared_glyph_key
+{
+    UINT64       font_hash;
+    UINT         index;
+    UINT         format;
+    UINT         tategaki;
+    UINT         pad;
+};
+
+struct shared_glyph_slot
+{
+    UINT64       hash;
+    UINT64       pos;
+};
+
+struct shared_glyph_cache
+{
+    DWORD        magic;
+    DWORD        data_size;
+    UINT64       write_pos;
+    struct shared_glyph_slot slots[SHARED_GLYPH_CACHE_SLOTS];
+    BYTE         data[1];
+};
+
+struct shared_glyph_entry
+{
+    UINT64       hash;
+    struct shared_glyph_key key;
+    GLYPHMETRICS gm;
+    ABC          abc;
+    DWORD        size;
+    BYTE         bits[1];
+};
+
+static struct shared_glyph_cache *shared_glyph_cache;
+static HANDLE shared_glyph_cache_mutex;
+static BOOL shared_glyph_cache_initialized;
+
+static BOOL is_cacheable_glyph_format( UINT format )
+{
+    switch (format)
+    {
+    case GGO_BITMAP:
+    case GGO_GRAY2_BITMAP:
+    case GGO_GRAY4_BITMAP:
+    case GGO_GRAY8_BITMAP:
+    case WINE_GGO_GRAY16_BITMAP:
+    case WINE_GGO_HRGB_BITMAP:
+    case WINE_GGO_HBGR_BITMAP:
+    case WINE_GGO_VRGB_BITMAP:
+    case WINE_GGO_VBGR_BITMAP:
+        return TRUE;
+    }
+    return FALSE;
+}
+
+static void free_glyph_cache_entry( struct glyph_cache_entry *entry )
+{
+    list_remove( &entry->entry );
+    list_remove( &entry->lru_entry );
+    glyph_cache_size -= offsetof( struct glyph_cache_entry, bits[entry->size] );
+    HeapFree( GetProcessHeap(), 0, entry );
+}
+
+static void flush_glyph_cache(void)
+{
+    struct glyph_cache_font *cache_font, *next;
+
+    TRACE( "flushing %u bytes\n", glyph_cache_size );
+    while (!list_empty( &glyph_cache_lru ))
+        free_glyph_cache_entry( LIST_ENTRY( list_head( &glyph_cache_lru ), struct glyph_cache_entry, lru_entry ));
+    LIST_FOR_EACH_ENTRY_SAFE( cache_font, next, &glyph_cache_fonts, struct glyph_cache_font, entry )
+    {
+        list_remove( &cache_font->entry );
+        HeapFree( GetProcessHeap(), 0, cache_font );
+    }
+    glyph_cache_font_count = 0;
+}
+
+static UINT64 hash_glyph_cache_data( UINT64 hash, const void *data, SIZE_T size )
+{
+    const BYTE *ptr = data;
+
+    while (size--) hash = (hash ^ *ptr++) * 0x100000001b3;
+    return hash;
+}
+
+/* hash identifying the glyph rendering parameters of a font across processes */
+static UINT64 get_glyph_cache_font_hash( const struct gdi_font *font )
+{
+    struct
+    {
+        LOGFONTW lf;
+        FMAT2    matrix;
+        INT      scale_y;
+        INT      aveWidth;
+        UINT     face_index;
+        UINT     ntmFlags;
+        BOOL     can_use_bitmap;
+        BOOL     fake_italic;
+        BOOL     fake_bold;
+        FILETIME writetime;
+        UINT64   data_size;
+    } key;
+    UINT64 hash;
+
+    /* clear the padding and anything after the face name */
+    memset( &key, 0, sizeof(key) );
+    key.lf = font->lf;
+    memset( key.lf.lfFaceName, 0, sizeof(key.lf.lfFaceName) );
+    lstrcpynW( key.lf.lfFaceName, font->lf.lfFaceName, LF_FACESIZE );
+    key.matrix         = font->matrix;
+    key.scale_y        = font->scale_y;
+    key.aveWidth       = font->aveWidth;
+    key.face_index     = font->face_index;
+    key.ntmFlags       = font->ntmFlags;
+    key.can_use_bitmap = font->can_use_bitmap;
+    key.fake_italic    = font->fake_italic;
+    key.fake_bold      = font->fake_bold;
+    key.writetime      = font->writetime;
+    key.data_size      = font->data_size;
+
+    hash = hash_glyph_cache_data( 0xcbf29ce484222325, &key, sizeof(key) );
+    return hash_glyph_cache_data( hash, font->file, lstrlenW( font->file ) * sizeof(WCHAR) );
+}
+
+/* return the id identifying the glyph rendering parameters of a font, or 0 if it can't be cached */
+static DWORD get_glyph_cache_font_id( struct gdi_font *font )
+{
+    static DWORD last_id;
+    struct glyph_cache_font *cache_font;
+    UINT len;
+
+    if (font->glyph_cache_id) return font->glyph_cache_id;
+    if (!font->file[0]) return 0;  /* memory fonts can be removed at any time */
+
+    LIST_FOR_EACH_ENTRY( cache_font, &glyph_cache_fonts, struct glyph_cache_font, entry )
+    {
+        if (cache_font->face_index != font->face_index) continue;
+        if (cache_font->scale_y != font->scale_y) continue;
+        if (cache_font->aveWidth != font->aveWidth) continue;
+        if (cache_font->ntmFlags != font->ntmFlags) continue;
+        if (cache_font->can_use_bitmap != font->can_use_bitmap) continue;
+        if (cache_font->fake_italic != font->fake_italic) continue;
+        if (cache_font->fake_bold != font->fake_bold) continue;
+        if (cache_font->data_size != font->data_size) continue;
+        if (CompareFileTime( &cache_font->writetime, &font->writetime )) continue;
+        if (memcmp( &cache_font->matrix, &font->matrix, sizeof(font->matrix) )) continue;
+        if (memcmp( &cache_font->lf, &font->lf, sizeof(font->lf) )) continue;
+        if (wcscmp( cache_font->file, font->file )) continue;
+        list_remove( &cache_font->entry );
+        list_add_head( &glyph_cache_fonts, &cache_font->entry );
+        font->glyph_cache_hash = cache_font->hash;
+        return font->glyph_cache_id = cache_font->id;
+    }
+
+    if (glyph_cache_font_count >= GLYPH_CACHE_MAX_FONTS) flush_glyph_cache();
+
+    len = lstrlenW( font->file );
+    if (!(cache_font = HeapAlloc( GetProcessHeap(), 0, offsetof( struct glyph_cache_font, file[len + 1] ))))
+        return 0;
+    cache_font->id             = ++last_id;
+    cache_font->hash           = get_glyph_cache_font_hash( font );
+    cache_font->lf             = font->lf;
+    cache_font->matrix         = font->matrix;
+    cache_font->scale_y        = font->scale_y;
+    cache_font->aveWidth       = font->aveWidth;
+    cache_font->face_index     = font->face_index;
+    cache_font->ntmFlags       = font->ntmFlags;
+    cache_font->can_use_bitmap = font->can_use_bitmap;
+    cache_font->fake_italic    = font->fake_italic;
+    cache_font->fake_bold      = font->fake_bold;
+    cache_font->writetime      = font->writetime;
+    cache_font->data_size      = font->data_size;
+    memcpy( cache_font->file, font->file, (len + 1) * sizeof(WCHAR) );
+    list_add_head( &glyph_cache_fonts, &cache_font->entry );
+    glyph_cache_font_count++;
+    TRACE( "font %p id %u file %s\n", font, cache_font->id, debugstr_w(font->file) );
+    font->glyph_cache_hash = cache_font->hash;
+    return font->glyph_cache_id = cache_font->id;
+}
+
+static inline struct list *get_glyph_cache_bucket( DWORD font_id, UINT index, UINT format )
+{
+    return &glyph_cache_hash[(font_id * 31 + index * 7 + format) % GLYPH_CACHE_HASH_SIZE];
+}
+
+static struct glyph_cache_entry *find_glyph_cache_entry( DWORD font_id, UINT index, UINT format,
+                                                          BOOL tategaki )
+{
+    struct list *bucket = get_glyph_cache_bucket( font_id, index, format );
+    struct glyph_cache_entry *entry;
+
+    if (!bucket->next) return NULL;  /* not initialized yet */
+    LIST_FOR_EACH_ENTRY( entry, bucket, struct glyph_cache_entry, entry )
+    {
+        if (entry->font_id != font_id || entry->index != index) continue;
+        if (entry->format != format || entry->tategaki != tategaki) continue;
+        list_remove( &entry->lru_entry );
+        list_add_head( &glyph_cache_lru, &entry->lru_entry );
+        return entry;
+    }
+    return NULL;
+}
+
+static struct glyph_cache_entry *alloc_glyph_cache_entry( DWORD font_id, UINT index, UINT format,
+                                                           BOOL tategaki, DWORD size )
+{
+    struct glyph_cache_entry *entry;
+
+    if (!(entry = HeapAlloc( GetProcessHeap(), HEAP_ZERO_MEMORY, offsetof( struct glyph_cache_entry, bits[size] ))))
+        return NULL;
+    entry->font_id  = font_id;
+    entry->index    = index;
+    entry->format   = format;
+    entry->tategaki = tategaki;
+    entry->size     = size;
+    return entry;
+}
+
+static void add_glyph_cache_entry( struct glyph_cache_entry *entry )
+{
+    struct list *bucket = get_glyph_cache_bucket( entry->font_id, entry->index, entry->format );
+
+    glyph_cache_size += offsetof( struct glyph_cache_entry, bits[entry->size] );
+    while (glyph_cache_size > GLYPH_CACHE_MAX_SIZE && !list_empty( &glyph_cache_lru ))
+        free_glyph_cache_entry( LIST_ENTRY( list_tail( &glyph_cache_lru ), struct glyph_cache_entry, lru_entry ));
+
+    if (!bucket->next) list_init( bucket );
+    list_add_head( bucket, &entry->entry );
+    list_add_head( &glyph_cache_lru, &entry->lru_entry );
+}
+
+/* render a glyph bitmap into a new cache entry */
+static struct glyph_cache_entry *render_glyph_cache_entry( struct gdi_font *font, DWORD font_id, UINT index,
+                                                            UINT format, BOOL tategaki )
+{
+    struct glyph_cache_entry *entry;
+    GLYPHMETRICS gm;
+    ABC abc;
+    DWORD size;
+
+    size = font_funcs->get_glyph_outline( font, index, format, &gm, &abc, 0, NULL, NULL, tategaki );
+    if (size == GDI_ERROR || size > GLYPH_CACHE_MAX_GLYPH) return NULL;
+
+    if (!(entry = alloc_glyph_cache_entry( font_id, index, format, tategaki, size ))) return NULL;
+    if (size && font_funcs->get_glyph_outline( font, index, format, &gm, &abc,
+                                               size, entry->bits, NULL, tategaki ) == GDI_ERROR)
+    {
+        HeapFree( GetProcessHeap(), 0, entry );
+        return NULL;
+    }
+    entry->gm  = gm;
+    entry->abc = abc;
+    return entry;
+}
+
+static BOOL init_shared_glyph_cache(void)
+{
+    DWORD type, count, value, size = SHARED_GLYPH_CACHE_DEFAULT_SIZE, total;
+    struct shared_glyph_cache *cache;
+    WCHAR name[64];
+    HANDLE mapping;
+
+    if (shared_glyph_cache_initialized) return shared_glyph_cache != NULL;
+    shared_glyph_cache_initialized = TRUE;
+
+    count = sizeof(value);
+    if (!RegQueryValueExW( wine_fonts_key, L"SharedGlyphCacheSize", NULL, &type, (BYTE *)&value, &count )
+            && type == REG_DWORD)
+        size = value;
+    if (!size) return FALSE;
+    size = min( size, 256 );
+
+    /* the size is part of the name, processes that use a different one get their own cache */
+    total = offsetof( struct shared_glyph_cache, data[size * 1024 * 1024] );
+    swprintf( name, ARRAY_SIZE(name), L"__wine_gdi32_glyph_cache_%u", size );
+    if (!(mapping = CreateFileMappingW( INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, total, name )))
+    {
+        WARN( "failed to create the shared glyph cache, error %u\n", GetLastError() );
+        return FALSE;
+    }
+    cache = MapViewOfFile( mapping, FILE_MAP_WRITE, 0, 0, total );
+    CloseHandle( mapping );
+    if (!cache) return FALSE;
+
+    wcscat( name, L"_mutex" );
+    if (!(shared_glyph_cache_mutex = CreateMutexW( NULL, FALSE, name )))
+    {
+        UnmapViewOfFile( cache );
+        return FALSE;
+    }
+
+    WaitForSingleObject( shared_glyph_cache_mutex, INFINITE );
+    if (cache->magic != SHARED_GLYPH_CACHE_MAGIC)
+    {
+        cache->magic = SHARED_GLYPH_CACHE_MAGIC;
+        cache->data_size = size * 1024 * 1024;
+    }
+    ReleaseMutex( shared_glyph_cache_mutex );
+
+    TRACE( "using a %u MB shared glyph cache\n", size );
+    shared_glyph_cache = cache;
+    return TRUE;
+}
+
+static BOOL lock_shared_glyph_cache(void)
+{
+    if (!init_shared_glyph_cache()) return FALSE;
+
+    switch (WaitForSingleObject( shared_glyph_cache_mutex, INFINITE ))
+    {
+    case WAIT_OBJECT_0:
+        return TRUE;
+    case WAIT_ABANDONED:
+        /* a process died while updating the cache, the table can't be trusted */
+        WARN( "resetting the shared glyph cache\n" );
+        memset( shared_glyph_cache->slots, 0, sizeof(shared_glyph_cache->slots) );
+        return TRUE;
+    default:
+        return FALSE;
+    }
+}
+
+static void get_shared_glyph_key( const struct gdi_font *font, UINT index, UINT format, BOOL tategaki,
+                                  struct shared_glyph_key *key, UINT64 *hash )
+{
+    memset( key, 0, sizeof(*key) );
+    key->font_hash = font->glyph_cache_hash;
+    key->index     = index;
+    key->format    = format;
+    key->tategaki  = tategaki;
+    if (!(*hash = hash_glyph_cache_data( 0xcbf29ce484222325, key, sizeof(*key) ))) *hash = 1;
+}
+
+/* copy a glyph from the shared cache into a new process cache entry */
+static struct glyph_cache_entry *find_shared_glyph_cache_entry( struct gdi_font *font, DWORD font_id,
+                                                                UINT index, UINT format, BOOL tategaki )
+{
+    struct glyph_cache_entry *entry = NULL;
+    const struct shared_glyph_entry *shared;
+    const struct shared_glyph_slot *slot;
+    struct shared_glyph_key key;
+    UINT64 hash;
+
+    get_shared_glyph_key( font, index, format, tategaki, &key, &hash );
+    if (!lock_shared_glyph_cache()) return NULL;
+
+    slot = &shared_glyph_cache->slots[hash % SHARED_GLYPH_CACHE_SLOTS];
+    if (slot->hash == hash && shared_glyph_cache->write_pos - slot->pos <= shared_glyph_cache->data_size)
+    {
+        shared = (const struct shared_glyph_entry *)(shared_glyph_cache->data + slot->pos % shared_glyph_cache->data_size);
+        if (shared->hash == hash && !memcmp( &shared->key, &key, sizeof(key) ) &&
+            (entry = alloc_glyph_cache_entry( font_id, index, format, tategaki, shared->size )))
+        {
+            entry->gm  = shared->gm;
+            entry->abc = shared->abc;
+            memcpy( entry->bits, shared->bits, shared->size );
+        }
+    }
+
+    ReleaseMutex( shared_glyph_cache_mutex );
+    return entry;
+}
+
+static void add_shared_glyph_cache_entry( struct gdi_font *font, const struct glyph_cache_entry *entry )
+{
+    DWORD len = (offsetof( struct shared_glyph_entry, bits[entry->size] ) + 7) & ~7;
+    struct shared_glyph_entry *shared;
+    struct shared_glyph_slot *slot;
+    struct shared_glyph_key key;
+    UINT64 hash, pos;
+
+    get_shared_glyph_key( font, entry->index, entry->format, entry->tategaki, &key, &hash );
+    if (!lock_shared_glyph_cache()) return;
+
+    if (len <= shared_glyph_cache->data_size)
+    {
+        /* entries don't wrap around the end of the ring */
+        pos = shared_glyph_cache->write_pos;
+        if (pos % shared_glyph_cache->data_size + len > shared_glyph_cache->data_size)
+            pos += shared_glyph_cache->data_size - pos % shared_glyph_cache->data_size;
+
+        shared = (struct shared_glyph_entry *)(shared_glyph_cache->data + pos % shared_glyph_cache->data_size);
+        shared->hash = hash;
+        shared->key  = key;
+        shared->gm   = entry->gm;
+        shared->abc  = entry->abc;
+        shared->size = entry->size;
+        memcpy( shared->bits, entry->bits, entry->size );
+        shared_glyph_cache->write_pos = pos + len;
+
+        slot = &shared_glyph_cache->slots[hash % SHARED_GLYPH_CACHE_SLOTS];
+        slot->hash = hash;
+        slot->pos  = pos;
+    }
+
+    ReleaseMutex( shared_glyph_cache_mutex );
+}
+
+/* retrieve a glyph bitmap from the cache, same semantics as the get_glyph_outline backend function */
+static BOOL get_cached_glyph_bitmap( struct gdi_font *font, UINT index, UINT format, BOOL tategaki,
+                                     GLYPHMETRICS *gm, ABC *abc, DWORD buflen, void *buf, DWORD *ret )
+{
+    struct glyph_cache_entry *entry;
+    DWORD font_id;
+
+    if (!(font_id = get_glyph_cache_font_id( font ))) return FALSE;
+    if (!(entry = find_glyph_cache_entry( font_id, index, format, tategaki )))
+    {
+        if ((entry = find_shared_glyph_cache_entry( font, font_id, index, format, tategaki )))
+            add_glyph_cache_entry( entry );
+        else if (!buf || !buflen)
+            return FALSE;  /* size queries don't need the glyph to be rendered */
+        else if ((entry = render_glyph_cache_entry( font, font_id, index, format, tategaki )))
+        {
+            add_glyph_cache_entry( entry );
+            if (init_shared_glyph_cache()) add_shared_glyph_cache_entry( font, entry );
+        }
+        else return FALSE;
+    }
+
+    /* same as the backend: size queries return the size, empty glyphs and short buffers
+     * fail, and the rest of the buffer is cleared */
+    if (!buf || !buflen) *ret = entry->size;
+    else if (!entry->size || entry->size > buflen) *ret = GDI_ERROR;
+    else
+    {
+        memcpy( buf, entry->bits, entry->size );
+        memset( (BYTE *)buf + entry->size, 0, buflen - entry->size );
+        *ret = entry->size;
+    }
+    *gm = entry->gm;
+    *abc = entry->abc;
+    return TRUE;
+}
 
 /* GSUB table support */
 
@@ -2934,7 +3715,9 @@ static DWORD get_glyph_outline( struct gdi_font *font, UINT glyph, UINT format,
     if (format == GGO_METRICS && !mat && get_gdi_font_glyph_metrics( font, index, &gm, &abc ))
         goto done;
 
-    ret = font_funcs->get_glyph_outline( font, index, format, &gm, &abc, buflen, buf, mat, tategaki );
+    if (mat || !is_cacheable_glyph_format( format ) ||
+        !get_cached_glyph_bitmap( font, index, format, tategaki, &gm, &abc, buflen, buf, &ret ))
+        ret = font_funcs->get_glyph_outline( font, index, format, &gm, &abc, buflen, buf, mat, tategaki );
     if (ret == GDI_ERROR) return ret;
 
     if ((format == GGO_METRICS || format == GGO_BITMAP || format ==  WINE_GGO_GRAY16_BITMAP) && !mat)
@@ -7919,7 +8702,6 @@ static const struct font_callback_funcs callback_funcs = { add_gdi_face };
 void font_init(void)
 {
     HANDLE mutex;
-    DWORD disposition;
 
     if (RegCreateKeyExW( HKEY_CURRENT_USER, L"Software\\Wine\\Fonts", 0, NULL, 0,
                          KEY_ALL_ACCESS, NULL, &wine_fonts_key, NULL ))
@@ -7932,10 +8714,8 @@ void font_init(void)
     if (!(mutex = CreateMutexW( NULL, FALSE, L"__WINE_FONT_MUTEX__" ))) return;
     WaitForSingleObject( mutex, INFINITE );
 
-    RegCreateKeyExW( wine_fonts_key, L"Cache", 0, NULL, REG_OPTION_VOLATILE,
-                     KEY_ALL_ACCESS, NULL, &wine_fonts_cache_key, &disposition );
-
-    if (disposition == REG_CREATED_NEW_KEY)
+    face_cache_loading = TRUE;
+    if (!load_font_list_from_cache())
     {
         HKEY key = load_external_font_keys();
         load_system_bitmap_fonts();
@@ -7944,8 +8724,9 @@ void font_init(void)
         font_funcs->load_fonts();
         update_external_font_keys( key );
         RegCloseKey( key );
+        build_face_cache();
     }
-    else load_font_list_from_cache();
+    face_cache_loading = FALSE;
 
     ReleaseMutex( mutex );
 
@@ -1754,6 +1754,50 @@ static void CDECL freetype_load_fonts(void)
 #endif
 }
 
+static UINT64 add_font_dir_key( UINT64 key, const char *dir )
+{
+    struct stat st;
+    const char *p;
+
+    for (p = dir; *p; p++) key = key * 31 + (unsigned char)*p;
+    if (stat( dir, &st ) == -1) return key * 31;
+    return key * 31 + st.st_mtime;
+}
+
+/*************************************************************
+ * freetype_get_fonts_key
+ *
+ * Key of the state of the directories scanned by freetype_load_fonts().
+ */
+static UINT64 CDECL freetype_get_fonts_key(void)
+{
+    UINT64 key = 0;
+#ifdef SONAME_LIBFONTCONFIG
+    const FcChar8 *dir;
+    FcStrList *dir_list;
+    FcConfig *config;
+
+    /* the font directories include all their subdirectories */
+    if (fontconfig_enabled && (config = pFcConfigGetCurrent()) && (dir_list = pFcConfigGetFontDirs( config )))
+    {
+        while ((dir = pFcStrListNext( dir_list ))) key = add_font_dir_key( key, (const char *)dir );
+        pFcStrListDone( dir_list );
+    }
+#elif defined(HAVE_CARBON_CARBON_H)
+    static const char *dirs[] = { "/Library/Fonts", "/System/Library/Fonts", "/Network/Library/Fonts" };
+    const char *home = getenv( "HOME" );
+    char path[MAX_PATH];
+    unsigned int i;
+
+    for (i = 0; i < ARRAY_SIZE(dirs); i++) key = add_font_dir_key( key, dirs[i] );
+    if (home && snprintf( path, sizeof(path), "%s/Library/Fonts", home ) < sizeof(path))
+        key = add_font_dir_key( key, path );
+#elif defined(__ANDROID__)
+    key = add_font_dir_key( key, "/system/fonts" );
+#endif
+    return key;
+}
+
 /* Some fonts have large usWinDescent values, as a result of storing signed short
    in unsigned field. That's probably caused by sTypoDescent vs usWinDescent confusion in
    some font generation tools. */
@@ -4101,6 +4145,7 @@ static DWORD CDECL freetype_get_kerning_pairs( struct gdi_font *font, KERNINGPAI
 static const struct font_backend_funcs font_funcs =
 {
     freetype_load_fonts,
+    freetype_get_fonts_key,
     fontconfig_enum_family_fallbacks,
     freetype_add_font,
     freetype_add_mem_font,
@@ -260,6 +260,7 @@ extern DWORD put_image_into_bitmap( BITMAPOBJ *bmp, HRGN clip, BITMAPINFO *info,
                                     const struct gdi_image_bits *bits, struct bitblt_coords *src,
                                     struct bitblt_coords *dst ) DECLSPEC_HIDDEN;
 extern void dibdrv_set_window_surface( DC *dc, struct window_surface *surface ) DECLSPEC_HIDDEN;
+extern void init_dib_row_funcs(void) DECLSPEC_HIDDEN;
 
 extern NTSTATUS init_opengl_lib( HMODULE module, DWORD reason, const void *ptr_in, void *ptr_out ) DECLSPEC_HIDDEN;
 
@@ -330,6 +331,8 @@ struct gdi_font
     struct list            child_fonts;
     DWORD                  handle;
     DWORD                  cache_num;
+    DWORD                  glyph_cache_id;     /* id in the glyph bitmap cache, 0 if not assigned yet */
+    UINT64                 glyph_cache_hash;   /* hash of the glyph rendering parameters */
     DWORD                  hash;
     UINT                   charset;
     UINT                   codepage;
@@ -381,6 +384,7 @@ struct gdi_font
 struct font_backend_funcs
 {
     void  (CDECL *load_fonts)(void);
+    UINT64 (CDECL *get_fonts_key)(void);
     BOOL  (CDECL *enum_family_fallbacks)( DWORD pitch_and_family, int index, WCHAR buffer[LF_FACESIZE] );
     INT   (CDECL *add_font)( const WCHAR *file, DWORD flags );
     INT   (CDECL *add_mem_font)( void *ptr, SIZE_T size, DWORD flags );
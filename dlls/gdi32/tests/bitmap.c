@@ -4001,6 +4001,226 @@ static void test_clipping(void)
     DeleteDC( hdcSrc );
 }
 
+static HBITMAP create_row_dib( HDC hdc, int width, int bpp, void **bits )
+{
+    char buffer[FIELD_OFFSET( BITMAPINFO, bmiColors[256] )];
+    BITMAPINFO *info = (BITMAPINFO *)buffer;
+
+    memset( info, 0, sizeof(info->bmiHeader) );
+    info->bmiHeader.biSize = sizeof(info->bmiHeader);
+    info->bmiHeader.biWidth = width;
+    info->bmiHeader.biHeight = -1;
+    info->bmiHeader.biPlanes = 1;
+    info->bmiHeader.biBitCount = bpp;
+    info->bmiHeader.biCompression = BI_RGB;
+    return CreateDIBSection( hdc, info, DIB_RGB_COLORS, bits, NULL, 0 );
+}
+
+static void time_row_primitives( HDC hdc_dst, HDC hdc_src, HDC hdc_src16 )
+{
+    static const BLENDFUNCTION blend_src_alpha = { AC_SRC_OVER, 0, 255, AC_SRC_ALPHA };
+    static const BLENDFUNCTION blend_const_alpha = { AC_SRC_OVER, 0, 128, AC_SRC_ALPHA };
+    DWORD start, i;
+
+    start = GetTickCount();
+    for (i = 0; i < 20000; i++) PatBlt( hdc_dst, 0, 0, 1024, 1, PATINVERT );
+    trace( "PatBlt 32bpp: %u ms\n", GetTickCount() - start );
+
+    start = GetTickCount();
+    for (i = 0; i < 20000; i++) PatBlt( hdc_src16, 0, 0, 1024, 1, PATINVERT );
+    trace( "PatBlt 16bpp: %u ms\n", GetTickCount() - start );
+
+    start = GetTickCount();
+    for (i = 0; i < 20000; i++) BitBlt( hdc_dst, 0, 0, 1024, 1, hdc_src16, 0, 0, SRCCOPY );
+    trace( "BitBlt 555 to 8888: %u ms\n", GetTickCount() - start );
+
+    start = GetTickCount();
+    for (i = 0; i < 20000; i++) pGdiAlphaBlend( hdc_dst, 0, 0, 1024, 1, hdc_src, 0, 0, 1024, 1, blend_src_alpha );
+    trace( "GdiAlphaBlend source alpha: %u ms\n", GetTickCount() - start );
+
+    start = GetTickCount();
+    for (i = 0; i < 20000; i++) pGdiAlphaBlend( hdc_dst, 0, 0, 1024, 1, hdc_src, 0, 0, 1024, 1, blend_const_alpha );
+    trace( "GdiAlphaBlend constant alpha: %u ms\n", GetTickCount() - start );
+}
+
+/* the DIB engine processes full rows at once, make sure that the results don't
+ * depend on the width of the operation */
+static void test_row_primitives(void)
+{
+    static const BYTE alphas[] = { 0, 1, 127, 128, 254, 255 };
+    BLENDFUNCTION blend = { AC_SRC_OVER, 0, 255, AC_SRC_ALPHA };
+    HDC hdc_dst, hdc_ref, hdc_src, hdc_src16;
+    HBITMAP dib_dst, dib_ref, dib_src, dib_src16;
+    DWORD *dst_bits, *ref_bits, *src_bits;
+    WORD *src16_bits;
+    int width, x, i;
+    DWORD a;
+
+    if (!pGdiAlphaBlend)
+    {
+        win_skip( "GdiAlphaBlend() is not implemented\n" );
+        return;
+    }
+
+    hdc_dst = CreateCompatibleDC( NULL );
+    hdc_ref = CreateCompatibleDC( NULL );
+    hdc_src = CreateCompatibleDC( NULL );
+    hdc_src16 = CreateCompatibleDC( NULL );
+    dib_dst = create_row_dib( hdc_dst, 1024, 32, (void **)&dst_bits );
+    dib_ref = create_row_dib( hdc_ref, 1024, 32, (void **)&ref_bits );
+    dib_src = create_row_dib( hdc_src, 1024, 32, (void **)&src_bits );
+    dib_src16 = create_row_dib( hdc_src16, 1024, 16, (void **)&src16_bits );
+    SelectObject( hdc_dst, dib_dst );
+    SelectObject( hdc_ref, dib_ref );
+    SelectObject( hdc_src, dib_src );
+    SelectObject( hdc_src16, dib_src16 );
+
+    for (x = 0; x < 1024; x++)
+    {
+        a = (x * 37) & 0xff;
+        src_bits[x] = a << 24 | ((x * 7) % (a + 1)) << 16 | ((x * 13) % (a + 1)) << 8 | ((x * 29) % (a + 1));
+        src16_bits[x] = x * 0x9e37;
+    }
+
+    for (width = 1; width <= 67; width++)
+    {
+        for (i = 0; i < ARRAY_SIZE(alphas); i++)
+        {
+            for (x = 0; x < width; x++) dst_bits[x] = ref_bits[x] = 0x80402010 + x * 0x01030507;
+            blend.SourceConstantAlpha = alphas[i];
+            pGdiAlphaBlend( hdc_dst, 0, 0, width, 1, hdc_src, 0, 0, width, 1, blend );
+            for (x = 0; x < width; x++)
+                pGdiAlphaBlend( hdc_ref, x, 0, 1, 1, hdc_src, x, 0, 1, 1, blend );
+            ok( !memcmp( dst_bits, ref_bits, width * sizeof(DWORD) ),
+                "width %d alpha %u: blend results differ\n", width, alphas[i] );
+        }
+
+        for (x = 0; x < width; x++) dst_bits[x] = ref_bits[x] = 0x12345678u * x;
+        PatBlt( hdc_dst, 0, 0, width, 1, DSTINVERT );
+        for (x = 0; x < width; x++) PatBlt( hdc_ref, x, 0, 1, 1, DSTINVERT );
+        ok( !memcmp( dst_bits, ref_bits, width * sizeof(DWORD) ), "width %d: fill results differ\n", width );
+
+        BitBlt( hdc_dst, 0, 0, width, 1, hdc_src16, 0, 0, SRCCOPY );
+        for (x = 0; x < width; x++) BitBlt( hdc_ref, x, 0, 1, 1, hdc_src16, x, 0, SRCCOPY );
+        ok( !memcmp( dst_bits, ref_bits, width * sizeof(DWORD) ), "width %d: copy results differ\n", width );
+    }
+
+    if (winetest_interactive) time_row_primitives( hdc_dst, hdc_src, hdc_src16 );
+
+    DeleteDC( hdc_dst );
+    DeleteDC( hdc_ref );
+    DeleteDC( hdc_src );
+    DeleteDC( hdc_src16 );
+    DeleteObject( dib_dst );
+    DeleteObject( dib_ref );
+    DeleteObject( dib_src );
+    DeleteObject( dib_src16 );
+}
+
+static void large_blit( HDC hdc, int width, int height, HDC hdc_src, int src_width, int src_height,
+                        BOOL flip, BOOL blend )
+{
+    static const BLENDFUNCTION func = { AC_SRC_OVER, 0, 200, AC_SRC_ALPHA };
+    int y = flip ? height - 1 : 0;
+
+    if (flip) height = -height;
+    if (blend) pGdiAlphaBlend( hdc, 0, y, width, height, hdc_src, 0, 0, src_width, src_height, func );
+    else StretchBlt( hdc, 0, y, width, height, hdc_src, 0, 0, src_width, src_height, SRCCOPY );
+}
+
+/* large blits may be split in bands processed in parallel, the results must be
+ * the same as when drawing small bands one at a time */
+static void test_large_blits(void)
+{
+    static const struct
+    {
+        int  src_width, src_height;
+        int  mode;
+        BOOL flip;
+        BOOL blend;
+    } tests[] =
+    {
+        {  800,  600, COLORONCOLOR, FALSE, FALSE },
+        { 1600, 1300, COLORONCOLOR, FALSE, FALSE },
+        { 1600, 1300, BLACKONWHITE, FALSE, FALSE },
+        { 1600, 1300, WHITEONBLACK, TRUE,  FALSE },
+        {  900, 1300, COLORONCOLOR, FALSE, FALSE },
+        { 1700,  700, COLORONCOLOR, TRUE,  FALSE },
+        { 1200, 1000, COLORONCOLOR, FALSE, TRUE },
+        {  900, 1100, COLORONCOLOR, FALSE, TRUE },
+    };
+    const int width = 1200, height = 1000;
+    HDC hdc_dst, hdc_ref, hdc_src;
+    HBITMAP dib_dst, dib_ref, dib_src;
+    DWORD *dst_bits, *ref_bits, *src_bits;
+    BITMAPINFO info;
+    HRGN rgn;
+    int i, x, y;
+
+    if (!pGdiAlphaBlend)
+    {
+        win_skip( "GdiAlphaBlend() is not implemented\n" );
+        return;
+    }
+
+    memset( &info, 0, sizeof(info) );
+    info.bmiHeader.biSize = sizeof(info.bmiHeader);
+    info.bmiHeader.biPlanes = 1;
+    info.bmiHeader.biBitCount = 32;
+    info.bmiHeader.biCompression = BI_RGB;
+
+    hdc_dst = CreateCompatibleDC( NULL );
+    hdc_ref = CreateCompatibleDC( NULL );
+    hdc_src = CreateCompatibleDC( NULL );
+    info.bmiHeader.biWidth = width;
+    info.bmiHeader.biHeight = -height;
+    dib_dst = CreateDIBSection( hdc_dst, &info, DIB_RGB_COLORS, (void **)&dst_bits, NULL, 0 );
+    dib_ref = CreateDIBSection( hdc_ref, &info, DIB_RGB_COLORS, (void **)&ref_bits, NULL, 0 );
+    info.bmiHeader.biWidth = 1700;
+    info.bmiHeader.biHeight = -1300;
+    dib_src = CreateDIBSection( hdc_src, &info, DIB_RGB_COLORS, (void **)&src_bits, NULL, 0 );
+    ok( dib_dst && dib_ref && dib_src, "failed to create dibs\n" );
+    SelectObject( hdc_dst, dib_dst );
+    SelectObject( hdc_ref, dib_ref );
+    SelectObject( hdc_src, dib_src );
+
+    for (i = 0; i < 1700 * 1300; i++)
+    {
+        DWORD alpha = (i ^ (i >> 7)) & 0xff;
+        src_bits[i] = alpha << 24 | ((i * 31) % (alpha + 1)) << 16 | ((i * 17) % (alpha + 1)) << 8 |
+                      ((i / 1700) % (alpha + 1));
+    }
+
+    for (i = 0; i < ARRAY_SIZE(tests); i++)
+    {
+        for (x = 0; x < width * height; x++) dst_bits[x] = ref_bits[x] = 0x01020304u * (x % 997);
+        SetStretchBltMode( hdc_dst, tests[i].mode );
+        SetStretchBltMode( hdc_ref, tests[i].mode );
+
+        large_blit( hdc_dst, width, height, hdc_src, tests[i].src_width, tests[i].src_height,
+                    tests[i].flip, tests[i].blend );
+
+        for (y = 0; y < height; y += 16)
+        {
+            rgn = CreateRectRgn( 0, y, width, y + 16 );
+            SelectClipRgn( hdc_ref, rgn );
+            DeleteObject( rgn );
+            large_blit( hdc_ref, width, height, hdc_src, tests[i].src_width, tests[i].src_height,
+                        tests[i].flip, tests[i].blend );
+        }
+        SelectClipRgn( hdc_ref, NULL );
+
+        ok( !memcmp( dst_bits, ref_bits, width * height * sizeof(DWORD) ), "%d: results differ\n", i );
+    }
+
+    DeleteDC( hdc_dst );
+    DeleteDC( hdc_ref );
+    DeleteDC( hdc_src );
+    DeleteObject( dib_dst );
+    DeleteObject( dib_ref );
+    DeleteObject( dib_src );
+}
+
 static void test_32bit_ddb(void)
 {
     char buffer[sizeof(BITMAPINFOHEADER) + sizeof(DWORD)];
@@ -5966,6 +6186,8 @@ START_TEST(bitmap)
     test_StretchDIBits();
     test_GdiAlphaBlend();
     test_GdiGradientFill();
+    test_row_primitives();
+    test_large_blits();
     test_32bit_ddb();
     test_bitmapinfoheadersize();
     test_get16dibits();
@@ -7650,6 +7650,318 @@ done:
     ReleaseDC(0, hdc);
 }
 
+static void draw_text_with_new_font( HDC hdc, const char *face, int height, BYTE quality, const char *text )
+{
+    HFONT hfont, old_hfont;
+    LOGFONTA lf;
+
+    memset( &lf, 0, sizeof(lf) );
+    strcpy( lf.lfFaceName, face );
+    lf.lfHeight = height;
+    lf.lfQuality = quality;
+    hfont = CreateFontIndirectA( &lf );
+    old_hfont = SelectObject( hdc, hfont );
+    TextOutA( hdc, 2, 2, text, strlen(text) );
+    SelectObject( hdc, old_hfont );
+    DeleteObject( hfont );
+}
+
+static const char glyph_cache_text[] = "The quick brown fox jumps over the lazy dog 0123456789";
+static const BYTE glyph_cache_qualities[] = { NONANTIALIASED_QUALITY, ANTIALIASED_QUALITY, CLEARTYPE_QUALITY };
+
+static HDC create_glyph_cache_dc( DWORD **bits )
+{
+    BITMAPINFO info;
+    HBITMAP dib;
+    HDC hdc;
+
+    memset( &info, 0, sizeof(info) );
+    info.bmiHeader.biSize = sizeof(info.bmiHeader);
+    info.bmiHeader.biWidth = 600;
+    info.bmiHeader.biHeight = -40;
+    info.bmiHeader.biPlanes = 1;
+    info.bmiHeader.biBitCount = 32;
+    info.bmiHeader.biCompression = BI_RGB;
+    hdc = CreateCompatibleDC( 0 );
+    dib = CreateDIBSection( hdc, &info, DIB_RGB_COLORS, (void **)bits, NULL, 0 );
+    SelectObject( hdc, dib );
+    return hdc;
+}
+
+static void delete_glyph_cache_dc( HDC hdc )
+{
+    HBITMAP dib = GetCurrentObject( hdc, OBJ_BITMAP );
+
+    DeleteDC( hdc );
+    DeleteObject( dib );
+}
+
+static DWORD get_glyph_cache_text_checksum( HDC hdc, const DWORD *bits, BYTE quality )
+{
+    DWORD i, sum = 0;
+
+    PatBlt( hdc, 0, 0, 600, 40, WHITENESS );
+    draw_text_with_new_font( hdc, "Arial", -16, quality, glyph_cache_text );
+    for (i = 0; i < 600 * 40; i++) sum = sum * 31 + bits[i];
+    return sum;
+}
+
+/* text drawn by another process, which may use glyphs rendered by the parent */
+static void test_glyph_cache_child( char **argv )
+{
+    DWORD *bits, sum;
+    HDC hdc;
+    int i;
+
+    hdc = create_glyph_cache_dc( &bits );
+    for (i = 0; i < ARRAY_SIZE(glyph_cache_qualities); i++)
+    {
+        sum = get_glyph_cache_text_checksum( hdc, bits, glyph_cache_qualities[i] );
+        ok( sum == strtoul( argv[3 + i], NULL, 16 ), "quality %u: text is different\n",
+            glyph_cache_qualities[i] );
+    }
+    delete_glyph_cache_dc( hdc );
+}
+
+/* glyphs are the same when rendered again by a newly created font */
+static void test_glyph_cache(void)
+{
+    static const MAT2 mat = { {0,1}, {0,0}, {0,0}, {0,1} };
+    DWORD *bits, *ref_bits, size, ret, start, sums[ARRAY_SIZE(glyph_cache_qualities)];
+    char path_name[MAX_PATH], **argv;
+    PROCESS_INFORMATION info;
+    STARTUPINFOA startup;
+    GLYPHMETRICS gm, gm2;
+    HFONT hfont, old_hfont;
+    LOGFONTA lf;
+    BYTE *buf, *buf2;
+    DWORD size0 = 0;
+    HDC hdc;
+    int i, j;
+
+    if (!is_truetype_font_installed( "Arial" ))
+    {
+        skip( "Arial is not installed\n" );
+        return;
+    }
+
+    hdc = create_glyph_cache_dc( &bits );
+    ref_bits = HeapAlloc( GetProcessHeap(), 0, 600 * 40 * sizeof(DWORD) );
+
+    for (i = 0; i < ARRAY_SIZE(glyph_cache_qualities); i++)
+    {
+        for (j = 0; j < 5; j++)
+        {
+            PatBlt( hdc, 0, 0, 600, 40, WHITENESS );
+            draw_text_with_new_font( hdc, "Arial", -16, glyph_cache_qualities[i], glyph_cache_text );
+            if (!j) memcpy( ref_bits, bits, 600 * 40 * sizeof(DWORD) );
+            else ok( !memcmp( ref_bits, bits, 600 * 40 * sizeof(DWORD) ),
+                     "quality %u, %d: text is different\n", glyph_cache_qualities[i], j );
+        }
+        sums[i] = get_glyph_cache_text_checksum( hdc, bits, glyph_cache_qualities[i] );
+    }
+
+    winetest_get_mainargs( &argv );
+    sprintf( path_name, "%s font glyph_cache %08x %08x %08x", argv[0], sums[0], sums[1], sums[2] );
+    memset( &startup, 0, sizeof(startup) );
+    startup.cb = sizeof(startup);
+    ok( CreateProcessA( NULL, path_name, NULL, NULL, FALSE, 0, NULL, NULL, &startup, &info ),
+        "CreateProcess failed.\n" );
+    wait_child_process( info.hProcess );
+    CloseHandle( info.hProcess );
+    CloseHandle( info.hThread );
+
+    memset( &lf, 0, sizeof(lf) );
+    strcpy( lf.lfFaceName, "Arial" );
+    lf.lfHeight = -16;
+    for (i = 0; i < 2; i++)
+    {
+        hfont = CreateFontIndirectA( &lf );
+        old_hfont = SelectObject( hdc, hfont );
+
+        /* the glyph isn't cached yet in the first iteration */
+        size = GetGlyphOutlineA( hdc, 'W', GGO_GRAY8_BITMAP, &gm, 0, NULL, &mat );
+        ok( size != GDI_ERROR && size > 1, "%d: GetGlyphOutlineA failed\n", i );
+        if (!i) size0 = size;
+        else ok( size == size0, "%d: got %u, expected %u\n", i, size, size0 );
+        buf = HeapAlloc( GetProcessHeap(), HEAP_ZERO_MEMORY, size );
+        buf2 = HeapAlloc( GetProcessHeap(), HEAP_ZERO_MEMORY, size );
+
+        /* a NULL buffer or a zero size return the size */
+        ret = GetGlyphOutlineA( hdc, 'W', GGO_GRAY8_BITMAP, &gm2, size, NULL, &mat );
+        ok( ret == size, "%d: got %u, expected %u\n", i, ret, size );
+        ok( !memcmp( &gm, &gm2, sizeof(gm) ), "%d: glyph metrics differ\n", i );
+        ret = GetGlyphOutlineA( hdc, 'W', GGO_GRAY8_BITMAP, &gm2, 0, buf, &mat );
+        ok( ret == size, "%d: got %u, expected %u\n", i, ret, size );
+
+        /* a buffer that is too small fails, whether the glyph is cached or not */
+        ret = GetGlyphOutlineA( hdc, i ? 'W' : 'M', GGO_GRAY8_BITMAP, &gm2, 1, buf, &mat );
+        ok( ret == GDI_ERROR, "%d: got %u\n", i, ret );
+        ret = GetGlyphOutlineA( hdc, 'W', GGO_GRAY8_BITMAP, &gm2, size - 1, buf, &mat );
+        ok( ret == GDI_ERROR, "%d: got %u\n", i, ret );
+        ret = GetGlyphOutlineA( hdc, 'W', GGO_GRAY8_BITMAP, &gm2, size, buf, &mat );
+        ok( ret == size, "%d: got %u, expected %u\n", i, ret, size );
+        ok( !memcmp( &gm, &gm2, sizeof(gm) ), "%d: glyph metrics differ\n", i );
+        ret = GetGlyphOutlineA( hdc, 'W', GGO_GRAY8_BITMAP, &gm2, size, buf2, &mat );
+        ok( ret == size, "%d: got %u, expected %u\n", i, ret, size );
+        ok( !memcmp( buf, buf2, size ), "%d: glyph bits differ\n", i );
+        HeapFree( GetProcessHeap(), 0, buf );
+        HeapFree( GetProcessHeap(), 0, buf2 );
+
+        SelectObject( hdc, old_hfont );
+        DeleteObject( hfont );
+    }
+
+    if (winetest_interactive)
+    {
+        for (i = 0; i < ARRAY_SIZE(glyph_cache_qualities); i++)
+        {
+            start = GetTickCount();
+            for (j = 0; j < 1000; j++)
+                draw_text_with_new_font( hdc, "Arial", -16 - j % 4, glyph_cache_qualities[i], glyph_cache_text );
+            trace( "quality %u: 1000 fonts created and drawn in %u ms\n", glyph_cache_qualities[i],
+                   GetTickCount() - start );
+        }
+    }
+
+    HeapFree( GetProcessHeap(), 0, ref_bits );
+    delete_glyph_cache_dc( hdc );
+}
+
+static INT CALLBACK count_font_proc( const LOGFONTA *lf, const TEXTMETRICA *tm, DWORD type, LPARAM lparam )
+{
+    (*(UINT *)lparam)++;
+    return 1;
+}
+
+static UINT get_font_count(void)
+{
+    LOGFONTA lf;
+    UINT count = 0;
+    HDC hdc = GetDC( 0 );
+
+    memset( &lf, 0, sizeof(lf) );
+    lf.lfCharSet = DEFAULT_CHARSET;
+    EnumFontFamiliesExA( hdc, &lf, count_font_proc, (LPARAM)&count, 0 );
+    ReleaseDC( 0, hdc );
+    return count;
+}
+
+/* time the startup of processes loading the font list */
+static void time_process_startup(void)
+{
+    char path_name[MAX_PATH], **argv;
+    PROCESS_INFORMATION info;
+    STARTUPINFOA startup;
+    DWORD start;
+    int i;
+
+    winetest_get_mainargs( &argv );
+    sprintf( path_name, "%s font startup", argv[0] );
+    start = GetTickCount();
+    for (i = 0; i < 10; i++)
+    {
+        memset( &startup, 0, sizeof(startup) );
+        startup.cb = sizeof(startup);
+        ok( CreateProcessA( NULL, path_name, NULL, NULL, FALSE, 0, NULL, NULL, &startup, &info ),
+            "CreateProcess failed.\n" );
+        wait_child_process( info.hProcess );
+        CloseHandle( info.hProcess );
+        CloseHandle( info.hThread );
+    }
+    trace( "%u fonts, 10 processes started in %u ms\n", get_font_count(), GetTickCount() - start );
+}
+
+struct font_list_hash
+{
+    UINT  count;
+    DWORD hash;
+};
+
+static DWORD hash_font_string( DWORD hash, const BYTE *str )
+{
+    while (*str) hash = hash * 31 + *str++;
+    return hash;
+}
+
+static INT CALLBACK hash_font_proc( const LOGFONTA *lf, const TEXTMETRICA *tm, DWORD type, LPARAM lparam )
+{
+    const ENUMLOGFONTEXA *elf = (const ENUMLOGFONTEXA *)lf;
+    struct font_list_hash *list = (struct font_list_hash *)lparam;
+    DWORD hash;
+
+    hash = hash_font_string( 0, (const BYTE *)lf->lfFaceName );
+    hash = hash_font_string( hash, elf->elfFullName );
+    hash = hash_font_string( hash, elf->elfStyle );
+    hash = hash * 31 + lf->lfCharSet;
+    hash = hash * 31 + lf->lfWeight;
+    hash = hash * 31 + lf->lfItalic;
+    hash = hash * 31 + type;
+    /* the enumeration order isn't relevant */
+    list->hash += hash;
+    list->count++;
+    return 1;
+}
+
+static void get_font_list_hash( struct font_list_hash *list )
+{
+    LOGFONTA lf;
+    HDC hdc = GetDC( 0 );
+
+    memset( &lf, 0, sizeof(lf) );
+    lf.lfCharSet = DEFAULT_CHARSET;
+    list->count = list->hash = 0;
+    EnumFontFamiliesExA( hdc, &lf, hash_font_proc, (LPARAM)list, 0 );
+    ReleaseDC( 0, hdc );
+}
+
+static void test_face_cache_child( char **argv )
+{
+    struct font_list_hash list;
+
+    get_font_list_hash( &list );
+    ok( list.count == strtoul( argv[3], NULL, 16 ), "got %u fonts, expected %s\n", list.count, argv[3] );
+    ok( list.hash == strtoul( argv[4], NULL, 16 ), "got hash %08x, expected %s\n", list.hash, argv[4] );
+}
+
+/* processes started after the first one load the font list from the face cache */
+static void test_face_cache(void)
+{
+    char path_name[MAX_PATH], cache_path[MAX_PATH], **argv;
+    WIN32_FILE_ATTRIBUTE_DATA info, info2;
+    struct font_list_hash list;
+    PROCESS_INFORMATION pi;
+    STARTUPINFOA startup;
+    BOOL is_wine = !strcmp( winetest_platform, "wine" ), has_cache;
+    int i;
+
+    get_font_list_hash( &list );
+    ok( list.count > 0, "no fonts enumerated\n" );
+
+    /* the cache is written by the first process, which is this one at the latest */
+    GetWindowsDirectoryA( cache_path, MAX_PATH - 20 );
+    strcat( cache_path, "\\wine_fontcache.dat" );
+    has_cache = GetFileAttributesExA( cache_path, GetFileExInfoStandard, &info );
+    if (is_wine) ok( has_cache, "face cache not found, error %u\n", GetLastError() );
+
+    winetest_get_mainargs( &argv );
+    sprintf( path_name, "%s font face_cache %08x %08x", argv[0], list.count, list.hash );
+    for (i = 0; i < 2; i++)
+    {
+        memset( &startup, 0, sizeof(startup) );
+        startup.cb = sizeof(startup);
+        ok( CreateProcessA( NULL, path_name, NULL, NULL, FALSE, 0, NULL, NULL, &startup, &pi ),
+            "CreateProcess failed.\n" );
+        wait_child_process( pi.hProcess );
+        CloseHandle( pi.hProcess );
+        CloseHandle( pi.hThread );
+    }
+
+    if (is_wine && has_cache && GetFileAttributesExA( cache_path, GetFileExInfoStandard, &info2 ))
+        ok( !CompareFileTime( &info.ftLastWriteTime, &info2.ftLastWriteTime ),
+            "face cache was rebuilt by the child processes\n" );
+}
+
 START_TEST(font)
 {
     static const char *test_names[] =
@@ -7668,10 +7980,16 @@ START_TEST(font)
     {
         if (!strcmp(argv[2], "AddFontMemResource"))
             test_AddFontMemResource();
+        else if (!strcmp(argv[2], "glyph_cache") && argc >= 6)
+            test_glyph_cache_child( argv );
+        else if (!strcmp(argv[2], "face_cache") && argc >= 5)
+            test_face_cache_child( argv );
+        /* nothing to do for "startup", gdi32 is already initialized */
         return;
     }
 
     test_stock_fonts();
+    test_face_cache();
     test_logfont();
     test_bitmap_font();
     test_outline_font();
@@ -7736,6 +8054,8 @@ START_TEST(font)
     test_ttf_names();
     test_lang_names();
     test_char_width();
+    test_glyph_cache();
+    if (winetest_interactive) time_process_startup();
 
     /* These tests should be last test until RemoveFontResource
      * is properly implemented.
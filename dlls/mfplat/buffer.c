@@ -26,11 +26,36 @@
 #include "evr.h"
 
 #include "wine/debug.h"
+#include "wine/list.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(mfplat);
 
 #define ALIGN_SIZE(size, alignment) (((size) + (alignment)) & ~((alignment)))
 
+/* Backing memory of large buffers is kept for reuse when buffers are released. Video pipelines
+   create and release buffers of a few fixed sizes for every frame, and recycling them avoids
+   mapping and faulting in fresh pages each time. Recycled memory is cleared like new memory. */
+#define BUFFER_MEMORY_CACHE_MIN_SIZE (64 * 1024)
+#define BUFFER_MEMORY_CACHE_MAX_SIZE (128 * 1024 * 1024)
+
+struct buffer_memory
+{
+    struct list entry;
+    SIZE_T size;
+};
+
+static CRITICAL_SECTION buffer_memory_cs;
+static CRITICAL_SECTION_DEBUG buffer_memory_cs_debug =
+{
+    0, 0, &buffer_memory_cs,
+    { &buffer_memory_cs_debug.ProcessLocksList, &buffer_memory_cs_debug.ProcessLocksList },
+      0, 0, { (DWORD_PTR)(__FILE__ ": buffer_memory_cs") }
+};
+static CRITICAL_SECTION buffer_memory_cs = { &buffer_memory_cs_debug, -1, 0, 0, 0, 0 };
+
+static struct list buffer_memory_cache = LIST_INIT(buffer_memory_cache);
+static SIZE_T buffer_memory_cache_size;
+
 struct memory_buffer
 {
     IMFMediaBuffer IMFMediaBuffer_iface;
@@ -38,6 +63,7 @@ struct memory_buffer
     IMFGetService IMFGetService_iface;
     LONG refcount;
 
+    struct buffer_memory *memory;
     BYTE *data;
     DWORD max_length;
     DWORD current_length;
@@ -113,6 +139,74 @@ static struct sample *impl_from_IMFTrackedSample(IMFTrackedSample *iface)
     return CONTAINING_RECORD(iface, struct sample, IMFTrackedSample_iface);
 }
 
+static struct buffer_memory *alloc_buffer_memory(SIZE_T size)
+{
+    struct buffer_memory *memory;
+
+    if (size >= BUFFER_MEMORY_CACHE_MIN_SIZE)
+    {
+        EnterCriticalSection(&buffer_memory_cs);
+        LIST_FOR_EACH_ENTRY(memory, &buffer_memory_cache, struct buffer_memory, entry)
+        {
+            if (memory->size == size)
+            {
+                list_remove(&memory->entry);
+                buffer_memory_cache_size -= size;
+                LeaveCriticalSection(&buffer_memory_cs);
+                memset(memory + 1, 0, size);
+                return memory;
+            }
+        }
+        LeaveCriticalSection(&buffer_memory_cs);
+    }
+
+    if (!(memory = heap_alloc_zero(sizeof(*memory) + size)))
+        return NULL;
+    memory->size = size;
+
+    return memory;
+}
+
+static void release_buffer_memory(struct buffer_memory *memory)
+{
+    struct buffer_memory *oldest;
+
+    if (!memory)
+        return;
+
+    if (memory->size < BUFFER_MEMORY_CACHE_MIN_SIZE || memory->size > BUFFER_MEMORY_CACHE_MAX_SIZE)
+    {
+        heap_free(memory);
+        return;
+    }
+
+    EnterCriticalSection(&buffer_memory_cs);
+    while (buffer_memory_cache_size + memory->size > BUFFER_MEMORY_CACHE_MAX_SIZE)
+    {
+        oldest = LIST_ENTRY(list_tail(&buffer_memory_cache), struct buffer_memory, entry);
+        list_remove(&oldest->entry);
+        buffer_memory_cache_size -= oldest->size;
+        heap_free(oldest);
+    }
+    list_add_head(&buffer_memory_cache, &memory->entry);
+    buffer_memory_cache_size += memory->size;
+    LeaveCriticalSection(&buffer_memory_cs);
+}
+
+void clear_buffer_memory_cache(void)
+{
+    struct buffer_memory *memory, *next;
+
+    EnterCriticalSection(&buffer_memory_cs);
+    LIST_FOR_EACH_ENTRY_SAFE(memory, next, &buffer_memory_cache, struct buffer_memory, entry)
+    {
+        list_remove(&memory->entry);
+        heap_free(memory);
+    }
+    buffer_memory_cache_size = 0;
+    LeaveCriticalSection(&buffer_memory_cs);
+}
+
 static HRESULT WINAPI memory_buffer_QueryInterface(IMFMediaBuffer *iface, REFIID riid, void **out)
 {
     struct memory_buffer *buffer = impl_from_IMFMediaBuffer(iface);
@@ -155,7 +249,7 @@ static ULONG WINAPI memory_buffer_Release(IMFMediaBuffer *iface)
             IDirect3DSurface9_Release(buffer->d3d9_surface.surface);
         DeleteCriticalSection(&buffer->cs);
         heap_free(buffer->_2d.linear_buffer);
-        heap_free(buffer->data);
+        release_buffer_memory(buffer->memory);
         heap_free(buffer);
     }
 
@@ -819,9 +913,11 @@ static const IMFGetServiceVtbl d3d9_surface_buffer_gs_vtbl =
 static HRESULT memory_buffer_init(struct memory_buffer *buffer, DWORD max_length, DWORD alignment,
         const IMFMediaBufferVtbl *vtbl)
 {
-    buffer->data = heap_alloc_zero(ALIGN_SIZE(max_length, alignment));
-    if (!buffer->data)
+    /* Keep data at least as aligned as regular heap allocations. */
+    alignment |= MF_16_BYTE_ALIGNMENT;
+    if (!(buffer->memory = alloc_buffer_memory(ALIGN_SIZE(max_length, alignment) + alignment)))
         return E_OUTOFMEMORY;
+    buffer->data = (BYTE *)ALIGN_SIZE((ULONG_PTR)(buffer->memory + 1), (ULONG_PTR)alignment);
 
     buffer->IMFMediaBuffer_iface.lpVtbl = vtbl;
     buffer->refcount = 1;
@@ -1486,6 +1486,7 @@ HRESULT WINAPI MFShutdown(void)
     TRACE("\n");
 
     RtwqShutdown();
+    clear_buffer_memory_cache();
 
     return S_OK;
 }
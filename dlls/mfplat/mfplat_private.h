@@ -115,6 +115,7 @@ static inline BOOL mf_array_reserve(void **elements, size_t *capacity, size_t co
     return TRUE;
 }
 
+extern void clear_buffer_memory_cache(void) DECLSPEC_HIDDEN;
 extern unsigned int mf_format_get_stride(const GUID *subtype, unsigned int width, BOOL *is_yuv) DECLSPEC_HIDDEN;
 
 static inline const char *debugstr_propvar(const PROPVARIANT *v)
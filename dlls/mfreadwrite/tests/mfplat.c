@@ -28,6 +28,7 @@
 
 #include "initguid.h"
 #include "ole2.h"
+#include "wincodec.h"
 
 DEFINE_GUID(GUID_NULL, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
 
@@ -1042,6 +1043,257 @@ static void test_source_reader_from_media_source(void)
     fail_request_sample = FALSE;
 }
 
+/* The RIFF headers of an AVI file with a single video stream, up to the start
+ * of the movi list. */
+struct avi_header
+{
+    DWORD riff, riff_size, avi;
+    DWORD hdrl_list, hdrl_size, hdrl;
+    DWORD avih, avih_size;
+    DWORD usec_per_frame, max_bytes_per_sec, padding_granularity, flags, total_frames, initial_frames;
+    DWORD streams, suggested_buffer_size, width, height, reserved[4];
+    DWORD strl_list, strl_size, strl;
+    DWORD strh, strh_size;
+    DWORD type, handler, stream_flags;
+    WORD priority, language;
+    DWORD initial, scale, rate, start, length, stream_buffer_size, quality, sample_size;
+    SHORT frame[4];
+    DWORD strf, strf_size;
+    BITMAPINFOHEADER bitmap;
+    DWORD movi_list, movi_size, movi;
+};
+
+static IMFByteStream *create_mjpeg_avi_stream(unsigned int width, unsigned int height, unsigned int frame_count)
+{
+    static const DWORD pad;
+    DWORD jpeg_size, chunk_size, offset, written, i, j;
+    IWICBitmapFrameEncode *frame;
+    IWICImagingFactory *factory;
+    IWICBitmapEncoder *encoder;
+    IMFByteStream *bytestream;
+    IStream *jpeg, *stream;
+    LARGE_INTEGER move;
+    ULARGE_INTEGER pos;
+    HGLOBAL hglobal;
+    BYTE *pixels;
+    WICPixelFormatGUID pixel_format = GUID_WICPixelFormat24bppBGR;
+    struct avi_header header;
+    HRESULT hr;
+    struct
+    {
+        DWORD id, flags, offset, size;
+    } index;
+    DWORD chunk[2];
+
+    /* Encode a single frame, and repeat it for every frame of the stream. */
+    hr = CoCreateInstance(&CLSID_WICImagingFactory, NULL, CLSCTX_INPROC_SERVER,
+            &IID_IWICImagingFactory, (void **)&factory);
+    if (FAILED(hr))
+        return NULL;
+
+    hr = CreateStreamOnHGlobal(NULL, TRUE, &jpeg);
+    ok(hr == S_OK, "Failed to create memory stream, hr %#x.\n", hr);
+    hr = IWICImagingFactory_CreateEncoder(factory, &GUID_ContainerFormatJpeg, NULL, &encoder);
+    IWICImagingFactory_Release(factory);
+    if (FAILED(hr))
+    {
+        IStream_Release(jpeg);
+        return NULL;
+    }
+    hr = IWICBitmapEncoder_Initialize(encoder, jpeg, WICBitmapEncoderNoCache);
+    ok(hr == S_OK, "Failed to initialize encoder, hr %#x.\n", hr);
+    hr = IWICBitmapEncoder_CreateNewFrame(encoder, &frame, NULL);
+    ok(hr == S_OK, "Failed to create frame, hr %#x.\n", hr);
+    hr = IWICBitmapFrameEncode_Initialize(frame, NULL);
+    ok(hr == S_OK, "Failed to initialize frame, hr %#x.\n", hr);
+    hr = IWICBitmapFrameEncode_SetSize(frame, width, height);
+    ok(hr == S_OK, "Failed to set frame size, hr %#x.\n", hr);
+    hr = IWICBitmapFrameEncode_SetPixelFormat(frame, &pixel_format);
+    ok(hr == S_OK, "Failed to set pixel format, hr %#x.\n", hr);
+
+    pixels = heap_alloc(width * height * 3);
+    for (i = 0; i < height; ++i)
+    {
+        for (j = 0; j < width * 3; ++j)
+            pixels[i * width * 3 + j] = (i + j) & 0xff;
+    }
+    hr = IWICBitmapFrameEncode_WritePixels(frame, height, width * 3, width * height * 3, pixels);
+    ok(hr == S_OK, "Failed to write pixels, hr %#x.\n", hr);
+    heap_free(pixels);
+
+    hr = IWICBitmapFrameEncode_Commit(frame);
+    ok(hr == S_OK, "Failed to commit frame, hr %#x.\n", hr);
+    IWICBitmapFrameEncode_Release(frame);
+    hr = IWICBitmapEncoder_Commit(encoder);
+    ok(hr == S_OK, "Failed to commit encoder, hr %#x.\n", hr);
+    IWICBitmapEncoder_Release(encoder);
+
+    move.QuadPart = 0;
+    IStream_Seek(jpeg, move, STREAM_SEEK_CUR, &pos);
+    jpeg_size = pos.u.LowPart;
+    chunk_size = (jpeg_size + 1) & ~1;
+    GetHGlobalFromStream(jpeg, &hglobal);
+
+    memset(&header, 0, sizeof(header));
+    header.riff = MAKEFOURCC('R','I','F','F');
+    header.riff_size = sizeof(header) - 8 + frame_count * (8 + chunk_size) + 8 + frame_count * sizeof(index);
+    header.avi = MAKEFOURCC('A','V','I',' ');
+    header.hdrl_list = MAKEFOURCC('L','I','S','T');
+    header.hdrl_size = offsetof(struct avi_header, movi_list) - offsetof(struct avi_header, hdrl);
+    header.hdrl = MAKEFOURCC('h','d','r','l');
+    header.avih = MAKEFOURCC('a','v','i','h');
+    header.avih_size = offsetof(struct avi_header, strl_list) - offsetof(struct avi_header, usec_per_frame);
+    header.usec_per_frame = 1000000 / 30;
+    header.flags = 0x10; /* AVIF_HASINDEX */
+    header.total_frames = frame_count;
+    header.streams = 1;
+    header.suggested_buffer_size = chunk_size;
+    header.width = width;
+    header.height = height;
+    header.strl_list = MAKEFOURCC('L','I','S','T');
+    header.strl_size = offsetof(struct avi_header, movi_list) - offsetof(struct avi_header, strl);
+    header.strl = MAKEFOURCC('s','t','r','l');
+    header.strh = MAKEFOURCC('s','t','r','h');
+    header.strh_size = offsetof(struct avi_header, strf) - offsetof(struct avi_header, type);
+    header.type = MAKEFOURCC('v','i','d','s');
+    header.handler = MAKEFOURCC('M','J','P','G');
+    header.scale = 1;
+    header.rate = 30;
+    header.length = frame_count;
+    header.stream_buffer_size = chunk_size;
+    header.quality = ~0u;
+    header.frame[2] = width;
+    header.frame[3] = height;
+    header.strf = MAKEFOURCC('s','t','r','f');
+    header.strf_size = sizeof(header.bitmap);
+    header.bitmap.biSize = sizeof(header.bitmap);
+    header.bitmap.biWidth = width;
+    header.bitmap.biHeight = height;
+    header.bitmap.biPlanes = 1;
+    header.bitmap.biBitCount = 24;
+    header.bitmap.biCompression = MAKEFOURCC('M','J','P','G');
+    header.bitmap.biSizeImage = width * height * 3;
+    header.movi_list = MAKEFOURCC('L','I','S','T');
+    header.movi_size = 4 + frame_count * (8 + chunk_size);
+    header.movi = MAKEFOURCC('m','o','v','i');
+
+    hr = CreateStreamOnHGlobal(NULL, TRUE, &stream);
+    ok(hr == S_OK, "Failed to create memory stream, hr %#x.\n", hr);
+    IStream_Write(stream, &header, sizeof(header), &written);
+
+    chunk[0] = MAKEFOURCC('0','0','d','c');
+    chunk[1] = jpeg_size;
+    pixels = GlobalLock(hglobal);
+    for (i = 0; i < frame_count; ++i)
+    {
+        IStream_Write(stream, chunk, sizeof(chunk), &written);
+        IStream_Write(stream, pixels, jpeg_size, &written);
+        IStream_Write(stream, &pad, chunk_size - jpeg_size, &written);
+    }
+    GlobalUnlock(hglobal);
+    IStream_Release(jpeg);
+
+    chunk[0] = MAKEFOURCC('i','d','x','1');
+    chunk[1] = frame_count * sizeof(index);
+    IStream_Write(stream, chunk, sizeof(chunk), &written);
+    index.id = MAKEFOURCC('0','0','d','c');
+    index.flags = 0x10; /* AVIIF_KEYFRAME */
+    index.size = jpeg_size;
+    for (i = 0, offset = 4; i < frame_count; ++i, offset += 8 + chunk_size)
+    {
+        index.offset = offset;
+        IStream_Write(stream, &index, sizeof(index), &written);
+    }
+
+    hr = pMFCreateMFByteStreamOnStream(stream, &bytestream);
+    ok(hr == S_OK, "Failed to create bytestream, hr %#x.\n", hr);
+    IStream_Release(stream);
+
+    return bytestream;
+}
+
+static void test_source_reader_video_throughput(void)
+{
+    /* Hold on to decoded samples the way a renderer queues frames for
+     * presentation. Frames are large enough to use recycled buffer memory. */
+    static const unsigned int width = 640, height = 480, frame_count = 300;
+    DWORD stream_flags, start, length, total_length = 0, count = 0, max_length;
+    IMFSample *samples[32] = {NULL};
+    IMFMediaBuffer *buffer;
+    IMFSourceReader *reader;
+    IMFByteStream *stream;
+    LONGLONG timestamp;
+    IMFSample *sample;
+    unsigned int i;
+    BYTE *data;
+    HRESULT hr;
+
+    if (!pMFCreateMFByteStreamOnStream)
+    {
+        win_skip("MFCreateMFByteStreamOnStream() not found\n");
+        return;
+    }
+
+    CoInitialize(NULL);
+
+    if (!(stream = create_mjpeg_avi_stream(width, height, frame_count)))
+    {
+        skip("Failed to encode a JPEG frame.\n");
+        CoUninitialize();
+        return;
+    }
+
+    hr = MFCreateSourceReaderFromByteStream(stream, NULL, &reader);
+    IMFByteStream_Release(stream);
+    if (FAILED(hr))
+    {
+        skip("MFCreateSourceReaderFromByteStream() failed, is G-Streamer missing?\n");
+        CoUninitialize();
+        return;
+    }
+
+    start = GetTickCount();
+    for (;;)
+    {
+        hr = IMFSourceReader_ReadSample(reader, MF_SOURCE_READER_FIRST_VIDEO_STREAM, 0, NULL, &stream_flags,
+                &timestamp, &sample);
+        ok(hr == S_OK, "Failed to get a sample, hr %#x.\n", hr);
+        if (hr != S_OK || !sample)
+            break;
+
+        hr = IMFSample_ConvertToContiguousBuffer(sample, &buffer);
+        ok(hr == S_OK, "Failed to get sample buffer, hr %#x.\n", hr);
+        hr = IMFMediaBuffer_Lock(buffer, &data, &max_length, &length);
+        ok(hr == S_OK, "Failed to lock buffer, hr %#x.\n", hr);
+        ok(length >= width * height, "Got unexpected length %u.\n", length);
+        IMFMediaBuffer_Unlock(buffer);
+        IMFMediaBuffer_Release(buffer);
+
+        i = count % ARRAY_SIZE(samples);
+        if (samples[i])
+            IMFSample_Release(samples[i]);
+        samples[i] = sample;
+
+        total_length += length;
+        ++count;
+
+        if (stream_flags & MF_SOURCE_READERF_ENDOFSTREAM)
+            break;
+    }
+
+    trace("Decoded %u frames of %ux%u, %u bytes in %u ms.\n", count, width, height,
+            total_length, GetTickCount() - start);
+
+    for (i = 0; i < ARRAY_SIZE(samples); ++i)
+    {
+        if (samples[i])
+            IMFSample_Release(samples[i]);
+    }
+    IMFSourceReader_Release(reader);
+
+    CoUninitialize();
+}
+
 START_TEST(mfplat)
 {
     HRESULT hr;
@@ -1055,6 +1307,9 @@ START_TEST(mfplat)
     test_source_reader();
     test_source_reader_from_media_source();
 
+    if (winetest_interactive)
+        test_source_reader_video_throughput();
+
     hr = MFShutdown();
     ok(hr == S_OK, "Failed to shut down, hr %#x.\n", hr);
 }
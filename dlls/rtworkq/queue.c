@@ -122,6 +122,8 @@ enum system_queue_index
 
 struct work_item
 {
+    /* Links the item into the cache of free items, or into a pool queue while it's waiting to be run. */
+    SLIST_ENTRY slist_entry;
     IUnknown IUnknown_iface;
     LONG refcount;
     struct list entry;
@@ -139,6 +141,12 @@ struct work_item
     } u;
 };
 
+/* Released work items are kept on a lock-free list and reused, to avoid a heap round trip for
+   every submitted item. */
+#define MAX_CACHED_WORK_ITEMS 256
+static SLIST_HEADER work_item_cache;
+static LONG work_item_cache_size;
+
 static struct work_item *work_item_impl_from_IUnknown(IUnknown *iface)
 {
     return CONTAINING_RECORD(iface, struct work_item, IUnknown_iface);
@@ -177,6 +185,15 @@ struct queue
     CRITICAL_SECTION cs;
     struct list pending_items;
     DWORD id;
+    /* Data used for pool queues only. Items are pushed to per-priority lists without locking,
+       and picked in batches by a single work object, submitted at most max_workers times. */
+    SLIST_HEADER incoming[ARRAY_SIZE(priorities)];
+    SLIST_ENTRY *ready[ARRAY_SIZE(priorities)];
+    SRWLOCK ready_lock;
+    TP_WORK *work;
+    LONG pending;
+    LONG workers;
+    LONG max_workers;
     /* Data used for serial queues only. */
     PTP_SIMPLE_CALLBACK finalization_callback;
     DWORD target_queue;
@@ -308,6 +325,8 @@ static void CALLBACK standard_queue_cleanup_callback(void *object_data, void *gr
 {
 }
 
+static void CALLBACK pool_queue_worker(TP_CALLBACK_INSTANCE *instance, void *context, TP_WORK *work);
+
 static HRESULT pool_queue_init(const struct queue_desc *desc, struct queue *queue)
 {
     TP_CALLBACK_ENVIRON_V3 env;
@@ -326,23 +345,80 @@ static HRESULT pool_queue_init(const struct queue_desc *desc, struct queue *queu
     {
         queue->envs[i] = env;
         queue->envs[i].CallbackPriority = priorities[i];
+        InitializeSListHead(&queue->incoming[i]);
+        queue->ready[i] = NULL;
     }
     list_init(&queue->pending_items);
     InitializeCriticalSection(&queue->cs);
+    InitializeSRWLock(&queue->ready_lock);
 
     max_thread = (desc->queue_type == RTWQ_STANDARD_WORKQUEUE || desc->queue_type == RTWQ_WINDOW_WORKQUEUE) ? 1 : 4;
 
     SetThreadpoolThreadMinimum(queue->pool, 1);
     SetThreadpoolThreadMaximum(queue->pool, max_thread);
 
+    queue->max_workers = max_thread;
+    queue->work = CreateThreadpoolWork(pool_queue_worker, queue,
+            (TP_CALLBACK_ENVIRON *)&queue->envs[TP_CALLBACK_PRIORITY_NORMAL]);
+
     if (desc->queue_type == RTWQ_WINDOW_WORKQUEUE)
         FIXME("RTWQ_WINDOW_WORKQUEUE is not supported.\n");
 
     return S_OK;
 }
 
+/* Returns next item to run, higher priorities first. Producers only push to 'incoming' lists,
+   those are flushed and reversed here, so items of the same priority run in submission order. */
+static struct work_item *pool_queue_get_next(struct queue *queue)
+{
+    SLIST_ENTRY *entry, *next, *prev;
+    unsigned int i;
+
+    AcquireSRWLockExclusive(&queue->ready_lock);
+
+    for (i = 0; i < ARRAY_SIZE(priorities); ++i)
+    {
+        if (!queue->ready[i] && (entry = InterlockedFlushSList(&queue->incoming[i])))
+        {
+            for (prev = NULL; entry; entry = next)
+            {
+                next = entry->Next;
+                entry->Next = prev;
+                prev = entry;
+            }
+            queue->ready[i] = prev;
+        }
+
+        if ((entry = queue->ready[i]))
+        {
+            queue->ready[i] = entry->Next;
+            ReleaseSRWLockExclusive(&queue->ready_lock);
+            return CONTAINING_RECORD(entry, struct work_item, slist_entry);
+        }
+    }
+
+    ReleaseSRWLockExclusive(&queue->ready_lock);
+
+    return NULL;
+}
+
+static BOOL pool_queue_claim_worker(struct queue *queue)
+{
+    LONG workers;
+
+    while ((workers = queue->workers) < queue->max_workers)
+    {
+        if (InterlockedCompareExchange(&queue->workers, workers + 1, workers) == workers)
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
 static BOOL pool_queue_shutdown(struct queue *queue)
 {
+    struct work_item *item;
+
     if (!queue->pool)
         return FALSE;
 
@@ -350,12 +426,20 @@ static BOOL pool_queue_shutdown(struct queue *queue)
     CloseThreadpool(queue->pool);
     queue->pool = NULL;
 
+    /* Release items that were never picked up, including the reference held for finalization. */
+    while ((item = pool_queue_get_next(queue)))
+    {
+        if (item->finalization_callback)
+            IUnknown_Release(&item->IUnknown_iface);
+        IUnknown_Release(&item->IUnknown_iface);
+    }
+
     return TRUE;
 }
 
-static void CALLBACK standard_queue_worker(TP_CALLBACK_INSTANCE *instance, void *context, TP_WORK *work)
+static void invoke_work_item(TP_CALLBACK_INSTANCE *instance, struct work_item *item)
 {
-    struct work_item *item = context;
+    PTP_SIMPLE_CALLBACK finalization_callback = item->finalization_callback;
     RTWQASYNCRESULT *result = (RTWQASYNCRESULT *)item->result;
 
     TRACE("result object %p.\n", result);
@@ -367,13 +451,33 @@ static void CALLBACK standard_queue_worker(TP_CALLBACK_INSTANCE *instance, void
     IRtwqAsyncCallback_Invoke(result->pCallback, item->reply_result ? item->reply_result : item->result);
 
     IUnknown_Release(&item->IUnknown_iface);
+
+    if (finalization_callback)
+        finalization_callback(instance, item);
+}
+
+static void CALLBACK pool_queue_worker(TP_CALLBACK_INSTANCE *instance, void *context, TP_WORK *work)
+{
+    struct queue *queue = context;
+    struct work_item *item;
+
+    do
+    {
+        while ((item = pool_queue_get_next(queue)))
+        {
+            InterlockedDecrement(&queue->pending);
+            invoke_work_item(instance, item);
+        }
+
+        InterlockedDecrement(&queue->workers);
+
+        /* Submitter might have seen this worker as still running, pick up whatever was added meanwhile. */
+    } while (queue->pending && pool_queue_claim_worker(queue));
 }
 
 static void pool_queue_submit(struct queue *queue, struct work_item *item)
 {
     TP_CALLBACK_PRIORITY callback_priority;
-    TP_CALLBACK_ENVIRON_V3 env;
-    TP_WORK *work_object;
 
     if (item->priority == 0)
         callback_priority = TP_CALLBACK_PRIORITY_NORMAL;
@@ -382,14 +486,15 @@ static void pool_queue_submit(struct queue *queue, struct work_item *item)
     else
         callback_priority = TP_CALLBACK_PRIORITY_HIGH;
 
-    env = queue->envs[callback_priority];
-    env.FinalizationCallback = item->finalization_callback;
-    /* Worker pool callback will release one reference. Grab one more to keep object alive when
+    /* Worker will release one reference. Grab one more to keep object alive when
        we need finalization callback. */
     if (item->finalization_callback)
         IUnknown_AddRef(&item->IUnknown_iface);
-    work_object = CreateThreadpoolWork(standard_queue_worker, item, (TP_CALLBACK_ENVIRON *)&env);
-    SubmitThreadpoolWork(work_object);
+
+    InterlockedPushEntrySList(&queue->incoming[callback_priority], &item->slist_entry);
+    InterlockedIncrement(&queue->pending);
+    if (pool_queue_claim_worker(queue))
+        SubmitThreadpoolWork(queue->work);
 
     TRACE("dispatched %p.\n", item->result);
 }
@@ -553,7 +658,13 @@ static ULONG WINAPI work_item_Release(IUnknown *iface)
         if (item->reply_result)
             IRtwqAsyncResult_Release(item->reply_result);
         IRtwqAsyncResult_Release(item->result);
-        heap_free(item);
+        if (InterlockedIncrement(&work_item_cache_size) <= MAX_CACHED_WORK_ITEMS)
+            InterlockedPushEntrySList(&work_item_cache, &item->slist_entry);
+        else
+        {
+            InterlockedDecrement(&work_item_cache_size);
+            heap_free(item);
+        }
     }
 
     return refcount;
@@ -571,8 +682,16 @@ static struct work_item * alloc_work_item(struct queue *queue, LONG priority, IR
     RTWQASYNCRESULT *async_result = (RTWQASYNCRESULT *)result;
     DWORD flags = 0, queue_id = 0;
     struct work_item *item;
+    SLIST_ENTRY *entry;
 
-    item = heap_alloc_zero(sizeof(*item));
+    if ((entry = InterlockedPopEntrySList(&work_item_cache)))
+    {
+        InterlockedDecrement(&work_item_cache_size);
+        item = CONTAINING_RECORD(entry, struct work_item, slist_entry);
+        memset(item, 0, sizeof(*item));
+    }
+    else if (!(item = heap_alloc_zero(sizeof(*item))))
+        return NULL;
 
     item->IUnknown_iface.lpVtbl = &work_item_vtbl;
     item->result = result;
@@ -1157,6 +1276,7 @@ HRESULT WINAPI RtwqStartup(void)
 
 static void shutdown_system_queues(void)
 {
+    SLIST_ENTRY *entry;
     unsigned int i;
     HRESULT hr;
 
@@ -1167,6 +1287,12 @@ static void shutdown_system_queues(void)
         shutdown_queue(&system_queues[i]);
     }
 
+    while ((entry = InterlockedPopEntrySList(&work_item_cache)))
+    {
+        InterlockedDecrement(&work_item_cache_size);
+        heap_free(CONTAINING_RECORD(entry, struct work_item, slist_entry));
+    }
+
     if (FAILED(hr = CoDecrementMTAUsage(mta_cookie)))
         WARN("Failed to uninitialize MTA, hr %#x.\n", hr);
 
@@ -16,11 +16,14 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
  */
 
+#define COBJMACROS
+
 #include <stdarg.h>
 #include <string.h>
 
 #include "windef.h"
 #include "winbase.h"
+#include "initguid.h"
 #include "rtworkq.h"
 
 #include "wine/test.h"
@@ -101,7 +104,120 @@ static void test_platform_init(void)
     ok(hr == S_OK, "Failed to shut down, hr %#x.\n", hr);
 }
 
+struct test_callback
+{
+    IRtwqAsyncCallback IRtwqAsyncCallback_iface;
+    LONG remaining;
+    HANDLE event;
+};
+
+static struct test_callback *impl_from_IRtwqAsyncCallback(IRtwqAsyncCallback *iface)
+{
+    return CONTAINING_RECORD(iface, struct test_callback, IRtwqAsyncCallback_iface);
+}
+
+static HRESULT WINAPI test_callback_QueryInterface(IRtwqAsyncCallback *iface, REFIID riid, void **obj)
+{
+    if (IsEqualIID(riid, &IID_IRtwqAsyncCallback) ||
+            IsEqualIID(riid, &IID_IUnknown))
+    {
+        *obj = iface;
+        IRtwqAsyncCallback_AddRef(iface);
+        return S_OK;
+    }
+
+    *obj = NULL;
+    return E_NOINTERFACE;
+}
+
+static ULONG WINAPI test_callback_AddRef(IRtwqAsyncCallback *iface)
+{
+    return 2;
+}
+
+static ULONG WINAPI test_callback_Release(IRtwqAsyncCallback *iface)
+{
+    return 1;
+}
+
+static HRESULT WINAPI test_callback_GetParameters(IRtwqAsyncCallback *iface, DWORD *flags, DWORD *queue)
+{
+    return E_NOTIMPL;
+}
+
+static HRESULT WINAPI test_callback_Invoke(IRtwqAsyncCallback *iface, IRtwqAsyncResult *result)
+{
+    struct test_callback *callback = impl_from_IRtwqAsyncCallback(iface);
+
+    if (!InterlockedDecrement(&callback->remaining))
+        SetEvent(callback->event);
+
+    return S_OK;
+}
+
+static const IRtwqAsyncCallbackVtbl test_callback_vtbl =
+{
+    test_callback_QueryInterface,
+    test_callback_AddRef,
+    test_callback_Release,
+    test_callback_GetParameters,
+    test_callback_Invoke,
+};
+
+static void test_work_item_throughput(void)
+{
+    static const struct
+    {
+        DWORD queue;
+        const char *name;
+    }
+    queues[] =
+    {
+        {1 /* RTWQ_CALLBACK_QUEUE_STANDARD */, "standard"},
+        {5 /* RTWQ_CALLBACK_QUEUE_MULTITHREADED */, "multithreaded"},
+    };
+    static const unsigned int count = 100000;
+    struct test_callback callback;
+    IRtwqAsyncResult *result;
+    unsigned int i, j;
+    DWORD start, ret;
+    HRESULT hr;
+
+    hr = RtwqStartup();
+    ok(hr == S_OK, "Failed to start up, hr %#x.\n", hr);
+
+    callback.IRtwqAsyncCallback_iface.lpVtbl = &test_callback_vtbl;
+    callback.event = CreateEventA(NULL, FALSE, FALSE, NULL);
+
+    for (i = 0; i < ARRAY_SIZE(queues); ++i)
+    {
+        callback.remaining = count;
+
+        start = GetTickCount();
+        for (j = 0; j < count; ++j)
+        {
+            hr = RtwqCreateAsyncResult(NULL, &callback.IRtwqAsyncCallback_iface, NULL, &result);
+            ok(hr == S_OK, "Failed to create result, hr %#x.\n", hr);
+            hr = RtwqPutWorkItem(queues[i].queue, (j % 3) - 1, result);
+            ok(hr == S_OK, "Failed to submit item, hr %#x.\n", hr);
+            IRtwqAsyncResult_Release(result);
+        }
+
+        ret = WaitForSingleObject(callback.event, 30000);
+        ok(!ret, "Unexpected wait result %#x.\n", ret);
+        trace("%s queue: %u items in %u ms.\n", queues[i].name, count, GetTickCount() - start);
+    }
+
+    CloseHandle(callback.event);
+
+    hr = RtwqShutdown();
+    ok(hr == S_OK, "Failed to shut down, hr %#x.\n", hr);
+}
+
 START_TEST(rtworkq)
 {
     test_platform_init();
+
+    if (winetest_interactive)
+        test_work_item_throughput();
 }
@@ -11749,6 +11749,47 @@ static void test_arrange_iconic_windows(void)
     ok(ret, "failed to restore minimized metrics, error %u\n", GetLastError());
 }
 
+static void check_other_process_window(HWND hwnd, DWORD style)
+{
+    DWORD pid, tid;
+    LONG ret;
+
+    ok(IsWindow(hwnd), "IsWindow failed.\n");
+    tid = GetWindowThreadProcessId(hwnd, &pid);
+    ok(tid && tid != GetCurrentThreadId(), "Unexpected tid %#x.\n", tid);
+    ok(pid && pid != GetCurrentProcessId(), "Unexpected pid %#x.\n", pid);
+    ret = GetWindowLongA(hwnd, GWL_STYLE);
+    ok((ret & (WS_VISIBLE | WS_MINIMIZE | WS_MAXIMIZE)) == style, "Unexpected style %#x.\n", ret);
+    ret = GetWindowLongA(hwnd, GWL_EXSTYLE);
+    ok(!(ret & WS_EX_TOPMOST), "Unexpected exstyle %#x.\n", ret);
+}
+
+static void time_other_process_window(HWND hwnd)
+{
+    static const unsigned int count = 100000;
+    LARGE_INTEGER freq, start, end;
+    unsigned int i;
+
+    QueryPerformanceFrequency(&freq);
+
+    QueryPerformanceCounter(&start);
+    for (i = 0; i < count; i++) IsWindow(hwnd);
+    QueryPerformanceCounter(&end);
+    trace("IsWindow: %.3f us per call\n", (end.QuadPart - start.QuadPart) * 1e6 / freq.QuadPart / count);
+
+    QueryPerformanceCounter(&start);
+    for (i = 0; i < count; i++) GetWindowThreadProcessId(hwnd, NULL);
+    QueryPerformanceCounter(&end);
+    trace("GetWindowThreadProcessId: %.3f us per call\n",
+          (end.QuadPart - start.QuadPart) * 1e6 / freq.QuadPart / count);
+
+    QueryPerformanceCounter(&start);
+    for (i = 0; i < count; i++) GetWindowLongW(hwnd, GWL_STYLE);
+    QueryPerformanceCounter(&end);
+    trace("GetWindowLong(GWL_STYLE): %.3f us per call\n",
+          (end.QuadPart - start.QuadPart) * 1e6 / freq.QuadPart / count);
+}
+
 static void other_process_proc(HWND hwnd)
 {
     HANDLE window_ready_event, test_done_event;
@@ -11767,6 +11808,8 @@ static void other_process_proc(HWND hwnd)
     ok(ret, "Unexpected ret %#x.\n", ret);
     ok(wp.showCmd == SW_SHOWNORMAL, "Unexpected showCmd %#x.\n", wp.showCmd);
     ok(!wp.flags, "Unexpected flags %#x.\n", wp.flags);
+    check_other_process_window(hwnd, WS_VISIBLE);
+    if (winetest_interactive) time_other_process_window(hwnd);
     SetEvent(test_done_event);
 
     /* SW_SHOWMAXIMIZED */
@@ -11776,6 +11819,7 @@ static void other_process_proc(HWND hwnd)
     ok(ret, "Unexpected ret %#x.\n", ret);
     ok(wp.showCmd == SW_SHOWMAXIMIZED, "Unexpected showCmd %#x.\n", wp.showCmd);
     todo_wine ok(wp.flags == WPF_RESTORETOMAXIMIZED, "Unexpected flags %#x.\n", wp.flags);
+    check_other_process_window(hwnd, WS_VISIBLE | WS_MAXIMIZE);
     SetEvent(test_done_event);
 
     /* SW_SHOWMINIMIZED */
@@ -11785,6 +11829,7 @@ static void other_process_proc(HWND hwnd)
     ok(ret, "Unexpected ret %#x.\n", ret);
     ok(wp.showCmd == SW_SHOWMINIMIZED, "Unexpected showCmd %#x.\n", wp.showCmd);
     todo_wine ok(wp.flags == WPF_RESTORETOMAXIMIZED, "Unexpected flags %#x.\n", wp.flags);
+    check_other_process_window(hwnd, WS_VISIBLE | WS_MINIMIZE);
     SetEvent(test_done_event);
 
     /* SW_RESTORE */
@@ -23,6 +23,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "ntstatus.h"
+#define WIN32_NO_STATUS
 #include "windef.h"
 #include "winbase.h"
 #include "winnls.h"
@@ -100,6 +102,74 @@ static inline void set_win_data( void *ptr, LONG_PTR val, UINT size )
 
 
 static void *user_handles[NB_USER_HANDLES];
+static const volatile shared_user_entry_t *shared_user_entries;
+
+/***********************************************************************
+ *           get_shared_user_entries
+ *
+ * Map the server user handle table, or return NULL if it's not available.
+ */
+static const volatile shared_user_entry_t *get_shared_user_entries(void)
+{
+    static BOOL unavailable;
+    OBJECT_ATTRIBUTES attr;
+    UNICODE_STRING name;
+    SIZE_T size = 0;
+    HANDLE section;
+    void *ptr = NULL;
+
+    if (shared_user_entries || unavailable) return shared_user_entries;
+
+    RtlInitUnicodeString( &name, L"\\KernelObjects\\__wine_user_handles" );
+    InitializeObjectAttributes( &attr, &name, 0, NULL, NULL );
+    if (!NtOpenSection( &section, SECTION_MAP_READ, &attr ))
+    {
+        NtMapViewOfSection( section, GetCurrentProcess(), &ptr, 0, 0, NULL, &size, ViewUnmap, 0, PAGE_READONLY );
+        NtClose( section );
+    }
+    if (!ptr)
+    {
+        WARN( "shared user handle table not available\n" );
+        unavailable = TRUE;
+        return NULL;
+    }
+    if (InterlockedCompareExchangePointer( (void **)&shared_user_entries, ptr, NULL ))
+        NtUnmapViewOfSection( GetCurrentProcess(), ptr );  /* someone beat us here */
+    return shared_user_entries;
+}
+
+
+/***********************************************************************
+ *           get_shared_window_info
+ *
+ * Retrieve the information about a window from the shared handle table without
+ * a server round trip. Returns STATUS_NOT_SUPPORTED if the table is not available.
+ */
+static NTSTATUS get_shared_window_info( HWND hwnd, shared_user_entry_t *info )
+{
+    const volatile shared_user_entry_t *entries = get_shared_user_entries(), *entry;
+    WORD index = USER_HANDLE_TO_INDEX( hwnd ), generation = HIWORD( hwnd );
+    unsigned int seq;
+
+    if (!entries) return STATUS_NOT_SUPPORTED;
+    if (index >= NB_USER_HANDLES) return STATUS_INVALID_HANDLE;
+
+    entry = &entries[index];
+    do
+    {
+        /* the server makes the sequence number odd while it's updating the entry; the
+         * barriers keep the data reads between the two sequence number reads */
+        while ((seq = __atomic_load_n( &entry->seq, __ATOMIC_ACQUIRE )) & 1) NtYieldExecution();
+        *info = *entry;
+        __atomic_thread_fence( __ATOMIC_ACQUIRE );
+    }
+    while (__atomic_load_n( &entry->seq, __ATOMIC_RELAXED ) != seq);
+
+    if (info->type != USER_WINDOW) return STATUS_INVALID_HANDLE;
+    if (generation && generation != 0xffff && generation != info->generation) return STATUS_INVALID_HANDLE;
+    return STATUS_SUCCESS;
+}
+
 
 /***********************************************************************
  *           alloc_user_handle
@@ -730,6 +800,16 @@ HWND WIN_GetFullHandle( HWND hwnd )
     }
     else  /* may belong to another process */
     {
+        shared_user_entry_t info;
+
+        switch (get_shared_window_info( hwnd, &info ))
+        {
+        case STATUS_SUCCESS:
+            return wine_server_ptr_handle( LOWORD(hwnd) | (info.generation << 16) );
+        case STATUS_INVALID_HANDLE:
+            SetLastError( ERROR_INVALID_WINDOW_HANDLE );
+            return hwnd;
+        }
         SERVER_START_REQ( get_window_info )
         {
             req->handle = wine_server_user_handle( hwnd );
@@ -2347,11 +2427,32 @@ static LONG_PTR WIN_GetWindowLong( HWND hwnd, INT offset, UINT size, BOOL unicod
 
     if (wndPtr == WND_OTHER_PROCESS)
     {
+        shared_user_entry_t info;
+
         if (offset == GWLP_WNDPROC)
         {
             SetLastError( ERROR_ACCESS_DENIED );
             return 0;
         }
+        if (offset < 0)
+        {
+            switch (get_shared_window_info( hwnd, &info ))
+            {
+            case STATUS_SUCCESS:
+                switch (offset)
+                {
+                case GWL_STYLE:      return info.style;
+                case GWL_EXSTYLE:    return info.ex_style;
+                case GWLP_ID:        return info.id;
+                case GWLP_HINSTANCE: return (ULONG_PTR)wine_server_get_ptr( info.instance );
+                case GWLP_USERDATA:  return info.user_data;
+                }
+                break;
+            case STATUS_INVALID_HANDLE:
+                SetLastError( ERROR_INVALID_WINDOW_HANDLE );
+                return 0;
+            }
+        }
         SERVER_START_REQ( set_window_info )
         {
             req->handle = wine_server_user_handle( hwnd );
@@ -2996,6 +3097,7 @@ INT WINAPI GetWindowTextLengthW( HWND hwnd )
  */
 BOOL WINAPI IsWindow( HWND hwnd )
 {
+    shared_user_entry_t info;
     WND *ptr;
     BOOL ret;
 
@@ -3009,6 +3111,15 @@ BOOL WINAPI IsWindow( HWND hwnd )
     }
 
     /* check other processes */
+    switch (get_shared_window_info( hwnd, &info ))
+    {
+    case STATUS_SUCCESS:
+        return TRUE;
+    case STATUS_INVALID_HANDLE:
+        SetLastError( ERROR_INVALID_WINDOW_HANDLE );
+        return FALSE;
+    }
+
     SERVER_START_REQ( get_window_info )
     {
         req->handle = wine_server_user_handle( hwnd );
@@ -3024,6 +3135,7 @@ BOOL WINAPI IsWindow( HWND hwnd )
  */
 DWORD WINAPI GetWindowThreadProcessId( HWND hwnd, LPDWORD process )
 {
+    shared_user_entry_t info;
     WND *ptr;
     DWORD tid = 0;
 
@@ -3043,6 +3155,16 @@ DWORD WINAPI GetWindowThreadProcessId( HWND hwnd, LPDWORD process )
     }
 
     /* check other processes */
+    switch (get_shared_window_info( hwnd, &info ))
+    {
+    case STATUS_SUCCESS:
+        if (process) *process = info.pid;
+        return info.tid;
+    case STATUS_INVALID_HANDLE:
+        SetLastError( ERROR_INVALID_WINDOW_HANDLE );
+        return 0;
+    }
+
     SERVER_START_REQ( get_window_info )
     {
         req->handle = wine_server_user_handle( hwnd );
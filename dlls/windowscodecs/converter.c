@@ -133,6 +133,242 @@ static void to_sRGB(BYTE *bgr)
 }
 #endif
 
+/* Conversion of a single float to an sRGB byte, as done by the gray paths. */
+static BYTE float_to_sRGB_byte_slow(float f)
+{
+    return (BYTE)floorf(to_sRGB_component(f) * 255.0f + 0.51f);
+}
+
+static INIT_ONCE converter_init_once = INIT_ONCE_STATIC_INIT;
+
+/* srgb_threshold[i] is the smallest value in [0, 1] that converts to an sRGB
+ * byte of at least i. The conversion is monotonic in that range, so looking
+ * up a value in this table gives the same result as float_to_sRGB_byte_slow()
+ * without calling powf(). */
+static float srgb_threshold[256];
+
+/* ceil(2^24 / alpha), x * 255 * unpremultiply_factor[alpha] >> 24 is exactly
+ * x * 255 / alpha for all byte values. */
+static UINT unpremultiply_factor[256];
+
+static void premultiply_row_c(BYTE *row, UINT width);
+static void (*premultiply_row)(BYTE *row, UINT width) = premultiply_row_c;
+
+static BYTE float_to_sRGB_byte(float f)
+{
+    UINT i = 0, step;
+
+    if (!(f >= 0.0f && f <= 1.0f))
+        return float_to_sRGB_byte_slow(f);
+
+    for (step = 128; step; step >>= 1)
+        if (f >= srgb_threshold[i + step]) i += step;
+
+    return i;
+}
+
+static inline DWORD read_pixel32(const BYTE *p)
+{
+    DWORD v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline void write_pixel32(BYTE *p, DWORD v)
+{
+    memcpy(p, &v, sizeof(v));
+}
+
+/* 32bpp pixels are processed as little endian DWORDs, 0xaarrggbb for BGRA. */
+static void set_alpha_row(BYTE *row, UINT width)
+{
+    UINT x;
+
+    for (x = 0; x < width; x++)
+        write_pixel32(row + 4 * x, read_pixel32(row + 4 * x) | 0xff000000);
+}
+
+static void swap_rb_row(BYTE *row, UINT width)
+{
+    UINT x;
+
+    for (x = 0; x < width; x++)
+    {
+        DWORD v = read_pixel32(row + 4 * x);
+        write_pixel32(row + 4 * x, (v & 0xff00ff00) | ((v >> 16) & 0xff) | ((v & 0xff) << 16));
+    }
+}
+
+static void swap_rb(BYTE *bits, UINT width, UINT height, UINT stride)
+{
+    UINT y;
+
+    for (y = 0; y < height; y++)
+        swap_rb_row(bits + stride * y, width);
+}
+
+/* 24bpp to 32bpp with opaque alpha, 4 pixels from 3 DWORDs at a time. */
+static void expand_bgr_row(const BYTE *src, BYTE *dst, UINT width)
+{
+    UINT x;
+
+    for (x = 0; x + 4 <= width; x += 4)
+    {
+        DWORD s0 = read_pixel32(src), s1 = read_pixel32(src + 4), s2 = read_pixel32(src + 8);
+
+        write_pixel32(dst, s0 | 0xff000000);
+        write_pixel32(dst + 4, (s0 >> 24) | (s1 << 8) | 0xff000000);
+        write_pixel32(dst + 8, (s1 >> 16) | (s2 << 16) | 0xff000000);
+        write_pixel32(dst + 12, (s2 >> 8) | 0xff000000);
+        src += 12;
+        dst += 16;
+    }
+    for (; x < width; x++)
+    {
+        dst[0] = src[0];
+        dst[1] = src[1];
+        dst[2] = src[2];
+        dst[3] = 0xff;
+        src += 3;
+        dst += 4;
+    }
+}
+
+/* 32bpp to 24bpp, dropping alpha, 4 pixels to 3 DWORDs at a time. */
+static void pack_bgr_row(const BYTE *src, BYTE *dst, UINT width)
+{
+    UINT x;
+
+    for (x = 0; x + 4 <= width; x += 4)
+    {
+        DWORD s0 = read_pixel32(src), s1 = read_pixel32(src + 4);
+        DWORD s2 = read_pixel32(src + 8), s3 = read_pixel32(src + 12);
+
+        write_pixel32(dst, (s0 & 0xffffff) | (s1 << 24));
+        write_pixel32(dst + 4, ((s1 >> 8) & 0xffff) | (s2 << 16));
+        write_pixel32(dst + 8, ((s2 >> 16) & 0xff) | (s3 << 8));
+        src += 16;
+        dst += 12;
+    }
+    for (; x < width; x++)
+    {
+        dst[0] = src[0];
+        dst[1] = src[1];
+        dst[2] = src[2];
+        src += 4;
+        dst += 3;
+    }
+}
+
+static void premultiply_row_c(BYTE *row, UINT width)
+{
+    UINT x;
+
+    for (x = 0; x < width; x++, row += 4)
+    {
+        BYTE alpha = row[3];
+        if (alpha != 255)
+        {
+            row[0] = row[0] * alpha / 255;
+            row[1] = row[1] * alpha / 255;
+            row[2] = row[2] * alpha / 255;
+        }
+    }
+}
+
+#if (defined(__i386__) || defined(__x86_64__)) \
+      && (defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+
+#define HAVE_PREMULTIPLY_SSE2
+
+typedef unsigned short premultiply_v8hu __attribute__((vector_size(16)));
+typedef unsigned int premultiply_v4su __attribute__((vector_size(16)));
+
+/* 4 pixels at a time. Even and odd bytes are multiplied by alpha in 16 bit
+ * lanes, and divided by 255 with (t + 1 + (t >> 8)) >> 8, which is exact for
+ * t <= 255 * 255. */
+static __attribute__((target("sse2"))) void premultiply_row_sse2(BYTE *row, UINT width)
+{
+    static const premultiply_v4su alpha_mask = {0xff000000, 0xff000000, 0xff000000, 0xff000000};
+    static const premultiply_v8hu low_mask = {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff};
+    static const premultiply_v8hu one = {1, 1, 1, 1, 1, 1, 1, 1};
+    premultiply_v8hu even, odd, alpha;
+    premultiply_v4su v, a;
+    UINT x;
+
+    for (x = 0; x + 4 <= width; x += 4, row += 16)
+    {
+        memcpy(&v, row, sizeof(v));
+        a = v >> 24;
+        alpha = (premultiply_v8hu)(a | (a << 16));
+
+        even = ((premultiply_v8hu)v & low_mask) * alpha;
+        odd = ((premultiply_v8hu)v >> 8) * alpha;
+        even = (even + one + (even >> 8)) >> 8;
+        odd = (odd + one + (odd >> 8)) >> 8;
+
+        v = ((premultiply_v4su)(even | (odd << 8)) & ~alpha_mask) | (v & alpha_mask);
+        memcpy(row, &v, sizeof(v));
+    }
+    premultiply_row_c(row, width - x);
+}
+
+#endif
+
+static void unpremultiply_row(BYTE *row, UINT width)
+{
+    UINT x;
+
+    for (x = 0; x < width; x++, row += 4)
+    {
+        BYTE alpha = row[3];
+        if (alpha != 0 && alpha != 255)
+        {
+            UINT factor = unpremultiply_factor[alpha];
+
+            row[0] = (UINT64)(row[0] * 255) * factor >> 24;
+            row[1] = (UINT64)(row[1] * 255) * factor >> 24;
+            row[2] = (UINT64)(row[2] * 255) * factor >> 24;
+        }
+    }
+}
+
+static BOOL WINAPI init_converter_tables(INIT_ONCE *once, void *param, void **context)
+{
+    DWORD lo, hi, mid, one;
+    float f = 1.0f;
+    UINT i;
+
+    /* Bisect on the float bit patterns, which are ordered like the values for
+     * positive floats. */
+    memcpy(&one, &f, sizeof(one));
+    for (i = 1; i < 256; i++)
+    {
+        lo = 0;
+        hi = one;
+        while (lo < hi)
+        {
+            mid = lo + (hi - lo) / 2;
+            memcpy(&f, &mid, sizeof(f));
+            if (float_to_sRGB_byte_slow(f) >= i)
+                hi = mid;
+            else
+                lo = mid + 1;
+        }
+        memcpy(&srgb_threshold[i], &lo, sizeof(lo));
+    }
+
+    for (i = 1; i < 256; i++)
+        unpremultiply_factor[i] = ((1u << 24) + i - 1) / i;
+
+#ifdef HAVE_PREMULTIPLY_SSE2
+    if (IsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE))
+        premultiply_row = premultiply_row_sse2;
+#endif
+
+    return TRUE;
+}
+
 static inline FormatConverter *impl_from_IWICFormatConverter(IWICFormatConverter *iface)
 {
     return CONTAINING_RECORD(iface, FormatConverter, IWICFormatConverter_iface);
@@ -620,13 +856,11 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
         if (prc)
         {
             HRESULT res;
-            INT x, y;
+            INT y;
             BYTE *srcdata;
             UINT srcstride, srcdatasize;
             const BYTE *srcrow;
-            const BYTE *srcpixel;
             BYTE *dstrow;
-            BYTE *dstpixel;
 
             srcstride = 3 * prc->Width;
             srcdatasize = srcstride * prc->Height;
@@ -641,14 +875,7 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
                 srcrow = srcdata;
                 dstrow = pbBuffer;
                 for (y=0; y<prc->Height; y++) {
-                    srcpixel=srcrow;
-                    dstpixel=dstrow;
-                    for (x=0; x<prc->Width; x++) {
-                        *dstpixel++=*srcpixel++; /* blue */
-                        *dstpixel++=*srcpixel++; /* green */
-                        *dstpixel++=*srcpixel++; /* red */
-                        *dstpixel++=255; /* alpha */
-                    }
+                    expand_bgr_row(srcrow, dstrow, prc->Width);
                     srcrow += srcstride;
                     dstrow += cbStride;
                 }
@@ -663,14 +890,11 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
         if (prc)
         {
             HRESULT res;
-            INT x, y;
+            INT y;
             BYTE *srcdata;
             UINT srcstride, srcdatasize;
             const BYTE *srcrow;
-            const BYTE *srcpixel;
             BYTE *dstrow;
-            BYTE *dstpixel;
-            BYTE tmppixel[3];
 
             srcstride = 3 * prc->Width;
             srcdatasize = srcstride * prc->Height;
@@ -685,18 +909,8 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
                 srcrow = srcdata;
                 dstrow = pbBuffer;
                 for (y=0; y<prc->Height; y++) {
-                    srcpixel=srcrow;
-                    dstpixel=dstrow;
-                    for (x=0; x<prc->Width; x++) {
-                        tmppixel[0]=*srcpixel++; /* red */
-                        tmppixel[1]=*srcpixel++; /* green */
-                        tmppixel[2]=*srcpixel++; /* blue */
-
-                        *dstpixel++=tmppixel[2]; /* blue */
-                        *dstpixel++=tmppixel[1]; /* green */
-                        *dstpixel++=tmppixel[0]; /* red */
-                        *dstpixel++=255; /* alpha */
-                    }
+                    expand_bgr_row(srcrow, dstrow, prc->Width);
+                    swap_rb_row(dstrow, prc->Width);
                     srcrow += srcstride;
                     dstrow += cbStride;
                 }
@@ -711,15 +925,14 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
         if (prc)
         {
             HRESULT res;
-            INT x, y;
+            INT y;
 
             res = IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
             if (FAILED(res)) return res;
 
             /* set all alpha values to 255 */
             for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
-                    pbBuffer[cbStride*y+4*x+3] = 0xff;
+                set_alpha_row(pbBuffer + cbStride * y, prc->Width);
         }
         return S_OK;
     case format_32bppRGBA:
@@ -728,7 +941,7 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
             HRESULT res;
             res = IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
             if (FAILED(res)) return res;
-            reverse_bgr8(4, pbBuffer, prc->Width, prc->Height, cbStride);
+            swap_rb(pbBuffer, prc->Width, prc->Height, cbStride);
         }
         return S_OK;
     case format_32bppBGRA:
@@ -739,22 +952,13 @@ static HRESULT copypixels_to_32bppBGRA(struct FormatConverter *This, const WICRe
         if (prc)
         {
             HRESULT res;
-            INT x, y;
+            INT y;
 
             res = IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
             if (FAILED(res)) return res;
 
             for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
-                {
-                    BYTE alpha = pbBuffer[cbStride*y+4*x+3];
-                    if (alpha != 0 && alpha != 255)
-                    {
-                        pbBuffer[cbStride*y+4*x] = pbBuffer[cbStride*y+4*x] * 255 / alpha;
-                        pbBuffer[cbStride*y+4*x+1] = pbBuffer[cbStride*y+4*x+1] * 255 / alpha;
-                        pbBuffer[cbStride*y+4*x+2] = pbBuffer[cbStride*y+4*x+2] * 255 / alpha;
-                    }
-                }
+                unpremultiply_row(pbBuffer + cbStride * y, prc->Width);
         }
         return S_OK;
     case format_48bppRGB:
@@ -883,15 +1087,14 @@ static HRESULT copypixels_to_32bppRGBA(struct FormatConverter *This, const WICRe
     case format_32bppRGB:
         if (prc)
         {
-            INT x, y;
+            INT y;
 
             hr = IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
             if (FAILED(hr)) return hr;
 
             /* set all alpha values to 255 */
             for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
-                    pbBuffer[cbStride*y+4*x+3] = 0xff;
+                set_alpha_row(pbBuffer + cbStride * y, prc->Width);
         }
         return S_OK;
 
@@ -903,29 +1106,20 @@ static HRESULT copypixels_to_32bppRGBA(struct FormatConverter *This, const WICRe
     case format_32bppPRGBA:
         if (prc)
         {
-            INT x, y;
+            INT y;
 
             hr = IWICBitmapSource_CopyPixels(This->source, prc, cbStride, cbBufferSize, pbBuffer);
             if (FAILED(hr)) return hr;
 
             for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
-                {
-                    BYTE alpha = pbBuffer[cbStride*y+4*x+3];
-                    if (alpha != 0 && alpha != 255)
-                    {
-                        pbBuffer[cbStride*y+4*x] = pbBuffer[cbStride*y+4*x] * 255 / alpha;
-                        pbBuffer[cbStride*y+4*x+1] = pbBuffer[cbStride*y+4*x+1] * 255 / alpha;
-                        pbBuffer[cbStride*y+4*x+2] = pbBuffer[cbStride*y+4*x+2] * 255 / alpha;
-                    }
-                }
+                unpremultiply_row(pbBuffer + cbStride * y, prc->Width);
         }
         return S_OK;
 
     default:
         hr = copypixels_to_32bppBGRA(This, prc, cbStride, cbBufferSize, pbBuffer, source_format);
         if (SUCCEEDED(hr) && prc)
-              reverse_bgr8(4, pbBuffer, prc->Width, prc->Height, cbStride);
+              swap_rb(pbBuffer, prc->Width, prc->Height, cbStride);
         return hr;
     }
 }
@@ -977,19 +1171,10 @@ static HRESULT copypixels_to_32bppPBGRA(struct FormatConverter *This, const WICR
         hr = copypixels_to_32bppBGRA(This, prc, cbStride, cbBufferSize, pbBuffer, source_format);
         if (SUCCEEDED(hr) && prc)
         {
-            INT x, y;
+            INT y;
 
             for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
-                {
-                    BYTE alpha = pbBuffer[cbStride*y+4*x+3];
-                    if (alpha != 255)
-                    {
-                        pbBuffer[cbStride*y+4*x] = pbBuffer[cbStride*y+4*x] * alpha / 255;
-                        pbBuffer[cbStride*y+4*x+1] = pbBuffer[cbStride*y+4*x+1] * alpha / 255;
-                        pbBuffer[cbStride*y+4*x+2] = pbBuffer[cbStride*y+4*x+2] * alpha / 255;
-                    }
-                }
+                premultiply_row(pbBuffer + cbStride * y, prc->Width);
         }
         return hr;
     }
@@ -1010,19 +1195,10 @@ static HRESULT copypixels_to_32bppPRGBA(struct FormatConverter *This, const WICR
         hr = copypixels_to_32bppRGBA(This, prc, cbStride, cbBufferSize, pbBuffer, source_format);
         if (SUCCEEDED(hr) && prc)
         {
-            INT x, y;
+            INT y;
 
             for (y=0; y<prc->Height; y++)
-                for (x=0; x<prc->Width; x++)
-                {
-                    BYTE alpha = pbBuffer[cbStride*y+4*x+3];
-                    if (alpha != 255)
-                    {
-                        pbBuffer[cbStride*y+4*x] = pbBuffer[cbStride*y+4*x] * alpha / 255;
-                        pbBuffer[cbStride*y+4*x+1] = pbBuffer[cbStride*y+4*x+1] * alpha / 255;
-                        pbBuffer[cbStride*y+4*x+2] = pbBuffer[cbStride*y+4*x+2] * alpha / 255;
-                    }
-                }
+                premultiply_row(pbBuffer + cbStride * y, prc->Width);
         }
         return hr;
     }
@@ -1052,13 +1228,11 @@ static HRESULT copypixels_to_24bppBGR(struct FormatConverter *This, const WICRec
         if (prc)
         {
             HRESULT res;
-            INT x, y;
+            INT y;
             BYTE *srcdata;
             UINT srcstride, srcdatasize;
-            const BYTE *srcrow;
-            const BYTE *srcpixel;
+            BYTE *srcrow;
             BYTE *dstrow;
-            BYTE *dstpixel;
 
             srcstride = 4 * prc->Width;
             srcdatasize = srcstride * prc->Height;
@@ -1072,38 +1246,13 @@ static HRESULT copypixels_to_24bppBGR(struct FormatConverter *This, const WICRec
             {
                 srcrow = srcdata;
                 dstrow = pbBuffer;
-
-                if (source_format == format_32bppRGBA)
-                {
-                    for (y = 0; y < prc->Height; y++)
-                    {
-                        srcpixel = srcrow;
-                        dstpixel = dstrow;
-                        for (x = 0; x < prc->Width; x++) {
-                            *dstpixel++ = srcpixel[2]; /* blue */
-                            *dstpixel++ = srcpixel[1]; /* green */
-                            *dstpixel++ = srcpixel[0]; /* red */
-                            srcpixel += 4;
-                        }
-                        srcrow += srcstride;
-                        dstrow += cbStride;
-                    }
-                }
-                else
+                for (y = 0; y < prc->Height; y++)
                 {
-                    for (y = 0; y < prc->Height; y++)
-                    {
-                        srcpixel = srcrow;
-                        dstpixel = dstrow;
-                        for (x = 0; x < prc->Width; x++) {
-                            *dstpixel++ = *srcpixel++; /* blue */
-                            *dstpixel++ = *srcpixel++; /* green */
-                            *dstpixel++ = *srcpixel++; /* red */
-                            srcpixel++; /* alpha */
-                        }
-                        srcrow += srcstride;
-                        dstrow += cbStride;
-                    }
+                    if (source_format == format_32bppRGBA)
+                        swap_rb_row(srcrow, prc->Width);
+                    pack_bgr_row(srcrow, dstrow, prc->Width);
+                    srcrow += srcstride;
+                    dstrow += cbStride;
                 }
             }
 
@@ -1139,7 +1288,7 @@ static HRESULT copypixels_to_24bppBGR(struct FormatConverter *This, const WICRec
 
                     for (x = 0; x < prc->Width; x++)
                     {
-                        BYTE gray = (BYTE)floorf(to_sRGB_component(gray_float[x]) * 255.0f + 0.51f);
+                        BYTE gray = float_to_sRGB_byte(gray_float[x]);
                         *bgr++ = gray;
                         *bgr++ = gray;
                         *bgr++ = gray;
@@ -1226,14 +1375,11 @@ static HRESULT copypixels_to_24bppRGB(struct FormatConverter *This, const WICRec
         if (prc)
         {
             HRESULT res;
-            INT x, y;
+            INT y;
             BYTE *srcdata;
             UINT srcstride, srcdatasize;
-            const BYTE *srcrow;
-            const BYTE *srcpixel;
+            BYTE *srcrow;
             BYTE *dstrow;
-            BYTE *dstpixel;
-            BYTE tmppixel[3];
 
             srcstride = 4 * prc->Width;
             srcdatasize = srcstride * prc->Height;
@@ -1248,18 +1394,8 @@ static HRESULT copypixels_to_24bppRGB(struct FormatConverter *This, const WICRec
                 srcrow = srcdata;
                 dstrow = pbBuffer;
                 for (y=0; y<prc->Height; y++) {
-                    srcpixel=srcrow;
-                    dstpixel=dstrow;
-                    for (x=0; x<prc->Width; x++) {
-                        tmppixel[0]=*srcpixel++; /* blue */
-                        tmppixel[1]=*srcpixel++; /* green */
-                        tmppixel[2]=*srcpixel++; /* red */
-                        srcpixel++; /* alpha */
-
-                        *dstpixel++=tmppixel[2]; /* red */
-                        *dstpixel++=tmppixel[1]; /* green */
-                        *dstpixel++=tmppixel[0]; /* blue */
-                    }
+                    swap_rb_row(srcrow, prc->Width);
+                    pack_bgr_row(srcrow, dstrow, prc->Width);
                     srcrow += srcstride;
                     dstrow += cbStride;
                 }
@@ -1358,7 +1494,7 @@ static HRESULT copypixels_to_8bppGray(struct FormatConverter *This, const WICRec
                     BYTE *dstpixel = dst;
 
                     for (x=0; x < prc->Width; x++)
-                        *dstpixel++ = (BYTE)floorf(to_sRGB_component(*srcpixel++) * 255.0f + 0.51f);
+                        *dstpixel++ = float_to_sRGB_byte(*srcpixel++);
 
                     src += srcstride;
                     dst += cbStride;
@@ -1394,8 +1530,7 @@ static HRESULT copypixels_to_8bppGray(struct FormatConverter *This, const WICRec
             {
                 float gray = (bgr[2] * 0.2126f + bgr[1] * 0.7152f + bgr[0] * 0.0722f) / 255.0f;
 
-                gray = to_sRGB_component(gray) * 255.0f;
-                dst[x] = (BYTE)floorf(gray + 0.51f);
+                dst[x] = float_to_sRGB_byte(gray);
                 bgr += 3;
             }
             src += srcstride;
@@ -1407,36 +1542,98 @@ static HRESULT copypixels_to_8bppGray(struct FormatConverter *This, const WICRec
     return hr;
 }
 
-static UINT rgb_to_palette_index(BYTE bgr[3], WICColor *colors, UINT count)
+/* Nearest palette color lookup. The entries are sorted by green, so the search
+ * can start at the pixel's green value and stop in each direction once the
+ * green distance alone exceeds the best match. Ties go to the lowest palette
+ * index, like a linear search would. Results are cached by color, which helps
+ * with the long runs of identical colors typical of images that are converted
+ * to a palette. */
+#define PALETTE_CACHE_SIZE 4096
+
+struct palette_map
 {
-    UINT best_diff, best_index, i;
+    UINT count;
+    struct
+    {
+        BYTE r, g, b, index;
+    } entries[256];
+    DWORD cache_key[PALETTE_CACHE_SIZE];
+    BYTE cache_index[PALETTE_CACHE_SIZE];
+};
 
-    best_diff = ~0;
-    best_index = 0;
+static void init_palette_map(struct palette_map *map, const WICColor *colors, UINT count)
+{
+    UINT i, j;
 
+    map->count = count;
     for (i = 0; i < count; i++)
     {
-        BYTE pal_r, pal_g, pal_b;
-        UINT diff_r, diff_g, diff_b, diff;
+        BYTE r = colors[i] >> 16, g = colors[i] >> 8, b = colors[i];
+
+        for (j = i; j > 0 && map->entries[j - 1].g > g; j--)
+            map->entries[j] = map->entries[j - 1];
+        map->entries[j].r = r;
+        map->entries[j].g = g;
+        map->entries[j].b = b;
+        map->entries[j].index = i;
+    }
 
-        pal_r = colors[i] >> 16;
-        pal_g = colors[i] >> 8;
-        pal_b = colors[i];
+    /* Valid keys never have the top byte set. */
+    memset(map->cache_key, 0xff, sizeof(map->cache_key));
+}
 
-        diff_r = bgr[2] - pal_r;
-        diff_g = bgr[1] - pal_g;
-        diff_b = bgr[0] - pal_b;
+static inline void palette_map_test(const struct palette_map *map, UINT i, const BYTE bgr[3],
+        UINT *best_diff, UINT *best_index)
+{
+    int diff_r = bgr[2] - map->entries[i].r;
+    int diff_g = bgr[1] - map->entries[i].g;
+    int diff_b = bgr[0] - map->entries[i].b;
+    UINT diff = diff_r * diff_r + diff_g * diff_g + diff_b * diff_b;
 
-        diff = diff_r * diff_r + diff_g * diff_g + diff_b * diff_b;
-        if (diff == 0) return i;
+    if (diff < *best_diff || (diff == *best_diff && map->entries[i].index < *best_index))
+    {
+        *best_diff = diff;
+        *best_index = map->entries[i].index;
+    }
+}
 
-        if (diff < best_diff)
-        {
-            best_diff = diff;
-            best_index = i;
-        }
+static UINT rgb_to_palette_index(struct palette_map *map, const BYTE bgr[3])
+{
+    DWORD key = bgr[0] | (bgr[1] << 8) | (bgr[2] << 16);
+    UINT slot = (key * 0x9e3779b1) >> 20;
+    UINT best_diff = ~0u, best_index = 0;
+    UINT lo, hi, i;
+    int diff_g;
+
+    if (map->cache_key[slot] == key)
+        return map->cache_index[slot];
+
+    lo = 0;
+    hi = map->count;
+    while (lo < hi)
+    {
+        i = (lo + hi) / 2;
+        if (map->entries[i].g < bgr[1])
+            lo = i + 1;
+        else
+            hi = i;
     }
 
+    for (i = lo; i < map->count; i++)
+    {
+        diff_g = map->entries[i].g - bgr[1];
+        if ((UINT)(diff_g * diff_g) > best_diff) break;
+        palette_map_test(map, i, bgr, &best_diff, &best_index);
+    }
+    for (i = lo; i > 0; i--)
+    {
+        diff_g = bgr[1] - map->entries[i - 1].g;
+        if ((UINT)(diff_g * diff_g) > best_diff) break;
+        palette_map_test(map, i - 1, bgr, &best_diff, &best_index);
+    }
+
+    map->cache_key[slot] = key;
+    map->cache_index[slot] = best_index;
     return best_index;
 }
 
@@ -1446,6 +1643,7 @@ static HRESULT copypixels_to_8bppIndexed(struct FormatConverter *This, const WIC
     HRESULT hr;
     BYTE *srcdata;
     WICColor colors[256];
+    struct palette_map *map;
     UINT srcstride, srcdatasize, count;
 
     if (source_format == format_8bppIndexed)
@@ -1467,8 +1665,15 @@ static HRESULT copypixels_to_8bppIndexed(struct FormatConverter *This, const WIC
     srcstride = 3 * prc->Width;
     srcdatasize = srcstride * prc->Height;
 
+    if (!(map = heap_alloc(sizeof(*map)))) return E_OUTOFMEMORY;
+    init_palette_map(map, colors, count);
+
     srcdata = HeapAlloc(GetProcessHeap(), 0, srcdatasize);
-    if (!srcdata) return E_OUTOFMEMORY;
+    if (!srcdata)
+    {
+        heap_free(map);
+        return E_OUTOFMEMORY;
+    }
 
     hr = copypixels_to_24bppBGR(This, prc, srcstride, srcdatasize, srcdata, source_format);
     if (SUCCEEDED(hr))
@@ -1482,7 +1687,7 @@ static HRESULT copypixels_to_8bppIndexed(struct FormatConverter *This, const WIC
 
             for (x = 0; x < prc->Width; x++)
             {
-                dst[x] = rgb_to_palette_index(bgr, colors, count);
+                dst[x] = rgb_to_palette_index(map, bgr);
                 bgr += 3;
             }
             src += srcstride;
@@ -1491,6 +1696,7 @@ static HRESULT copypixels_to_8bppIndexed(struct FormatConverter *This, const WIC
     }
 
     HeapFree(GetProcessHeap(), 0, srcdata);
+    heap_free(map);
     return hr;
 }
 
@@ -1672,6 +1878,8 @@ static HRESULT WINAPI FormatConverter_CopyPixels(IWICFormatConverter *iface,
             prc = &rc;
         }
 
+        InitOnceExecuteOnce(&converter_init_once, init_converter_tables, NULL, NULL);
+
         return This->dst_format->copy_function(This, prc, cbStride, cbBufferSize,
             pbBuffer, This->src_format->format);
     }
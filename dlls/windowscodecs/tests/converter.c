@@ -1849,6 +1849,92 @@ static void test_converter_8bppIndexed(void)
     DeleteTestBitmap(src_obj);
 }
 
+static void test_converter_performance(void)
+{
+    static const struct
+    {
+        const WICPixelFormatGUID *src_format;
+        const WICPixelFormatGUID *dst_format;
+        const char *name;
+    }
+    tests[] =
+    {
+        {&GUID_WICPixelFormat24bppBGR, &GUID_WICPixelFormat32bppBGRA, "24bppBGR -> 32bppBGRA"},
+        {&GUID_WICPixelFormat24bppRGB, &GUID_WICPixelFormat32bppBGRA, "24bppRGB -> 32bppBGRA"},
+        {&GUID_WICPixelFormat32bppBGR, &GUID_WICPixelFormat32bppBGRA, "32bppBGR -> 32bppBGRA"},
+        {&GUID_WICPixelFormat32bppRGBA, &GUID_WICPixelFormat32bppBGRA, "32bppRGBA -> 32bppBGRA"},
+        {&GUID_WICPixelFormat32bppPBGRA, &GUID_WICPixelFormat32bppBGRA, "32bppPBGRA -> 32bppBGRA"},
+        {&GUID_WICPixelFormat32bppBGRA, &GUID_WICPixelFormat32bppPBGRA, "32bppBGRA -> 32bppPBGRA"},
+        {&GUID_WICPixelFormat32bppBGRA, &GUID_WICPixelFormat24bppBGR, "32bppBGRA -> 24bppBGR"},
+        {&GUID_WICPixelFormat32bppRGBA, &GUID_WICPixelFormat24bppBGR, "32bppRGBA -> 24bppBGR"},
+        {&GUID_WICPixelFormat32bppBGRA, &GUID_WICPixelFormat24bppRGB, "32bppBGRA -> 24bppRGB"},
+        {&GUID_WICPixelFormat24bppBGR, &GUID_WICPixelFormat8bppGray, "24bppBGR -> 8bppGray"},
+        {&GUID_WICPixelFormat32bppGrayFloat, &GUID_WICPixelFormat8bppGray, "32bppGrayFloat -> 8bppGray"},
+        {&GUID_WICPixelFormat32bppGrayFloat, &GUID_WICPixelFormat24bppBGR, "32bppGrayFloat -> 24bppBGR"},
+        {&GUID_WICPixelFormat24bppBGR, &GUID_WICPixelFormat8bppIndexed, "24bppBGR -> 8bppIndexed"},
+    };
+    static const UINT width = 1024, height = 1024, iterations = 10;
+    IWICFormatConverter *converter;
+    IWICBitmap *bitmap;
+    BYTE *src, *dst;
+    DWORD start;
+    UINT i, j, x, y, bpp;
+    HRESULT hr;
+
+    src = HeapAlloc(GetProcessHeap(), 0, width * height * 4);
+    dst = HeapAlloc(GetProcessHeap(), 0, width * height * 4);
+
+    for (i = 0; i < ARRAY_SIZE(tests); i++)
+    {
+        bpp = IsEqualGUID(tests[i].src_format, &GUID_WICPixelFormat24bppBGR)
+                || IsEqualGUID(tests[i].src_format, &GUID_WICPixelFormat24bppRGB) ? 3 : 4;
+
+        for (y = 0; y < height; y++)
+        {
+            for (x = 0; x < width; x++)
+            {
+                BYTE *pixel = src + (y * width + x) * bpp;
+
+                if (IsEqualGUID(tests[i].src_format, &GUID_WICPixelFormat32bppGrayFloat))
+                {
+                    *(float *)pixel = ((x ^ y) & 0x3ff) / 1023.0f;
+                    continue;
+                }
+                pixel[0] = x;
+                pixel[1] = y;
+                pixel[2] = x ^ y;
+                if (bpp == 4)
+                    pixel[3] = (x + y) >> 2;
+            }
+        }
+
+        hr = IWICImagingFactory_CreateBitmapFromMemory(factory, width, height, tests[i].src_format,
+                width * bpp, width * height * bpp, src, &bitmap);
+        ok(hr == S_OK, "%s: CreateBitmapFromMemory error %#x\n", tests[i].name, hr);
+
+        hr = IWICImagingFactory_CreateFormatConverter(factory, &converter);
+        ok(hr == S_OK, "%s: CreateFormatConverter error %#x\n", tests[i].name, hr);
+        hr = IWICFormatConverter_Initialize(converter, (IWICBitmapSource *)bitmap, tests[i].dst_format,
+                WICBitmapDitherTypeNone, NULL, 0.0, WICBitmapPaletteTypeFixedWebPalette);
+        ok(hr == S_OK, "%s: Initialize error %#x\n", tests[i].name, hr);
+
+        start = GetTickCount();
+        for (j = 0; j < iterations; j++)
+        {
+            hr = IWICFormatConverter_CopyPixels(converter, NULL, width * 4, width * height * 4, dst);
+            ok(hr == S_OK, "%s: CopyPixels error %#x\n", tests[i].name, hr);
+        }
+        trace("%s: %u ms per %ux%u image.\n", tests[i].name,
+                (GetTickCount() - start) / iterations, width, height);
+
+        IWICFormatConverter_Release(converter);
+        IWICBitmap_Release(bitmap);
+    }
+
+    HeapFree(GetProcessHeap(), 0, dst);
+    HeapFree(GetProcessHeap(), 0, src);
+}
+
 START_TEST(converter)
 {
     HRESULT hr;
@@ -1908,6 +1994,9 @@ START_TEST(converter)
     test_default_converter();
     test_converter_8bppIndexed();
 
+    if (winetest_interactive)
+        test_converter_performance();
+
     test_encoder(&testdata_8bppIndexed, &CLSID_WICGifEncoder,
                  &testdata_8bppIndexed, &CLSID_WICGifDecoder, "GIF encoder 8bppIndexed");
 
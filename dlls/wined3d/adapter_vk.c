@@ -399,6 +399,98 @@ static const struct wined3d_allocator_ops wined3d_allocator_vk_ops =
     .allocator_destroy_chunk = wined3d_allocator_vk_destroy_chunk,
 };
 
+/* The pipeline cache is kept per application and device, and stored in the
+ * shader cache directory. The driver validates the cache header itself, but
+ * the pipeline cache UUID is part of the key so that driver updates don't
+ * keep replacing each other's entries. */
+static void adapter_vk_get_pipeline_cache_key(struct wined3d_shader_cache_key *key,
+        const struct wined3d_adapter_vk *adapter_vk)
+{
+    const struct wined3d_adapter *adapter = &adapter_vk->a;
+    WCHAR path[MAX_PATH];
+    DWORD len;
+
+    wined3d_shader_cache_key_init(key);
+    wined3d_shader_cache_key_add_string(key, "vk_pipeline_cache");
+    wined3d_shader_cache_key_add(key, adapter_vk->pipeline_cache_uuid, sizeof(adapter_vk->pipeline_cache_uuid));
+    wined3d_shader_cache_key_add(key, &adapter->device_uuid, sizeof(adapter->device_uuid));
+    wined3d_shader_cache_key_add(key, &adapter->driver_uuid, sizeof(adapter->driver_uuid));
+    if ((len = GetModuleFileNameW(NULL, path, ARRAY_SIZE(path))) && len < ARRAY_SIZE(path))
+        wined3d_shader_cache_key_add(key, path, len * sizeof(*path));
+}
+
+static void adapter_vk_create_pipeline_cache(struct wined3d_device_vk *device_vk,
+        const struct wined3d_adapter_vk *adapter_vk)
+{
+    const struct wined3d_vk_info *vk_info = &device_vk->vk_info;
+    VkPipelineCacheCreateInfo cache_info;
+    void *data = NULL;
+    SIZE_T size = 0;
+    VkResult vr;
+
+    if (wined3d_settings.shader_cache_size)
+    {
+        adapter_vk_get_pipeline_cache_key(&device_vk->pipeline_cache_key, adapter_vk);
+        data = wined3d_shader_cache_load(&device_vk->pipeline_cache_key, &size);
+    }
+
+    cache_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cache_info.pNext = NULL;
+    cache_info.flags = 0;
+    cache_info.initialDataSize = data ? size : 0;
+    cache_info.pInitialData = data;
+
+    if ((vr = VK_CALL(vkCreatePipelineCache(device_vk->vk_device,
+            &cache_info, NULL, &device_vk->vk_pipeline_cache))) < 0 && data)
+    {
+        /* Drivers are supposed to ignore incompatible data, but not all of them do. */
+        WARN("Failed to create pipeline cache with %lu bytes of initial data, vr %s.\n",
+                size, wined3d_debug_vkresult(vr));
+        cache_info.initialDataSize = 0;
+        cache_info.pInitialData = NULL;
+        vr = VK_CALL(vkCreatePipelineCache(device_vk->vk_device, &cache_info, NULL, &device_vk->vk_pipeline_cache));
+    }
+    heap_free(data);
+
+    if (vr < 0)
+    {
+        WARN("Failed to create pipeline cache, vr %s.\n", wined3d_debug_vkresult(vr));
+        device_vk->vk_pipeline_cache = VK_NULL_HANDLE;
+        return;
+    }
+
+    device_vk->pipeline_cache_size = cache_info.initialDataSize;
+    TRACE("Created pipeline cache 0x%s with %lu bytes of initial data.\n",
+            wine_dbgstr_longlong(device_vk->vk_pipeline_cache), (unsigned long)cache_info.initialDataSize);
+}
+
+static void adapter_vk_destroy_pipeline_cache(struct wined3d_device_vk *device_vk)
+{
+    const struct wined3d_vk_info *vk_info = &device_vk->vk_info;
+    size_t size;
+    void *data;
+
+    if (!device_vk->vk_pipeline_cache)
+    {
+        wined3d_shader_cache_key_cleanup(&device_vk->pipeline_cache_key);
+        return;
+    }
+
+    /* Pipelines are only ever added to the cache, so an unchanged size
+     * means there is nothing new to write. */
+    if (device_vk->pipeline_cache_key.size
+            && VK_CALL(vkGetPipelineCacheData(device_vk->vk_device, device_vk->vk_pipeline_cache, &size, NULL)) >= 0
+            && size != device_vk->pipeline_cache_size && (data = heap_alloc(size)))
+    {
+        if (VK_CALL(vkGetPipelineCacheData(device_vk->vk_device, device_vk->vk_pipeline_cache, &size, data)) >= 0)
+            wined3d_shader_cache_store(&device_vk->pipeline_cache_key, data, size);
+        heap_free(data);
+    }
+    wined3d_shader_cache_key_cleanup(&device_vk->pipeline_cache_key);
+
+    VK_CALL(vkDestroyPipelineCache(device_vk->vk_device, device_vk->vk_pipeline_cache, NULL));
+}
+
 static HRESULT adapter_vk_create_device(struct wined3d *wined3d, const struct wined3d_adapter *adapter,
         enum wined3d_device_type device_type, HWND focus_window, unsigned int flags, BYTE surface_alignment,
         const enum wined3d_feature_level *levels, unsigned int level_count,
@@ -509,10 +601,14 @@ static HRESULT adapter_vk_create_device(struct wined3d *wined3d, const struct wi
         goto fail;
     }
 
+    adapter_vk_create_pipeline_cache(device_vk, adapter_vk);
+
     if (FAILED(hr = wined3d_device_init(&device_vk->d, wined3d, adapter->ordinal, device_type, focus_window,
             flags, surface_alignment, levels, level_count, vk_info->supported, device_parent)))
     {
         WARN("Failed to initialize device, hr %#x.\n", hr);
+        VK_CALL(vkDestroyPipelineCache(vk_device, device_vk->vk_pipeline_cache, NULL));
+        wined3d_shader_cache_key_cleanup(&device_vk->pipeline_cache_key);
         wined3d_allocator_cleanup(&device_vk->allocator);
         goto fail;
     }
@@ -533,6 +629,7 @@ static void adapter_vk_destroy_device(struct wined3d_device *device)
     const struct wined3d_vk_info *vk_info = &device_vk->vk_info;
 
     wined3d_device_cleanup(&device_vk->d);
+    adapter_vk_destroy_pipeline_cache(device_vk);
     wined3d_allocator_cleanup(&device_vk->allocator);
     VK_CALL(vkDestroyDevice(device_vk->vk_device, NULL));
     heap_free(device_vk);
@@ -1600,7 +1697,10 @@ static void adapter_vk_draw_primitive(struct wined3d_device *device,
     if (!(vk_command_buffer = wined3d_context_vk_apply_draw_state(context_vk,
             state, indirect_vk, parameters->indexed)))
     {
-        ERR("Failed to apply draw state.\n");
+        if (context_vk->shaders_pending)
+            TRACE("Shaders are still being compiled, skipping draw.\n");
+        else
+            ERR("Failed to apply draw state.\n");
         context_release(&context_vk->c);
         return;
     }
@@ -2269,6 +2369,8 @@ static BOOL wined3d_adapter_vk_init(struct wined3d_adapter_vk *adapter_vk,
     else
         VK_CALL(vkGetPhysicalDeviceProperties(adapter_vk->physical_device, &properties2.properties));
     adapter_vk->device_limits = properties2.properties.limits;
+    memcpy(adapter_vk->pipeline_cache_uuid, properties2.properties.pipelineCacheUUID,
+            sizeof(adapter_vk->pipeline_cache_uuid));
 
     VK_CALL(vkGetPhysicalDeviceMemoryProperties(adapter_vk->physical_device, &adapter_vk->memory_properties));
 
@@ -29,6 +29,8 @@
 
 WINE_DEFAULT_DEBUG_CHANNEL(d3d);
 
+static const struct wined3d_buffer_ops wined3d_buffer_gl_ops;
+
 #define WINED3D_BUFFER_HASDESC      0x01    /* A vertex description has been found. */
 #define WINED3D_BUFFER_USE_BO       0x02    /* Use a buffer object for this buffer. */
 #define WINED3D_BUFFER_PIN_SYSMEM   0x04    /* Keep a system memory copy for this buffer. */
@@ -742,11 +744,26 @@ static void wined3d_buffer_drop_bo(struct wined3d_buffer *buffer)
     buffer_resource_unload(&buffer->resource);
 }
 
+/* The streaming buffer space of a mapped buffer stays allocated until the
+ * buffer is unmapped or destroyed, even if the buffer object is destroyed in
+ * the meantime, since the application may still write to it. */
+static void wined3d_buffer_gl_release_streaming(struct wined3d_buffer_gl *buffer_gl)
+{
+    if (!buffer_gl->streaming)
+        return;
+
+    --wined3d_device_gl(buffer_gl->b.resource.device)->streaming_buffer.map_count;
+    buffer_gl->streaming = FALSE;
+}
+
 static void wined3d_buffer_destroy_object(void *object)
 {
     struct wined3d_buffer *buffer = object;
     struct wined3d_context *context;
 
+    if (buffer->buffer_ops == &wined3d_buffer_gl_ops)
+        wined3d_buffer_gl_release_streaming(wined3d_buffer_gl(buffer));
+
     if (buffer->buffer_object)
     {
         context = context_acquire(buffer->resource.device, NULL, 0);
@@ -983,6 +1000,85 @@ struct wined3d_resource * CDECL wined3d_buffer_get_resource(struct wined3d_buffe
     return &buffer->resource;
 }
 
+/* Write-only DISCARD maps of dynamic buffers are redirected to the device
+ * streaming buffer, and the written ranges are copied into the buffer object
+ * on unmap. This avoids both glMapBufferRange() calls and the implicit
+ * synchronisation or renaming the driver would do for them. NOOVERWRITE maps
+ * need the current buffer contents, so they keep using the buffer object.
+ *
+ * Context activation is done by the caller. */
+static BOOL wined3d_buffer_gl_map_streaming(struct wined3d_buffer_gl *buffer_gl,
+        struct wined3d_context_gl *context_gl, uint32_t flags)
+{
+    struct wined3d_resource *resource = &buffer_gl->b.resource;
+    struct wined3d_streaming_buffer_gl *streaming;
+    struct wined3d_device_gl *device_gl;
+
+    if (buffer_gl->b.buffer_ops != &wined3d_buffer_gl_ops)
+        return FALSE;
+
+    if (!(resource->usage & WINED3DUSAGE_DYNAMIC) || !(flags & WINED3D_MAP_DISCARD)
+            || (flags & WINED3D_MAP_READ) || (buffer_gl->b.flags & WINED3D_BUFFER_APPLESYNC))
+        return FALSE;
+
+    /* Redundant DISCARD maps need to preserve the buffer contents; see
+     * buffer_resource_sub_resource_map(). */
+    if (buffer_gl->b.flags & WINED3D_BUFFER_DISCARD)
+        return FALSE;
+
+    device_gl = wined3d_device_gl(resource->device);
+    streaming = &device_gl->streaming_buffer;
+    if (!wined3d_device_gl_streaming_buffer_alloc(device_gl, context_gl,
+            resource->size, &buffer_gl->streaming_offset))
+        return FALSE;
+
+    ++streaming->map_count;
+    buffer_gl->streaming = TRUE;
+    buffer_gl->b.map_ptr = streaming->map_ptr + buffer_gl->streaming_offset;
+
+    TRACE("Mapped buffer %p at streaming buffer offset %#x.\n", buffer_gl, buffer_gl->streaming_offset);
+
+    return TRUE;
+}
+
+/* Context activation is done by the caller. */
+static void wined3d_buffer_gl_unmap_streaming(struct wined3d_buffer_gl *buffer_gl,
+        struct wined3d_context_gl *context_gl, unsigned int range_count, const struct wined3d_range *ranges)
+{
+    struct wined3d_device_gl *device_gl = wined3d_device_gl(buffer_gl->b.resource.device);
+    struct wined3d_streaming_buffer_gl *streaming = &device_gl->streaming_buffer;
+    struct wined3d_bo_address dst, src;
+    unsigned int i;
+
+    if (!buffer_gl->bo.id)
+    {
+        /* The buffer object was destroyed while the buffer was mapped, and
+         * the written ranges were forgotten with it. The rest of a DISCARD
+         * map is undefined, so keep the whole mapping in system memory. */
+        wined3d_buffer_gl_release_streaming(buffer_gl);
+        if (wined3d_buffer_prepare_location(&buffer_gl->b, &context_gl->c, WINED3D_LOCATION_SYSMEM))
+        {
+            memcpy(buffer_gl->b.resource.heap_memory, streaming->map_ptr + buffer_gl->streaming_offset,
+                    buffer_gl->b.resource.size);
+            wined3d_buffer_validate_location(&buffer_gl->b, WINED3D_LOCATION_SYSMEM);
+            wined3d_buffer_invalidate_location(&buffer_gl->b, ~WINED3D_LOCATION_SYSMEM);
+        }
+        return;
+    }
+
+    dst.buffer_object = (uintptr_t)&buffer_gl->bo;
+    src.buffer_object = (uintptr_t)&streaming->bo;
+
+    for (i = 0; i < range_count; ++i)
+    {
+        dst.addr = (BYTE *)(uintptr_t)ranges[i].offset;
+        src.addr = (BYTE *)(uintptr_t)(buffer_gl->streaming_offset + ranges[i].offset);
+        wined3d_context_gl_copy_bo_address(context_gl, &dst, &src, ranges[i].size);
+    }
+
+    wined3d_buffer_gl_release_streaming(buffer_gl);
+}
+
 static HRESULT buffer_resource_sub_resource_map(struct wined3d_resource *resource, unsigned int sub_resource_idx,
         struct wined3d_map_desc *map_desc, const struct wined3d_box *box, uint32_t flags)
 {
@@ -1063,7 +1159,8 @@ static HRESULT buffer_resource_sub_resource_map(struct wined3d_resource *resourc
             if ((flags & WINED3D_MAP_DISCARD) && resource->heap_memory)
                 wined3d_buffer_evict_sysmem(buffer);
 
-            if (count == 1)
+            if (count == 1 && !wined3d_buffer_gl_map_streaming(wined3d_buffer_gl(buffer),
+                    wined3d_context_gl(context), flags))
             {
                 /* Filter redundant WINED3D_MAP_DISCARD maps. The 3DMark2001
                  * multitexture fill rate test seems to depend on this. When
@@ -1156,6 +1253,18 @@ static HRESULT buffer_resource_sub_resource_unmap(struct wined3d_resource *resou
 
     context = context_acquire(device, NULL, 0);
 
+    if (buffer->buffer_ops == &wined3d_buffer_gl_ops && wined3d_buffer_gl(buffer)->streaming)
+    {
+        wined3d_buffer_gl_unmap_streaming(wined3d_buffer_gl(buffer),
+                wined3d_context_gl(context), range_count, buffer->maps);
+        context_release(context);
+
+        buffer_clear_dirty_areas(buffer);
+        buffer->map_ptr = NULL;
+
+        return WINED3D_OK;
+    }
+
     if (buffer->flags & WINED3D_BUFFER_APPLESYNC)
     {
         struct wined3d_context_gl *context_gl;
@@ -1487,21 +1596,44 @@ static void wined3d_buffer_gl_unload_location(struct wined3d_buffer *buffer,
 static void wined3d_buffer_gl_upload_ranges(struct wined3d_buffer *buffer, struct wined3d_context *context,
         const void *data, unsigned int data_offset, unsigned int range_count, const struct wined3d_range *ranges)
 {
+    struct wined3d_device_gl *device_gl = wined3d_device_gl(buffer->resource.device);
+    struct wined3d_streaming_buffer_gl *streaming = &device_gl->streaming_buffer;
     struct wined3d_context_gl *context_gl = wined3d_context_gl(context);
     struct wined3d_buffer_gl *buffer_gl = wined3d_buffer_gl(buffer);
     const struct wined3d_gl_info *gl_info = context_gl->gl_info;
+    struct wined3d_bo_address dst, src;
     const struct wined3d_range *range;
+    BOOL use_streaming;
+    unsigned int offset;
+    const BYTE *ptr;
 
     TRACE("buffer %p, context %p, data %p, data_offset %u, range_count %u, ranges %p.\n",
             buffer, context, data, data_offset, range_count, ranges);
 
+    /* Constant buffer updates are typically small and frequent, and the
+     * buffer is likely still in use by previous draws. */
+    use_streaming = streaming->bo.id && (buffer->resource.bind_flags & WINED3D_BIND_CONSTANT_BUFFER);
+    dst.buffer_object = (uintptr_t)&buffer_gl->bo;
+    src.buffer_object = (uintptr_t)&streaming->bo;
+
     wined3d_buffer_gl_bind(buffer_gl, context_gl);
 
     while (range_count--)
     {
         range = &ranges[range_count];
-        GL_EXTCALL(glBufferSubData(buffer_gl->bo.binding,
-                range->offset, range->size, (BYTE *)data + range->offset - data_offset));
+        ptr = (const BYTE *)data + range->offset - data_offset;
+        wined3d_frame_stats_add(WINED3D_FRAME_COUNTER_UPLOAD_BYTES, range->size);
+
+        if (use_streaming && wined3d_device_gl_streaming_buffer_alloc(device_gl, context_gl, range->size, &offset))
+        {
+            memcpy(streaming->map_ptr + offset, ptr, range->size);
+            dst.addr = (BYTE *)(uintptr_t)range->offset;
+            src.addr = (BYTE *)(uintptr_t)offset;
+            wined3d_context_gl_copy_bo_address(context_gl, &dst, &src, range->size);
+            continue;
+        }
+
+        GL_EXTCALL(glBufferSubData(buffer_gl->bo.binding, range->offset, range->size, ptr));
     }
     checkGLcall("buffer upload");
 }
@@ -1690,6 +1822,7 @@ static void wined3d_buffer_vk_upload_ranges(struct wined3d_buffer *buffer, struc
     {
         range = &ranges[i];
         memcpy((uint8_t *)map_ptr + range->offset, (uint8_t *)data + range->offset - data_offset, range->size);
+        wined3d_frame_stats_add(WINED3D_FRAME_COUNTER_UPLOAD_BYTES, range->size);
     }
 
     wined3d_context_unmap_bo_address(context, &dst, range_count, ranges);
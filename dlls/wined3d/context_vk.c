@@ -517,6 +517,19 @@ static struct wined3d_retired_object_vk *wined3d_context_vk_get_retired_object_v
     return &retired->objects[retired->count++];
 }
 
+static void wined3d_context_vk_destroy_descriptor_set(struct wine_rb_entry *entry, void *ctx)
+{
+    heap_free(WINE_RB_ENTRY_VALUE(entry, struct wined3d_descriptor_set_vk, entry));
+}
+
+/* Cached descriptor sets refer to Vulkan objects by handle, and a handle
+ * may be reused once the object it refers to is destroyed. The sets
+ * themselves remain allocated from the descriptor pool. */
+static void wined3d_context_vk_invalidate_descriptor_sets(struct wined3d_context_vk *context_vk)
+{
+    wine_rb_clear(&context_vk->descriptor_sets, wined3d_context_vk_destroy_descriptor_set, NULL);
+}
+
 void wined3d_context_vk_destroy_framebuffer(struct wined3d_context_vk *context_vk,
         VkFramebuffer vk_framebuffer, uint64_t command_buffer_id)
 {
@@ -549,6 +562,8 @@ static void wined3d_context_vk_destroy_descriptor_pool(struct wined3d_context_vk
     const struct wined3d_vk_info *vk_info = context_vk->vk_info;
     struct wined3d_retired_object_vk *o;
 
+    wined3d_context_vk_invalidate_descriptor_sets(context_vk);
+
     if (context_vk->completed_command_buffer_id > command_buffer_id)
     {
         VK_CALL(vkDestroyDescriptorPool(device_vk->vk_device, vk_descriptor_pool, NULL));
@@ -672,6 +687,8 @@ static void wined3d_context_vk_destroy_buffer(struct wined3d_context_vk *context
     const struct wined3d_vk_info *vk_info = context_vk->vk_info;
     struct wined3d_retired_object_vk *o;
 
+    wined3d_context_vk_invalidate_descriptor_sets(context_vk);
+
     if (context_vk->completed_command_buffer_id > command_buffer_id)
     {
         VK_CALL(vkDestroyBuffer(device_vk->vk_device, vk_buffer, NULL));
@@ -722,6 +739,8 @@ void wined3d_context_vk_destroy_buffer_view(struct wined3d_context_vk *context_v
     const struct wined3d_vk_info *vk_info = context_vk->vk_info;
     struct wined3d_retired_object_vk *o;
 
+    wined3d_context_vk_invalidate_descriptor_sets(context_vk);
+
     if (context_vk->completed_command_buffer_id > command_buffer_id)
     {
         VK_CALL(vkDestroyBufferView(device_vk->vk_device, vk_view, NULL));
@@ -747,6 +766,8 @@ void wined3d_context_vk_destroy_image_view(struct wined3d_context_vk *context_vk
     const struct wined3d_vk_info *vk_info = context_vk->vk_info;
     struct wined3d_retired_object_vk *o;
 
+    wined3d_context_vk_invalidate_descriptor_sets(context_vk);
+
     if (context_vk->completed_command_buffer_id > command_buffer_id)
     {
         VK_CALL(vkDestroyImageView(device_vk->vk_device, vk_view, NULL));
@@ -772,6 +793,8 @@ void wined3d_context_vk_destroy_sampler(struct wined3d_context_vk *context_vk,
     const struct wined3d_vk_info *vk_info = context_vk->vk_info;
     struct wined3d_retired_object_vk *o;
 
+    wined3d_context_vk_invalidate_descriptor_sets(context_vk);
+
     if (context_vk->completed_command_buffer_id > command_buffer_id)
     {
         VK_CALL(vkDestroySampler(device_vk->vk_device, vk_sampler, NULL));
@@ -979,6 +1002,8 @@ static void wined3d_context_vk_destroy_pipeline_layout(struct wine_rb_entry *ent
     vk_info = context_vk->vk_info;
     device_vk = wined3d_device_vk(context_vk->c.device);
 
+    if (layout->vk_update_template)
+        VK_CALL(vkDestroyDescriptorUpdateTemplate(device_vk->vk_device, layout->vk_update_template, NULL));
     VK_CALL(vkDestroyPipelineLayout(device_vk->vk_device, layout->vk_pipeline_layout, NULL));
     VK_CALL(vkDestroyDescriptorSetLayout(device_vk->vk_device, layout->vk_set_layout, NULL));
     heap_free(layout->key.bindings);
@@ -1205,6 +1230,7 @@ static void wined3d_context_vk_destroy_render_pass(struct wine_rb_entry *entry,
 
 static void wined3d_shader_descriptor_writes_vk_cleanup(struct wined3d_shader_descriptor_writes_vk *writes)
 {
+    heap_free(writes->info);
     heap_free(writes->writes);
 }
 
@@ -1321,6 +1347,7 @@ void wined3d_context_vk_cleanup(struct wined3d_context_vk *context_vk)
     wine_rb_destroy(&context_vk->graphics_pipelines, wined3d_context_vk_destroy_graphics_pipeline, context_vk);
     wine_rb_destroy(&context_vk->pipeline_layouts, wined3d_context_vk_destroy_pipeline_layout, context_vk);
     wine_rb_destroy(&context_vk->render_passes, wined3d_context_vk_destroy_render_pass, context_vk);
+    wine_rb_destroy(&context_vk->descriptor_sets, wined3d_context_vk_destroy_descriptor_set, NULL);
 
     wined3d_context_cleanup(&context_vk->c);
 }
@@ -2375,9 +2402,8 @@ static VkResult wined3d_context_vk_create_descriptor_set(struct wined3d_context_
 }
 
 static bool wined3d_shader_descriptor_writes_vk_add_write(struct wined3d_shader_descriptor_writes_vk *writes,
-        VkDescriptorSet vk_descriptor_set, size_t binding_idx, VkDescriptorType type,
-        const VkDescriptorBufferInfo *buffer_info, const VkDescriptorImageInfo *image_info,
-        const VkBufferView *buffer_view)
+        size_t binding_idx, VkDescriptorType type, const VkDescriptorBufferInfo *buffer_info,
+        const VkDescriptorImageInfo *image_info, const VkBufferView *buffer_view)
 {
     SIZE_T write_count = writes->count;
     VkWriteDescriptorSet *write;
@@ -2389,7 +2415,7 @@ static bool wined3d_shader_descriptor_writes_vk_add_write(struct wined3d_shader_
     write = &writes->writes[write_count];
     write->sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
     write->pNext = NULL;
-    write->dstSet = vk_descriptor_set;
+    write->dstSet = VK_NULL_HANDLE;
     write->dstBinding = binding_idx;
     write->dstArrayElement = 0;
     write->descriptorCount = 1;
@@ -2404,8 +2430,8 @@ static bool wined3d_shader_descriptor_writes_vk_add_write(struct wined3d_shader_
 }
 
 static bool wined3d_shader_resource_bindings_add_null_srv_binding(struct wined3d_shader_descriptor_writes_vk *writes,
-        VkDescriptorSet vk_descriptor_set, size_t binding_idx, enum wined3d_shader_resource_type type,
-        enum wined3d_data_type data_type, struct wined3d_context_vk *context_vk)
+        size_t binding_idx, enum wined3d_shader_resource_type type, enum wined3d_data_type data_type,
+        struct wined3d_context_vk *context_vk)
 {
     const struct wined3d_null_views_vk *v = &wined3d_device_vk(context_vk->c.device)->null_views_vk;
 
@@ -2413,38 +2439,38 @@ static bool wined3d_shader_resource_bindings_add_null_srv_binding(struct wined3d
     {
         case WINED3D_SHADER_RESOURCE_BUFFER:
             if (data_type == WINED3D_DATA_FLOAT)
-                return wined3d_shader_descriptor_writes_vk_add_write(writes, vk_descriptor_set, binding_idx,
+                return wined3d_shader_descriptor_writes_vk_add_write(writes, binding_idx,
                         VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER, NULL, NULL, &v->vk_view_buffer_float);
-            return wined3d_shader_descriptor_writes_vk_add_write(writes, vk_descriptor_set, binding_idx,
+            return wined3d_shader_descriptor_writes_vk_add_write(writes, binding_idx,
                     VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER, NULL, NULL, &v->vk_view_buffer_uint);
 
         case WINED3D_SHADER_RESOURCE_TEXTURE_1D:
-            return wined3d_shader_descriptor_writes_vk_add_write(writes, vk_descriptor_set,
-                    binding_idx, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, NULL, &v->vk_info_1d, NULL);
+            return wined3d_shader_descriptor_writes_vk_add_write(writes, binding_idx,
+                    VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, NULL, &v->vk_info_1d, NULL);
 
         case WINED3D_SHADER_RESOURCE_TEXTURE_2D:
-            return wined3d_shader_descriptor_writes_vk_add_write(writes, vk_descriptor_set,
-                    binding_idx, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, NULL, &v->vk_info_2d, NULL);
+            return wined3d_shader_descriptor_writes_vk_add_write(writes, binding_idx,
+                    VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, NULL, &v->vk_info_2d, NULL);
 
         case WINED3D_SHADER_RESOURCE_TEXTURE_2DMS:
-            return wined3d_shader_descriptor_writes_vk_add_write(writes, vk_descriptor_set,
-                    binding_idx, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, NULL, &v->vk_info_2dms, NULL);
+            return wined3d_shader_descriptor_writes_vk_add_write(writes, binding_idx,
+                    VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, NULL, &v->vk_info_2dms, NULL);
 
         case WINED3D_SHADER_RESOURCE_TEXTURE_3D:
-            return wined3d_shader_descriptor_writes_vk_add_write(writes, vk_descriptor_set,
-                    binding_idx, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, NULL, &v->vk_info_3d, NULL);
+            return wined3d_shader_descriptor_writes_vk_add_write(writes, binding_idx,
+                    VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, NULL, &v->vk_info_3d, NULL);
 
         case WINED3D_SHADER_RESOURCE_TEXTURE_CUBE:
-            return wined3d_shader_descriptor_writes_vk_add_write(writes, vk_descriptor_set,
-                    binding_idx, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, NULL, &v->vk_info_cube, NULL);
+            return wined3d_shader_descriptor_writes_vk_add_write(writes, binding_idx,
+                    VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, NULL, &v->vk_info_cube, NULL);
 
         case WINED3D_SHADER_RESOURCE_TEXTURE_2DARRAY:
-            return wined3d_shader_descriptor_writes_vk_add_write(writes, vk_descriptor_set,
-                    binding_idx, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, NULL, &v->vk_info_2d_array, NULL);
+            return wined3d_shader_descriptor_writes_vk_add_write(writes, binding_idx,
+                    VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, NULL, &v->vk_info_2d_array, NULL);
 
         case WINED3D_SHADER_RESOURCE_TEXTURE_2DMSARRAY:
-            return wined3d_shader_descriptor_writes_vk_add_write(writes, vk_descriptor_set,
-                    binding_idx, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, NULL, &v->vk_info_2dms_array, NULL);
+            return wined3d_shader_descriptor_writes_vk_add_write(writes, binding_idx,
+                    VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, NULL, &v->vk_info_2dms_array, NULL);
 
         default:
             FIXME("Unhandled resource type %#x.\n", type);
@@ -2452,12 +2478,127 @@ static bool wined3d_shader_resource_bindings_add_null_srv_binding(struct wined3d
     }
 }
 
+static int wined3d_descriptor_set_vk_compare(const void *key, const struct wine_rb_entry *entry)
+{
+    const struct wined3d_descriptor_set_key_vk *a = key;
+    const struct wined3d_descriptor_set_key_vk *b = &WINE_RB_ENTRY_VALUE(entry,
+            const struct wined3d_descriptor_set_vk, entry)->key;
+
+    if (a->hash != b->hash)
+        return a->hash < b->hash ? -1 : 1;
+    if (a->vk_set_layout != b->vk_set_layout)
+        return a->vk_set_layout < b->vk_set_layout ? -1 : 1;
+    if (a->count != b->count)
+        return a->count - b->count;
+    return memcmp(a->info, b->info, a->count * sizeof(*a->info));
+}
+
+/* Returns a descriptor set containing the descriptors in
+ * context_vk->descriptor_writes. Sets are cached by their contents, so
+ * that binding the same resources again doesn't require allocating and
+ * writing a new set. */
+static VkResult wined3d_context_vk_get_descriptor_set(struct wined3d_context_vk *context_vk,
+        VkDescriptorSetLayout vk_set_layout, VkDescriptorUpdateTemplate vk_update_template,
+        VkDescriptorSet *vk_descriptor_set)
+{
+    struct wined3d_shader_descriptor_writes_vk *writes = &context_vk->descriptor_writes;
+    struct wined3d_device_vk *device_vk = wined3d_device_vk(context_vk->c.device);
+    const struct wined3d_vk_info *vk_info = context_vk->vk_info;
+    union wined3d_descriptor_info_vk *info = NULL;
+    struct wined3d_descriptor_set_key_vk key;
+    struct wined3d_descriptor_set_vk *set;
+    const VkWriteDescriptorSet *write;
+    struct wine_rb_entry *entry;
+    VkResult vr;
+    SIZE_T i;
+
+    /* The descriptor contents double as the update template data, so they
+     * are stored by binding index. */
+    if (wined3d_array_reserve((void **)&writes->info, &writes->info_size, writes->count, sizeof(*writes->info)))
+    {
+        info = writes->info;
+        memset(info, 0, writes->count * sizeof(*info));
+        for (i = 0; i < writes->count; ++i)
+        {
+            write = &writes->writes[i];
+            if (write->dstBinding >= writes->count)
+            {
+                info = NULL;
+                break;
+            }
+
+            if (write->pBufferInfo)
+            {
+                info[write->dstBinding].buffer = *write->pBufferInfo;
+            }
+            else if (write->pImageInfo)
+            {
+                info[write->dstBinding].image.sampler = write->pImageInfo->sampler;
+                info[write->dstBinding].image.imageView = write->pImageInfo->imageView;
+                info[write->dstBinding].image.imageLayout = write->pImageInfo->imageLayout;
+            }
+            else
+            {
+                info[write->dstBinding].buffer_view = *write->pTexelBufferView;
+            }
+        }
+    }
+
+    if (info)
+    {
+        key.vk_set_layout = vk_set_layout;
+        key.hash = wined3d_shader_cache_hash(WINED3D_SHADER_CACHE_HASH_INIT, info, writes->count * sizeof(*info));
+        key.count = writes->count;
+        key.info = info;
+
+        if ((entry = wine_rb_get(&context_vk->descriptor_sets, &key)))
+        {
+            *vk_descriptor_set = WINE_RB_ENTRY_VALUE(entry, struct wined3d_descriptor_set_vk, entry)->vk_descriptor_set;
+            wined3d_frame_stats_add(WINED3D_FRAME_COUNTER_DESCRIPTOR_SET_REUSES, 1);
+            return VK_SUCCESS;
+        }
+    }
+
+    if ((vr = wined3d_context_vk_create_descriptor_set(context_vk, vk_set_layout, vk_descriptor_set)))
+    {
+        WARN("Failed to create descriptor set, vr %s.\n", wined3d_debug_vkresult(vr));
+        return vr;
+    }
+    wined3d_frame_stats_add(WINED3D_FRAME_COUNTER_DESCRIPTOR_SET_ALLOCS, 1);
+
+    if (info && vk_update_template)
+    {
+        VK_CALL(vkUpdateDescriptorSetWithTemplate(device_vk->vk_device, *vk_descriptor_set, vk_update_template, info));
+    }
+    else
+    {
+        for (i = 0; i < writes->count; ++i)
+            writes->writes[i].dstSet = *vk_descriptor_set;
+        VK_CALL(vkUpdateDescriptorSets(device_vk->vk_device, writes->count, writes->writes, 0, NULL));
+    }
+
+    if (!info || !(set = heap_alloc(FIELD_OFFSET(struct wined3d_descriptor_set_vk, info[key.count]))))
+        return VK_SUCCESS;
+
+    memcpy(set->info, info, key.count * sizeof(*info));
+    set->key = key;
+    set->key.info = set->info;
+    set->vk_descriptor_set = *vk_descriptor_set;
+    if (wine_rb_put(&context_vk->descriptor_sets, &set->key, &set->entry) == -1)
+    {
+        ERR("Failed to insert descriptor set.\n");
+        heap_free(set);
+    }
+
+    return VK_SUCCESS;
+}
+
 static bool wined3d_context_vk_update_descriptors(struct wined3d_context_vk *context_vk,
         VkCommandBuffer vk_command_buffer, const struct wined3d_state *state, enum wined3d_pipeline pipeline)
 {
     struct wined3d_shader_descriptor_writes_vk *writes = &context_vk->descriptor_writes;
-    struct wined3d_device_vk *device_vk = wined3d_device_vk(context_vk->c.device);
     const struct wined3d_vk_info *vk_info = context_vk->vk_info;
+    VkDescriptorUpdateTemplate vk_update_template;
     const struct wined3d_shader_resource_binding *binding;
     struct wined3d_shader_resource_bindings *bindings;
     struct wined3d_unordered_access_view_vk *uav_vk;
@@ -2486,6 +2627,7 @@ static bool wined3d_context_vk_update_descriptors(struct wined3d_context_vk *con
             bindings = &context_vk->graphics.bindings;
             vk_bind_point = VK_PIPELINE_BIND_POINT_GRAPHICS;
             vk_set_layout = context_vk->graphics.vk_set_layout;
+            vk_update_template = context_vk->graphics.vk_update_template;
             vk_pipeline_layout = context_vk->graphics.vk_pipeline_layout;
             break;
 
@@ -2493,6 +2635,7 @@ static bool wined3d_context_vk_update_descriptors(struct wined3d_context_vk *con
             bindings = &context_vk->compute.bindings;
             vk_bind_point = VK_PIPELINE_BIND_POINT_COMPUTE;
             vk_set_layout = context_vk->compute.vk_set_layout;
+            vk_update_template = context_vk->compute.vk_update_template;
             vk_pipeline_layout = context_vk->compute.vk_pipeline_layout;
             break;
 
@@ -2501,12 +2644,6 @@ static bool wined3d_context_vk_update_descriptors(struct wined3d_context_vk *con
             return false;
     }
 
-    if ((vr = wined3d_context_vk_create_descriptor_set(context_vk, vk_set_layout, &vk_descriptor_set)))
-    {
-        WARN("Failed to create descriptor set, vr %s.\n", wined3d_debug_vkresult(vr));
-        return false;
-    }
-
     writes->count = 0;
     for (i = 0; i < bindings->count; ++i)
     {
@@ -2522,8 +2659,8 @@ static bool wined3d_context_vk_update_descriptors(struct wined3d_context_vk *con
                 }
                 buffer_vk = wined3d_buffer_vk(buffer);
                 buffer_info = wined3d_buffer_vk_get_buffer_info(buffer_vk);
-                if (!wined3d_shader_descriptor_writes_vk_add_write(writes, vk_descriptor_set,
-                        binding->binding_idx, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, buffer_info, NULL, NULL))
+                if (!wined3d_shader_descriptor_writes_vk_add_write(writes, binding->binding_idx,
+                        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, buffer_info, NULL, NULL))
                     return false;
                 wined3d_context_vk_reference_bo(context_vk, &buffer_vk->bo);
                 break;
@@ -2531,8 +2668,8 @@ static bool wined3d_context_vk_update_descriptors(struct wined3d_context_vk *con
             case WINED3D_SHADER_DESCRIPTOR_TYPE_SRV:
                 if (!(srv = state->shader_resource_view[binding->shader_type][binding->resource_idx]))
                 {
-                    if (!wined3d_shader_resource_bindings_add_null_srv_binding(writes, vk_descriptor_set,
-                            binding->binding_idx, binding->resource_type, binding->resource_data_type, context_vk))
+                    if (!wined3d_shader_resource_bindings_add_null_srv_binding(writes, binding->binding_idx,
+                            binding->resource_type, binding->resource_data_type, context_vk))
                         return false;
                     break;
                 }
@@ -2558,8 +2695,8 @@ static bool wined3d_context_vk_update_descriptors(struct wined3d_context_vk *con
                     type = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
                 }
 
-                if (!wined3d_shader_descriptor_writes_vk_add_write(writes, vk_descriptor_set,
-                        binding->binding_idx, type, NULL, image_info, buffer_view))
+                if (!wined3d_shader_descriptor_writes_vk_add_write(writes, binding->binding_idx,
+                        type, NULL, image_info, buffer_view))
                     return false;
                 wined3d_context_vk_reference_shader_resource_view(context_vk, srv_vk);
                 break;
@@ -2592,8 +2729,8 @@ static bool wined3d_context_vk_update_descriptors(struct wined3d_context_vk *con
                     type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
                 }
 
-                if (!wined3d_shader_descriptor_writes_vk_add_write(writes, vk_descriptor_set,
-                        binding->binding_idx, type, NULL, image_info, buffer_view))
+                if (!wined3d_shader_descriptor_writes_vk_add_write(writes, binding->binding_idx,
+                        type, NULL, image_info, buffer_view))
                     return false;
                 wined3d_context_vk_reference_unordered_access_view(context_vk, uav_vk);
                 break;
@@ -2607,7 +2744,7 @@ static bool wined3d_context_vk_update_descriptors(struct wined3d_context_vk *con
 
                 uav_vk = wined3d_unordered_access_view_vk(uav);
                 if (!uav_vk->vk_counter_view || !wined3d_shader_descriptor_writes_vk_add_write(writes,
-                        vk_descriptor_set, binding->binding_idx, VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER,
+                        binding->binding_idx, VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER,
                         NULL, NULL, &uav_vk->vk_counter_view))
                     return false;
                 break;
@@ -2615,7 +2752,7 @@ static bool wined3d_context_vk_update_descriptors(struct wined3d_context_vk *con
             case WINED3D_SHADER_DESCRIPTOR_TYPE_SAMPLER:
                 if (!(sampler = state->sampler[binding->shader_type][binding->resource_idx]))
                     sampler = context_vk->c.device->null_sampler;
-                if (!wined3d_shader_descriptor_writes_vk_add_write(writes, vk_descriptor_set, binding->binding_idx,
+                if (!wined3d_shader_descriptor_writes_vk_add_write(writes, binding->binding_idx,
                         VK_DESCRIPTOR_TYPE_SAMPLER, NULL, &wined3d_sampler_vk(sampler)->vk_image_info, NULL))
                     return false;
                 wined3d_context_vk_reference_sampler(context_vk, wined3d_sampler_vk(sampler));
@@ -2627,7 +2764,13 @@ static bool wined3d_context_vk_update_descriptors(struct wined3d_context_vk *con
         }
     }
 
-    VK_CALL(vkUpdateDescriptorSets(device_vk->vk_device, writes->count, writes->writes, 0, NULL));
+    if ((vr = wined3d_context_vk_get_descriptor_set(context_vk,
+            vk_set_layout, vk_update_template, &vk_descriptor_set)))
+    {
+        WARN("Failed to get descriptor set, vr %s.\n", wined3d_debug_vkresult(vr));
+        return false;
+    }
+
     VK_CALL(vkCmdBindDescriptorSets(vk_command_buffer, vk_bind_point,
             vk_pipeline_layout, 0, 1, &vk_descriptor_set, 0, NULL));
 
@@ -2653,6 +2796,57 @@ static VkResult wined3d_context_vk_create_descriptor_set_layout(struct wined3d_d
     return vr;
 }
 
+/* The update template data is an array of wined3d_descriptor_info_vk
+ * structures, indexed by binding. */
+static VkDescriptorUpdateTemplate wined3d_context_vk_create_descriptor_update_template(
+        struct wined3d_device_vk *device_vk, const struct wined3d_vk_info *vk_info,
+        const struct wined3d_pipeline_layout_key_vk *key, VkDescriptorSetLayout vk_set_layout)
+{
+    VkDescriptorUpdateTemplate vk_update_template = VK_NULL_HANDLE;
+    VkDescriptorUpdateTemplateCreateInfo template_desc;
+    VkDescriptorUpdateTemplateEntry *entries;
+    VkResult vr;
+    SIZE_T i;
+
+    if (vk_info->api_version < VK_API_VERSION_1_1 || !vk_info->vk_ops.vkCreateDescriptorUpdateTemplate
+            || !key->binding_count)
+        return VK_NULL_HANDLE;
+
+    if (!(entries = heap_calloc(key->binding_count, sizeof(*entries))))
+        return VK_NULL_HANDLE;
+
+    for (i = 0; i < key->binding_count; ++i)
+    {
+        entries[i].dstBinding = key->bindings[i].binding;
+        entries[i].dstArrayElement = 0;
+        entries[i].descriptorCount = 1;
+        entries[i].descriptorType = key->bindings[i].descriptorType;
+        entries[i].offset = key->bindings[i].binding * sizeof(union wined3d_descriptor_info_vk);
+        entries[i].stride = sizeof(union wined3d_descriptor_info_vk);
+    }
+
+    template_desc.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+    template_desc.pNext = NULL;
+    template_desc.flags = 0;
+    template_desc.descriptorUpdateEntryCount = key->binding_count;
+    template_desc.pDescriptorUpdateEntries = entries;
+    template_desc.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+    template_desc.descriptorSetLayout = vk_set_layout;
+    template_desc.pipelineBindPoint = 0;
+    template_desc.pipelineLayout = VK_NULL_HANDLE;
+    template_desc.set = 0;
+
+    if ((vr = VK_CALL(vkCreateDescriptorUpdateTemplate(device_vk->vk_device,
+            &template_desc, NULL, &vk_update_template))) < 0)
+    {
+        WARN("Failed to create descriptor update template, vr %s.\n", wined3d_debug_vkresult(vr));
+        vk_update_template = VK_NULL_HANDLE;
+    }
+    heap_free(entries);
+
+    return vk_update_template;
+}
+
 struct wined3d_pipeline_layout_vk *wined3d_context_vk_get_pipeline_layout(
         struct wined3d_context_vk *context_vk, VkDescriptorSetLayoutBinding *bindings, SIZE_T binding_count)
 {
@@ -2702,9 +2896,14 @@ struct wined3d_pipeline_layout_vk *wined3d_context_vk_get_pipeline_layout(
         goto fail;
     }
 
+    layout->vk_update_template = wined3d_context_vk_create_descriptor_update_template(device_vk,
+            vk_info, &layout->key, layout->vk_set_layout);
+
     if (wine_rb_put(&context_vk->pipeline_layouts, &layout->key, &layout->entry) == -1)
     {
         ERR("Failed to insert pipeline layout.\n");
+        if (layout->vk_update_template)
+            VK_CALL(vkDestroyDescriptorUpdateTemplate(device_vk->vk_device, layout->vk_update_template, NULL));
         VK_CALL(vkDestroyPipelineLayout(device_vk->vk_device, layout->vk_pipeline_layout, NULL));
         VK_CALL(vkDestroyDescriptorSetLayout(device_vk->vk_device, layout->vk_set_layout, NULL));
         goto fail;
@@ -2725,6 +2924,7 @@ static VkPipeline wined3d_context_vk_get_graphics_pipeline(struct wined3d_contex
     struct wined3d_graphics_pipeline_vk *pipeline_vk;
     struct wined3d_graphics_pipeline_key_vk *key;
     struct wine_rb_entry *entry;
+    LONGLONG start = 0;
     VkResult vr;
 
     key = &context_vk->graphics.pipeline_key_vk;
@@ -2735,13 +2935,20 @@ static VkPipeline wined3d_context_vk_get_graphics_pipeline(struct wined3d_contex
         return VK_NULL_HANDLE;
     pipeline_vk->key = *key;
 
-    if ((vr = VK_CALL(vkCreateGraphicsPipelines(device_vk->vk_device,
-            VK_NULL_HANDLE, 1, &key->pipeline_desc, NULL, &pipeline_vk->vk_pipeline))) < 0)
+    if (wined3d_settings.frame_stats)
+        start = wined3d_frame_stats_time();
+    if ((vr = VK_CALL(vkCreateGraphicsPipelines(device_vk->vk_device, device_vk->vk_pipeline_cache,
+            1, &key->pipeline_desc, NULL, &pipeline_vk->vk_pipeline))) < 0)
     {
         WARN("Failed to create graphics pipeline, vr %s.\n", wined3d_debug_vkresult(vr));
         heap_free(pipeline_vk);
         return VK_NULL_HANDLE;
     }
+    if (wined3d_settings.frame_stats)
+    {
+        wined3d_frame_stats_add(WINED3D_FRAME_COUNTER_PIPELINE_COMPILES, 1);
+        wined3d_frame_stats_add(WINED3D_FRAME_COUNTER_PIPELINE_COMPILE_TIME, wined3d_frame_stats_time() - start);
+    }
 
     if (wine_rb_put(&context_vk->graphics_pipelines, &pipeline_vk->key, &pipeline_vk->entry) == -1)
         ERR("Failed to insert pipeline.\n");
@@ -2936,7 +3143,8 @@ VkCommandBuffer wined3d_context_vk_apply_draw_state(struct wined3d_context_vk *c
         device_vk->d.shader_backend->shader_select(device_vk->d.shader_priv, &context_vk->c, state);
         if (!context_vk->graphics.vk_pipeline_layout)
         {
-            ERR("No pipeline layout set.\n");
+            if (!context_vk->shaders_pending)
+                ERR("No pipeline layout set.\n");
             return VK_NULL_HANDLE;
         }
         context_vk->c.update_shader_resource_bindings = 1;
@@ -3180,6 +3388,7 @@ HRESULT wined3d_context_vk_init(struct wined3d_context_vk *context_vk, struct wi
     wine_rb_init(&context_vk->pipeline_layouts, wined3d_pipeline_layout_vk_compare);
     wine_rb_init(&context_vk->graphics_pipelines, wined3d_graphics_pipeline_vk_compare);
     wine_rb_init(&context_vk->bo_slab_available, wined3d_bo_slab_vk_compare);
+    wine_rb_init(&context_vk->descriptor_sets, wined3d_descriptor_set_vk_compare);
 
     return WINED3D_OK;
 }
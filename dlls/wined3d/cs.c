@@ -21,6 +21,7 @@
 #include "wined3d_private.h"
 
 WINE_DEFAULT_DEBUG_CHANNEL(d3d);
+WINE_DECLARE_DEBUG_CHANNEL(d3d_perf);
 WINE_DECLARE_DEBUG_CHANNEL(fps);
 
 #define WINED3D_INITIAL_CS_SIZE 4096
@@ -55,6 +56,7 @@ enum wined3d_cs_op
     WINED3D_CS_OP_SET_RENDER_STATE,
     WINED3D_CS_OP_SET_TEXTURE_STATE,
     WINED3D_CS_OP_SET_SAMPLER_STATE,
+    WINED3D_CS_OP_SET_STATES,
     WINED3D_CS_OP_SET_TRANSFORM,
     WINED3D_CS_OP_SET_CLIP_PLANE,
     WINED3D_CS_OP_SET_COLOR_KEY,
@@ -75,6 +77,7 @@ enum wined3d_cs_op
     WINED3D_CS_OP_CLEAR_UNORDERED_ACCESS_VIEW,
     WINED3D_CS_OP_COPY_UAV_COUNTER,
     WINED3D_CS_OP_GENERATE_MIPMAPS,
+    WINED3D_CS_OP_EXECUTE_COMMAND_LIST,
     WINED3D_CS_OP_STOP,
 };
 
@@ -305,6 +308,29 @@ struct wined3d_cs_set_sampler_state
     DWORD value;
 };
 
+/* The ops that are collected in the pending state table. */
+union wined3d_cs_state_op
+{
+    enum wined3d_cs_op opcode;
+    struct wined3d_cs_set_stream_source stream_source;
+    struct wined3d_cs_set_constant_buffer constant_buffer;
+    struct wined3d_cs_set_texture texture;
+    struct wined3d_cs_set_shader_resource_view shader_resource_view;
+    struct wined3d_cs_set_sampler sampler;
+    struct wined3d_cs_set_render_state render_state;
+    struct wined3d_cs_set_texture_state texture_state;
+    struct wined3d_cs_set_sampler_state sampler_state;
+};
+
+C_ASSERT(sizeof(union wined3d_cs_state_op) <= sizeof(((struct wined3d_cs *)0)->pending_states[0]));
+
+struct wined3d_cs_set_states
+{
+    enum wined3d_cs_op opcode;
+    unsigned int count;
+    union wined3d_cs_state_op ops[1];
+};
+
 struct wined3d_cs_set_transform
 {
     enum wined3d_cs_op opcode;
@@ -350,6 +376,7 @@ struct wined3d_cs_push_constants
 struct wined3d_cs_reset_state
 {
     enum wined3d_cs_op opcode;
+    bool invalidate;
 };
 
 struct wined3d_cs_callback
@@ -448,20 +475,77 @@ struct wined3d_cs_generate_mipmaps
     struct wined3d_shader_resource_view *view;
 };
 
+struct wined3d_cs_execute_command_list
+{
+    enum wined3d_cs_op opcode;
+    struct wined3d_command_list *list;
+};
+
 struct wined3d_cs_stop
 {
     enum wined3d_cs_op opcode;
 };
 
+/* Commands recorded by a deferred context. The packets have the same layout
+ * as in the command stream queues. */
+struct wined3d_command_list
+{
+    LONG refcount;
+    struct wined3d_device *device;
+
+    SIZE_T data_size;
+    void *data;
+
+    /* Resources acquired by the recorded commands. */
+    SIZE_T resource_count;
+    struct wined3d_resource **resources;
+
+    SIZE_T upload_count;
+    void **uploads;
+
+    /* Command lists executed by the recorded commands. */
+    SIZE_T command_list_count;
+    struct wined3d_command_list **command_lists;
+
+    /* Queries issued by the recorded commands. */
+    SIZE_T query_issue_count;
+    struct wined3d_deferred_query_issue *query_issues;
+};
+
+static const struct wined3d_cs_ops wined3d_cs_deferred_ops;
+
+static void wined3d_cs_queue_states(struct wined3d_cs *cs);
+
+static inline void wined3d_cs_queue_pending_states(struct wined3d_cs *cs)
+{
+    /* Pending states are only set by the application thread. */
+    if (cs->pending_state_count && cs->thread_id != GetCurrentThreadId())
+        wined3d_cs_queue_states(cs);
+}
+
 static inline void *wined3d_cs_require_space(struct wined3d_cs *cs,
         size_t size, enum wined3d_cs_queue_id queue_id)
 {
+    wined3d_cs_queue_pending_states(cs);
     return cs->ops->require_space(cs, size, queue_id);
 }
 
-static inline void wined3d_cs_submit(struct wined3d_cs *cs, enum wined3d_cs_queue_id queue_id)
+static inline void wined3d_cs_submit(struct wined3d_cs *cs, void *data, enum wined3d_cs_queue_id queue_id)
+{
+    cs->ops->submit(cs, data, queue_id);
+}
+
+static inline void wined3d_cs_acquire_resource(struct wined3d_cs *cs, struct wined3d_resource *resource)
+{
+    cs->ops->acquire_resource(cs, resource);
+}
+
+/* The application state the commands are emitted for. */
+static inline const struct wined3d_state *wined3d_cs_get_state(const struct wined3d_cs *cs)
 {
-    cs->ops->submit(cs, queue_id);
+    if (cs->ops == &wined3d_cs_deferred_ops)
+        return &cs->state;
+    return &cs->device->state;
 }
 
 static const char *debug_cs_op(enum wined3d_cs_op op)
@@ -497,6 +581,7 @@ static const char *debug_cs_op(enum wined3d_cs_op op)
         WINED3D_TO_STR(WINED3D_CS_OP_SET_RENDER_STATE);
         WINED3D_TO_STR(WINED3D_CS_OP_SET_TEXTURE_STATE);
         WINED3D_TO_STR(WINED3D_CS_OP_SET_SAMPLER_STATE);
+        WINED3D_TO_STR(WINED3D_CS_OP_SET_STATES);
         WINED3D_TO_STR(WINED3D_CS_OP_SET_TRANSFORM);
         WINED3D_TO_STR(WINED3D_CS_OP_SET_CLIP_PLANE);
         WINED3D_TO_STR(WINED3D_CS_OP_SET_COLOR_KEY);
@@ -517,12 +602,26 @@ static const char *debug_cs_op(enum wined3d_cs_op op)
         WINED3D_TO_STR(WINED3D_CS_OP_CLEAR_UNORDERED_ACCESS_VIEW);
         WINED3D_TO_STR(WINED3D_CS_OP_COPY_UAV_COUNTER);
         WINED3D_TO_STR(WINED3D_CS_OP_GENERATE_MIPMAPS);
+        WINED3D_TO_STR(WINED3D_CS_OP_EXECUTE_COMMAND_LIST);
         WINED3D_TO_STR(WINED3D_CS_OP_STOP);
 #undef WINED3D_TO_STR
     }
     return wine_dbg_sprintf("UNKNOWN_OP(%#x)", op);
 }
 
+const char *wined3d_debug_cs_op(unsigned int op)
+{
+    return debug_cs_op(op);
+}
+
+C_ASSERT(WINED3D_CS_OP_STOP <= WINED3D_FRAME_STATS_MAX_OPS);
+
+static inline void wined3d_cs_count_op(struct wined3d_cs *cs, enum wined3d_cs_op opcode)
+{
+    if (cs->frame_stats)
+        ++cs->frame.op_counts[opcode];
+}
+
 static void wined3d_cs_exec_nop(struct wined3d_cs *cs, const void *data)
 {
 }
@@ -576,6 +675,7 @@ static void wined3d_cs_exec_present(struct wined3d_cs *cs, const void *data)
     }
 
     swapchain->swapchain_ops->swapchain_present(swapchain, &op->src_rect, &op->dst_rect, op->swap_interval, op->flags);
+    wined3d_frame_stats_end_frame(cs);
 
     /* Discard buffers if the swap effect allows it. */
     back_buffer = swapchain->back_buffers[desc->backbuffer_count - 1];
@@ -622,7 +722,8 @@ void wined3d_cs_emit_present(struct wined3d_cs *cs, struct wined3d_swapchain *sw
     unsigned int i;
     LONG pending;
 
-    op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
+    if (!(op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT)))
+        return;
     op->opcode = WINED3D_CS_OP_PRESENT;
     op->dst_window_override = dst_window_override;
     op->swapchain = swapchain;
@@ -633,13 +734,18 @@ void wined3d_cs_emit_present(struct wined3d_cs *cs, struct wined3d_swapchain *sw
 
     pending = InterlockedIncrement(&cs->pending_presents);
 
-    wined3d_resource_acquire(&swapchain->front_buffer->resource);
+    wined3d_cs_acquire_resource(cs, &swapchain->front_buffer->resource);
     for (i = 0; i < swapchain->state.desc.backbuffer_count; ++i)
     {
-        wined3d_resource_acquire(&swapchain->back_buffers[i]->resource);
+        wined3d_cs_acquire_resource(cs, &swapchain->back_buffers[i]->resource);
     }
 
-    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+    wined3d_cs_submit(cs, op, WINED3D_CS_QUEUE_DEFAULT);
+
+    TRACE_(d3d_perf)("Dropped %u redundant and merged %u state changes this frame.\n",
+            cs->redundant_state_count, cs->coalesced_state_count);
+    cs->redundant_state_count = 0;
+    cs->coalesced_state_count = 0;
 
     /* Limit input latency by limiting the number of presents that we can get
      * ahead of the worker thread. */
@@ -683,8 +789,9 @@ void wined3d_cs_emit_clear(struct wined3d_cs *cs, DWORD rect_count, const RECT *
 
     rt_count = flags & WINED3DCLEAR_TARGET ? cs->device->adapter->d3d_info.limits.max_rt_count : 0;
 
-    op = wined3d_cs_require_space(cs, FIELD_OFFSET(struct wined3d_cs_clear, rects[rect_count]),
-            WINED3D_CS_QUEUE_DEFAULT);
+    if (!(op = wined3d_cs_require_space(cs, FIELD_OFFSET(struct wined3d_cs_clear, rects[rect_count]),
+            WINED3D_CS_QUEUE_DEFAULT)))
+        return;
     op->opcode = WINED3D_CS_OP_CLEAR;
     op->flags = flags & (WINED3DCLEAR_TARGET | WINED3DCLEAR_ZBUFFER | WINED3DCLEAR_STENCIL);
     op->rt_count = rt_count;
@@ -701,15 +808,15 @@ void wined3d_cs_emit_clear(struct wined3d_cs *cs, DWORD rect_count, const RECT *
     for (i = 0; i < rt_count; ++i)
     {
         if ((view = state->fb.render_targets[i]))
-            wined3d_resource_acquire(view->resource);
+            wined3d_cs_acquire_resource(cs, view->resource);
     }
     if (flags & (WINED3DCLEAR_ZBUFFER | WINED3DCLEAR_STENCIL))
     {
         view = state->fb.depth_stencil;
-        wined3d_resource_acquire(view->resource);
+        wined3d_cs_acquire_resource(cs, view->resource);
     }
 
-    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+    wined3d_cs_submit(cs, op, WINED3D_CS_QUEUE_DEFAULT);
 }
 
 void wined3d_cs_emit_clear_rendertarget_view(struct wined3d_cs *cs, struct wined3d_rendertarget_view *view,
@@ -719,7 +826,8 @@ void wined3d_cs_emit_clear_rendertarget_view(struct wined3d_cs *cs, struct wined
     size_t size;
 
     size = FIELD_OFFSET(struct wined3d_cs_clear, rects[1]) + sizeof(struct wined3d_fb_state);
-    op = wined3d_cs_require_space(cs, size, WINED3D_CS_QUEUE_DEFAULT);
+    if (!(op = wined3d_cs_require_space(cs, size, WINED3D_CS_QUEUE_DEFAULT)))
+        return;
     op->fb = (void *)&op->rects[1];
 
     op->opcode = WINED3D_CS_OP_CLEAR;
@@ -743,14 +851,15 @@ void wined3d_cs_emit_clear_rendertarget_view(struct wined3d_cs *cs, struct wined
     op->rect_count = 1;
     op->rects[0] = *rect;
 
-    wined3d_resource_acquire(view->resource);
+    wined3d_cs_acquire_resource(cs, view->resource);
 
-    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+    wined3d_cs_submit(cs, op, WINED3D_CS_QUEUE_DEFAULT);
     if (flags & WINED3DCLEAR_SYNCHRONOUS)
         wined3d_cs_finish(cs, WINED3D_CS_QUEUE_DEFAULT);
 }
 
-static void acquire_shader_resources(const struct wined3d_state *state, unsigned int shader_mask)
+static void acquire_shader_resources(struct wined3d_cs *cs, const struct wined3d_state *state,
+        unsigned int shader_mask)
 {
     struct wined3d_shader_sampler_map_entry *entry;
     struct wined3d_shader_resource_view *view;
@@ -768,7 +877,7 @@ static void acquire_shader_resources(const struct wined3d_state *state, unsigned
         for (j = 0; j < WINED3D_MAX_CBS; ++j)
         {
             if (state->cb[i][j])
-                wined3d_resource_acquire(&state->cb[i][j]->resource);
+                wined3d_cs_acquire_resource(cs, &state->cb[i][j]->resource);
         }
 
         for (j = 0; j < shader->reg_maps.sampler_map.count; ++j)
@@ -778,7 +887,7 @@ static void acquire_shader_resources(const struct wined3d_state *state, unsigned
             if (!(view = state->shader_resource_view[i][entry->resource_idx]))
                 continue;
 
-            wined3d_resource_acquire(view->resource);
+            wined3d_cs_acquire_resource(cs, view->resource);
         }
     }
 }
@@ -816,7 +925,7 @@ static void release_shader_resources(const struct wined3d_state *state, unsigned
     }
 }
 
-static void acquire_unordered_access_resources(const struct wined3d_shader *shader,
+static void acquire_unordered_access_resources(struct wined3d_cs *cs, const struct wined3d_shader *shader,
         struct wined3d_unordered_access_view * const *views)
 {
     unsigned int i;
@@ -832,7 +941,7 @@ static void acquire_unordered_access_resources(const struct wined3d_shader *shad
         if (!views[i])
             continue;
 
-        wined3d_resource_acquire(views[i]->resource);
+        wined3d_cs_acquire_resource(cs, views[i]->resource);
     }
 }
 
@@ -874,47 +983,49 @@ static void wined3d_cs_exec_dispatch(struct wined3d_cs *cs, const void *data)
             state->unordered_access_view[WINED3D_PIPELINE_COMPUTE]);
 }
 
-static void acquire_compute_pipeline_resources(const struct wined3d_state *state)
+static void acquire_compute_pipeline_resources(struct wined3d_cs *cs, const struct wined3d_state *state)
 {
-    acquire_shader_resources(state, 1u << WINED3D_SHADER_TYPE_COMPUTE);
-    acquire_unordered_access_resources(state->shader[WINED3D_SHADER_TYPE_COMPUTE],
+    acquire_shader_resources(cs, state, 1u << WINED3D_SHADER_TYPE_COMPUTE);
+    acquire_unordered_access_resources(cs, state->shader[WINED3D_SHADER_TYPE_COMPUTE],
             state->unordered_access_view[WINED3D_PIPELINE_COMPUTE]);
 }
 
 void wined3d_cs_emit_dispatch(struct wined3d_cs *cs,
         unsigned int group_count_x, unsigned int group_count_y, unsigned int group_count_z)
 {
-    const struct wined3d_state *state = &cs->device->state;
+    const struct wined3d_state *state = wined3d_cs_get_state(cs);
     struct wined3d_cs_dispatch *op;
 
-    op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
+    if (!(op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT)))
+        return;
     op->opcode = WINED3D_CS_OP_DISPATCH;
     op->parameters.indirect = FALSE;
     op->parameters.u.direct.group_count_x = group_count_x;
     op->parameters.u.direct.group_count_y = group_count_y;
     op->parameters.u.direct.group_count_z = group_count_z;
 
-    acquire_compute_pipeline_resources(state);
+    acquire_compute_pipeline_resources(cs, state);
 
-    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+    wined3d_cs_submit(cs, op, WINED3D_CS_QUEUE_DEFAULT);
 }
 
 void wined3d_cs_emit_dispatch_indirect(struct wined3d_cs *cs,
         struct wined3d_buffer *buffer, unsigned int offset)
 {
-    const struct wined3d_state *state = &cs->device->state;
+    const struct wined3d_state *state = wined3d_cs_get_state(cs);
     struct wined3d_cs_dispatch *op;
 
-    op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
+    if (!(op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT)))
+        return;
     op->opcode = WINED3D_CS_OP_DISPATCH;
     op->parameters.indirect = TRUE;
     op->parameters.u.indirect.buffer = buffer;
     op->parameters.u.indirect.offset = offset;
 
-    acquire_compute_pipeline_resources(state);
-    wined3d_resource_acquire(&buffer->resource);
+    acquire_compute_pipeline_resources(cs, state);
+    wined3d_cs_acquire_resource(cs, &buffer->resource);
 
-    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+    wined3d_cs_submit(cs, op, WINED3D_CS_QUEUE_DEFAULT);
 }
 
 static void wined3d_cs_exec_draw(struct wined3d_cs *cs, const void *data)
@@ -1004,37 +1115,37 @@ static void wined3d_cs_exec_draw(struct wined3d_cs *cs, const void *data)
             state->unordered_access_view[WINED3D_PIPELINE_GRAPHICS]);
 }
 
-static void acquire_graphics_pipeline_resources(const struct wined3d_state *state,
+static void acquire_graphics_pipeline_resources(struct wined3d_cs *cs, const struct wined3d_state *state,
         BOOL indexed, const struct wined3d_d3d_info *d3d_info)
 {
     unsigned int i;
 
     if (indexed)
-        wined3d_resource_acquire(&state->index_buffer->resource);
+        wined3d_cs_acquire_resource(cs, &state->index_buffer->resource);
     for (i = 0; i < ARRAY_SIZE(state->streams); ++i)
     {
         if (state->streams[i].buffer)
-            wined3d_resource_acquire(&state->streams[i].buffer->resource);
+            wined3d_cs_acquire_resource(cs, &state->streams[i].buffer->resource);
     }
     for (i = 0; i < ARRAY_SIZE(state->stream_output); ++i)
     {
         if (state->stream_output[i].buffer)
-            wined3d_resource_acquire(&state->stream_output[i].buffer->resource);
+            wined3d_cs_acquire_resource(cs, &state->stream_output[i].buffer->resource);
     }
     for (i = 0; i < ARRAY_SIZE(state->textures); ++i)
     {
         if (state->textures[i])
-            wined3d_resource_acquire(&state->textures[i]->resource);
+            wined3d_cs_acquire_resource(cs, &state->textures[i]->resource);
     }
     for (i = 0; i < d3d_info->limits.max_rt_count; ++i)
     {
         if (state->fb.render_targets[i])
-            wined3d_resource_acquire(state->fb.render_targets[i]->resource);
+            wined3d_cs_acquire_resource(cs, state->fb.render_targets[i]->resource);
     }
     if (state->fb.depth_stencil)
-        wined3d_resource_acquire(state->fb.depth_stencil->resource);
-    acquire_shader_resources(state, ~(1u << WINED3D_SHADER_TYPE_COMPUTE));
-    acquire_unordered_access_resources(state->shader[WINED3D_SHADER_TYPE_PIXEL],
+        wined3d_cs_acquire_resource(cs, state->fb.depth_stencil->resource);
+    acquire_shader_resources(cs, state, ~(1u << WINED3D_SHADER_TYPE_COMPUTE));
+    acquire_unordered_access_resources(cs, state->shader[WINED3D_SHADER_TYPE_PIXEL],
             state->unordered_access_view[WINED3D_PIPELINE_GRAPHICS]);
 }
 
@@ -1043,10 +1154,11 @@ void wined3d_cs_emit_draw(struct wined3d_cs *cs, enum wined3d_primitive_type pri
         unsigned int index_count, unsigned int start_instance, unsigned int instance_count, bool indexed)
 {
     const struct wined3d_d3d_info *d3d_info = &cs->device->adapter->d3d_info;
-    const struct wined3d_state *state = &cs->device->state;
+    const struct wined3d_state *state = wined3d_cs_get_state(cs);
     struct wined3d_cs_draw *op;
 
-    op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
+    if (!(op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT)))
+        return;
     op->opcode = WINED3D_CS_OP_DRAW;
     op->primitive_type = primitive_type;
     op->patch_vertex_count = patch_vertex_count;
@@ -1058,19 +1170,20 @@ void wined3d_cs_emit_draw(struct wined3d_cs *cs, enum wined3d_primitive_type pri
     op->parameters.u.direct.instance_count = instance_count;
     op->parameters.indexed = indexed;
 
-    acquire_graphics_pipeline_resources(state, indexed, d3d_info);
+    acquire_graphics_pipeline_resources(cs, state, indexed, d3d_info);
 
-    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+    wined3d_cs_submit(cs, op, WINED3D_CS_QUEUE_DEFAULT);
 }
 
 void wined3d_cs_emit_draw_indirect(struct wined3d_cs *cs, enum wined3d_primitive_type primitive_type,
         unsigned int patch_vertex_count, struct wined3d_buffer *buffer, unsigned int offset, bool indexed)
 {
     const struct wined3d_d3d_info *d3d_info = &cs->device->adapter->d3d_info;
-    const struct wined3d_state *state = &cs->device->state;
+    const struct wined3d_state *state = wined3d_cs_get_state(cs);
     struct wined3d_cs_draw *op;
 
-    op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
+    if (!(op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT)))
+        return;
     op->opcode = WINED3D_CS_OP_DRAW;
     op->primitive_type = primitive_type;
     op->patch_vertex_count = patch_vertex_count;
@@ -1079,10 +1192,10 @@ void wined3d_cs_emit_draw_indirect(struct wined3d_cs *cs, enum wined3d_primitive
     op->parameters.u.indirect.offset = offset;
     op->parameters.indexed = indexed;
 
-    acquire_graphics_pipeline_resources(state, indexed, d3d_info);
-    wined3d_resource_acquire(&buffer->resource);
+    acquire_graphics_pipeline_resources(cs, state, indexed, d3d_info);
+    wined3d_cs_acquire_resource(cs, &buffer->resource);
 
-    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+    wined3d_cs_submit(cs, op, WINED3D_CS_QUEUE_DEFAULT);
 }
 
 static void wined3d_cs_exec_flush(struct wined3d_cs *cs, const void *data)
@@ -1098,10 +1211,11 @@ void wined3d_cs_emit_flush(struct wined3d_cs *cs)
 {
     struct wined3d_cs_flush *op;
 
-    op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
+    if (!(op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT)))
+        return;
     op->opcode = WINED3D_CS_OP_FLUSH;
 
-    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+    wined3d_cs_submit(cs, op, WINED3D_CS_QUEUE_DEFAULT);
     cs->queries_flushed = TRUE;
 }
 
@@ -1117,12 +1231,13 @@ void wined3d_cs_emit_set_predication(struct wined3d_cs *cs, struct wined3d_query
 {
     struct wined3d_cs_set_predication *op;
 
-    op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
+    if (!(op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT)))
+        return;
     op->opcode = WINED3D_CS_OP_SET_PREDICATION;
     op->predicate = predicate;
     op->value = value;
 
-    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+    wined3d_cs_submit(cs, op, WINED3D_CS_QUEUE_DEFAULT);
 }
 
 static void wined3d_cs_exec_set_viewports(struct wined3d_cs *cs, const void *data)
@@ -1142,13 +1257,14 @@ void wined3d_cs_emit_set_viewports(struct wined3d_cs *cs, unsigned int viewport_
 {
     struct wined3d_cs_set_viewports *op;
 
-    op = wined3d_cs_require_space(cs, FIELD_OFFSET(struct wined3d_cs_set_viewports, viewports[viewport_count]),
-            WINED3D_CS_QUEUE_DEFAULT);
+    if (!(op = wined3d_cs_require_space(cs, FIELD_OFFSET(struct wined3d_cs_set_viewports, viewports[viewport_count]),
+            WINED3D_CS_QUEUE_DEFAULT)))
+        return;
     op->opcode = WINED3D_CS_OP_SET_VIEWPORTS;
     memcpy(op->viewports, viewports, viewport_count * sizeof(*viewports));
     op->viewport_count = viewport_count;
 
-    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+    wined3d_cs_submit(cs, op, WINED3D_CS_QUEUE_DEFAULT);
 }
 
 static void wined3d_cs_exec_set_scissor_rects(struct wined3d_cs *cs, const void *data)
@@ -1167,13 +1283,14 @@ void wined3d_cs_emit_set_scissor_rects(struct wined3d_cs *cs, unsigned int rect_
 {
     struct wined3d_cs_set_scissor_rects *op;
 
-    op = wined3d_cs_require_space(cs, FIELD_OFFSET(struct wined3d_cs_set_scissor_rects, rects[rect_count]),
-            WINED3D_CS_QUEUE_DEFAULT);
+    if (!(op = wined3d_cs_require_space(cs, FIELD_OFFSET(struct wined3d_cs_set_scissor_rects, rects[rect_count]),
+            WINED3D_CS_QUEUE_DEFAULT)))
+        return;
     op->opcode = WINED3D_CS_OP_SET_SCISSOR_RECTS;
     memcpy(op->rects, rects, rect_count * sizeof(*rects));
     op->rect_count = rect_count;
 
-    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+    wined3d_cs_submit(cs, op, WINED3D_CS_QUEUE_DEFAULT);
 }
 
 static void wined3d_cs_exec_set_rendertarget_view(struct wined3d_cs *cs, const void *data)
@@ -1197,12 +1314,13 @@ void wined3d_cs_emit_set_rendertarget_view(struct wined3d_cs *cs, unsigned int v
 {
     struct wined3d_cs_set_rendertarget_view *op;
 
-    op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
+    if (!(op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT)))
+        return;
     op->opcode = WINED3D_CS_OP_SET_RENDERTARGET_VIEW;
     op->view_idx = view_idx;
     op->view = view;
 
-    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+    wined3d_cs_submit(cs, op, WINED3D_CS_QUEUE_DEFAULT);
 }
 
 static void wined3d_cs_exec_set_depth_stencil_view(struct wined3d_cs *cs, const void *data)
@@ -1244,11 +1362,12 @@ void wined3d_cs_emit_set_depth_stencil_view(struct wined3d_cs *cs, struct wined3
 {
     struct wined3d_cs_set_depth_stencil_view *op;
 
-    op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
+    if (!(op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT)))
+        return;
     op->opcode = WINED3D_CS_OP_SET_DEPTH_STENCIL_VIEW;
     op->view = view;
 
-    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+    wined3d_cs_submit(cs, op, WINED3D_CS_QUEUE_DEFAULT);
 }
 
 static void wined3d_cs_exec_set_vertex_declaration(struct wined3d_cs *cs, const void *data)
@@ -1263,11 +1382,69 @@ void wined3d_cs_emit_set_vertex_declaration(struct wined3d_cs *cs, struct wined3
 {
     struct wined3d_cs_set_vertex_declaration *op;
 
-    op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
+    if (!(op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT)))
+        return;
     op->opcode = WINED3D_CS_OP_SET_VERTEX_DECLARATION;
     op->declaration = declaration;
 
-    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+    wined3d_cs_submit(cs, op, WINED3D_CS_QUEUE_DEFAULT);
+}
+
+/* State setting ops are not queued individually. They are collected in the
+ * pending state table and queued as a single WINED3D_CS_OP_SET_STATES packet
+ * before the next command, so that a later value for the same state replaces
+ * an earlier one instead of being queued after it. */
+static void wined3d_cs_emit_state(struct wined3d_cs *cs, enum wined3d_cs_state_key key,
+        const void *data, size_t size)
+{
+    unsigned int i;
+    void *op;
+
+    /* Commands emitted by the CS thread itself are executed immediately. */
+    if (cs->thread_id == GetCurrentThreadId())
+    {
+        if (!(op = cs->ops->require_space(cs, size, WINED3D_CS_QUEUE_DEFAULT)))
+            return;
+        memcpy(op, data, size);
+        cs->ops->submit(cs, op, WINED3D_CS_QUEUE_DEFAULT);
+        return;
+    }
+
+    if ((i = cs->pending_state_slots[key]) && i <= cs->pending_state_count
+            && cs->pending_state_keys[i - 1] == key)
+    {
+        --i;
+    }
+    else
+    {
+        if (cs->pending_state_count == ARRAY_SIZE(cs->pending_states))
+            wined3d_cs_queue_states(cs);
+        i = cs->pending_state_count++;
+        cs->pending_state_keys[i] = key;
+        cs->pending_state_slots[key] = i + 1;
+    }
+    ++cs->pending_state_sets;
+    memcpy(&cs->pending_states[i], data, size);
+}
+
+static void wined3d_cs_queue_states(struct wined3d_cs *cs)
+{
+    unsigned int count = cs->pending_state_count, i;
+    struct wined3d_cs_set_states *op;
+
+    cs->coalesced_state_count += cs->pending_state_sets - count;
+    cs->pending_state_sets = 0;
+    cs->pending_state_count = 0;
+
+    if (!(op = cs->ops->require_space(cs, FIELD_OFFSET(struct wined3d_cs_set_states, ops[count]),
+            WINED3D_CS_QUEUE_DEFAULT)))
+        return;
+    op->opcode = WINED3D_CS_OP_SET_STATES;
+    op->count = count;
+    for (i = 0; i < count; ++i)
+        memcpy(&op->ops[i], &cs->pending_states[i], sizeof(op->ops[i]));
+
+    cs->ops->submit(cs, op, WINED3D_CS_QUEUE_DEFAULT);
 }
 
 static void wined3d_cs_exec_set_stream_source(struct wined3d_cs *cs, const void *data)
@@ -1293,16 +1470,15 @@ static void wined3d_cs_exec_set_stream_source(struct wined3d_cs *cs, const void
 void wined3d_cs_emit_set_stream_source(struct wined3d_cs *cs, UINT stream_idx,
         struct wined3d_buffer *buffer, UINT offset, UINT stride)
 {
-    struct wined3d_cs_set_stream_source *op;
+    struct wined3d_cs_set_stream_source op;
 
-    op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
-    op->opcode = WINED3D_CS_OP_SET_STREAM_SOURCE;
-    op->stream_idx = stream_idx;
-    op->buffer = buffer;
-    op->offset = offset;
-    op->stride = stride;
+    op.opcode = WINED3D_CS_OP_SET_STREAM_SOURCE;
+    op.stream_idx = stream_idx;
+    op.buffer = buffer;
+    op.offset = offset;
+    op.stride = stride;
 
-    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+    wined3d_cs_emit_state(cs, WINED3D_CS_KEY_STREAM_SOURCE + stream_idx, &op, sizeof(op));
 }
 
 static void wined3d_cs_exec_set_stream_source_freq(struct wined3d_cs *cs, const void *data)
@@ -1321,13 +1497,14 @@ void wined3d_cs_emit_set_stream_source_freq(struct wined3d_cs *cs, UINT stream_i
 {
     struct wined3d_cs_set_stream_source_freq *op;
 
-    op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
+    if (!(op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT)))
+        return;
     op->opcode = WINED3D_CS_OP_SET_STREAM_SOURCE_FREQ;
     op->stream_idx = stream_idx;
     op->frequency = frequency;
     op->flags = flags;
 
-    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+    wined3d_cs_submit(cs, op, WINED3D_CS_QUEUE_DEFAULT);
 }
 
 static void wined3d_cs_exec_set_stream_output(struct wined3d_cs *cs, const void *data)
@@ -1354,13 +1531,14 @@ void wined3d_cs_emit_set_stream_output(struct wined3d_cs *cs, UINT stream_idx,
 {
     struct wined3d_cs_set_stream_output *op;
 
-    op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
+    if (!(op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT)))
+        return;
     op->opcode = WINED3D_CS_OP_SET_STREAM_OUTPUT;
     op->stream_idx = stream_idx;
     op->buffer = buffer;
     op->offset = offset;
 
-    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+    wined3d_cs_submit(cs, op, WINED3D_CS_QUEUE_DEFAULT);
 }
 
 static void wined3d_cs_exec_set_index_buffer(struct wined3d_cs *cs, const void *data)
@@ -1386,13 +1564,14 @@ void wined3d_cs_emit_set_index_buffer(struct wined3d_cs *cs, struct wined3d_buff
 {
     struct wined3d_cs_set_index_buffer *op;
 
-    op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
+    if (!(op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT)))
+        return;
     op->opcode = WINED3D_CS_OP_SET_INDEX_BUFFER;
     op->buffer = buffer;
     op->format_id = format_id;
     op->offset = offset;
 
-    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+    wined3d_cs_submit(cs, op, WINED3D_CS_QUEUE_DEFAULT);
 }
 
 static void wined3d_cs_exec_set_constant_buffer(struct wined3d_cs *cs, const void *data)
@@ -1414,15 +1593,15 @@ static void wined3d_cs_exec_set_constant_buffer(struct wined3d_cs *cs, const voi
 void wined3d_cs_emit_set_constant_buffer(struct wined3d_cs *cs, enum wined3d_shader_type type,
         UINT cb_idx, struct wined3d_buffer *buffer)
 {
-    struct wined3d_cs_set_constant_buffer *op;
+    struct wined3d_cs_set_constant_buffer op;
 
-    op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
-    op->opcode = WINED3D_CS_OP_SET_CONSTANT_BUFFER;
-    op->type = type;
-    op->cb_idx = cb_idx;
-    op->buffer = buffer;
+    op.opcode = WINED3D_CS_OP_SET_CONSTANT_BUFFER;
+    op.type = type;
+    op.cb_idx = cb_idx;
+    op.buffer = buffer;
 
-    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+    wined3d_cs_emit_state(cs, WINED3D_CS_KEY_CONSTANT_BUFFER + type * MAX_CONSTANT_BUFFERS + cb_idx,
+            &op, sizeof(op));
 }
 
 static void wined3d_cs_exec_set_texture(struct wined3d_cs *cs, const void *data)
@@ -1505,14 +1684,13 @@ static void wined3d_cs_exec_set_texture(struct wined3d_cs *cs, const void *data)
 
 void wined3d_cs_emit_set_texture(struct wined3d_cs *cs, UINT stage, struct wined3d_texture *texture)
 {
-    struct wined3d_cs_set_texture *op;
+    struct wined3d_cs_set_texture op;
 
-    op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
-    op->opcode = WINED3D_CS_OP_SET_TEXTURE;
-    op->stage = stage;
-    op->texture = texture;
+    op.opcode = WINED3D_CS_OP_SET_TEXTURE;
+    op.stage = stage;
+    op.texture = texture;
 
-    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+    wined3d_cs_emit_state(cs, WINED3D_CS_KEY_TEXTURE + stage, &op, sizeof(op));
 }
 
 static void wined3d_cs_exec_set_shader_resource_view(struct wined3d_cs *cs, const void *data)
@@ -1537,15 +1715,15 @@ static void wined3d_cs_exec_set_shader_resource_view(struct wined3d_cs *cs, cons
 void wined3d_cs_emit_set_shader_resource_view(struct wined3d_cs *cs, enum wined3d_shader_type type,
         UINT view_idx, struct wined3d_shader_resource_view *view)
 {
-    struct wined3d_cs_set_shader_resource_view *op;
+    struct wined3d_cs_set_shader_resource_view op;
 
-    op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
-    op->opcode = WINED3D_CS_OP_SET_SHADER_RESOURCE_VIEW;
-    op->type = type;
-    op->view_idx = view_idx;
-    op->view = view;
+    op.opcode = WINED3D_CS_OP_SET_SHADER_RESOURCE_VIEW;
+    op.type = type;
+    op.view_idx = view_idx;
+    op.view = view;
 
-    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+    wined3d_cs_emit_state(cs, WINED3D_CS_KEY_SHADER_RESOURCE_VIEW + type * MAX_SHADER_RESOURCE_VIEWS + view_idx,
+            &op, sizeof(op));
 }
 
 static void wined3d_cs_exec_set_unordered_access_view(struct wined3d_cs *cs, const void *data)
@@ -1572,14 +1750,15 @@ void wined3d_cs_emit_set_unordered_access_view(struct wined3d_cs *cs, enum wined
 {
     struct wined3d_cs_set_unordered_access_view *op;
 
-    op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
+    if (!(op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT)))
+        return;
     op->opcode = WINED3D_CS_OP_SET_UNORDERED_ACCESS_VIEW;
     op->pipeline = pipeline;
     op->view_idx = view_idx;
     op->view = view;
     op->initial_count = initial_count;
 
-    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+    wined3d_cs_submit(cs, op, WINED3D_CS_QUEUE_DEFAULT);
 }
 
 static void wined3d_cs_exec_set_sampler(struct wined3d_cs *cs, const void *data)
@@ -1596,15 +1775,14 @@ static void wined3d_cs_exec_set_sampler(struct wined3d_cs *cs, const void *data)
 void wined3d_cs_emit_set_sampler(struct wined3d_cs *cs, enum wined3d_shader_type type,
         UINT sampler_idx, struct wined3d_sampler *sampler)
 {
-    struct wined3d_cs_set_sampler *op;
+    struct wined3d_cs_set_sampler op;
 
-    op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
-    op->opcode = WINED3D_CS_OP_SET_SAMPLER;
-    op->type = type;
-    op->sampler_idx = sampler_idx;
-    op->sampler = sampler;
+    op.opcode = WINED3D_CS_OP_SET_SAMPLER;
+    op.type = type;
+    op.sampler_idx = sampler_idx;
+    op.sampler = sampler;
 
-    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+    wined3d_cs_emit_state(cs, WINED3D_CS_KEY_SAMPLER + type * MAX_SAMPLER_OBJECTS + sampler_idx, &op, sizeof(op));
 }
 
 static void wined3d_cs_exec_set_shader(struct wined3d_cs *cs, const void *data)
@@ -1623,12 +1801,13 @@ void wined3d_cs_emit_set_shader(struct wined3d_cs *cs, enum wined3d_shader_type
 {
     struct wined3d_cs_set_shader *op;
 
-    op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
+    if (!(op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT)))
+        return;
     op->opcode = WINED3D_CS_OP_SET_SHADER;
     op->type = type;
     op->shader = shader;
 
-    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+    wined3d_cs_submit(cs, op, WINED3D_CS_QUEUE_DEFAULT);
 }
 
 static void wined3d_cs_exec_set_blend_state(struct wined3d_cs *cs, const void *data)
@@ -1652,13 +1831,14 @@ void wined3d_cs_emit_set_blend_state(struct wined3d_cs *cs, struct wined3d_blend
 {
     struct wined3d_cs_set_blend_state *op;
 
-    op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
+    if (!(op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT)))
+        return;
     op->opcode = WINED3D_CS_OP_SET_BLEND_STATE;
     op->state = state;
     op->factor = *blend_factor;
     op->sample_mask = sample_mask;
 
-    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+    wined3d_cs_submit(cs, op, WINED3D_CS_QUEUE_DEFAULT);
 }
 
 static void wined3d_cs_exec_set_depth_stencil_state(struct wined3d_cs *cs, const void *data)
@@ -1674,11 +1854,12 @@ void wined3d_cs_emit_set_depth_stencil_state(struct wined3d_cs *cs,
 {
     struct wined3d_cs_set_depth_stencil_state *op;
 
-    op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
+    if (!(op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT)))
+        return;
     op->opcode = WINED3D_CS_OP_SET_DEPTH_STENCIL_STATE;
     op->state = state;
 
-    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+    wined3d_cs_submit(cs, op, WINED3D_CS_QUEUE_DEFAULT);
 }
 
 static void wined3d_cs_exec_set_rasterizer_state(struct wined3d_cs *cs, const void *data)
@@ -1694,11 +1875,12 @@ void wined3d_cs_emit_set_rasterizer_state(struct wined3d_cs *cs,
 {
     struct wined3d_cs_set_rasterizer_state *op;
 
-    op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
+    if (!(op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT)))
+        return;
     op->opcode = WINED3D_CS_OP_SET_RASTERIZER_STATE;
     op->state = rasterizer_state;
 
-    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+    wined3d_cs_submit(cs, op, WINED3D_CS_QUEUE_DEFAULT);
 }
 
 static void wined3d_cs_exec_set_render_state(struct wined3d_cs *cs, const void *data)
@@ -1711,14 +1893,13 @@ static void wined3d_cs_exec_set_render_state(struct wined3d_cs *cs, const void *
 
 void wined3d_cs_emit_set_render_state(struct wined3d_cs *cs, enum wined3d_render_state state, DWORD value)
 {
-    struct wined3d_cs_set_render_state *op;
+    struct wined3d_cs_set_render_state op;
 
-    op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
-    op->opcode = WINED3D_CS_OP_SET_RENDER_STATE;
-    op->state = state;
-    op->value = value;
+    op.opcode = WINED3D_CS_OP_SET_RENDER_STATE;
+    op.state = state;
+    op.value = value;
 
-    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+    wined3d_cs_emit_state(cs, WINED3D_CS_KEY_RENDER_STATE + state, &op, sizeof(op));
 }
 
 static void wined3d_cs_exec_set_texture_state(struct wined3d_cs *cs, const void *data)
@@ -1732,15 +1913,15 @@ static void wined3d_cs_exec_set_texture_state(struct wined3d_cs *cs, const void
 void wined3d_cs_emit_set_texture_state(struct wined3d_cs *cs, UINT stage,
         enum wined3d_texture_stage_state state, DWORD value)
 {
-    struct wined3d_cs_set_texture_state *op;
+    struct wined3d_cs_set_texture_state op;
 
-    op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
-    op->opcode = WINED3D_CS_OP_SET_TEXTURE_STATE;
-    op->stage = stage;
-    op->state = state;
-    op->value = value;
+    op.opcode = WINED3D_CS_OP_SET_TEXTURE_STATE;
+    op.stage = stage;
+    op.state = state;
+    op.value = value;
 
-    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+    wined3d_cs_emit_state(cs, WINED3D_CS_KEY_TEXTURE_STATE + stage * (WINED3D_HIGHEST_TEXTURE_STATE + 1) + state,
+            &op, sizeof(op));
 }
 
 static void wined3d_cs_exec_set_sampler_state(struct wined3d_cs *cs, const void *data)
@@ -1754,15 +1935,15 @@ static void wined3d_cs_exec_set_sampler_state(struct wined3d_cs *cs, const void
 void wined3d_cs_emit_set_sampler_state(struct wined3d_cs *cs, UINT sampler_idx,
         enum wined3d_sampler_state state, DWORD value)
 {
-    struct wined3d_cs_set_sampler_state *op;
+    struct wined3d_cs_set_sampler_state op;
 
-    op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
-    op->opcode = WINED3D_CS_OP_SET_SAMPLER_STATE;
-    op->sampler_idx = sampler_idx;
-    op->state = state;
-    op->value = value;
+    op.opcode = WINED3D_CS_OP_SET_SAMPLER_STATE;
+    op.sampler_idx = sampler_idx;
+    op.state = state;
+    op.value = value;
 
-    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+    wined3d_cs_emit_state(cs, WINED3D_CS_KEY_SAMPLER_STATE + sampler_idx * (WINED3D_HIGHEST_SAMPLER_STATE + 1) + state,
+            &op, sizeof(op));
 }
 
 static void wined3d_cs_exec_set_transform(struct wined3d_cs *cs, const void *data)
@@ -1779,12 +1960,13 @@ void wined3d_cs_emit_set_transform(struct wined3d_cs *cs, enum wined3d_transform
 {
     struct wined3d_cs_set_transform *op;
 
-    op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
+    if (!(op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT)))
+        return;
     op->opcode = WINED3D_CS_OP_SET_TRANSFORM;
     op->state = state;
     op->matrix = *matrix;
 
-    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+    wined3d_cs_submit(cs, op, WINED3D_CS_QUEUE_DEFAULT);
 }
 
 static void wined3d_cs_exec_set_clip_plane(struct wined3d_cs *cs, const void *data)
@@ -1799,12 +1981,13 @@ void wined3d_cs_emit_set_clip_plane(struct wined3d_cs *cs, UINT plane_idx, const
 {
     struct wined3d_cs_set_clip_plane *op;
 
-    op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
+    if (!(op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT)))
+        return;
     op->opcode = WINED3D_CS_OP_SET_CLIP_PLANE;
     op->plane_idx = plane_idx;
     op->plane = *plane;
 
-    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+    wined3d_cs_submit(cs, op, WINED3D_CS_QUEUE_DEFAULT);
 }
 
 static void wined3d_cs_exec_set_color_key(struct wined3d_cs *cs, const void *data)
@@ -1875,7 +2058,8 @@ void wined3d_cs_emit_set_color_key(struct wined3d_cs *cs, struct wined3d_texture
 {
     struct wined3d_cs_set_color_key *op;
 
-    op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
+    if (!(op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT)))
+        return;
     op->opcode = WINED3D_CS_OP_SET_COLOR_KEY;
     op->texture = texture;
     op->flags = flags;
@@ -1887,7 +2071,7 @@ void wined3d_cs_emit_set_color_key(struct wined3d_cs *cs, struct wined3d_texture
     else
         op->set = 0;
 
-    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+    wined3d_cs_submit(cs, op, WINED3D_CS_QUEUE_DEFAULT);
 }
 
 static void wined3d_cs_exec_set_material(struct wined3d_cs *cs, const void *data)
@@ -1902,11 +2086,12 @@ void wined3d_cs_emit_set_material(struct wined3d_cs *cs, const struct wined3d_ma
 {
     struct wined3d_cs_set_material *op;
 
-    op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
+    if (!(op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT)))
+        return;
     op->opcode = WINED3D_CS_OP_SET_MATERIAL;
     op->material = *material;
 
-    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+    wined3d_cs_submit(cs, op, WINED3D_CS_QUEUE_DEFAULT);
 }
 
 static void wined3d_cs_exec_set_light(struct wined3d_cs *cs, const void *data)
@@ -1950,11 +2135,12 @@ void wined3d_cs_emit_set_light(struct wined3d_cs *cs, const struct wined3d_light
 {
     struct wined3d_cs_set_light *op;
 
-    op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
+    if (!(op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT)))
+        return;
     op->opcode = WINED3D_CS_OP_SET_LIGHT;
     op->light = *light;
 
-    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+    wined3d_cs_submit(cs, op, WINED3D_CS_QUEUE_DEFAULT);
 }
 
 static void wined3d_cs_exec_set_light_enable(struct wined3d_cs *cs, const void *data)
@@ -1983,12 +2169,13 @@ void wined3d_cs_emit_set_light_enable(struct wined3d_cs *cs, unsigned int idx, B
 {
     struct wined3d_cs_set_light_enable *op;
 
-    op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
+    if (!(op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT)))
+        return;
     op->opcode = WINED3D_CS_OP_SET_LIGHT_ENABLE;
     op->idx = idx;
     op->enable = enable;
 
-    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+    wined3d_cs_submit(cs, op, WINED3D_CS_QUEUE_DEFAULT);
 }
 
 static const struct
@@ -2048,34 +2235,96 @@ static void wined3d_cs_mt_push_constants(struct wined3d_cs *cs, enum wined3d_pus
     size_t size;
 
     size = count * wined3d_cs_push_constant_info[p].size;
-    op = wined3d_cs_require_space(cs, FIELD_OFFSET(struct wined3d_cs_push_constants, constants[size]),
-            WINED3D_CS_QUEUE_DEFAULT);
+    if (!(op = wined3d_cs_require_space(cs, FIELD_OFFSET(struct wined3d_cs_push_constants, constants[size]),
+            WINED3D_CS_QUEUE_DEFAULT)))
+        return;
     op->opcode = WINED3D_CS_OP_PUSH_CONSTANTS;
     op->type = p;
     op->start_idx = start_idx;
     op->count = count;
     memcpy(op->constants, constants, size);
 
-    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+    wined3d_cs_submit(cs, op, WINED3D_CS_QUEUE_DEFAULT);
 }
 
 static void wined3d_cs_exec_reset_state(struct wined3d_cs *cs, const void *data)
 {
+    const struct wined3d_cs_reset_state *op = data;
     struct wined3d_adapter *adapter = cs->device->adapter;
+    struct wined3d_state *state = &cs->state;
+    unsigned int i, j;
 
-    state_cleanup(&cs->state);
-    memset(&cs->state, 0, sizeof(cs->state));
-    state_init(&cs->state, &adapter->d3d_info, WINED3D_STATE_NO_REF | WINED3D_STATE_INIT_DEFAULT);
+    /* When the device is reset or unloaded, all of its state is about to be
+     * reinitialised anyway. Resetting the state in the middle of rendering,
+     * e.g. for ClearState() or ExecuteCommandList(), needs to drop the bind
+     * counts taken by the set handlers above, and to invalidate the state
+     * applied to the GL/Vulkan context. */
+    if (op->invalidate)
+    {
+        for (i = 0; i < ARRAY_SIZE(state->streams); ++i)
+        {
+            if (state->streams[i].buffer)
+                InterlockedDecrement(&state->streams[i].buffer->resource.bind_count);
+        }
+        for (i = 0; i < ARRAY_SIZE(state->stream_output); ++i)
+        {
+            if (state->stream_output[i].buffer)
+                InterlockedDecrement(&state->stream_output[i].buffer->resource.bind_count);
+        }
+        if (state->index_buffer)
+            InterlockedDecrement(&state->index_buffer->resource.bind_count);
+        for (i = 0; i < ARRAY_SIZE(state->textures); ++i)
+        {
+            if (state->textures[i])
+                InterlockedDecrement(&state->textures[i]->resource.bind_count);
+        }
+        for (i = 0; i < WINED3D_SHADER_TYPE_COUNT; ++i)
+        {
+            for (j = 0; j < ARRAY_SIZE(state->cb[i]); ++j)
+            {
+                if (state->cb[i][j])
+                    InterlockedDecrement(&state->cb[i][j]->resource.bind_count);
+            }
+            for (j = 0; j < ARRAY_SIZE(state->shader_resource_view[i]); ++j)
+            {
+                if (state->shader_resource_view[i][j])
+                    InterlockedDecrement(&state->shader_resource_view[i][j]->resource->bind_count);
+            }
+        }
+        for (i = 0; i < WINED3D_PIPELINE_COUNT; ++i)
+        {
+            for (j = 0; j < ARRAY_SIZE(state->unordered_access_view[i]); ++j)
+            {
+                if (state->unordered_access_view[i][j])
+                    InterlockedDecrement(&state->unordered_access_view[i][j]->resource->bind_count);
+            }
+        }
+    }
+
+    state_cleanup(state);
+    memset(state, 0, sizeof(*state));
+    state_init(state, &adapter->d3d_info, WINED3D_STATE_NO_REF | WINED3D_STATE_INIT_DEFAULT);
+
+    if (op->invalidate)
+    {
+        for (i = 0; i <= STATE_HIGHEST; ++i)
+        {
+            if (STATE_IS_COMPUTE(i) || cs->device->state_table[i].representative)
+                device_invalidate_state(cs->device, i);
+        }
+    }
 }
 
-void wined3d_cs_emit_reset_state(struct wined3d_cs *cs)
+void wined3d_cs_emit_reset_state(struct wined3d_cs *cs, bool invalidate)
 {
     struct wined3d_cs_reset_state *op;
 
-    op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
+    if (!(op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT)))
+        return;
     op->opcode = WINED3D_CS_OP_RESET_STATE;
+    op->invalidate = invalidate;
 
-    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+    wined3d_cs_submit(cs, op, WINED3D_CS_QUEUE_DEFAULT);
 }
 
 static void wined3d_cs_exec_callback(struct wined3d_cs *cs, const void *data)
@@ -2089,12 +2338,15 @@ static void wined3d_cs_emit_callback(struct wined3d_cs *cs, void (*callback)(voi
 {
     struct wined3d_cs_callback *op;
 
-    op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
+    /* The object may still be bound to the command stream state until a
+     * pending state change unbinds it, so pending states are queued first. */
+    if (!(op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT)))
+        return;
     op->opcode = WINED3D_CS_OP_CALLBACK;
     op->callback = callback;
     op->object = object;
 
-    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+    cs->ops->submit(cs, op, WINED3D_CS_QUEUE_DEFAULT);
 }
 
 void wined3d_cs_destroy_object(struct wined3d_cs *cs, void (*callback)(void *object), void *object)
@@ -2153,12 +2405,13 @@ void wined3d_cs_emit_query_issue(struct wined3d_cs *cs, struct wined3d_query *qu
 {
     struct wined3d_cs_query_issue *op;
 
-    op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
+    if (!(op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT)))
+        return;
     op->opcode = WINED3D_CS_OP_QUERY_ISSUE;
     op->query = query;
     op->flags = flags;
 
-    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+    wined3d_cs_submit(cs, op, WINED3D_CS_QUEUE_DEFAULT);
     cs->queries_flushed = FALSE;
 }
 
@@ -2175,13 +2428,14 @@ void wined3d_cs_emit_preload_resource(struct wined3d_cs *cs, struct wined3d_reso
 {
     struct wined3d_cs_preload_resource *op;
 
-    op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
+    if (!(op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT)))
+        return;
     op->opcode = WINED3D_CS_OP_PRELOAD_RESOURCE;
     op->resource = resource;
 
-    wined3d_resource_acquire(resource);
+    wined3d_cs_acquire_resource(cs, resource);
 
-    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+    wined3d_cs_submit(cs, op, WINED3D_CS_QUEUE_DEFAULT);
 }
 
 static void wined3d_cs_exec_unload_resource(struct wined3d_cs *cs, const void *data)
@@ -2197,13 +2451,14 @@ void wined3d_cs_emit_unload_resource(struct wined3d_cs *cs, struct wined3d_resou
 {
     struct wined3d_cs_unload_resource *op;
 
-    op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
+    if (!(op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT)))
+        return;
     op->opcode = WINED3D_CS_OP_UNLOAD_RESOURCE;
     op->resource = resource;
 
-    wined3d_resource_acquire(resource);
+    wined3d_cs_acquire_resource(cs, resource);
 
-    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+    wined3d_cs_submit(cs, op, WINED3D_CS_QUEUE_DEFAULT);
 }
 
 static void wined3d_cs_exec_map(struct wined3d_cs *cs, const void *data)
@@ -2218,6 +2473,7 @@ static void wined3d_cs_exec_map(struct wined3d_cs *cs, const void *data)
 HRESULT wined3d_cs_map(struct wined3d_cs *cs, struct wined3d_resource *resource, unsigned int sub_resource_idx,
         struct wined3d_map_desc *map_desc, const struct wined3d_box *box, unsigned int flags)
 {
+    LONGLONG start = 0;
     struct wined3d_cs_map *op;
     HRESULT hr;
 
@@ -2225,7 +2481,11 @@ HRESULT wined3d_cs_map(struct wined3d_cs *cs, struct wined3d_resource *resource,
      * increasing the map count would be visible to applications. */
     wined3d_not_from_cs(cs);
 
-    op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_MAP);
+    if (wined3d_settings.frame_stats)
+        start = wined3d_frame_stats_time();
+
+    if (!(op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_MAP)))
+        return E_OUTOFMEMORY;
     op->opcode = WINED3D_CS_OP_MAP;
     op->resource = resource;
     op->sub_resource_idx = sub_resource_idx;
@@ -2234,9 +2494,15 @@ HRESULT wined3d_cs_map(struct wined3d_cs *cs, struct wined3d_resource *resource,
     op->flags = flags;
     op->hr = &hr;
 
-    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_MAP);
+    wined3d_cs_submit(cs, op, WINED3D_CS_QUEUE_MAP);
     wined3d_cs_finish(cs, WINED3D_CS_QUEUE_MAP);
 
+    if (wined3d_settings.frame_stats)
+    {
+        wined3d_frame_stats_add(WINED3D_FRAME_COUNTER_MAPS, 1);
+        wined3d_frame_stats_add(WINED3D_FRAME_COUNTER_MAP_WAIT_TIME, wined3d_frame_stats_time() - start);
+    }
+
     return hr;
 }
 
@@ -2255,13 +2521,14 @@ HRESULT wined3d_cs_unmap(struct wined3d_cs *cs, struct wined3d_resource *resourc
 
     wined3d_not_from_cs(cs);
 
-    op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_MAP);
+    if (!(op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_MAP)))
+        return E_OUTOFMEMORY;
     op->opcode = WINED3D_CS_OP_UNMAP;
     op->resource = resource;
     op->sub_resource_idx = sub_resource_idx;
     op->hr = &hr;
 
-    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_MAP);
+    wined3d_cs_submit(cs, op, WINED3D_CS_QUEUE_MAP);
     wined3d_cs_finish(cs, WINED3D_CS_QUEUE_MAP);
 
     return hr;
@@ -2375,7 +2642,8 @@ void wined3d_cs_emit_blt_sub_resource(struct wined3d_cs *cs, struct wined3d_reso
 {
     struct wined3d_cs_blt_sub_resource *op;
 
-    op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
+    if (!(op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT)))
+        return;
     op->opcode = WINED3D_CS_OP_BLT_SUB_RESOURCE;
     op->dst_resource = dst_resource;
     op->dst_sub_resource_idx = dst_sub_resource_idx;
@@ -2390,11 +2658,11 @@ void wined3d_cs_emit_blt_sub_resource(struct wined3d_cs *cs, struct wined3d_reso
         memset(&op->fx, 0, sizeof(op->fx));
     op->filter = filter;
 
-    wined3d_resource_acquire(dst_resource);
+    wined3d_cs_acquire_resource(cs, dst_resource);
     if (src_resource)
-        wined3d_resource_acquire(src_resource);
+        wined3d_cs_acquire_resource(cs, src_resource);
 
-    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+    wined3d_cs_submit(cs, op, WINED3D_CS_QUEUE_DEFAULT);
     if (flags & WINED3D_BLT_SYNCHRONOUS)
         wined3d_cs_finish(cs, WINED3D_CS_QUEUE_DEFAULT);
 }
@@ -2458,13 +2726,70 @@ done:
     wined3d_resource_release(resource);
 }
 
+/* Command lists may be executed after the application changed or freed the
+ * data, so deferred contexts keep their own copy. */
+static const void *wined3d_cs_deferred_copy_data(struct wined3d_cs *cs, struct wined3d_resource *resource,
+        const struct wined3d_box *box, const void *data, unsigned int row_pitch, unsigned int slice_pitch)
+{
+    struct wined3d_deferred_context *context = CONTAINING_RECORD(cs, struct wined3d_deferred_context, cs);
+    unsigned int row_size, rows_size, size;
+    void *copy;
+
+    if (resource->type == WINED3D_RTYPE_BUFFER)
+    {
+        size = box->right - box->left;
+    }
+    else
+    {
+        wined3d_format_calculate_pitch(resource->format, 1, box->right - box->left,
+                box->bottom - box->top, &row_size, &rows_size);
+        size = (box->back - box->front - 1) * slice_pitch
+                + (rows_size / row_size - 1) * row_pitch + row_size;
+    }
+
+    if (!wined3d_array_reserve((void **)&context->uploads, &context->uploads_size,
+            context->upload_count + 1, sizeof(*context->uploads))
+            || !(copy = heap_alloc(size)))
+    {
+        context->hr = E_OUTOFMEMORY;
+        return NULL;
+    }
+    memcpy(copy, data, size);
+    context->uploads[context->upload_count++] = copy;
+
+    return copy;
+}
+
 void wined3d_cs_emit_update_sub_resource(struct wined3d_cs *cs, struct wined3d_resource *resource,
         unsigned int sub_resource_idx, const struct wined3d_box *box, const void *data, unsigned int row_pitch,
         unsigned int slice_pitch)
 {
     struct wined3d_cs_update_sub_resource *op;
 
-    op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_MAP);
+    if (cs->ops == &wined3d_cs_deferred_ops)
+    {
+        if (!(data = wined3d_cs_deferred_copy_data(cs, resource, box, data, row_pitch, slice_pitch)))
+        {
+            ERR("Failed to copy sub-resource data.\n");
+            return;
+        }
+
+        if (!(op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT)))
+            return;
+        op->opcode = WINED3D_CS_OP_UPDATE_SUB_RESOURCE;
+        op->resource = resource;
+        op->sub_resource_idx = sub_resource_idx;
+        op->box = *box;
+        op->data.row_pitch = row_pitch;
+        op->data.slice_pitch = slice_pitch;
+        op->data.data = data;
+
+        wined3d_cs_acquire_resource(cs, resource);
+        return;
+    }
+
+    if (!(op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_MAP)))
+        return;
     op->opcode = WINED3D_CS_OP_UPDATE_SUB_RESOURCE;
     op->resource = resource;
     op->sub_resource_idx = sub_resource_idx;
@@ -2473,9 +2798,9 @@ void wined3d_cs_emit_update_sub_resource(struct wined3d_cs *cs, struct wined3d_r
     op->data.slice_pitch = slice_pitch;
     op->data.data = data;
 
-    wined3d_resource_acquire(resource);
+    wined3d_cs_acquire_resource(cs, resource);
 
-    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_MAP);
+    wined3d_cs_submit(cs, op, WINED3D_CS_QUEUE_MAP);
     /* The data pointer may go away, so we need to wait until it is read.
      * Copying the data may be faster if it's small. */
     wined3d_cs_finish(cs, WINED3D_CS_QUEUE_MAP);
@@ -2507,14 +2832,15 @@ void wined3d_cs_emit_add_dirty_texture_region(struct wined3d_cs *cs,
 {
     struct wined3d_cs_add_dirty_texture_region *op;
 
-    op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
+    if (!(op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT)))
+        return;
     op->opcode = WINED3D_CS_OP_ADD_DIRTY_TEXTURE_REGION;
     op->texture = texture;
     op->layer = layer;
 
-    wined3d_resource_acquire(&texture->resource);
+    wined3d_cs_acquire_resource(cs, &texture->resource);
 
-    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+    wined3d_cs_submit(cs, op, WINED3D_CS_QUEUE_DEFAULT);
 }
 
 static void wined3d_cs_exec_clear_unordered_access_view(struct wined3d_cs *cs, const void *data)
@@ -2535,14 +2861,15 @@ void wined3d_cs_emit_clear_unordered_access_view_uint(struct wined3d_cs *cs,
 {
     struct wined3d_cs_clear_unordered_access_view *op;
 
-    op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
+    if (!(op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT)))
+        return;
     op->opcode = WINED3D_CS_OP_CLEAR_UNORDERED_ACCESS_VIEW;
     op->view = view;
     op->clear_value = *clear_value;
 
-    wined3d_resource_acquire(view->resource);
+    wined3d_cs_acquire_resource(cs, view->resource);
 
-    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+    wined3d_cs_submit(cs, op, WINED3D_CS_QUEUE_DEFAULT);
 }
 
 static void wined3d_cs_exec_copy_uav_counter(struct wined3d_cs *cs, const void *data)
@@ -2563,15 +2890,16 @@ void wined3d_cs_emit_copy_uav_counter(struct wined3d_cs *cs, struct wined3d_buff
 {
     struct wined3d_cs_copy_uav_counter *op;
 
-    op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
+    if (!(op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT)))
+        return;
     op->opcode = WINED3D_CS_OP_COPY_UAV_COUNTER;
     op->buffer = dst_buffer;
     op->offset = offset;
     op->view = uav;
 
-    wined3d_resource_acquire(&dst_buffer->resource);
+    wined3d_cs_acquire_resource(cs, &dst_buffer->resource);
 
-    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+    wined3d_cs_submit(cs, op, WINED3D_CS_QUEUE_DEFAULT);
 }
 
 static void wined3d_cs_exec_generate_mipmaps(struct wined3d_cs *cs, const void *data)
@@ -2587,26 +2915,147 @@ void wined3d_cs_emit_generate_mipmaps(struct wined3d_cs *cs, struct wined3d_shad
 {
     struct wined3d_cs_generate_mipmaps *op;
 
-    op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
+    if (!(op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT)))
+        return;
     op->opcode = WINED3D_CS_OP_GENERATE_MIPMAPS;
     op->view = view;
 
-    wined3d_resource_acquire(view->resource);
+    wined3d_cs_acquire_resource(cs, view->resource);
+
+    wined3d_cs_submit(cs, op, WINED3D_CS_QUEUE_DEFAULT);
+}
+
+static void wined3d_command_list_update_queries(const struct wined3d_command_list *list)
+{
+    SIZE_T i;
+
+    for (i = 0; i < list->query_issue_count; ++i)
+        wined3d_query_update_issued(list->query_issues[i].query, list->query_issues[i].flags);
+    for (i = 0; i < list->command_list_count; ++i)
+        wined3d_command_list_update_queries(list->command_lists[i]);
+}
+
+void wined3d_cs_emit_execute_command_list(struct wined3d_cs *cs, struct wined3d_command_list *list)
+{
+    struct wined3d_cs_execute_command_list *op;
+    SIZE_T i;
+
+    if (!(op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT)))
+        return;
+    op->opcode = WINED3D_CS_OP_EXECUTE_COMMAND_LIST;
+    op->list = list;
+
+    for (i = 0; i < list->resource_count; ++i)
+        wined3d_cs_acquire_resource(cs, list->resources[i]);
 
-    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+    /* Lists executed by a deferred context update their queries when the
+     * outer list is executed. */
+    if (cs->ops != &wined3d_cs_deferred_ops)
+    {
+        wined3d_command_list_update_queries(list);
+        cs->queries_flushed = FALSE;
+    }
+
+    wined3d_cs_submit(cs, op, WINED3D_CS_QUEUE_DEFAULT);
+}
+
+/* Bring the command stream state in line with "state", starting from the
+ * default state. Only the state accessible through deferred contexts is
+ * restored. */
+void wined3d_cs_emit_restore_state(struct wined3d_cs *cs, const struct wined3d_state *state)
+{
+    const struct wined3d_d3d_info *d3d_info = &cs->device->adapter->d3d_info;
+    DWORD default_render_states[WINEHIGHEST_RENDER_STATE + 1];
+    struct wined3d_rendertarget_view *view;
+    unsigned int i, j;
+
+    wined3d_cs_emit_reset_state(cs, true);
+
+    for (i = 0; i < WINED3D_SHADER_TYPE_COUNT; ++i)
+    {
+        if (state->shader[i])
+            wined3d_cs_emit_set_shader(cs, i, state->shader[i]);
+        for (j = 0; j < MAX_CONSTANT_BUFFERS; ++j)
+        {
+            if (state->cb[i][j])
+                wined3d_cs_emit_set_constant_buffer(cs, i, j, state->cb[i][j]);
+        }
+        for (j = 0; j < MAX_SHADER_RESOURCE_VIEWS; ++j)
+        {
+            if (state->shader_resource_view[i][j])
+                wined3d_cs_emit_set_shader_resource_view(cs, i, j, state->shader_resource_view[i][j]);
+        }
+        for (j = 0; j < MAX_SAMPLER_OBJECTS; ++j)
+        {
+            if (state->sampler[i][j])
+                wined3d_cs_emit_set_sampler(cs, i, j, state->sampler[i][j]);
+        }
+    }
+
+    for (i = 0; i < WINED3D_PIPELINE_COUNT; ++i)
+    {
+        for (j = 0; j < MAX_UNORDERED_ACCESS_VIEWS; ++j)
+        {
+            if (state->unordered_access_view[i][j])
+                wined3d_cs_emit_set_unordered_access_view(cs, i, j, state->unordered_access_view[i][j], ~0u);
+        }
+    }
+
+    for (i = 0; i < d3d_info->limits.max_rt_count; ++i)
+    {
+        if ((view = state->fb.render_targets[i]))
+            wined3d_cs_emit_set_rendertarget_view(cs, i, view);
+    }
+    if ((view = state->fb.depth_stencil))
+        wined3d_cs_emit_set_depth_stencil_view(cs, view);
+
+    if (state->vertex_declaration)
+        wined3d_cs_emit_set_vertex_declaration(cs, state->vertex_declaration);
+    for (i = 0; i < ARRAY_SIZE(state->streams); ++i)
+    {
+        if (state->streams[i].buffer)
+            wined3d_cs_emit_set_stream_source(cs, i, state->streams[i].buffer,
+                    state->streams[i].offset, state->streams[i].stride);
+    }
+    for (i = 0; i < ARRAY_SIZE(state->stream_output); ++i)
+    {
+        if (state->stream_output[i].buffer)
+            wined3d_cs_emit_set_stream_output(cs, i, state->stream_output[i].buffer, state->stream_output[i].offset);
+    }
+    if (state->index_buffer)
+        wined3d_cs_emit_set_index_buffer(cs, state->index_buffer, state->index_format, state->index_offset);
+
+    wined3d_cs_emit_set_blend_state(cs, state->blend_state, &state->blend_factor, state->sample_mask);
+    wined3d_cs_emit_set_depth_stencil_state(cs, state->depth_stencil_state);
+    wined3d_cs_emit_set_rasterizer_state(cs, state->rasterizer_state);
+    wined3d_cs_emit_set_viewports(cs, state->viewport_count, state->viewports);
+    wined3d_cs_emit_set_scissor_rects(cs, state->scissor_rect_count, state->scissor_rects);
+    if (state->predicate)
+        wined3d_cs_emit_set_predication(cs, state->predicate, state->predicate_value);
+
+    init_default_render_states(default_render_states, d3d_info);
+    for (i = 0; i <= WINEHIGHEST_RENDER_STATE; ++i)
+    {
+        if (state->render_states[i] != default_render_states[i])
+            wined3d_cs_emit_set_render_state(cs, i, state->render_states[i]);
+    }
 }
 
 static void wined3d_cs_emit_stop(struct wined3d_cs *cs)
 {
     struct wined3d_cs_stop *op;
 
-    op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT);
+    if (!(op = wined3d_cs_require_space(cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT)))
+        return;
     op->opcode = WINED3D_CS_OP_STOP;
 
-    wined3d_cs_submit(cs, WINED3D_CS_QUEUE_DEFAULT);
+    wined3d_cs_submit(cs, op, WINED3D_CS_QUEUE_DEFAULT);
     wined3d_cs_finish(cs, WINED3D_CS_QUEUE_DEFAULT);
 }
 
+static void wined3d_cs_exec_set_states(struct wined3d_cs *cs, const void *data);
+static void wined3d_cs_exec_execute_command_list(struct wined3d_cs *cs, const void *data);
+
 static void (* const wined3d_cs_op_handlers[])(struct wined3d_cs *cs, const void *data) =
 {
     /* WINED3D_CS_OP_NOP                         */ wined3d_cs_exec_nop,
@@ -2637,6 +3086,7 @@ static void (* const wined3d_cs_op_handlers[])(struct wined3d_cs *cs, const void
     /* WINED3D_CS_OP_SET_RENDER_STATE            */ wined3d_cs_exec_set_render_state,
     /* WINED3D_CS_OP_SET_TEXTURE_STATE           */ wined3d_cs_exec_set_texture_state,
     /* WINED3D_CS_OP_SET_SAMPLER_STATE           */ wined3d_cs_exec_set_sampler_state,
+    /* WINED3D_CS_OP_SET_STATES                  */ wined3d_cs_exec_set_states,
     /* WINED3D_CS_OP_SET_TRANSFORM               */ wined3d_cs_exec_set_transform,
     /* WINED3D_CS_OP_SET_CLIP_PLANE              */ wined3d_cs_exec_set_clip_plane,
     /* WINED3D_CS_OP_SET_COLOR_KEY               */ wined3d_cs_exec_set_color_key,
@@ -2657,8 +3107,44 @@ static void (* const wined3d_cs_op_handlers[])(struct wined3d_cs *cs, const void
     /* WINED3D_CS_OP_CLEAR_UNORDERED_ACCESS_VIEW */ wined3d_cs_exec_clear_unordered_access_view,
     /* WINED3D_CS_OP_COPY_UAV_COUNTER            */ wined3d_cs_exec_copy_uav_counter,
     /* WINED3D_CS_OP_GENERATE_MIPMAPS            */ wined3d_cs_exec_generate_mipmaps,
+    /* WINED3D_CS_OP_EXECUTE_COMMAND_LIST        */ wined3d_cs_exec_execute_command_list,
 };
 
+static void wined3d_cs_exec_set_states(struct wined3d_cs *cs, const void *data)
+{
+    const struct wined3d_cs_set_states *op = data;
+    unsigned int i;
+
+    for (i = 0; i < op->count; ++i)
+    {
+        wined3d_cs_count_op(cs, op->ops[i].opcode);
+        wined3d_cs_op_handlers[op->ops[i].opcode](cs, &op->ops[i]);
+    }
+}
+
+static void wined3d_cs_exec_execute_command_list(struct wined3d_cs *cs, const void *data)
+{
+    const struct wined3d_cs_execute_command_list *op = data;
+    const struct wined3d_command_list *list = op->list;
+    const struct wined3d_cs_packet *packet;
+    enum wined3d_cs_op opcode;
+    SIZE_T start;
+
+    for (start = 0; start < list->data_size; start += FIELD_OFFSET(struct wined3d_cs_packet, data[packet->size]))
+    {
+        packet = (const struct wined3d_cs_packet *)((const BYTE *)list->data + start);
+        opcode = *(const enum wined3d_cs_op *)packet->data;
+
+        if (opcode >= WINED3D_CS_OP_STOP)
+        {
+            ERR("Invalid opcode %#x.\n", opcode);
+            return;
+        }
+        wined3d_cs_count_op(cs, opcode);
+        wined3d_cs_op_handlers[opcode](cs, packet->data);
+    }
+}
+
 static void *wined3d_cs_st_require_space(struct wined3d_cs *cs, size_t size, enum wined3d_cs_queue_id queue_id)
 {
     if (size > (cs->data_size - cs->end))
@@ -2672,7 +3158,10 @@ static void *wined3d_cs_st_require_space(struct wined3d_cs *cs, size_t size, enu
         else
             new_data = heap_alloc(new_size);
         if (!new_data)
+        {
+            ERR("Failed to allocate %lu bytes.\n", (unsigned long)new_size);
             return NULL;
+        }
 
         cs->data_size = new_size;
         cs->start = cs->end = 0;
@@ -2684,7 +3173,7 @@ static void *wined3d_cs_st_require_space(struct wined3d_cs *cs, size_t size, enu
     return (BYTE *)cs->data + cs->start;
 }
 
-static void wined3d_cs_st_submit(struct wined3d_cs *cs, enum wined3d_cs_queue_id queue_id)
+static void wined3d_cs_st_submit(struct wined3d_cs *cs, void *op, enum wined3d_cs_queue_id queue_id)
 {
     enum wined3d_cs_op opcode;
     size_t start;
@@ -2696,9 +3185,14 @@ static void wined3d_cs_st_submit(struct wined3d_cs *cs, enum wined3d_cs_queue_id
 
     opcode = *(const enum wined3d_cs_op *)&data[start];
     if (opcode >= WINED3D_CS_OP_STOP)
+    {
         ERR("Invalid opcode %#x.\n", opcode);
+    }
     else
+    {
+        wined3d_cs_count_op(cs, opcode);
         wined3d_cs_op_handlers[opcode](cs, &data[start]);
+    }
 
     if (cs->data == data)
         cs->start = cs->end = start;
@@ -2708,6 +3202,12 @@ static void wined3d_cs_st_submit(struct wined3d_cs *cs, enum wined3d_cs_queue_id
 
 static void wined3d_cs_st_finish(struct wined3d_cs *cs, enum wined3d_cs_queue_id queue_id)
 {
+    wined3d_cs_queue_pending_states(cs);
+}
+
+static void wined3d_cs_st_acquire_resource(struct wined3d_cs *cs, struct wined3d_resource *resource)
+{
+    wined3d_resource_acquire(resource);
 }
 
 static const struct wined3d_cs_ops wined3d_cs_st_ops =
@@ -2716,6 +3216,7 @@ static const struct wined3d_cs_ops wined3d_cs_st_ops =
     wined3d_cs_st_submit,
     wined3d_cs_st_finish,
     wined3d_cs_st_push_constants,
+    wined3d_cs_st_acquire_resource,
 };
 
 static BOOL wined3d_cs_queue_is_empty(const struct wined3d_cs *cs, const struct wined3d_cs_queue *queue)
@@ -2724,32 +3225,42 @@ static BOOL wined3d_cs_queue_is_empty(const struct wined3d_cs *cs, const struct
     return *(volatile LONG *)&queue->head == queue->tail;
 }
 
-static void wined3d_cs_queue_submit(struct wined3d_cs_queue *queue, struct wined3d_cs *cs)
+/* Publish the packet at "start", once all packets reserved before it have
+ * been published. */
+static void wined3d_cs_queue_publish(struct wined3d_cs_queue *queue, struct wined3d_cs *cs,
+        LONG start, size_t packet_size)
 {
-    struct wined3d_cs_packet *packet;
-    size_t packet_size;
-
-    packet = (struct wined3d_cs_packet *)&queue->data[queue->head];
-    packet_size = FIELD_OFFSET(struct wined3d_cs_packet, data[packet->size]);
-    InterlockedExchange(&queue->head, (queue->head + packet_size) & (WINED3D_CS_QUEUE_SIZE - 1));
+    while (*(volatile LONG *)&queue->head != start)
+        wined3d_pause();
+    InterlockedExchange(&queue->head, (start + packet_size) & (WINED3D_CS_QUEUE_SIZE - 1));
 
     if (InterlockedCompareExchange(&cs->waiting_for_event, FALSE, TRUE))
         SetEvent(cs->event);
 }
 
-static void wined3d_cs_mt_submit(struct wined3d_cs *cs, enum wined3d_cs_queue_id queue_id)
+static void wined3d_cs_queue_submit(struct wined3d_cs_queue *queue, struct wined3d_cs *cs, void *data)
+{
+    struct wined3d_cs_packet *packet;
+
+    packet = CONTAINING_RECORD(data, struct wined3d_cs_packet, data);
+    wined3d_cs_queue_publish(queue, cs, (BYTE *)packet - queue->data,
+            FIELD_OFFSET(struct wined3d_cs_packet, data[packet->size]));
+}
+
+static void wined3d_cs_mt_submit(struct wined3d_cs *cs, void *data, enum wined3d_cs_queue_id queue_id)
 {
     if (cs->thread_id == GetCurrentThreadId())
-        return wined3d_cs_st_submit(cs, queue_id);
+        return wined3d_cs_st_submit(cs, data, queue_id);
 
-    wined3d_cs_queue_submit(&cs->queue[queue_id], cs);
+    wined3d_cs_queue_submit(&cs->queue[queue_id], cs, data);
 }
 
 static void *wined3d_cs_queue_require_space(struct wined3d_cs_queue *queue, size_t size, struct wined3d_cs *cs)
 {
     size_t queue_size = ARRAY_SIZE(queue->data);
-    size_t header_size, packet_size, remaining;
+    size_t header_size, packet_size, nop_size;
     struct wined3d_cs_packet *packet;
+    LONG start, tail, used, end;
 
     header_size = FIELD_OFFSET(struct wined3d_cs_packet, data[0]);
     packet_size = FIELD_OFFSET(struct wined3d_cs_packet, data[size]);
@@ -2762,47 +3273,45 @@ static void *wined3d_cs_queue_require_space(struct wined3d_cs_queue *queue, size
         return NULL;
     }
 
-    remaining = queue_size - queue->head;
-    if (remaining < packet_size)
+    /* Claim the space with a single compare-and-swap. Packets don't wrap
+     * around the end of the queue; if the packet doesn't fit before the end,
+     * the rest of the queue is claimed as well, and filled with a nop. The
+     * tail is read after "reserved", so it can't be ahead of "start". */
+    for (;;)
     {
-        size_t nop_size = remaining - header_size;
-        struct wined3d_cs_nop *nop;
+        start = *(volatile LONG *)&queue->reserved;
+        tail = *(volatile LONG *)&queue->tail;
+        used = (start - tail) & (WINED3D_CS_QUEUE_SIZE - 1);
 
-        TRACE("Inserting a nop for %lu + %lu bytes.\n",
-                (unsigned long)header_size, (unsigned long)nop_size);
-
-        nop = wined3d_cs_queue_require_space(queue, nop_size, cs);
-        if (nop_size)
-            nop->opcode = WINED3D_CS_OP_NOP;
+        nop_size = queue_size - start < packet_size ? queue_size - start : 0;
+        /* Never make "reserved" equal to the tail; that means empty. */
+        if (nop_size + packet_size < queue_size - used)
+        {
+            end = (start + nop_size + packet_size) & (WINED3D_CS_QUEUE_SIZE - 1);
+            if (InterlockedCompareExchange(&queue->reserved, end, start) == start)
+                break;
+            continue;
+        }
 
-        wined3d_cs_queue_submit(queue, cs);
-        assert(!queue->head);
+        TRACE("Waiting for free space. Reserved %u, tail %u, packet size %lu.\n",
+                start, tail, (unsigned long)packet_size);
+        wined3d_pause();
     }
 
-    for (;;)
+    if (nop_size)
     {
-        LONG tail = *(volatile LONG *)&queue->tail;
-        LONG head = queue->head;
-        LONG new_pos;
-
-        /* Empty. */
-        if (head == tail)
-            break;
-        new_pos = (head + packet_size) & (WINED3D_CS_QUEUE_SIZE - 1);
-        /* Head ahead of tail. We checked the remaining size above, so we only
-         * need to make sure we don't make head equal to tail. */
-        if (head > tail && (new_pos != tail))
-            break;
-        /* Tail ahead of head. Make sure the new head is before the tail as
-         * well. Note that new_pos is 0 when it's at the end of the queue. */
-        if (new_pos < tail && new_pos)
-            break;
+        TRACE("Inserting a nop for %lu + %lu bytes.\n",
+                (unsigned long)header_size, (unsigned long)(nop_size - header_size));
 
-        TRACE("Waiting for free space. Head %u, tail %u, packet size %lu.\n",
-                head, tail, (unsigned long)packet_size);
+        packet = (struct wined3d_cs_packet *)&queue->data[start];
+        packet->size = nop_size - header_size;
+        if (packet->size)
+            *(enum wined3d_cs_op *)packet->data = WINED3D_CS_OP_NOP;
+        wined3d_cs_queue_publish(queue, cs, start, nop_size);
+        start = 0;
     }
 
-    packet = (struct wined3d_cs_packet *)&queue->data[queue->head];
+    packet = (struct wined3d_cs_packet *)&queue->data[start];
     packet->size = size;
     return packet->data;
 }
@@ -2820,6 +3329,7 @@ static void wined3d_cs_mt_finish(struct wined3d_cs *cs, enum wined3d_cs_queue_id
     if (cs->thread_id == GetCurrentThreadId())
         return wined3d_cs_st_finish(cs, queue_id);
 
+    wined3d_cs_queue_pending_states(cs);
     while (cs->queue[queue_id].head != *(volatile LONG *)&cs->queue[queue_id].tail)
         wined3d_pause();
 }
@@ -2830,6 +3340,77 @@ static const struct wined3d_cs_ops wined3d_cs_mt_ops =
     wined3d_cs_mt_submit,
     wined3d_cs_mt_finish,
     wined3d_cs_mt_push_constants,
+    wined3d_cs_st_acquire_resource,
+};
+
+/* Deferred contexts append packets to a private buffer, which becomes the
+ * data of the next command list. The packets use the same layout as the
+ * queues of the multithreaded command stream. */
+static void *wined3d_cs_deferred_require_space(struct wined3d_cs *cs,
+        size_t size, enum wined3d_cs_queue_id queue_id)
+{
+    size_t header_size, packet_size;
+    struct wined3d_cs_packet *packet;
+
+    header_size = FIELD_OFFSET(struct wined3d_cs_packet, data[0]);
+    packet_size = FIELD_OFFSET(struct wined3d_cs_packet, data[size]);
+    packet_size = (packet_size + header_size - 1) & ~(header_size - 1);
+
+    if (packet_size > cs->data_size - cs->end)
+    {
+        size_t new_size;
+        void *new_data;
+
+        new_size = max(cs->end + packet_size, cs->data_size * 2);
+        if (!(new_data = heap_realloc(cs->data, new_size)))
+        {
+            ERR("Failed to grow command buffer to %lu bytes.\n", (unsigned long)new_size);
+            CONTAINING_RECORD(cs, struct wined3d_deferred_context, cs)->hr = E_OUTOFMEMORY;
+            return NULL;
+        }
+
+        cs->data_size = new_size;
+        cs->data = new_data;
+    }
+
+    packet = (struct wined3d_cs_packet *)((BYTE *)cs->data + cs->end);
+    packet->size = packet_size - header_size;
+    cs->end += packet_size;
+
+    return packet->data;
+}
+
+static void wined3d_cs_deferred_submit(struct wined3d_cs *cs, void *data, enum wined3d_cs_queue_id queue_id)
+{
+}
+
+static void wined3d_cs_deferred_finish(struct wined3d_cs *cs, enum wined3d_cs_queue_id queue_id)
+{
+}
+
+/* Resources are only acquired when the command list is executed. */
+static void wined3d_cs_deferred_acquire_resource(struct wined3d_cs *cs, struct wined3d_resource *resource)
+{
+    struct wined3d_deferred_context *context = CONTAINING_RECORD(cs, struct wined3d_deferred_context, cs);
+
+    if (!wined3d_array_reserve((void **)&context->resources, &context->resources_size,
+            context->resource_count + 1, sizeof(*context->resources)))
+    {
+        ERR("Failed to reserve memory.\n");
+        context->hr = E_OUTOFMEMORY;
+        return;
+    }
+
+    context->resources[context->resource_count++] = resource;
+}
+
+static const struct wined3d_cs_ops wined3d_cs_deferred_ops =
+{
+    wined3d_cs_deferred_require_space,
+    wined3d_cs_deferred_submit,
+    wined3d_cs_deferred_finish,
+    wined3d_cs_mt_push_constants,
+    wined3d_cs_deferred_acquire_resource,
 };
 
 static void poll_queries(struct wined3d_cs *cs)
@@ -2849,6 +3430,8 @@ static void poll_queries(struct wined3d_cs *cs)
 
 static void wined3d_cs_wait_event(struct wined3d_cs *cs)
 {
+    LONGLONG start;
+
     InterlockedExchange(&cs->waiting_for_event, TRUE);
 
     /* The main thread might have enqueued a command and blocked on it after
@@ -2863,7 +3446,16 @@ static void wined3d_cs_wait_event(struct wined3d_cs *cs)
             && InterlockedCompareExchange(&cs->waiting_for_event, FALSE, TRUE))
         return;
 
+    if (!cs->frame_stats)
+    {
+        WaitForSingleObject(cs->event, INFINITE);
+        return;
+    }
+
+    start = wined3d_frame_stats_time();
     WaitForSingleObject(cs->event, INFINITE);
+    wined3d_frame_stats_add(WINED3D_FRAME_COUNTER_CS_WAITS, 1);
+    wined3d_frame_stats_add(WINED3D_FRAME_COUNTER_CS_WAIT_TIME, wined3d_frame_stats_time() - start);
 }
 
 static DWORD WINAPI wined3d_cs_run(void *ctx)
@@ -2920,6 +3512,15 @@ static DWORD WINAPI wined3d_cs_run(void *ctx)
                 break;
             }
 
+            if (cs->frame_stats)
+            {
+                LONG fill = (*(volatile LONG *)&queue->head - tail) & (WINED3D_CS_QUEUE_SIZE - 1);
+
+                ++cs->frame.op_counts[opcode];
+                if (fill > cs->frame.counters[WINED3D_FRAME_COUNTER_CS_QUEUE_FILL])
+                    cs->frame.counters[WINED3D_FRAME_COUNTER_CS_QUEUE_FILL] = fill;
+            }
+
             wined3d_cs_op_handlers[opcode](cs, packet->data);
             TRACE("%s executed.\n", debug_cs_op(opcode));
         }
@@ -2952,6 +3553,8 @@ struct wined3d_cs *wined3d_cs_create(struct wined3d_device *device)
     if (!(cs->data = heap_alloc(cs->data_size)))
         goto fail;
 
+    wined3d_frame_stats_init(cs);
+
     if (wined3d_settings.cs_multithreaded
             && !RtlIsCriticalSectionLockedByThread(NtCurrentTeb()->Peb->LoaderLock))
     {
@@ -2986,6 +3589,7 @@ struct wined3d_cs *wined3d_cs_create(struct wined3d_device *device)
     return cs;
 
 fail:
+    wined3d_frame_stats_cleanup(cs);
     state_cleanup(&cs->state);
     heap_free(cs);
     return NULL;
@@ -3001,7 +3605,386 @@ void wined3d_cs_destroy(struct wined3d_cs *cs)
             ERR("Closing event failed.\n");
     }
 
+    wined3d_frame_stats_cleanup(cs);
     state_cleanup(&cs->state);
     heap_free(cs->data);
     heap_free(cs);
 }
+
+static inline struct wined3d_deferred_context *wined3d_deferred_context_from_context(
+        struct wined3d_device_context *context)
+{
+    return CONTAINING_RECORD(context, struct wined3d_deferred_context, c);
+}
+
+static struct wined3d_deferred_map *wined3d_deferred_context_find_map(struct wined3d_deferred_context *context,
+        const struct wined3d_resource *resource, unsigned int sub_resource_idx)
+{
+    SIZE_T i;
+
+    for (i = 0; i < context->map_count; ++i)
+    {
+        if (context->maps[i].resource == resource && context->maps[i].sub_resource_idx == sub_resource_idx)
+            return &context->maps[i];
+    }
+
+    return NULL;
+}
+
+/* Only WRITE | DISCARD maps, and WRITE | NOOVERWRITE maps following a
+ * discard map of the same sub-resource, are allowed on deferred contexts.
+ * The data is uploaded by an update_sub_resource command recorded on unmap. */
+static HRESULT wined3d_deferred_context_map(struct wined3d_device_context *context,
+        struct wined3d_resource *resource, unsigned int sub_resource_idx,
+        struct wined3d_map_desc *map_desc, const struct wined3d_box *box, DWORD flags)
+{
+    struct wined3d_deferred_context *deferred = wined3d_deferred_context_from_context(context);
+    unsigned int row_pitch, slice_pitch, size;
+    struct wined3d_deferred_map *map;
+    void *data;
+
+    if (box)
+    {
+        FIXME("Mapping a box on a deferred context is not implemented.\n");
+        return E_NOTIMPL;
+    }
+
+    if (!(resource->access & WINED3D_RESOURCE_ACCESS_MAP_W))
+    {
+        WARN("Resource does not have MAP_W access.\n");
+        return E_INVALIDARG;
+    }
+
+    map = wined3d_deferred_context_find_map(deferred, resource, sub_resource_idx);
+    if (map && map->mapped)
+    {
+        WARN("Sub-resource is already mapped.\n");
+        return E_INVALIDARG;
+    }
+
+    flags &= WINED3D_MAP_READ | WINED3D_MAP_WRITE | WINED3D_MAP_DISCARD | WINED3D_MAP_NOOVERWRITE;
+    if (flags == (WINED3D_MAP_WRITE | WINED3D_MAP_NOOVERWRITE))
+    {
+        if (!map)
+        {
+            WARN("No-overwrite map without a preceding discard map.\n");
+            return E_INVALIDARG;
+        }
+    }
+    else if (flags == (WINED3D_MAP_WRITE | WINED3D_MAP_DISCARD))
+    {
+        if (resource->type == WINED3D_RTYPE_BUFFER)
+        {
+            if (sub_resource_idx)
+            {
+                WARN("Invalid sub-resource index %u.\n", sub_resource_idx);
+                return E_INVALIDARG;
+            }
+            row_pitch = slice_pitch = size = resource->size;
+        }
+        else
+        {
+            struct wined3d_texture *texture = texture_from_resource(resource);
+            unsigned int level;
+
+            if (sub_resource_idx >= texture->level_count * texture->layer_count)
+            {
+                WARN("Invalid sub-resource index %u.\n", sub_resource_idx);
+                return E_INVALIDARG;
+            }
+            level = sub_resource_idx % texture->level_count;
+            wined3d_texture_get_pitch(texture, level, &row_pitch, &slice_pitch);
+            size = slice_pitch * wined3d_texture_get_level_depth(texture, level);
+        }
+
+        /* The memory is owned by "uploads"; earlier commands may still refer
+         * to the previous allocation. */
+        if (!wined3d_array_reserve((void **)&deferred->uploads, &deferred->uploads_size,
+                deferred->upload_count + 1, sizeof(*deferred->uploads))
+                || (!map && !wined3d_array_reserve((void **)&deferred->maps, &deferred->maps_size,
+                deferred->map_count + 1, sizeof(*deferred->maps)))
+                || !(data = heap_alloc_zero(size)))
+            return E_OUTOFMEMORY;
+        deferred->uploads[deferred->upload_count++] = data;
+
+        if (!map)
+        {
+            map = &deferred->maps[deferred->map_count++];
+            map->resource = resource;
+            map->sub_resource_idx = sub_resource_idx;
+        }
+        map->row_pitch = row_pitch;
+        map->slice_pitch = slice_pitch;
+        map->data = data;
+    }
+    else
+    {
+        WARN("Unsupported map flags %#x on a deferred context.\n", flags);
+        return E_INVALIDARG;
+    }
+
+    map->mapped = TRUE;
+    map_desc->row_pitch = map->row_pitch;
+    map_desc->slice_pitch = map->slice_pitch;
+    map_desc->data = map->data;
+
+    return WINED3D_OK;
+}
+
+static HRESULT wined3d_deferred_context_unmap(struct wined3d_device_context *context,
+        struct wined3d_resource *resource, unsigned int sub_resource_idx)
+{
+    struct wined3d_deferred_context *deferred = wined3d_deferred_context_from_context(context);
+    struct wined3d_cs_update_sub_resource *op;
+    struct wined3d_deferred_map *map;
+    struct wined3d_box box;
+
+    if (!(map = wined3d_deferred_context_find_map(deferred, resource, sub_resource_idx)) || !map->mapped)
+    {
+        WARN("Sub-resource is not mapped.\n");
+        return WINEDDERR_NOTLOCKED;
+    }
+    map->mapped = FALSE;
+
+    if (resource->type == WINED3D_RTYPE_BUFFER)
+        wined3d_box_set(&box, 0, 0, resource->size, 1, 0, 1);
+    else
+        wined3d_texture_get_level_box(texture_from_resource(resource),
+                sub_resource_idx % texture_from_resource(resource)->level_count, &box);
+
+    if (!(op = wined3d_cs_require_space(&deferred->cs, sizeof(*op), WINED3D_CS_QUEUE_DEFAULT)))
+        return E_OUTOFMEMORY;
+    op->opcode = WINED3D_CS_OP_UPDATE_SUB_RESOURCE;
+    op->resource = resource;
+    op->sub_resource_idx = sub_resource_idx;
+    op->box = box;
+    op->data.row_pitch = map->row_pitch;
+    op->data.slice_pitch = map->slice_pitch;
+    op->data.data = map->data;
+
+    wined3d_cs_acquire_resource(&deferred->cs, resource);
+
+    wined3d_cs_submit(&deferred->cs, op, WINED3D_CS_QUEUE_DEFAULT);
+
+    return WINED3D_OK;
+}
+
+static void wined3d_deferred_context_issue_query(struct wined3d_device_context *context,
+        struct wined3d_query *query, DWORD flags)
+{
+    struct wined3d_deferred_context *deferred = wined3d_deferred_context_from_context(context);
+    struct wined3d_deferred_query_issue *issue;
+
+    if (!wined3d_array_reserve((void **)&deferred->query_issues, &deferred->query_issues_size,
+            deferred->query_issue_count + 1, sizeof(*deferred->query_issues)))
+    {
+        ERR("Failed to reserve memory.\n");
+        deferred->hr = E_OUTOFMEMORY;
+        return;
+    }
+    issue = &deferred->query_issues[deferred->query_issue_count++];
+    issue->query = query;
+    issue->flags = flags;
+
+    wined3d_cs_emit_query_issue(&deferred->cs, query, flags);
+}
+
+static void wined3d_deferred_context_execute_command_list(struct wined3d_device_context *context,
+        struct wined3d_command_list *list, BOOL restore_state)
+{
+    struct wined3d_deferred_context *deferred = wined3d_deferred_context_from_context(context);
+
+    if (!wined3d_array_reserve((void **)&deferred->command_lists, &deferred->command_lists_size,
+            deferred->command_list_count + 1, sizeof(*deferred->command_lists)))
+    {
+        ERR("Failed to reserve command list memory.\n");
+        deferred->hr = E_OUTOFMEMORY;
+        return;
+    }
+    wined3d_command_list_incref(list);
+    deferred->command_lists[deferred->command_list_count++] = list;
+
+    wined3d_cs_emit_execute_command_list(&deferred->cs, list);
+    if (restore_state)
+        wined3d_cs_emit_restore_state(&deferred->cs, &deferred->cs.state);
+    else
+        wined3d_device_context_reset_state(context);
+}
+
+static const struct wined3d_device_context_ops wined3d_deferred_context_ops =
+{
+    wined3d_deferred_context_map,
+    wined3d_deferred_context_unmap,
+    wined3d_deferred_context_issue_query,
+    wined3d_deferred_context_execute_command_list,
+};
+
+HRESULT CDECL wined3d_deferred_context_create(struct wined3d_device *device, struct wined3d_device_context **context)
+{
+    struct wined3d_deferred_context *object;
+
+    TRACE("device %p, context %p.\n", device, context);
+
+    if (!(object = heap_alloc_zero(sizeof(*object))))
+        return E_OUTOFMEMORY;
+
+    object->cs.ops = &wined3d_cs_deferred_ops;
+    object->cs.device = device;
+    /* The recorded state keeps its objects alive, but resources bound on a
+     * deferred context aren't bound to the device. */
+    state_init(&object->cs.state, &device->adapter->d3d_info,
+            WINED3D_STATE_INIT_DEFAULT | WINED3D_STATE_NO_BIND_COUNT);
+
+    object->c.ops = &wined3d_deferred_context_ops;
+    object->c.device = device;
+    object->c.state = &object->cs.state;
+    object->c.cs = &object->cs;
+
+    /* Command lists start from the default state. */
+    wined3d_cs_emit_reset_state(&object->cs, true);
+
+    TRACE("Created deferred context %p.\n", object);
+    *context = &object->c;
+
+    return WINED3D_OK;
+}
+
+/* Free the commands recorded since the last command list. */
+static void wined3d_deferred_context_discard(struct wined3d_deferred_context *context)
+{
+    SIZE_T i;
+
+    for (i = 0; i < context->upload_count; ++i)
+        heap_free(context->uploads[i]);
+    context->upload_count = 0;
+    context->resource_count = 0;
+    context->query_issue_count = 0;
+    context->map_count = 0;
+    for (i = 0; i < context->command_list_count; ++i)
+        wined3d_command_list_decref(context->command_lists[i]);
+    context->command_list_count = 0;
+    context->cs.start = context->cs.end = 0;
+}
+
+void CDECL wined3d_deferred_context_destroy(struct wined3d_device_context *context)
+{
+    struct wined3d_deferred_context *deferred = wined3d_deferred_context_from_context(context);
+
+    TRACE("context %p.\n", context);
+
+    wined3d_deferred_context_discard(deferred);
+    heap_free(deferred->uploads);
+    heap_free(deferred->resources);
+    heap_free(deferred->maps);
+    heap_free(deferred->query_issues);
+    heap_free(deferred->command_lists);
+    state_cleanup(&deferred->cs.state);
+    heap_free(deferred->cs.data);
+    heap_free(deferred);
+}
+
+HRESULT CDECL wined3d_deferred_context_record_command_list(struct wined3d_device_context *context,
+        BOOL restore, struct wined3d_command_list **list)
+{
+    struct wined3d_deferred_context *deferred = wined3d_deferred_context_from_context(context);
+    struct wined3d_cs *cs = &deferred->cs;
+    struct wined3d_command_list *object;
+    HRESULT hr;
+
+    TRACE("context %p, restore %#x, list %p.\n", context, restore, list);
+
+    wined3d_cs_queue_pending_states(cs);
+
+    /* A command list with missing commands is worse than no command list. */
+    if (FAILED(hr = deferred->hr) || !(object = heap_alloc_zero(sizeof(*object))))
+    {
+        WARN("Discarding the recorded commands.\n");
+        wined3d_deferred_context_discard(deferred);
+        deferred->hr = S_OK;
+        *list = NULL;
+        hr = E_OUTOFMEMORY;
+    }
+    else
+    {
+        object->refcount = 1;
+        object->device = cs->device;
+        object->data_size = cs->end;
+        object->data = cs->data;
+        object->resource_count = deferred->resource_count;
+        object->resources = deferred->resources;
+        object->upload_count = deferred->upload_count;
+        object->uploads = deferred->uploads;
+        object->command_list_count = deferred->command_list_count;
+        object->command_lists = deferred->command_lists;
+        object->query_issue_count = deferred->query_issue_count;
+        object->query_issues = deferred->query_issues;
+
+        cs->data = NULL;
+        cs->data_size = cs->start = cs->end = 0;
+        deferred->resources = NULL;
+        deferred->resources_size = deferred->resource_count = 0;
+        deferred->uploads = NULL;
+        deferred->uploads_size = deferred->upload_count = 0;
+        deferred->command_lists = NULL;
+        deferred->command_lists_size = deferred->command_list_count = 0;
+        deferred->query_issues = NULL;
+        deferred->query_issues_size = deferred->query_issue_count = 0;
+        /* The mapped memory now belongs to the command list. */
+        deferred->map_count = 0;
+
+        TRACE("Created command list %p.\n", object);
+        *list = object;
+    }
+
+    if (!restore)
+        wined3d_device_context_reset_app_state(context);
+    wined3d_cs_emit_restore_state(cs, &cs->state);
+
+    return hr;
+}
+
+ULONG CDECL wined3d_command_list_incref(struct wined3d_command_list *list)
+{
+    ULONG refcount = InterlockedIncrement(&list->refcount);
+
+    TRACE("%p increasing refcount to %u.\n", list, refcount);
+
+    return refcount;
+}
+
+static void wined3d_command_list_destroy_object(void *object)
+{
+    struct wined3d_command_list *list = object;
+    SIZE_T i;
+
+    for (i = 0; i < list->upload_count; ++i)
+        heap_free(list->uploads[i]);
+    heap_free(list->uploads);
+    heap_free(list->resources);
+    heap_free(list->command_lists);
+    heap_free(list->query_issues);
+    heap_free(list->data);
+    heap_free(list);
+}
+
+ULONG CDECL wined3d_command_list_decref(struct wined3d_command_list *list)
+{
+    ULONG refcount = InterlockedDecrement(&list->refcount);
+    struct wined3d_cs *cs = list->device->cs;
+    SIZE_T i;
+
+    TRACE("%p decreasing refcount to %u.\n", list, refcount);
+
+    if (!refcount)
+    {
+        for (i = 0; i < list->command_list_count; ++i)
+            wined3d_command_list_decref(list->command_lists[i]);
+        /* The command stream thread may still be executing the list. */
+        if (cs->thread)
+            wined3d_cs_destroy_object(cs, wined3d_command_list_destroy_object, list);
+        else
+            wined3d_command_list_destroy_object(list);
+    }
+
+    return refcount;
+}
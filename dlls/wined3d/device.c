@@ -524,6 +524,205 @@ static void wined3d_device_gl_destroy_dummy_textures(struct wined3d_device_gl *d
     memset(dummy_textures, 0, sizeof(*dummy_textures));
 }
 
+/* Context activation is done by the caller. */
+static void wined3d_device_gl_create_streaming_buffer(struct wined3d_device_gl *device_gl,
+        struct wined3d_context_gl *context_gl)
+{
+    static const GLbitfield map_flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    struct wined3d_streaming_buffer_gl *streaming = &device_gl->streaming_buffer;
+    const struct wined3d_gl_info *gl_info = context_gl->gl_info;
+
+    memset(streaming, 0, sizeof(*streaming));
+
+    if (!gl_info->supported[ARB_BUFFER_STORAGE] || !gl_info->supported[ARB_SYNC]
+            || !gl_info->supported[ARB_COPY_BUFFER] || !gl_info->supported[ARB_MAP_BUFFER_RANGE])
+    {
+        TRACE("Not creating a streaming buffer.\n");
+        return;
+    }
+
+    GL_EXTCALL(glGenBuffers(1, &streaming->bo.id));
+    streaming->bo.binding = GL_COPY_READ_BUFFER;
+    GL_EXTCALL(glBindBuffer(GL_COPY_READ_BUFFER, streaming->bo.id));
+    GL_EXTCALL(glBufferStorage(GL_COPY_READ_BUFFER, WINED3D_STREAMING_BUFFER_SIZE, NULL, map_flags));
+    streaming->map_ptr = GL_EXTCALL(glMapBufferRange(GL_COPY_READ_BUFFER,
+            0, WINED3D_STREAMING_BUFFER_SIZE, map_flags));
+    GL_EXTCALL(glBindBuffer(GL_COPY_READ_BUFFER, 0));
+    checkGLcall("streaming buffer creation");
+
+    if (!streaming->map_ptr || ((ULONG_PTR)streaming->map_ptr & (RESOURCE_ALIGNMENT - 1)))
+    {
+        WARN("Failed to map streaming buffer, pointer %p.\n", streaming->map_ptr);
+        GL_EXTCALL(glDeleteBuffers(1, &streaming->bo.id));
+        checkGLcall("streaming buffer destruction");
+        memset(streaming, 0, sizeof(*streaming));
+        return;
+    }
+
+    streaming->size = WINED3D_STREAMING_BUFFER_SIZE;
+    TRACE("Created streaming buffer %u, size %#x, pointer %p.\n",
+            streaming->bo.id, streaming->size, streaming->map_ptr);
+}
+
+/* Context activation is done by the caller. */
+static void wined3d_device_gl_destroy_streaming_buffer(struct wined3d_device_gl *device_gl,
+        struct wined3d_context_gl *context_gl)
+{
+    struct wined3d_streaming_buffer_gl *streaming = &device_gl->streaming_buffer;
+    const struct wined3d_gl_info *gl_info = context_gl->gl_info;
+    unsigned int i;
+
+    if (!streaming->bo.id)
+        return;
+
+    for (i = 0; i < streaming->frame_count; ++i)
+    {
+        GL_EXTCALL(glDeleteSync(streaming->frames[(streaming->frame_start + i)
+                % WINED3D_STREAMING_FRAME_COUNT].sync));
+    }
+    GL_EXTCALL(glDeleteBuffers(1, &streaming->bo.id));
+    checkGLcall("streaming buffer destruction");
+
+    memset(streaming, 0, sizeof(*streaming));
+}
+
+/* Context activation is done by the caller. */
+static BOOL wined3d_device_gl_streaming_buffer_retire(struct wined3d_device_gl *device_gl,
+        struct wined3d_context_gl *context_gl, BOOL wait)
+{
+    struct wined3d_streaming_buffer_gl *streaming = &device_gl->streaming_buffer;
+    const struct wined3d_gl_info *gl_info = context_gl->gl_info;
+    BOOL retired = FALSE;
+    GLenum ret;
+
+    while (streaming->frame_count)
+    {
+        unsigned int idx = streaming->frame_start;
+
+        ret = GL_EXTCALL(glClientWaitSync(streaming->frames[idx].sync,
+                wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? ~(GLuint64)0 : 0));
+        checkGLcall("glClientWaitSync");
+        if (ret == GL_TIMEOUT_EXPIRED)
+            break;
+        if (ret == GL_WAIT_FAILED)
+            ERR("Failed to wait for streaming buffer fence.\n");
+
+        GL_EXTCALL(glDeleteSync(streaming->frames[idx].sync));
+        streaming->tail = streaming->frames[idx].end;
+        streaming->frame_start = (idx + 1) % WINED3D_STREAMING_FRAME_COUNT;
+        --streaming->frame_count;
+        retired = TRUE;
+        /* Only wait for the oldest fence. */
+        wait = FALSE;
+    }
+
+    if (!streaming->frame_count && streaming->tail == streaming->head && !streaming->map_count)
+        streaming->head = streaming->tail = 0;
+
+    return retired;
+}
+
+/* Context activation is done by the caller. */
+void wined3d_device_gl_streaming_buffer_fence(struct wined3d_device_gl *device_gl,
+        struct wined3d_context_gl *context_gl)
+{
+    struct wined3d_streaming_buffer_gl *streaming = &device_gl->streaming_buffer;
+    const struct wined3d_gl_info *gl_info = context_gl->gl_info;
+    unsigned int idx;
+
+    if (!streaming->bo.id)
+        return;
+
+    wined3d_device_gl_streaming_buffer_retire(device_gl, context_gl, FALSE);
+
+    /* Ring space that is still mapped can't be covered by a fence. It will
+     * be picked up by the next one. */
+    if (streaming->map_count)
+        return;
+
+    if (streaming->frame_count)
+    {
+        idx = (streaming->frame_start + streaming->frame_count - 1) % WINED3D_STREAMING_FRAME_COUNT;
+        if (streaming->frames[idx].end == streaming->head)
+            return;
+    }
+    else if (streaming->tail == streaming->head)
+    {
+        return;
+    }
+
+    if (streaming->frame_count == WINED3D_STREAMING_FRAME_COUNT)
+    {
+        /* Merge with the newest fence instead of stalling. */
+        idx = (streaming->frame_start + streaming->frame_count - 1) % WINED3D_STREAMING_FRAME_COUNT;
+        GL_EXTCALL(glDeleteSync(streaming->frames[idx].sync));
+    }
+    else
+    {
+        idx = (streaming->frame_start + streaming->frame_count++) % WINED3D_STREAMING_FRAME_COUNT;
+    }
+
+    streaming->frames[idx].sync = GL_EXTCALL(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+    streaming->frames[idx].end = streaming->head;
+    checkGLcall("glFenceSync");
+}
+
+/* Context activation is done by the caller. */
+BOOL wined3d_device_gl_streaming_buffer_alloc(struct wined3d_device_gl *device_gl,
+        struct wined3d_context_gl *context_gl, unsigned int size, unsigned int *offset)
+{
+    struct wined3d_streaming_buffer_gl *streaming = &device_gl->streaming_buffer;
+    unsigned int head, tail;
+
+    if (!streaming->bo.id || !size || size > streaming->size / 4)
+        return FALSE;
+
+    size = (size + (RESOURCE_ALIGNMENT - 1)) & ~(RESOURCE_ALIGNMENT - 1);
+
+    wined3d_device_gl_streaming_buffer_retire(device_gl, context_gl, FALSE);
+
+    for (;;)
+    {
+        head = streaming->head;
+        tail = streaming->tail;
+
+        /* "head == tail" means the ring is empty, so allocations never
+         * completely fill it. */
+        if (head >= tail)
+        {
+            if (streaming->size - head > size || (streaming->size - head == size && tail))
+            {
+                *offset = head;
+                break;
+            }
+            if (tail > size)
+            {
+                *offset = 0;
+                break;
+            }
+        }
+        else if (tail - head > size)
+        {
+            *offset = head;
+            break;
+        }
+
+        /* Fence the current frame's uploads so that we have something to
+         * wait for, unless some of them are still mapped. */
+        if (!streaming->map_count)
+            wined3d_device_gl_streaming_buffer_fence(device_gl, context_gl);
+
+        if (!wined3d_device_gl_streaming_buffer_retire(device_gl, context_gl, TRUE))
+        {
+            TRACE("Streaming buffer is full.\n");
+            return FALSE;
+        }
+    }
+
+    streaming->head = *offset + size;
+    return TRUE;
+}
+
 /* Context activation is done by the caller. */
 void wined3d_device_create_default_samplers(struct wined3d_device *device, struct wined3d_context *context)
 {
@@ -1012,6 +1211,7 @@ void wined3d_device_delete_opengl_contexts_cs(void *object)
     context_gl = wined3d_context_gl(context);
     device->blitter->ops->blitter_destroy(device->blitter, context);
     device->shader_backend->shader_free_private(device, context);
+    wined3d_device_gl_destroy_streaming_buffer(device_gl, context_gl);
     wined3d_device_gl_destroy_dummy_textures(device_gl, context_gl);
     wined3d_device_destroy_default_samplers(device, context);
     context_release(context);
@@ -1067,6 +1267,7 @@ void wined3d_device_create_primary_opengl_context_cs(void *object)
     wined3d_raw_blitter_create(&device->blitter, context_gl->gl_info);
 
     wined3d_device_gl_create_dummy_textures(wined3d_device_gl(device), context_gl);
+    wined3d_device_gl_create_streaming_buffer(wined3d_device_gl(device), context_gl);
     wined3d_device_create_default_samplers(device, context);
     context_release(context);
 }
@@ -1211,7 +1412,7 @@ void wined3d_device_uninit_3d(struct wined3d_device *device)
         wined3d_texture_decref(texture);
     }
 
-    wined3d_cs_emit_reset_state(device->cs);
+    wined3d_cs_emit_reset_state(device->cs, false);
     state_cleanup(&device->state);
     for (i = 0; i < device->adapter->d3d_info.limits.max_rt_count; ++i)
     {
@@ -1290,13 +1491,13 @@ UINT CDECL wined3d_device_get_available_texture_mem(const struct wined3d_device
     return min(UINT_MAX, driver_info->vram_bytes - device->adapter->vram_bytes_used);
 }
 
-void CDECL wined3d_device_set_stream_output(struct wined3d_device *device, UINT idx,
-        struct wined3d_buffer *buffer, UINT offset)
+void CDECL wined3d_device_context_set_stream_output(struct wined3d_device_context *context, unsigned int idx,
+        struct wined3d_buffer *buffer, unsigned int offset)
 {
     struct wined3d_stream_output *stream;
     struct wined3d_buffer *prev_buffer;
 
-    TRACE("device %p, idx %u, buffer %p, offset %u.\n", device, idx, buffer, offset);
+    TRACE("context %p, idx %u, buffer %p, offset %u.\n", context, idx, buffer, offset);
 
     if (idx >= WINED3D_MAX_STREAM_OUTPUT_BUFFERS)
     {
@@ -1304,22 +1505,30 @@ void CDECL wined3d_device_set_stream_output(struct wined3d_device *device, UINT
         return;
     }
 
-    stream = &device->state.stream_output[idx];
+    stream = &context->state->stream_output[idx];
     prev_buffer = stream->buffer;
 
     if (buffer)
         wined3d_buffer_incref(buffer);
     stream->buffer = buffer;
     stream->offset = offset;
-    wined3d_cs_emit_set_stream_output(device->cs, idx, buffer, offset);
+    wined3d_cs_emit_set_stream_output(context->cs, idx, buffer, offset);
     if (prev_buffer)
         wined3d_buffer_decref(prev_buffer);
 }
 
-struct wined3d_buffer * CDECL wined3d_device_get_stream_output(struct wined3d_device *device,
-        UINT idx, UINT *offset)
+void CDECL wined3d_device_set_stream_output(struct wined3d_device *device, UINT idx,
+        struct wined3d_buffer *buffer, UINT offset)
 {
-    TRACE("device %p, idx %u, offset %p.\n", device, idx, offset);
+    TRACE("device %p, idx %u, buffer %p, offset %u.\n", device, idx, buffer, offset);
+
+    wined3d_device_context_set_stream_output(&device->immediate_context, idx, buffer, offset);
+}
+
+struct wined3d_buffer * CDECL wined3d_device_context_get_stream_output(struct wined3d_device_context *context,
+        unsigned int idx, unsigned int *offset)
+{
+    TRACE("context %p, idx %u, offset %p.\n", context, idx, offset);
 
     if (idx >= WINED3D_MAX_STREAM_OUTPUT_BUFFERS)
     {
@@ -1328,18 +1537,26 @@ struct wined3d_buffer * CDECL wined3d_device_get_stream_output(struct wined3d_de
     }
 
     if (offset)
-        *offset = device->state.stream_output[idx].offset;
-    return device->state.stream_output[idx].buffer;
+        *offset = context->state->stream_output[idx].offset;
+    return context->state->stream_output[idx].buffer;
 }
 
-HRESULT CDECL wined3d_device_set_stream_source(struct wined3d_device *device, UINT stream_idx,
-        struct wined3d_buffer *buffer, UINT offset, UINT stride)
+struct wined3d_buffer * CDECL wined3d_device_get_stream_output(struct wined3d_device *device,
+        UINT idx, UINT *offset)
+{
+    TRACE("device %p, idx %u, offset %p.\n", device, idx, offset);
+
+    return wined3d_device_context_get_stream_output(&device->immediate_context, idx, offset);
+}
+
+HRESULT CDECL wined3d_device_context_set_stream_source(struct wined3d_device_context *context,
+        unsigned int stream_idx, struct wined3d_buffer *buffer, unsigned int offset, unsigned int stride)
 {
     struct wined3d_stream_state *stream;
     struct wined3d_buffer *prev_buffer;
 
-    TRACE("device %p, stream_idx %u, buffer %p, offset %u, stride %u.\n",
-            device, stream_idx, buffer, offset, stride);
+    TRACE("context %p, stream_idx %u, buffer %p, offset %u, stride %u.\n",
+            context, stream_idx, buffer, offset, stride);
 
     if (stream_idx >= WINED3D_MAX_STREAMS)
     {
@@ -1352,7 +1569,7 @@ HRESULT CDECL wined3d_device_set_stream_source(struct wined3d_device *device, UI
         return WINED3DERR_INVALIDCALL;
     }
 
-    stream = &device->state.streams[stream_idx];
+    stream = &context->state->streams[stream_idx];
     prev_buffer = stream->buffer;
 
     if (prev_buffer == buffer
@@ -1360,6 +1577,7 @@ HRESULT CDECL wined3d_device_set_stream_source(struct wined3d_device *device, UI
             && stream->offset == offset)
     {
        TRACE("Application is setting the old values over, nothing to do.\n");
+       ++context->cs->redundant_state_count;
        return WINED3D_OK;
     }
 
@@ -1368,20 +1586,29 @@ HRESULT CDECL wined3d_device_set_stream_source(struct wined3d_device *device, UI
     stream->offset = offset;
     if (buffer)
         wined3d_buffer_incref(buffer);
-    wined3d_cs_emit_set_stream_source(device->cs, stream_idx, buffer, offset, stride);
+    wined3d_cs_emit_set_stream_source(context->cs, stream_idx, buffer, offset, stride);
     if (prev_buffer)
         wined3d_buffer_decref(prev_buffer);
 
     return WINED3D_OK;
 }
 
-HRESULT CDECL wined3d_device_get_stream_source(const struct wined3d_device *device,
-        UINT stream_idx, struct wined3d_buffer **buffer, UINT *offset, UINT *stride)
+HRESULT CDECL wined3d_device_set_stream_source(struct wined3d_device *device, UINT stream_idx,
+        struct wined3d_buffer *buffer, UINT offset, UINT stride)
+{
+    TRACE("device %p, stream_idx %u, buffer %p, offset %u, stride %u.\n",
+            device, stream_idx, buffer, offset, stride);
+
+    return wined3d_device_context_set_stream_source(&device->immediate_context, stream_idx, buffer, offset, stride);
+}
+
+HRESULT CDECL wined3d_device_context_get_stream_source(const struct wined3d_device_context *context,
+        unsigned int stream_idx, struct wined3d_buffer **buffer, unsigned int *offset, unsigned int *stride)
 {
     const struct wined3d_stream_state *stream;
 
-    TRACE("device %p, stream_idx %u, buffer %p, offset %p, stride %p.\n",
-            device, stream_idx, buffer, offset, stride);
+    TRACE("context %p, stream_idx %u, buffer %p, offset %p, stride %p.\n",
+            context, stream_idx, buffer, offset, stride);
 
     if (stream_idx >= WINED3D_MAX_STREAMS)
     {
@@ -1389,7 +1616,7 @@ HRESULT CDECL wined3d_device_get_stream_source(const struct wined3d_device *devi
         return WINED3DERR_INVALIDCALL;
     }
 
-    stream = &device->state.streams[stream_idx];
+    stream = &context->state->streams[stream_idx];
     *buffer = stream->buffer;
     if (offset)
         *offset = stream->offset;
@@ -1398,6 +1625,15 @@ HRESULT CDECL wined3d_device_get_stream_source(const struct wined3d_device *devi
     return WINED3D_OK;
 }
 
+HRESULT CDECL wined3d_device_get_stream_source(const struct wined3d_device *device,
+        UINT stream_idx, struct wined3d_buffer **buffer, UINT *offset, UINT *stride)
+{
+    TRACE("device %p, stream_idx %u, buffer %p, offset %p, stride %p.\n",
+            device, stream_idx, buffer, offset, stride);
+
+    return wined3d_device_context_get_stream_source(&device->immediate_context, stream_idx, buffer, offset, stride);
+}
+
 static void wined3d_device_set_stream_source_freq(struct wined3d_device *device, UINT stream_idx, UINT divider)
 {
     struct wined3d_stream_state *stream;
@@ -1434,6 +1670,7 @@ static void wined3d_device_set_transform(struct wined3d_device *device,
     if (!memcmp(&device->state.transforms[d3dts], matrix, sizeof(*matrix)))
     {
         TRACE("The application is setting the same matrix over again.\n");
+        ++device->cs->redundant_state_count;
         return;
     }
 
@@ -1633,42 +1870,59 @@ static void wined3d_device_set_material(struct wined3d_device *device, const str
     wined3d_cs_emit_set_material(device->cs, material);
 }
 
-void CDECL wined3d_device_set_index_buffer(struct wined3d_device *device,
+void CDECL wined3d_device_context_set_index_buffer(struct wined3d_device_context *context,
         struct wined3d_buffer *buffer, enum wined3d_format_id format_id, unsigned int offset)
 {
     enum wined3d_format_id prev_format;
     struct wined3d_buffer *prev_buffer;
     unsigned int prev_offset;
 
-    TRACE("device %p, buffer %p, format %s, offset %u.\n",
-            device, buffer, debug_d3dformat(format_id), offset);
+    TRACE("context %p, buffer %p, format %s, offset %u.\n",
+            context, buffer, debug_d3dformat(format_id), offset);
 
-    prev_buffer = device->state.index_buffer;
-    prev_format = device->state.index_format;
-    prev_offset = device->state.index_offset;
+    prev_buffer = context->state->index_buffer;
+    prev_format = context->state->index_format;
+    prev_offset = context->state->index_offset;
 
     if (prev_buffer == buffer && prev_format == format_id && prev_offset == offset)
         return;
 
     if (buffer)
         wined3d_buffer_incref(buffer);
-    device->state.index_buffer = buffer;
-    device->state.index_format = format_id;
-    device->state.index_offset = offset;
-    wined3d_cs_emit_set_index_buffer(device->cs, buffer, format_id, offset);
+    context->state->index_buffer = buffer;
+    context->state->index_format = format_id;
+    context->state->index_offset = offset;
+    wined3d_cs_emit_set_index_buffer(context->cs, buffer, format_id, offset);
     if (prev_buffer)
         wined3d_buffer_decref(prev_buffer);
 }
 
+void CDECL wined3d_device_set_index_buffer(struct wined3d_device *device,
+        struct wined3d_buffer *buffer, enum wined3d_format_id format_id, unsigned int offset)
+{
+    TRACE("device %p, buffer %p, format %s, offset %u.\n",
+            device, buffer, debug_d3dformat(format_id), offset);
+
+    wined3d_device_context_set_index_buffer(&device->immediate_context, buffer, format_id, offset);
+}
+
+struct wined3d_buffer * CDECL wined3d_device_context_get_index_buffer(const struct wined3d_device_context *context,
+        enum wined3d_format_id *format, unsigned int *offset)
+{
+    TRACE("context %p, format %p, offset %p.\n", context, format, offset);
+
+    *format = context->state->index_format;
+    if (offset)
+        *offset = context->state->index_offset;
+    return context->state->index_buffer;
+}
+
 struct wined3d_buffer * CDECL wined3d_device_get_index_buffer(const struct wined3d_device *device,
         enum wined3d_format_id *format, unsigned int *offset)
 {
     TRACE("device %p, format %p, offset %p.\n", device, format, offset);
 
-    *format = device->state.index_format;
-    if (offset)
-        *offset = device->state.index_offset;
-    return device->state.index_buffer;
+    return wined3d_device_context_get_index_buffer(&device->immediate_context, format, offset);
 }
 
 void CDECL wined3d_device_set_base_vertex_index(struct wined3d_device *device, INT base_index)
@@ -1678,12 +1932,12 @@ void CDECL wined3d_device_set_base_vertex_index(struct wined3d_device *device, I
     device->state.base_vertex_index = base_index;
 }
 
-void CDECL wined3d_device_set_viewports(struct wined3d_device *device, unsigned int viewport_count,
+void CDECL wined3d_device_context_set_viewports(struct wined3d_device_context *context, unsigned int viewport_count,
         const struct wined3d_viewport *viewports)
 {
     unsigned int i;
 
-    TRACE("device %p, viewport_count %u, viewports %p.\n", device, viewport_count, viewports);
+    TRACE("context %p, viewport_count %u, viewports %p.\n", context, viewport_count, viewports);
 
     for (i = 0; i < viewport_count; ++i)
     {
@@ -1692,31 +1946,47 @@ void CDECL wined3d_device_set_viewports(struct wined3d_device *device, unsigned
     }
 
     if (viewport_count)
-        memcpy(device->state.viewports, viewports, viewport_count * sizeof(*viewports));
+        memcpy(context->state->viewports, viewports, viewport_count * sizeof(*viewports));
     else
-        memset(device->state.viewports, 0, sizeof(device->state.viewports));
-    device->state.viewport_count = viewport_count;
+        memset(context->state->viewports, 0, sizeof(context->state->viewports));
+    context->state->viewport_count = viewport_count;
 
-    wined3d_cs_emit_set_viewports(device->cs, viewport_count, viewports);
+    wined3d_cs_emit_set_viewports(context->cs, viewport_count, viewports);
 }
 
-void CDECL wined3d_device_get_viewports(const struct wined3d_device *device, unsigned int *viewport_count,
-        struct wined3d_viewport *viewports)
+void CDECL wined3d_device_set_viewports(struct wined3d_device *device, unsigned int viewport_count,
+        const struct wined3d_viewport *viewports)
+{
+    TRACE("device %p, viewport_count %u, viewports %p.\n", device, viewport_count, viewports);
+
+    wined3d_device_context_set_viewports(&device->immediate_context, viewport_count, viewports);
+}
+
+void CDECL wined3d_device_context_get_viewports(const struct wined3d_device_context *context,
+        unsigned int *viewport_count, struct wined3d_viewport *viewports)
 {
     unsigned int count;
 
-    TRACE("device %p, viewport_count %p, viewports %p.\n", device, viewport_count, viewports);
+    TRACE("context %p, viewport_count %p, viewports %p.\n", context, viewport_count, viewports);
 
-    count = viewport_count ? min(*viewport_count, device->state.viewport_count) : 1;
+    count = viewport_count ? min(*viewport_count, context->state->viewport_count) : 1;
     if (count && viewports)
-        memcpy(viewports, device->state.viewports, count * sizeof(*viewports));
+        memcpy(viewports, context->state->viewports, count * sizeof(*viewports));
     if (viewport_count)
-        *viewport_count = device->state.viewport_count;
+        *viewport_count = context->state->viewport_count;
 }
 
-static void resolve_depth_buffer(struct wined3d_device *device)
+void CDECL wined3d_device_get_viewports(const struct wined3d_device *device, unsigned int *viewport_count,
+        struct wined3d_viewport *viewports)
 {
-    const struct wined3d_state *state = &device->state;
+    TRACE("device %p, viewport_count %p, viewports %p.\n", device, viewport_count, viewports);
+
+    wined3d_device_context_get_viewports(&device->immediate_context, viewport_count, viewports);
+}
+
+static void resolve_depth_buffer(struct wined3d_device_context *context)
+{
+    const struct wined3d_state *state = context->state;
     struct wined3d_rendertarget_view *src_view;
     struct wined3d_resource *dst_resource;
     struct wined3d_texture *dst_texture;
@@ -1729,18 +1999,18 @@ static void resolve_depth_buffer(struct wined3d_device *device)
     if (!(src_view = state->fb.depth_stencil))
         return;
 
-    wined3d_device_resolve_sub_resource(device, dst_resource, 0,
+    wined3d_device_context_resolve_sub_resource(context, dst_resource, 0,
             src_view->resource, src_view->sub_resource_idx, dst_resource->format->id);
 }
 
-void CDECL wined3d_device_set_blend_state(struct wined3d_device *device,
+void CDECL wined3d_device_context_set_blend_state(struct wined3d_device_context *context,
         struct wined3d_blend_state *blend_state, const struct wined3d_color *blend_factor, unsigned int sample_mask)
 {
-    struct wined3d_state *state = &device->state;
+    struct wined3d_state *state = context->state;
     struct wined3d_blend_state *prev;
 
-    TRACE("device %p, blend_state %p, blend_factor %s, sample_mask %#x.\n",
-            device, blend_state, debug_color(blend_factor), sample_mask);
+    TRACE("context %p, blend_state %p, blend_factor %s, sample_mask %#x.\n",
+            context, blend_state, debug_color(blend_factor), sample_mask);
 
     prev = state->blend_state;
     if (prev == blend_state && !memcmp(blend_factor, &state->blend_factor, sizeof(*blend_factor))
@@ -1752,79 +2022,128 @@ void CDECL wined3d_device_set_blend_state(struct wined3d_device *device,
     state->blend_state = blend_state;
     state->blend_factor = *blend_factor;
     state->sample_mask = sample_mask;
-    wined3d_cs_emit_set_blend_state(device->cs, blend_state, blend_factor, sample_mask);
+    wined3d_cs_emit_set_blend_state(context->cs, blend_state, blend_factor, sample_mask);
     if (prev)
         wined3d_blend_state_decref(prev);
 }
 
-struct wined3d_blend_state * CDECL wined3d_device_get_blend_state(const struct wined3d_device *device,
-        struct wined3d_color *blend_factor, unsigned int *sample_mask)
+void CDECL wined3d_device_set_blend_state(struct wined3d_device *device,
+        struct wined3d_blend_state *blend_state, const struct wined3d_color *blend_factor, unsigned int sample_mask)
 {
-    const struct wined3d_state *state = &device->state;
+    TRACE("device %p, blend_state %p, blend_factor %s, sample_mask %#x.\n",
+            device, blend_state, debug_color(blend_factor), sample_mask);
 
-    TRACE("device %p, blend_factor %p, sample_mask %p.\n", device, blend_factor, sample_mask);
+    wined3d_device_context_set_blend_state(&device->immediate_context, blend_state, blend_factor, sample_mask);
+}
+
+struct wined3d_blend_state * CDECL wined3d_device_context_get_blend_state(
+        const struct wined3d_device_context *context, struct wined3d_color *blend_factor, unsigned int *sample_mask)
+{
+    const struct wined3d_state *state = context->state;
+
+    TRACE("context %p, blend_factor %p, sample_mask %p.\n", context, blend_factor, sample_mask);
 
     *blend_factor = state->blend_factor;
     *sample_mask = state->sample_mask;
     return state->blend_state;
 }
 
-void CDECL wined3d_device_set_depth_stencil_state(struct wined3d_device *device,
+struct wined3d_blend_state * CDECL wined3d_device_get_blend_state(const struct wined3d_device *device,
+        struct wined3d_color *blend_factor, unsigned int *sample_mask)
+{
+    TRACE("device %p, blend_factor %p, sample_mask %p.\n", device, blend_factor, sample_mask);
+
+    return wined3d_device_context_get_blend_state(&device->immediate_context, blend_factor, sample_mask);
+}
+
+void CDECL wined3d_device_context_set_depth_stencil_state(struct wined3d_device_context *context,
         struct wined3d_depth_stencil_state *state)
 {
     struct wined3d_depth_stencil_state *prev;
 
-    TRACE("device %p, state %p.\n", device, state);
+    TRACE("context %p, state %p.\n", context, state);
 
-    prev = device->state.depth_stencil_state;
+    prev = context->state->depth_stencil_state;
     if (prev == state)
         return;
 
     if (state)
         wined3d_depth_stencil_state_incref(state);
-    device->state.depth_stencil_state = state;
-    wined3d_cs_emit_set_depth_stencil_state(device->cs, state);
+    context->state->depth_stencil_state = state;
+    wined3d_cs_emit_set_depth_stencil_state(context->cs, state);
     if (prev)
         wined3d_depth_stencil_state_decref(prev);
 }
 
+void CDECL wined3d_device_set_depth_stencil_state(struct wined3d_device *device,
+        struct wined3d_depth_stencil_state *state)
+{
+    TRACE("device %p, state %p.\n", device, state);
+
+    wined3d_device_context_set_depth_stencil_state(&device->immediate_context, state);
+}
+
+struct wined3d_depth_stencil_state * CDECL wined3d_device_context_get_depth_stencil_state(
+        const struct wined3d_device_context *context)
+{
+    TRACE("context %p.\n", context);
+
+    return context->state->depth_stencil_state;
+}
+
 struct wined3d_depth_stencil_state * CDECL wined3d_device_get_depth_stencil_state(const struct wined3d_device *device)
 {
     TRACE("device %p.\n", device);
 
-    return device->state.depth_stencil_state;
+    return wined3d_device_context_get_depth_stencil_state(&device->immediate_context);
 }
 
-void CDECL wined3d_device_set_rasterizer_state(struct wined3d_device *device,
+void CDECL wined3d_device_context_set_rasterizer_state(struct wined3d_device_context *context,
         struct wined3d_rasterizer_state *rasterizer_state)
 {
     struct wined3d_rasterizer_state *prev;
 
-    TRACE("device %p, rasterizer_state %p.\n", device, rasterizer_state);
+    TRACE("context %p, rasterizer_state %p.\n", context, rasterizer_state);
 
-    prev = device->state.rasterizer_state;
+    prev = context->state->rasterizer_state;
     if (prev == rasterizer_state)
         return;
 
     if (rasterizer_state)
         wined3d_rasterizer_state_incref(rasterizer_state);
-    device->state.rasterizer_state = rasterizer_state;
-    wined3d_cs_emit_set_rasterizer_state(device->cs, rasterizer_state);
+    context->state->rasterizer_state = rasterizer_state;
+    wined3d_cs_emit_set_rasterizer_state(context->cs, rasterizer_state);
     if (prev)
         wined3d_rasterizer_state_decref(prev);
 }
 
+void CDECL wined3d_device_set_rasterizer_state(struct wined3d_device *device,
+        struct wined3d_rasterizer_state *rasterizer_state)
+{
+    TRACE("device %p, rasterizer_state %p.\n", device, rasterizer_state);
+
+    wined3d_device_context_set_rasterizer_state(&device->immediate_context, rasterizer_state);
+}
+
+struct wined3d_rasterizer_state * CDECL wined3d_device_context_get_rasterizer_state(
+        const struct wined3d_device_context *context)
+{
+    TRACE("context %p.\n", context);
+
+    return context->state->rasterizer_state;
+}
+
 struct wined3d_rasterizer_state * CDECL wined3d_device_get_rasterizer_state(struct wined3d_device *device)
 {
     TRACE("device %p.\n", device);
 
-    return device->state.rasterizer_state;
+    return wined3d_device_context_get_rasterizer_state(&device->immediate_context);
 }
 
-void CDECL wined3d_device_set_render_state(struct wined3d_device *device,
+void CDECL wined3d_device_context_set_render_state(struct wined3d_device_context *context,
         enum wined3d_render_state state, DWORD value)
 {
-    TRACE("device %p, state %s (%#x), value %#x.\n", device, debug_d3drenderstate(state), state, value);
+    TRACE("context %p, state %s (%#x), value %#x.\n", context, debug_d3drenderstate(state), state, value);
 
     if (state > WINEHIGHEST_RENDER_STATE)
     {
@@ -1832,21 +2151,32 @@ void CDECL wined3d_device_set_render_state(struct wined3d_device *device,
         return;
     }
 
-    if (value == device->state.render_states[state])
+    if (value == context->state->render_states[state])
+    {
         TRACE("Application is setting the old value over, nothing to do.\n");
+        ++context->cs->redundant_state_count;
+    }
     else
     {
-        device->state.render_states[state] = value;
-        wined3d_cs_emit_set_render_state(device->cs, state, value);
+        context->state->render_states[state] = value;
+        wined3d_cs_emit_set_render_state(context->cs, state, value);
     }
 
     if (state == WINED3D_RS_POINTSIZE && value == WINED3D_RESZ_CODE)
     {
         TRACE("RESZ multisampled depth buffer resolve triggered.\n");
-        resolve_depth_buffer(device);
+        resolve_depth_buffer(context);
     }
 }
 
+void CDECL wined3d_device_set_render_state(struct wined3d_device *device,
+        enum wined3d_render_state state, DWORD value)
+{
+    TRACE("device %p, state %s (%#x), value %#x.\n", device, debug_d3drenderstate(state), state, value);
+
+    wined3d_device_context_set_render_state(&device->immediate_context, state, value);
+}
+
 DWORD CDECL wined3d_device_get_render_state(const struct wined3d_device *device, enum wined3d_render_state state)
 {
     TRACE("device %p, state %s (%#x).\n", device, debug_d3drenderstate(state), state);
@@ -1863,6 +2193,7 @@ static void wined3d_device_set_sampler_state(struct wined3d_device *device,
     if (value == device->state.sampler_states[sampler_idx][state])
     {
         TRACE("Application is setting the old value over, nothing to do.\n");
+        ++device->cs->redundant_state_count;
         return;
     }
 
@@ -1870,102 +2201,152 @@ static void wined3d_device_set_sampler_state(struct wined3d_device *device,
     wined3d_cs_emit_set_sampler_state(device->cs, sampler_idx, state, value);
 }
 
-void CDECL wined3d_device_set_scissor_rects(struct wined3d_device *device, unsigned int rect_count,
-        const RECT *rects)
+void CDECL wined3d_device_context_set_scissor_rects(struct wined3d_device_context *context,
+        unsigned int rect_count, const RECT *rects)
 {
     unsigned int i;
 
-    TRACE("device %p, rect_count %u, rects %p.\n", device, rect_count, rects);
+    TRACE("context %p, rect_count %u, rects %p.\n", context, rect_count, rects);
 
     for (i = 0; i < rect_count; ++i)
     {
         TRACE("%u: %s\n", i, wine_dbgstr_rect(&rects[i]));
     }
 
-    if (device->state.scissor_rect_count == rect_count
-            && !memcmp(device->state.scissor_rects, rects, rect_count * sizeof(*rects)))
+    if (context->state->scissor_rect_count == rect_count
+            && !memcmp(context->state->scissor_rects, rects, rect_count * sizeof(*rects)))
     {
         TRACE("App is setting the old scissor rectangles over, nothing to do.\n");
         return;
     }
 
     if (rect_count)
-        memcpy(device->state.scissor_rects, rects, rect_count * sizeof(*rects));
+        memcpy(context->state->scissor_rects, rects, rect_count * sizeof(*rects));
     else
-        memset(device->state.scissor_rects, 0, sizeof(device->state.scissor_rects));
-    device->state.scissor_rect_count = rect_count;
+        memset(context->state->scissor_rects, 0, sizeof(context->state->scissor_rects));
+    context->state->scissor_rect_count = rect_count;
 
-    wined3d_cs_emit_set_scissor_rects(device->cs, rect_count, rects);
+    wined3d_cs_emit_set_scissor_rects(context->cs, rect_count, rects);
 }
 
-void CDECL wined3d_device_get_scissor_rects(const struct wined3d_device *device, unsigned int *rect_count, RECT *rects)
+void CDECL wined3d_device_set_scissor_rects(struct wined3d_device *device, unsigned int rect_count,
+        const RECT *rects)
+{
+    TRACE("device %p, rect_count %u, rects %p.\n", device, rect_count, rects);
+
+    wined3d_device_context_set_scissor_rects(&device->immediate_context, rect_count, rects);
+}
+
+void CDECL wined3d_device_context_get_scissor_rects(const struct wined3d_device_context *context,
+        unsigned int *rect_count, RECT *rects)
 {
     unsigned int count;
 
-    TRACE("device %p, rect_count %p, rects %p.\n", device, rect_count, rects);
+    TRACE("context %p, rect_count %p, rects %p.\n", context, rect_count, rects);
 
-    count = rect_count ? min(*rect_count, device->state.scissor_rect_count) : 1;
+    count = rect_count ? min(*rect_count, context->state->scissor_rect_count) : 1;
     if (count && rects)
-        memcpy(rects, device->state.scissor_rects, count * sizeof(*rects));
+        memcpy(rects, context->state->scissor_rects, count * sizeof(*rects));
     if (rect_count)
-        *rect_count = device->state.scissor_rect_count;
+        *rect_count = context->state->scissor_rect_count;
 }
 
-void CDECL wined3d_device_set_vertex_declaration(struct wined3d_device *device,
+void CDECL wined3d_device_get_scissor_rects(const struct wined3d_device *device, unsigned int *rect_count, RECT *rects)
+{
+    TRACE("device %p, rect_count %p, rects %p.\n", device, rect_count, rects);
+
+    wined3d_device_context_get_scissor_rects(&device->immediate_context, rect_count, rects);
+}
+
+void CDECL wined3d_device_context_set_vertex_declaration(struct wined3d_device_context *context,
         struct wined3d_vertex_declaration *declaration)
 {
-    struct wined3d_vertex_declaration *prev = device->state.vertex_declaration;
+    struct wined3d_vertex_declaration *prev = context->state->vertex_declaration;
 
-    TRACE("device %p, declaration %p.\n", device, declaration);
+    TRACE("context %p, declaration %p.\n", context, declaration);
 
     if (declaration == prev)
         return;
 
     if (declaration)
         wined3d_vertex_declaration_incref(declaration);
-    device->state.vertex_declaration = declaration;
-    wined3d_cs_emit_set_vertex_declaration(device->cs, declaration);
+    context->state->vertex_declaration = declaration;
+    wined3d_cs_emit_set_vertex_declaration(context->cs, declaration);
     if (prev)
         wined3d_vertex_declaration_decref(prev);
 }
 
+void CDECL wined3d_device_set_vertex_declaration(struct wined3d_device *device,
+        struct wined3d_vertex_declaration *declaration)
+{
+    TRACE("device %p, declaration %p.\n", device, declaration);
+
+    wined3d_device_context_set_vertex_declaration(&device->immediate_context, declaration);
+}
+
+struct wined3d_vertex_declaration * CDECL wined3d_device_context_get_vertex_declaration(
+        const struct wined3d_device_context *context)
+{
+    TRACE("context %p.\n", context);
+
+    return context->state->vertex_declaration;
+}
+
 struct wined3d_vertex_declaration * CDECL wined3d_device_get_vertex_declaration(const struct wined3d_device *device)
 {
     TRACE("device %p.\n", device);
 
-    return device->state.vertex_declaration;
+    return wined3d_device_context_get_vertex_declaration(&device->immediate_context);
 }
 
-void CDECL wined3d_device_set_vertex_shader(struct wined3d_device *device, struct wined3d_shader *shader)
+void CDECL wined3d_device_context_set_shader(struct wined3d_device_context *context,
+        enum wined3d_shader_type type, struct wined3d_shader *shader)
 {
-    struct wined3d_shader *prev = device->state.shader[WINED3D_SHADER_TYPE_VERTEX];
+    struct wined3d_state *state = context->state;
+    struct wined3d_shader *prev;
 
-    TRACE("device %p, shader %p.\n", device, shader);
+    TRACE("context %p, type %#x, shader %p.\n", context, type, shader);
 
+    prev = state->shader[type];
     if (shader == prev)
         return;
 
     if (shader)
         wined3d_shader_incref(shader);
-    device->state.shader[WINED3D_SHADER_TYPE_VERTEX] = shader;
-    wined3d_cs_emit_set_shader(device->cs, WINED3D_SHADER_TYPE_VERTEX, shader);
+    state->shader[type] = shader;
+    wined3d_cs_emit_set_shader(context->cs, type, shader);
     if (prev)
         wined3d_shader_decref(prev);
 }
 
+struct wined3d_shader * CDECL wined3d_device_context_get_shader(const struct wined3d_device_context *context,
+        enum wined3d_shader_type type)
+{
+    TRACE("context %p, type %#x.\n", context, type);
+
+    return context->state->shader[type];
+}
+
+void CDECL wined3d_device_set_vertex_shader(struct wined3d_device *device, struct wined3d_shader *shader)
+{
+    TRACE("device %p, shader %p.\n", device, shader);
+
+    wined3d_device_context_set_shader(&device->immediate_context, WINED3D_SHADER_TYPE_VERTEX, shader);
+}
+
 struct wined3d_shader * CDECL wined3d_device_get_vertex_shader(const struct wined3d_device *device)
 {
     TRACE("device %p.\n", device);
 
-    return device->state.shader[WINED3D_SHADER_TYPE_VERTEX];
+    return wined3d_device_context_get_shader(&device->immediate_context, WINED3D_SHADER_TYPE_VERTEX);
 }
 
-void CDECL wined3d_device_set_constant_buffer(struct wined3d_device *device,
-        enum wined3d_shader_type type, UINT idx, struct wined3d_buffer *buffer)
+void CDECL wined3d_device_context_set_constant_buffer(struct wined3d_device_context *context,
+        enum wined3d_shader_type type, unsigned int idx, struct wined3d_buffer *buffer)
 {
     struct wined3d_buffer *prev;
 
-    TRACE("device %p, type %#x, idx %u, buffer %p.\n", device, type, idx, buffer);
+    TRACE("context %p, type %#x, idx %u, buffer %p.\n", context, type, idx, buffer);
 
     if (idx >= MAX_CONSTANT_BUFFERS)
     {
@@ -1973,22 +2354,33 @@ void CDECL wined3d_device_set_constant_buffer(struct wined3d_device *device,
         return;
     }
 
-    prev = device->state.cb[type][idx];
+    prev = context->state->cb[type][idx];
     if (buffer == prev)
+    {
+        ++context->cs->redundant_state_count;
         return;
+    }
 
     if (buffer)
         wined3d_buffer_incref(buffer);
-    device->state.cb[type][idx] = buffer;
-    wined3d_cs_emit_set_constant_buffer(device->cs, type, idx, buffer);
+    context->state->cb[type][idx] = buffer;
+    wined3d_cs_emit_set_constant_buffer(context->cs, type, idx, buffer);
     if (prev)
         wined3d_buffer_decref(prev);
 }
 
-struct wined3d_buffer * CDECL wined3d_device_get_constant_buffer(const struct wined3d_device *device,
+void CDECL wined3d_device_set_constant_buffer(struct wined3d_device *device,
+        enum wined3d_shader_type type, UINT idx, struct wined3d_buffer *buffer)
+{
+    TRACE("device %p, type %#x, idx %u, buffer %p.\n", device, type, idx, buffer);
+
+    wined3d_device_context_set_constant_buffer(&device->immediate_context, type, idx, buffer);
+}
+
+struct wined3d_buffer * CDECL wined3d_device_context_get_constant_buffer(const struct wined3d_device_context *context,
         enum wined3d_shader_type shader_type, unsigned int idx)
 {
-    TRACE("device %p, shader_type %#x, idx %u.\n", device, shader_type, idx);
+    TRACE("context %p, shader_type %#x, idx %u.\n", context, shader_type, idx);
 
     if (idx >= MAX_CONSTANT_BUFFERS)
     {
@@ -1996,14 +2388,26 @@ struct wined3d_buffer * CDECL wined3d_device_get_constant_buffer(const struct wi
         return NULL;
     }
 
-    return device->state.cb[shader_type][idx];
+    return context->state->cb[shader_type][idx];
+}
+
+struct wined3d_buffer * CDECL wined3d_device_get_constant_buffer(const struct wined3d_device *device,
+        enum wined3d_shader_type shader_type, unsigned int idx)
+{
+    TRACE("device %p, shader_type %#x, idx %u.\n", device, shader_type, idx);
+
+    return wined3d_device_context_get_constant_buffer(&device->immediate_context, shader_type, idx);
 }
 
-static void wined3d_device_set_shader_resource_view(struct wined3d_device *device,
-        enum wined3d_shader_type type, UINT idx, struct wined3d_shader_resource_view *view)
+void CDECL wined3d_device_context_set_shader_resource_view(struct wined3d_device_context *context,
+        enum wined3d_shader_type type, unsigned int idx, struct wined3d_shader_resource_view *view)
 {
+    struct wined3d_state *state = context->state;
     const struct wined3d_rendertarget_view *dsv;
     struct wined3d_shader_resource_view *prev;
+    bool bind_count;
+
+    TRACE("context %p, type %#x, idx %u, view %p.\n", context, type, idx, view);
 
     if (idx >= MAX_SHADER_RESOURCE_VIEWS)
     {
@@ -2011,12 +2415,18 @@ static void wined3d_device_set_shader_resource_view(struct wined3d_device *devic
         return;
     }
 
-    prev = device->state.shader_resource_view[type][idx];
+    prev = state->shader_resource_view[type][idx];
     if (view == prev)
+    {
+        ++context->cs->redundant_state_count;
         return;
+    }
 
-    if (view && (wined3d_is_srv_rtv_bound(view)
-            || ((dsv = device->state.fb.depth_stencil)
+    /* Bind counts are global to the resource, so only the immediate context
+     * tracks them, and checks for views bound for output. */
+    bind_count = !(state->flags & WINED3D_STATE_NO_BIND_COUNT);
+    if (view && bind_count && (wined3d_is_srv_rtv_bound(view)
+            || ((dsv = state->fb.depth_stencil)
             && dsv->resource == view->resource && wined3d_dsv_srv_conflict(dsv, view->format))))
     {
         WARN("Application is trying to bind resource which is attached as render target.\n");
@@ -2026,14 +2436,16 @@ static void wined3d_device_set_shader_resource_view(struct wined3d_device *devic
     if (view)
     {
         wined3d_shader_resource_view_incref(view);
-        wined3d_srv_bind_count_inc(view);
+        if (bind_count)
+            wined3d_srv_bind_count_inc(view);
     }
 
-    device->state.shader_resource_view[type][idx] = view;
-    wined3d_cs_emit_set_shader_resource_view(device->cs, type, idx, view);
+    state->shader_resource_view[type][idx] = view;
+    wined3d_cs_emit_set_shader_resource_view(context->cs, type, idx, view);
     if (prev)
     {
-        wined3d_srv_bind_count_dec(prev);
+        if (bind_count)
+            wined3d_srv_bind_count_dec(prev);
         wined3d_shader_resource_view_decref(prev);
     }
 }
@@ -2043,19 +2455,21 @@ void CDECL wined3d_device_set_vs_resource_view(struct wined3d_device *device,
 {
     TRACE("device %p, idx %u, view %p.\n", device, idx, view);
 
-    wined3d_device_set_shader_resource_view(device, WINED3D_SHADER_TYPE_VERTEX, idx, view);
+    wined3d_device_context_set_shader_resource_view(&device->immediate_context, WINED3D_SHADER_TYPE_VERTEX, idx, view);
 }
 
-static struct wined3d_shader_resource_view *wined3d_device_get_shader_resource_view(
-        const struct wined3d_device *device, enum wined3d_shader_type shader_type, unsigned int idx)
+struct wined3d_shader_resource_view * CDECL wined3d_device_context_get_shader_resource_view(
+        const struct wined3d_device_context *context, enum wined3d_shader_type shader_type, unsigned int idx)
 {
+    TRACE("context %p, shader_type %#x, idx %u.\n", context, shader_type, idx);
+
     if (idx >= MAX_SHADER_RESOURCE_VIEWS)
     {
         WARN("Invalid view index %u.\n", idx);
         return NULL;
     }
 
-    return device->state.shader_resource_view[shader_type][idx];
+    return context->state->shader_resource_view[shader_type][idx];
 }
 
 struct wined3d_shader_resource_view * CDECL wined3d_device_get_vs_resource_view(const struct wined3d_device *device,
@@ -2063,28 +2477,33 @@ struct wined3d_shader_resource_view * CDECL wined3d_device_get_vs_resource_view(
 {
     TRACE("device %p, idx %u.\n", device, idx);
 
-    return wined3d_device_get_shader_resource_view(device, WINED3D_SHADER_TYPE_VERTEX, idx);
+    return wined3d_device_context_get_shader_resource_view(&device->immediate_context, WINED3D_SHADER_TYPE_VERTEX, idx);
 }
 
-static void wined3d_device_set_sampler(struct wined3d_device *device,
-        enum wined3d_shader_type type, UINT idx, struct wined3d_sampler *sampler)
+void CDECL wined3d_device_context_set_sampler(struct wined3d_device_context *context,
+        enum wined3d_shader_type type, unsigned int idx, struct wined3d_sampler *sampler)
 {
     struct wined3d_sampler *prev;
 
+    TRACE("context %p, type %#x, idx %u, sampler %p.\n", context, type, idx, sampler);
+
     if (idx >= MAX_SAMPLER_OBJECTS)
     {
         WARN("Invalid sampler index %u.\n", idx);
         return;
     }
 
-    prev = device->state.sampler[type][idx];
+    prev = context->state->sampler[type][idx];
     if (sampler == prev)
+    {
+        ++context->cs->redundant_state_count;
         return;
+    }
 
     if (sampler)
         wined3d_sampler_incref(sampler);
-    device->state.sampler[type][idx] = sampler;
-    wined3d_cs_emit_set_sampler(device->cs, type, idx, sampler);
+    context->state->sampler[type][idx] = sampler;
+    wined3d_cs_emit_set_sampler(context->cs, type, idx, sampler);
     if (prev)
         wined3d_sampler_decref(prev);
 }
@@ -2093,26 +2512,28 @@ void CDECL wined3d_device_set_vs_sampler(struct wined3d_device *device, UINT idx
 {
     TRACE("device %p, idx %u, sampler %p.\n", device, idx, sampler);
 
-    wined3d_device_set_sampler(device, WINED3D_SHADER_TYPE_VERTEX, idx, sampler);
+    wined3d_device_context_set_sampler(&device->immediate_context, WINED3D_SHADER_TYPE_VERTEX, idx, sampler);
 }
 
-static struct wined3d_sampler *wined3d_device_get_sampler(const struct wined3d_device *device,
+struct wined3d_sampler * CDECL wined3d_device_context_get_sampler(const struct wined3d_device_context *context,
         enum wined3d_shader_type shader_type, unsigned int idx)
 {
+    TRACE("context %p, shader_type %#x, idx %u.\n", context, shader_type, idx);
+
     if (idx >= MAX_SAMPLER_OBJECTS)
     {
         WARN("Invalid sampler index %u.\n", idx);
         return NULL;
     }
 
-    return device->state.sampler[shader_type][idx];
+    return context->state->sampler[shader_type][idx];
 }
 
 struct wined3d_sampler * CDECL wined3d_device_get_vs_sampler(const struct wined3d_device *device, UINT idx)
 {
     TRACE("device %p, idx %u.\n", device, idx);
 
-    return wined3d_device_get_sampler(device, WINED3D_SHADER_TYPE_VERTEX, idx);
+    return wined3d_device_context_get_sampler(&device->immediate_context, WINED3D_SHADER_TYPE_VERTEX, idx);
 }
 
 static void wined3d_device_set_vs_consts_b(struct wined3d_device *device,
@@ -2171,26 +2592,16 @@ static void wined3d_device_set_vs_consts_f(struct wined3d_device *device,
 
 void CDECL wined3d_device_set_pixel_shader(struct wined3d_device *device, struct wined3d_shader *shader)
 {
-    struct wined3d_shader *prev = device->state.shader[WINED3D_SHADER_TYPE_PIXEL];
-
     TRACE("device %p, shader %p.\n", device, shader);
 
-    if (shader == prev)
-        return;
-
-    if (shader)
-        wined3d_shader_incref(shader);
-    device->state.shader[WINED3D_SHADER_TYPE_PIXEL] = shader;
-    wined3d_cs_emit_set_shader(device->cs, WINED3D_SHADER_TYPE_PIXEL, shader);
-    if (prev)
-        wined3d_shader_decref(prev);
+    wined3d_device_context_set_shader(&device->immediate_context, WINED3D_SHADER_TYPE_PIXEL, shader);
 }
 
 struct wined3d_shader * CDECL wined3d_device_get_pixel_shader(const struct wined3d_device *device)
 {
     TRACE("device %p.\n", device);
 
-    return device->state.shader[WINED3D_SHADER_TYPE_PIXEL];
+    return wined3d_device_context_get_shader(&device->immediate_context, WINED3D_SHADER_TYPE_PIXEL);
 }
 
 void CDECL wined3d_device_set_ps_resource_view(struct wined3d_device *device,
@@ -2198,7 +2609,7 @@ void CDECL wined3d_device_set_ps_resource_view(struct wined3d_device *device,
 {
     TRACE("device %p, idx %u, view %p.\n", device, idx, view);
 
-    wined3d_device_set_shader_resource_view(device, WINED3D_SHADER_TYPE_PIXEL, idx, view);
+    wined3d_device_context_set_shader_resource_view(&device->immediate_context, WINED3D_SHADER_TYPE_PIXEL, idx, view);
 }
 
 struct wined3d_shader_resource_view * CDECL wined3d_device_get_ps_resource_view(const struct wined3d_device *device,
@@ -2206,21 +2617,21 @@ struct wined3d_shader_resource_view * CDECL wined3d_device_get_ps_resource_view(
 {
     TRACE("device %p, idx %u.\n", device, idx);
 
-    return wined3d_device_get_shader_resource_view(device, WINED3D_SHADER_TYPE_PIXEL, idx);
+    return wined3d_device_context_get_shader_resource_view(&device->immediate_context, WINED3D_SHADER_TYPE_PIXEL, idx);
 }
 
 void CDECL wined3d_device_set_ps_sampler(struct wined3d_device *device, UINT idx, struct wined3d_sampler *sampler)
 {
     TRACE("device %p, idx %u, sampler %p.\n", device, idx, sampler);
 
-    wined3d_device_set_sampler(device, WINED3D_SHADER_TYPE_PIXEL, idx, sampler);
+    wined3d_device_context_set_sampler(&device->immediate_context, WINED3D_SHADER_TYPE_PIXEL, idx, sampler);
 }
 
 struct wined3d_sampler * CDECL wined3d_device_get_ps_sampler(const struct wined3d_device *device, UINT idx)
 {
     TRACE("device %p, idx %u.\n", device, idx);
 
-    return wined3d_device_get_sampler(device, WINED3D_SHADER_TYPE_PIXEL, idx);
+    return wined3d_device_context_get_sampler(&device->immediate_context, WINED3D_SHADER_TYPE_PIXEL, idx);
 }
 
 static void wined3d_device_set_ps_consts_b(struct wined3d_device *device,
@@ -2279,26 +2690,16 @@ static void wined3d_device_set_ps_consts_f(struct wined3d_device *device,
 
 void CDECL wined3d_device_set_hull_shader(struct wined3d_device *device, struct wined3d_shader *shader)
 {
-    struct wined3d_shader *prev;
-
     TRACE("device %p, shader %p.\n", device, shader);
 
-    prev = device->state.shader[WINED3D_SHADER_TYPE_HULL];
-    if (shader == prev)
-        return;
-    if (shader)
-        wined3d_shader_incref(shader);
-    device->state.shader[WINED3D_SHADER_TYPE_HULL] = shader;
-    wined3d_cs_emit_set_shader(device->cs, WINED3D_SHADER_TYPE_HULL, shader);
-    if (prev)
-        wined3d_shader_decref(prev);
+    wined3d_device_context_set_shader(&device->immediate_context, WINED3D_SHADER_TYPE_HULL, shader);
 }
 
 struct wined3d_shader * CDECL wined3d_device_get_hull_shader(const struct wined3d_device *device)
 {
     TRACE("device %p.\n", device);
 
-    return device->state.shader[WINED3D_SHADER_TYPE_HULL];
+    return wined3d_device_context_get_shader(&device->immediate_context, WINED3D_SHADER_TYPE_HULL);
 }
 
 void CDECL wined3d_device_set_hs_resource_view(struct wined3d_device *device,
@@ -2306,7 +2707,7 @@ void CDECL wined3d_device_set_hs_resource_view(struct wined3d_device *device,
 {
     TRACE("device %p, idx %u, view %p.\n", device, idx, view);
 
-    wined3d_device_set_shader_resource_view(device, WINED3D_SHADER_TYPE_HULL, idx, view);
+    wined3d_device_context_set_shader_resource_view(&device->immediate_context, WINED3D_SHADER_TYPE_HULL, idx, view);
 }
 
 struct wined3d_shader_resource_view * CDECL wined3d_device_get_hs_resource_view(const struct wined3d_device *device,
@@ -2314,7 +2715,7 @@ struct wined3d_shader_resource_view * CDECL wined3d_device_get_hs_resource_view(
 {
     TRACE("device %p, idx %u.\n", device, idx);
 
-    return wined3d_device_get_shader_resource_view(device, WINED3D_SHADER_TYPE_HULL, idx);
+    return wined3d_device_context_get_shader_resource_view(&device->immediate_context, WINED3D_SHADER_TYPE_HULL, idx);
 }
 
 void CDECL wined3d_device_set_hs_sampler(struct wined3d_device *device,
@@ -2322,38 +2723,28 @@ void CDECL wined3d_device_set_hs_sampler(struct wined3d_device *device,
 {
     TRACE("device %p, idx %u, sampler %p.\n", device, idx, sampler);
 
-    wined3d_device_set_sampler(device, WINED3D_SHADER_TYPE_HULL, idx, sampler);
+    wined3d_device_context_set_sampler(&device->immediate_context, WINED3D_SHADER_TYPE_HULL, idx, sampler);
 }
 
 struct wined3d_sampler * CDECL wined3d_device_get_hs_sampler(const struct wined3d_device *device, unsigned int idx)
 {
     TRACE("device %p, idx %u.\n", device, idx);
 
-    return wined3d_device_get_sampler(device, WINED3D_SHADER_TYPE_HULL, idx);
+    return wined3d_device_context_get_sampler(&device->immediate_context, WINED3D_SHADER_TYPE_HULL, idx);
 }
 
 void CDECL wined3d_device_set_domain_shader(struct wined3d_device *device, struct wined3d_shader *shader)
 {
-    struct wined3d_shader *prev;
-
     TRACE("device %p, shader %p.\n", device, shader);
 
-    prev = device->state.shader[WINED3D_SHADER_TYPE_DOMAIN];
-    if (shader == prev)
-        return;
-    if (shader)
-        wined3d_shader_incref(shader);
-    device->state.shader[WINED3D_SHADER_TYPE_DOMAIN] = shader;
-    wined3d_cs_emit_set_shader(device->cs, WINED3D_SHADER_TYPE_DOMAIN, shader);
-    if (prev)
-        wined3d_shader_decref(prev);
+    wined3d_device_context_set_shader(&device->immediate_context, WINED3D_SHADER_TYPE_DOMAIN, shader);
 }
 
 struct wined3d_shader * CDECL wined3d_device_get_domain_shader(const struct wined3d_device *device)
 {
     TRACE("device %p.\n", device);
 
-    return device->state.shader[WINED3D_SHADER_TYPE_DOMAIN];
+    return wined3d_device_context_get_shader(&device->immediate_context, WINED3D_SHADER_TYPE_DOMAIN);
 }
 
 void CDECL wined3d_device_set_ds_resource_view(struct wined3d_device *device,
@@ -2361,7 +2752,7 @@ void CDECL wined3d_device_set_ds_resource_view(struct wined3d_device *device,
 {
     TRACE("device %p, idx %u, view %p.\n", device, idx, view);
 
-    wined3d_device_set_shader_resource_view(device, WINED3D_SHADER_TYPE_DOMAIN, idx, view);
+    wined3d_device_context_set_shader_resource_view(&device->immediate_context, WINED3D_SHADER_TYPE_DOMAIN, idx, view);
 }
 
 struct wined3d_shader_resource_view * CDECL wined3d_device_get_ds_resource_view(const struct wined3d_device *device,
@@ -2369,7 +2760,7 @@ struct wined3d_shader_resource_view * CDECL wined3d_device_get_ds_resource_view(
 {
     TRACE("device %p, idx %u.\n", device, idx);
 
-    return wined3d_device_get_shader_resource_view(device, WINED3D_SHADER_TYPE_DOMAIN, idx);
+    return wined3d_device_context_get_shader_resource_view(&device->immediate_context, WINED3D_SHADER_TYPE_DOMAIN, idx);
 }
 
 void CDECL wined3d_device_set_ds_sampler(struct wined3d_device *device,
@@ -2377,37 +2768,28 @@ void CDECL wined3d_device_set_ds_sampler(struct wined3d_device *device,
 {
     TRACE("device %p, idx %u, sampler %p.\n", device, idx, sampler);
 
-    wined3d_device_set_sampler(device, WINED3D_SHADER_TYPE_DOMAIN, idx, sampler);
+    wined3d_device_context_set_sampler(&device->immediate_context, WINED3D_SHADER_TYPE_DOMAIN, idx, sampler);
 }
 
 struct wined3d_sampler * CDECL wined3d_device_get_ds_sampler(const struct wined3d_device *device, unsigned int idx)
 {
     TRACE("device %p, idx %u.\n", device, idx);
 
-    return wined3d_device_get_sampler(device, WINED3D_SHADER_TYPE_DOMAIN, idx);
+    return wined3d_device_context_get_sampler(&device->immediate_context, WINED3D_SHADER_TYPE_DOMAIN, idx);
 }
 
 void CDECL wined3d_device_set_geometry_shader(struct wined3d_device *device, struct wined3d_shader *shader)
 {
-    struct wined3d_shader *prev = device->state.shader[WINED3D_SHADER_TYPE_GEOMETRY];
-
     TRACE("device %p, shader %p.\n", device, shader);
 
-    if (shader == prev)
-        return;
-    if (shader)
-        wined3d_shader_incref(shader);
-    device->state.shader[WINED3D_SHADER_TYPE_GEOMETRY] = shader;
-    wined3d_cs_emit_set_shader(device->cs, WINED3D_SHADER_TYPE_GEOMETRY, shader);
-    if (prev)
-        wined3d_shader_decref(prev);
+    wined3d_device_context_set_shader(&device->immediate_context, WINED3D_SHADER_TYPE_GEOMETRY, shader);
 }
 
 struct wined3d_shader * CDECL wined3d_device_get_geometry_shader(const struct wined3d_device *device)
 {
     TRACE("device %p.\n", device);
 
-    return device->state.shader[WINED3D_SHADER_TYPE_GEOMETRY];
+    return wined3d_device_context_get_shader(&device->immediate_context, WINED3D_SHADER_TYPE_GEOMETRY);
 }
 
 void CDECL wined3d_device_set_gs_resource_view(struct wined3d_device *device,
@@ -2415,7 +2797,8 @@ void CDECL wined3d_device_set_gs_resource_view(struct wined3d_device *device,
 {
     TRACE("device %p, idx %u, view %p.\n", device, idx, view);
 
-    wined3d_device_set_shader_resource_view(device, WINED3D_SHADER_TYPE_GEOMETRY, idx, view);
+    wined3d_device_context_set_shader_resource_view(&device->immediate_context,
+            WINED3D_SHADER_TYPE_GEOMETRY, idx, view);
 }
 
 struct wined3d_shader_resource_view * CDECL wined3d_device_get_gs_resource_view(const struct wined3d_device *device,
@@ -2423,45 +2806,36 @@ struct wined3d_shader_resource_view * CDECL wined3d_device_get_gs_resource_view(
 {
     TRACE("device %p, idx %u.\n", device, idx);
 
-    return wined3d_device_get_shader_resource_view(device, WINED3D_SHADER_TYPE_GEOMETRY, idx);
+    return wined3d_device_context_get_shader_resource_view(&device->immediate_context,
+            WINED3D_SHADER_TYPE_GEOMETRY, idx);
 }
 
 void CDECL wined3d_device_set_gs_sampler(struct wined3d_device *device, UINT idx, struct wined3d_sampler *sampler)
 {
     TRACE("device %p, idx %u, sampler %p.\n", device, idx, sampler);
 
-    wined3d_device_set_sampler(device, WINED3D_SHADER_TYPE_GEOMETRY, idx, sampler);
+    wined3d_device_context_set_sampler(&device->immediate_context, WINED3D_SHADER_TYPE_GEOMETRY, idx, sampler);
 }
 
 struct wined3d_sampler * CDECL wined3d_device_get_gs_sampler(const struct wined3d_device *device, UINT idx)
 {
     TRACE("device %p, idx %u.\n", device, idx);
 
-    return wined3d_device_get_sampler(device, WINED3D_SHADER_TYPE_GEOMETRY, idx);
+    return wined3d_device_context_get_sampler(&device->immediate_context, WINED3D_SHADER_TYPE_GEOMETRY, idx);
 }
-
-void CDECL wined3d_device_set_compute_shader(struct wined3d_device *device, struct wined3d_shader *shader)
-{
-    struct wined3d_shader *prev;
-
-    TRACE("device %p, shader %p.\n", device, shader);
-
-    prev = device->state.shader[WINED3D_SHADER_TYPE_COMPUTE];
-    if (shader == prev)
-        return;
-    if (shader)
-        wined3d_shader_incref(shader);
-    device->state.shader[WINED3D_SHADER_TYPE_COMPUTE] = shader;
-    wined3d_cs_emit_set_shader(device->cs, WINED3D_SHADER_TYPE_COMPUTE, shader);
-    if (prev)
-        wined3d_shader_decref(prev);
+
+void CDECL wined3d_device_set_compute_shader(struct wined3d_device *device, struct wined3d_shader *shader)
+{
+    TRACE("device %p, shader %p.\n", device, shader);
+
+    wined3d_device_context_set_shader(&device->immediate_context, WINED3D_SHADER_TYPE_COMPUTE, shader);
 }
 
 struct wined3d_shader * CDECL wined3d_device_get_compute_shader(const struct wined3d_device *device)
 {
     TRACE("device %p.\n", device);
 
-    return device->state.shader[WINED3D_SHADER_TYPE_COMPUTE];
+    return wined3d_device_context_get_shader(&device->immediate_context, WINED3D_SHADER_TYPE_COMPUTE);
 }
 
 void CDECL wined3d_device_set_cs_resource_view(struct wined3d_device *device,
@@ -2469,7 +2843,7 @@ void CDECL wined3d_device_set_cs_resource_view(struct wined3d_device *device,
 {
     TRACE("device %p, idx %u, view %p.\n", device, idx, view);
 
-    wined3d_device_set_shader_resource_view(device, WINED3D_SHADER_TYPE_COMPUTE, idx, view);
+    wined3d_device_context_set_shader_resource_view(&device->immediate_context, WINED3D_SHADER_TYPE_COMPUTE, idx, view);
 }
 
 struct wined3d_shader_resource_view * CDECL wined3d_device_get_cs_resource_view(const struct wined3d_device *device,
@@ -2477,7 +2851,8 @@ struct wined3d_shader_resource_view * CDECL wined3d_device_get_cs_resource_view(
 {
     TRACE("device %p, idx %u.\n", device, idx);
 
-    return wined3d_device_get_shader_resource_view(device, WINED3D_SHADER_TYPE_COMPUTE, idx);
+    return wined3d_device_context_get_shader_resource_view(&device->immediate_context,
+            WINED3D_SHADER_TYPE_COMPUTE, idx);
 }
 
 void CDECL wined3d_device_set_cs_sampler(struct wined3d_device *device,
@@ -2485,50 +2860,55 @@ void CDECL wined3d_device_set_cs_sampler(struct wined3d_device *device,
 {
     TRACE("device %p, idx %u, sampler %p.\n", device, idx, sampler);
 
-    wined3d_device_set_sampler(device, WINED3D_SHADER_TYPE_COMPUTE, idx, sampler);
+    wined3d_device_context_set_sampler(&device->immediate_context, WINED3D_SHADER_TYPE_COMPUTE, idx, sampler);
 }
 
 struct wined3d_sampler * CDECL wined3d_device_get_cs_sampler(const struct wined3d_device *device, unsigned int idx)
 {
     TRACE("device %p, idx %u.\n", device, idx);
 
-    return wined3d_device_get_sampler(device, WINED3D_SHADER_TYPE_COMPUTE, idx);
+    return wined3d_device_context_get_sampler(&device->immediate_context, WINED3D_SHADER_TYPE_COMPUTE, idx);
 }
 
-static void wined3d_device_set_pipeline_unordered_access_view(struct wined3d_device *device,
+void CDECL wined3d_device_context_set_unordered_access_view(struct wined3d_device_context *context,
         enum wined3d_pipeline pipeline, unsigned int idx, struct wined3d_unordered_access_view *uav,
         unsigned int initial_count)
 {
     struct wined3d_unordered_access_view *prev;
 
+    TRACE("context %p, pipeline %#x, idx %u, uav %p, initial_count %u.\n",
+            context, pipeline, idx, uav, initial_count);
+
     if (idx >= MAX_UNORDERED_ACCESS_VIEWS)
     {
         WARN("Invalid UAV index %u.\n", idx);
         return;
     }
 
-    prev = device->state.unordered_access_view[pipeline][idx];
+    prev = context->state->unordered_access_view[pipeline][idx];
     if (uav == prev && initial_count == ~0u)
         return;
 
     if (uav)
         wined3d_unordered_access_view_incref(uav);
-    device->state.unordered_access_view[pipeline][idx] = uav;
-    wined3d_cs_emit_set_unordered_access_view(device->cs, pipeline, idx, uav, initial_count);
+    context->state->unordered_access_view[pipeline][idx] = uav;
+    wined3d_cs_emit_set_unordered_access_view(context->cs, pipeline, idx, uav, initial_count);
     if (prev)
         wined3d_unordered_access_view_decref(prev);
 }
 
-static struct wined3d_unordered_access_view *wined3d_device_get_pipeline_unordered_access_view(
-        const struct wined3d_device *device, enum wined3d_pipeline pipeline, unsigned int idx)
+struct wined3d_unordered_access_view * CDECL wined3d_device_context_get_unordered_access_view(
+        const struct wined3d_device_context *context, enum wined3d_pipeline pipeline, unsigned int idx)
 {
+    TRACE("context %p, pipeline %#x, idx %u.\n", context, pipeline, idx);
+
     if (idx >= MAX_UNORDERED_ACCESS_VIEWS)
     {
         WARN("Invalid UAV index %u.\n", idx);
         return NULL;
     }
 
-    return device->state.unordered_access_view[pipeline][idx];
+    return context->state->unordered_access_view[pipeline][idx];
 }
 
 void CDECL wined3d_device_set_cs_uav(struct wined3d_device *device, unsigned int idx,
@@ -2536,7 +2916,8 @@ void CDECL wined3d_device_set_cs_uav(struct wined3d_device *device, unsigned int
 {
     TRACE("device %p, idx %u, uav %p, initial_count %#x.\n", device, idx, uav, initial_count);
 
-    wined3d_device_set_pipeline_unordered_access_view(device, WINED3D_PIPELINE_COMPUTE, idx, uav, initial_count);
+    wined3d_device_context_set_unordered_access_view(&device->immediate_context,
+            WINED3D_PIPELINE_COMPUTE, idx, uav, initial_count);
 }
 
 struct wined3d_unordered_access_view * CDECL wined3d_device_get_cs_uav(const struct wined3d_device *device,
@@ -2544,7 +2925,7 @@ struct wined3d_unordered_access_view * CDECL wined3d_device_get_cs_uav(const str
 {
     TRACE("device %p, idx %u.\n", device, idx);
 
-    return wined3d_device_get_pipeline_unordered_access_view(device, WINED3D_PIPELINE_COMPUTE, idx);
+    return wined3d_device_context_get_unordered_access_view(&device->immediate_context, WINED3D_PIPELINE_COMPUTE, idx);
 }
 
 void CDECL wined3d_device_set_unordered_access_view(struct wined3d_device *device,
@@ -2552,7 +2933,8 @@ void CDECL wined3d_device_set_unordered_access_view(struct wined3d_device *devic
 {
     TRACE("device %p, idx %u, uav %p, initial_count %#x.\n", device, idx, uav, initial_count);
 
-    wined3d_device_set_pipeline_unordered_access_view(device, WINED3D_PIPELINE_GRAPHICS, idx, uav, initial_count);
+    wined3d_device_context_set_unordered_access_view(&device->immediate_context,
+            WINED3D_PIPELINE_GRAPHICS, idx, uav, initial_count);
 }
 
 struct wined3d_unordered_access_view * CDECL wined3d_device_get_unordered_access_view(
@@ -2560,7 +2942,7 @@ struct wined3d_unordered_access_view * CDECL wined3d_device_get_unordered_access
 {
     TRACE("device %p, idx %u.\n", device, idx);
 
-    return wined3d_device_get_pipeline_unordered_access_view(device, WINED3D_PIPELINE_GRAPHICS, idx);
+    return wined3d_device_context_get_unordered_access_view(&device->immediate_context, WINED3D_PIPELINE_GRAPHICS, idx);
 }
 
 void CDECL wined3d_device_set_max_frame_latency(struct wined3d_device *device, unsigned int latency)
@@ -3539,6 +3921,7 @@ static void wined3d_device_set_texture_stage_state(struct wined3d_device *device
     if (value == device->state.texture_states[stage][state])
     {
         TRACE("Application is setting the old value over, nothing to do.\n");
+        ++device->cs->redundant_state_count;
         return;
     }
 
@@ -3567,6 +3950,7 @@ static void wined3d_device_set_texture(struct wined3d_device *device,
     if (texture == prev)
     {
         TRACE("App is setting the same texture again, nothing to do.\n");
+        ++device->cs->redundant_state_count;
         return;
     }
 
@@ -4067,33 +4451,58 @@ HRESULT CDECL wined3d_device_clear(struct wined3d_device *device, DWORD rect_cou
     return WINED3D_OK;
 }
 
-void CDECL wined3d_device_set_predication(struct wined3d_device *device,
+void CDECL wined3d_device_context_set_predication(struct wined3d_device_context *context,
         struct wined3d_query *predicate, BOOL value)
 {
     struct wined3d_query *prev;
 
-    TRACE("device %p, predicate %p, value %#x.\n", device, predicate, value);
+    TRACE("context %p, predicate %p, value %#x.\n", context, predicate, value);
 
-    prev = device->state.predicate;
+    prev = context->state->predicate;
     if (predicate)
     {
         FIXME("Predicated rendering not implemented.\n");
         wined3d_query_incref(predicate);
     }
-    device->state.predicate = predicate;
-    device->state.predicate_value = value;
-    wined3d_cs_emit_set_predication(device->cs, predicate, value);
+    context->state->predicate = predicate;
+    context->state->predicate_value = value;
+    wined3d_cs_emit_set_predication(context->cs, predicate, value);
     if (prev)
         wined3d_query_decref(prev);
 }
 
+void CDECL wined3d_device_set_predication(struct wined3d_device *device,
+        struct wined3d_query *predicate, BOOL value)
+{
+    TRACE("device %p, predicate %p, value %#x.\n", device, predicate, value);
+
+    wined3d_device_context_set_predication(&device->immediate_context, predicate, value);
+}
+
+struct wined3d_query * CDECL wined3d_device_context_get_predication(const struct wined3d_device_context *context,
+        BOOL *value)
+{
+    TRACE("context %p, value %p.\n", context, value);
+
+    if (value)
+        *value = context->state->predicate_value;
+    return context->state->predicate;
+}
+
 struct wined3d_query * CDECL wined3d_device_get_predication(struct wined3d_device *device, BOOL *value)
 {
     TRACE("device %p, value %p.\n", device, value);
 
-    if (value)
-        *value = device->state.predicate_value;
-    return device->state.predicate;
+    return wined3d_device_context_get_predication(&device->immediate_context, value);
+}
+
+void CDECL wined3d_device_context_dispatch(struct wined3d_device_context *context,
+        unsigned int group_count_x, unsigned int group_count_y, unsigned int group_count_z)
+{
+    TRACE("context %p, group_count_x %u, group_count_y %u, group_count_z %u.\n",
+            context, group_count_x, group_count_y, group_count_z);
+
+    wined3d_cs_emit_dispatch(context->cs, group_count_x, group_count_y, group_count_z);
 }
 
 void CDECL wined3d_device_dispatch_compute(struct wined3d_device *device,
@@ -4102,7 +4511,15 @@ void CDECL wined3d_device_dispatch_compute(struct wined3d_device *device,
     TRACE("device %p, group_count_x %u, group_count_y %u, group_count_z %u.\n",
             device, group_count_x, group_count_y, group_count_z);
 
-    wined3d_cs_emit_dispatch(device->cs, group_count_x, group_count_y, group_count_z);
+    wined3d_device_context_dispatch(&device->immediate_context, group_count_x, group_count_y, group_count_z);
+}
+
+void CDECL wined3d_device_context_dispatch_indirect(struct wined3d_device_context *context,
+        struct wined3d_buffer *buffer, unsigned int offset)
+{
+    TRACE("context %p, buffer %p, offset %u.\n", context, buffer, offset);
+
+    wined3d_cs_emit_dispatch_indirect(context->cs, buffer, offset);
 }
 
 void CDECL wined3d_device_dispatch_compute_indirect(struct wined3d_device *device,
@@ -4110,7 +4527,17 @@ void CDECL wined3d_device_dispatch_compute_indirect(struct wined3d_device *devic
 {
     TRACE("device %p, buffer %p, offset %u.\n", device, buffer, offset);
 
-    wined3d_cs_emit_dispatch_indirect(device->cs, buffer, offset);
+    wined3d_device_context_dispatch_indirect(&device->immediate_context, buffer, offset);
+}
+
+void CDECL wined3d_device_context_set_primitive_type(struct wined3d_device_context *context,
+        enum wined3d_primitive_type primitive_type, unsigned int patch_vertex_count)
+{
+    TRACE("context %p, primitive_type %s, patch_vertex_count %u.\n",
+            context, debug_d3dprimitivetype(primitive_type), patch_vertex_count);
+
+    context->state->primitive_type = primitive_type;
+    context->state->patch_vertex_count = patch_vertex_count;
 }
 
 void CDECL wined3d_device_set_primitive_type(struct wined3d_device *device,
@@ -4119,8 +4546,20 @@ void CDECL wined3d_device_set_primitive_type(struct wined3d_device *device,
     TRACE("device %p, primitive_type %s, patch_vertex_count %u.\n",
             device, debug_d3dprimitivetype(primitive_type), patch_vertex_count);
 
-    device->state.primitive_type = primitive_type;
-    device->state.patch_vertex_count = patch_vertex_count;
+    wined3d_device_context_set_primitive_type(&device->immediate_context, primitive_type, patch_vertex_count);
+}
+
+void CDECL wined3d_device_context_get_primitive_type(const struct wined3d_device_context *context,
+        enum wined3d_primitive_type *primitive_type, unsigned int *patch_vertex_count)
+{
+    TRACE("context %p, primitive_type %p, patch_vertex_count %p.\n",
+            context, primitive_type, patch_vertex_count);
+
+    *primitive_type = context->state->primitive_type;
+    if (patch_vertex_count)
+        *patch_vertex_count = context->state->patch_vertex_count;
+
+    TRACE("Returning %s.\n", debug_d3dprimitivetype(*primitive_type));
 }
 
 void CDECL wined3d_device_get_primitive_type(const struct wined3d_device *device,
@@ -4129,11 +4568,38 @@ void CDECL wined3d_device_get_primitive_type(const struct wined3d_device *device
     TRACE("device %p, primitive_type %p, patch_vertex_count %p.\n",
             device, primitive_type, patch_vertex_count);
 
-    *primitive_type = device->state.primitive_type;
-    if (patch_vertex_count)
-        *patch_vertex_count = device->state.patch_vertex_count;
+    wined3d_device_context_get_primitive_type(&device->immediate_context, primitive_type, patch_vertex_count);
+}
 
-    TRACE("Returning %s.\n", debug_d3dprimitivetype(*primitive_type));
+void CDECL wined3d_device_context_draw(struct wined3d_device_context *context, int base_vertex_idx,
+        unsigned int start_idx, unsigned int index_count, unsigned int start_instance,
+        unsigned int instance_count, BOOL indexed)
+{
+    const struct wined3d_state *state = context->state;
+
+    TRACE("context %p, base_vertex_idx %d, start_idx %u, index_count %u, "
+            "start_instance %u, instance_count %u, indexed %#x.\n",
+            context, base_vertex_idx, start_idx, index_count, start_instance, instance_count, indexed);
+
+    if (indexed && !state->index_buffer)
+    {
+        WARN("Called without a valid index buffer set, returning.\n");
+        return;
+    }
+
+    wined3d_cs_emit_draw(context->cs, state->primitive_type, state->patch_vertex_count,
+            base_vertex_idx, start_idx, index_count, start_instance, instance_count, indexed);
+}
+
+void CDECL wined3d_device_context_draw_indirect(struct wined3d_device_context *context,
+        struct wined3d_buffer *buffer, unsigned int offset, BOOL indexed)
+{
+    const struct wined3d_state *state = context->state;
+
+    TRACE("context %p, buffer %p, offset %u, indexed %#x.\n", context, buffer, offset, indexed);
+
+    wined3d_cs_emit_draw_indirect(context->cs, state->primitive_type,
+            state->patch_vertex_count, buffer, offset, indexed);
 }
 
 HRESULT CDECL wined3d_device_draw_primitive(struct wined3d_device *device, UINT start_vertex, UINT vertex_count)
@@ -4498,23 +4964,32 @@ float CDECL wined3d_device_get_npatch_mode(const struct wined3d_device *device)
     return 0.0f;
 }
 
+void CDECL wined3d_device_context_copy_uav_counter(struct wined3d_device_context *context,
+        struct wined3d_buffer *dst_buffer, unsigned int offset, struct wined3d_unordered_access_view *uav)
+{
+    TRACE("context %p, dst_buffer %p, offset %u, uav %p.\n",
+            context, dst_buffer, offset, uav);
+
+    wined3d_cs_emit_copy_uav_counter(context->cs, dst_buffer, offset, uav);
+}
+
 void CDECL wined3d_device_copy_uav_counter(struct wined3d_device *device,
         struct wined3d_buffer *dst_buffer, unsigned int offset, struct wined3d_unordered_access_view *uav)
 {
     TRACE("device %p, dst_buffer %p, offset %u, uav %p.\n",
             device, dst_buffer, offset, uav);
 
-    wined3d_cs_emit_copy_uav_counter(device->cs, dst_buffer, offset, uav);
+    wined3d_device_context_copy_uav_counter(&device->immediate_context, dst_buffer, offset, uav);
 }
 
-void CDECL wined3d_device_copy_resource(struct wined3d_device *device,
+void CDECL wined3d_device_context_copy_resource(struct wined3d_device_context *context,
         struct wined3d_resource *dst_resource, struct wined3d_resource *src_resource)
 {
     struct wined3d_texture *dst_texture, *src_texture;
     struct wined3d_box box;
     unsigned int i, j;
 
-    TRACE("device %p, dst_resource %p, src_resource %p.\n", device, dst_resource, src_resource);
+    TRACE("context %p, dst_resource %p, src_resource %p.\n", context, dst_resource, src_resource);
 
     if (src_resource == dst_resource)
     {
@@ -4552,7 +5027,7 @@ void CDECL wined3d_device_copy_resource(struct wined3d_device *device,
     if (dst_resource->type == WINED3D_RTYPE_BUFFER)
     {
         wined3d_box_set(&box, 0, 0, src_resource->size, 1, 0, 1);
-        wined3d_cs_emit_blt_sub_resource(device->cs, dst_resource, 0, &box,
+        wined3d_cs_emit_blt_sub_resource(context->cs, dst_resource, 0, &box,
                 src_resource, 0, &box, WINED3D_BLT_RAW, NULL, WINED3D_TEXF_POINT);
         return;
     }
@@ -4576,22 +5051,30 @@ void CDECL wined3d_device_copy_resource(struct wined3d_device *device,
         {
             unsigned int idx = j * dst_texture->level_count + i;
 
-            wined3d_cs_emit_blt_sub_resource(device->cs, dst_resource, idx, &box,
+            wined3d_cs_emit_blt_sub_resource(context->cs, dst_resource, idx, &box,
                     src_resource, idx, &box, WINED3D_BLT_RAW, NULL, WINED3D_TEXF_POINT);
         }
     }
 }
 
-HRESULT CDECL wined3d_device_copy_sub_resource_region(struct wined3d_device *device,
+void CDECL wined3d_device_copy_resource(struct wined3d_device *device,
+        struct wined3d_resource *dst_resource, struct wined3d_resource *src_resource)
+{
+    TRACE("device %p, dst_resource %p, src_resource %p.\n", device, dst_resource, src_resource);
+
+    wined3d_device_context_copy_resource(&device->immediate_context, dst_resource, src_resource);
+}
+
+HRESULT CDECL wined3d_device_context_copy_sub_resource_region(struct wined3d_device_context *context,
         struct wined3d_resource *dst_resource, unsigned int dst_sub_resource_idx, unsigned int dst_x,
         unsigned int dst_y, unsigned int dst_z, struct wined3d_resource *src_resource,
         unsigned int src_sub_resource_idx, const struct wined3d_box *src_box, unsigned int flags)
 {
     struct wined3d_box dst_box, b;
 
-    TRACE("device %p, dst_resource %p, dst_sub_resource_idx %u, dst_x %u, dst_y %u, dst_z %u, "
+    TRACE("context %p, dst_resource %p, dst_sub_resource_idx %u, dst_x %u, dst_y %u, dst_z %u, "
             "src_resource %p, src_sub_resource_idx %u, src_box %s, flags %#x.\n",
-            device, dst_resource, dst_sub_resource_idx, dst_x, dst_y, dst_z,
+            context, dst_resource, dst_sub_resource_idx, dst_x, dst_y, dst_z,
             src_resource, src_sub_resource_idx, debug_box(src_box), flags);
 
     if (flags)
@@ -4722,30 +5205,35 @@ HRESULT CDECL wined3d_device_copy_sub_resource_region(struct wined3d_device *dev
         }
     }
 
-    wined3d_cs_emit_blt_sub_resource(device->cs, dst_resource, dst_sub_resource_idx, &dst_box,
+    wined3d_cs_emit_blt_sub_resource(context->cs, dst_resource, dst_sub_resource_idx, &dst_box,
             src_resource, src_sub_resource_idx, src_box, WINED3D_BLT_RAW, NULL, WINED3D_TEXF_POINT);
 
     return WINED3D_OK;
 }
 
-void CDECL wined3d_device_update_sub_resource(struct wined3d_device *device, struct wined3d_resource *resource,
-        unsigned int sub_resource_idx, const struct wined3d_box *box, const void *data, unsigned int row_pitch,
-        unsigned int depth_pitch, unsigned int flags)
+HRESULT CDECL wined3d_device_copy_sub_resource_region(struct wined3d_device *device,
+        struct wined3d_resource *dst_resource, unsigned int dst_sub_resource_idx, unsigned int dst_x,
+        unsigned int dst_y, unsigned int dst_z, struct wined3d_resource *src_resource,
+        unsigned int src_sub_resource_idx, const struct wined3d_box *src_box, unsigned int flags)
 {
-    unsigned int width, height, depth;
-    struct wined3d_box b;
+    TRACE("device %p, dst_resource %p, dst_sub_resource_idx %u, dst_x %u, dst_y %u, dst_z %u, "
+            "src_resource %p, src_sub_resource_idx %u, src_box %s, flags %#x.\n",
+            device, dst_resource, dst_sub_resource_idx, dst_x, dst_y, dst_z,
+            src_resource, src_sub_resource_idx, debug_box(src_box), flags);
 
-    TRACE("device %p, resource %p, sub_resource_idx %u, box %s, data %p, row_pitch %u, depth_pitch %u, "
-            "flags %#x.\n",
-            device, resource, sub_resource_idx, debug_box(box), data, row_pitch, depth_pitch, flags);
+    return wined3d_device_context_copy_sub_resource_region(&device->immediate_context, dst_resource,
+            dst_sub_resource_idx, dst_x, dst_y, dst_z, src_resource, src_sub_resource_idx, src_box, flags);
+}
 
-    if (flags)
-        FIXME("Ignoring flags %#x.\n", flags);
+static BOOL wined3d_resource_check_update_box(struct wined3d_resource *resource,
+        unsigned int sub_resource_idx, const struct wined3d_box **box, struct wined3d_box *b)
+{
+    unsigned int width, height, depth;
 
     if (!(resource->access & WINED3D_RESOURCE_ACCESS_GPU))
     {
         WARN("Resource %p is not GPU accessible.\n", resource);
-        return;
+        return FALSE;
     }
 
     if (resource->type == WINED3D_RTYPE_BUFFER)
@@ -4753,7 +5241,7 @@ void CDECL wined3d_device_update_sub_resource(struct wined3d_device *device, str
         if (sub_resource_idx > 0)
         {
             WARN("Invalid sub_resource_idx %u.\n", sub_resource_idx);
-            return;
+            return FALSE;
         }
 
         width = resource->size;
@@ -4768,7 +5256,7 @@ void CDECL wined3d_device_update_sub_resource(struct wined3d_device *device, str
         if (sub_resource_idx >= texture->level_count * texture->layer_count)
         {
             WARN("Invalid sub_resource_idx %u.\n", sub_resource_idx);
-            return;
+            return FALSE;
         }
 
         level = sub_resource_idx % texture->level_count;
@@ -4777,25 +5265,59 @@ void CDECL wined3d_device_update_sub_resource(struct wined3d_device *device, str
         depth = wined3d_texture_get_level_depth(texture, level);
     }
 
-    if (!box)
+    if (!*box)
     {
-        wined3d_box_set(&b, 0, 0, width, height, 0, depth);
-        box = &b;
+        wined3d_box_set(b, 0, 0, width, height, 0, depth);
+        *box = b;
     }
-    else if (box->left >= box->right || box->right > width
-            || box->top >= box->bottom || box->bottom > height
-            || box->front >= box->back || box->back > depth)
+    else if ((*box)->left >= (*box)->right || (*box)->right > width
+            || (*box)->top >= (*box)->bottom || (*box)->bottom > height
+            || (*box)->front >= (*box)->back || (*box)->back > depth)
     {
-        WARN("Invalid box %s specified.\n", debug_box(box));
-        return;
+        WARN("Invalid box %s specified.\n", debug_box(*box));
+        return FALSE;
     }
 
-    wined3d_resource_wait_idle(resource);
+    return TRUE;
+}
+
+void CDECL wined3d_device_context_update_sub_resource(struct wined3d_device_context *context,
+        struct wined3d_resource *resource, unsigned int sub_resource_idx, const struct wined3d_box *box,
+        const void *data, unsigned int row_pitch, unsigned int depth_pitch, unsigned int flags)
+{
+    struct wined3d_box b;
+
+    TRACE("context %p, resource %p, sub_resource_idx %u, box %s, data %p, row_pitch %u, depth_pitch %u, "
+            "flags %#x.\n",
+            context, resource, sub_resource_idx, debug_box(box), data, row_pitch, depth_pitch, flags);
+
+    if (flags)
+        FIXME("Ignoring flags %#x.\n", flags);
+
+    if (!wined3d_resource_check_update_box(resource, sub_resource_idx, &box, &b))
+        return;
 
-    wined3d_cs_emit_update_sub_resource(device->cs, resource, sub_resource_idx, box, data, row_pitch, depth_pitch);
+    /* Deferred contexts copy the data; it's only uploaded when the command
+     * list is executed. */
+    if (context == &context->device->immediate_context)
+        wined3d_resource_wait_idle(resource);
+
+    wined3d_cs_emit_update_sub_resource(context->cs, resource, sub_resource_idx, box, data, row_pitch, depth_pitch);
 }
 
-void CDECL wined3d_device_resolve_sub_resource(struct wined3d_device *device,
+void CDECL wined3d_device_update_sub_resource(struct wined3d_device *device, struct wined3d_resource *resource,
+        unsigned int sub_resource_idx, const struct wined3d_box *box, const void *data, unsigned int row_pitch,
+        unsigned int depth_pitch, unsigned int flags)
+{
+    TRACE("device %p, resource %p, sub_resource_idx %u, box %s, data %p, row_pitch %u, depth_pitch %u, "
+            "flags %#x.\n",
+            device, resource, sub_resource_idx, debug_box(box), data, row_pitch, depth_pitch, flags);
+
+    wined3d_device_context_update_sub_resource(&device->immediate_context, resource, sub_resource_idx,
+            box, data, row_pitch, depth_pitch, flags);
+}
+
+void CDECL wined3d_device_context_resolve_sub_resource(struct wined3d_device_context *context,
         struct wined3d_resource *dst_resource, unsigned int dst_sub_resource_idx,
         struct wined3d_resource *src_resource, unsigned int src_sub_resource_idx,
         enum wined3d_format_id format_id)
@@ -4804,9 +5326,9 @@ void CDECL wined3d_device_resolve_sub_resource(struct wined3d_device *device,
     unsigned int dst_level, src_level;
     RECT dst_rect, src_rect;
 
-    TRACE("device %p, dst_resource %p, dst_sub_resource_idx %u, "
+    TRACE("context %p, dst_resource %p, dst_sub_resource_idx %u, "
             "src_resource %p, src_sub_resource_idx %u, format %s.\n",
-            device, dst_resource, dst_sub_resource_idx,
+            context, dst_resource, dst_sub_resource_idx,
             src_resource, src_sub_resource_idx, debug_d3dformat(format_id));
 
     if (wined3d_format_is_typeless(dst_resource->format)
@@ -4837,19 +5359,33 @@ void CDECL wined3d_device_resolve_sub_resource(struct wined3d_device *device,
     src_level = src_sub_resource_idx % src_texture->level_count;
     SetRect(&src_rect, 0, 0, wined3d_texture_get_level_width(src_texture, src_level),
             wined3d_texture_get_level_height(src_texture, src_level));
-    wined3d_texture_blt(dst_texture, dst_sub_resource_idx, &dst_rect,
+    wined3d_device_context_blt(context, dst_texture, dst_sub_resource_idx, &dst_rect,
             src_texture, src_sub_resource_idx, &src_rect, 0, NULL, WINED3D_TEXF_POINT);
 }
 
-HRESULT CDECL wined3d_device_clear_rendertarget_view(struct wined3d_device *device,
+void CDECL wined3d_device_resolve_sub_resource(struct wined3d_device *device,
+        struct wined3d_resource *dst_resource, unsigned int dst_sub_resource_idx,
+        struct wined3d_resource *src_resource, unsigned int src_sub_resource_idx,
+        enum wined3d_format_id format_id)
+{
+    TRACE("device %p, dst_resource %p, dst_sub_resource_idx %u, "
+            "src_resource %p, src_sub_resource_idx %u, format %s.\n",
+            device, dst_resource, dst_sub_resource_idx,
+            src_resource, src_sub_resource_idx, debug_d3dformat(format_id));
+
+    wined3d_device_context_resolve_sub_resource(&device->immediate_context, dst_resource, dst_sub_resource_idx,
+            src_resource, src_sub_resource_idx, format_id);
+}
+
+HRESULT CDECL wined3d_device_context_clear_rendertarget_view(struct wined3d_device_context *context,
         struct wined3d_rendertarget_view *view, const RECT *rect, DWORD flags,
         const struct wined3d_color *color, float depth, DWORD stencil)
 {
     struct wined3d_resource *resource;
     RECT r;
 
-    TRACE("device %p, view %p, rect %s, flags %#x, color %s, depth %.8e, stencil %u.\n",
-            device, view, wine_dbgstr_rect(rect), flags, debug_color(color), depth, stencil);
+    TRACE("context %p, view %p, rect %s, flags %#x, color %s, depth %.8e, stencil %u.\n",
+            context, view, wine_dbgstr_rect(rect), flags, debug_color(color), depth, stencil);
 
     if (!flags)
         return WINED3D_OK;
@@ -4883,44 +5419,215 @@ HRESULT CDECL wined3d_device_clear_rendertarget_view(struct wined3d_device *devi
             return hr;
     }
 
-    wined3d_cs_emit_clear_rendertarget_view(device->cs, view, rect, flags, color, depth, stencil);
+    wined3d_cs_emit_clear_rendertarget_view(context->cs, view, rect, flags, color, depth, stencil);
 
     return WINED3D_OK;
 }
 
+HRESULT CDECL wined3d_device_clear_rendertarget_view(struct wined3d_device *device,
+        struct wined3d_rendertarget_view *view, const RECT *rect, DWORD flags,
+        const struct wined3d_color *color, float depth, DWORD stencil)
+{
+    TRACE("device %p, view %p, rect %s, flags %#x, color %s, depth %.8e, stencil %u.\n",
+            device, view, wine_dbgstr_rect(rect), flags, debug_color(color), depth, stencil);
+
+    return wined3d_device_context_clear_rendertarget_view(&device->immediate_context,
+            view, rect, flags, color, depth, stencil);
+}
+
+void CDECL wined3d_device_context_clear_uav_uint(struct wined3d_device_context *context,
+        struct wined3d_unordered_access_view *view, const struct wined3d_uvec4 *clear_value)
+{
+    TRACE("context %p, view %p, clear_value %s.\n", context, view, debug_uvec4(clear_value));
+
+    wined3d_cs_emit_clear_unordered_access_view_uint(context->cs, view, clear_value);
+}
+
 void CDECL wined3d_device_clear_unordered_access_view_uint(struct wined3d_device *device,
         struct wined3d_unordered_access_view *view, const struct wined3d_uvec4 *clear_value)
 {
     TRACE("device %p, view %p, clear_value %s.\n", device, view, debug_uvec4(clear_value));
 
-    wined3d_cs_emit_clear_unordered_access_view_uint(device->cs, view, clear_value);
+    wined3d_device_context_clear_uav_uint(&device->immediate_context, view, clear_value);
 }
 
-struct wined3d_rendertarget_view * CDECL wined3d_device_get_rendertarget_view(const struct wined3d_device *device,
-        unsigned int view_idx)
+void wined3d_device_context_reset_app_state(struct wined3d_device_context *context)
+{
+    struct wined3d_depth_stencil_state *depth_stencil_state;
+    struct wined3d_rasterizer_state *rasterizer_state;
+    struct wined3d_state *state = context->state;
+    struct wined3d_rendertarget_view *view;
+    struct wined3d_query *predicate;
+    DWORD flags = state->flags;
+    unsigned int i;
+
+    for (i = 0; i < ARRAY_SIZE(state->fb.render_targets); ++i)
+    {
+        if ((view = state->fb.render_targets[i]))
+        {
+            state->fb.render_targets[i] = NULL;
+            if (!(flags & WINED3D_STATE_NO_BIND_COUNT))
+                wined3d_rtv_bind_count_dec(view);
+            wined3d_rendertarget_view_decref(view);
+        }
+    }
+    if ((view = state->fb.depth_stencil))
+    {
+        state->fb.depth_stencil = NULL;
+        wined3d_rendertarget_view_decref(view);
+    }
+    if ((rasterizer_state = state->rasterizer_state))
+    {
+        state->rasterizer_state = NULL;
+        wined3d_rasterizer_state_decref(rasterizer_state);
+    }
+    if ((depth_stencil_state = state->depth_stencil_state))
+    {
+        state->depth_stencil_state = NULL;
+        wined3d_depth_stencil_state_decref(depth_stencil_state);
+    }
+    if ((predicate = state->predicate))
+    {
+        state->predicate = NULL;
+        wined3d_query_decref(predicate);
+    }
+
+    state_cleanup(state);
+    memset(state, 0, sizeof(*state));
+    state_init(state, &context->device->adapter->d3d_info, flags);
+}
+
+void CDECL wined3d_device_context_reset_state(struct wined3d_device_context *context)
+{
+    TRACE("context %p.\n", context);
+
+    wined3d_device_context_reset_app_state(context);
+    wined3d_cs_emit_reset_state(context->cs, true);
+}
+
+void CDECL wined3d_device_context_issue_query(struct wined3d_device_context *context,
+        struct wined3d_query *query, DWORD flags)
+{
+    TRACE("context %p, query %p, flags %#x.\n", context, query, flags);
+
+    context->ops->issue_query(context, query, flags);
+}
+
+HRESULT CDECL wined3d_device_context_map(struct wined3d_device_context *context,
+        struct wined3d_resource *resource, unsigned int sub_resource_idx,
+        struct wined3d_map_desc *map_desc, const struct wined3d_box *box, DWORD flags)
+{
+    TRACE("context %p, resource %p, sub_resource_idx %u, map_desc %p, box %s, flags %#x.\n",
+            context, resource, sub_resource_idx, map_desc, debug_box(box), flags);
+
+    return context->ops->map(context, resource, sub_resource_idx, map_desc, box, flags);
+}
+
+HRESULT CDECL wined3d_device_context_unmap(struct wined3d_device_context *context,
+        struct wined3d_resource *resource, unsigned int sub_resource_idx)
+{
+    TRACE("context %p, resource %p, sub_resource_idx %u.\n", context, resource, sub_resource_idx);
+
+    return context->ops->unmap(context, resource, sub_resource_idx);
+}
+
+void CDECL wined3d_device_context_execute_command_list(struct wined3d_device_context *context,
+        struct wined3d_command_list *list, BOOL restore_state)
+{
+    TRACE("context %p, list %p, restore_state %#x.\n", context, list, restore_state);
+
+    context->ops->execute_command_list(context, list, restore_state);
+}
+
+struct wined3d_device_context * CDECL wined3d_device_get_immediate_context(struct wined3d_device *device)
+{
+    TRACE("device %p.\n", device);
+
+    return &device->immediate_context;
+}
+
+static HRESULT wined3d_immediate_context_map(struct wined3d_device_context *context,
+        struct wined3d_resource *resource, unsigned int sub_resource_idx,
+        struct wined3d_map_desc *map_desc, const struct wined3d_box *box, DWORD flags)
+{
+    return wined3d_resource_map(resource, sub_resource_idx, map_desc, box, flags);
+}
+
+static HRESULT wined3d_immediate_context_unmap(struct wined3d_device_context *context,
+        struct wined3d_resource *resource, unsigned int sub_resource_idx)
+{
+    return wined3d_resource_unmap(resource, sub_resource_idx);
+}
+
+static void wined3d_immediate_context_issue_query(struct wined3d_device_context *context,
+        struct wined3d_query *query, DWORD flags)
+{
+    wined3d_query_update_issued(query, flags);
+    wined3d_cs_emit_query_issue(context->cs, query, flags);
+}
+
+static void wined3d_immediate_context_execute_command_list(struct wined3d_device_context *context,
+        struct wined3d_command_list *list, BOOL restore_state)
+{
+    wined3d_cs_emit_execute_command_list(context->cs, list);
+
+    /* Command lists leave the command stream in an undefined state. Either
+     * bring it back in line with the device state, or reset both. */
+    if (restore_state)
+        wined3d_cs_emit_restore_state(context->cs, context->state);
+    else
+        wined3d_device_context_reset_state(context);
+}
+
+static const struct wined3d_device_context_ops wined3d_immediate_context_ops =
+{
+    wined3d_immediate_context_map,
+    wined3d_immediate_context_unmap,
+    wined3d_immediate_context_issue_query,
+    wined3d_immediate_context_execute_command_list,
+};
+
+struct wined3d_rendertarget_view * CDECL wined3d_device_context_get_rendertarget_view(
+        const struct wined3d_device_context *context, unsigned int view_idx)
 {
     unsigned int max_rt_count;
 
-    TRACE("device %p, view_idx %u.\n", device, view_idx);
+    TRACE("context %p, view_idx %u.\n", context, view_idx);
 
-    max_rt_count = device->adapter->d3d_info.limits.max_rt_count;
+    max_rt_count = context->device->adapter->d3d_info.limits.max_rt_count;
     if (view_idx >= max_rt_count)
     {
         WARN("Only %u render targets are supported.\n", max_rt_count);
         return NULL;
     }
 
-    return device->state.fb.render_targets[view_idx];
+    return context->state->fb.render_targets[view_idx];
+}
+
+struct wined3d_rendertarget_view * CDECL wined3d_device_get_rendertarget_view(const struct wined3d_device *device,
+        unsigned int view_idx)
+{
+    TRACE("device %p, view_idx %u.\n", device, view_idx);
+
+    return wined3d_device_context_get_rendertarget_view(&device->immediate_context, view_idx);
+}
+
+struct wined3d_rendertarget_view * CDECL wined3d_device_context_get_depth_stencil_view(
+        const struct wined3d_device_context *context)
+{
+    TRACE("context %p.\n", context);
+
+    return context->state->fb.depth_stencil;
 }
 
 struct wined3d_rendertarget_view * CDECL wined3d_device_get_depth_stencil_view(const struct wined3d_device *device)
 {
     TRACE("device %p.\n", device);
 
-    return device->state.fb.depth_stencil;
+    return wined3d_device_context_get_depth_stencil_view(&device->immediate_context);
 }
 
-static void wined3d_unbind_srv_for_rtv(struct wined3d_device *device,
+static void wined3d_unbind_srv_for_rtv(struct wined3d_device_context *context,
         const struct wined3d_rendertarget_view *view, BOOL dsv)
 {
     if (view && wined3d_is_rtv_srv_bound(view))
@@ -4933,23 +5640,24 @@ static void wined3d_unbind_srv_for_rtv(struct wined3d_device *device,
 
         for (i = 0; i < WINED3D_SHADER_TYPE_COUNT; ++i)
             for (j = 0; j < MAX_SHADER_RESOURCE_VIEWS; ++j)
-                if ((srv = device->state.shader_resource_view[i][j]) && srv->resource == resource
+                if ((srv = context->state->shader_resource_view[i][j]) && srv->resource == resource
                         && ((!dsv && wined3d_is_srv_rtv_bound(srv))
                         || (dsv && wined3d_dsv_srv_conflict(view, srv->format))))
-                    wined3d_device_set_shader_resource_view(device, i, j, NULL);
+                    wined3d_device_context_set_shader_resource_view(context, i, j, NULL);
     }
 }
 
-HRESULT CDECL wined3d_device_set_rendertarget_view(struct wined3d_device *device,
+HRESULT CDECL wined3d_device_context_set_rendertarget_view(struct wined3d_device_context *context,
         unsigned int view_idx, struct wined3d_rendertarget_view *view, BOOL set_viewport)
 {
+    bool bind_count = !(context->state->flags & WINED3D_STATE_NO_BIND_COUNT);
     struct wined3d_rendertarget_view *prev;
     unsigned int max_rt_count;
 
-    TRACE("device %p, view_idx %u, view %p, set_viewport %#x.\n",
-            device, view_idx, view, set_viewport);
+    TRACE("context %p, view_idx %u, view %p, set_viewport %#x.\n",
+            context, view_idx, view, set_viewport);
 
-    max_rt_count = device->adapter->d3d_info.limits.max_rt_count;
+    max_rt_count = context->device->adapter->d3d_info.limits.max_rt_count;
     if (view_idx >= max_rt_count)
     {
         WARN("Only %u render targets are supported.\n", max_rt_count);
@@ -4967,7 +5675,7 @@ HRESULT CDECL wined3d_device_set_rendertarget_view(struct wined3d_device *device
      * primary stateblock. */
     if (!view_idx && set_viewport)
     {
-        struct wined3d_state *state = &device->state;
+        struct wined3d_state *state = context->state;
 
         state->viewports[0].x = 0;
         state->viewports[0].y = 0;
@@ -4976,43 +5684,55 @@ HRESULT CDECL wined3d_device_set_rendertarget_view(struct wined3d_device *device
         state->viewports[0].min_z = 0.0f;
         state->viewports[0].max_z = 1.0f;
         state->viewport_count = 1;
-        wined3d_cs_emit_set_viewports(device->cs, 1, state->viewports);
+        wined3d_cs_emit_set_viewports(context->cs, 1, state->viewports);
 
         SetRect(&state->scissor_rects[0], 0, 0, view->width, view->height);
         state->scissor_rect_count = 1;
-        wined3d_cs_emit_set_scissor_rects(device->cs, 1, state->scissor_rects);
+        wined3d_cs_emit_set_scissor_rects(context->cs, 1, state->scissor_rects);
     }
 
-    prev = device->state.fb.render_targets[view_idx];
+    prev = context->state->fb.render_targets[view_idx];
     if (view == prev)
         return WINED3D_OK;
 
     if (view)
     {
         wined3d_rendertarget_view_incref(view);
-        wined3d_rtv_bind_count_inc(view);
+        if (bind_count)
+            wined3d_rtv_bind_count_inc(view);
     }
-    device->state.fb.render_targets[view_idx] = view;
-    wined3d_cs_emit_set_rendertarget_view(device->cs, view_idx, view);
+    context->state->fb.render_targets[view_idx] = view;
+    wined3d_cs_emit_set_rendertarget_view(context->cs, view_idx, view);
     /* Release after the assignment, to prevent device_resource_released()
      * from seeing the surface as still in use. */
     if (prev)
     {
-        wined3d_rtv_bind_count_dec(prev);
+        if (bind_count)
+            wined3d_rtv_bind_count_dec(prev);
         wined3d_rendertarget_view_decref(prev);
     }
 
-    wined3d_unbind_srv_for_rtv(device, view, FALSE);
+    if (bind_count)
+        wined3d_unbind_srv_for_rtv(context, view, FALSE);
 
     return WINED3D_OK;
 }
 
-HRESULT CDECL wined3d_device_set_depth_stencil_view(struct wined3d_device *device,
+HRESULT CDECL wined3d_device_set_rendertarget_view(struct wined3d_device *device,
+        unsigned int view_idx, struct wined3d_rendertarget_view *view, BOOL set_viewport)
+{
+    TRACE("device %p, view_idx %u, view %p, set_viewport %#x.\n",
+            device, view_idx, view, set_viewport);
+
+    return wined3d_device_context_set_rendertarget_view(&device->immediate_context, view_idx, view, set_viewport);
+}
+
+HRESULT CDECL wined3d_device_context_set_depth_stencil_view(struct wined3d_device_context *context,
         struct wined3d_rendertarget_view *view)
 {
     struct wined3d_rendertarget_view *prev;
 
-    TRACE("device %p, view %p.\n", device, view);
+    TRACE("context %p, view %p.\n", context, view);
 
     if (view && !(view->resource->bind_flags & WINED3D_BIND_DEPTH_STENCIL))
     {
@@ -5021,23 +5741,32 @@ HRESULT CDECL wined3d_device_set_depth_stencil_view(struct wined3d_device *devic
         return WINED3DERR_INVALIDCALL;
     }
 
-    prev = device->state.fb.depth_stencil;
+    prev = context->state->fb.depth_stencil;
     if (prev == view)
     {
         TRACE("Trying to do a NOP SetRenderTarget operation.\n");
         return WINED3D_OK;
     }
 
-    if ((device->state.fb.depth_stencil = view))
+    if ((context->state->fb.depth_stencil = view))
         wined3d_rendertarget_view_incref(view);
-    wined3d_cs_emit_set_depth_stencil_view(device->cs, view);
+    wined3d_cs_emit_set_depth_stencil_view(context->cs, view);
     if (prev)
         wined3d_rendertarget_view_decref(prev);
-    wined3d_unbind_srv_for_rtv(device, view, TRUE);
+    if (!(context->state->flags & WINED3D_STATE_NO_BIND_COUNT))
+        wined3d_unbind_srv_for_rtv(context, view, TRUE);
 
     return WINED3D_OK;
 }
 
+HRESULT CDECL wined3d_device_set_depth_stencil_view(struct wined3d_device *device,
+        struct wined3d_rendertarget_view *view)
+{
+    TRACE("device %p, view %p.\n", device, view);
+
+    return wined3d_device_context_set_depth_stencil_view(&device->immediate_context, view);
+}
+
 static struct wined3d_texture *wined3d_device_create_cursor_texture(struct wined3d_device *device,
         struct wined3d_texture *cursor_image, unsigned int sub_resource_idx)
 {
@@ -5526,7 +6255,7 @@ HRESULT CDECL wined3d_device_reset(struct wined3d_device *device,
     if (reset_state)
     {
         TRACE("Resetting state.\n");
-        wined3d_cs_emit_reset_state(device->cs);
+        wined3d_cs_emit_reset_state(device->cs, false);
         state_cleanup(&device->state);
 
         LIST_FOR_EACH_ENTRY_SAFE(resource, cursor, &device->resources, struct wined3d_resource, resource_list_entry)
@@ -5857,6 +6586,11 @@ HRESULT wined3d_device_init(struct wined3d_device *device, struct wined3d *wined
         goto err;
     }
 
+    device->immediate_context.ops = &wined3d_immediate_context_ops;
+    device->immediate_context.device = device;
+    device->immediate_context.state = &device->state;
+    device->immediate_context.cs = device->cs;
+
     return WINED3D_OK;
 
 err:
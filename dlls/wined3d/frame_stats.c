@@ -0,0 +1,257 @@
+/*
+ * Frame statistics
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "config.h"
+#include "wine/port.h"
+
+#include <stdio.h>
+
+#include "wined3d_private.h"
+
+WINE_DEFAULT_DEBUG_CHANNEL(d3d_perf);
+
+/* When the "FrameStats" setting is enabled, a summary of each frame is
+ * printed at present time. When "FrameStatsTrace" is set, the statistics of
+ * the last WINED3D_FRAME_STATS_FRAME_COUNT frames are written to that file
+ * in the Chrome trace event format when the device is destroyed. The trace
+ * can be loaded in chrome://tracing or Perfetto.
+ *
+ * Counters that can be updated from any thread are accumulated in
+ * wined3d_frame_counters[], and moved into the frame record at present
+ * time. CS packet counts and the queue fill level are only updated from the
+ * CS thread, and are stored in the frame record directly. */
+
+LONG wined3d_frame_counters[WINED3D_FRAME_COUNTER_COUNT];
+
+static LONGLONG wined3d_frame_stats_frequency;
+
+static const struct
+{
+    const char *name;
+    BOOL time;
+}
+wined3d_frame_counter_info[] =
+{
+    /* WINED3D_FRAME_COUNTER_CS_QUEUE_FILL   */ {"cs_queue_fill"},
+    /* WINED3D_FRAME_COUNTER_CS_WAITS        */ {"cs_waits"},
+    /* WINED3D_FRAME_COUNTER_CS_WAIT_TIME    */ {"cs_wait_time", TRUE},
+    /* WINED3D_FRAME_COUNTER_SHADER_COMPILES */ {"shader_compiles"},
+    /* WINED3D_FRAME_COUNTER_UPLOAD_BYTES    */ {"upload_bytes"},
+    /* WINED3D_FRAME_COUNTER_MAPS            */ {"maps"},
+    /* WINED3D_FRAME_COUNTER_MAP_WAIT_TIME   */ {"map_wait_time", TRUE},
+    /* WINED3D_FRAME_COUNTER_DESCRIPTOR_SET_ALLOCS */ {"descriptor_set_allocs"},
+    /* WINED3D_FRAME_COUNTER_DESCRIPTOR_SET_REUSES */ {"descriptor_set_reuses"},
+    /* WINED3D_FRAME_COUNTER_PIPELINE_COMPILES */ {"pipeline_compiles"},
+    /* WINED3D_FRAME_COUNTER_PIPELINE_COMPILE_TIME */ {"pipeline_compile_time", TRUE},
+    /* WINED3D_FRAME_COUNTER_SHADER_CACHE_HITS */ {"shader_cache_hits"},
+    /* WINED3D_FRAME_COUNTER_SHADER_COMPILE_TIME */ {"shader_compile_time", TRUE},
+};
+
+C_ASSERT(ARRAY_SIZE(wined3d_frame_counter_info) == WINED3D_FRAME_COUNTER_COUNT);
+
+LONGLONG wined3d_frame_stats_time(void)
+{
+    LARGE_INTEGER counter;
+
+    QueryPerformanceCounter(&counter);
+
+    return counter.QuadPart / wined3d_frame_stats_frequency * 1000000
+            + counter.QuadPart % wined3d_frame_stats_frequency * 1000000 / wined3d_frame_stats_frequency;
+}
+
+static const char *wined3d_frame_stats_op_name(unsigned int op)
+{
+    static const char prefix[] = "WINED3D_CS_OP_";
+    const char *name = wined3d_debug_cs_op(op);
+
+    if (!strncmp(name, prefix, strlen(prefix)))
+        return name + strlen(prefix);
+    return name;
+}
+
+static void wined3d_frame_stats_print(const struct wined3d_frame_stats *frame, unsigned int idx)
+{
+    unsigned int i, j, total = 0, top[3] = {~0u, ~0u, ~0u};
+    char ops[256];
+    int len = 0;
+
+    for (i = 0; i < WINED3D_FRAME_STATS_MAX_OPS; ++i)
+    {
+        if (!frame->op_counts[i])
+            continue;
+        total += frame->op_counts[i];
+
+        for (j = 0; j < ARRAY_SIZE(top); ++j)
+        {
+            if (top[j] == ~0u || frame->op_counts[i] > frame->op_counts[top[j]])
+            {
+                memmove(&top[j + 1], &top[j], (ARRAY_SIZE(top) - j - 1) * sizeof(*top));
+                top[j] = i;
+                break;
+            }
+        }
+    }
+
+    ops[0] = 0;
+    for (j = 0; j < ARRAY_SIZE(top) && top[j] != ~0u; ++j)
+    {
+        len += snprintf(ops + len, sizeof(ops) - len, "%s%s %u", j ? ", " : "",
+                wined3d_frame_stats_op_name(top[j]), frame->op_counts[top[j]]);
+    }
+
+    MESSAGE("wined3d: frame %u: %.3f ms, %u packets (%s), queue fill %d bytes, "
+            "%d cs waits (%.3f ms), %d shader compiles, %d bytes uploaded, %d maps (%.3f ms), "
+            "%d descriptor sets allocated, %d reused, %d pipeline compiles (%.3f ms), "
+            "%d shader cache hits, %.3f ms compiling shaders.\n",
+            idx, (frame->end - frame->start) / 1000.0, total, ops,
+            frame->counters[WINED3D_FRAME_COUNTER_CS_QUEUE_FILL],
+            frame->counters[WINED3D_FRAME_COUNTER_CS_WAITS],
+            frame->counters[WINED3D_FRAME_COUNTER_CS_WAIT_TIME] / 1000.0,
+            frame->counters[WINED3D_FRAME_COUNTER_SHADER_COMPILES],
+            frame->counters[WINED3D_FRAME_COUNTER_UPLOAD_BYTES],
+            frame->counters[WINED3D_FRAME_COUNTER_MAPS],
+            frame->counters[WINED3D_FRAME_COUNTER_MAP_WAIT_TIME] / 1000.0,
+            frame->counters[WINED3D_FRAME_COUNTER_DESCRIPTOR_SET_ALLOCS],
+            frame->counters[WINED3D_FRAME_COUNTER_DESCRIPTOR_SET_REUSES],
+            frame->counters[WINED3D_FRAME_COUNTER_PIPELINE_COMPILES],
+            frame->counters[WINED3D_FRAME_COUNTER_PIPELINE_COMPILE_TIME] / 1000.0,
+            frame->counters[WINED3D_FRAME_COUNTER_SHADER_CACHE_HITS],
+            frame->counters[WINED3D_FRAME_COUNTER_SHADER_COMPILE_TIME] / 1000.0);
+}
+
+void wined3d_frame_stats_end_frame(struct wined3d_cs *cs)
+{
+    struct wined3d_frame_stats *frame = &cs->frame;
+    unsigned int i;
+
+    if (!cs->frame_stats)
+        return;
+
+    frame->end = wined3d_frame_stats_time();
+    for (i = 0; i < WINED3D_FRAME_COUNTER_COUNT; ++i)
+    {
+        if (i == WINED3D_FRAME_COUNTER_CS_QUEUE_FILL)
+            continue;
+        frame->counters[i] = InterlockedExchange(&wined3d_frame_counters[i], 0);
+    }
+
+    if (wined3d_settings.frame_stats & WINED3D_FRAME_STATS_PRINT)
+        wined3d_frame_stats_print(frame, cs->frame_stats_count);
+
+    cs->frame_stats[cs->frame_stats_count++ % WINED3D_FRAME_STATS_FRAME_COUNT] = *frame;
+
+    memset(frame, 0, sizeof(*frame));
+    frame->start = cs->frame_stats[(cs->frame_stats_count - 1) % WINED3D_FRAME_STATS_FRAME_COUNT].end;
+}
+
+static void wined3d_frame_stats_write_trace(const struct wined3d_cs *cs, const char *path)
+{
+    unsigned int i, j, first, count, pid, tid;
+    const struct wined3d_frame_stats *frame;
+    struct wined3d_string_buffer buffer;
+    DWORD written;
+    HANDLE file;
+    BOOL ret;
+
+    if (!string_buffer_init(&buffer))
+    {
+        ERR("Failed to initialise string buffer.\n");
+        return;
+    }
+
+    pid = GetCurrentProcessId();
+    tid = cs->thread_id;
+    count = min(cs->frame_stats_count, WINED3D_FRAME_STATS_FRAME_COUNT);
+    first = cs->frame_stats_count - count;
+
+    shader_addline(&buffer, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    for (i = 0; i < count; ++i)
+    {
+        frame = &cs->frame_stats[(first + i) % WINED3D_FRAME_STATS_FRAME_COUNT];
+
+        shader_addline(&buffer, "%s{\"name\":\"frame\",\"cat\":\"wined3d\",\"ph\":\"X\","
+                "\"pid\":%u,\"tid\":%u,\"ts\":%.0f,\"dur\":%.0f,\"args\":{\"frame\":%u",
+                i ? ",\n" : "", pid, tid, (double)frame->start, (double)(frame->end - frame->start), first + i);
+        for (j = 0; j < WINED3D_FRAME_STATS_MAX_OPS; ++j)
+        {
+            if (frame->op_counts[j])
+                shader_addline(&buffer, ",\"%s\":%u", wined3d_frame_stats_op_name(j), frame->op_counts[j]);
+        }
+        shader_addline(&buffer, "}}");
+
+        for (j = 0; j < WINED3D_FRAME_COUNTER_COUNT; ++j)
+        {
+            shader_addline(&buffer, ",\n{\"name\":\"%s\",\"cat\":\"wined3d\",\"ph\":\"C\","
+                    "\"pid\":%u,\"ts\":%.0f,\"args\":{\"%s\":", wined3d_frame_counter_info[j].name,
+                    pid, (double)frame->start, wined3d_frame_counter_info[j].time ? "ms" : "value");
+            if (wined3d_frame_counter_info[j].time)
+                shader_addline(&buffer, "%.3f}}", frame->counters[j] / 1000.0);
+            else
+                shader_addline(&buffer, "%d}}", frame->counters[j]);
+        }
+    }
+    shader_addline(&buffer, "\n]}\n");
+
+    if ((file = CreateFileA(path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, NULL)) == INVALID_HANDLE_VALUE)
+    {
+        ERR("Failed to create %s, error %u.\n", debugstr_a(path), GetLastError());
+        string_buffer_free(&buffer);
+        return;
+    }
+
+    ret = WriteFile(file, buffer.buffer, buffer.content_size, &written, NULL) && written == buffer.content_size;
+    CloseHandle(file);
+    string_buffer_free(&buffer);
+
+    if (!ret)
+        ERR("Failed to write %s.\n", debugstr_a(path));
+    else
+        TRACE("Wrote %u frames to %s.\n", count, debugstr_a(path));
+}
+
+void wined3d_frame_stats_init(struct wined3d_cs *cs)
+{
+    LARGE_INTEGER frequency;
+
+    if (!wined3d_settings.frame_stats)
+        return;
+
+    QueryPerformanceFrequency(&frequency);
+    wined3d_frame_stats_frequency = frequency.QuadPart;
+
+    if (!(cs->frame_stats = heap_calloc(WINED3D_FRAME_STATS_FRAME_COUNT, sizeof(*cs->frame_stats))))
+    {
+        ERR("Failed to allocate frame statistics.\n");
+        return;
+    }
+    cs->frame_stats_count = 0;
+    memset(&cs->frame, 0, sizeof(cs->frame));
+    cs->frame.start = wined3d_frame_stats_time();
+}
+
+void wined3d_frame_stats_cleanup(struct wined3d_cs *cs)
+{
+    if (!cs->frame_stats)
+        return;
+
+    if ((wined3d_settings.frame_stats & WINED3D_FRAME_STATS_TRACE) && cs->frame_stats_count)
+        wined3d_frame_stats_write_trace(cs, wined3d_settings.frame_stats_trace);
+
+    heap_free(cs->frame_stats);
+    cs->frame_stats = NULL;
+}
@@ -567,6 +567,8 @@ static void shader_glsl_compile(const struct wined3d_gl_info *gl_info, GLuint sh
     GL_EXTCALL(glCompileShader(shader));
     checkGLcall("glCompileShader");
     print_glsl_info_log(gl_info, shader, FALSE);
+
+    wined3d_frame_stats_add(WINED3D_FRAME_COUNTER_SHADER_COMPILES, 1);
 }
 
 /* Context activation is done by the caller. */
@@ -639,6 +641,155 @@ void shader_glsl_validate_link(const struct wined3d_gl_info *gl_info, GLuint pro
     print_glsl_info_log(gl_info, program, TRUE);
 }
 
+/* The program binary depends on the attached shaders, on the driver, and on
+ * the link state set by the caller. Attribute locations follow from the
+ * shader sources, the fragment data locations depend on dual source
+ * blending, and the transform feedback varyings on the stream output
+ * description. */
+static BOOL shader_glsl_get_program_key(const struct wined3d_gl_info *gl_info, GLuint program,
+        const struct wined3d_stream_output_desc *so_desc, BOOL dual_source, struct wined3d_shader_cache_key *key)
+{
+    GLint i, j, shader_count, source_size = 0;
+    GLuint *shaders, shader;
+    GLint *types, tmp;
+    char *source = NULL;
+
+    GL_EXTCALL(glGetProgramiv(program, GL_ATTACHED_SHADERS, &shader_count));
+    if (!(shaders = heap_calloc(shader_count, sizeof(*shaders))))
+        return FALSE;
+    if (!(types = heap_calloc(shader_count, sizeof(*types))))
+    {
+        heap_free(shaders);
+        return FALSE;
+    }
+
+    /* The shaders are attached in no particular order, but there is at most
+     * one of each type. Sort them by type, so that the key doesn't depend on
+     * the order. */
+    GL_EXTCALL(glGetAttachedShaders(program, shader_count, NULL, shaders));
+    for (i = 0; i < shader_count; ++i)
+    {
+        shader = shaders[i];
+        GL_EXTCALL(glGetShaderiv(shader, GL_SHADER_TYPE, &tmp));
+        for (j = i; j > 0 && types[j - 1] > tmp; --j)
+        {
+            types[j] = types[j - 1];
+            shaders[j] = shaders[j - 1];
+        }
+        types[j] = tmp;
+        shaders[j] = shader;
+    }
+
+    wined3d_shader_cache_key_init(key);
+    for (i = 0; i < shader_count; ++i)
+    {
+        GL_EXTCALL(glGetShaderiv(shaders[i], GL_SHADER_SOURCE_LENGTH, &tmp));
+        if (source_size < tmp)
+        {
+            heap_free(source);
+            if (!(source = heap_alloc(tmp)))
+            {
+                heap_free(types);
+                heap_free(shaders);
+                wined3d_shader_cache_key_cleanup(key);
+                return FALSE;
+            }
+            source_size = tmp;
+        }
+
+        wined3d_shader_cache_key_add_uint(key, types[i]);
+        GL_EXTCALL(glGetShaderSource(shaders[i], source_size, &tmp, source));
+        wined3d_shader_cache_key_add(key, source, tmp);
+    }
+    heap_free(source);
+    heap_free(types);
+    heap_free(shaders);
+
+    wined3d_shader_cache_key_add_uint(key, dual_source);
+    wined3d_shader_cache_key_add_uint(key, !!so_desc);
+    if (so_desc)
+        wined3d_shader_cache_key_add_so_desc(key, so_desc);
+
+    wined3d_shader_cache_key_add_string(key, (const char *)gl_info->gl_ops.gl.p_glGetString(GL_VENDOR));
+    wined3d_shader_cache_key_add_string(key, (const char *)gl_info->gl_ops.gl.p_glGetString(GL_RENDERER));
+    wined3d_shader_cache_key_add_string(key, (const char *)gl_info->gl_ops.gl.p_glGetString(GL_VERSION));
+
+    return TRUE;
+}
+
+/* Returns TRUE if the program binary was loaded from the cache.
+ * Context activation is done by the caller. */
+static BOOL shader_glsl_link_program_cached(const struct wined3d_gl_info *gl_info, GLuint program,
+        const struct wined3d_stream_output_desc *so_desc, BOOL dual_source)
+{
+    struct wined3d_shader_cache_key key;
+    GLint status, length;
+    GLenum *binary;
+    SIZE_T size;
+
+    if (!gl_info->supported[ARB_GET_PROGRAM_BINARY] || !wined3d_settings.shader_cache_size
+            || !shader_glsl_get_program_key(gl_info, program, so_desc, dual_source, &key))
+    {
+        GL_EXTCALL(glLinkProgram(program));
+        return FALSE;
+    }
+
+    /* The binary format is stored before the binary itself. */
+    if ((binary = wined3d_shader_cache_load(&key, &size)))
+    {
+        if (size > sizeof(*binary))
+            GL_EXTCALL(glProgramBinary(program, binary[0], &binary[1], size - sizeof(*binary)));
+        heap_free(binary);
+        GL_EXTCALL(glGetProgramiv(program, GL_LINK_STATUS, &status));
+        checkGLcall("glProgramBinary");
+        if (status)
+        {
+            TRACE("Loaded program %u from the shader cache.\n", program);
+            wined3d_shader_cache_key_cleanup(&key);
+            return TRUE;
+        }
+        WARN("Failed to load cached binary for program %u, relinking.\n", program);
+    }
+
+    GL_EXTCALL(glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE));
+    GL_EXTCALL(glLinkProgram(program));
+    GL_EXTCALL(glGetProgramiv(program, GL_LINK_STATUS, &status));
+    GL_EXTCALL(glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length));
+    checkGLcall("glGetProgramiv");
+    if (status && length > 0 && (binary = heap_alloc(sizeof(*binary) + length)))
+    {
+        GL_EXTCALL(glGetProgramBinary(program, length, &length, &binary[0], &binary[1]));
+        checkGLcall("glGetProgramBinary");
+        if (length > 0)
+            wined3d_shader_cache_store(&key, binary, sizeof(*binary) + length);
+        heap_free(binary);
+    }
+    wined3d_shader_cache_key_cleanup(&key);
+
+    return FALSE;
+}
+
+/* Link a GLSL program, using the persistent shader cache when possible.
+ * Only the link step is cached; the GLSL is still generated and compiled,
+ * since its source is part of the key. Context activation is done by the
+ * caller. */
+static void shader_glsl_link_program(const struct wined3d_gl_info *gl_info, GLuint program,
+        const struct wined3d_stream_output_desc *so_desc, BOOL dual_source)
+{
+    LONGLONG start = 0;
+    BOOL hit;
+
+    if (wined3d_settings.frame_stats)
+        start = wined3d_frame_stats_time();
+    hit = shader_glsl_link_program_cached(gl_info, program, so_desc, dual_source);
+    if (wined3d_settings.frame_stats)
+    {
+        if (hit)
+            wined3d_frame_stats_add(WINED3D_FRAME_COUNTER_SHADER_CACHE_HITS, 1);
+        wined3d_frame_stats_add(WINED3D_FRAME_COUNTER_SHADER_COMPILE_TIME, wined3d_frame_stats_time() - start);
+    }
+}
+
 static BOOL shader_glsl_use_layout_qualifier(const struct wined3d_gl_info *gl_info)
 {
     /* Layout qualifiers were introduced in GLSL 1.40. The Nvidia Legacy GPU
@@ -10112,7 +10263,7 @@ static HRESULT shader_glsl_compile_compute_shader(struct shader_glsl_priv *priv,
     list_add_head(&shader->linked_programs, &entry->cs.shader_entry);
 
     TRACE("Linking GLSL shader program %u.\n", program_id);
-    GL_EXTCALL(glLinkProgram(program_id));
+    shader_glsl_link_program(gl_info, program_id, NULL, FALSE);
     shader_glsl_validate_link(gl_info, program_id);
 
     GL_EXTCALL(glUseProgram(program_id));
@@ -10445,7 +10596,8 @@ static void set_glsl_shader_program(const struct wined3d_context_gl *context_gl,
 
     /* Link the program */
     TRACE("Linking GLSL shader program %u.\n", program_id);
-    GL_EXTCALL(glLinkProgram(program_id));
+    shader_glsl_link_program(gl_info, program_id, gshader ? gshader->u.gs.so_desc : NULL,
+            state->blend_state && state->blend_state->dual_source);
     shader_glsl_validate_link(gl_info, program_id);
 
     shader_glsl_init_vs_uniform_locations(gl_info, priv, program_id, &entry->vs,
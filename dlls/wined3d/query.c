@@ -498,19 +498,24 @@ UINT CDECL wined3d_query_get_data_size(const struct wined3d_query *query)
     return query->data_size;
 }
 
-HRESULT CDECL wined3d_query_issue(struct wined3d_query *query, DWORD flags)
+/* Update the application side of "query" for an issue with "flags". For
+ * deferred contexts this happens when the command list is executed. */
+void wined3d_query_update_issued(struct wined3d_query *query, DWORD flags)
 {
-    TRACE("query %p, flags %#x.\n", query, flags);
-
     if (flags & WINED3DISSUE_END)
         ++query->counter_main;
 
-    wined3d_cs_emit_query_issue(query->device->cs, query, flags);
-
     if (flags & WINED3DISSUE_BEGIN)
         query->state = QUERY_BUILDING;
     else
         query->state = QUERY_SIGNALLED;
+}
+
+HRESULT CDECL wined3d_query_issue(struct wined3d_query *query, DWORD flags)
+{
+    TRACE("query %p, flags %#x.\n", query, flags);
+
+    wined3d_device_context_issue_query(&query->device->immediate_context, query, flags);
 
     return WINED3D_OK;
 }
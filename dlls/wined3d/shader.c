@@ -1024,6 +1024,238 @@ static HRESULT shader_scan_output_signature(struct wined3d_shader *shader)
     return WINED3D_OK;
 }
 
+#define WINED3D_SHADER_IR_CHUNK_SIZE 0x1000
+
+struct wined3d_shader_ir_chunk
+{
+    struct wined3d_shader_ir_chunk *next;
+    SIZE_T size;
+    SIZE_T offset;
+    BYTE data[1];
+};
+
+static void *shader_ir_alloc(struct wined3d_shader_ir *ir, SIZE_T size)
+{
+    struct wined3d_shader_ir_chunk *chunk = ir->chunks;
+    SIZE_T chunk_size;
+    void *ptr;
+
+    size = (size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+    if (!chunk || chunk->size - chunk->offset < size)
+    {
+        chunk_size = max(size, WINED3D_SHADER_IR_CHUNK_SIZE);
+        if (!(chunk = heap_alloc(FIELD_OFFSET(struct wined3d_shader_ir_chunk, data[chunk_size]))))
+            return NULL;
+        chunk->size = chunk_size;
+        chunk->offset = 0;
+        chunk->next = ir->chunks;
+        ir->chunks = chunk;
+    }
+
+    ptr = &chunk->data[chunk->offset];
+    chunk->offset += size;
+
+    return ptr;
+}
+
+static const struct wined3d_shader_src_param *shader_ir_copy_src_params(struct wined3d_shader_ir *ir,
+        const struct wined3d_shader_src_param *src, unsigned int count);
+
+static BOOL shader_ir_copy_register(struct wined3d_shader_ir *ir, struct wined3d_shader_register *reg)
+{
+    unsigned int i;
+
+    for (i = 0; i < ARRAY_SIZE(reg->idx); ++i)
+    {
+        if (reg->idx[i].rel_addr && !(reg->idx[i].rel_addr = shader_ir_copy_src_params(ir, reg->idx[i].rel_addr, 1)))
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+static const struct wined3d_shader_src_param *shader_ir_copy_src_params(struct wined3d_shader_ir *ir,
+        const struct wined3d_shader_src_param *src, unsigned int count)
+{
+    struct wined3d_shader_src_param *params;
+    unsigned int i;
+
+    if (!(params = shader_ir_alloc(ir, count * sizeof(*params))))
+        return NULL;
+    memcpy(params, src, count * sizeof(*params));
+    for (i = 0; i < count; ++i)
+    {
+        if (!shader_ir_copy_register(ir, &params[i].reg))
+            return NULL;
+    }
+
+    return params;
+}
+
+static const struct wined3d_shader_dst_param *shader_ir_copy_dst_params(struct wined3d_shader_ir *ir,
+        const struct wined3d_shader_dst_param *dst, unsigned int count)
+{
+    struct wined3d_shader_dst_param *params;
+    unsigned int i;
+
+    if (!(params = shader_ir_alloc(ir, count * sizeof(*params))))
+        return NULL;
+    memcpy(params, dst, count * sizeof(*params));
+    for (i = 0; i < count; ++i)
+    {
+        if (!shader_ir_copy_register(ir, &params[i].reg))
+            return NULL;
+    }
+
+    return params;
+}
+
+/* The frontends return instructions that point into their private data,
+ * which is overwritten by the next call to shader_read_instruction(). */
+static BOOL shader_ir_copy_instruction(struct wined3d_shader_ir *ir, struct wined3d_shader_instruction *ins)
+{
+    struct wined3d_shader_immediate_constant_buffer *icb;
+    SIZE_T icb_size;
+
+    ins->ctx = NULL;
+
+    if (ins->handler_idx == WINED3DSIH_TABLE_SIZE)
+    {
+        ins->dst_count = ins->src_count = 0;
+        ins->dst = NULL;
+        ins->src = NULL;
+        ins->predicate = NULL;
+        return TRUE;
+    }
+
+    if (ins->dst_count && !(ins->dst = shader_ir_copy_dst_params(ir, ins->dst, ins->dst_count)))
+        return FALSE;
+    if (ins->src_count && !(ins->src = shader_ir_copy_src_params(ir, ins->src, ins->src_count)))
+        return FALSE;
+    if (ins->predicate && !(ins->predicate = shader_ir_copy_src_params(ir, ins->predicate, 1)))
+        return FALSE;
+
+    switch (ins->handler_idx)
+    {
+        case WINED3DSIH_DCL:
+        case WINED3DSIH_DCL_UAV_TYPED:
+            return shader_ir_copy_register(ir, &ins->declaration.semantic.reg.reg);
+
+        case WINED3DSIH_DCL_CONSTANT_BUFFER:
+            return shader_ir_copy_register(ir, &ins->declaration.src.reg);
+
+        case WINED3DSIH_DCL_INPUT:
+        case WINED3DSIH_DCL_INPUT_PS:
+        case WINED3DSIH_DCL_OUTPUT:
+        case WINED3DSIH_DCL_RESOURCE_RAW:
+        case WINED3DSIH_DCL_SAMPLER:
+        case WINED3DSIH_DCL_UAV_RAW:
+            return shader_ir_copy_register(ir, &ins->declaration.dst.reg);
+
+        case WINED3DSIH_DCL_INPUT_PS_SGV:
+        case WINED3DSIH_DCL_INPUT_PS_SIV:
+        case WINED3DSIH_DCL_INPUT_SGV:
+        case WINED3DSIH_DCL_INPUT_SIV:
+        case WINED3DSIH_DCL_OUTPUT_SIV:
+            return shader_ir_copy_register(ir, &ins->declaration.register_semantic.reg.reg);
+
+        case WINED3DSIH_DCL_INDEX_RANGE:
+            return shader_ir_copy_register(ir, &ins->declaration.index_range.first_register.reg);
+
+        case WINED3DSIH_DCL_RESOURCE_STRUCTURED:
+        case WINED3DSIH_DCL_UAV_STRUCTURED:
+            return shader_ir_copy_register(ir, &ins->declaration.structured_resource.reg.reg);
+
+        case WINED3DSIH_DCL_TGSM_RAW:
+            return shader_ir_copy_register(ir, &ins->declaration.tgsm_raw.reg.reg);
+
+        case WINED3DSIH_DCL_TGSM_STRUCTURED:
+            return shader_ir_copy_register(ir, &ins->declaration.tgsm_structured.reg.reg);
+
+        case WINED3DSIH_DCL_IMMEDIATE_CONSTANT_BUFFER:
+            icb_size = FIELD_OFFSET(struct wined3d_shader_immediate_constant_buffer,
+                    data[ins->declaration.icb->vec4_count * 4]);
+            if (!(icb = shader_ir_alloc(ir, icb_size)))
+                return FALSE;
+            memcpy(icb, ins->declaration.icb, icb_size);
+            ins->declaration.icb = icb;
+            return TRUE;
+
+        default:
+            return TRUE;
+    }
+}
+
+static void shader_ir_cleanup(struct wined3d_shader_ir *ir)
+{
+    struct wined3d_shader_ir_chunk *chunk, *next;
+
+    for (chunk = ir->chunks; chunk; chunk = next)
+    {
+        next = chunk->next;
+        heap_free(chunk);
+    }
+    heap_free(ir->locations);
+    heap_free(ir->instructions);
+    memset(ir, 0, sizeof(*ir));
+}
+
+static HRESULT shader_ir_init(struct wined3d_shader_ir *ir, const struct wined3d_shader_frontend *fe, void *fe_data)
+{
+    struct wined3d_shader_instruction *ins;
+    const DWORD *ptr;
+
+    memset(ir, 0, sizeof(*ir));
+
+    fe->shader_read_header(fe_data, &ptr, &ir->shader_version);
+    for (;;)
+    {
+        if (!wined3d_array_reserve((void **)&ir->locations, &ir->locations_size,
+                ir->count + 1, sizeof(*ir->locations)))
+            goto fail;
+        ir->locations[ir->count] = ptr;
+
+        if (fe->shader_is_end(fe_data, &ptr))
+            break;
+
+        if (!wined3d_array_reserve((void **)&ir->instructions, &ir->instructions_size,
+                ir->count + 1, sizeof(*ir->instructions)))
+            goto fail;
+        ins = &ir->instructions[ir->count];
+        fe->shader_read_instruction(fe_data, &ptr, ins);
+        if (!shader_ir_copy_instruction(ir, ins))
+            goto fail;
+        ++ir->count;
+    }
+
+    TRACE("Decoded %lu instructions.\n", (unsigned long)ir->count);
+
+    return WINED3D_OK;
+
+fail:
+    ERR("Failed to allocate shader instructions.\n");
+    shader_ir_cleanup(ir);
+    return E_OUTOFMEMORY;
+}
+
+/* Returns the index of the instruction at byte code location "ptr", or the
+ * instruction count if there is no such instruction. */
+static SIZE_T shader_ir_find_location(const struct wined3d_shader_ir *ir, const DWORD *ptr)
+{
+    SIZE_T l = 0, r = ir->count, m;
+
+    while (l < r)
+    {
+        m = l + (r - l) / 2;
+        if (ir->locations[m] < ptr)
+            l = m + 1;
+        else
+            r = m;
+    }
+
+    return l;
+}
+
 /* Note that this does not count the loop register as an address register. */
 static HRESULT shader_get_registers_used(struct wined3d_shader *shader, DWORD constf_size)
 {
@@ -1032,13 +1264,13 @@ static HRESULT shader_get_registers_used(struct wined3d_shader *shader, DWORD co
     struct wined3d_shader_signature *output_signature = &shader->output_signature;
     struct wined3d_shader_signature *input_signature = &shader->input_signature;
     struct wined3d_shader_reg_maps *reg_maps = &shader->reg_maps;
-    const struct wined3d_shader_frontend *fe = shader->frontend;
     unsigned int cur_loop_depth = 0, max_loop_depth = 0;
+    const struct wined3d_shader_ir *ir = &shader->ir;
     struct wined3d_shader_version shader_version;
     struct wined3d_shader_phase *phase = NULL;
-    const DWORD *ptr, *prev_ins, *current_ins;
-    void *fe_data = shader->frontend_data;
+    const DWORD *prev_ins, *current_ins;
     unsigned int i;
+    SIZE_T ins_idx;
     HRESULT hr;
 
     memset(reg_maps, 0, sizeof(*reg_maps));
@@ -1047,8 +1279,8 @@ static HRESULT shader_get_registers_used(struct wined3d_shader *shader, DWORD co
     reg_maps->min_rel_offset = ~0U;
     list_init(&reg_maps->indexable_temps);
 
-    fe->shader_read_header(fe_data, &ptr, &shader_version);
-    prev_ins = current_ins = ptr;
+    shader_version = ir->shader_version;
+    prev_ins = current_ins = ir->locations[0];
     reg_maps->shader_version = shader_version;
 
     shader_set_limits(shader);
@@ -1060,13 +1292,11 @@ static HRESULT shader_get_registers_used(struct wined3d_shader *shader, DWORD co
         return E_OUTOFMEMORY;
     }
 
-    while (!fe->shader_is_end(fe_data, &ptr))
+    for (ins_idx = 0; ins_idx < ir->count; ++ins_idx)
     {
-        struct wined3d_shader_instruction ins;
+        struct wined3d_shader_instruction ins = ir->instructions[ins_idx];
 
-        current_ins = ptr;
-        /* Fetch opcode. */
-        fe->shader_read_instruction(fe_data, &ptr, &ins);
+        current_ins = ir->locations[ins_idx];
 
         /* Unhandled opcode, and its parameters. */
         if (ins.handler_idx == WINED3DSIH_TABLE_SIZE)
@@ -2591,14 +2821,12 @@ HRESULT shader_generate_code(const struct wined3d_shader *shader, struct wined3d
         const DWORD *start, const DWORD *end)
 {
     struct wined3d_device *device = shader->device;
-    const struct wined3d_shader_frontend *fe = shader->frontend;
-    void *fe_data = shader->frontend_data;
-    struct wined3d_shader_version shader_version;
+    const struct wined3d_shader_ir *ir = &shader->ir;
     struct wined3d_shader_parser_state state;
     struct wined3d_shader_instruction ins;
     struct wined3d_shader_tex_mx tex_mx;
     struct wined3d_shader_context ctx;
-    const DWORD *ptr;
+    SIZE_T i, count;
 
     /* Initialize current parsing state. */
     tex_mx.current_row = 0;
@@ -2612,16 +2840,14 @@ HRESULT shader_generate_code(const struct wined3d_shader *shader, struct wined3d
     ctx.tex_mx = &tex_mx;
     ctx.state = &state;
     ctx.backend_data = backend_ctx;
-    ins.ctx = &ctx;
 
-    fe->shader_read_header(fe_data, &ptr, &shader_version);
-    if (start)
-        ptr = start;
+    i = start ? shader_ir_find_location(ir, start) : 0;
+    count = end ? shader_ir_find_location(ir, end) : ir->count;
 
-    while (!fe->shader_is_end(fe_data, &ptr) && ptr != end)
+    for (; i < count; ++i)
     {
-        /* Read opcode. */
-        fe->shader_read_instruction(fe_data, &ptr, &ins);
+        ins = ir->instructions[i];
+        ins.ctx = &ctx;
 
         /* Unknown opcode and its parameters. */
         if (ins.handler_idx == WINED3DSIH_TABLE_SIZE)
@@ -2744,13 +2970,13 @@ static void shader_dump_interpolation_mode(struct wined3d_string_buffer *buffer,
     }
 }
 
-static void shader_trace_init(const struct wined3d_shader_frontend *fe, void *fe_data)
+static void shader_trace_init(const struct wined3d_shader_ir *ir)
 {
-    struct wined3d_shader_version shader_version;
+    const struct wined3d_shader_version shader_version = ir->shader_version;
     struct wined3d_string_buffer buffer;
     const char *type_prefix;
     const char *p, *q;
-    const DWORD *ptr;
+    SIZE_T ins_idx;
     DWORD i;
 
     if (!string_buffer_init(&buffer))
@@ -2759,9 +2985,7 @@ static void shader_trace_init(const struct wined3d_shader_frontend *fe, void *fe
         return;
     }
 
-    fe->shader_read_header(fe_data, &ptr, &shader_version);
-
-    TRACE("Parsing %p.\n", ptr);
+    TRACE("Parsing %p.\n", ir->locations[0]);
 
     switch (shader_version.type)
     {
@@ -2797,11 +3021,10 @@ static void shader_trace_init(const struct wined3d_shader_frontend *fe, void *fe
 
     shader_addline(&buffer, "%s_%u_%u\n", type_prefix, shader_version.major, shader_version.minor);
 
-    while (!fe->shader_is_end(fe_data, &ptr))
+    for (ins_idx = 0; ins_idx < ir->count; ++ins_idx)
     {
-        struct wined3d_shader_instruction ins;
+        struct wined3d_shader_instruction ins = ir->instructions[ins_idx];
 
-        fe->shader_read_instruction(fe_data, &ptr, &ins);
         if (ins.handler_idx == WINED3DSIH_TABLE_SIZE)
         {
             WARN("Skipping unrecognized instruction.\n");
@@ -3149,8 +3372,16 @@ static void shader_cleanup(struct wined3d_shader *shader)
     shader_delete_constant_list(&shader->constantsI);
     list_remove(&shader->shader_list_entry);
 
-    if (shader->frontend && shader->frontend_data)
-        shader->frontend->shader_free(shader->frontend_data);
+    shader_ir_cleanup(&shader->ir);
+}
+
+/* Shaders are created without holding the wined3d mutex, but destroying the
+ * backend data of a shader that failed initialisation still needs it. */
+static void shader_cleanup_unpublished(struct wined3d_shader *shader)
+{
+    wined3d_mutex_lock();
+    shader_cleanup(shader);
+    wined3d_mutex_unlock();
 }
 
 struct shader_none_priv
@@ -3318,22 +3549,29 @@ static HRESULT shader_set_function(struct wined3d_shader *shader, struct wined3d
     const struct wined3d_shader_version *version = &reg_maps->shader_version;
     const struct wined3d_shader_frontend *fe;
     unsigned int backend_version;
+    void *fe_data;
     HRESULT hr;
 
     TRACE("shader %p, device %p, type %s, float_const_count %u.\n",
             shader, device, debug_shader_type(type), float_const_count);
 
     fe = shader->frontend;
-    if (!(shader->frontend_data = fe->shader_init(shader->function,
-            shader->functionLength, &shader->output_signature)))
+    if (!(fe_data = fe->shader_init(shader->function, shader->functionLength, &shader->output_signature)))
     {
         FIXME("Failed to initialize frontend.\n");
         return WINED3DERR_INVALIDCALL;
     }
 
+    /* Decode the byte code once; the passes below and the shader backends
+     * operate on the decoded instructions. */
+    hr = shader_ir_init(&shader->ir, fe, fe_data);
+    fe->shader_free(fe_data);
+    if (FAILED(hr))
+        return hr;
+
     /* First pass: trace shader. */
     if (TRACE_ON(d3d_shader))
-        shader_trace_init(fe, shader->frontend_data);
+        shader_trace_init(&shader->ir);
 
     /* Second pass: figure out which registers are used, what the semantics are, etc. */
     if (FAILED(hr = shader_get_registers_used(shader, float_const_count)))
@@ -3667,7 +3905,7 @@ static HRESULT shader_init(struct wined3d_shader *shader, struct wined3d_device
     return WINED3D_OK;
 
 fail:
-    shader_cleanup(shader);
+    shader_cleanup_unpublished(shader);
     return hr;
 }
 
@@ -3684,7 +3922,7 @@ static HRESULT vertex_shader_init(struct wined3d_shader *shader, struct wined3d_
     if (FAILED(hr = shader_set_function(shader, device,
             WINED3D_SHADER_TYPE_VERTEX, device->adapter->d3d_info.limits.vs_uniform_count)))
     {
-        shader_cleanup(shader);
+        shader_cleanup_unpublished(shader);
         return hr;
     }
 
@@ -3754,9 +3992,14 @@ static HRESULT geometry_shader_init_so_desc(struct wined3d_geometry_shader *gs,
     size_t size;
     char *name;
 
+    /* The stream output descriptions are shared by all the shaders of the
+     * device, which may be created concurrently. */
+    wined3d_mutex_lock();
+
     if ((entry = wine_rb_get(&device->so_descs, so_desc)))
     {
         gs->so_desc = &WINE_RB_ENTRY_VALUE(entry, struct wined3d_so_desc_entry, entry)->desc;
+        wined3d_mutex_unlock();
         return WINED3D_OK;
     }
 
@@ -3769,7 +4012,10 @@ static HRESULT geometry_shader_init_so_desc(struct wined3d_geometry_shader *gs,
             size += strlen(n) + 1;
     }
     if (!(s = heap_alloc(size)))
+    {
+        wined3d_mutex_unlock();
         return E_OUTOFMEMORY;
+    }
 
     s->desc = *so_desc;
 
@@ -3792,11 +4038,14 @@ static HRESULT geometry_shader_init_so_desc(struct wined3d_geometry_shader *gs,
 
     if (wine_rb_put(&device->so_descs, &s->desc, &s->entry) == -1)
     {
+        wined3d_mutex_unlock();
         heap_free(s);
         return E_FAIL;
     }
     gs->so_desc = &s->desc;
 
+    wined3d_mutex_unlock();
+
     return WINED3D_OK;
 }
 
@@ -3896,7 +4145,7 @@ static HRESULT geometry_shader_init(struct wined3d_shader *shader, struct wined3
     return WINED3D_OK;
 
 fail:
-    shader_cleanup(shader);
+    shader_cleanup_unpublished(shader);
     return hr;
 }
 
@@ -4224,7 +4473,7 @@ static HRESULT pixel_shader_init(struct wined3d_shader *shader, struct wined3d_d
     if (FAILED(hr = shader_set_function(shader, device,
             WINED3D_SHADER_TYPE_PIXEL, device->adapter->d3d_info.limits.ps_uniform_count)))
     {
-        shader_cleanup(shader);
+        shader_cleanup_unpublished(shader);
         return hr;
     }
 
@@ -4316,12 +4565,14 @@ HRESULT CDECL wined3d_shader_create_cs(struct wined3d_device *device, const stru
 
     if (FAILED(hr = shader_set_function(object, device, WINED3D_SHADER_TYPE_COMPUTE, 0)))
     {
-        shader_cleanup(object);
+        shader_cleanup_unpublished(object);
         heap_free(object);
         return hr;
     }
 
+    wined3d_mutex_lock();
     wined3d_cs_init_object(device->cs, wined3d_shader_init_object, object);
+    wined3d_mutex_unlock();
 
     TRACE("Created compute shader %p.\n", object);
     *shader = object;
@@ -4350,12 +4601,14 @@ HRESULT CDECL wined3d_shader_create_ds(struct wined3d_device *device, const stru
 
     if (FAILED(hr = shader_set_function(object, device, WINED3D_SHADER_TYPE_DOMAIN, 0)))
     {
-        shader_cleanup(object);
+        shader_cleanup_unpublished(object);
         heap_free(object);
         return hr;
     }
 
+    wined3d_mutex_lock();
     wined3d_cs_init_object(device->cs, wined3d_shader_init_object, object);
+    wined3d_mutex_unlock();
 
     TRACE("Created domain shader %p.\n", object);
     *shader = object;
@@ -4383,7 +4636,9 @@ HRESULT CDECL wined3d_shader_create_gs(struct wined3d_device *device, const stru
         return hr;
     }
 
+    wined3d_mutex_lock();
     wined3d_cs_init_object(device->cs, wined3d_shader_init_object, object);
+    wined3d_mutex_unlock();
 
     TRACE("Created geometry shader %p.\n", object);
     *shader = object;
@@ -4412,12 +4667,14 @@ HRESULT CDECL wined3d_shader_create_hs(struct wined3d_device *device, const stru
 
     if (FAILED(hr = shader_set_function(object, device, WINED3D_SHADER_TYPE_HULL, 0)))
     {
-        shader_cleanup(object);
+        shader_cleanup_unpublished(object);
         heap_free(object);
         return hr;
     }
 
+    wined3d_mutex_lock();
     wined3d_cs_init_object(device->cs, wined3d_shader_init_object, object);
+    wined3d_mutex_unlock();
 
     TRACE("Created hull shader %p.\n", object);
     *shader = object;
@@ -4444,7 +4701,9 @@ HRESULT CDECL wined3d_shader_create_ps(struct wined3d_device *device, const stru
         return hr;
     }
 
+    wined3d_mutex_lock();
     wined3d_cs_init_object(device->cs, wined3d_shader_init_object, object);
+    wined3d_mutex_unlock();
 
     TRACE("Created pixel shader %p.\n", object);
     *shader = object;
@@ -4471,7 +4730,9 @@ HRESULT CDECL wined3d_shader_create_vs(struct wined3d_device *device, const stru
         return hr;
     }
 
+    wined3d_mutex_lock();
     wined3d_cs_init_object(device->cs, wined3d_shader_init_object, object);
+    wined3d_mutex_unlock();
 
     TRACE("Created vertex shader %p.\n", object);
     *shader = object;
@@ -0,0 +1,434 @@
+/*
+ * Persistent shader cache
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "config.h"
+#include "wine/port.h"
+
+#include "wined3d_private.h"
+
+WINE_DEFAULT_DEBUG_CHANNEL(d3d_shader);
+
+/* The cache stores compiled shader blobs (GL program binaries, SPIR-V) on
+ * disk, one file per key hash. Files are written to a temporary name and
+ * renamed into place, so that concurrent processes never see partial entries.
+ * The last write time of an entry is updated when it is loaded, and the least
+ * recently used entries are removed when the cache grows beyond
+ * wined3d_settings.shader_cache_size.
+ *
+ * Each entry stores its complete key, so hash collisions are detected. Keys
+ * are sequences of fields, each preceded by its DWORD size. */
+
+#define WINED3D_SHADER_CACHE_MAGIC   0x32435357 /* "WSC2" */
+#define WINED3D_SHADER_CACHE_MAX_ENTRY_SIZE (16 * 1024 * 1024)
+
+struct wined3d_shader_cache_header
+{
+    DWORD magic;
+    DWORD key_size;
+    DWORD data_size;
+    DWORD padding;
+    UINT64 hash;
+    UINT64 checksum;
+};
+
+struct wined3d_shader_cache_file
+{
+    char name[24];
+    FILETIME time;
+    UINT64 size;
+};
+
+static char shader_cache_dir[MAX_PATH];
+static UINT64 shader_cache_size, shader_cache_limit;
+
+static CRITICAL_SECTION shader_cache_cs;
+static CRITICAL_SECTION_DEBUG shader_cache_cs_debug =
+{
+    0, 0, &shader_cache_cs,
+    {&shader_cache_cs_debug.ProcessLocksList,
+    &shader_cache_cs_debug.ProcessLocksList},
+    0, 0, {(DWORD_PTR)(__FILE__ ": shader_cache_cs")}
+};
+static CRITICAL_SECTION shader_cache_cs = {&shader_cache_cs_debug, -1, 0, 0, 0, 0};
+
+/* 64-bit FNV-1a. */
+UINT64 wined3d_shader_cache_hash(UINT64 hash, const void *data, SIZE_T size)
+{
+    const BYTE *ptr = data;
+    SIZE_T i;
+
+    for (i = 0; i < size; ++i)
+    {
+        hash ^= ptr[i];
+        hash *= 0x100000001b3ull;
+    }
+
+    return hash;
+}
+
+void wined3d_shader_cache_key_init(struct wined3d_shader_cache_key *key)
+{
+    memset(key, 0, sizeof(*key));
+}
+
+void wined3d_shader_cache_key_cleanup(struct wined3d_shader_cache_key *key)
+{
+    heap_free(key->data);
+    memset(key, 0, sizeof(*key));
+}
+
+/* Once a field fails to be added, the key is invalid, and the cache isn't
+ * used for it. */
+void wined3d_shader_cache_key_add(struct wined3d_shader_cache_key *key, const void *data, SIZE_T size)
+{
+    DWORD field_size = size;
+
+    if (key->invalid || size > WINED3D_SHADER_CACHE_MAX_ENTRY_SIZE - sizeof(field_size)
+            || key->size > WINED3D_SHADER_CACHE_MAX_ENTRY_SIZE - sizeof(field_size) - size
+            || !wined3d_array_reserve((void **)&key->data, &key->capacity,
+            key->size + sizeof(field_size) + size, 1))
+    {
+        key->invalid = TRUE;
+        return;
+    }
+
+    memcpy(key->data + key->size, &field_size, sizeof(field_size));
+    key->size += sizeof(field_size);
+    if (size)
+        memcpy(key->data + key->size, data, size);
+    key->size += size;
+}
+
+void wined3d_shader_cache_key_add_uint(struct wined3d_shader_cache_key *key, unsigned int value)
+{
+    wined3d_shader_cache_key_add(key, &value, sizeof(value));
+}
+
+void wined3d_shader_cache_key_add_string(struct wined3d_shader_cache_key *key, const char *str)
+{
+    wined3d_shader_cache_key_add(key, str, str ? strlen(str) + 1 : 0);
+}
+
+void wined3d_shader_cache_key_add_so_desc(struct wined3d_shader_cache_key *key,
+        const struct wined3d_stream_output_desc *desc)
+{
+    unsigned int i;
+
+    wined3d_shader_cache_key_add_uint(key, desc->element_count);
+    for (i = 0; i < desc->element_count; ++i)
+    {
+        const struct wined3d_stream_output_element *e = &desc->elements[i];
+
+        wined3d_shader_cache_key_add_string(key, e->semantic_name);
+        wined3d_shader_cache_key_add_uint(key, e->stream_idx);
+        wined3d_shader_cache_key_add_uint(key, e->semantic_idx);
+        wined3d_shader_cache_key_add_uint(key, e->component_idx);
+        wined3d_shader_cache_key_add_uint(key, e->component_count);
+        wined3d_shader_cache_key_add_uint(key, e->output_slot);
+    }
+    wined3d_shader_cache_key_add(key, desc->buffer_strides,
+            desc->buffer_stride_count * sizeof(*desc->buffer_strides));
+    wined3d_shader_cache_key_add_uint(key, desc->rasterizer_stream_idx);
+}
+
+static BOOL shader_cache_get_path(char *path, SIZE_T size, const char *name)
+{
+    return snprintf(path, size, "%s\\%s", shader_cache_dir, name) < size;
+}
+
+static void shader_cache_get_name(char *name, SIZE_T size, UINT64 hash)
+{
+    snprintf(name, size, "%08x%08x.wsc", (unsigned int)(hash >> 32), (unsigned int)hash);
+}
+
+static BOOL shader_cache_create_dir(const char *path)
+{
+    return CreateDirectoryA(path, NULL) || GetLastError() == ERROR_ALREADY_EXISTS;
+}
+
+static struct wined3d_shader_cache_file *shader_cache_list_files(SIZE_T *count, UINT64 *total_size)
+{
+    struct wined3d_shader_cache_file *files = NULL;
+    SIZE_T files_size = 0;
+    WIN32_FIND_DATAA data;
+    char path[MAX_PATH];
+    HANDLE handle;
+
+    *count = 0;
+    *total_size = 0;
+
+    if (!shader_cache_get_path(path, sizeof(path), "*.wsc"))
+        return NULL;
+    if ((handle = FindFirstFileA(path, &data)) == INVALID_HANDLE_VALUE)
+        return NULL;
+
+    do
+    {
+        struct wined3d_shader_cache_file *file;
+
+        if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY || strlen(data.cFileName) >= sizeof(file->name))
+            continue;
+        if (!wined3d_array_reserve((void **)&files, &files_size, *count + 1, sizeof(*files)))
+            break;
+
+        file = &files[(*count)++];
+        strcpy(file->name, data.cFileName);
+        file->time = data.ftLastWriteTime;
+        file->size = ((UINT64)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+        *total_size += file->size;
+    } while (FindNextFileA(handle, &data));
+    FindClose(handle);
+
+    return files;
+}
+
+/* Temporary files are left behind if a process dies while storing an entry.
+ * Recent ones may still be written to by another process. */
+static void shader_cache_remove_temp_files(void)
+{
+    WIN32_FIND_DATAA data;
+    char path[MAX_PATH];
+    ULARGE_INTEGER now, time;
+    FILETIME ft;
+    HANDLE handle;
+
+    if (!shader_cache_get_path(path, sizeof(path), "wsc*.tmp"))
+        return;
+    if ((handle = FindFirstFileA(path, &data)) == INVALID_HANDLE_VALUE)
+        return;
+
+    GetSystemTimeAsFileTime(&ft);
+    now.u.LowPart = ft.dwLowDateTime;
+    now.u.HighPart = ft.dwHighDateTime;
+    do
+    {
+        time.u.LowPart = data.ftLastWriteTime.dwLowDateTime;
+        time.u.HighPart = data.ftLastWriteTime.dwHighDateTime;
+        if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY
+                || time.QuadPart + 60 * (ULONGLONG)10000000 > now.QuadPart)
+            continue;
+        if (shader_cache_get_path(path, sizeof(path), data.cFileName) && DeleteFileA(path))
+            TRACE("Removed stale temporary file %s.\n", debugstr_a(data.cFileName));
+    } while (FindNextFileA(handle, &data));
+    FindClose(handle);
+}
+
+static BOOL WINAPI shader_cache_init_once(INIT_ONCE *once, void *param, void **context)
+{
+    struct wined3d_shader_cache_file *files;
+    char path[MAX_PATH];
+    SIZE_T count;
+    DWORD len;
+
+    if (!wined3d_settings.shader_cache_size)
+    {
+        TRACE("Shader cache disabled.\n");
+        return TRUE;
+    }
+
+    if (wined3d_settings.shader_cache_path)
+    {
+        if (strlen(wined3d_settings.shader_cache_path) >= sizeof(path))
+            return TRUE;
+        strcpy(path, wined3d_settings.shader_cache_path);
+    }
+    else
+    {
+        len = GetEnvironmentVariableA("LOCALAPPDATA", path, sizeof(path));
+        if (!len || len + strlen("\\wine\\shader_cache") >= sizeof(path))
+        {
+            WARN("Failed to get the local application data directory.\n");
+            return TRUE;
+        }
+        strcat(path, "\\wine");
+        shader_cache_create_dir(path);
+        strcat(path, "\\shader_cache");
+    }
+
+    if (!shader_cache_create_dir(path))
+    {
+        WARN("Failed to create shader cache directory %s, error %u.\n", debugstr_a(path), GetLastError());
+        return TRUE;
+    }
+
+    strcpy(shader_cache_dir, path);
+    shader_cache_limit = (UINT64)wined3d_settings.shader_cache_size * 1024 * 1024;
+    shader_cache_remove_temp_files();
+    files = shader_cache_list_files(&count, &shader_cache_size);
+    heap_free(files);
+
+    TRACE("Using shader cache %s, %lu entries, %s bytes.\n", debugstr_a(shader_cache_dir),
+            count, wine_dbgstr_longlong(shader_cache_size));
+
+    return TRUE;
+}
+
+static BOOL shader_cache_init(void)
+{
+    static INIT_ONCE init_once = INIT_ONCE_STATIC_INIT;
+
+    InitOnceExecuteOnce(&init_once, shader_cache_init_once, NULL, NULL);
+    return !!shader_cache_dir[0];
+}
+
+static int shader_cache_file_compare(const void *a, const void *b)
+{
+    const struct wined3d_shader_cache_file *f1 = a, *f2 = b;
+
+    return CompareFileTime(&f1->time, &f2->time);
+}
+
+/* Remove the least recently used entries until the cache uses at most 3/4 of
+ * its size limit. The caller must hold shader_cache_cs. */
+static void shader_cache_evict(void)
+{
+    struct wined3d_shader_cache_file *files;
+    char path[MAX_PATH];
+    SIZE_T count, i;
+
+    /* Other processes may have added or removed entries. */
+    files = shader_cache_list_files(&count, &shader_cache_size);
+    qsort(files, count, sizeof(*files), shader_cache_file_compare);
+
+    for (i = 0; i < count && shader_cache_size > shader_cache_limit / 4 * 3; ++i)
+    {
+        if (!shader_cache_get_path(path, sizeof(path), files[i].name) || !DeleteFileA(path))
+            continue;
+        TRACE("Evicted %s.\n", debugstr_a(files[i].name));
+        shader_cache_size -= files[i].size;
+    }
+
+    heap_free(files);
+}
+
+void *wined3d_shader_cache_load(const struct wined3d_shader_cache_key *key, SIZE_T *size)
+{
+    struct wined3d_shader_cache_header header;
+    char name[24], path[MAX_PATH];
+    BYTE *entry;
+    FILETIME now;
+    HANDLE file;
+    UINT64 hash;
+    DWORD count;
+
+    if (key->invalid || !shader_cache_init())
+        return NULL;
+
+    hash = wined3d_shader_cache_hash(WINED3D_SHADER_CACHE_HASH_INIT, key->data, key->size);
+    shader_cache_get_name(name, sizeof(name), hash);
+    if (!shader_cache_get_path(path, sizeof(path), name))
+        return NULL;
+
+    if ((file = CreateFileA(path, GENERIC_READ | FILE_WRITE_ATTRIBUTES,
+            FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, 0, NULL))
+            == INVALID_HANDLE_VALUE)
+    {
+        TRACE("Cache miss for %s.\n", debugstr_a(name));
+        return NULL;
+    }
+
+    if (!ReadFile(file, &header, sizeof(header), &count, NULL) || count != sizeof(header)
+            || header.magic != WINED3D_SHADER_CACHE_MAGIC || header.hash != hash || header.key_size != key->size
+            || header.data_size > WINED3D_SHADER_CACHE_MAX_ENTRY_SIZE
+            || !(entry = heap_alloc(header.key_size + header.data_size)))
+    {
+        WARN("Invalid cache entry %s.\n", debugstr_a(name));
+        CloseHandle(file);
+        return NULL;
+    }
+
+    if (!ReadFile(file, entry, header.key_size + header.data_size, &count, NULL)
+            || count != header.key_size + header.data_size
+            || wined3d_shader_cache_hash(WINED3D_SHADER_CACHE_HASH_INIT, entry, count) != header.checksum)
+    {
+        WARN("Corrupted cache entry %s.\n", debugstr_a(name));
+        CloseHandle(file);
+        heap_free(entry);
+        return NULL;
+    }
+
+    if (memcmp(entry, key->data, key->size))
+    {
+        TRACE("Hash collision for %s.\n", debugstr_a(name));
+        CloseHandle(file);
+        heap_free(entry);
+        return NULL;
+    }
+
+    GetSystemTimeAsFileTime(&now);
+    SetFileTime(file, NULL, NULL, &now);
+    CloseHandle(file);
+
+    TRACE("Loaded %u bytes from %s.\n", header.data_size, debugstr_a(name));
+
+    /* Return the data alone, at the start of the allocation. */
+    memmove(entry, entry + header.key_size, header.data_size);
+    *size = header.data_size;
+    return entry;
+}
+
+void wined3d_shader_cache_store(const struct wined3d_shader_cache_key *key, const void *data, SIZE_T size)
+{
+    struct wined3d_shader_cache_header header;
+    char name[24], path[MAX_PATH], tmp_path[MAX_PATH];
+    DWORD written;
+    HANDLE file;
+    BOOL ret;
+
+    if (key->invalid || !shader_cache_init() || size > WINED3D_SHADER_CACHE_MAX_ENTRY_SIZE - key->size)
+        return;
+
+    header.magic = WINED3D_SHADER_CACHE_MAGIC;
+    header.key_size = key->size;
+    header.data_size = size;
+    header.padding = 0;
+    header.hash = wined3d_shader_cache_hash(WINED3D_SHADER_CACHE_HASH_INIT, key->data, key->size);
+    header.checksum = wined3d_shader_cache_hash(header.hash, data, size);
+
+    shader_cache_get_name(name, sizeof(name), header.hash);
+    if (!shader_cache_get_path(path, sizeof(path), name)
+            || !GetTempFileNameA(shader_cache_dir, "wsc", 0, tmp_path))
+        return;
+
+    if ((file = CreateFileA(tmp_path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, NULL)) == INVALID_HANDLE_VALUE)
+    {
+        WARN("Failed to create %s, error %u.\n", debugstr_a(tmp_path), GetLastError());
+        DeleteFileA(tmp_path);
+        return;
+    }
+
+    ret = WriteFile(file, &header, sizeof(header), &written, NULL) && written == sizeof(header)
+            && WriteFile(file, key->data, key->size, &written, NULL) && written == key->size
+            && WriteFile(file, data, size, &written, NULL) && written == size;
+    CloseHandle(file);
+
+    if (!ret || !MoveFileExA(tmp_path, path, MOVEFILE_REPLACE_EXISTING))
+    {
+        WARN("Failed to write cache entry %s, error %u.\n", debugstr_a(name), GetLastError());
+        DeleteFileA(tmp_path);
+        return;
+    }
+
+    TRACE("Stored %lu bytes in %s.\n", size, debugstr_a(name));
+
+    EnterCriticalSection(&shader_cache_cs);
+    shader_cache_size += sizeof(header) + key->size + size;
+    if (shader_cache_size > shader_cache_limit)
+        shader_cache_evict();
+    LeaveCriticalSection(&shader_cache_cs);
+}
@@ -78,6 +78,19 @@ struct shader_spirv_compile_arguments
     } u;
 };
 
+/* A variant compiled on a worker thread. The job owns a copy of the resource
+ * bindings, and "done" is signalled once "vk_module" is set. */
+struct shader_spirv_compile_job
+{
+    struct wined3d_device_vk *device_vk;
+    struct wined3d_shader *shader;
+    struct shader_spirv_compile_arguments args;
+    struct shader_spirv_resource_bindings bindings;
+
+    VkShaderModule vk_module;
+    HANDLE done;
+};
+
 struct shader_spirv_graphics_program_variant_vk
 {
     struct shader_spirv_compile_arguments compile_args;
@@ -85,6 +98,7 @@ struct shader_spirv_graphics_program_variant_vk
     size_t binding_base;
 
     VkShaderModule vk_module;
+    struct shader_spirv_compile_job *job;
 };
 
 struct shader_spirv_graphics_program_vk
@@ -101,6 +115,7 @@ struct shader_spirv_compute_program_vk
     VkPipeline vk_pipeline;
     VkPipelineLayout vk_pipeline_layout;
     VkDescriptorSetLayout vk_set_layout;
+    VkDescriptorUpdateTemplate vk_update_template;
 
     struct vkd3d_shader_scan_descriptor_info descriptor_info;
 };
@@ -304,23 +319,128 @@ static void shader_spirv_init_shader_interface_vk(struct wined3d_shader_spirv_sh
     iface->vkd3d_interface.uav_counter_count = b->uav_counter_count;
 }
 
-static VkShaderModule shader_spirv_compile(struct wined3d_context_vk *context_vk,
+static void shader_spirv_key_add_descriptor_binding(struct wined3d_shader_cache_key *key,
+        const struct vkd3d_shader_descriptor_binding *b)
+{
+    wined3d_shader_cache_key_add_uint(key, b->set);
+    wined3d_shader_cache_key_add_uint(key, b->binding);
+    wined3d_shader_cache_key_add_uint(key, b->count);
+}
+
+/* The key is built from the individual fields of the compile inputs, so that
+ * padding and unused union members never end up in it. */
+static void shader_spirv_get_cache_key(struct wined3d_shader_cache_key *key, const struct wined3d_shader *shader,
+        const struct shader_spirv_compile_arguments *args, const struct shader_spirv_resource_bindings *bindings,
+        const struct wined3d_stream_output_desc *so_desc)
+{
+    enum wined3d_shader_type shader_type = shader->reg_maps.shader_version.type;
+    SIZE_T i;
+
+    wined3d_shader_cache_key_init(key);
+    wined3d_shader_cache_key_add_string(key, vkd3d_shader_get_version(NULL, NULL));
+    wined3d_shader_cache_key_add(key, shader->byte_code, shader->byte_code_size);
+    wined3d_shader_cache_key_add_uint(key, shader_type);
+    if (args && shader_type == WINED3D_SHADER_TYPE_PIXEL)
+    {
+        wined3d_shader_cache_key_add_uint(key, args->u.fs.alpha_swizzle);
+        wined3d_shader_cache_key_add_uint(key, args->u.fs.sample_count);
+    }
+
+    wined3d_shader_cache_key_add_uint(key, bindings->binding_count);
+    for (i = 0; i < bindings->binding_count; ++i)
+    {
+        const struct vkd3d_shader_resource_binding *b = &bindings->bindings[i];
+
+        wined3d_shader_cache_key_add_uint(key, b->type);
+        wined3d_shader_cache_key_add_uint(key, b->register_space);
+        wined3d_shader_cache_key_add_uint(key, b->register_index);
+        wined3d_shader_cache_key_add_uint(key, b->shader_visibility);
+        wined3d_shader_cache_key_add_uint(key, b->flags);
+        shader_spirv_key_add_descriptor_binding(key, &b->binding);
+    }
+
+    wined3d_shader_cache_key_add_uint(key, bindings->uav_counter_count);
+    for (i = 0; i < bindings->uav_counter_count; ++i)
+    {
+        const struct vkd3d_shader_uav_counter_binding *c = &bindings->uav_counters[i];
+
+        wined3d_shader_cache_key_add_uint(key, c->register_space);
+        wined3d_shader_cache_key_add_uint(key, c->register_index);
+        wined3d_shader_cache_key_add_uint(key, c->shader_visibility);
+        shader_spirv_key_add_descriptor_binding(key, &c->binding);
+        wined3d_shader_cache_key_add_uint(key, c->offset);
+    }
+
+    wined3d_shader_cache_key_add_uint(key, !!so_desc);
+    if (so_desc)
+        wined3d_shader_cache_key_add_so_desc(key, so_desc);
+}
+
+static VkShaderModule shader_spirv_create_module(struct wined3d_device_vk *device_vk, const void *code, size_t size)
+{
+    const struct wined3d_vk_info *vk_info = &device_vk->vk_info;
+    VkShaderModuleCreateInfo shader_desc;
+    VkShaderModule module;
+    VkResult vr;
+
+    shader_desc.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    shader_desc.pNext = NULL;
+    shader_desc.flags = 0;
+    shader_desc.codeSize = size;
+    shader_desc.pCode = code;
+    if ((vr = VK_CALL(vkCreateShaderModule(device_vk->vk_device, &shader_desc, NULL, &module))) < 0)
+    {
+        WARN("Failed to create Vulkan shader module, vr %s.\n", wined3d_debug_vkresult(vr));
+        return VK_NULL_HANDLE;
+    }
+
+    return module;
+}
+
+/* This may be called from worker threads, see shader_spirv_compile_job_proc(). */
+static VkShaderModule shader_spirv_compile(struct wined3d_device_vk *device_vk,
         struct wined3d_shader *shader, const struct shader_spirv_compile_arguments *args,
         const struct shader_spirv_resource_bindings *bindings, const struct wined3d_stream_output_desc *so_desc)
 {
     struct wined3d_shader_spirv_compile_args compile_args;
     struct wined3d_shader_spirv_shader_interface iface;
+    struct wined3d_shader_cache_key key;
     struct vkd3d_shader_compile_info info;
-    const struct wined3d_vk_info *vk_info;
     enum wined3d_shader_type shader_type;
-    VkShaderModuleCreateInfo shader_desc;
-    struct wined3d_device_vk *device_vk;
     struct vkd3d_shader_code spirv;
     VkShaderModule module;
+    LONGLONG start = 0;
+    SIZE_T size;
     char *messages;
-    VkResult vr;
+    void *code;
     int ret;
 
+    if (wined3d_settings.frame_stats)
+        start = wined3d_frame_stats_time();
+
+    wined3d_shader_cache_key_init(&key);
+    if (wined3d_settings.shader_cache_size)
+    {
+        shader_spirv_get_cache_key(&key, shader, args, bindings, so_desc);
+        if ((code = wined3d_shader_cache_load(&key, &size)))
+        {
+            module = size % 4 ? VK_NULL_HANDLE : shader_spirv_create_module(device_vk, code, size);
+            heap_free(code);
+            if (module)
+            {
+                TRACE("Loaded shader %p from the shader cache.\n", shader);
+                wined3d_shader_cache_key_cleanup(&key);
+                if (wined3d_settings.frame_stats)
+                {
+                    wined3d_frame_stats_add(WINED3D_FRAME_COUNTER_SHADER_CACHE_HITS, 1);
+                    wined3d_frame_stats_add(WINED3D_FRAME_COUNTER_SHADER_COMPILE_TIME,
+                            wined3d_frame_stats_time() - start);
+                }
+                return module;
+            }
+        }
+    }
+
     shader_spirv_init_shader_interface_vk(&iface, shader, bindings, so_desc);
     shader_type = shader->reg_maps.shader_version.type;
     shader_spirv_init_compile_args(&compile_args, &iface.vkd3d_interface,
@@ -337,6 +457,7 @@ static VkShaderModule shader_spirv_compile(struct wined3d_context_vk *context_vk
     info.log_level = VKD3D_SHADER_LOG_WARNING;
     info.source_name = NULL;
 
+    wined3d_frame_stats_add(WINED3D_FRAME_COUNTER_SHADER_COMPILES, 1);
     ret = vkd3d_shader_compile(&info, &spirv, &messages);
     if (messages && *messages && FIXME_ON(d3d_shader))
     {
@@ -355,33 +476,118 @@ static VkShaderModule shader_spirv_compile(struct wined3d_context_vk *context_vk
     if (ret < 0)
     {
         ERR("Failed to compile DXBC, ret %d.\n", ret);
+        wined3d_shader_cache_key_cleanup(&key);
         return VK_NULL_HANDLE;
     }
 
-    device_vk = wined3d_device_vk(context_vk->c.device);
-    vk_info = &device_vk->vk_info;
+    if ((module = shader_spirv_create_module(device_vk, spirv.code, spirv.size)) && key.size)
+        wined3d_shader_cache_store(&key, spirv.code, spirv.size);
 
-    shader_desc.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    shader_desc.pNext = NULL;
-    shader_desc.flags = 0;
-    shader_desc.codeSize = spirv.size;
-    shader_desc.pCode = spirv.code;
-    if ((vr = VK_CALL(vkCreateShaderModule(device_vk->vk_device, &shader_desc, NULL, &module))) < 0)
+    vkd3d_shader_free_shader_code(&spirv);
+    wined3d_shader_cache_key_cleanup(&key);
+
+    if (wined3d_settings.frame_stats)
+        wined3d_frame_stats_add(WINED3D_FRAME_COUNTER_SHADER_COMPILE_TIME, wined3d_frame_stats_time() - start);
+
+    return module;
+}
+
+static DWORD WINAPI shader_spirv_compile_job_proc(void *ctx)
+{
+    struct shader_spirv_compile_job *job = ctx;
+
+    job->vk_module = shader_spirv_compile(job->device_vk, job->shader, &job->args, &job->bindings, NULL);
+    SetEvent(job->done);
+
+    return 0;
+}
+
+static void shader_spirv_compile_job_destroy(struct shader_spirv_compile_job *job)
+{
+    CloseHandle(job->done);
+    heap_free(job->bindings.bindings);
+    heap_free(job);
+}
+
+static struct shader_spirv_compile_job *shader_spirv_compile_job_create(struct wined3d_device_vk *device_vk,
+        struct wined3d_shader *shader, const struct shader_spirv_compile_arguments *args,
+        const struct shader_spirv_resource_bindings *bindings)
+{
+    struct shader_spirv_compile_job *job;
+
+    if (!(job = heap_alloc_zero(sizeof(*job))))
+        return NULL;
+
+    job->device_vk = device_vk;
+    job->shader = shader;
+    job->args = *args;
+    if (!(job->bindings.bindings = heap_calloc(bindings->binding_count, sizeof(*bindings->bindings))))
     {
-        vkd3d_shader_free_shader_code(&spirv);
-        WARN("Failed to create Vulkan shader module, vr %s.\n", wined3d_debug_vkresult(vr));
-        return VK_NULL_HANDLE;
+        heap_free(job);
+        return NULL;
     }
+    memcpy(job->bindings.bindings, bindings->bindings, bindings->binding_count * sizeof(*bindings->bindings));
+    job->bindings.bindings_size = job->bindings.binding_count = bindings->binding_count;
+    memcpy(job->bindings.uav_counters, bindings->uav_counters,
+            bindings->uav_counter_count * sizeof(*bindings->uav_counters));
+    job->bindings.uav_counter_count = bindings->uav_counter_count;
 
-    vkd3d_shader_free_shader_code(&spirv);
+    if (!(job->done = CreateEventW(NULL, TRUE, FALSE, NULL)))
+    {
+        shader_spirv_compile_job_destroy(job);
+        return NULL;
+    }
 
-    return module;
+    if (!QueueUserWorkItem(shader_spirv_compile_job_proc, job, WT_EXECUTEDEFAULT))
+    {
+        WARN("Failed to queue compile job, error %u.\n", GetLastError());
+        shader_spirv_compile_job_destroy(job);
+        return NULL;
+    }
+
+    return job;
+}
+
+/* Returns false if the job is still running. */
+static bool shader_spirv_compile_job_complete(struct shader_spirv_graphics_program_variant_vk *variant_vk, DWORD timeout)
+{
+    struct shader_spirv_compile_job *job = variant_vk->job;
+
+    if (WaitForSingleObject(job->done, timeout))
+        return false;
+
+    variant_vk->vk_module = job->vk_module;
+    variant_vk->job = NULL;
+    shader_spirv_compile_job_destroy(job);
+
+    return true;
+}
+
+/* Skipping draws is only acceptable when the shader has no side effects. */
+static bool shader_spirv_can_compile_async(const struct shader_spirv_graphics_program_vk *program_vk,
+        const struct wined3d_stream_output_desc *so_desc)
+{
+    unsigned int i;
+
+    if (!wined3d_settings.async_shader_compile || so_desc)
+        return false;
+
+    for (i = 0; i < program_vk->descriptor_info.descriptor_count; ++i)
+    {
+        if (program_vk->descriptor_info.descriptors[i].type == VKD3D_SHADER_DESCRIPTOR_TYPE_UAV)
+            return false;
+    }
+
+    return true;
 }
 
+/* Returns a variant without a Vulkan module if the variant is still being
+ * compiled. */
 static struct shader_spirv_graphics_program_variant_vk *shader_spirv_find_graphics_program_variant_vk(
         struct shader_spirv_priv *priv, struct wined3d_context_vk *context_vk, struct wined3d_shader *shader,
         const struct wined3d_state *state, const struct shader_spirv_resource_bindings *bindings)
 {
+    struct wined3d_device_vk *device_vk = wined3d_device_vk(context_vk->c.device);
     enum wined3d_shader_type shader_type = shader->reg_maps.shader_version.type;
     struct shader_spirv_graphics_program_variant_vk *variant_vk;
     size_t binding_base = bindings->binding_base[shader_type];
@@ -403,7 +609,11 @@ static struct shader_spirv_graphics_program_variant_vk *shader_spirv_find_graphi
         variant_vk = &program_vk->variants[i];
         if (variant_vk->so_desc == so_desc && variant_vk->binding_base == binding_base
                 && !memcmp(&variant_vk->compile_args, &args, sizeof(args)))
-            return variant_vk;
+        {
+            if (variant_vk->job && !shader_spirv_compile_job_complete(variant_vk, 0))
+                return variant_vk;
+            return variant_vk->vk_module ? variant_vk : NULL;
+        }
     }
 
     if (!wined3d_array_reserve((void **)&program_vk->variants, &program_vk->variants_size,
@@ -412,8 +622,20 @@ static struct shader_spirv_graphics_program_variant_vk *shader_spirv_find_graphi
 
     variant_vk = &program_vk->variants[variant_count];
     variant_vk->compile_args = args;
+    variant_vk->so_desc = so_desc;
     variant_vk->binding_base = binding_base;
-    if (!(variant_vk->vk_module = shader_spirv_compile(context_vk, shader, &args, bindings, so_desc)))
+    variant_vk->vk_module = VK_NULL_HANDLE;
+    variant_vk->job = NULL;
+
+    if (shader_spirv_can_compile_async(program_vk, so_desc)
+            && (variant_vk->job = shader_spirv_compile_job_create(device_vk, shader, &args, bindings)))
+    {
+        TRACE("Compiling variant %p of shader %p asynchronously.\n", variant_vk, shader);
+        ++program_vk->variant_count;
+        return variant_vk;
+    }
+
+    if (!(variant_vk->vk_module = shader_spirv_compile(device_vk, shader, &args, bindings, so_desc)))
         return NULL;
     ++program_vk->variant_count;
 
@@ -429,6 +651,7 @@ static struct shader_spirv_compute_program_vk *shader_spirv_find_compute_program
     struct shader_spirv_compute_program_vk *program;
     struct wined3d_pipeline_layout_vk *layout;
     VkComputePipelineCreateInfo pipeline_info;
+    LONGLONG start = 0;
     VkResult vr;
 
     if (!(program = shader->backend_data))
@@ -437,7 +660,7 @@ static struct shader_spirv_compute_program_vk *shader_spirv_find_compute_program
     if (program->vk_module)
         return program;
 
-    if (!(program->vk_module = shader_spirv_compile(context_vk, shader, NULL, bindings, NULL)))
+    if (!(program->vk_module = shader_spirv_compile(device_vk, shader, NULL, bindings, NULL)))
         return NULL;
 
     if (!(layout = wined3d_context_vk_get_pipeline_layout(context_vk,
@@ -448,6 +671,7 @@ static struct shader_spirv_compute_program_vk *shader_spirv_find_compute_program
         return NULL;
     }
     program->vk_set_layout = layout->vk_set_layout;
+    program->vk_update_template = layout->vk_update_template;
     program->vk_pipeline_layout = layout->vk_pipeline_layout;
 
     pipeline_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
@@ -463,14 +687,21 @@ static struct shader_spirv_compute_program_vk *shader_spirv_find_compute_program
     pipeline_info.layout = program->vk_pipeline_layout;
     pipeline_info.basePipelineHandle = VK_NULL_HANDLE;
     pipeline_info.basePipelineIndex = -1;
-    if ((vr = VK_CALL(vkCreateComputePipelines(device_vk->vk_device,
-            VK_NULL_HANDLE, 1, &pipeline_info, NULL, &program->vk_pipeline))) < 0)
+    if (wined3d_settings.frame_stats)
+        start = wined3d_frame_stats_time();
+    if ((vr = VK_CALL(vkCreateComputePipelines(device_vk->vk_device, device_vk->vk_pipeline_cache,
+            1, &pipeline_info, NULL, &program->vk_pipeline))) < 0)
     {
         ERR("Failed to create Vulkan compute pipeline, vr %s.\n", wined3d_debug_vkresult(vr));
         VK_CALL(vkDestroyShaderModule(device_vk->vk_device, program->vk_module, NULL));
         program->vk_module = VK_NULL_HANDLE;
         return NULL;
     }
+    if (wined3d_settings.frame_stats)
+    {
+        wined3d_frame_stats_add(WINED3D_FRAME_COUNTER_PIPELINE_COMPILES, 1);
+        wined3d_frame_stats_add(WINED3D_FRAME_COUNTER_PIPELINE_COMPILE_TIME, wined3d_frame_stats_time() - start);
+    }
 
     return program;
 }
@@ -831,6 +1062,7 @@ static void shader_spirv_select(void *shader_priv, struct wined3d_context *conte
     priv->vertex_pipe->vp_enable(context, !use_vs(state));
     priv->fragment_pipe->fp_enable(context, !use_ps(state));
 
+    context_vk->shaders_pending = 0;
     bindings = &priv->bindings;
     memcpy(binding_base, bindings->binding_base, sizeof(bindings->binding_base));
     if (!shader_spirv_resource_bindings_init(bindings, &context_vk->graphics.bindings,
@@ -844,6 +1076,7 @@ static void shader_spirv_select(void *shader_priv, struct wined3d_context *conte
 
     layout_vk = wined3d_context_vk_get_pipeline_layout(context_vk, bindings->vk_bindings, bindings->vk_binding_count);
     context_vk->graphics.vk_set_layout = layout_vk->vk_set_layout;
+    context_vk->graphics.vk_update_template = layout_vk->vk_update_template;
     context_vk->graphics.vk_pipeline_layout = layout_vk->vk_pipeline_layout;
 
     for (shader_type = 0; shader_type < ARRAY_SIZE(context_vk->graphics.vk_modules); ++shader_type)
@@ -860,13 +1093,24 @@ static void shader_spirv_select(void *shader_priv, struct wined3d_context *conte
 
         if (!(variant_vk = shader_spirv_find_graphics_program_variant_vk(priv, context_vk, shader, state, bindings)))
             goto fail;
+        if (!variant_vk->vk_module)
+        {
+            /* Keep looking up the other stages, so that their compilation
+             * starts as well. */
+            context_vk->shaders_pending = 1;
+            continue;
+        }
         context_vk->graphics.vk_modules[shader_type] = variant_vk->vk_module;
     }
 
+    if (context_vk->shaders_pending)
+        goto fail;
+
     return;
 
 fail:
     context_vk->graphics.vk_set_layout = VK_NULL_HANDLE;
+    context_vk->graphics.vk_update_template = VK_NULL_HANDLE;
     context_vk->graphics.vk_pipeline_layout = VK_NULL_HANDLE;
 }
 
@@ -891,12 +1135,14 @@ static void shader_spirv_select_compute(void *shader_priv,
     {
         context_vk->compute.vk_pipeline = program->vk_pipeline;
         context_vk->compute.vk_set_layout = program->vk_set_layout;
+        context_vk->compute.vk_update_template = program->vk_update_template;
         context_vk->compute.vk_pipeline_layout = program->vk_pipeline_layout;
     }
     else
     {
         context_vk->compute.vk_pipeline = VK_NULL_HANDLE;
         context_vk->compute.vk_set_layout = VK_NULL_HANDLE;
+        context_vk->compute.vk_update_template = VK_NULL_HANDLE;
         context_vk->compute.vk_pipeline_layout = VK_NULL_HANDLE;
     }
 }
@@ -1016,6 +1262,8 @@ static void shader_spirv_destroy(struct wined3d_shader *shader)
     for (i = 0; i < program_vk->variant_count; ++i)
     {
         variant_vk = &program_vk->variants[i];
+        if (variant_vk->job)
+            shader_spirv_compile_job_complete(variant_vk, INFINITE);
         shader_spirv_invalidate_contexts_graphics_program_variant(&device_vk->d, variant_vk);
         VK_CALL(vkDestroyShaderModule(device_vk->vk_device, variant_vk->vk_module, NULL));
     }
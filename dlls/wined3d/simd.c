@@ -0,0 +1,114 @@
+/*
+ * Vectorised CPU format conversions and blits
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "config.h"
+#include "wine/port.h"
+#include "wined3d_private.h"
+
+WINE_DEFAULT_DEBUG_CHANNEL(d3d);
+
+/* The C versions, used for the end of the rows. */
+static struct wined3d_row_funcs row_funcs_c;
+
+#if defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+
+/* The row functions are built from simd_row.h once per vector size, using the
+ * compiler vector extensions. On x86 the variants are compiled for the
+ * corresponding instruction set and selected at runtime, elsewhere the native
+ * vector size is used. */
+
+#define ROW_FUNC(name) ROW_FUNC_(name, ROW_SUFFIX)
+#define ROW_FUNC_(name, suffix) ROW_FUNC__(name, suffix)
+#define ROW_FUNC__(name, suffix) name##_##suffix
+
+#define SET_ROW_FUNCS(funcs, suffix) \
+    do { \
+        (funcs)->fill_row_16 = fill_row_16_##suffix; \
+        (funcs)->fill_row_32 = fill_row_32_##suffix; \
+        (funcs)->or_row_32 = or_row_32_##suffix; \
+        (funcs)->convert_row_x8_d24_upload = convert_row_x8_d24_upload_##suffix; \
+        (funcs)->convert_row_x8_d24_download = convert_row_x8_d24_download_##suffix; \
+        (funcs)->convert_row_r8g8b8a8_snorm = convert_row_r8g8b8a8_snorm_##suffix; \
+        (funcs)->convert_row_r5g6b5_x8r8g8b8 = convert_row_r5g6b5_x8r8g8b8_##suffix; \
+        (funcs)->color_key_row_b5g6r5 = color_key_row_b5g6r5_##suffix; \
+        (funcs)->color_key_row_b5g5r5x1 = color_key_row_b5g5r5x1_##suffix; \
+        (funcs)->color_key_row_32 = color_key_row_32_##suffix; \
+        (funcs)->blt_row_color_key_16 = blt_row_color_key_16_##suffix; \
+        (funcs)->blt_row_color_key_32 = blt_row_color_key_32_##suffix; \
+    } while (0)
+
+#if defined(__i386__) || defined(__x86_64__)
+
+#define ROW_SUFFIX   sse2
+#define ROW_TARGET   __attribute__((target("sse2")))
+#define ROW_VEC_SIZE 16
+#include "simd_row.h"
+#undef ROW_SUFFIX
+#undef ROW_TARGET
+#undef ROW_VEC_SIZE
+
+#define ROW_SUFFIX   avx2
+#define ROW_TARGET   __attribute__((target("avx2")))
+#define ROW_VEC_SIZE 32
+#include "simd_row.h"
+#undef ROW_SUFFIX
+#undef ROW_TARGET
+#undef ROW_VEC_SIZE
+
+void wined3d_init_row_funcs(void)
+{
+    row_funcs_c = wined3d_row_funcs;
+
+    if (IsProcessorFeaturePresent(PF_AVX2_INSTRUCTIONS_AVAILABLE))
+    {
+        TRACE("Using AVX2 row functions.\n");
+        SET_ROW_FUNCS(&wined3d_row_funcs, avx2);
+    }
+    else if (IsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE))
+    {
+        TRACE("Using SSE2 row functions.\n");
+        SET_ROW_FUNCS(&wined3d_row_funcs, sse2);
+    }
+}
+
+#else  /* __i386__ || __x86_64__ */
+
+#define ROW_SUFFIX   vec
+#define ROW_TARGET
+#define ROW_VEC_SIZE 16
+#include "simd_row.h"
+#undef ROW_SUFFIX
+#undef ROW_TARGET
+#undef ROW_VEC_SIZE
+
+void wined3d_init_row_funcs(void)
+{
+    row_funcs_c = wined3d_row_funcs;
+    SET_ROW_FUNCS(&wined3d_row_funcs, vec);
+}
+
+#endif  /* __i386__ || __x86_64__ */
+
+#else  /* __clang__ || __GNUC__ */
+
+void wined3d_init_row_funcs(void)
+{
+    row_funcs_c = wined3d_row_funcs;
+}
+
+#endif  /* __clang__ || __GNUC__ */
@@ -0,0 +1,237 @@
+/*
+ * Vectorised row functions for the CPU format conversions and blits
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+/* This file is included multiple times by simd.c, with ROW_SUFFIX, ROW_TARGET
+ * and ROW_VEC_SIZE defined to the name suffix, the compiler target and the
+ * vector size in bytes of the functions to build. The results must be
+ * identical to the C versions in utils.c, which also handle the end of the
+ * rows. */
+
+#define ROW_PIXELS_16 (ROW_VEC_SIZE / 2)
+#define ROW_PIXELS_32 (ROW_VEC_SIZE / 4)
+
+typedef uint32_t ROW_FUNC(vec32) __attribute__((vector_size(ROW_VEC_SIZE), aligned(4), may_alias));
+typedef uint16_t ROW_FUNC(vec16) __attribute__((vector_size(ROW_VEC_SIZE), aligned(2), may_alias));
+
+static ROW_TARGET void ROW_FUNC(fill_row_16)(uint16_t *dst, uint16_t value, unsigned int count)
+{
+    ROW_FUNC(vec16) v = {0};
+    unsigned int x;
+
+    v += value;
+    for (x = 0; x + ROW_PIXELS_16 <= count; x += ROW_PIXELS_16)
+        *(ROW_FUNC(vec16) *)(dst + x) = v;
+    row_funcs_c.fill_row_16(dst + x, value, count - x);
+}
+
+static ROW_TARGET void ROW_FUNC(fill_row_32)(uint32_t *dst, uint32_t value, unsigned int count)
+{
+    ROW_FUNC(vec32) v = {0};
+    unsigned int x;
+
+    v += value;
+    for (x = 0; x + ROW_PIXELS_32 <= count; x += ROW_PIXELS_32)
+        *(ROW_FUNC(vec32) *)(dst + x) = v;
+    row_funcs_c.fill_row_32(dst + x, value, count - x);
+}
+
+static ROW_TARGET void ROW_FUNC(or_row_32)(uint32_t *dst, const uint32_t *src, uint32_t value, unsigned int count)
+{
+    unsigned int x;
+
+    for (x = 0; x + ROW_PIXELS_32 <= count; x += ROW_PIXELS_32)
+        *(ROW_FUNC(vec32) *)(dst + x) = *(const ROW_FUNC(vec32) *)(src + x) | value;
+    row_funcs_c.or_row_32(dst + x, src + x, value, count - x);
+}
+
+static ROW_TARGET void ROW_FUNC(convert_row_x8_d24_upload)(uint32_t *dst, const uint32_t *src, unsigned int count)
+{
+    ROW_FUNC(vec32) c;
+    unsigned int x;
+
+    for (x = 0; x + ROW_PIXELS_32 <= count; x += ROW_PIXELS_32)
+    {
+        c = *(const ROW_FUNC(vec32) *)(src + x);
+        *(ROW_FUNC(vec32) *)(dst + x) = c << 8 | ((c >> 16) & 0xff);
+    }
+    row_funcs_c.convert_row_x8_d24_upload(dst + x, src + x, count - x);
+}
+
+static ROW_TARGET void ROW_FUNC(convert_row_x8_d24_download)(uint32_t *dst, const uint32_t *src, unsigned int count)
+{
+    unsigned int x;
+
+    for (x = 0; x + ROW_PIXELS_32 <= count; x += ROW_PIXELS_32)
+        *(ROW_FUNC(vec32) *)(dst + x) = *(const ROW_FUNC(vec32) *)(src + x) >> 8;
+    row_funcs_c.convert_row_x8_d24_download(dst + x, src + x, count - x);
+}
+
+static ROW_TARGET void ROW_FUNC(convert_row_r8g8b8a8_snorm)(uint32_t *dst, const uint32_t *src, unsigned int count)
+{
+    ROW_FUNC(vec32) c;
+    unsigned int x;
+
+    for (x = 0; x + ROW_PIXELS_32 <= count; x += ROW_PIXELS_32)
+    {
+        c = *(const ROW_FUNC(vec32) *)(src + x);
+        *(ROW_FUNC(vec32) *)(dst + x) = ((c & 0xff00ff00u) | ((c >> 16) & 0xffu) | ((c & 0xffu) << 16))
+                ^ 0x80808080u;
+    }
+    row_funcs_c.convert_row_r8g8b8a8_snorm(dst + x, src + x, count - x);
+}
+
+static inline ROW_TARGET ROW_FUNC(vec32) ROW_FUNC(expand_r5g6b5)(ROW_FUNC(vec32) c)
+{
+    return 0xff000000u
+            | ((((c >> 11) * 527u + 23) >> 6) << 16)
+            | (((((c >> 5) & 0x3f) * 259u + 33) >> 6) << 8)
+            | (((c & 0x1f) * 527u + 23) >> 6);
+}
+
+static ROW_TARGET void ROW_FUNC(convert_row_r5g6b5_x8r8g8b8)(uint32_t *dst, const uint16_t *src, unsigned int count)
+{
+    ROW_FUNC(vec32) c, even, odd;
+    unsigned int i, x;
+
+    /* Each 32-bit lane holds two source pixels. */
+    for (x = 0; x + ROW_PIXELS_16 <= count; x += ROW_PIXELS_16)
+    {
+        c = *(const ROW_FUNC(vec32) *)(src + x);
+        even = ROW_FUNC(expand_r5g6b5)(c & 0xffff);
+        odd = ROW_FUNC(expand_r5g6b5)(c >> 16);
+        for (i = 0; i < ROW_PIXELS_32; ++i)
+        {
+            dst[x + 2 * i] = even[i];
+            dst[x + 2 * i + 1] = odd[i];
+        }
+    }
+    row_funcs_c.convert_row_r5g6b5_x8r8g8b8(dst + x, src + x, count - x);
+}
+
+/* The colour key range is compared against the zero extended 16-bit value.
+ * Returns FALSE if no 16-bit value can be inside the range. */
+static inline BOOL ROW_FUNC(get_range_16)(uint32_t low, uint32_t high, ROW_FUNC(vec16) *low_vec,
+        ROW_FUNC(vec16) *high_vec)
+{
+    if (low > 0xffff || low > high)
+        return FALSE;
+    *low_vec = *high_vec = (ROW_FUNC(vec16)){0};
+    *low_vec += (uint16_t)low;
+    *high_vec += (uint16_t)min(high, 0xffff);
+    return TRUE;
+}
+
+static ROW_TARGET void ROW_FUNC(color_key_row_b5g6r5)(uint16_t *dst, const uint16_t *src, unsigned int count,
+        uint32_t low, uint32_t high)
+{
+    ROW_FUNC(vec16) c, low_vec, high_vec, in_range;
+    BOOL keyed;
+    unsigned int x;
+
+    keyed = ROW_FUNC(get_range_16)(low, high, &low_vec, &high_vec);
+    for (x = 0; x + ROW_PIXELS_16 <= count; x += ROW_PIXELS_16)
+    {
+        c = *(const ROW_FUNC(vec16) *)(src + x);
+        in_range = keyed ? (ROW_FUNC(vec16))((c >= low_vec) & (c <= high_vec)) : (ROW_FUNC(vec16)){0};
+        *(ROW_FUNC(vec16) *)(dst + x) = ((c & 0xffc0u) >> 1) | (c & 0x1fu) | (~in_range & 0x8000u);
+    }
+    row_funcs_c.color_key_row_b5g6r5(dst + x, src + x, count - x, low, high);
+}
+
+static ROW_TARGET void ROW_FUNC(color_key_row_b5g5r5x1)(uint16_t *dst, const uint16_t *src, unsigned int count,
+        uint32_t low, uint32_t high)
+{
+    ROW_FUNC(vec16) c, low_vec, high_vec, in_range;
+    BOOL keyed;
+    unsigned int x;
+
+    keyed = ROW_FUNC(get_range_16)(low, high, &low_vec, &high_vec);
+    for (x = 0; x + ROW_PIXELS_16 <= count; x += ROW_PIXELS_16)
+    {
+        c = *(const ROW_FUNC(vec16) *)(src + x);
+        in_range = keyed ? (ROW_FUNC(vec16))((c >= low_vec) & (c <= high_vec)) : (ROW_FUNC(vec16)){0};
+        *(ROW_FUNC(vec16) *)(dst + x) = (c & 0x7fffu) | (~in_range & 0x8000u);
+    }
+    row_funcs_c.color_key_row_b5g5r5x1(dst + x, src + x, count - x, low, high);
+}
+
+static ROW_TARGET void ROW_FUNC(color_key_row_32)(uint32_t *dst, const uint32_t *src, unsigned int count,
+        uint32_t low, uint32_t high, uint32_t alpha)
+{
+    ROW_FUNC(vec32) c, low_vec = {0}, high_vec = {0}, in_range;
+    unsigned int x;
+
+    low_vec += low;
+    high_vec += high;
+    for (x = 0; x + ROW_PIXELS_32 <= count; x += ROW_PIXELS_32)
+    {
+        c = *(const ROW_FUNC(vec32) *)(src + x);
+        in_range = (ROW_FUNC(vec32))((c >= low_vec) & (c <= high_vec));
+        *(ROW_FUNC(vec32) *)(dst + x) = (in_range & (c & 0x00ffffffu)) | (~in_range & (c | alpha));
+    }
+    row_funcs_c.color_key_row_32(dst + x, src + x, count - x, low, high, alpha);
+}
+
+static ROW_TARGET void ROW_FUNC(blt_row_color_key_16)(uint16_t *dst, const uint16_t *src, unsigned int count,
+        const struct wined3d_blt_color_keys *keys)
+{
+    ROW_FUNC(vec16) s, d, low, high, dst_low, dst_high, copy;
+    BOOL src_keyed, dst_keyed;
+    unsigned int x;
+
+    src_keyed = ROW_FUNC(get_range_16)(keys->low, keys->high, &low, &high);
+    dst_keyed = ROW_FUNC(get_range_16)(keys->dst_low, keys->dst_high, &dst_low, &dst_high);
+    /* No destination pixel can be inside the destination key range. */
+    if (!dst_keyed)
+        return;
+
+    for (x = 0; x + ROW_PIXELS_16 <= count; x += ROW_PIXELS_16)
+    {
+        s = *(const ROW_FUNC(vec16) *)(src + x);
+        d = *(ROW_FUNC(vec16) *)(dst + x);
+        copy = (ROW_FUNC(vec16))(((d & (uint16_t)keys->dst_mask) >= dst_low) & ((d & (uint16_t)keys->dst_mask) <= dst_high));
+        if (src_keyed)
+            copy &= (ROW_FUNC(vec16))(((s & (uint16_t)keys->mask) < low) | ((s & (uint16_t)keys->mask) > high));
+        *(ROW_FUNC(vec16) *)(dst + x) = (copy & s) | (~copy & d);
+    }
+    row_funcs_c.blt_row_color_key_16(dst + x, src + x, count - x, keys);
+}
+
+static ROW_TARGET void ROW_FUNC(blt_row_color_key_32)(uint32_t *dst, const uint32_t *src, unsigned int count,
+        const struct wined3d_blt_color_keys *keys)
+{
+    ROW_FUNC(vec32) s, d, low = {0}, high = {0}, dst_low = {0}, dst_high = {0}, copy;
+    unsigned int x;
+
+    low += keys->low;
+    high += keys->high;
+    dst_low += keys->dst_low;
+    dst_high += keys->dst_high;
+    for (x = 0; x + ROW_PIXELS_32 <= count; x += ROW_PIXELS_32)
+    {
+        s = *(const ROW_FUNC(vec32) *)(src + x);
+        d = *(ROW_FUNC(vec32) *)(dst + x);
+        copy = (ROW_FUNC(vec32))((((s & keys->mask) < low) | ((s & keys->mask) > high))
+                & ((d & keys->dst_mask) >= dst_low) & ((d & keys->dst_mask) <= dst_high));
+        *(ROW_FUNC(vec32) *)(dst + x) = (copy & s) | (~copy & d);
+    }
+    row_funcs_c.blt_row_color_key_32(dst + x, src + x, count - x, keys);
+}
+
+#undef ROW_PIXELS_16
+#undef ROW_PIXELS_32
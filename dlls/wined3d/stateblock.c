@@ -450,7 +450,8 @@ void state_unbind_resources(struct wined3d_state *state)
             if ((srv = state->shader_resource_view[i][j]))
             {
                 state->shader_resource_view[i][j] = NULL;
-                wined3d_srv_bind_count_dec(srv);
+                if (!(state->flags & WINED3D_STATE_NO_BIND_COUNT))
+                    wined3d_srv_bind_count_dec(srv);
                 wined3d_shader_resource_view_decref(srv);
             }
         }
@@ -1626,7 +1627,7 @@ HRESULT CDECL wined3d_stateblock_get_light(const struct wined3d_stateblock *stat
     return WINED3D_OK;
 }
 
-static void init_default_render_states(DWORD rs[WINEHIGHEST_RENDER_STATE + 1], const struct wined3d_d3d_info *d3d_info)
+void init_default_render_states(DWORD rs[WINEHIGHEST_RENDER_STATE + 1], const struct wined3d_d3d_info *d3d_info)
 {
     union
     {
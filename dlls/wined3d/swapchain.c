@@ -564,6 +564,8 @@ static void swapchain_gl_present(struct wined3d_swapchain *swapchain,
 
     TRACE("SwapBuffers called, Starting new frame\n");
 
+    wined3d_device_gl_streaming_buffer_fence(wined3d_device_gl(swapchain->device), context_gl);
+
     wined3d_texture_validate_location(swapchain->front_buffer, 0, WINED3D_LOCATION_DRAWABLE);
     wined3d_texture_invalidate_location(swapchain->front_buffer, 0, ~WINED3D_LOCATION_DRAWABLE);
 
@@ -2354,6 +2354,9 @@ static void wined3d_texture_gl_upload_data(struct wined3d_context *context,
             src_row_pitch, src_slice_pitch, dst_texture, dst_sub_resource_idx,
             wined3d_debug_location(dst_location), dst_x, dst_y, dst_z);
 
+    wined3d_frame_stats_add(WINED3D_FRAME_COUNTER_UPLOAD_BYTES, wined3d_format_calculate_size(src_format, 1,
+            src_box->right - src_box->left, src_box->bottom - src_box->top, src_box->back - src_box->front));
+
     if (dst_location == WINED3D_LOCATION_TEXTURE_SRGB)
     {
         srgb = TRUE;
@@ -3833,19 +3836,15 @@ static HRESULT wined3d_texture_init(struct wined3d_texture *texture, const struc
     return WINED3D_OK;
 }
 
-HRESULT CDECL wined3d_texture_blt(struct wined3d_texture *dst_texture, unsigned int dst_sub_resource_idx,
-        const RECT *dst_rect, struct wined3d_texture *src_texture, unsigned int src_sub_resource_idx,
-        const RECT *src_rect, DWORD flags, const struct wined3d_blt_fx *fx, enum wined3d_texture_filter_type filter)
+HRESULT wined3d_device_context_blt(struct wined3d_device_context *context,
+        struct wined3d_texture *dst_texture, unsigned int dst_sub_resource_idx, const RECT *dst_rect,
+        struct wined3d_texture *src_texture, unsigned int src_sub_resource_idx, const RECT *src_rect,
+        DWORD flags, const struct wined3d_blt_fx *fx, enum wined3d_texture_filter_type filter)
 {
     struct wined3d_box src_box = {src_rect->left, src_rect->top, src_rect->right, src_rect->bottom, 0, 1};
     struct wined3d_box dst_box = {dst_rect->left, dst_rect->top, dst_rect->right, dst_rect->bottom, 0, 1};
     HRESULT hr;
 
-    TRACE("dst_texture %p, dst_sub_resource_idx %u, dst_rect %s, src_texture %p, "
-            "src_sub_resource_idx %u, src_rect %s, flags %#x, fx %p, filter %s.\n",
-            dst_texture, dst_sub_resource_idx, wine_dbgstr_rect(dst_rect), src_texture,
-            src_sub_resource_idx, wine_dbgstr_rect(src_rect), flags, fx, debug_d3dtexturefiltertype(filter));
-
     if (dst_sub_resource_idx >= dst_texture->level_count * dst_texture->layer_count
             || dst_texture->resource.type != WINED3D_RTYPE_TEXTURE_2D)
         return WINED3DERR_INVALIDCALL;
@@ -3886,12 +3885,25 @@ HRESULT CDECL wined3d_texture_blt(struct wined3d_texture *dst_texture, unsigned
         return E_NOTIMPL;
     }
 
-    wined3d_cs_emit_blt_sub_resource(dst_texture->resource.device->cs, &dst_texture->resource, dst_sub_resource_idx,
+    wined3d_cs_emit_blt_sub_resource(context->cs, &dst_texture->resource, dst_sub_resource_idx,
             &dst_box, &src_texture->resource, src_sub_resource_idx, &src_box, flags, fx, filter);
 
     return WINED3D_OK;
 }
 
+HRESULT CDECL wined3d_texture_blt(struct wined3d_texture *dst_texture, unsigned int dst_sub_resource_idx,
+        const RECT *dst_rect, struct wined3d_texture *src_texture, unsigned int src_sub_resource_idx,
+        const RECT *src_rect, DWORD flags, const struct wined3d_blt_fx *fx, enum wined3d_texture_filter_type filter)
+{
+    TRACE("dst_texture %p, dst_sub_resource_idx %u, dst_rect %s, src_texture %p, "
+            "src_sub_resource_idx %u, src_rect %s, flags %#x, fx %p, filter %s.\n",
+            dst_texture, dst_sub_resource_idx, wine_dbgstr_rect(dst_rect), src_texture,
+            src_sub_resource_idx, wine_dbgstr_rect(src_rect), flags, fx, debug_d3dtexturefiltertype(filter));
+
+    return wined3d_device_context_blt(&dst_texture->resource.device->immediate_context, dst_texture,
+            dst_sub_resource_idx, dst_rect, src_texture, src_sub_resource_idx, src_rect, flags, fx, filter);
+}
+
 HRESULT CDECL wined3d_texture_get_overlay_position(const struct wined3d_texture *texture,
         unsigned int sub_resource_idx, LONG *x, LONG *y)
 {
@@ -4591,6 +4603,9 @@ static void wined3d_texture_vk_upload_data(struct wined3d_context *context,
             src_row_pitch, src_slice_pitch, dst_texture, dst_sub_resource_idx,
             wined3d_debug_location(dst_location), dst_x, dst_y, dst_z);
 
+    wined3d_frame_stats_add(WINED3D_FRAME_COUNTER_UPLOAD_BYTES, wined3d_format_calculate_size(src_format, 1,
+            src_box->right - src_box->left, src_box->bottom - src_box->top, src_box->back - src_box->front));
+
     if (src_bo_addr->buffer_object)
     {
         FIXME("Unhandled buffer object %#lx.\n", src_bo_addr->buffer_object);
@@ -674,6 +674,173 @@ struct wined3d_format_texture_info
             unsigned int width, unsigned int height, unsigned int depth);
 };
 
+static void fill_row_16(uint16_t *dst, uint16_t value, unsigned int count)
+{
+    unsigned int x;
+
+    for (x = 0; x < count; ++x)
+        dst[x] = value;
+}
+
+static void fill_row_32(uint32_t *dst, uint32_t value, unsigned int count)
+{
+    unsigned int x;
+
+    for (x = 0; x < count; ++x)
+        dst[x] = value;
+}
+
+static void or_row_32(uint32_t *dst, const uint32_t *src, uint32_t value, unsigned int count)
+{
+    unsigned int x;
+
+    for (x = 0; x < count; ++x)
+        dst[x] = src[x] | value;
+}
+
+static void convert_row_x8_d24_upload(uint32_t *dst, const uint32_t *src, unsigned int count)
+{
+    unsigned int x;
+
+    for (x = 0; x < count; ++x)
+        dst[x] = src[x] << 8 | ((src[x] >> 16) & 0xff);
+}
+
+static void convert_row_x8_d24_download(uint32_t *dst, const uint32_t *src, unsigned int count)
+{
+    unsigned int x;
+
+    for (x = 0; x < count; ++x)
+        dst[x] = src[x] >> 8;
+}
+
+/* Swaps the first and third channel, and converts the channels from signed
+ * to unsigned by adding 128. */
+static void convert_row_r8g8b8a8_snorm(uint32_t *dst, const uint32_t *src, unsigned int count)
+{
+    unsigned int x;
+    uint32_t c;
+
+    for (x = 0; x < count; ++x)
+    {
+        c = src[x];
+        dst[x] = ((c & 0xff00ff00u) | ((c >> 16) & 0xffu) | ((c & 0xffu) << 16)) ^ 0x80808080u;
+    }
+}
+
+/* (v * 527 + 23) >> 6 and (v * 259 + 33) >> 6 are round(v * 255 / 31) and
+ * round(v * 255 / 63) for all 5 and 6-bit values. */
+static void convert_row_r5g6b5_x8r8g8b8(uint32_t *dst, const uint16_t *src, unsigned int count)
+{
+    unsigned int x;
+    uint16_t c;
+
+    for (x = 0; x < count; ++x)
+    {
+        c = src[x];
+        dst[x] = 0xff000000u
+                | ((((c >> 11) * 527u + 23) >> 6) << 16)
+                | (((((c >> 5) & 0x3f) * 259u + 33) >> 6) << 8)
+                | (((c & 0x1f) * 527u + 23) >> 6);
+    }
+}
+
+static void color_key_row_b5g6r5(uint16_t *dst, const uint16_t *src, unsigned int count,
+        uint32_t low, uint32_t high)
+{
+    unsigned int x;
+    uint16_t c;
+
+    for (x = 0; x < count; ++x)
+    {
+        c = src[x];
+        if (c >= low && c <= high)
+            dst[x] = ((c & 0xffc0u) >> 1) | (c & 0x1fu);
+        else
+            dst[x] = 0x8000u | ((c & 0xffc0u) >> 1) | (c & 0x1fu);
+    }
+}
+
+static void color_key_row_b5g5r5x1(uint16_t *dst, const uint16_t *src, unsigned int count,
+        uint32_t low, uint32_t high)
+{
+    unsigned int x;
+    uint16_t c;
+
+    for (x = 0; x < count; ++x)
+    {
+        c = src[x];
+        if (c >= low && c <= high)
+            dst[x] = c & ~0x8000u;
+        else
+            dst[x] = c | 0x8000u;
+    }
+}
+
+/* Clears the alpha channel of the pixels inside the key range, and sets the
+ * bits in "alpha" for the other pixels. */
+static void color_key_row_32(uint32_t *dst, const uint32_t *src, unsigned int count,
+        uint32_t low, uint32_t high, uint32_t alpha)
+{
+    unsigned int x;
+    uint32_t c;
+
+    for (x = 0; x < count; ++x)
+    {
+        c = src[x];
+        if (c >= low && c <= high)
+            dst[x] = c & ~0xff000000u;
+        else
+            dst[x] = c | alpha;
+    }
+}
+
+static void blt_row_color_key_16(uint16_t *dst, const uint16_t *src, unsigned int count,
+        const struct wined3d_blt_color_keys *keys)
+{
+    uint32_t s, d;
+    unsigned int x;
+
+    for (x = 0; x < count; ++x)
+    {
+        s = src[x] & keys->mask;
+        d = dst[x] & keys->dst_mask;
+        if ((s < keys->low || s > keys->high) && d >= keys->dst_low && d <= keys->dst_high)
+            dst[x] = src[x];
+    }
+}
+
+static void blt_row_color_key_32(uint32_t *dst, const uint32_t *src, unsigned int count,
+        const struct wined3d_blt_color_keys *keys)
+{
+    uint32_t s, d;
+    unsigned int x;
+
+    for (x = 0; x < count; ++x)
+    {
+        s = src[x] & keys->mask;
+        d = dst[x] & keys->dst_mask;
+        if ((s < keys->low || s > keys->high) && d >= keys->dst_low && d <= keys->dst_high)
+            dst[x] = src[x];
+    }
+}
+
+struct wined3d_row_funcs wined3d_row_funcs =
+{
+    fill_row_16,
+    fill_row_32,
+    or_row_32,
+    convert_row_x8_d24_upload,
+    convert_row_x8_d24_download,
+    convert_row_r8g8b8a8_snorm,
+    convert_row_r5g6b5_x8r8g8b8,
+    color_key_row_b5g6r5,
+    color_key_row_b5g5r5x1,
+    color_key_row_32,
+    blt_row_color_key_16,
+    blt_row_color_key_32,
+};
+
 static void convert_l4a4_unorm(const BYTE *src, BYTE *dst, UINT src_row_pitch, UINT src_slice_pitch,
         UINT dst_row_pitch, UINT dst_slice_pitch, UINT width, UINT height, UINT depth)
 {
@@ -876,28 +1043,18 @@ static void convert_r8g8_snorm_l8x8_unorm(const BYTE *src, BYTE *dst, UINT src_r
 static void convert_r8g8_snorm_l8x8_unorm_nv(const BYTE *src, BYTE *dst, UINT src_row_pitch, UINT src_slice_pitch,
         UINT dst_row_pitch, UINT dst_slice_pitch, UINT width, UINT height, UINT depth)
 {
-    unsigned int x, y, z;
-    const DWORD *Source;
-    unsigned char *Dest;
+    unsigned int y, z;
 
     /* This implementation works with the fixed function pipeline and shaders
-     * without further modification after converting the surface.
+     * without further modification after converting the surface. The U, V and
+     * L channels are kept in place, and X is set to 0xff.
      */
     for (z = 0; z < depth; z++)
     {
         for (y = 0; y < height; y++)
         {
-            Source = (const DWORD *)(src + z * src_slice_pitch + y * src_row_pitch);
-            Dest = dst + z * dst_slice_pitch + y * dst_row_pitch;
-            for (x = 0; x < width; x++ )
-            {
-                LONG color = (*Source++);
-                /* L */ Dest[2] = ((color >> 16) & 0xff);   /* L */
-                /* V */ Dest[1] = ((color >> 8 ) & 0xff);   /* V */
-                /* U */ Dest[0] = (color         & 0xff);   /* U */
-                /* I */ Dest[3] = 255;                      /* X */
-                Dest += 4;
-            }
+            wined3d_row_funcs.or_row_32((uint32_t *)(dst + z * dst_slice_pitch + y * dst_row_pitch),
+                    (const uint32_t *)(src + z * src_slice_pitch + y * src_row_pitch), 0xff000000u, width);
         }
     }
 }
@@ -905,25 +1062,14 @@ static void convert_r8g8_snorm_l8x8_unorm_nv(const BYTE *src, BYTE *dst, UINT sr
 static void convert_r8g8b8a8_snorm(const BYTE *src, BYTE *dst, UINT src_row_pitch, UINT src_slice_pitch,
         UINT dst_row_pitch, UINT dst_slice_pitch, UINT width, UINT height, UINT depth)
 {
-    unsigned int x, y, z;
-    const DWORD *Source;
-    unsigned char *Dest;
+    unsigned int y, z;
 
     for (z = 0; z < depth; z++)
     {
         for (y = 0; y < height; y++)
         {
-            Source = (const DWORD *)(src + z * src_slice_pitch + y * src_row_pitch);
-            Dest = dst + z * dst_slice_pitch + y * dst_row_pitch;
-            for (x = 0; x < width; x++ )
-            {
-                LONG color = (*Source++);
-                /* B */ Dest[0] = ((color >> 16) & 0xff) + 128; /* W */
-                /* G */ Dest[1] = ((color >> 8 ) & 0xff) + 128; /* V */
-                /* R */ Dest[2] = (color         & 0xff) + 128; /* U */
-                /* A */ Dest[3] = ((color >> 24) & 0xff) + 128; /* Q */
-                Dest += 4;
-            }
+            wined3d_row_funcs.convert_row_r8g8b8a8_snorm((uint32_t *)(dst + z * dst_slice_pitch + y * dst_row_pitch),
+                    (const uint32_t *)(src + z * src_slice_pitch + y * src_row_pitch), width);
         }
     }
 }
@@ -1034,19 +1180,14 @@ static void x8_d24_unorm_upload(const BYTE *src, BYTE *dst,
         unsigned int dst_row_pitch, unsigned int dst_slice_pitch,
         unsigned int width, unsigned int height, unsigned int depth)
 {
-    unsigned int x, y, z;
+    unsigned int y, z;
 
     for (z = 0; z < depth; ++z)
     {
         for (y = 0; y < height; ++y)
         {
-            const DWORD *source = (const DWORD *)(src + z * src_slice_pitch + y * src_row_pitch);
-            DWORD *dest = (DWORD *)(dst + z * dst_slice_pitch + y * dst_row_pitch);
-
-            for (x = 0; x < width; ++x)
-            {
-                dest[x] = source[x] << 8 | ((source[x] >> 16) & 0xff);
-            }
+            wined3d_row_funcs.convert_row_x8_d24_upload((uint32_t *)(dst + z * dst_slice_pitch + y * dst_row_pitch),
+                    (const uint32_t *)(src + z * src_slice_pitch + y * src_row_pitch), width);
         }
     }
 }
@@ -1056,19 +1197,14 @@ static void x8_d24_unorm_download(const BYTE *src, BYTE *dst,
         unsigned int dst_row_pitch, unsigned int dst_slice_pitch,
         unsigned int width, unsigned int height, unsigned int depth)
 {
-    unsigned int x, y, z;
+    unsigned int y, z;
 
     for (z = 0; z < depth; ++z)
     {
         for (y = 0; y < height; ++y)
         {
-            const DWORD *source = (const DWORD *)(src + z * src_slice_pitch + y * src_row_pitch);
-            DWORD *dest = (DWORD *)(dst + z * dst_slice_pitch + y * dst_row_pitch);
-
-            for (x = 0; x < width; ++x)
-            {
-                dest[x] = source[x] >> 8;
-            }
+            wined3d_row_funcs.convert_row_x8_d24_download((uint32_t *)(dst + z * dst_slice_pitch + y * dst_row_pitch),
+                    (const uint32_t *)(src + z * src_slice_pitch + y * src_row_pitch), width);
         }
     }
 }
@@ -1085,22 +1221,12 @@ static void convert_b5g6r5_unorm_b5g5r5a1_unorm_color_key(const BYTE *src, unsig
         BYTE *dst, unsigned int dst_pitch, unsigned int width, unsigned int height,
         const struct wined3d_color_key *color_key)
 {
-    const WORD *src_row;
-    unsigned int x, y;
-    WORD *dst_row;
+    unsigned int y;
 
     for (y = 0; y < height; ++y)
     {
-        src_row = (WORD *)&src[src_pitch * y];
-        dst_row = (WORD *)&dst[dst_pitch * y];
-        for (x = 0; x < width; ++x)
-        {
-            WORD src_color = src_row[x];
-            if (!color_in_range(color_key, src_color))
-                dst_row[x] = 0x8000u | ((src_color & 0xffc0u) >> 1) | (src_color & 0x1fu);
-            else
-                dst_row[x] = ((src_color & 0xffc0u) >> 1) | (src_color & 0x1fu);
-        }
+        wined3d_row_funcs.color_key_row_b5g6r5((uint16_t *)&dst[dst_pitch * y], (const uint16_t *)&src[src_pitch * y],
+                width, color_key->color_space_low_value, color_key->color_space_high_value);
     }
 }
 
@@ -1108,22 +1234,13 @@ static void convert_b5g5r5x1_unorm_b5g5r5a1_unorm_color_key(const BYTE *src, uns
         BYTE *dst, unsigned int dst_pitch, unsigned int width, unsigned int height,
         const struct wined3d_color_key *color_key)
 {
-    const WORD *src_row;
-    unsigned int x, y;
-    WORD *dst_row;
+    unsigned int y;
 
     for (y = 0; y < height; ++y)
     {
-        src_row = (WORD *)&src[src_pitch * y];
-        dst_row = (WORD *)&dst[dst_pitch * y];
-        for (x = 0; x < width; ++x)
-        {
-            WORD src_color = src_row[x];
-            if (color_in_range(color_key, src_color))
-                dst_row[x] = src_color & ~0x8000;
-            else
-                dst_row[x] = src_color | 0x8000;
-        }
+        wined3d_row_funcs.color_key_row_b5g5r5x1((uint16_t *)&dst[dst_pitch * y],
+                (const uint16_t *)&src[src_pitch * y], width,
+                color_key->color_space_low_value, color_key->color_space_high_value);
     }
 }
 
@@ -1152,22 +1269,12 @@ static void convert_b8g8r8x8_unorm_b8g8r8a8_unorm_color_key(const BYTE *src, uns
         BYTE *dst, unsigned int dst_pitch, unsigned int width, unsigned int height,
         const struct wined3d_color_key *color_key)
 {
-    const DWORD *src_row;
-    unsigned int x, y;
-    DWORD *dst_row;
+    unsigned int y;
 
     for (y = 0; y < height; ++y)
     {
-        src_row = (DWORD *)&src[src_pitch * y];
-        dst_row = (DWORD *)&dst[dst_pitch * y];
-        for (x = 0; x < width; ++x)
-        {
-            DWORD src_color = src_row[x];
-            if (color_in_range(color_key, src_color))
-                dst_row[x] = src_color & ~0xff000000;
-            else
-                dst_row[x] = src_color | 0xff000000;
-        }
+        wined3d_row_funcs.color_key_row_32((uint32_t *)&dst[dst_pitch * y], (const uint32_t *)&src[src_pitch * y],
+                width, color_key->color_space_low_value, color_key->color_space_high_value, 0xff000000u);
     }
 }
 
@@ -1175,21 +1282,12 @@ static void convert_b8g8r8a8_unorm_b8g8r8a8_unorm_color_key(const BYTE *src, uns
         BYTE *dst, unsigned int dst_pitch, unsigned int width, unsigned int height,
         const struct wined3d_color_key *color_key)
 {
-    const DWORD *src_row;
-    unsigned int x, y;
-    DWORD *dst_row;
+    unsigned int y;
 
     for (y = 0; y < height; ++y)
     {
-        src_row = (DWORD *)&src[src_pitch * y];
-        dst_row = (DWORD *)&dst[dst_pitch * y];
-        for (x = 0; x < width; ++x)
-        {
-            DWORD src_color = src_row[x];
-            if (color_in_range(color_key, src_color))
-                src_color &= ~0xff000000;
-            dst_row[x] = src_color;
-        }
+        wined3d_row_funcs.color_key_row_32((uint32_t *)&dst[dst_pitch * y], (const uint32_t *)&src[src_pitch * y],
+                width, color_key->color_space_low_value, color_key->color_space_high_value, 0);
     }
 }
 
@@ -1246,10 +1246,18 @@ void shader_resource_view_generate_mipmaps(struct wined3d_shader_resource_view *
 }
 
 void CDECL wined3d_shader_resource_view_generate_mipmaps(struct wined3d_shader_resource_view *view)
+{
+    TRACE("view %p.\n", view);
+
+    wined3d_device_context_generate_mipmaps(&view->resource->device->immediate_context, view);
+}
+
+void CDECL wined3d_device_context_generate_mipmaps(struct wined3d_device_context *context,
+        struct wined3d_shader_resource_view *view)
 {
     struct wined3d_texture *texture;
 
-    TRACE("view %p.\n", view);
+    TRACE("context %p, view %p.\n", context, view);
 
     if (view->resource->type == WINED3D_RTYPE_BUFFER)
     {
@@ -1264,7 +1272,7 @@ void CDECL wined3d_shader_resource_view_generate_mipmaps(struct wined3d_shader_r
         return;
     }
 
-    wined3d_cs_emit_generate_mipmaps(view->resource->device->cs, view);
+    wined3d_cs_emit_generate_mipmaps(context->cs, view);
 }
 
 ULONG CDECL wined3d_unordered_access_view_incref(struct wined3d_unordered_access_view *view)
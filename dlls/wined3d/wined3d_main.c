@@ -119,6 +119,9 @@ struct wined3d_settings wined3d_settings =
     ~0u,            /* No CS shader model limit by default. */
     WINED3D_RENDERER_AUTO,
     WINED3D_SHADER_BACKEND_AUTO,
+    256,            /* 256 MB of persistent shader cache. */
+    NULL,           /* Store the shader cache in the local application data directory. */
+    FALSE,          /* Compile shaders synchronously by default. */
 };
 
 struct wined3d * CDECL wined3d_create(DWORD flags)
@@ -213,6 +216,8 @@ static BOOL wined3d_dll_init(HINSTANCE hInstDLL)
     }
     context_set_tls_idx(wined3d_context_tls_idx);
 
+    wined3d_init_row_funcs();
+
     /* We need our own window class for a fake window which we use to retrieve GL capabilities */
     /* We might need CS_OWNDC in the future if we notice strange things on Windows.
      * Various articles/posts about OpenGL problems on Windows recommend this. */
@@ -392,6 +397,40 @@ static BOOL wined3d_dll_init(HINSTANCE hInstDLL)
                 wined3d_settings.renderer = WINED3D_RENDERER_NO3D;
             }
         }
+        if (!get_config_key_dword(hkey, appkey, "ShaderCacheSize", &wined3d_settings.shader_cache_size))
+            TRACE("Limiting the shader cache to %u MB.\n", wined3d_settings.shader_cache_size);
+        if (!get_config_key_dword(hkey, appkey, "AsyncShaderCompile", &wined3d_settings.async_shader_compile))
+            ERR_(winediag)("Setting asynchronous shader compilation to %#x.\n",
+                    wined3d_settings.async_shader_compile);
+        if (!get_config_key(hkey, appkey, "ShaderCachePath", buffer, size))
+        {
+            size_t len = strlen(buffer) + 1;
+
+            if (!(wined3d_settings.shader_cache_path = heap_alloc(len)))
+                ERR("Failed to allocate shader cache path memory.\n");
+            else
+                memcpy(wined3d_settings.shader_cache_path, buffer, len);
+        }
+        if (!get_config_key_dword(hkey, appkey, "FrameStats", &tmpvalue) && tmpvalue)
+        {
+            ERR_(winediag)("Printing frame statistics.\n");
+            wined3d_settings.frame_stats |= WINED3D_FRAME_STATS_PRINT;
+        }
+        if (!get_config_key(hkey, appkey, "FrameStatsTrace", buffer, size))
+        {
+            size_t len = strlen(buffer) + 1;
+
+            if (!(wined3d_settings.frame_stats_trace = heap_alloc(len)))
+            {
+                ERR("Failed to allocate frame statistics trace path memory.\n");
+            }
+            else
+            {
+                memcpy(wined3d_settings.frame_stats_trace, buffer, len);
+                ERR_(winediag)("Writing frame statistics to %s.\n", debugstr_a(buffer));
+                wined3d_settings.frame_stats |= WINED3D_FRAME_STATS_TRACE;
+            }
+        }
     }
 
     if (appkey) RegCloseKey( appkey );
@@ -434,6 +473,8 @@ static BOOL wined3d_dll_destroy(HINSTANCE hInstDLL)
     heap_free(swapchain_state_table.hooks);
 
     heap_free(wined3d_settings.logo);
+    heap_free(wined3d_settings.shader_cache_path);
+    heap_free(wined3d_settings.frame_stats_trace);
     UnregisterClassA(WINED3D_OPENGL_WINDOW_CLASS_NAME, hInstDLL);
 
     DeleteCriticalSection(&wined3d_wndproc_cs);
@@ -442,8 +442,16 @@ struct wined3d_settings
     unsigned int max_sm_cs;
     enum wined3d_renderer renderer;
     enum wined3d_shader_backend shader_backend;
+    unsigned int shader_cache_size;
+    char *shader_cache_path;
+    unsigned int async_shader_compile;
+    unsigned int frame_stats;
+    char *frame_stats_trace;
 };
 
+#define WINED3D_FRAME_STATS_PRINT   0x00000001u
+#define WINED3D_FRAME_STATS_TRACE   0x00000002u
+
 extern struct wined3d_settings wined3d_settings DECLSPEC_HIDDEN;
 
 enum wined3d_shader_byte_code_format
@@ -1305,6 +1313,23 @@ struct wined3d_shader_frontend
     BOOL (*shader_is_end)(void *data, const DWORD **ptr);
 };
 
+struct wined3d_shader_ir_chunk;
+
+/* The decoded instruction stream of a shader. The frontend is only run once
+ * per shader; register and parameter data referenced by the instructions is
+ * stored in "chunks". "locations" holds the byte code location of each
+ * instruction, plus the end of the byte code. */
+struct wined3d_shader_ir
+{
+    struct wined3d_shader_version shader_version;
+    struct wined3d_shader_instruction *instructions;
+    SIZE_T instructions_size;
+    const DWORD **locations;
+    SIZE_T locations_size;
+    SIZE_T count;
+    struct wined3d_shader_ir_chunk *chunks;
+};
+
 extern const struct wined3d_shader_frontend sm1_shader_frontend DECLSPEC_HIDDEN;
 extern const struct wined3d_shader_frontend sm4_shader_frontend DECLSPEC_HIDDEN;
 
@@ -1482,6 +1507,28 @@ extern const struct wined3d_shader_backend_ops none_shader_backend DECLSPEC_HIDD
 const struct wined3d_shader_backend_ops *wined3d_spirv_shader_backend_init_vk(void) DECLSPEC_HIDDEN;
 void wined3d_spirv_shader_backend_cleanup(void) DECLSPEC_HIDDEN;
 
+#define WINED3D_SHADER_CACHE_HASH_INIT 0xcbf29ce484222325ull
+
+struct wined3d_shader_cache_key
+{
+    BYTE *data;
+    SIZE_T size, capacity;
+    BOOL invalid;
+};
+
+UINT64 wined3d_shader_cache_hash(UINT64 hash, const void *data, SIZE_T size) DECLSPEC_HIDDEN;
+void wined3d_shader_cache_key_add(struct wined3d_shader_cache_key *key,
+        const void *data, SIZE_T size) DECLSPEC_HIDDEN;
+void wined3d_shader_cache_key_add_so_desc(struct wined3d_shader_cache_key *key,
+        const struct wined3d_stream_output_desc *desc) DECLSPEC_HIDDEN;
+void wined3d_shader_cache_key_add_string(struct wined3d_shader_cache_key *key, const char *str) DECLSPEC_HIDDEN;
+void wined3d_shader_cache_key_add_uint(struct wined3d_shader_cache_key *key, unsigned int value) DECLSPEC_HIDDEN;
+void wined3d_shader_cache_key_cleanup(struct wined3d_shader_cache_key *key) DECLSPEC_HIDDEN;
+void wined3d_shader_cache_key_init(struct wined3d_shader_cache_key *key) DECLSPEC_HIDDEN;
+void *wined3d_shader_cache_load(const struct wined3d_shader_cache_key *key, SIZE_T *size) DECLSPEC_HIDDEN;
+void wined3d_shader_cache_store(const struct wined3d_shader_cache_key *key,
+        const void *data, SIZE_T size) DECLSPEC_HIDDEN;
+
 #define GL_EXTCALL(f) (gl_info->gl_ops.ext.p_##f)
 
 #define D3DCOLOR_B_R(dw) (((dw) >> 16) & 0xff)
@@ -1685,13 +1732,6 @@ void dispatch_compute(struct wined3d_device *device, const struct wined3d_state
 #define GET_TEXCOORD_SIZE_FROM_FVF(d3dvtVertexType, tex_num) \
     (((((d3dvtVertexType) >> (16 + (2 * (tex_num)))) + 1) & 0x03) + 1)
 
-enum wined3d_pipeline
-{
-    WINED3D_PIPELINE_GRAPHICS,
-    WINED3D_PIPELINE_COMPUTE,
-    WINED3D_PIPELINE_COUNT,
-};
-
 /* Routines and structures related to state management */
 
 #define STATE_RENDER(a) (a)
@@ -1883,6 +1923,7 @@ HRESULT wined3d_query_gl_create(struct wined3d_device *device, enum wined3d_quer
         const struct wined3d_parent_ops *parent_ops, struct wined3d_query **query) DECLSPEC_HIDDEN;
 void wined3d_query_gl_destroy_buffer_object(struct wined3d_context_gl *context_gl,
         struct wined3d_query *query) DECLSPEC_HIDDEN;
+void wined3d_query_update_issued(struct wined3d_query *query, DWORD flags) DECLSPEC_HIDDEN;
 
 struct wined3d_event_query
 {
@@ -2379,6 +2420,30 @@ struct wined3d_pipeline_layout_vk
     struct wined3d_pipeline_layout_key_vk key;
     VkPipelineLayout vk_pipeline_layout;
     VkDescriptorSetLayout vk_set_layout;
+    VkDescriptorUpdateTemplate vk_update_template;
+};
+
+union wined3d_descriptor_info_vk
+{
+    VkDescriptorBufferInfo buffer;
+    VkDescriptorImageInfo image;
+    VkBufferView buffer_view;
+};
+
+struct wined3d_descriptor_set_key_vk
+{
+    VkDescriptorSetLayout vk_set_layout;
+    UINT64 hash;
+    SIZE_T count;
+    const union wined3d_descriptor_info_vk *info;
+};
+
+struct wined3d_descriptor_set_vk
+{
+    struct wine_rb_entry entry;
+    struct wined3d_descriptor_set_key_vk key;
+    VkDescriptorSet vk_descriptor_set;
+    union wined3d_descriptor_info_vk info[1];
 };
 
 struct wined3d_graphics_pipeline_key_vk
@@ -2442,6 +2507,9 @@ struct wined3d_shader_descriptor_writes_vk
 {
     VkWriteDescriptorSet *writes;
     SIZE_T size, count;
+
+    union wined3d_descriptor_info_vk *info;
+    SIZE_T info_size;
 };
 
 struct wined3d_pending_query_vk
@@ -2466,7 +2534,8 @@ struct wined3d_context_vk
 
     uint32_t update_compute_pipeline : 1;
     uint32_t update_stream_output : 1;
-    uint32_t padding : 30;
+    uint32_t shaders_pending : 1;
+    uint32_t padding : 29;
 
     struct
     {
@@ -2475,6 +2544,7 @@ struct wined3d_context_vk
         VkPipeline vk_pipeline;
         VkPipelineLayout vk_pipeline_layout;
         VkDescriptorSetLayout vk_set_layout;
+        VkDescriptorUpdateTemplate vk_update_template;
         struct wined3d_shader_resource_bindings bindings;
     } graphics;
 
@@ -2483,6 +2553,7 @@ struct wined3d_context_vk
         VkPipeline vk_pipeline;
         VkPipelineLayout vk_pipeline_layout;
         VkDescriptorSetLayout vk_set_layout;
+        VkDescriptorUpdateTemplate vk_update_template;
         struct wined3d_shader_resource_bindings bindings;
     } compute;
 
@@ -2522,6 +2593,7 @@ struct wined3d_context_vk
     struct wine_rb_tree pipeline_layouts;
     struct wine_rb_tree graphics_pipelines;
     struct wine_rb_tree bo_slab_available;
+    struct wine_rb_tree descriptor_sets;
 };
 
 static inline struct wined3d_context_vk *wined3d_context_vk(struct wined3d_context *context)
@@ -3362,6 +3434,7 @@ struct wined3d_adapter_vk
 
     VkPhysicalDeviceLimits device_limits;
     VkPhysicalDeviceMemoryProperties memory_properties;
+    uint8_t pipeline_cache_uuid[VK_UUID_SIZE];
 };
 
 static inline struct wined3d_adapter_vk *wined3d_adapter_vk(struct wined3d_adapter *adapter)
@@ -3595,6 +3668,7 @@ struct wined3d_light_state
 
 #define WINED3D_STATE_NO_REF        0x00000001
 #define WINED3D_STATE_INIT_DEFAULT  0x00000002
+#define WINED3D_STATE_NO_BIND_COUNT 0x00000004
 
 struct wined3d_state
 {
@@ -3685,6 +3759,28 @@ struct wined3d_so_desc_entry
     struct wined3d_stream_output_element elements[1];
 };
 
+struct wined3d_device_context_ops
+{
+    HRESULT (*map)(struct wined3d_device_context *context, struct wined3d_resource *resource,
+            unsigned int sub_resource_idx, struct wined3d_map_desc *map_desc, const struct wined3d_box *box,
+            DWORD flags);
+    HRESULT (*unmap)(struct wined3d_device_context *context, struct wined3d_resource *resource,
+            unsigned int sub_resource_idx);
+    void (*issue_query)(struct wined3d_device_context *context, struct wined3d_query *query, DWORD flags);
+    void (*execute_command_list)(struct wined3d_device_context *context,
+            struct wined3d_command_list *list, BOOL restore_state);
+};
+
+/* The immediate context of a device, or a deferred context. Commands are
+ * emitted to "cs", against the application state in "state". */
+struct wined3d_device_context
+{
+    const struct wined3d_device_context_ops *ops;
+    struct wined3d_device *device;
+    struct wined3d_state *state;
+    struct wined3d_cs *cs;
+};
+
 struct wined3d_device
 {
     LONG ref;
@@ -3753,6 +3849,7 @@ struct wined3d_device
 
     /* Command stream */
     struct wined3d_cs *cs;
+    struct wined3d_device_context immediate_context;
 
     /* Context management */
     struct wined3d_context **contexts;
@@ -3793,12 +3890,40 @@ static inline struct wined3d_device_no3d *wined3d_device_no3d(struct wined3d_dev
     return CONTAINING_RECORD(device, struct wined3d_device_no3d, d);
 }
 
+#define WINED3D_STREAMING_BUFFER_SIZE           0x800000u
+#define WINED3D_STREAMING_FRAME_COUNT           4
+
+/* A persistently mapped ring buffer that DISCARD maps of dynamic buffers, as
+ * well as small buffer uploads, are written to. Unmap copies the written
+ * ranges into the destination buffer object on the GPU, and fences issued at
+ * present time tell us when ring space can be reused. Space that is still
+ * mapped is never covered by a fence, so it can't be reused. */
+struct wined3d_streaming_buffer_gl
+{
+    struct wined3d_bo_gl bo;
+    BYTE *map_ptr;
+    unsigned int size;
+    unsigned int head, tail;
+    /* Number of ring allocations that are currently mapped by the
+     * application, and thus not covered by any fence yet. */
+    unsigned int map_count;
+
+    struct
+    {
+        GLsync sync;
+        unsigned int end;
+    } frames[WINED3D_STREAMING_FRAME_COUNT];
+    unsigned int frame_start, frame_count;
+};
+
 struct wined3d_device_gl
 {
     struct wined3d_device d;
 
     /* Textures for when no other textures are bound. */
     struct wined3d_dummy_textures dummy_textures;
+
+    struct wined3d_streaming_buffer_gl streaming_buffer;
 };
 
 static inline struct wined3d_device_gl *wined3d_device_gl(struct wined3d_device *device)
@@ -3806,6 +3931,11 @@ static inline struct wined3d_device_gl *wined3d_device_gl(struct wined3d_device
     return CONTAINING_RECORD(device, struct wined3d_device_gl, d);
 }
 
+BOOL wined3d_device_gl_streaming_buffer_alloc(struct wined3d_device_gl *device_gl,
+        struct wined3d_context_gl *context_gl, unsigned int size, unsigned int *offset) DECLSPEC_HIDDEN;
+void wined3d_device_gl_streaming_buffer_fence(struct wined3d_device_gl *device_gl,
+        struct wined3d_context_gl *context_gl) DECLSPEC_HIDDEN;
+
 struct wined3d_null_image_vk
 {
     VkImage vk_image;
@@ -3921,6 +4051,10 @@ struct wined3d_device_vk
 
     struct wined3d_vk_info vk_info;
 
+    VkPipelineCache vk_pipeline_cache;
+    struct wined3d_shader_cache_key pipeline_cache_key;
+    size_t pipeline_cache_size;
+
     struct wined3d_null_resources_vk null_resources_vk;
     struct wined3d_null_views_vk null_views_vk;
 
@@ -4573,6 +4707,8 @@ HRESULT wined3d_light_state_set_light(struct wined3d_light_state *state, DWORD l
 
 void state_cleanup(struct wined3d_state *state) DECLSPEC_HIDDEN;
 void state_init(struct wined3d_state *state, const struct wined3d_d3d_info *d3d_info, DWORD flags) DECLSPEC_HIDDEN;
+void init_default_render_states(DWORD rs[WINEHIGHEST_RENDER_STATE + 1],
+        const struct wined3d_d3d_info *d3d_info) DECLSPEC_HIDDEN;
 void state_unbind_resources(struct wined3d_state *state) DECLSPEC_HIDDEN;
 
 enum wined3d_cs_queue_id
@@ -4596,19 +4732,85 @@ enum wined3d_push_constants
 #define WINED3D_CS_QUEUE_SIZE           0x100000u
 #define WINED3D_CS_SPIN_COUNT           10000000u
 
+/* Several threads may add packets to a queue. Space is claimed by advancing
+ * "reserved", and packets are published by advancing "head", in the same
+ * order the space was claimed in. */
 struct wined3d_cs_queue
 {
     LONG head, tail;
+    LONG reserved;
     BYTE data[WINED3D_CS_QUEUE_SIZE];
 };
 
 struct wined3d_cs_ops
 {
     void *(*require_space)(struct wined3d_cs *cs, size_t size, enum wined3d_cs_queue_id queue_id);
-    void (*submit)(struct wined3d_cs *cs, enum wined3d_cs_queue_id queue_id);
+    void (*submit)(struct wined3d_cs *cs, void *data, enum wined3d_cs_queue_id queue_id);
     void (*finish)(struct wined3d_cs *cs, enum wined3d_cs_queue_id queue_id);
     void (*push_constants)(struct wined3d_cs *cs, enum wined3d_push_constants p,
             unsigned int start_idx, unsigned int count, const void *constants);
+    void (*acquire_resource)(struct wined3d_cs *cs, struct wined3d_resource *resource);
+};
+
+enum wined3d_frame_counter
+{
+    WINED3D_FRAME_COUNTER_CS_QUEUE_FILL,
+    WINED3D_FRAME_COUNTER_CS_WAITS,
+    WINED3D_FRAME_COUNTER_CS_WAIT_TIME,
+    WINED3D_FRAME_COUNTER_SHADER_COMPILES,
+    WINED3D_FRAME_COUNTER_UPLOAD_BYTES,
+    WINED3D_FRAME_COUNTER_MAPS,
+    WINED3D_FRAME_COUNTER_MAP_WAIT_TIME,
+    WINED3D_FRAME_COUNTER_DESCRIPTOR_SET_ALLOCS,
+    WINED3D_FRAME_COUNTER_DESCRIPTOR_SET_REUSES,
+    WINED3D_FRAME_COUNTER_PIPELINE_COMPILES,
+    WINED3D_FRAME_COUNTER_PIPELINE_COMPILE_TIME,
+    WINED3D_FRAME_COUNTER_SHADER_CACHE_HITS,
+    WINED3D_FRAME_COUNTER_SHADER_COMPILE_TIME,
+    WINED3D_FRAME_COUNTER_COUNT,
+};
+
+#define WINED3D_FRAME_STATS_MAX_OPS     64
+#define WINED3D_FRAME_STATS_FRAME_COUNT 1024
+
+/* Times are in microseconds. */
+struct wined3d_frame_stats
+{
+    LONGLONG start, end;
+    LONG counters[WINED3D_FRAME_COUNTER_COUNT];
+    unsigned int op_counts[WINED3D_FRAME_STATS_MAX_OPS];
+};
+
+extern LONG wined3d_frame_counters[WINED3D_FRAME_COUNTER_COUNT] DECLSPEC_HIDDEN;
+
+static inline void wined3d_frame_stats_add(enum wined3d_frame_counter counter, LONG value)
+{
+    if (wined3d_settings.frame_stats)
+        InterlockedExchangeAdd(&wined3d_frame_counters[counter], value);
+}
+
+LONGLONG wined3d_frame_stats_time(void) DECLSPEC_HIDDEN;
+void wined3d_frame_stats_init(struct wined3d_cs *cs) DECLSPEC_HIDDEN;
+void wined3d_frame_stats_end_frame(struct wined3d_cs *cs) DECLSPEC_HIDDEN;
+void wined3d_frame_stats_cleanup(struct wined3d_cs *cs) DECLSPEC_HIDDEN;
+
+#define WINED3D_CS_MAX_PENDING_STATES   64
+
+enum wined3d_cs_state_key
+{
+    WINED3D_CS_KEY_RENDER_STATE         = 0,
+    WINED3D_CS_KEY_TEXTURE_STATE        = WINED3D_CS_KEY_RENDER_STATE + WINEHIGHEST_RENDER_STATE + 1,
+    WINED3D_CS_KEY_SAMPLER_STATE        = WINED3D_CS_KEY_TEXTURE_STATE
+            + WINED3D_MAX_TEXTURES * (WINED3D_HIGHEST_TEXTURE_STATE + 1),
+    WINED3D_CS_KEY_TEXTURE              = WINED3D_CS_KEY_SAMPLER_STATE
+            + WINED3D_MAX_COMBINED_SAMPLERS * (WINED3D_HIGHEST_SAMPLER_STATE + 1),
+    WINED3D_CS_KEY_SHADER_RESOURCE_VIEW = WINED3D_CS_KEY_TEXTURE + WINED3D_MAX_COMBINED_SAMPLERS,
+    WINED3D_CS_KEY_SAMPLER              = WINED3D_CS_KEY_SHADER_RESOURCE_VIEW
+            + WINED3D_SHADER_TYPE_COUNT * MAX_SHADER_RESOURCE_VIEWS,
+    WINED3D_CS_KEY_CONSTANT_BUFFER      = WINED3D_CS_KEY_SAMPLER + WINED3D_SHADER_TYPE_COUNT * MAX_SAMPLER_OBJECTS,
+    WINED3D_CS_KEY_STREAM_SOURCE        = WINED3D_CS_KEY_CONSTANT_BUFFER
+            + WINED3D_SHADER_TYPE_COUNT * MAX_CONSTANT_BUFFERS,
+    WINED3D_CS_KEY_COUNT                = WINED3D_CS_KEY_STREAM_SOURCE + WINED3D_MAX_STREAMS,
 };
 
 struct wined3d_cs
@@ -4629,10 +4831,77 @@ struct wined3d_cs
     HANDLE event;
     BOOL waiting_for_event;
     LONG pending_presents;
+
+    /* State changes made since the last queued command. "pending_state_slots"
+     * maps a wined3d_cs_state_key to its index in "pending_states" plus one. */
+    unsigned int pending_state_count;
+    unsigned int pending_state_sets;
+    BYTE pending_state_slots[WINED3D_CS_KEY_COUNT];
+    unsigned short pending_state_keys[WINED3D_CS_MAX_PENDING_STATES];
+    union
+    {
+        void *ptr;
+        BYTE data[24];
+    } pending_states[WINED3D_CS_MAX_PENDING_STATES];
+
+    /* State changes dropped or merged since the last present. */
+    unsigned int redundant_state_count;
+    unsigned int coalesced_state_count;
+
+    /* Statistics for the last WINED3D_FRAME_STATS_FRAME_COUNT frames, and
+     * the frame currently being executed. Only accessed from the CS thread. */
+    struct wined3d_frame_stats *frame_stats;
+    unsigned int frame_stats_count;
+    struct wined3d_frame_stats frame;
+};
+
+struct wined3d_deferred_map
+{
+    struct wined3d_resource *resource;
+    unsigned int sub_resource_idx;
+    unsigned int row_pitch, slice_pitch;
+    void *data;
+    BOOL mapped;
+};
+
+struct wined3d_deferred_query_issue
+{
+    struct wined3d_query *query;
+    DWORD flags;
+};
+
+struct wined3d_deferred_context
+{
+    struct wined3d_device_context c;
+
+    /* Commands are recorded into "cs.data", against the state in "cs.state".
+     * The state holds references, but no bind counts. */
+    struct wined3d_cs cs;
+    /* E_OUTOFMEMORY once a command failed to be recorded. */
+    HRESULT hr;
+
+    SIZE_T resources_size, resource_count;
+    struct wined3d_resource **resources;
+
+    SIZE_T uploads_size, upload_count;
+    void **uploads;
+    SIZE_T maps_size, map_count;
+    struct wined3d_deferred_map *maps;
+    SIZE_T query_issues_size, query_issue_count;
+    struct wined3d_deferred_query_issue *query_issues;
+    SIZE_T command_lists_size, command_list_count;
+    struct wined3d_command_list **command_lists;
 };
 
+HRESULT wined3d_device_context_blt(struct wined3d_device_context *context,
+        struct wined3d_texture *dst_texture, unsigned int dst_sub_resource_idx, const RECT *dst_rect,
+        struct wined3d_texture *src_texture, unsigned int src_sub_resource_idx, const RECT *src_rect,
+        DWORD flags, const struct wined3d_blt_fx *fx, enum wined3d_texture_filter_type filter) DECLSPEC_HIDDEN;
+void wined3d_device_context_reset_app_state(struct wined3d_device_context *context) DECLSPEC_HIDDEN;
+
 struct wined3d_cs *wined3d_cs_create(struct wined3d_device *device) DECLSPEC_HIDDEN;
 void wined3d_cs_destroy(struct wined3d_cs *cs) DECLSPEC_HIDDEN;
+const char *wined3d_debug_cs_op(unsigned int op) DECLSPEC_HIDDEN;
 void wined3d_cs_destroy_object(struct wined3d_cs *cs,
         void (*callback)(void *object), void *object) DECLSPEC_HIDDEN;
 void wined3d_cs_emit_add_dirty_texture_region(struct wined3d_cs *cs,
@@ -4659,13 +4928,16 @@ void wined3d_cs_emit_draw(struct wined3d_cs *cs, enum wined3d_primitive_type pri
 void wined3d_cs_emit_draw_indirect(struct wined3d_cs *cs, enum wined3d_primitive_type primitive_type,
         unsigned int patch_vertex_count, struct wined3d_buffer *buffer,
         unsigned int offset, bool indexed) DECLSPEC_HIDDEN;
+void wined3d_cs_emit_execute_command_list(struct wined3d_cs *cs,
+        struct wined3d_command_list *list) DECLSPEC_HIDDEN;
 void wined3d_cs_emit_flush(struct wined3d_cs *cs) DECLSPEC_HIDDEN;
 void wined3d_cs_emit_generate_mipmaps(struct wined3d_cs *cs, struct wined3d_shader_resource_view *view) DECLSPEC_HIDDEN;
 void wined3d_cs_emit_preload_resource(struct wined3d_cs *cs, struct wined3d_resource *resource) DECLSPEC_HIDDEN;
 void wined3d_cs_emit_present(struct wined3d_cs *cs, struct wined3d_swapchain *swapchain, const RECT *src_rect,
         const RECT *dst_rect, HWND dst_window_override, unsigned int swap_interval, DWORD flags) DECLSPEC_HIDDEN;
 void wined3d_cs_emit_query_issue(struct wined3d_cs *cs, struct wined3d_query *query, DWORD flags) DECLSPEC_HIDDEN;
-void wined3d_cs_emit_reset_state(struct wined3d_cs *cs) DECLSPEC_HIDDEN;
+void wined3d_cs_emit_reset_state(struct wined3d_cs *cs, bool invalidate) DECLSPEC_HIDDEN;
+void wined3d_cs_emit_restore_state(struct wined3d_cs *cs, const struct wined3d_state *state) DECLSPEC_HIDDEN;
 void wined3d_cs_emit_set_blend_state(struct wined3d_cs *cs, struct wined3d_blend_state *state,
         const struct wined3d_color *blend_factor, unsigned int sample_mask) DECLSPEC_HIDDEN;
 void wined3d_cs_emit_set_clip_plane(struct wined3d_cs *cs, UINT plane_idx,
@@ -4825,6 +5097,10 @@ struct wined3d_buffer_gl
 
     struct wined3d_bo_gl bo;
     GLenum buffer_object_usage;
+
+    /* Offset of the current map in the device streaming buffer, if any. */
+    unsigned int streaming_offset;
+    BOOL streaming;
 };
 
 static inline struct wined3d_buffer_gl *wined3d_buffer_gl(struct wined3d_buffer *buffer)
@@ -5383,7 +5659,7 @@ struct wined3d_shader
     unsigned int byte_code_size;
     BOOL load_local_constsF;
     const struct wined3d_shader_frontend *frontend;
-    void *frontend_data;
+    struct wined3d_shader_ir ir;
     void *backend_data;
 
     void *parent;
@@ -5623,6 +5899,42 @@ struct wined3d_color_key_conversion
             unsigned int width, unsigned int height, const struct wined3d_color_key *colour_key);
 };
 
+/* Source and destination colour keys of CPU blits. A source pixel is copied
+ * if it is outside the source key range, and the destination pixel is inside
+ * the destination key range, after applying the respective masks. */
+struct wined3d_blt_color_keys
+{
+    uint32_t mask, low, high;
+    uint32_t dst_mask, dst_low, dst_high;
+};
+
+/* Inner loops of the CPU format conversions and blits that have vectorised
+ * versions, see simd.c. */
+struct wined3d_row_funcs
+{
+    void (*fill_row_16)(uint16_t *dst, uint16_t value, unsigned int count);
+    void (*fill_row_32)(uint32_t *dst, uint32_t value, unsigned int count);
+    void (*or_row_32)(uint32_t *dst, const uint32_t *src, uint32_t value, unsigned int count);
+    void (*convert_row_x8_d24_upload)(uint32_t *dst, const uint32_t *src, unsigned int count);
+    void (*convert_row_x8_d24_download)(uint32_t *dst, const uint32_t *src, unsigned int count);
+    void (*convert_row_r8g8b8a8_snorm)(uint32_t *dst, const uint32_t *src, unsigned int count);
+    void (*convert_row_r5g6b5_x8r8g8b8)(uint32_t *dst, const uint16_t *src, unsigned int count);
+    void (*color_key_row_b5g6r5)(uint16_t *dst, const uint16_t *src, unsigned int count,
+            uint32_t low, uint32_t high);
+    void (*color_key_row_b5g5r5x1)(uint16_t *dst, const uint16_t *src, unsigned int count,
+            uint32_t low, uint32_t high);
+    void (*color_key_row_32)(uint32_t *dst, const uint32_t *src, unsigned int count,
+            uint32_t low, uint32_t high, uint32_t alpha);
+    void (*blt_row_color_key_16)(uint16_t *dst, const uint16_t *src, unsigned int count,
+            const struct wined3d_blt_color_keys *keys);
+    void (*blt_row_color_key_32)(uint32_t *dst, const uint32_t *src, unsigned int count,
+            const struct wined3d_blt_color_keys *keys);
+};
+
+extern struct wined3d_row_funcs wined3d_row_funcs DECLSPEC_HIDDEN;
+
+void wined3d_init_row_funcs(void) DECLSPEC_HIDDEN;
+
 struct wined3d_format
 {
     enum wined3d_format_id id;
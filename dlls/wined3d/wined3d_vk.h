@@ -172,6 +172,10 @@
     VK_DEVICE_PFN(vkUnmapMemory) \
     VK_DEVICE_PFN(vkUpdateDescriptorSets) \
     VK_DEVICE_PFN(vkWaitForFences) \
+    /* Vulkan 1.1 */ \
+    VK_DEVICE_EXT_PFN(vkCreateDescriptorUpdateTemplate) \
+    VK_DEVICE_EXT_PFN(vkDestroyDescriptorUpdateTemplate) \
+    VK_DEVICE_EXT_PFN(vkUpdateDescriptorSetWithTemplate) \
     /* VK_EXT_transform_feedback */ \
     VK_DEVICE_EXT_PFN(vkCmdBeginQueryIndexedEXT) \
     VK_DEVICE_EXT_PFN(vkCmdBeginTransformFeedbackEXT) \
@@ -735,18 +735,285 @@ GstCaps *caps_from_mf_media_type(IMFMediaType *type)
 /* IMFSample = GstBuffer
    IMFBuffer = GstMemory */
 
-/* TODO: Future optimization could be to create a custom
-   IMFMediaBuffer wrapper around GstMemory, and to utilize
-   gst_memory_new_wrapped on IMFMediaBuffer data.  However,
-   this wouldn't work if we allow the callers to allocate
-   the buffers. */
+/* Media buffer exposing GstBuffer memory directly. The GstBuffer is only mapped while the media
+   buffer is locked. Its memory may be shared with upstream elements, so it is only handed out
+   for writing when the GstBuffer is writable. Otherwise the first lock copies it, and the
+   GstBuffer is released. */
+struct gst_media_buffer
+{
+    IMFMediaBuffer IMFMediaBuffer_iface;
+    LONG refcount;
+
+    CRITICAL_SECTION cs;
+    GstBuffer *buffer;
+    GstMapInfo map_info;
+    BYTE *data;
+    unsigned int locks;
+    DWORD max_length;
+    DWORD current_length;
+};
+
+/* Decoders may allocate from a fixed size buffer pool, so only keep a limited number of
+   GstBuffers alive through media buffers. */
+#define MAX_GST_MEDIA_BUFFERS 16
+
+static LONG gst_media_buffer_count;
+
+static struct gst_media_buffer *impl_from_IMFMediaBuffer(IMFMediaBuffer *iface)
+{
+    return CONTAINING_RECORD(iface, struct gst_media_buffer, IMFMediaBuffer_iface);
+}
+
+static void gst_media_buffer_release_gst_buffer(struct gst_media_buffer *buffer)
+{
+    gst_buffer_unref(buffer->buffer);
+    buffer->buffer = NULL;
+    InterlockedDecrement(&gst_media_buffer_count);
+}
+
+static HRESULT WINAPI gst_media_buffer_QueryInterface(IMFMediaBuffer *iface, REFIID riid, void **obj)
+{
+    TRACE("%p, %s, %p.\n", iface, debugstr_guid(riid), obj);
+
+    if (IsEqualIID(riid, &IID_IMFMediaBuffer) ||
+            IsEqualIID(riid, &IID_IUnknown))
+    {
+        *obj = iface;
+        IMFMediaBuffer_AddRef(iface);
+        return S_OK;
+    }
+
+    WARN("Unsupported %s.\n", debugstr_guid(riid));
+    *obj = NULL;
+    return E_NOINTERFACE;
+}
+
+static ULONG WINAPI gst_media_buffer_AddRef(IMFMediaBuffer *iface)
+{
+    struct gst_media_buffer *buffer = impl_from_IMFMediaBuffer(iface);
+    ULONG refcount = InterlockedIncrement(&buffer->refcount);
+
+    TRACE("%p, refcount %u.\n", iface, refcount);
+
+    return refcount;
+}
+
+static ULONG WINAPI gst_media_buffer_Release(IMFMediaBuffer *iface)
+{
+    struct gst_media_buffer *buffer = impl_from_IMFMediaBuffer(iface);
+    ULONG refcount = InterlockedDecrement(&buffer->refcount);
+
+    TRACE("%p, refcount %u.\n", iface, refcount);
+
+    if (!refcount)
+    {
+        if (buffer->buffer)
+        {
+            if (buffer->locks)
+                gst_buffer_unmap(buffer->buffer, &buffer->map_info);
+            gst_media_buffer_release_gst_buffer(buffer);
+        }
+        else
+        {
+            heap_free(buffer->data);
+        }
+        DeleteCriticalSection(&buffer->cs);
+        heap_free(buffer);
+    }
+
+    return refcount;
+}
+
+static HRESULT WINAPI gst_media_buffer_Lock(IMFMediaBuffer *iface, BYTE **data, DWORD *max_length,
+        DWORD *current_length)
+{
+    struct gst_media_buffer *buffer = impl_from_IMFMediaBuffer(iface);
+    HRESULT hr = S_OK;
+
+    TRACE("%p, %p, %p, %p.\n", iface, data, max_length, current_length);
+
+    if (!data)
+        return E_INVALIDARG;
+
+    EnterCriticalSection(&buffer->cs);
+
+    if (!buffer->locks && buffer->buffer)
+    {
+        if (gst_buffer_is_writable(buffer->buffer)
+                && gst_buffer_map(buffer->buffer, &buffer->map_info, GST_MAP_READWRITE))
+        {
+            buffer->data = buffer->map_info.data;
+        }
+        else if (!(buffer->data = heap_alloc(buffer->max_length)))
+        {
+            hr = E_OUTOFMEMORY;
+        }
+        else if (!gst_buffer_map(buffer->buffer, &buffer->map_info, GST_MAP_READ))
+        {
+            heap_free(buffer->data);
+            buffer->data = NULL;
+            hr = E_FAIL;
+        }
+        else
+        {
+            memcpy(buffer->data, buffer->map_info.data, min(buffer->max_length, buffer->map_info.size));
+            gst_buffer_unmap(buffer->buffer, &buffer->map_info);
+            gst_media_buffer_release_gst_buffer(buffer);
+        }
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        ++buffer->locks;
+        *data = buffer->data;
+        if (max_length)
+            *max_length = buffer->max_length;
+        if (current_length)
+            *current_length = buffer->current_length;
+    }
+
+    LeaveCriticalSection(&buffer->cs);
+
+    return hr;
+}
+
+static HRESULT WINAPI gst_media_buffer_Unlock(IMFMediaBuffer *iface)
+{
+    struct gst_media_buffer *buffer = impl_from_IMFMediaBuffer(iface);
+    HRESULT hr = S_OK;
+
+    TRACE("%p.\n", iface);
+
+    EnterCriticalSection(&buffer->cs);
+
+    if (!buffer->locks)
+        hr = HRESULT_FROM_WIN32(ERROR_WAS_UNLOCKED);
+    else if (!--buffer->locks && buffer->buffer)
+    {
+        gst_buffer_unmap(buffer->buffer, &buffer->map_info);
+        buffer->data = NULL;
+    }
+
+    LeaveCriticalSection(&buffer->cs);
+
+    return hr;
+}
+
+static HRESULT WINAPI gst_media_buffer_GetCurrentLength(IMFMediaBuffer *iface, DWORD *current_length)
+{
+    struct gst_media_buffer *buffer = impl_from_IMFMediaBuffer(iface);
+
+    TRACE("%p, %p.\n", iface, current_length);
+
+    if (!current_length)
+        return E_INVALIDARG;
+
+    *current_length = buffer->current_length;
+
+    return S_OK;
+}
+
+static HRESULT WINAPI gst_media_buffer_SetCurrentLength(IMFMediaBuffer *iface, DWORD current_length)
+{
+    struct gst_media_buffer *buffer = impl_from_IMFMediaBuffer(iface);
+
+    TRACE("%p, %u.\n", iface, current_length);
+
+    if (current_length > buffer->max_length)
+        return E_INVALIDARG;
+
+    buffer->current_length = current_length;
+
+    return S_OK;
+}
+
+static HRESULT WINAPI gst_media_buffer_GetMaxLength(IMFMediaBuffer *iface, DWORD *max_length)
+{
+    struct gst_media_buffer *buffer = impl_from_IMFMediaBuffer(iface);
+
+    TRACE("%p, %p.\n", iface, max_length);
+
+    if (!max_length)
+        return E_INVALIDARG;
+
+    *max_length = buffer->max_length;
+
+    return S_OK;
+}
+
+static const IMFMediaBufferVtbl gst_media_buffer_vtbl =
+{
+    gst_media_buffer_QueryInterface,
+    gst_media_buffer_AddRef,
+    gst_media_buffer_Release,
+    gst_media_buffer_Lock,
+    gst_media_buffer_Unlock,
+    gst_media_buffer_GetCurrentLength,
+    gst_media_buffer_SetCurrentLength,
+    gst_media_buffer_GetMaxLength,
+};
+
+static HRESULT copy_gst_buffer(GstBuffer *gst_buffer, IMFMediaBuffer **buffer)
+{
+    GstMapInfo map_info;
+    BYTE *data;
+    HRESULT hr;
+
+    if (!gst_buffer_map(gst_buffer, &map_info, GST_MAP_READ))
+        return E_FAIL;
+
+    if (SUCCEEDED(hr = MFCreateMemoryBuffer(map_info.size, buffer)))
+    {
+        if (SUCCEEDED(hr = IMFMediaBuffer_Lock(*buffer, &data, NULL, NULL)))
+        {
+            memcpy(data, map_info.data, map_info.size);
+            IMFMediaBuffer_Unlock(*buffer);
+            hr = IMFMediaBuffer_SetCurrentLength(*buffer, map_info.size);
+        }
+        if (FAILED(hr))
+        {
+            IMFMediaBuffer_Release(*buffer);
+            *buffer = NULL;
+        }
+    }
+
+    gst_buffer_unmap(gst_buffer, &map_info);
+
+    return hr;
+}
+
+static HRESULT create_gst_media_buffer(GstBuffer *gst_buffer, IMFMediaBuffer **buffer)
+{
+    struct gst_media_buffer *object;
+
+    if (InterlockedIncrement(&gst_media_buffer_count) > MAX_GST_MEDIA_BUFFERS)
+    {
+        InterlockedDecrement(&gst_media_buffer_count);
+        return copy_gst_buffer(gst_buffer, buffer);
+    }
+
+    if (!(object = heap_alloc_zero(sizeof(*object))))
+    {
+        InterlockedDecrement(&gst_media_buffer_count);
+        return E_OUTOFMEMORY;
+    }
+
+    object->IMFMediaBuffer_iface.lpVtbl = &gst_media_buffer_vtbl;
+    object->refcount = 1;
+    InitializeCriticalSection(&object->cs);
+    object->buffer = gst_buffer_ref(gst_buffer);
+    object->max_length = gst_buffer_get_size(gst_buffer);
+    object->current_length = object->max_length;
+
+    *buffer = &object->IMFMediaBuffer_iface;
+
+    return S_OK;
+}
 
 IMFSample* mf_sample_from_gst_buffer(GstBuffer *gst_buffer)
 {
     IMFMediaBuffer *mf_buffer = NULL;
-    GstMapInfo map_info = {0};
     LONGLONG duration, time;
-    BYTE *mapped_buf = NULL;
     IMFSample *out = NULL;
     HRESULT hr;
 
@@ -762,24 +1029,7 @@ IMFSample* mf_sample_from_gst_buffer(GstBuffer *gst_buffer)
     if (FAILED(hr = IMFSample_SetSampleTime(out, time / 100)))
         goto done;
 
-    if (!gst_buffer_map(gst_buffer, &map_info, GST_MAP_READ))
-    {
-        hr = E_FAIL;
-        goto done;
-    }
-
-    if (FAILED(hr = MFCreateMemoryBuffer(map_info.maxsize, &mf_buffer)))
-        goto done;
-
-    if (FAILED(hr = IMFMediaBuffer_Lock(mf_buffer, &mapped_buf, NULL, NULL)))
-        goto done;
-
-    memcpy(mapped_buf, map_info.data, map_info.size);
-
-    if (FAILED(hr = IMFMediaBuffer_Unlock(mf_buffer)))
-        goto done;
-
-    if (FAILED(hr = IMFMediaBuffer_SetCurrentLength(mf_buffer, map_info.size)))
+    if (FAILED(hr = create_gst_media_buffer(gst_buffer, &mf_buffer)))
         goto done;
 
     if (FAILED(hr = IMFSample_AddBuffer(out, mf_buffer)))
@@ -788,11 +1038,9 @@ IMFSample* mf_sample_from_gst_buffer(GstBuffer *gst_buffer)
 done:
     if (mf_buffer)
         IMFMediaBuffer_Release(mf_buffer);
-    if (map_info.data)
-        gst_buffer_unmap(gst_buffer, &map_info);
     if (FAILED(hr))
     {
-        ERR("Failed to copy IMFSample to GstBuffer, hr = %#x\n", hr);
+        ERR("Failed to create IMFSample from GstBuffer, hr = %#x\n", hr);
         if (out)
             IMFSample_Release(out);
         out = NULL;
@@ -790,6 +790,21 @@ typedef struct
 } cursor_pos_t;
 
 
+typedef struct
+{
+    unsigned int   seq;
+    unsigned short type;
+    unsigned short generation;
+    process_id_t   pid;
+    thread_id_t    tid;
+    unsigned int   style;
+    unsigned int   ex_style;
+    lparam_t       id;
+    mod_handle_t   instance;
+    lparam_t       user_data;
+} shared_user_entry_t;
+
+
 
 
 
@@ -6391,7 +6406,7 @@ union generic_reply
 
 /* ### protocol_version begin ### */
 
-#define SERVER_PROTOCOL_VERSION 654
+#define SERVER_PROTOCOL_VERSION 655
 
 /* ### protocol_version end ### */
 
@@ -410,6 +410,8 @@ void init_directories(void)
     /* mappings */
     static const WCHAR user_dataW[] = {'_','_','w','i','n','e','_','u','s','e','r','_','s','h','a','r','e','d','_','d','a','t','a'};
     static const struct unicode_str user_data_str = {user_dataW, sizeof(user_dataW)};
+    static const WCHAR user_handlesW[] = {'_','_','w','i','n','e','_','u','s','e','r','_','h','a','n','d','l','e','s'};
+    static const struct unicode_str user_handles_str = {user_handlesW, sizeof(user_handlesW)};
 
     struct directory *dir_driver, *dir_device, *dir_global, *dir_kernel;
     struct object *named_pipe_device, *mailslot_device, *null_device;
@@ -451,6 +453,9 @@ void init_directories(void)
     /* user data mapping */
     release_object( create_user_data_mapping( &dir_kernel->obj, &user_data_str, OBJ_PERMANENT, NULL ));
 
+    /* user handle table mapping */
+    release_object( create_user_handles_mapping( &dir_kernel->obj, &user_handles_str, OBJ_PERMANENT, NULL ));
+
     release_object( named_pipe_device );
     release_object( mailslot_device );
     release_object( null_device );
@@ -130,6 +130,7 @@ struct timeout_user;
 extern timeout_t current_time;
 extern timeout_t monotonic_time;
 extern struct _KUSER_SHARED_DATA *user_shared_data;
+extern shared_user_entry_t *shared_user_entries;
 
 #define TICKS_PER_SEC 10000000
 
@@ -173,6 +174,8 @@ extern void free_mapped_views( struct process *process );
 extern int get_page_size(void);
 extern struct object *create_user_data_mapping( struct object *root, const struct unicode_str *name,
                                                 unsigned int attr, const struct security_descriptor *sd );
+extern struct object *create_user_handles_mapping( struct object *root, const struct unicode_str *name,
+                                                   unsigned int attr, const struct security_descriptor *sd );
 
 /* device functions */
 
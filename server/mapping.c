@@ -975,6 +975,20 @@ struct object *create_user_data_mapping( struct object *root, const struct unico
     return &mapping->obj;
 }
 
+struct object *create_user_handles_mapping( struct object *root, const struct unicode_str *name,
+                                           unsigned int attr, const struct security_descriptor *sd )
+{
+    void *ptr;
+    struct mapping *mapping;
+    mem_size_t size = ((LAST_USER_HANDLE - FIRST_USER_HANDLE + 1) >> 1) * sizeof(shared_user_entry_t);
+
+    if (!(mapping = create_mapping( root, name, attr, size, SEC_COMMIT, 0,
+                                    FILE_READ_DATA | FILE_WRITE_DATA, sd ))) return NULL;
+    ptr = mmap( NULL, mapping->size, PROT_READ | PROT_WRITE, MAP_SHARED, get_unix_fd( mapping->fd ), 0 );
+    if (ptr != MAP_FAILED) shared_user_entries = ptr;
+    return &mapping->obj;
+}
+
 /* create a file mapping */
 DECL_HANDLER(create_mapping)
 {
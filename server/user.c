@@ -34,6 +34,26 @@ static struct user_handle *freelist;
 static int nb_handles;
 static int allocated_handles;
 
+shared_user_entry_t *shared_user_entries = NULL;  /* handle table shared with the clients */
+
+/* start modifying a shared entry; readers retry while the sequence number is odd */
+static inline void begin_shared_entry_update( shared_user_entry_t *shared )
+{
+    __atomic_store_n( &shared->seq, shared->seq + 1, __ATOMIC_RELAXED );
+    __atomic_thread_fence( __ATOMIC_RELEASE );
+}
+
+static inline void end_shared_entry_update( shared_user_entry_t *shared )
+{
+    __atomic_store_n( &shared->seq, shared->seq + 1, __ATOMIC_RELEASE );
+}
+
+static inline shared_user_entry_t *get_shared_entry( struct user_handle *ptr )
+{
+    if (!shared_user_entries) return NULL;
+    return &shared_user_entries[ptr - handles];
+}
+
 static struct user_handle *handle_to_entry( user_handle_t handle )
 {
     unsigned short generation;
@@ -81,11 +101,19 @@ static inline struct user_handle *alloc_user_entry(void)
 
 static inline void *free_user_entry( struct user_handle *ptr )
 {
+    shared_user_entry_t *shared = get_shared_entry( ptr );
     void *ret;
+
     ret = ptr->ptr;
     ptr->ptr  = freelist;
     ptr->type = 0;
     freelist  = ptr;
+    if (shared)
+    {
+        begin_shared_entry_update( shared );
+        shared->type = 0;
+        end_shared_entry_update( shared );
+    }
     return ret;
 }
 
@@ -93,10 +121,26 @@ static inline void *free_user_entry( struct user_handle *ptr )
 user_handle_t alloc_user_handle( void *ptr, enum user_object type )
 {
     struct user_handle *entry = alloc_user_entry();
+    shared_user_entry_t *shared;
+
     if (!entry) return 0;
     entry->ptr  = ptr;
     entry->type = type;
     if (++entry->generation >= 0xffff) entry->generation = 1;
+    if ((shared = get_shared_entry( entry )))
+    {
+        begin_shared_entry_update( shared );
+        shared->type       = type;
+        shared->generation = entry->generation;
+        shared->pid        = 0;
+        shared->tid        = 0;
+        shared->style      = 0;
+        shared->ex_style   = 0;
+        shared->id         = 0;
+        shared->instance   = 0;
+        shared->user_data  = 0;
+        end_shared_entry_update( shared );
+    }
     return entry_to_handle( entry );
 }
 
@@ -109,6 +153,23 @@ void *get_user_object( user_handle_t handle, enum user_object type )
     return entry->ptr;
 }
 
+/* start updating the shared entry of a user object, must be followed by end_user_entry_update */
+shared_user_entry_t *begin_user_entry_update( user_handle_t handle )
+{
+    struct user_handle *entry;
+    shared_user_entry_t *shared;
+
+    if (!(entry = handle_to_entry( handle )) || !(shared = get_shared_entry( entry ))) return NULL;
+    begin_shared_entry_update( shared );
+    return shared;
+}
+
+/* publish the changes made to a shared entry */
+void end_user_entry_update( shared_user_entry_t *shared )
+{
+    end_shared_entry_update( shared );
+}
+
 /* get the full handle for a possibly truncated handle */
 user_handle_t get_user_full_handle( user_handle_t handle )
 {
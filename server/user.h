@@ -85,6 +85,8 @@ extern user_handle_t alloc_user_handle( void *ptr, enum user_object type );
 extern void *get_user_object( user_handle_t handle, enum user_object type );
 extern void *get_user_object_handle( user_handle_t *handle, enum user_object type );
 extern user_handle_t get_user_full_handle( user_handle_t handle );
+extern shared_user_entry_t *begin_user_entry_update( user_handle_t handle );
+extern void end_user_entry_update( shared_user_entry_t *shared );
 extern void *free_user_handle( user_handle_t handle );
 extern void *next_user_handle( user_handle_t *handle, enum user_object type );
 extern void free_process_user_handles( struct process *process );
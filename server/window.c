@@ -188,6 +188,22 @@ static unsigned int get_monitor_dpi( struct window *win )
     return win->dpi ? win->dpi : USER_DEFAULT_SCREEN_DPI;
 }
 
+/* update the window information that clients can read from the shared handle table */
+static void update_shared_window( struct window *win )
+{
+    shared_user_entry_t *shared;
+
+    if (!(shared = begin_user_entry_update( win->handle ))) return;
+    shared->pid       = win->thread ? get_process_id( win->thread->process ) : 0;
+    shared->tid       = win->thread ? get_thread_id( win->thread ) : 0;
+    shared->style     = win->style;
+    shared->ex_style  = win->ex_style;
+    shared->id        = win->id;
+    shared->instance  = win->instance;
+    shared->user_data = win->user_data;
+    end_user_entry_update( shared );
+}
+
 /* link a window at the right place in the siblings list */
 static void link_window( struct window *win, struct window *previous )
 {
@@ -241,6 +257,7 @@ static void link_window( struct window *win, struct window *previous )
     }
 
     win->is_linked = 1;
+    update_shared_window( win );
 }
 
 /* change the parent of a window (or unlink the window if the new parent is NULL) */
@@ -421,6 +438,7 @@ static void detach_window_thread( struct window *win )
     /* destroyed when the desktop ref count reaches zero */
     release_object( win->desktop );
     win->thread = NULL;
+    update_shared_window( win );
 }
 
 /* get the process owning the top window of a given desktop */
@@ -548,6 +566,7 @@ static struct window *create_window( struct window *parent, struct window *owner
     }
 
     current->desktop_users++;
+    update_shared_window( win );
     return win;
 
 failed:
@@ -1702,6 +1721,7 @@ static void set_window_pos( struct window *win, struct window *previous,
     if (!(swp_flags & SWP_NOZORDER) && win->parent) link_window( win, previous );
     if (swp_flags & SWP_SHOWWINDOW) win->style |= WS_VISIBLE;
     else if (swp_flags & SWP_HIDEWINDOW) win->style &= ~WS_VISIBLE;
+    update_shared_window( win );
 
     /* keep children at the same position relative to top right corner when the parent is mirrored */
     if (win->ex_style & WS_EX_LAYOUTRTL)
@@ -1878,6 +1898,7 @@ void destroy_window( struct window *win )
     {
         struct region *vis_rgn = get_visible_region( win, DCX_WINDOW );
         win->style &= ~WS_VISIBLE;
+        update_shared_window( win );
         if (vis_rgn)
         {
             struct region *exposed_rgn = expose_window( win, &win->window_rect, vis_rgn );
@@ -2027,6 +2048,7 @@ DECL_HANDLER(get_desktop_window)
         {
             detach_window_thread( desktop->top_window );
             desktop->top_window->style  = WS_POPUP | WS_VISIBLE | WS_CLIPSIBLINGS | WS_CLIPCHILDREN;
+            update_shared_window( desktop->top_window );
         }
     }
 
@@ -2039,6 +2061,7 @@ DECL_HANDLER(get_desktop_window)
         {
             detach_window_thread( desktop->msg_window );
             desktop->msg_window->style = WS_POPUP | WS_CLIPSIBLINGS | WS_CLIPCHILDREN;
+            update_shared_window( desktop->msg_window );
         }
     }
 
@@ -2145,6 +2168,7 @@ DECL_HANDLER(set_window_info)
     if (req->flags & SET_WIN_USERDATA) win->user_data = req->user_data;
     if (req->flags & SET_WIN_EXTRA) memcpy( win->extra_bytes + req->extra_offset,
                                             &req->extra_value, req->extra_size );
+    if (req->flags) update_shared_window( win );
 
     /* changing window style triggers a non-client paint */
     if (req->flags & SET_WIN_STYLE) win->paint_flags |= PAINT_NONCLIENT;